@@ -41,6 +41,7 @@ ln -s -f simset convert
 ln -s -f simset buildatt
 ln -s -f simset combinebin
 ln -s -f simset combinehist
+ln -s -f simset indexhist
 ln -s -f simset reversebytes
 ln -s -f simset displayheader
 ln -s -f simset makeindexfile
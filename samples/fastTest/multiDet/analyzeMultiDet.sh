@@ -0,0 +1,25 @@
+echo "CHECK OF THE DETECTOR INTERACTIONS BINNED FOR THE FIRST OF TWO TOMOGRAPHS"
+echo "____________________________________________"
+echo
+echo "Radial range of the first tomograph's binned detector interactions"
+echo "(its detector spans 14.9 to 18.5 cm):"
+nice ../../../bin/bin -d multiDet.histin > multiDet.histout
+awk '/detector interaction =/ {
+		n++
+		r = sqrt($4*$4 + $5*$5)
+		if ((n == 1) || (r < minR)) minR = r
+		if ((n == 1) || (r > maxR)) maxR = r
+		if ((r < 14.89) || (r > 18.51)) bad++
+	}
+	END {
+		printf("Interactions = %d, minimum radius = %.3f, maximum radius = %.3f\n", n, minR, maxR)
+		if (n == 0)
+			print "FAILED: no interactions were read."
+		else if (bad == 0)
+			print "PASSED: all interactions lie within the first tomograph."
+		else
+			printf("FAILED: %d interactions lie outside the first tomograph.\n", bad)
+	}' multiDet.histout
+rm multiDet0.binhist multiDet1.binhist
+echo "____________________________________________"
+echo "____________________________________________"
@@ -0,0 +1,13 @@
+echo "Starting multiDet simulation at:"
+date
+
+echo
+echo "For current status of the simulation see multiDet/multiDet.phgout"
+
+nice ../../../bin/phg multiDet.phgin > multiDet.phgout
+
+echo
+echo "Ending multiDet simulation at:"
+date
+echo "---------------------------------"
+echo
@@ -127,6 +127,18 @@ cd SPECTfan
 ./analyzeSPECTfan.sh
 cd ..
 
+echo "Press return to continue."
+read DUMMY
+echo
+echo
+echo
+echo
+echo
+
+cd multiDet
+./analyzeMultiDet.sh
+cd ..
+
 echo
 echo
 echo "resultsFast complete."
@@ -1,11 +1,12 @@
 echo
-echo "This macro runs nine simulations designed to provide a fast"
+echo "This macro runs ten simulations designed to provide a fast"
 echo "test of many major SimSET features.  The simulations are"
 echo "3d PET (PET3d), 2d PET (PET2d), block-detector PET (PETblock),"
 echo "time-of-flight PET (TOFPET), a PET simulation with randoms"
 echo "simulation incorporated (randPET), dual-head coincidence imaging"
-echo "(DHCI), SPECT (SPECT), cone-beam SPECT (SPECTcone), and fan-"
-echo "beam SPECT (SPECTfan).  Further details about each of these"
+echo "(DHCI), SPECT (SPECT), cone-beam SPECT (SPECTcone), fan-"
+echo "beam SPECT (SPECTfan), and 3d PET with two tomographs"
+echo "(multiDet).  Further details about each of these"
 echo "simulations are available in the %%ReadMe%% files in each"
 echo "subdirectory."
 echo
@@ -37,6 +38,9 @@ cd ../SPECTfan
 cd ../SPECTcone
 ./runSPECTcone.sh
 
+cd ../multiDet
+./runMultiDet.sh
+
 cd ..
 
 echo
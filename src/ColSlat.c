@@ -347,6 +347,7 @@ Boolean colTrackSlat(PHG_TrackingPhoton *photonPtr)
 	double						fpToGo;					/* Free paths to travel in crystal */
 	double						comptonToScatterProbability;		/* Ratio of prob of compton to prob of scatter */
 	double						scatterProbability;		/* Probability of a scatter */
+	SubObjInteractionTy			*interactionPtr;		/* Interaction values of the material */
 	double						interactionProbability;	/* Interaction type probability */
 	double						backOfLayer = 0.0;		/* "Back" of the block in local coordinates */
 	double						frontOfLayer = 0.0;		/* "Front" of the block in local coordinates */
@@ -597,8 +598,9 @@ do { /* Process Loop */
 	
 
 		/* Get probability of scatter */
-		comptonToScatterProbability = SubObjGetProbComptToScatInTomo2(colData[ColCurParams].colSlatSegs[curLayer][curSeg].Material, photonPtr->energy);
-		scatterProbability = SubObjGetProbScatterInTomo2(colData[ColCurParams].colSlatSegs[curLayer][curSeg].Material, photonPtr->energy);
+		interactionPtr = SubObjGetInteractionInTomo2(colData[ColCurParams].colSlatSegs[curLayer][curSeg].Material, photonPtr->energy);
+		comptonToScatterProbability = interactionPtr->probComptonToScatter;
+		scatterProbability = interactionPtr->probScatter;
 		interactionProbability = PhgMathGetRandomNumber();
 		
 		/* See if photon is absorbed */
@@ -118,6 +118,7 @@
 #include "ColSlat.h"
 #include "phg.h"
 #include "PhgBin.h"
+#include "PhgParallel.h"
 
 
 /* Local types */
@@ -742,6 +743,25 @@ Boolean ColInitialize(Boolean doHistory)
 			}
 		}
 		
+		/* Register the report variables with the worker processes */
+		PhgParRegisterSum(&colData[ColCurParams].colTotBluePhotons, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&colData[ColCurParams].colTotPinkPhotons, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&colData[ColCurParams].colTotReachingCollimator, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&colData[ColCurParams].colTotAccBluePhotons, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&colData[ColCurParams].colTotAccPinkPhotons, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&colData[ColCurParams].colTotScatWtPassedThroughCollimator, PhgParEn_Double, 1);
+		PhgParRegisterSum(&colData[ColCurParams].colTotPrimWtPassedThroughCollimator, PhgParEn_Double, 1);
+		PhgParRegisterSum(&colData[ColCurParams].colTotBluePhotonWt, PhgParEn_Double, 1);
+		PhgParRegisterSum(&colData[ColCurParams].colTotPinkPhotonWt, PhgParEn_Double, 1);
+		PhgParRegisterSum(&colData[ColCurParams].colTotInCoincWt, PhgParEn_Double, 1);
+		PhgParRegisterSum(&colData[ColCurParams].colTotAccBluePhotonWt, PhgParEn_Double, 1);
+		PhgParRegisterSum(&colData[ColCurParams].colTotAccPinkPhotonWt, PhgParEn_Double, 1);
+		PhgParRegisterSum(&colData[ColCurParams].colTotAccCoincWt, PhgParEn_Double, 1);
+		PhgParRegisterSum(&colData[ColCurParams].colTotRejBluePhotonWt, PhgParEn_Double, 1);
+		PhgParRegisterSum(&colData[ColCurParams].colTotRejPinkPhotonWt, PhgParEn_Double, 1);
+		PhgParRegisterSum(&colData[ColCurParams].colAccPrimWeightSum, PhgParEn_Double, 1);
+		PhgParRegisterSum(&colData[ColCurParams].colAccScatWeightSum, PhgParEn_Double, 1);
+		
 		okay = true;
 		FAIL:;
 	} while (false);
@@ -1535,6 +1555,7 @@ ColEn_ActionTy colMCPETTrack(PHG_TrackingPhoton *photonPtr)
 	double						comptonToScatterProbability;		/* Ratio of prob of compton to prob of scatter */
 	double						interactionProbability;	/* Cumulative probability of compton and coherent scatter */
 	double						scatterProbability;	/* Probability of absorption */
+	SubObjInteractionTy			*interactionPtr;	/* Interaction values of the material */
 	LbUsFourByte				materialIndex;			/* Index into material for collimator */
 	LbFourByte					curLayer;				/* Which layer we are in */
 	LbFourByte					newLayer;				/* Which layer we are in */
@@ -1702,13 +1723,11 @@ ColEn_ActionTy colMCPETTrack(PHG_TrackingPhoton *photonPtr)
 				*/
 				if (action == colEnAc_Interact) {
 									
-					/* Get probability of compton scatter */
-					comptonToScatterProbability = SubObjGetProbComptToScatInTomo2(materialIndex,
-						photonPtr->energy);
-					
-					/* Get probability of  scatter */
-					scatterProbability = SubObjGetProbScatterInTomo2(materialIndex,
+					/* Get probabilities of compton scatter and of scatter */
+					interactionPtr = SubObjGetInteractionInTomo2(materialIndex,
 						photonPtr->energy);
+					comptonToScatterProbability = interactionPtr->probComptonToScatter;
+					scatterProbability = interactionPtr->probScatter;
 					
 					/* Sample for probability of interaction type */
 					interactionProbability = PhgMathGetRandomNumber();
@@ -41,6 +41,8 @@
 *				CylPosIsOutsideTarget
 *				CylPosProjectToTargetCylinder
 *				CylPosProjectToCylinder
+*				CylPosProjectWithRoots
+*				CylPosSolveCoaxialCylinders
 *				CylPosWillIntersectCritZone
 *				CylPosDumpObjects
 *
@@ -273,6 +275,105 @@ Boolean CylPosInitTargetCylinder(LbPfHkTy paramFlHk, LbUsFourByte numParams)
 	return (okay);
 }
 
+/*********************************************************************************
+*
+*			Name:			CylPosSolveCoaxialCylinders
+*			Summary:	Solve the ray/cylinder quadratic for a set of cylinders
+*						that share one axis. The terms that depend only on the
+*						ray (a, b, b squared and the squared distance from the
+*						axis) are computed once; the discriminants for all the
+*						cylinders are then computed in a single branch-free loop
+*						that the compiler can vectorize. The roots are exactly
+*						those PhgMathSolveQuadratic returns for each cylinder
+*						alone, so callers may switch without changing results.
+*			Arguments:
+*				double			x0				- Start on X axis, relative to the axis.
+*				double			y0				- Start on Y axis, relative to the axis.
+*				double			cosX			- Direction component in X direction.
+*				double			cosY			- Direction component in Y direction.
+*				double			a				- Quadratic a, usually 1 - cosZ squared.
+*				LbUsFourByte	numCylinders	- Number of radii (at most CYLPOS_MAX_COAXIAL).
+*				double			*radii			- The cylinder radii.
+*				CylPosRootsTy	*rootsPtr		- The roots, one entry per radius.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void CylPosSolveCoaxialCylinders(double x0, double y0, double cosX, double cosY,
+			double a, LbUsFourByte numCylinders, double *radii, CylPosRootsTy *rootsPtr)
+{
+	double			b;								/* Quadratic b, common to all cylinders */
+	double			bSquared;						/* b squared */
+	double			fourA;							/* 4 * a */
+	double			xySquared;						/* Squared distance from the axis */
+	double			c[CYLPOS_MAX_COAXIAL];			/* Quadratic c for each cylinder */
+	double			bSquMinus4AC[CYLPOS_MAX_COAXIAL];	/* Discriminant for each cylinder */
+	double			q;								/* Temp for roots */
+	double			root1, root2;					/* Unordered roots */
+	LbUsFourByte	cylIndex;						/* Current cylinder */
+	
+	#ifdef PHG_DEBUG
+		if (numCylinders > CYLPOS_MAX_COAXIAL) {
+			PhgAbort("Too many cylinders (CylPosSolveCoaxialCylinders).", false);
+		}
+	#endif
+	
+	/* Compute the ray terms once */
+	b = 2 * ((x0*cosX) + (y0*cosY));
+	bSquared = PHGMATH_Square(b);
+	fourA = 4*a;
+	xySquared = PHGMATH_Square(x0) + PHGMATH_Square(y0);
+	
+	/* Discriminants for all cylinders, no branches */
+	for (cylIndex = 0; cylIndex < numCylinders; cylIndex++) {
+		c[cylIndex] = xySquared - PHGMATH_Square(radii[cylIndex]);
+		bSquMinus4AC[cylIndex] = bSquared - (fourA * c[cylIndex]);
+	}
+	
+	/* Roots, following PhgMathSolveQuadratic case for case */
+	for (cylIndex = 0; cylIndex < numCylinders; cylIndex++) {
+		rootsPtr[cylIndex].numRoots = 0;
+		rootsPtr[cylIndex].minRoot = 0.0;
+		rootsPtr[cylIndex].maxRoot = 0.0;
+		
+		if (bSquMinus4AC[cylIndex] <= 0.0) {
+			/* No real roots, a degenerate (a = b = 0) case, or a single root */
+			if ((bSquMinus4AC[cylIndex] == 0.0) && (a != 0)) {
+				rootsPtr[cylIndex].minRoot = -b/(2*a);
+				rootsPtr[cylIndex].maxRoot = rootsPtr[cylIndex].minRoot;
+				rootsPtr[cylIndex].numRoots = 1;
+			}
+			continue;
+		}
+		
+		if (b > 0.0) {
+			q = -0.5*(b + PHGMATH_SquareRoot(bSquMinus4AC[cylIndex]));
+		}
+		else {
+			q = -0.5*(b - PHGMATH_SquareRoot(bSquMinus4AC[cylIndex]));
+		}
+		
+		#ifdef PHG_DEBUG
+			if (q == 0.0) {
+				ErAbort("Got q == 0.0 in CylPosSolveCoaxialCylinders");
+			}
+		#endif
+		
+		if (a == 0.0) {
+			rootsPtr[cylIndex].minRoot = c[cylIndex]/q;
+			rootsPtr[cylIndex].maxRoot = rootsPtr[cylIndex].minRoot;
+			rootsPtr[cylIndex].numRoots = 1;
+		}
+		else {
+			root1 = q/a;
+			root2 = c[cylIndex]/q;
+			rootsPtr[cylIndex].minRoot = PHGMATH_Min(root1, root2);
+			rootsPtr[cylIndex].maxRoot = PHGMATH_Max(root1, root2);
+			rootsPtr[cylIndex].numRoots = 2;
+		}
+	}
+}
+
 /*********************************************************************************
 *
 *			Name:			CylPosFind2dIntersection
@@ -294,29 +395,23 @@ Boolean CylPosInitTargetCylinder(LbPfHkTy paramFlHk, LbUsFourByte numParams)
 Boolean CylPosFind2dIntersection(double x0, double y0, double cosX, double cosY,
 			double radius, double *d1, double *d2)	
 {
-	Boolean	hasIntersection = false;	/* Intersection flag */
-	double	a;							/* Temp for quadratic */
-	double	b;							/* Temp for quadratic */
-	double	c;							/* Temp for quadratic */
-	LbUsFourByte numRoots;				/* PhgMathSolveQuadratic number roots */
+	Boolean			hasIntersection = false;	/* Intersection flag */
+	CylPosRootsTy	roots;						/* Roots of the quadratic */
 
 	do { /* Process Loop */
 	
-		/* Compute a, b, c */
-		a = PHGMATH_Square(cosX) + PHGMATH_Square(cosY);
-		b = 2 * ((x0*cosX) + (y0*cosY));
-		c = PHGMATH_Square(x0) + PHGMATH_Square(y0) - PHGMATH_Square(radius);
-		numRoots = PhgMathSolveQuadratic( a, b, c, d1, d2 );
+		/* Solve with a = cosX^2 + cosY^2 */
+		CylPosSolveCoaxialCylinders(x0, y0, cosX, cosY,
+			PHGMATH_Square(cosX) + PHGMATH_Square(cosY), 1, &radius, &roots);
 		
 		/* See if there is no intersection */
-		if (numRoots == 0)
+		if (roots.numRoots == 0)
 			break;
 		
-		/* if only one root was found, assign d2
+		/* if only one root was found, maxRoot already equals minRoot
 		 (some functions using this function look for d1==d2) */
-		if (numRoots == 1) {
-			*d2 = *d1;
-		}
+		*d1 = roots.minRoot;
+		*d2 = roots.maxRoot;
 				
 		hasIntersection = true;
 	} while (false);
@@ -346,24 +441,24 @@ void CylPosCalcDistanceToCylSurface(PHG_Position *posPtr, PHG_Direction *dirPtr,
 {
 	double			xCord;					/* X coordinate adjusted for center of cylinder */
 	double			yCord;					/* Y coordinate adjusted for center of cylinder */
-	double			a, b, c;				/* Quadratic formula variables */
+	CylPosRootsTy	roots;					/* Roots of the quadratic */
 	double			minRoot, maxRoot;		/* Roots returned by quadratic formula */
 	LbUsFourByte	numRoots;				/* number of roots returned by quadratic formula */
 	
 
 
-	/* Calculate "distance" using PhgMath quadratic routine */
+	/* Calculate "distance" using the coaxial cylinder solver */
 	{
 		/* Compute x/y coordinates adjusted for center of cylinder */
 		xCord = posPtr->x_position - cylinderPtr->centerX;
 		yCord = posPtr->y_position - cylinderPtr->centerY;
 		
-		/* Calculate a, b, and c of the quadratic formula */
-		a = 1 - PHGMATH_Square(dirPtr->cosine_z);
-		b = 2 * ( (xCord * dirPtr->cosine_x) + (yCord * dirPtr->cosine_y) );
-		c = PHGMATH_Square(xCord) + PHGMATH_Square(yCord) - PHGMATH_Square(cylinderPtr->radius);
-		
-		numRoots = PhgMathSolveQuadratic(a, b, c, &minRoot, &maxRoot);
+		/* Solve the quadratic with a = 1 - cosZ^2 */
+		CylPosSolveCoaxialCylinders(xCord, yCord, dirPtr->cosine_x, dirPtr->cosine_y,
+			1 - PHGMATH_Square(dirPtr->cosine_z), 1, &(cylinderPtr->radius), &roots);
+		numRoots = roots.numRoots;
+		minRoot = roots.minRoot;
+		maxRoot = roots.maxRoot;
 		
 
 		#ifdef CYLPOS_DEBUG
@@ -546,34 +641,21 @@ Boolean CylPosProjectToCylinder(PHG_Position *positionPtr,
 			PHG_Direction *directionPtr, CylPosCylinderTy *cylinderPtr,
 			PHG_Position *newPosPtr, double *distPtr)	
 {
-	Boolean	intersects = false;	/* Do we intersect */
+	Boolean			intersects = false;	/* Do we intersect */
+	CylPosRootsTy	roots;				/* Roots for the cylinder surface */
 	
 	do {
 	
-		/* If cosine_z == +/- 1, we will never intersect */
-		if (PhgMathRealNumAreEqual(directionPtr->cosine_z, 1.0, -7, 0, 0, 0)) {
-			break;
-		}
-		if (PhgMathRealNumAreEqual(directionPtr->cosine_z, -1.0, -7, 0, 0, 0)) {
-			break;
-		}
+		/* Solve for the surface of the cylinder */
+		CylPosSolveCoaxialCylinders(positionPtr->x_position - cylinderPtr->centerX,
+			positionPtr->y_position - cylinderPtr->centerY,
+			directionPtr->cosine_x, directionPtr->cosine_y,
+			1 - PHGMATH_Square(directionPtr->cosine_z), 1, &(cylinderPtr->radius), &roots);
 		
-		/* Compute distance to surface */
-		CylPosCalcDistanceToCylSurface(positionPtr,
-			directionPtr, cylinderPtr, distPtr);
-		
-		if (*distPtr > 0.0) {
-			/* Calculate z intersection */
-			newPosPtr->z_position = positionPtr->z_position +
-				(*distPtr * directionPtr->cosine_z);
-				
-			/* Calculate x intersection */
-			newPosPtr->x_position = positionPtr->x_position + 
-				(*distPtr * directionPtr->cosine_x);
-				
-			/* Calculate y intersection */
-			newPosPtr->y_position = positionPtr->y_position +
-				(*distPtr * directionPtr->cosine_y);
+		/* Project to it */
+		if (CylPosProjectWithRoots(positionPtr, directionPtr, &roots,
+				newPosPtr, distPtr) == false) {
+			break;
 		}
 			
 		#ifdef CYLPOS_DEBUG_HEAVY
@@ -605,6 +687,67 @@ Boolean CylPosProjectToCylinder(PHG_Position *positionPtr,
 	return (intersects);
 }
 
+/*********************************************************************************
+*
+*			Name:			CylPosProjectWithRoots
+*
+*			Summary:	Given a location, angle and the roots returned for a
+*						cylinder by CylPosSolveCoaxialCylinders, project to
+*						that cylinder. This lets callers that solve several
+*						coaxial cylinders at once project without solving again.
+*			Arguments:
+*				PHG_Position		*positionPtr	- The current position.
+*				PHG_Direction		*directionPtr	- The current direction.
+*				CylPosRootsTy		*rootsPtr		- The roots for the cylinder.
+*				PHG_Position		*newPosPtr		- The new position.
+*				double				*distPtr		- Distance to projection.
+*
+*			Function return: TRUE unless cosine_z == +/-1.
+*
+*********************************************************************************/
+Boolean CylPosProjectWithRoots(PHG_Position *positionPtr,
+			PHG_Direction *directionPtr, CylPosRootsTy *rootsPtr,
+			PHG_Position *newPosPtr, double *distPtr)	
+{
+	Boolean	intersects = false;	/* Do we intersect */
+	
+	do {
+	
+		/* If cosine_z == +/- 1, we will never intersect */
+		if (PhgMathRealNumAreEqual(directionPtr->cosine_z, 1.0, -7, 0, 0, 0)) {
+			break;
+		}
+		if (PhgMathRealNumAreEqual(directionPtr->cosine_z, -1.0, -7, 0, 0, 0)) {
+			break;
+		}
+		
+		/* Distance to surface, as in CylPosCalcDistanceToCylSurface */
+		if (rootsPtr->numRoots == 2) {
+			*distPtr = rootsPtr->maxRoot;
+		} else {
+			*distPtr = rootsPtr->minRoot;
+		}
+		
+		if (*distPtr > 0.0) {
+			/* Calculate z intersection */
+			newPosPtr->z_position = positionPtr->z_position +
+				(*distPtr * directionPtr->cosine_z);
+				
+			/* Calculate x intersection */
+			newPosPtr->x_position = positionPtr->x_position + 
+				(*distPtr * directionPtr->cosine_x);
+				
+			/* Calculate y intersection */
+			newPosPtr->y_position = positionPtr->y_position +
+				(*distPtr * directionPtr->cosine_y);
+		}
+		
+		intersects = true;
+	} while (false);
+	
+	return (intersects);
+}
+
 /*********************************************************************************
 *
 *			Name:			CylPosIsOutsideObjCylinder
@@ -1063,6 +1206,7 @@ Boolean CylPosWillIntersectCritZone(PHG_Position photon_position,
 			PHG_Direction photon_direction, PHG_Intersection *critZoneIntersectionPtr)	
 {
 	Boolean 		willIntersect;			/* Intersection flag */
+	CylPosRootsTy	roots;					/* Roots for the critical zone's surface */
 	
 	do {	/* Process Loop */
 	
@@ -1079,6 +1223,15 @@ Boolean CylPosWillIntersectCritZone(PHG_Position photon_position,
 		/* We will not be changing the direciton, so save it */
 		critZoneIntersectionPtr->photonsDirection = photon_direction;
 		
+		/* Solve for the zone's cylindrical surface once; the path is within the
+			zone's radius between the roots, and leaves it at the larger one
+		*/
+		CylPosSolveCoaxialCylinders(photon_position.x_position - CylPosCriticalZone.centerX,
+			photon_position.y_position - CylPosCriticalZone.centerY,
+			photon_direction.cosine_x, photon_direction.cosine_y,
+			1 - PHGMATH_Square(photon_direction.cosine_z), 1,
+			&CylPosCriticalZone.radius, &roots);
+		
 		/* See if photon will intersect the critical zone on its current path */
 		{
 			/* See if we are already within the critical zone */
@@ -1091,13 +1244,19 @@ Boolean CylPosWillIntersectCritZone(PHG_Position photon_position,
 				critZoneIntersectionPtr->distToEnter = 0;
 				critZoneIntersectionPtr->startingPosition = photon_position;
 			}
-			else if ((photon_position.z_position < CylPosCriticalZone.zMin)
-					&& (photon_direction.cosine_z > 0)) {
+			else if (((photon_position.z_position < CylPosCriticalZone.zMin)
+						&& (photon_direction.cosine_z > 0)) ||
+					((photon_position.z_position > CylPosCriticalZone.zMax)
+						&& (photon_direction.cosine_z < 0))) {
 					
-				/* Photon is below the zone, and traveling up */
+				/* Photon is below the zone traveling up, or above it traveling down */
+				critZoneIntersectionPtr->startingPosition.z_position =
+					((photon_direction.cosine_z > 0) ? CylPosCriticalZone.zMin :
+					CylPosCriticalZone.zMax);
 				
 				/* Calculate distance to enter zone */
-				critZoneIntersectionPtr->distToEnter = (CylPosCriticalZone.zMin -
+				critZoneIntersectionPtr->distToEnter =
+					(critZoneIntersectionPtr->startingPosition.z_position -
 					photon_position.z_position)/photon_direction.cosine_z;
 					
 				/* Calculate intersection point */
@@ -1106,148 +1265,63 @@ Boolean CylPosWillIntersectCritZone(PHG_Position photon_position,
 					
 				critZoneIntersectionPtr->startingPosition.y_position = photon_position.y_position
 					+ (critZoneIntersectionPtr->distToEnter * photon_direction.cosine_y);
-					
-				critZoneIntersectionPtr->startingPosition.z_position = CylPosCriticalZone.zMin;
 				
 				/* Verify that after traveling this far, we are within the critical zone */
-				if ((PHGMATH_Square((critZoneIntersectionPtr->startingPosition.x_position-
-						CylPosCriticalZone.centerX)/
-						CylPosCriticalZone.radius) +
-						PHGMATH_Square((critZoneIntersectionPtr->startingPosition.y_position-
-							CylPosCriticalZone.centerY)/
-						CylPosCriticalZone.radius)) <= 1) {
+				if ((roots.numRoots != 0) &&
+						(critZoneIntersectionPtr->distToEnter >= roots.minRoot) &&
+						(critZoneIntersectionPtr->distToEnter <= roots.maxRoot)) {
 						
 					/* We will be intersecting */
 					willIntersect = true;
 				}
 			}
-			else if ((photon_position.z_position > CylPosCriticalZone.zMax)
-					&& (photon_direction.cosine_z < 0)) {
-	
-				/* Photon is above, and traveling down */
-				
-				/* Calculate distance to enter zone */
-				critZoneIntersectionPtr->distToEnter = (CylPosCriticalZone.zMax -
-					photon_position.z_position)/photon_direction.cosine_z;
-					
-				/* Calculate intersection point */
-				critZoneIntersectionPtr->startingPosition.x_position = 
-					photon_position.x_position
-					+ (critZoneIntersectionPtr->distToEnter * photon_direction.cosine_x);
-					
-				critZoneIntersectionPtr->startingPosition.y_position = 
-					photon_position.y_position
-					+ (critZoneIntersectionPtr->distToEnter * photon_direction.cosine_y);
-					
-				critZoneIntersectionPtr->startingPosition.z_position = CylPosCriticalZone.zMax;
-				
-				/* Verify that after traveling this far, we are within the critical zone */
-				if ((PHGMATH_Square((critZoneIntersectionPtr->startingPosition.x_position-
-						CylPosCriticalZone.centerX)/
-						CylPosCriticalZone.radius) +
-						PHGMATH_Square((critZoneIntersectionPtr->startingPosition.y_position-
-						CylPosCriticalZone.centerY)/
-						CylPosCriticalZone.radius)) <= 1) {
-						
-					/* We will be intersecting */
-					willIntersect = true;
-				}
-				
-			}
 		}
 		
 		/* If we won't intersect, bolt */
 		if (willIntersect == false)
 			break;
 			
-		/* See if the photon is moving down */
-		if (photon_direction.cosine_z < 0) {
+		if (photon_direction.cosine_z != 0) {
 			
-			/* Calculate distance to exit */
-			critZoneIntersectionPtr->distToExit = (CylPosCriticalZone.zMin - 
+			/* Calculate distance to exit through the bottom (moving down) or top */
+			critZoneIntersectionPtr->distToExit = (((photon_direction.cosine_z < 0) ?
+				CylPosCriticalZone.zMin : CylPosCriticalZone.zMax) - 
 			   	photon_position.z_position)/photon_direction.cosine_z;
 				
-			/* Calculate exit point */
-			critZoneIntersectionPtr->finalPosition.x_position = 
-				photon_position.x_position			
-				+ (critZoneIntersectionPtr->distToExit * 
-			   photon_direction.cosine_x);
-				
-			critZoneIntersectionPtr->finalPosition.y_position = 
-				photon_position.y_position			
-				+ (critZoneIntersectionPtr->distToExit * 
-				photon_direction.cosine_y);
-
-			/* See if we go out of the cylinder */
-			if ((PHGMATH_Square((critZoneIntersectionPtr->finalPosition.x_position-
-					CylPosCriticalZone.centerX)/
-					CylPosCriticalZone.radius) +
-					PHGMATH_Square((critZoneIntersectionPtr->finalPosition.y_position-
-					CylPosCriticalZone.centerY)/
-					CylPosCriticalZone.radius)) > 1) {
+			/* See if we go out of the cylinder first */
+			if (critZoneIntersectionPtr->distToExit > roots.maxRoot) {
 				
 				/* Project to the critical zone */
-				(void) CylPosProjectToCylinder(&photon_position,
-					&(photon_direction), &CylPosCriticalZone,
+				(void) CylPosProjectWithRoots(&photon_position,
+					&(photon_direction), &roots,
 					&(critZoneIntersectionPtr->finalPosition),
 					&critZoneIntersectionPtr->distToExit);
 							
 			}
 			else {
 				
-				critZoneIntersectionPtr->finalPosition.z_position = photon_position.z_position			
-					+ (critZoneIntersectionPtr->distToExit * photon_direction.cosine_z);
-
-			}
-		}
-		else if (photon_direction.cosine_z > 0) {
-		
-			/* Photon is moving upward */
-
-			/* Calculate distance to exit */
-			critZoneIntersectionPtr->distToExit = (CylPosCriticalZone.zMax - 
-				photon_position.z_position)/photon_direction.cosine_z;
-				
-			/* Calculate exit point */
-			critZoneIntersectionPtr->finalPosition.x_position = photon_position.x_position			
-				+ (critZoneIntersectionPtr->distToExit * photon_direction.cosine_x);
-				
-			critZoneIntersectionPtr->finalPosition.y_position = photon_position.y_position			
-				+ (critZoneIntersectionPtr->distToExit * photon_direction.cosine_y);
-
-			/* See if we go out of the cylinder */
-			if ((PHGMATH_Square((critZoneIntersectionPtr->finalPosition.x_position-
-					CylPosCriticalZone.centerX)/
-					CylPosCriticalZone.radius) +
-					PHGMATH_Square((critZoneIntersectionPtr->finalPosition.y_position-
-					CylPosCriticalZone.centerY)/
-					CylPosCriticalZone.radius)) > 1) {
+				/* Calculate exit point */
+				critZoneIntersectionPtr->finalPosition.x_position = 
+					photon_position.x_position			
+					+ (critZoneIntersectionPtr->distToExit * photon_direction.cosine_x);
 					
-				/* Project to the critical zone */
-				(void) CylPosProjectToCylinder(
- 						&photon_position,
-						&(photon_direction), &CylPosCriticalZone,
-						&(critZoneIntersectionPtr->finalPosition),
- 						&critZoneIntersectionPtr->distToExit);
-							
-			}
-			else {
+				critZoneIntersectionPtr->finalPosition.y_position = 
+					photon_position.y_position			
+					+ (critZoneIntersectionPtr->distToExit * photon_direction.cosine_y);
 				
 				critZoneIntersectionPtr->finalPosition.z_position = 
 					photon_position.z_position			
-					+ (critZoneIntersectionPtr->distToExit * 
-					photon_direction.cosine_z);
+					+ (critZoneIntersectionPtr->distToExit * photon_direction.cosine_z);
 
 			}
-			
 		}
 		else {
 			/* Photon is moving parallel to the x-y plane */
 						
 			/* Project to the critical zone */
-			(void) CylPosProjectToCylinder(
+			(void) CylPosProjectWithRoots(
 				&photon_position,
-				&(photon_direction), &CylPosCriticalZone,
+				&(photon_direction), &roots,
 				&(critZoneIntersectionPtr->finalPosition), 
 				&critZoneIntersectionPtr->distToExit);
 		}
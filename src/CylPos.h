@@ -51,6 +51,8 @@
 #endif
 
 /* CONSTANTS */
+#define	CYLPOS_MAX_COAXIAL	8		/* Most cylinders CylPosSolveCoaxialCylinders will solve at once */
+
 /* TYPES */
 typedef struct {
 	double			radius;		/* Radius of cylinder */
@@ -60,6 +62,12 @@ typedef struct {
 	double			centerY;	/* Center point on y axis */
 } CylPosCylinderTy;
 
+typedef struct {
+	LbUsFourByte	numRoots;	/* Number of real roots (0, 1 or 2) */
+	double			minRoot;	/* Smaller distance to the surface (valid if numRoots > 0) */
+	double			maxRoot;	/* Larger distance to the surface (equals minRoot if numRoots == 1) */
+} CylPosRootsTy;
+
 /* MACROS */
 
 /* GLOBALS */
@@ -141,6 +149,11 @@ Boolean CylPosIsOutsideObjCylinder(PHG_Position	photon_position);
 Boolean	CylPosProjectToCylinder(PHG_Position *positionPtr,
 			PHG_Direction *directionPtr, CylPosCylinderTy *cylinderPtr,
 			PHG_Position *newPosPtr, double *distPtr);
+Boolean	CylPosProjectWithRoots(PHG_Position *positionPtr,
+			PHG_Direction *directionPtr, CylPosRootsTy *rootsPtr,
+			PHG_Position *newPosPtr, double *distPtr);
+void	CylPosSolveCoaxialCylinders(double x0, double y0, double cosX, double cosY,
+			double a, LbUsFourByte numCylinders, double *radii, CylPosRootsTy *rootsPtr);
 	
 Boolean CylPosProjectToTargetCylinder(PHG_Position *positionPtr,
 			PHG_Direction *directionPtr, double *distPtr);
@@ -114,6 +114,13 @@
 #include "DetBlock.h"
 
 
+/* CONSTANTS */
+#define kRingCellsPerRing	4				/* Axial ring grid cells per ring */
+#define kGridMargin			1.0E-6			/* Slack (cm) keeping grid and box searches conservative */
+#define kBoxNoHit			1.0E300			/* Box distance of a block the path misses */
+#define kMinBoxDirCos		1.0E-200		/* Smaller direction cosines are taken as 0 in box tests */
+
+
 /* TYPES */
 typedef enum {							/* Possible photon destinations */
 	detBlocEvt_Null, 						/* Never set value; should never occur */
@@ -160,6 +167,18 @@ static DetectorBlockPtr* detBlocIndexDatabase = NULL;/* Internal database by (r,
 static CylPosCylinderTy	detBlocInnerCylinder;		/* Inner cylindrical boundary */
 static double			detBlocOutRadius = 0.0;		/* Radius of outer cylinder */
 static double			detBlocOutRadSqrd = 0.0;	/* Radius of outer cylinder (squared) */
+static double			detBlocZonesPerRadian = 0.0;/* Zones per radian (zones are equal arcs) */
+static LbFourByte		detBlocNumRingCells = 0;	/* Number of cells in the axial ring grid */
+static double			detBlocRingGridMinZ = 0.0;	/* Lesser axial edge of the ring grid */
+static double			detBlocRingGridMaxZ = 0.0;	/* Greater axial edge of the ring grid */
+static double			detBlocRingCellsPerCm = 0.0;/* Ring grid cells per cm */
+static LbFourByte		*detBlocRingGrid = NULL;	/* First ring that can hold each cell's z */
+static LbUsFourByte		*detBlocZoneBlockCounts = NULL;/* Number of blocks in each (r,z) zone */
+static double			*detBlocBoxXMin = NULL;		/* (x,y) bounding boxes of the blocks, */
+static double			*detBlocBoxXMax = NULL;		/*	with kGridMargin slack, parallel */
+static double			*detBlocBoxYMin = NULL;		/*	to detBlocIndexDatabase */
+static double			*detBlocBoxYMax = NULL;
+static double			*detBlocZoneBoxDists = NULL;/* Path distances to a zone's block boxes */
 
 /* PROTOTYPES */
 void	detBlocGetZoneRange(	LbFourByte			ringNum, 
@@ -168,6 +187,12 @@ void	detBlocGetZoneRange(	LbFourByte			ringNum,
 Boolean detBlocGetZone( PHG_Position	*thePosition, 
 						LbFourByte		*ringNum, 
 						LbFourByte		*zoneNum);
+LbFourByte detBlocGridRing(double			zPosition);
+LbFourByte detBlocGridZone(DetAngleSpec		*theAngle);
+void detBlocCalcBoxDistances(	PHG_TrackingPhoton	*thePhotonPtr, 
+								LbUsFourByte		firstIndex, 
+								LbUsFourByte		numBlocks, 
+								double				*boxDistances);
 Boolean detBlocGetBlock(LbFourByte			ringNum, 
 						LbFourByte			zoneNum, 
 						LbFourByte			blockIndex, 
@@ -351,13 +376,13 @@ Boolean detBlocGetZone( PHG_Position	*thePosition,
 		}
 		else {
 			/* Invalid ring number */
-			r = 0;
+			r = detBlocGridRing(thePosition->z_position);
 			delta = 1;
 		}
 	}
 	else {
 		/* No starting guess */
-		r = 0;
+		r = detBlocGridRing(thePosition->z_position);
 		delta = 1;
 	}
 	
@@ -430,7 +455,7 @@ Boolean detBlocGetZone( PHG_Position	*thePosition,
 		}
 		else {
 			/* No starting guess */
-			z = 0;
+			z = detBlocGridZone(&itsAngle);
 			delta = 1;
 		}
 		
@@ -471,6 +496,91 @@ Boolean detBlocGetZone( PHG_Position	*thePosition,
 }
 
 
+/*********************************************************************************
+*
+*		Name:			detBlocGridRing
+*
+*		Summary:		Return the first ring that can contain the given z,
+*							from the axial ring grid.  Rings before it can't
+*							contain the z, so searching upward from it finds
+*							the same ring as searching upward from ring 0.
+*
+*		Arguments:
+*			double			zPosition		- Given z position.
+*
+*		Function return: Ring to start searching at; detBlocNumRings if none 
+*							can contain the z.
+*
+*********************************************************************************/
+
+LbFourByte detBlocGridRing(double			zPosition)
+
+{
+	LbFourByte			startRing;			/* Function return */
+	LbFourByte			cell;				/* Grid cell of the z */
+	
+	
+	if (detBlocNumRingCells == 0) {
+		/* No grid; search all the rings */
+		startRing = 0;
+	}
+	else if ((zPosition < detBlocRingGridMinZ) || (zPosition > detBlocRingGridMaxZ)) {
+		/* Beyond every ring */
+		startRing = detBlocNumRings;
+	}
+	else {
+		cell = (LbFourByte) ((zPosition - detBlocRingGridMinZ) * detBlocRingCellsPerCm);
+		if (cell >= detBlocNumRingCells) {
+			cell = detBlocNumRingCells - 1;
+		}
+		startRing = detBlocRingGrid[cell];
+	}
+	
+	return (startRing);
+}
+
+
+/*********************************************************************************
+*
+*		Name:			detBlocGridZone
+*
+*		Summary:		Return the zone to start searching for the zone of the
+*							given angle.  The zones are equal arcs, so the
+*							angle gives its zone directly; the search starts one
+*							zone lower so roundoff can't skip the first zone that
+*							contains the angle.
+*
+*		Arguments:
+*			DetAngleSpec	*theAngle		- Given angle.
+*
+*		Function return: Zone to start searching at.
+*
+*********************************************************************************/
+
+LbFourByte detBlocGridZone(DetAngleSpec		*theAngle)
+
+{
+	double				theta;				/* The angle (radians, 0 to 2 pi) */
+	LbFourByte			startZone;			/* Function return */
+	
+	
+	theta = atan2(theAngle->yDirCos, theAngle->xDirCos);
+	if (theta < 0.0) {
+		theta += PHGMATH_2PI;
+	}
+	
+	startZone = (LbFourByte) (theta * detBlocZonesPerRadian) - 1;
+	if (startZone < 0) {
+		startZone = 0;
+	}
+	else if (startZone >= detBlocNumRingZones) {
+		startZone = detBlocNumRingZones - 1;
+	}
+	
+	return (startZone);
+}
+
+
 /*********************************************************************************
 *
 *		Name:			detBlocGetBlock
@@ -2532,6 +2642,10 @@ Boolean detBlocOverlapCheck(void)
 *						Create the database of blocks within each zone;
 *							blocks are indexed in order, starting with 0.
 *						WARNING:  Blocks can be in multiple zones.
+*						Also build the search aids:  the axial ring grid, 
+*							and the (x,y) bounding boxes of each zone's 
+*							blocks, which screen out the blocks a path 
+*							can't reach before the nearest boundary.
 *
 *		Arguments:
 *			LbUsFourByte	maxZBlocks		- Maximum allowable blocks in a zone.
@@ -2561,6 +2675,11 @@ LbUsFourByte DetBlocDivideZones(LbUsFourByte		maxZBlocks)
 	LbFourByte			numIndices;			/* Size of index database */
 	DetectorBlockPtr*	blockPtrPtr;		/* Blocks pointer into detBlocIndexDatabase */
 	LbUsFourByte		ringIndex;			/* Index to ring start of index database */
+	LbFourByte			i;					/* Index through the index database */
+	Lb2D_Point			*cornerPtrs[4];		/* Corners of the current block */
+	LbFourByte			c;					/* Index through corners and grid cells */
+	DetBlockTomoRingTy	*curRingPtr;		/* Current ring info */
+	double				cellMinZ;			/* Lesser axial edge of a grid cell, less slack */
 	
 	
 	/* Initialize the zone boundary list to the 4 quadrants */
@@ -2712,6 +2831,28 @@ LbUsFourByte DetBlocDivideZones(LbUsFourByte		maxZBlocks)
 		return(0);
 	}
 	
+	/* Allocate memory for the zone block counts, the block boxes (one array, 
+		a quarter per box edge), and the box distances of a zone */
+	detBlocZoneBlockCounts = ( LbUsFourByte* )LbMmAlloc(
+										detBlocNumRings * numZones * sizeof(LbUsFourByte));
+	detBlocBoxXMin = ( double* )LbMmAlloc(4 * numIndices * sizeof(double));
+	detBlocZoneBoxDists = ( double* )LbMmAlloc(maxZoneBlocks * sizeof(double));
+	if ((!detBlocZoneBlockCounts) || (!detBlocBoxXMin) || (!detBlocZoneBoxDists)) {
+		/* Couldn't allocate the memory */
+		LbMmFree((void **)&detBlocZoneBounds);
+		LbMmFree((void **)&detBlocIndexDatabase);
+		if (detBlocZoneBlockCounts)
+			LbMmFree((void **)&detBlocZoneBlockCounts);
+		if (detBlocBoxXMin)
+			LbMmFree((void **)&detBlocBoxXMin);
+		if (detBlocZoneBoxDists)
+			LbMmFree((void **)&detBlocZoneBoxDists);
+		return(0);
+	}
+	detBlocBoxXMax = detBlocBoxXMin + numIndices;
+	detBlocBoxYMin = detBlocBoxXMax + numIndices;
+	detBlocBoxYMax = detBlocBoxYMin + numIndices;
+	
 	/* Initialize every block index to unused (= NULL) */
 	blockPtrPtr = detBlocIndexDatabase;
 	for (b=0; b<numIndices; b++) {
@@ -2757,12 +2898,181 @@ LbUsFourByte DetBlocDivideZones(LbUsFourByte		maxZBlocks)
 			
 			curBlockPtr++;
 		}
+		
+		/* Record the ring's zone block counts */
+		for (z=0; z<numZones; z++) {
+			detBlocZoneBlockCounts[r*numZones + z] = zoneCounts[z];
+		}
+	}
+	
+	/* Record the bounding box of each indexed block, widened by the slack */
+	for (i=0; i<numIndices; i++) {
+		curBlockPtr = detBlocIndexDatabase[i];
+		if (curBlockPtr) {
+			cornerPtrs[0] = &(curBlockPtr->itsRect.corner_1);
+			cornerPtrs[1] = &(curBlockPtr->itsRect.corner_2);
+			cornerPtrs[2] = &(curBlockPtr->itsRect.corner_3);
+			cornerPtrs[3] = &(curBlockPtr->itsRect.corner_4);
+			
+			detBlocBoxXMin[i] = detBlocBoxXMax[i] = cornerPtrs[0]->x_position;
+			detBlocBoxYMin[i] = detBlocBoxYMax[i] = cornerPtrs[0]->y_position;
+			for (c=1; c<4; c++) {
+				if (cornerPtrs[c]->x_position < detBlocBoxXMin[i])
+					detBlocBoxXMin[i] = cornerPtrs[c]->x_position;
+				if (cornerPtrs[c]->x_position > detBlocBoxXMax[i])
+					detBlocBoxXMax[i] = cornerPtrs[c]->x_position;
+				if (cornerPtrs[c]->y_position < detBlocBoxYMin[i])
+					detBlocBoxYMin[i] = cornerPtrs[c]->y_position;
+				if (cornerPtrs[c]->y_position > detBlocBoxYMax[i])
+					detBlocBoxYMax[i] = cornerPtrs[c]->y_position;
+			}
+			detBlocBoxXMin[i] -= kGridMargin;
+			detBlocBoxXMax[i] += kGridMargin;
+			detBlocBoxYMin[i] -= kGridMargin;
+			detBlocBoxYMax[i] += kGridMargin;
+		}
+		else {
+			/* Unused index; an empty box */
+			detBlocBoxXMin[i] = detBlocBoxYMin[i] = 1.0;
+			detBlocBoxXMax[i] = detBlocBoxYMax[i] = -1.0;
+		}
+	}
+	
+	/* Record the zones per radian; the zones are equal arcs */
+	detBlocZonesPerRadian = numZones / PHGMATH_2PI;
+	
+	/* Find the axial extent of the rings */
+	for (r=0; r<detBlocNumRings; r++) {
+		curRingPtr = &(DetRunTimeParams[DetCurParams].BlockTomoDetector.RingInfo[r]);
+		if ((r == 0) || (curRingPtr->MinZ + curRingPtr->AxialShift < detBlocRingGridMinZ)) {
+			detBlocRingGridMinZ = curRingPtr->MinZ + curRingPtr->AxialShift;
+		}
+		if ((r == 0) || (curRingPtr->MaxZ + curRingPtr->AxialShift > detBlocRingGridMaxZ)) {
+			detBlocRingGridMaxZ = curRingPtr->MaxZ + curRingPtr->AxialShift;
+		}
+	}
+	
+	/* Make the axial ring grid, unless the rings have no extent */
+	detBlocNumRingCells = 0;
+	if ((detBlocNumRings > 0) && (detBlocRingGridMaxZ > detBlocRingGridMinZ)) {
+		detBlocRingGrid = ( LbFourByte* )LbMmAlloc(
+								detBlocNumRings * kRingCellsPerRing * sizeof(LbFourByte));
+		if (!detBlocRingGrid) {
+			/* Couldn't allocate the memory */
+			LbMmFree((void **)&detBlocZoneBounds);
+			LbMmFree((void **)&detBlocIndexDatabase);
+			LbMmFree((void **)&detBlocZoneBlockCounts);
+			LbMmFree((void **)&detBlocBoxXMin);
+			LbMmFree((void **)&detBlocZoneBoxDists);
+			return(0);
+		}
+		detBlocNumRingCells = detBlocNumRings * kRingCellsPerRing;
+		detBlocRingCellsPerCm = detBlocNumRingCells / 
+									(detBlocRingGridMaxZ - detBlocRingGridMinZ);
+		
+		/* Each cell starts at the first ring reaching its lesser edge; 
+			the slack covers roundoff in locating a z's cell */
+		for (c=0; c<detBlocNumRingCells; c++) {
+			cellMinZ = detBlocRingGridMinZ + c / detBlocRingCellsPerCm - kGridMargin;
+			for (r=0; r<detBlocNumRings; r++) {
+				curRingPtr = &(DetRunTimeParams[DetCurParams].BlockTomoDetector.RingInfo[r]);
+				if (curRingPtr->MaxZ + curRingPtr->AxialShift >= cellMinZ) {
+					break;
+				}
+			}
+			detBlocRingGrid[c] = r;
+		}
 	}
 	
 	return(numZones);
 }
 
 
+/*********************************************************************************
+*
+*		Name:			detBlocCalcBoxDistances
+*
+*		Summary:		Calculate the distance along the photon's path to the 
+*							(x,y) bounding box of each block of a zone.
+*						The boxes are slightly larger than the blocks, so a 
+*							block can't be reached before its box distance.
+*						The loop has no branches or calls, so compilers can 
+*							vectorize it.
+*
+*		Arguments:
+*			PHG_TrackingPhoton	*thePhotonPtr	- The photon.
+*			LbUsFourByte		firstIndex		- Index database index of the 
+*													zone's first block.
+*			LbUsFourByte		numBlocks		- Number of blocks in the zone.
+*			double				*boxDistances	- Returned box distances; 
+*													kBoxNoHit if missed.
+*
+*		Function return: None.
+*
+*********************************************************************************/
+
+void detBlocCalcBoxDistances(	PHG_TrackingPhoton	*thePhotonPtr, 
+								LbUsFourByte		firstIndex, 
+								LbUsFourByte		numBlocks, 
+								double				*boxDistances)
+
+{
+	double				xPos;				/* Photon x position */
+	double				yPos;				/* Photon y position */
+	double				xInvCos;			/* Inverse of photon x direction cosine */
+	double				yInvCos;			/* Inverse of photon y direction cosine */
+	double				*xMinPtr;			/* Zone box lesser x edges */
+	double				*xMaxPtr;			/* Zone box greater x edges */
+	double				*yMinPtr;			/* Zone box lesser y edges */
+	double				*yMaxPtr;			/* Zone box greater y edges */
+	LbUsFourByte		b;					/* Index through the zone blocks */
+	double				tx1, tx2;			/* Distances to the box x edges */
+	double				ty1, ty2;			/* Distances to the box y edges */
+	double				txNear, txFar;		/* Distances into and out of the x slab */
+	double				tyNear, tyFar;		/* Distances into and out of the y slab */
+	double				tNear, tFar;		/* Distances into and out of the box */
+	
+	
+	xPos = thePhotonPtr->location.x_position;
+	yPos = thePhotonPtr->location.y_position;
+	
+	/* Paths (nearly) parallel to a slab get huge distances of the right sign */
+	if (fabs(thePhotonPtr->angle.cosine_x) < kMinBoxDirCos) {
+		xInvCos = (thePhotonPtr->angle.cosine_x < 0.0) ? -kBoxNoHit : kBoxNoHit;
+	}
+	else {
+		xInvCos = 1.0 / thePhotonPtr->angle.cosine_x;
+	}
+	if (fabs(thePhotonPtr->angle.cosine_y) < kMinBoxDirCos) {
+		yInvCos = (thePhotonPtr->angle.cosine_y < 0.0) ? -kBoxNoHit : kBoxNoHit;
+	}
+	else {
+		yInvCos = 1.0 / thePhotonPtr->angle.cosine_y;
+	}
+	
+	xMinPtr = &(detBlocBoxXMin[firstIndex]);
+	xMaxPtr = &(detBlocBoxXMax[firstIndex]);
+	yMinPtr = &(detBlocBoxYMin[firstIndex]);
+	yMaxPtr = &(detBlocBoxYMax[firstIndex]);
+	
+	for (b=0; b<numBlocks; b++) {
+		tx1 = (xMinPtr[b] - xPos) * xInvCos;
+		tx2 = (xMaxPtr[b] - xPos) * xInvCos;
+		ty1 = (yMinPtr[b] - yPos) * yInvCos;
+		ty2 = (yMaxPtr[b] - yPos) * yInvCos;
+		
+		txNear = (tx1 < tx2) ? tx1 : tx2;
+		txFar = (tx1 < tx2) ? tx2 : tx1;
+		tyNear = (ty1 < ty2) ? ty1 : ty2;
+		tyFar = (ty1 < ty2) ? ty2 : ty1;
+		tNear = (txNear > tyNear) ? txNear : tyNear;
+		tFar = (txFar < tyFar) ? txFar : tyFar;
+		
+		boxDistances[b] = ((tNear <= tFar) && (tFar >= 0.0)) ? tNear : kBoxNoHit;
+	}
+}
+
+
 /*********************************************************************************
 *
 *		Name:			detBlocIntraFreePaths
@@ -3790,6 +4100,8 @@ Boolean detBlocNextBlock(	PHG_TrackingPhoton	*thePhotonPtr,
 	DetBlockTomoRingTy*	nextRingPtr;		/* Ring info for the adjacent ring */
 	double				nextRingZ;			/* Position of adjacent ring boundary */
 	LbFourByte			newZone;			/* Zone photon went into */
+	LbUsFourByte		zoneIndex;			/* Index of the (r,z) zone */
+	LbFourByte			numBlocks;			/* Number of blocks in the zone */
 	
 	
 	/* NOTE:  It is assumed that the photon is in a ring and not in a block */
@@ -3942,9 +4254,16 @@ Boolean detBlocNextBlock(	PHG_TrackingPhoton	*thePhotonPtr,
 			}
 		}
 		
-		/* Check each detector block in the starting ring zone */
-		for (b=0; b<detBlocNumZoneBlocks; b++) {
-			if (detBlocGetBlock(itsRing, itsZone, b, &curBlockPtr)) {
+		/* Check each detector block in the starting ring zone; 
+			skip blocks whose boxes are no nearer than the nearest event so far */
+		zoneIndex = itsRing * detBlocNumRingZones + itsZone;
+		numBlocks = detBlocZoneBlockCounts[zoneIndex];
+		detBlocCalcBoxDistances(thePhotonPtr, zoneIndex * detBlocNumZoneBlocks, numBlocks, 
+								detBlocZoneBoxDists);
+		for (b=0; b<numBlocks; b++) {
+			if (detBlocZoneBoxDists[b] < shortestDistance) {
+				curBlockPtr = detBlocIndexDatabase[zoneIndex * detBlocNumZoneBlocks + b];
+				
 				/* Avoid checking the block being exited */
 				if ((itsBlockPtr == NULL) || (itsBlockPtr != curBlockPtr)) {
 					/* Check the distance to the block */
@@ -3966,10 +4285,6 @@ Boolean detBlocNextBlock(	PHG_TrackingPhoton	*thePhotonPtr,
 					}
 				}
 			}
-			else {
-				/* No more blocks in this zone */
-				break;
-			}
 		}
 		
 		
@@ -4851,4 +5166,10 @@ void DetBlocFreeData(void)
 	LbMmFree((void **)&detBlocBlocksDatabase);
 	LbMmFree((void **)&detBlocZoneBounds);
 	LbMmFree((void **)&detBlocIndexDatabase);
+	LbMmFree((void **)&detBlocZoneBlockCounts);
+	LbMmFree((void **)&detBlocBoxXMin);
+	LbMmFree((void **)&detBlocZoneBoxDists);
+	if (detBlocRingGrid)
+		LbMmFree((void **)&detBlocRingGrid);
+	detBlocNumRingCells = 0;
 }
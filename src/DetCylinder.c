@@ -135,6 +135,11 @@ typedef enum { detCylEnAc_Null,
 				detCylEnAc_AxialCross,
 				detCylEnAc_LayerCross} detCylEn_ActionTy;
 
+/* Indexes into the roots solved by detCylSolveBounds; the outer cylinder
+	comes first so it can be solved alone */
+#define	DETCYL_OUTER_BOUND	0
+#define	DETCYL_INNER_BOUND	1
+
 #ifdef PHG_DEBUG
 static char					detCylErrStr[1024];				/* Storage for creating error strings */
 #endif
@@ -163,8 +168,10 @@ void				detDumpCylInteractions(LbFourByte numInteractions,
 						detInteractionInfoTy *interactions);
 
 void				detCylInitCylinders(LbUsFourByte curRing, LbUsFourByte curLayer);
-double				detCylFindInnerDist(PHG_Position *posPtr,
-						PHG_Direction *dirPtr);
+void				detCylSolveBounds(PHG_Position *posPtr,
+						PHG_Direction *dirPtr, Boolean withInner,
+						CylPosRootsTy *boundRoots);
+double				detCylFindInnerDist(CylPosRootsTy *innerRootsPtr);
 LbUsFourByte		detCylFindRing(double zPos);
 double				detCylGtFreePaths(PHG_TrackingPhoton *photonPtr, Boolean firstTime,
 						LbUsFourByte curRingIndex, LbUsFourByte curLayerIndex);
@@ -473,6 +480,7 @@ Boolean DetCylTrack(PHG_Decay *decayPtr,
 	double						weight;
 	double						comptonToScatterProbability;	/* Ratio of prob of compton to prob of scatter */
 	double						scatterProbability;				/* Probability of a scatter */
+	SubObjInteractionTy			*interactionPtr;				/* Interaction values of the material */
 	double						interactionProbability;			/* Interaction-type probability */
 	DetCylnRingTy				*ringPtr;						/* Current ring info */
 	detCylEn_ActionTy			action;							/* What to do in response to photon travel */
@@ -569,6 +577,7 @@ Boolean DetCylTrack(PHG_Decay *decayPtr,
 	depositedEnergy = 0.0;
 	depositedActiveEnergy = 0.0;
 	curInteraction = -1;
+	photonPtr->det_interactions = DetNewInteractions();
 	curLayer = 0;
 	
 	/* Update our cylinders */
@@ -687,17 +696,14 @@ Boolean DetCylTrack(PHG_Decay *decayPtr,
 			/* Save the current position */
 			photonPtr->det_interactions[curInteraction].pos = newPos;
 			
-			/* Get probability of compton to probability scatter ratio */
-			comptonToScatterProbability =
-				SubObjGetProbComptToScatInTomo2(
-				ringPtr->LayerInfo[curLayer].LayerMaterial,
-				photonPtr->energy);
-			
-				
-			/* Get probability of scatter */
-			scatterProbability = SubObjGetProbScatterInTomo2(
+			/* Get probability of compton to probability scatter ratio,
+				and probability of scatter
+			*/
+			interactionPtr = SubObjGetInteractionInTomo2(
 				ringPtr->LayerInfo[curLayer].LayerMaterial,
 				photonPtr->energy);
+			comptonToScatterProbability = interactionPtr->probComptonToScatter;
+			scatterProbability = interactionPtr->probScatter;
 			
 			/* Sample for probability of photo-electric absorbtion */
 			interactionProbability = PhgMathGetRandomNumber();
@@ -1007,6 +1013,7 @@ detCylEn_ActionTy detCylProject(PHG_TrackingPhoton *photonPtr,
 	double				distToWall = 0.0;			/* Distance to donut wall */
 	double				distToWall1 = -1.0;			/* Distance to donut wall */
 	double				distToWall2 = -1.0;			/* Distance to donut wall */
+	CylPosRootsTy		boundRoots[2];				/* Roots for the outer and inner cylinders */
 	detCylEn_ActionTy	action = detCylEnAc_Null;	/* What action will result? */
 	
 	
@@ -1024,8 +1031,11 @@ detCylEn_ActionTy detCylProject(PHG_TrackingPhoton *photonPtr,
 			then the photon is traveling towards the inner
 			cylinder.
 		*/
-		if ((firstTime == false) && ((distToInner = detCylFindInnerDist((&photonPtr->location),
-				&(photonPtr->angle))) > 0)){
+		detCylSolveBounds(&(photonPtr->location), &(photonPtr->angle),
+			(firstTime == false), boundRoots);
+		
+		if ((firstTime == false) && ((distToInner = detCylFindInnerDist(
+				&boundRoots[DETCYL_INNER_BOUND])) > 0)){
 		
 			/* Find intersection with donut walls */
 			if (photonPtr->angle.cosine_z == 0.0) {
@@ -1108,8 +1118,8 @@ detCylEn_ActionTy detCylProject(PHG_TrackingPhoton *photonPtr,
 		else {
 		
 			/* The photon is going to intersect with the outer cylinder */
-			if (CylPosProjectToCylinder(&(photonPtr->location),
-					&(photonPtr->angle), &detCylOutBoundCyl, newPosPtr, &distToOuter)
+			if (CylPosProjectWithRoots(&(photonPtr->location),
+					&(photonPtr->angle), &boundRoots[DETCYL_OUTER_BOUND], newPosPtr, &distToOuter)
 					== false) {
 
 				distToOuter = LBDOUBLE_MAX;
@@ -1244,6 +1254,7 @@ void detCylCompFreePathsToExit(PHG_TrackingPhoton *photonPtr,
 	double				distToWall1 = -1.0;			/* Distance to donut wall */
 	double				distToWall2 = -1.0;			/* Distance to donut wall */
 	double				distance = 0.0;				/* The incremental distance */
+	CylPosRootsTy		boundRoots[2];				/* Roots for the outer and inner cylinders */
 	double				attenuation = 0.0;			/* The attenuation of the current material */
 	detCylEn_ActionTy	action = detCylEnAc_Null;	/* What action will result? */
 	DetCylnRingTy		*ringPtr;					/* The current ring */
@@ -1277,8 +1288,11 @@ void detCylCompFreePathsToExit(PHG_TrackingPhoton *photonPtr,
 			then the photon is traveling towards the inner
 			cylinder.
 		*/
-		if ((firstTime == false) && ((distToInner = detCylFindInnerDist((&position),
-				&(photonPtr->angle))) > 0)){
+		detCylSolveBounds(&position, &(photonPtr->angle),
+			(firstTime == false), boundRoots);
+		
+		if ((firstTime == false) && ((distToInner = detCylFindInnerDist(
+				&boundRoots[DETCYL_INNER_BOUND])) > 0)){
 		
 			/* Find intersection with donut walls */
 			if (photonPtr->angle.cosine_z == 0.0) {
@@ -1333,8 +1347,8 @@ void detCylCompFreePathsToExit(PHG_TrackingPhoton *photonPtr,
 		else {
 		
 			/* The photon is going to intersect with the outer cylinder */
-			if (CylPosProjectToCylinder(&position,
-					&(photonPtr->angle), &detCylOutBoundCyl, &tempPos, &distToOuter)
+			if (CylPosProjectWithRoots(&position,
+					&(photonPtr->angle), &boundRoots[DETCYL_OUTER_BOUND], &tempPos, &distToOuter)
 					== false) {
 
 				distToOuter = LBDOUBLE_MAX;
@@ -1460,6 +1474,39 @@ void detCylCompFreePathsToExit(PHG_TrackingPhoton *photonPtr,
 	detCylInitCylinders(startingRingIndex, startingLayerIndex);
 }
 
+/*********************************************************************************
+*
+*			Name:			detCylSolveBounds
+*
+*			Summary:		Solve for the outer bounding cylinder and, if asked,
+*							the inner one. The two are coaxial, so they are
+*							solved together by CylPosSolveCoaxialCylinders.
+*
+*			Arguments:
+*				PHG_Position	*posPtr		- The position of the photon.
+*				PHG_Direction	*dirPtr		- The direction of the photon.
+*				Boolean			withInner	- Solve the inner cylinder too?
+*				CylPosRootsTy	*boundRoots	- The roots, indexed by
+*											DETCYL_OUTER_BOUND/DETCYL_INNER_BOUND.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void detCylSolveBounds(PHG_Position *posPtr,
+				PHG_Direction *dirPtr, Boolean withInner,
+				CylPosRootsTy *boundRoots)
+{
+	double		radii[2];			/* Radii of the bounding cylinders */
+	
+	radii[DETCYL_OUTER_BOUND] = detCylOutBoundCyl.radius;
+	radii[DETCYL_INNER_BOUND] = detCylInBoundCyl.radius;
+	
+	CylPosSolveCoaxialCylinders(posPtr->x_position - detCylOutBoundCyl.centerX,
+		posPtr->y_position - detCylOutBoundCyl.centerY,
+		dirPtr->cosine_x, dirPtr->cosine_y, 1 - PHGMATH_Square(dirPtr->cosine_z),
+		((withInner == true) ? 2 : 1), radii, boundRoots);
+}
+
 /*********************************************************************************
 *
 *			Name:			detCylFindInnerDist
@@ -1467,51 +1514,33 @@ void detCylCompFreePathsToExit(PHG_TrackingPhoton *photonPtr,
 *			Summary:		Determine the distance to the inner cylinder.
 *
 *			Arguments:
-*				PHG_Position	*posPtr	- The position of the photon.
-*				PHG_Direction	*dirPtr	- The direction of the photon.
+*				CylPosRootsTy	*innerRootsPtr	- The inner cylinder roots
+*												from detCylSolveBounds.
 *
 *			Function return: Distance to inner cylinder, negative if
 *								it doesn't intersect.
 *
 *********************************************************************************/
-double detCylFindInnerDist(PHG_Position *posPtr,
-				PHG_Direction *dirPtr)
+double detCylFindInnerDist(CylPosRootsTy *innerRootsPtr)
 {
-	double		xCord = 0.0;				/* X coordinate normalized to center of cylinder */	
-	double		yCord = 0.0;				/* Y coordinate normalized to center of cylinder */
 	double		distToInner = -1.0;			/* Distance to inner cylinder */
-	double		aa, bb, cc, minRoot, maxRoot;
-	LbFourByte	numRoots;
 	
 
 	 do { /* Process Loop */
 	 
-		/* Compute 'a' for quadratic */
-		aa = 1 - PHGMATH_Square(dirPtr->cosine_z);
-
-		/* Comput b and c for quadratic */		
-		xCord = posPtr->x_position - detCylInBoundCyl.centerX;
-		yCord = posPtr->y_position - detCylInBoundCyl.centerY;
-
-		bb = 2 * ((dirPtr->cosine_x * xCord) + (dirPtr->cosine_y * yCord));
-		cc = PHGMATH_Square(xCord) + PHGMATH_Square(yCord) - PHGMATH_Square(detCylInBoundCyl.radius);
-
-		/* Solve quadratic */
-		numRoots = PhgMathSolveQuadratic(aa, bb, cc,
-						&minRoot, &maxRoot);
-
 		/* Check for no intersection with inner cylinder */				
-		if (numRoots < 2) {
+		if (innerRootsPtr->numRoots < 2) {
 			break;
 		}
 	
 		/* Check for negative-only intersection */				
-		if ((maxRoot < 0) || (PhgMathRealNumAreEqual(maxRoot, 0.0, -5, 0, 0, 0) == true)) {
+		if ((innerRootsPtr->maxRoot < 0) ||
+				(PhgMathRealNumAreEqual(innerRootsPtr->maxRoot, 0.0, -5, 0, 0, 0) == true)) {
 			break;
 		}
 	
 		/* Distance to inner intersection is the minimum root from the quadratic */
-		distToInner = minRoot;
+		distToInner = innerRootsPtr->minRoot;
 		
 		
 		#ifdef PHG_DEBUG
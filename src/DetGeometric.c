@@ -463,6 +463,7 @@ Boolean DetGeomTrack(DetEn_DetectorTypeTy detectorType,
 	#endif
 	depositedActiveEnergy = 0.0;
 	curInteraction = -1;
+	photonPtr->det_interactions = DetNewInteractions();
 	
 	/* Get free paths to travel */  
 	if (DetRunTimeParams[DetCurParams].DoForcedInteraction) {
@@ -832,6 +832,7 @@ Boolean detTrackPlanar(PHG_TrackingPhoton *photonPtr)
 	double						fpToGo;					/* Free paths to travel in crystal */
 	double						comptonToScatterProbability;		/* Ratio of prob of compton to prob of scatter */
 	double						scatterProbability;		/* Probability of a scatter */
+	SubObjInteractionTy			*interactionPtr;		/* Interaction values of the material */
 	double						interactionProbability;	/* Interaction type probability */
 	double						depositedEnergy = 0.0;	/* Energy deposited at current location */
 	double						depositedActiveEnergy = 0.0;	/* Energy deposited in active layers at current location */
@@ -1001,6 +1002,7 @@ Boolean detTrackPlanar(PHG_TrackingPhoton *photonPtr)
 		depositedEnergy = 0.0;
 		depositedActiveEnergy = 0.0;
 		curInteraction = -1;
+		photonPtr->det_interactions = DetNewInteractions();
 		curLayer = 0;
 		backOfLayer = DetRunTimeParams[DetCurParams].PlanarDetector.LayerInfo[curLayer].LayerDepth;
 		frontOfLayer = 0.0;
@@ -1217,16 +1219,12 @@ Boolean detTrackPlanar(PHG_TrackingPhoton *photonPtr)
 				/* Save the active status */
 				photonPtr->det_interactions[curInteraction].isActive = layerIsActive;
 				
-				/* Get probability of  scatter */
-				scatterProbability = SubObjGetProbScatterInTomo2(
-					DetRunTimeParams[DetCurParams].PlanarDetector.LayerInfo[curLayer].LayerMaterial,
-					photonPtr->energy);
-				
-				/* Get probability of compton scatter */
-				comptonToScatterProbability =
-					SubObjGetProbComptToScatInTomo2(
+				/* Get probabilities of scatter and of compton scatter */
+				interactionPtr = SubObjGetInteractionInTomo2(
 					DetRunTimeParams[DetCurParams].PlanarDetector.LayerInfo[curLayer].LayerMaterial,
 					photonPtr->energy);
+				scatterProbability = interactionPtr->probScatter;
+				comptonToScatterProbability = interactionPtr->probComptonToScatter;
 				
 				/* Sample for probability of photo-electric absorbtion */
 				interactionProbability = PhgMathGetRandomNumber();
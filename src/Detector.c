@@ -34,6 +34,7 @@
 *				DetGtOutsideRadius
 *				DetPETPhotons
 *				DetSPECTPhotons
+*				DetNewInteractions
 *				DetTerminate
 *
 *			Global variables defined:		none
@@ -179,6 +180,7 @@
 #include "DetBlock.h"
 #include "phg.h"
 #include "PhgBin.h"
+#include "PhgParallel.h"
 
 
 /* LOCAL CONSTANTS */
@@ -188,6 +190,7 @@
 											blur, to a standard deviation for the
 											blurring routine.
 										*/
+#define DET_MAX_INTERACTION_LISTS	(2*PHG_MAX_DETECTED_PHOTONS)	/* Photons tracked per decay, per detector */
 
 
 									
@@ -215,7 +218,6 @@ void 			detCylindricalSPECT(PHG_Decay *decayPtr,
 					DetectedPhotonsTy *detPhotonsPtr);
 
 /* Local Global Variables */
-/* 	(None for now) */	
 
 
 /*********************************************************************************
@@ -252,6 +254,14 @@ Boolean DetInitialize(Boolean doHistory)
 		detData[DetCurParams].detTotReachingCrystal = 0;
 		detData[DetCurParams].detWeightAdjusted = 0.0;
 		detData[DetCurParams].detNumReachedMaxInteractions = 0;
+		detData[DetCurParams].detNumInteractionLists = 0;
+		
+		/* Each detector keeps its own interaction lists, as all the detectors
+			process a decay before any of them are binned */
+		if ((detData[DetCurParams].detInteractionLists = (PHG_DetInteractionsTy *)
+				LbMmAlloc(sizeof(PHG_DetInteractionsTy) * DET_MAX_INTERACTION_LISTS)) == 0) {
+			break;
+		}
 
 		#ifdef PHG_DEBUG
 		detData[DetCurParams].detCylCountCohInteractions = 0;
@@ -568,6 +578,29 @@ Boolean DetInitialize(Boolean doHistory)
 				break;
 		}
 
+		/* Register the report variables with the worker processes */
+		PhgParRegisterSum(&detData[DetCurParams].detTotBluePhotons, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&detData[DetCurParams].detTotPinkPhotons, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&detData[DetCurParams].detTotAccBluePhotons, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&detData[DetCurParams].detTotAccPinkPhotons, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&detData[DetCurParams].detTotPhotonsDepositingEnergy, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&detData[DetCurParams].detTotPhotonsAbsorbed, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&detData[DetCurParams].detTotForcedAbsorptions, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&detData[DetCurParams].detTotPhotonsPassingThrough, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&detData[DetCurParams].detTotFirstTimeAbsorptions, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&detData[DetCurParams].detTotReachingCrystal, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&detData[DetCurParams].detNumReachedMaxInteractions, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&detData[DetCurParams].detTotWtAbsorbed, PhgParEn_Double, 1);
+		PhgParRegisterSum(&detData[DetCurParams].detTotWtForcedAbsorbed, PhgParEn_Double, 1);
+		PhgParRegisterSum(&detData[DetCurParams].detTotWtFirstTimeAbsorbed, PhgParEn_Double, 1);
+		PhgParRegisterSum(&detData[DetCurParams].detWeightAdjusted, PhgParEn_Double, 1);
+		PhgParRegisterSum(detData[DetCurParams].detWeightAbsorbedBins, PhgParEn_Double, MAX_DET_INTERACTIONS);
+		PhgParRegisterSum(detData[DetCurParams].detWeightEscapedBins, PhgParEn_Double, MAX_DET_INTERACTIONS+1);
+		#ifdef PHG_DEBUG
+		PhgParRegisterSum(&detData[DetCurParams].detCylCountInteractions, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&detData[DetCurParams].detCylCountCohInteractions, PhgParEn_EightByte, 1);
+		#endif
+
 		okay = true;
 		FAILURE:;
 	} while (false);
@@ -1437,6 +1470,9 @@ void DetPETPhotons(PHG_Decay *decayPtr,
 	/*   Make sure that the number of detected photons gets initialized to 0.  */
 	detPhotonsPtr->NumDetectedBluePhotons = 0;
 	detPhotonsPtr->NumDetectedPinkPhotons = 0;
+	
+	/* This detector's interactions for the previous decay are no longer needed */
+	detData[DetCurParams].detNumInteractionLists = 0;
 
 	/* For efficiency this routine gets called, but if there are no photons to process,
 	then bolt out of here.
@@ -1862,6 +1898,9 @@ void DetSPECTPhotons(PHG_Decay *decayPtr,
 	/*  Make sure that the number of detected photons gets initialized to 0. */
 	detPhotonsPtr->NumDetectedBluePhotons = 0;
 	
+	/* This detector's interactions for the previous decay are no longer needed */
+	detData[DetCurParams].detNumInteractionLists = 0;
+	
 	/* Compute statistics */
 	detData[DetCurParams].detTotBluePhotons += numPhotons;
 
@@ -2094,6 +2133,33 @@ LbFourByte	DetGtNumViews(void)
 	return (DetRunTimeParams[DetCurParams].PlanarDetector.NumViews);
 }
 
+/*********************************************************************************
+*
+*			Name:			DetNewInteractions
+*
+*			Summary:		Return an empty list for the detector interactions
+*							of a photon about to be tracked.  Each detector has
+*							its own lists, reused for each decay (see
+*							DetPETPhotons and DetSPECTPhotons), so the lists of
+*							one detector stay valid while the others run.  The
+*							tracking photon, which is copied often, only carries
+*							a pointer to its list.
+*
+*			Arguments:
+*			Function return: The interaction list.
+*
+*********************************************************************************/
+detInteractionInfoTy *DetNewInteractions(void)
+{
+	if (detData[DetCurParams].detNumInteractionLists == DET_MAX_INTERACTION_LISTS) {
+		PhgAbort("Too many photons tracked in the detector for one decay (DetNewInteractions).", false);
+	}
+	
+	detData[DetCurParams].detNumInteractionLists++;
+	
+	return (detData[DetCurParams].detInteractionLists[detData[DetCurParams].detNumInteractionLists-1]);
+}
+
 /*********************************************************************************
 *
 *			Name:			DetTerminate
@@ -2153,6 +2219,11 @@ void DetTerminate(void)
 				break;
 			}
 		}
+		
+		/* Free the interaction lists */
+		if (detData[DetCurParams].detInteractionLists != 0) {
+			LbMmFree((void **) &detData[DetCurParams].detInteractionLists);
+		}
 
 		/* Free memory used by detector */
 		switch(DetRunTimeParams[DetCurParams].DetectorType){
@@ -157,6 +157,8 @@ typedef struct {
  CylPosCylinderTy		detPlnrBigCylinder;
  double					detPlnrAngularCoverage;
  double					detPlnrDelta;						/* Size of detector positions */
+ PHG_DetInteractionsTy	*detInteractionLists;				/* This detector's interaction lists for the current decay */
+ LbUsFourByte			detNumInteractionLists;				/* Number of them in use */
 
 
 #ifdef PHG_DEBUG
@@ -198,6 +200,7 @@ void			DetPETPhotons(PHG_Decay *decay,
 void			DetSPECTPhotons(PHG_Decay *decay,
 					PHG_TrackingPhoton *photons, LbUsFourByte numPhotons,
 					DetectedPhotonsTy *colPhotonsPtr);
+detInteractionInfoTy	*DetNewInteractions(void);
 void			DetTerminate(void);
 
 #undef LOCALE
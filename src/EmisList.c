@@ -133,6 +133,7 @@
 #include "EmisList.h"
 #include "phg.h"
 #include "PhgBin.h"
+#include "PhgParallel.h"
 
 /* LOCAL CONSTANTS */
 #define EMLI_NUM_EMP_RANGE_DISTANCES	1000
@@ -151,6 +152,8 @@ static CollimatedPhotonsTy	EmisListCollimatedPhotons[PHG_MAX_PARAM_FILES];		/* T
 static DetectedPhotonsTy	EmisListDetectedPhotons[PHG_MAX_PARAM_FILES];				/* These are the successfully detected photons */
 static PhoHFileHkTy			EmisListPHGHistoryFileHk;				/* The PHG History file */
 static PHG_Direction		newDecayEmissionAngle;		/* The new decay's emission angle */
+static PHG_InteractionInfo	emLiBlueStarts[PHG_MAXIMUM_STARTS];	/* Starts list of the current blue photon */
+static PHG_InteractionInfo	emLiPinkStarts[PHG_MAXIMUM_STARTS];	/* Starts list of the current pink photon */
 #ifdef DO_POS_RANGE_THE_OLD_WAY
 static double				emLiEmpiricalRangeDist[EMLI_NUM_EMP_RANGE_DISTANCES];
 #endif
@@ -212,6 +215,7 @@ void	emLiCreatePhoton(LbUsOneByte flags, PHG_Decay	 *decayPtr,
 			LbFourByte sliceIndex, LbFourByte angleIndex,
 			LbFourByte xIndex, LbFourByte yIndex);
 void	emLiDoEscape(void);
+void	emLiTrackDecays(void);
 Boolean emLiReadEvent(void);
 void 	emLiAdjForNonCollinearity(PHG_TrackingPhoton *trackingPhotonPtr);
 void	emLiCreateIsotopeTable(void);	
@@ -1001,6 +1005,8 @@ Boolean emLiReadEvent()
 			trPhotonPtr->energy = detPhoton.energy;
 			trPhotonPtr->travel_distance  =
 				detPhoton.time_since_creation * PHGMATH_SPEED_OF_LIGHT;
+			trPhotonPtr->starts_list = (PHG_IsBlue(trPhotonPtr) ?
+				emLiBlueStarts : emLiPinkStarts);
 			trPhotonPtr->numStarts = 0;
 			trPhotonPtr->number = (LbUsEightByte) -1;
 		}
@@ -1462,6 +1468,7 @@ void emLiCreatePhoton(LbUsOneByte flags, PHG_Decay	 *decayPtr,
 		newPhotonPtr->detectorAngle = -1;
 	}
 	
+	newPhotonPtr->starts_list = (PHG_IsBlue(newPhotonPtr) ? emLiBlueStarts : emLiPinkStarts);
 	newPhotonPtr->numStarts = 0;
 	#ifdef PHG_DEBUG
 		/* Clear the starts_list array so the debugger doesn't show the whole thing */
@@ -1567,7 +1574,6 @@ void emLiCreatePhoton(LbUsOneByte flags, PHG_Decay	 *decayPtr,
 Boolean EmisListCreatePhotonList()	
 {
 	Boolean 			okay = false;				/* Process flag */
-	LbUsFourByte		curBinParams;				/* LCV For bin parameters */
 	Boolean 			histFileCreated = false;	/* Did we get history file created */
 	LbTmTimingType		calcDecaysStartTime;		/* Time we started calculating decays */
 	LbTmTimingType		trackPhotonsStartTime;		/* Time we started tracking photons */
@@ -1576,7 +1582,6 @@ Boolean EmisListCreatePhotonList()
 	double				trackPhotonsTime;			/* User time to track photons */
 	double				trackPhotonsCPUTime;		/* System time to track photons */
 	Boolean				timingValid;				/* Whether timing exists on this system */
-	LbUsFourByte		loopV;						/* Loop counter */
 	
 	
 	do { /* Process Loop */
@@ -1609,8 +1614,10 @@ Boolean EmisListCreatePhotonList()
 		/* Get start timing info */
 		LbTmStartTiming(&calcDecaysStartTime);
 		
-		/* Calculate the number of decays */
-		SubObjCalcTimeBinDecays(0, PhgRunTimeParams.Phg_EventsToSimulate);
+		/* Calculate the number of decays (worker processes do this per block) */
+		if (!PHGPAR_IsParallel()) {
+			SubObjCalcTimeBinDecays(0, PhgRunTimeParams.Phg_EventsToSimulate);
+		}
 		
 		/* Get timing information */
 		timingValid = LbTmStopTiming(&calcDecaysStartTime, &calcDecaysTime, &calcDecaysCPUTime);
@@ -1622,165 +1629,408 @@ Boolean EmisListCreatePhotonList()
 		/* Clear out our counter */
 		EmisListNumCreated = 0;
 		
-		/* Loop through all decays */
-		while (emLiCreateDecay()) {
-			
-			/* Although these get cleared out at the beginning of appropriate routines, it
-				is better that they get cleared here.
-			*/
-			for (ColCurParams = 0; ColCurParams < ColNumParams; ColCurParams++) {
-				EmisListCollimatedPhotons[ColCurParams].NumCollimatedBluePhotons = 0;
-				EmisListCollimatedPhotons[ColCurParams].NumCollimatedPinkPhotons = 0;
+		/* Track all of the decays */
+		if (PHGPAR_IsParallel()) {
+			if (!PhgParTrackDecays(emLiTrackDecays)) {
+				break;
 			}
-			for (DetCurParams = 0; DetCurParams < DetNumParams; DetCurParams++) {
-				EmisListDetectedPhotons[DetCurParams].NumDetectedBluePhotons = 0;			
-				EmisListDetectedPhotons[DetCurParams].NumDetectedPinkPhotons = 0;
+		}
+		else {
+			emLiTrackDecays();
+		}
+		
+		/* Get timing information; when tracking in parallel add the CPU time of
+			the worker processes and other ranks to ours */
+		timingValid = LbTmStopTiming(&trackPhotonsStartTime, &trackPhotonsTime, &trackPhotonsCPUTime);
+		if (PHGPAR_IsParallel()) {
+			trackPhotonsCPUTime += PhgParGetOtherCPUTime();
+		}
+		
+		LbInPrintf("\n***************** Simulation Finished *************\n\n");
+		
+		/* Tell them how many photons we tracked */
+		if (PHG_IsPET()) {
+			LbInPrintf("\n\nTracked %lld photons.", SUBOBJGetDecaysProcessed()*2);
+		}
+		else {
+			LbInPrintf("\n\nTracked %lld photons.", SUBOBJGetDecaysProcessed());
+		}
+		
+		/* Print out timing information */
+		{
+			/* Only do this when we want it */
+			if (timingValid) {
+				LbInPrintf("\n\nReal time for calculating time bin decays = %3.1f seconds.", 
+						calcDecaysTime);
+				
+				LbInPrintf("\nReal time for tracking photons = %3.1f seconds.", 
+						trackPhotonsTime);
+				
+				LbInPrintf("\nTotal CPU time for calculating time bin decays = %3.1f seconds.",
+						calcDecaysCPUTime);
+				
+				LbInPrintf("\nTotal CPU time for tracking photons  = %3.1f. seconds",
+						trackPhotonsCPUTime);
+				
+				LbInPrintf("\n\nCPU time for simulation =  %3.1f.",
+						(calcDecaysCPUTime + trackPhotonsCPUTime));
 			}
-			EmisListCurBluePhotonIndex	 = 0;	
-			EmisListCurPinkPhotonIndex = 0;
+		}
+		
+		/* Write the photon statistics */
+		if (!PhoHStatWrite()) {
+			break;
+		}
+		
+		/* Close the photon history list */
+		if (PHG_IsHist()) {
 					
+			/* Print out history report */
+			if (EmisListPHGHistoryFileHk.doCustom) {
+				LbInPrintf("\n\n\tHistory file report for PHG history file");
+				PhoHFilePrintReport(&EmisListPHGHistoryFileHk);
+			}
 			
-			#ifdef __MWERKS__
-				/* Pause for user interaction (on mac) */
-				EmisListDoMacEvent();
-			#endif
+			if (!PhoHFileClose(&EmisListPHGHistoryFileHk)) {
+				break;
+			}
+		}
+		
+		#ifdef __MWERKS__
+			ABORT:;
+		#endif
+		okay = true;
+	} while (false);
+	
+	/* If an error occured, do best to clean up */
+	if (!okay) {
+		ErIgnoreBegin();
+			if (histFileCreated)
+				(void) PhoHFileClose(&EmisListPHGHistoryFileHk);
+		ErIgnoreEnd();
+	}
+	
+	return (okay);
+}
+
+
+/*********************************************************************************
+*
+*			Name:		emLiTrackDecays
+*
+*			Summary:	Create and track every decay remaining in the current
+*						time bin, collimating, detecting, binning and writing
+*						history for each one.
+*			Arguments:
+*				
+*			Function return: None.
+*
+*********************************************************************************/
+void emLiTrackDecays()	
+{
+	LbUsFourByte		curBinParams;				/* LCV For bin parameters */
+	LbUsFourByte		loopV;						/* Loop counter */
+	
+	/* Loop through all decays */
+	while (emLiCreateDecay()) {
+		
+		/* Although these get cleared out at the beginning of appropriate routines, it
+			is better that they get cleared here.
+		*/
+		for (ColCurParams = 0; ColCurParams < ColNumParams; ColCurParams++) {
+			EmisListCollimatedPhotons[ColCurParams].NumCollimatedBluePhotons = 0;
+			EmisListCollimatedPhotons[ColCurParams].NumCollimatedPinkPhotons = 0;
+		}
+		for (DetCurParams = 0; DetCurParams < DetNumParams; DetCurParams++) {
+			EmisListDetectedPhotons[DetCurParams].NumDetectedBluePhotons = 0;			
+			EmisListDetectedPhotons[DetCurParams].NumDetectedPinkPhotons = 0;
+		}
+		EmisListCurBluePhotonIndex	 = 0;	
+		EmisListCurPinkPhotonIndex = 0;
+				
+		
+		#ifdef __MWERKS__
+			/* Pause for user interaction (on mac) */
+			EmisListDoMacEvent();
+		#endif
+		
+		/* Reset current detected photon indexes */
+		EmisListCurBluePhotonIndex = 0;
+		EmisListCurPinkPhotonIndex = 0;
+		
+		/* Increment statistics for this start */
+		PhoHStatUpdateStartedPhotons(&EmisListBluePhoton);
+		
+		/* Update primary productivity starts if photon will be tracked as primary */
+		if ( PHG_IsTrackAsPrimary(&EmisListBluePhoton) ) {
+		
+			ProdTblAddStartingProductivity(&EmisListBluePhoton, PRODTBLFg_Primary);
+		
+		}
+		
+		/* Update scatter productivity starts if photon will be tracked as scatter */
+		if ( PHG_IsTrackAsScatter(&EmisListBluePhoton) ) {
+		
+			ProdTblAddStartingProductivity(&EmisListBluePhoton, PRODTBLFg_Scatter);
+		
+		}
 			
-			/* Reset current detected photon indexes */
-			EmisListCurBluePhotonIndex = 0;
-			EmisListCurPinkPhotonIndex = 0;
+		/* Track that photon */
+		EmisLisTrackPhoton(&EmisListBluePhoton);
+		
+		/* Track pink photon if we are doing PET and (1) there is a detected blue photon
+		 OR (2) we are tracking singles */
+		if ( PHG_IsPETCoincPlusSingles() ||
+				( PHG_IsPETCoincidencesOnly() && (EmisListCurBluePhotonIndex != 0) )  ) {
 			
 			/* Increment statistics for this start */
-			PhoHStatUpdateStartedPhotons(&EmisListBluePhoton);
+			PhoHStatUpdateStartedPhotons(&EmisListPinkPhoton);
 			
 			/* Update primary productivity starts if photon will be tracked as primary */
-			if ( PHG_IsTrackAsPrimary(&EmisListBluePhoton) ) {
+			if ( PHG_IsTrackAsPrimary(&EmisListPinkPhoton) ) {
 			
-				ProdTblAddStartingProductivity(&EmisListBluePhoton, PRODTBLFg_Primary);
+				ProdTblAddStartingProductivity(&EmisListPinkPhoton, PRODTBLFg_Primary);
 			
 			}
 			
 			/* Update scatter productivity starts if photon will be tracked as scatter */
-			if ( PHG_IsTrackAsScatter(&EmisListBluePhoton) ) {
+			if ( PHG_IsTrackAsScatter(&EmisListPinkPhoton) ) {
 			
-				ProdTblAddStartingProductivity(&EmisListBluePhoton, PRODTBLFg_Scatter);
+				ProdTblAddStartingProductivity(&EmisListPinkPhoton, PRODTBLFg_Scatter);
 			
 			}
-				
+			
 			/* Track that photon */
-			EmisLisTrackPhoton(&EmisListBluePhoton);
+			EmisLisTrackPhoton(&EmisListPinkPhoton);
 			
-			/* Track pink photon if we are doing PET and (1) there is a detected blue photon
-			 OR (2) we are tracking singles */
-			if ( PHG_IsPETCoincPlusSingles() ||
-					( PHG_IsPETCoincidencesOnly() && (EmisListCurBluePhotonIndex != 0) )  ) {
-				
-				/* Increment statistics for this start */
-				PhoHStatUpdateStartedPhotons(&EmisListPinkPhoton);
-				
-				/* Update primary productivity starts if photon will be tracked as primary */
-				if ( PHG_IsTrackAsPrimary(&EmisListPinkPhoton) ) {
-				
-					ProdTblAddStartingProductivity(&EmisListPinkPhoton, PRODTBLFg_Primary);
-				
-				}
-				
-				/* Update scatter productivity starts if photon will be tracked as scatter */
-				if ( PHG_IsTrackAsScatter(&EmisListPinkPhoton) ) {
-				
-					ProdTblAddStartingProductivity(&EmisListPinkPhoton, PRODTBLFg_Scatter);
+		}
+		/* Collimate/detect/bin/write photons that made it to the target cylinder */
+		if (PHG_IsPETCoincidencesOnly()){
+		
+			/* For PET check for both blue and pink photons to process detections */
+			if ((EmisListCurBluePhotonIndex != 0) &&
+					(EmisListCurPinkPhotonIndex != 0)) {
 				
+				/* Collimate them if requested */
+				if (PHG_IsCollimateOnTheFly()) {
+					
+					/* Loop through possible collimator configurations */
+					for (ColCurParams = 0; ColCurParams < ColNumParams; ColCurParams++) {
+					
+						/* Some collimator models rely on detector data so keep current detector 
+						parameters index consistent just in case.
+						*/
+						DetCurParams = ColCurParams;
+
+						/* Collimate the photons */
+						ColPETPhotons(&EmisListNewDecay,
+							EmisListDetectdTrkngBluePhotons, EmisListCurBluePhotonIndex,
+							EmisListDetectdTrkngPinkPhotons, EmisListCurPinkPhotonIndex,
+							&EmisListCollimatedPhotons[ColCurParams]);
+								
+							/* Restore tracked photons if more than one detector */
+							if (ColNumParams > 1) {
+								for (loopV = 0; loopV < EmisListCurBluePhotonIndex; loopV++) {
+									EmisListDetectdTrkngBluePhotons[loopV] = EmisListTrackedBluePhotons[loopV];
+								}
+								for (loopV = 0; loopV < EmisListCurPinkPhotonIndex; loopV++) {
+									EmisListDetectdTrkngPinkPhotons[loopV] = EmisListTrackedPinkPhotons[loopV];
+								}
+							}
+					}
 				}
 				
-				/* Track that photon */
-				EmisLisTrackPhoton(&EmisListPinkPhoton);
-				
-			}
-			/* Collimate/detect/bin/write photons that made it to the target cylinder */
-			if (PHG_IsPETCoincidencesOnly()){
-			
-				/* For PET check for both blue and pink photons to process detections */
-				if ((EmisListCurBluePhotonIndex != 0) &&
-						(EmisListCurPinkPhotonIndex != 0)) {
-					
-					/* Collimate them if requested */
+				/* Detect them if requested */
+				if (PHG_IsDetectOnTheFly()) {
+		
+					/* Send collimated photons if it was done */
 					if (PHG_IsCollimateOnTheFly()) {
+						for (DetCurParams = 0; DetCurParams < DetNumParams; DetCurParams++) {
 						
-						/* Loop through possible collimator configurations */
-						for (ColCurParams = 0; ColCurParams < ColNumParams; ColCurParams++) {
-						
-							/* Some collimator models rely on detector data so keep current detector 
-							parameters index consistent just in case.
-							*/
-							DetCurParams = ColCurParams;
+							/* Keep collimator params index current with detector */
+							ColCurParams = DetCurParams;
+							
+							DetPETPhotons(&EmisListNewDecay,
+								EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngBluePhotons,
+								EmisListCollimatedPhotons[ColCurParams].NumCollimatedBluePhotons,
+								EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngPinkPhotons,
+								EmisListCollimatedPhotons[ColCurParams].NumCollimatedPinkPhotons,
+								&(EmisListDetectedPhotons[DetCurParams]));
+						}
+					}
+					else {
+						/* Loop through possible detector configurations */
+						for (DetCurParams = 0; DetCurParams < DetNumParams; DetCurParams++) {
 
-							/* Collimate the photons */
-							ColPETPhotons(&EmisListNewDecay,
+							ColCurParams = DetCurParams;
+							
+							DetPETPhotons(&EmisListNewDecay,
 								EmisListDetectdTrkngBluePhotons, EmisListCurBluePhotonIndex,
 								EmisListDetectdTrkngPinkPhotons, EmisListCurPinkPhotonIndex,
-								&EmisListCollimatedPhotons[ColCurParams]);
-									
-								/* Restore tracked photons if more than one detector */
-								if (ColNumParams > 1) {
-									for (loopV = 0; loopV < EmisListCurBluePhotonIndex; loopV++) {
-										EmisListDetectdTrkngBluePhotons[loopV] = EmisListTrackedBluePhotons[loopV];
-									}
-									for (loopV = 0; loopV < EmisListCurPinkPhotonIndex; loopV++) {
-										EmisListDetectdTrkngPinkPhotons[loopV] = EmisListTrackedPinkPhotons[loopV];
-									}
+								&(EmisListDetectedPhotons[DetCurParams]));
+								
+							/* Restore tracked photons if more than one detector */
+							if (DetNumParams > 1) {
+								for (loopV = 0; loopV < EmisListCurBluePhotonIndex; loopV++) {
+									EmisListDetectdTrkngBluePhotons[loopV] = EmisListTrackedBluePhotons[loopV];
+								}
+								for (loopV = 0; loopV < EmisListCurPinkPhotonIndex; loopV++) {
+									EmisListDetectdTrkngPinkPhotons[loopV] = EmisListTrackedPinkPhotons[loopV];
 								}
+							}
 						}
 					}
-					
-					/* Detect them if requested */
-					if (PHG_IsDetectOnTheFly()) {
-			
-						/* Send collimated photons if it was done */
-						if (PHG_IsCollimateOnTheFly()) {
-							for (DetCurParams = 0; DetCurParams < DetNumParams; DetCurParams++) {
+				}
+				
+				/* Bin them up if binning is being done */
+				if (PHG_IsBinOnTheFly()) {
+					for (curBinParams = 0; curBinParams < PhgNumBinParams; curBinParams++) {
+						ColCurParams = curBinParams;
+						DetCurParams = curBinParams;
+						
+						/* Pass detected Photons if we created them */
+						if (PHG_IsDetectOnTheFly()){
+							PhgBinPETPhotons(&PhgBinParams[curBinParams],
+								&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
+								&EmisListNewDecay,
+								EmisListDetectedPhotons[DetCurParams].DetectedTrkngBluePhotons, 
+								EmisListDetectedPhotons[DetCurParams].NumDetectedBluePhotons,
+								EmisListDetectedPhotons[DetCurParams].DetectedTrkngPinkPhotons,
+								EmisListDetectedPhotons[DetCurParams].NumDetectedPinkPhotons);
+						}
+						else if (PHG_IsCollimateOnTheFly()) {
 							
-								/* Keep collimator params index current with detector */
-								ColCurParams = DetCurParams;
+							PhgBinPETPhotons(&PhgBinParams[curBinParams], &PhgBinData[curBinParams], &PhgBinFields[curBinParams],
+								&EmisListNewDecay,
+								EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngBluePhotons, 
+								EmisListCollimatedPhotons[ColCurParams].NumCollimatedBluePhotons,
+								EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngPinkPhotons,
+								EmisListCollimatedPhotons[ColCurParams].NumCollimatedPinkPhotons);
+						}
+						else {
+							/* Bin up non-collimated photons */
+							PhgBinPETPhotons(&PhgBinParams[curBinParams], &PhgBinData[curBinParams], &PhgBinFields[curBinParams],
+								&EmisListNewDecay,
+								EmisListDetectdTrkngBluePhotons, EmisListCurBluePhotonIndex,
+								EmisListDetectdTrkngPinkPhotons, EmisListCurPinkPhotonIndex);
+						}
+					}
+				}
+				
+				/* Now write them out (Abort on failure) */
+				if (PHG_IsHist()) {
+					if (PhoHFileWriteDetections(&EmisListPHGHistoryFileHk, &EmisListNewDecay,
+							EmisListTrackedBluePhotons, EmisListCurBluePhotonIndex,
+							EmisListTrackedPinkPhotons, EmisListCurPinkPhotonIndex) == false) {
+						
+						/* Abort Program execution */
+						PhgAbort("Got failure from PhoHFileWriteDetections (EmisListCreatePhotonList).", true);
+					}
+				}
+			}
+		}
+		else if (PHG_IsPETCoincPlusSingles()){
+		
+			/* For PET check for both blue and pink photons to process detections */
+			if ((EmisListCurBluePhotonIndex != 0) ||
+					(EmisListCurPinkPhotonIndex != 0)) {
+				
+				/* Collimate them if requested */
+				if (PHG_IsCollimateOnTheFly()) {
+					
+					/* Loop through possible collimator configurations */
+					for (ColCurParams = 0; ColCurParams < ColNumParams; ColCurParams++) {
+					
+						/* Some collimator models rely on detector data so keep current detector 
+						parameters index consistent just in case.
+						*/
+						DetCurParams = ColCurParams;
+
+						/* Collimate the photons */
+						ColPETPhotons(&EmisListNewDecay,
+							EmisListDetectdTrkngBluePhotons, EmisListCurBluePhotonIndex,
+							EmisListDetectdTrkngPinkPhotons, EmisListCurPinkPhotonIndex,
+							&EmisListCollimatedPhotons[ColCurParams]);
 								
-								DetPETPhotons(&EmisListNewDecay,
-									EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngBluePhotons,
-									EmisListCollimatedPhotons[ColCurParams].NumCollimatedBluePhotons,
-									EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngPinkPhotons,
-									EmisListCollimatedPhotons[ColCurParams].NumCollimatedPinkPhotons,
-									&(EmisListDetectedPhotons[DetCurParams]));
+							/* Restore tracked photons if more than one detector */
+							if (ColNumParams > 1) {
+								for (loopV = 0; loopV < EmisListCurBluePhotonIndex; loopV++) {
+									EmisListDetectdTrkngBluePhotons[loopV] = EmisListTrackedBluePhotons[loopV];
+								}
+								for (loopV = 0; loopV < EmisListCurPinkPhotonIndex; loopV++) {
+									EmisListDetectdTrkngPinkPhotons[loopV] = EmisListTrackedPinkPhotons[loopV];
+								}
 							}
+					}
+				}
+				
+				/* Detect them if requested */
+				if (PHG_IsDetectOnTheFly()) {
+		
+					/* Send collimated photons if it was done */
+					if (PHG_IsCollimateOnTheFly()) {
+						for (DetCurParams = 0; DetCurParams < DetNumParams; DetCurParams++) {
+						
+							/* Keep collimator params index current with detector */
+							ColCurParams = DetCurParams;
+							
+							DetPETPhotons(&EmisListNewDecay,
+								EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngBluePhotons,
+								EmisListCollimatedPhotons[ColCurParams].NumCollimatedBluePhotons,
+								EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngPinkPhotons,
+								EmisListCollimatedPhotons[ColCurParams].NumCollimatedPinkPhotons,
+								&(EmisListDetectedPhotons[DetCurParams]));
 						}
-						else {
-							/* Loop through possible detector configurations */
-							for (DetCurParams = 0; DetCurParams < DetNumParams; DetCurParams++) {
+					}
+					else {
+						/* Loop through possible detector configurations */
+						for (DetCurParams = 0; DetCurParams < DetNumParams; DetCurParams++) {
 
-								ColCurParams = DetCurParams;
+							ColCurParams = DetCurParams;
+							
+							DetPETPhotons(&EmisListNewDecay,
+								EmisListDetectdTrkngBluePhotons, EmisListCurBluePhotonIndex,
+								EmisListDetectdTrkngPinkPhotons, EmisListCurPinkPhotonIndex,
+								&(EmisListDetectedPhotons[DetCurParams]));
 								
-								DetPETPhotons(&EmisListNewDecay,
-									EmisListDetectdTrkngBluePhotons, EmisListCurBluePhotonIndex,
-									EmisListDetectdTrkngPinkPhotons, EmisListCurPinkPhotonIndex,
-									&(EmisListDetectedPhotons[DetCurParams]));
-									
-								/* Restore tracked photons if more than one detector */
-								if (DetNumParams > 1) {
-									for (loopV = 0; loopV < EmisListCurBluePhotonIndex; loopV++) {
-										EmisListDetectdTrkngBluePhotons[loopV] = EmisListTrackedBluePhotons[loopV];
-									}
-									for (loopV = 0; loopV < EmisListCurPinkPhotonIndex; loopV++) {
-										EmisListDetectdTrkngPinkPhotons[loopV] = EmisListTrackedPinkPhotons[loopV];
-									}
+							/* Restore tracked photons if more than one detector */
+							if (DetNumParams > 1) {
+								for (loopV = 0; loopV < EmisListCurBluePhotonIndex; loopV++) {
+									EmisListDetectdTrkngBluePhotons[loopV] = EmisListTrackedBluePhotons[loopV];
+								}
+								for (loopV = 0; loopV < EmisListCurPinkPhotonIndex; loopV++) {
+									EmisListDetectdTrkngPinkPhotons[loopV] = EmisListTrackedPinkPhotons[loopV];
 								}
 							}
 						}
 					}
-					
-					/* Bin them up if binning is being done */
-					if (PHG_IsBinOnTheFly()) {
-						for (curBinParams = 0; curBinParams < PhgNumBinParams; curBinParams++) {
-							ColCurParams = curBinParams;
-							DetCurParams = curBinParams;
+				}
+				
+				/* Bin them up if binning is being done */
+				if (PHG_IsBinOnTheFly()) {
+					for (curBinParams = 0; curBinParams < PhgNumBinParams; curBinParams++) {
+						ColCurParams = curBinParams;
+						DetCurParams = curBinParams;
+						
+						/* Pass detected Photons if we created them */
+						if (PHG_IsDetectOnTheFly()){
+						
+							if ( PhgBinParams[0].isBinPETasSPECT ) {
+								
+								PhgBinSPECTPhotons(&PhgBinParams[curBinParams],
+									&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
+									&EmisListNewDecay,
+									EmisListDetectedPhotons[DetCurParams].DetectedTrkngBluePhotons,
+									EmisListDetectedPhotons[DetCurParams].NumDetectedBluePhotons);
+								
+								PhgBinSPECTPhotons(&PhgBinParams[curBinParams],
+									&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
+									&EmisListNewDecay,
+									EmisListDetectedPhotons[DetCurParams].DetectedTrkngPinkPhotons,
+									EmisListDetectedPhotons[DetCurParams].NumDetectedPinkPhotons);
+								
+							} else {
 							
-							/* Pass detected Photons if we created them */
-							if (PHG_IsDetectOnTheFly()){
 								PhgBinPETPhotons(&PhgBinParams[curBinParams],
 									&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
 									&EmisListNewDecay,
@@ -1788,401 +2038,191 @@ Boolean EmisListCreatePhotonList()
 									EmisListDetectedPhotons[DetCurParams].NumDetectedBluePhotons,
 									EmisListDetectedPhotons[DetCurParams].DetectedTrkngPinkPhotons,
 									EmisListDetectedPhotons[DetCurParams].NumDetectedPinkPhotons);
+								
 							}
-							else if (PHG_IsCollimateOnTheFly()) {
+							
+						}
+						else if (PHG_IsCollimateOnTheFly()) {
+							
+							if ( PhgBinParams[0].isBinPETasSPECT ) {
+								
+								PhgBinSPECTPhotons(&PhgBinParams[curBinParams],
+									&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
+									&EmisListNewDecay,
+									EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngBluePhotons, 
+									EmisListCollimatedPhotons[ColCurParams].NumCollimatedBluePhotons);
 								
+								PhgBinSPECTPhotons(&PhgBinParams[curBinParams],
+									&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
+									&EmisListNewDecay,
+									EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngPinkPhotons,
+									EmisListCollimatedPhotons[ColCurParams].NumCollimatedPinkPhotons);
+								
+							} else {
+							
 								PhgBinPETPhotons(&PhgBinParams[curBinParams], &PhgBinData[curBinParams], &PhgBinFields[curBinParams],
 									&EmisListNewDecay,
 									EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngBluePhotons, 
 									EmisListCollimatedPhotons[ColCurParams].NumCollimatedBluePhotons,
 									EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngPinkPhotons,
 									EmisListCollimatedPhotons[ColCurParams].NumCollimatedPinkPhotons);
+								
 							}
-							else {
-								/* Bin up non-collimated photons */
+							
+						}
+						else {
+
+							/* Bin up non-collimated photons */
+							if ( PhgBinParams[0].isBinPETasSPECT ) {
+								
+								PhgBinSPECTPhotons(&PhgBinParams[curBinParams],
+									&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
+									&EmisListNewDecay,
+									EmisListDetectdTrkngBluePhotons, EmisListCurBluePhotonIndex);
+								
+								PhgBinSPECTPhotons(&PhgBinParams[curBinParams],
+									&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
+									&EmisListNewDecay,
+									EmisListDetectdTrkngPinkPhotons, EmisListCurPinkPhotonIndex);
+								
+							} else {
+							
 								PhgBinPETPhotons(&PhgBinParams[curBinParams], &PhgBinData[curBinParams], &PhgBinFields[curBinParams],
 									&EmisListNewDecay,
 									EmisListDetectdTrkngBluePhotons, EmisListCurBluePhotonIndex,
 									EmisListDetectdTrkngPinkPhotons, EmisListCurPinkPhotonIndex);
+								
 							}
-						}
-					}
-					
-					/* Now write them out (Abort on failure) */
-					if (PHG_IsHist()) {
-						if (PhoHFileWriteDetections(&EmisListPHGHistoryFileHk, &EmisListNewDecay,
-								EmisListTrackedBluePhotons, EmisListCurBluePhotonIndex,
-								EmisListTrackedPinkPhotons, EmisListCurPinkPhotonIndex) == false) {
 							
-							/* Abort Program execution */
-							PhgAbort("Got failure from PhoHFileWriteDetections (EmisListCreatePhotonList).", true);
 						}
 					}
 				}
-			}
-			else if (PHG_IsPETCoincPlusSingles()){
-			
-				/* For PET check for both blue and pink photons to process detections */
-				if ((EmisListCurBluePhotonIndex != 0) ||
-						(EmisListCurPinkPhotonIndex != 0)) {
-					
-					/* Collimate them if requested */
-					if (PHG_IsCollimateOnTheFly()) {
-						
-						/* Loop through possible collimator configurations */
-						for (ColCurParams = 0; ColCurParams < ColNumParams; ColCurParams++) {
+				
+				/* Now write them out (Abort on failure) */
+				if (PHG_IsHist()) {
+					if (PhoHFileWriteDetections(&EmisListPHGHistoryFileHk, &EmisListNewDecay,
+							EmisListTrackedBluePhotons, EmisListCurBluePhotonIndex,
+							EmisListTrackedPinkPhotons, EmisListCurPinkPhotonIndex) == false) {
 						
-							/* Some collimator models rely on detector data so keep current detector 
-							parameters index consistent just in case.
-							*/
-							DetCurParams = ColCurParams;
-
-							/* Collimate the photons */
-							ColPETPhotons(&EmisListNewDecay,
-								EmisListDetectdTrkngBluePhotons, EmisListCurBluePhotonIndex,
-								EmisListDetectdTrkngPinkPhotons, EmisListCurPinkPhotonIndex,
-								&EmisListCollimatedPhotons[ColCurParams]);
-									
-								/* Restore tracked photons if more than one detector */
-								if (ColNumParams > 1) {
-									for (loopV = 0; loopV < EmisListCurBluePhotonIndex; loopV++) {
-										EmisListDetectdTrkngBluePhotons[loopV] = EmisListTrackedBluePhotons[loopV];
-									}
-									for (loopV = 0; loopV < EmisListCurPinkPhotonIndex; loopV++) {
-										EmisListDetectdTrkngPinkPhotons[loopV] = EmisListTrackedPinkPhotons[loopV];
-									}
-								}
-						}
+						/* Abort Program execution */
+						PhgAbort("Got failure from PhoHFileWriteDetections (EmisListCreatePhotonList).", true);
 					}
+				}
+			}
+		}
+		else {
+		
+			/* For SPECT check for blue photos to process detections */
+			if (EmisListCurBluePhotonIndex != 0) {
 					
-					/* Detect them if requested */
-					if (PHG_IsDetectOnTheFly()) {
-			
-						/* Send collimated photons if it was done */
-						if (PHG_IsCollimateOnTheFly()) {
-							for (DetCurParams = 0; DetCurParams < DetNumParams; DetCurParams++) {
-							
-								/* Keep collimator params index current with detector */
-								ColCurParams = DetCurParams;
-								
-								DetPETPhotons(&EmisListNewDecay,
-									EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngBluePhotons,
-									EmisListCollimatedPhotons[ColCurParams].NumCollimatedBluePhotons,
-									EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngPinkPhotons,
-									EmisListCollimatedPhotons[ColCurParams].NumCollimatedPinkPhotons,
-									&(EmisListDetectedPhotons[DetCurParams]));
-							}
-						}
-						else {
-							/* Loop through possible detector configurations */
-							for (DetCurParams = 0; DetCurParams < DetNumParams; DetCurParams++) {
-
-								ColCurParams = DetCurParams;
+				/* Collimate them if necessary */
+				if (PHG_IsCollimateOnTheFly()) {
+					for (ColCurParams = 0; ColCurParams < ColNumParams; ColCurParams++) {
+						DetCurParams = ColCurParams;
+						ColSPECTPhotons(&EmisListNewDecay,
+							EmisListDetectdTrkngBluePhotons, EmisListCurBluePhotonIndex,
+							&EmisListCollimatedPhotons[ColCurParams]);
 								
-								DetPETPhotons(&EmisListNewDecay,
-									EmisListDetectdTrkngBluePhotons, EmisListCurBluePhotonIndex,
-									EmisListDetectdTrkngPinkPhotons, EmisListCurPinkPhotonIndex,
-									&(EmisListDetectedPhotons[DetCurParams]));
-									
-								/* Restore tracked photons if more than one detector */
-								if (DetNumParams > 1) {
-									for (loopV = 0; loopV < EmisListCurBluePhotonIndex; loopV++) {
-										EmisListDetectdTrkngBluePhotons[loopV] = EmisListTrackedBluePhotons[loopV];
-									}
-									for (loopV = 0; loopV < EmisListCurPinkPhotonIndex; loopV++) {
-										EmisListDetectdTrkngPinkPhotons[loopV] = EmisListTrackedPinkPhotons[loopV];
-									}
+							/* Restore tracked photons if more than one detector */
+							if (ColNumParams > 1) {
+								for (loopV = 0; loopV < EmisListCurBluePhotonIndex; loopV++) {
+									EmisListDetectdTrkngBluePhotons[loopV] = EmisListTrackedBluePhotons[loopV];
 								}
-							}
-						}
-					}
-					
-					/* Bin them up if binning is being done */
-					if (PHG_IsBinOnTheFly()) {
-						for (curBinParams = 0; curBinParams < PhgNumBinParams; curBinParams++) {
-							ColCurParams = curBinParams;
-							DetCurParams = curBinParams;
-							
-							/* Pass detected Photons if we created them */
-							if (PHG_IsDetectOnTheFly()){
-							
-								if ( PhgBinParams[0].isBinPETasSPECT ) {
-									
-									PhgBinSPECTPhotons(&PhgBinParams[curBinParams],
-										&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
-										&EmisListNewDecay,
-										EmisListDetectedPhotons[DetCurParams].DetectedTrkngBluePhotons,
-										EmisListDetectedPhotons[DetCurParams].NumDetectedBluePhotons);
-									
-									PhgBinSPECTPhotons(&PhgBinParams[curBinParams],
-										&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
-										&EmisListNewDecay,
-										EmisListDetectedPhotons[DetCurParams].DetectedTrkngPinkPhotons,
-										EmisListDetectedPhotons[DetCurParams].NumDetectedPinkPhotons);
-									
-								} else {
-								
-									PhgBinPETPhotons(&PhgBinParams[curBinParams],
-										&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
-										&EmisListNewDecay,
-										EmisListDetectedPhotons[DetCurParams].DetectedTrkngBluePhotons, 
-										EmisListDetectedPhotons[DetCurParams].NumDetectedBluePhotons,
-										EmisListDetectedPhotons[DetCurParams].DetectedTrkngPinkPhotons,
-										EmisListDetectedPhotons[DetCurParams].NumDetectedPinkPhotons);
-									
+								for (loopV = 0; loopV < EmisListCurPinkPhotonIndex; loopV++) {
+									EmisListDetectdTrkngPinkPhotons[loopV] = EmisListTrackedPinkPhotons[loopV];
 								}
-								
 							}
-							else if (PHG_IsCollimateOnTheFly()) {
-								
-								if ( PhgBinParams[0].isBinPETasSPECT ) {
-									
-									PhgBinSPECTPhotons(&PhgBinParams[curBinParams],
-										&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
-										&EmisListNewDecay,
-										EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngBluePhotons, 
-										EmisListCollimatedPhotons[ColCurParams].NumCollimatedBluePhotons);
-									
-									PhgBinSPECTPhotons(&PhgBinParams[curBinParams],
-										&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
-										&EmisListNewDecay,
-										EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngPinkPhotons,
-										EmisListCollimatedPhotons[ColCurParams].NumCollimatedPinkPhotons);
-									
-								} else {
-								
-									PhgBinPETPhotons(&PhgBinParams[curBinParams], &PhgBinData[curBinParams], &PhgBinFields[curBinParams],
-										&EmisListNewDecay,
-										EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngBluePhotons, 
-										EmisListCollimatedPhotons[ColCurParams].NumCollimatedBluePhotons,
-										EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngPinkPhotons,
-										EmisListCollimatedPhotons[ColCurParams].NumCollimatedPinkPhotons);
-									
-								}
-								
-							}
-							else {
-
-								/* Bin up non-collimated photons */
-								if ( PhgBinParams[0].isBinPETasSPECT ) {
-									
-									PhgBinSPECTPhotons(&PhgBinParams[curBinParams],
-										&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
-										&EmisListNewDecay,
-										EmisListDetectdTrkngBluePhotons, EmisListCurBluePhotonIndex);
-									
-									PhgBinSPECTPhotons(&PhgBinParams[curBinParams],
-										&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
-										&EmisListNewDecay,
-										EmisListDetectdTrkngPinkPhotons, EmisListCurPinkPhotonIndex);
-									
-								} else {
-								
-									PhgBinPETPhotons(&PhgBinParams[curBinParams], &PhgBinData[curBinParams], &PhgBinFields[curBinParams],
-										&EmisListNewDecay,
-										EmisListDetectdTrkngBluePhotons, EmisListCurBluePhotonIndex,
-										EmisListDetectdTrkngPinkPhotons, EmisListCurPinkPhotonIndex);
-									
-								}
-								
-							}
-						}
-					}
-					
-					/* Now write them out (Abort on failure) */
-					if (PHG_IsHist()) {
-						if (PhoHFileWriteDetections(&EmisListPHGHistoryFileHk, &EmisListNewDecay,
-								EmisListTrackedBluePhotons, EmisListCurBluePhotonIndex,
-								EmisListTrackedPinkPhotons, EmisListCurPinkPhotonIndex) == false) {
-							
-							/* Abort Program execution */
-							PhgAbort("Got failure from PhoHFileWriteDetections (EmisListCreatePhotonList).", true);
-						}
 					}
 				}
-			}
-			else {
-			
-				/* For SPECT check for blue photos to process detections */
-				if (EmisListCurBluePhotonIndex != 0) {
+					
+				/* Collimate them if necessary */
+				if (PHG_IsDetectOnTheFly()) {
+					for (DetCurParams = 0; DetCurParams < DetNumParams; DetCurParams++) {
+						ColCurParams = DetCurParams;
 						
-					/* Collimate them if necessary */
-					if (PHG_IsCollimateOnTheFly()) {
-						for (ColCurParams = 0; ColCurParams < ColNumParams; ColCurParams++) {
-							DetCurParams = ColCurParams;
-							ColSPECTPhotons(&EmisListNewDecay,
+						if (PHG_IsCollimateOnTheFly()) {
+							DetSPECTPhotons(&EmisListNewDecay,
+								EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngBluePhotons,
+								EmisListCollimatedPhotons[ColCurParams].NumCollimatedBluePhotons,
+								&(EmisListDetectedPhotons[DetCurParams]));
+						}
+						else {
+							DetSPECTPhotons(&EmisListNewDecay,
 								EmisListDetectdTrkngBluePhotons, EmisListCurBluePhotonIndex,
-								&EmisListCollimatedPhotons[ColCurParams]);
-									
-								/* Restore tracked photons if more than one detector */
-								if (ColNumParams > 1) {
-									for (loopV = 0; loopV < EmisListCurBluePhotonIndex; loopV++) {
-										EmisListDetectdTrkngBluePhotons[loopV] = EmisListTrackedBluePhotons[loopV];
-									}
-									for (loopV = 0; loopV < EmisListCurPinkPhotonIndex; loopV++) {
-										EmisListDetectdTrkngPinkPhotons[loopV] = EmisListTrackedPinkPhotons[loopV];
-									}
+								&(EmisListDetectedPhotons[DetCurParams]));
+								
+							/* Restore tracked photons if more than one detector */
+							if (DetNumParams > 1) {
+								for (loopV = 0; loopV < EmisListCurBluePhotonIndex; loopV++) {
+									EmisListDetectdTrkngBluePhotons[loopV] = EmisListTrackedBluePhotons[loopV];
 								}
-						}
-					}
-						
-					/* Collimate them if necessary */
-					if (PHG_IsDetectOnTheFly()) {
-						for (DetCurParams = 0; DetCurParams < DetNumParams; DetCurParams++) {
-							ColCurParams = DetCurParams;
-							
-							if (PHG_IsCollimateOnTheFly()) {
-								DetSPECTPhotons(&EmisListNewDecay,
-									EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngBluePhotons,
-									EmisListCollimatedPhotons[ColCurParams].NumCollimatedBluePhotons,
-									&(EmisListDetectedPhotons[DetCurParams]));
-							}
-							else {
-								DetSPECTPhotons(&EmisListNewDecay,
-									EmisListDetectdTrkngBluePhotons, EmisListCurBluePhotonIndex,
-									&(EmisListDetectedPhotons[DetCurParams]));
-									
-								/* Restore tracked photons if more than one detector */
-								if (DetNumParams > 1) {
-									for (loopV = 0; loopV < EmisListCurBluePhotonIndex; loopV++) {
-										EmisListDetectdTrkngBluePhotons[loopV] = EmisListTrackedBluePhotons[loopV];
-									}
-									for (loopV = 0; loopV < EmisListCurPinkPhotonIndex; loopV++) {
-										EmisListDetectdTrkngPinkPhotons[loopV] = EmisListTrackedPinkPhotons[loopV];
-									}
+								for (loopV = 0; loopV < EmisListCurPinkPhotonIndex; loopV++) {
+									EmisListDetectdTrkngPinkPhotons[loopV] = EmisListTrackedPinkPhotons[loopV];
 								}
 							}
 						}
 					}
+				}
 
-					/* Bin them up if necessary */
-					if (PHG_IsBinOnTheFly()) {
+				/* Bin them up if necessary */
+				if (PHG_IsBinOnTheFly()) {
 
-						for (curBinParams = 0; curBinParams < PhgNumBinParams; curBinParams++) {
-							ColCurParams = curBinParams;
-							DetCurParams = curBinParams;
-							
-							/* Pass detected photons if we created them */
-							if (PHG_IsDetectOnTheFly()) {
-								PhgBinSPECTPhotons(&PhgBinParams[curBinParams],
-									&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
-									&EmisListNewDecay,
-									EmisListDetectedPhotons[DetCurParams].DetectedTrkngBluePhotons,
-									EmisListDetectedPhotons[DetCurParams].NumDetectedBluePhotons);
-							}
-							else if (PHG_IsCollimateOnTheFly()) {
-								PhgBinSPECTPhotons(&PhgBinParams[curBinParams],
-									&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
-									&EmisListNewDecay,
-									EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngBluePhotons,
-									EmisListCollimatedPhotons[ColCurParams].NumCollimatedBluePhotons);
-							}
-							else {
-								/* Bin up non-collimated photons */
-								PhgBinSPECTPhotons(&PhgBinParams[curBinParams], &PhgBinData[curBinParams], &PhgBinFields[curBinParams],
+					for (curBinParams = 0; curBinParams < PhgNumBinParams; curBinParams++) {
+						ColCurParams = curBinParams;
+						DetCurParams = curBinParams;
+						
+						/* Pass detected photons if we created them */
+						if (PHG_IsDetectOnTheFly()) {
+							PhgBinSPECTPhotons(&PhgBinParams[curBinParams],
+								&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
 								&EmisListNewDecay,
-									EmisListDetectdTrkngBluePhotons, EmisListCurBluePhotonIndex);
-							}
+								EmisListDetectedPhotons[DetCurParams].DetectedTrkngBluePhotons,
+								EmisListDetectedPhotons[DetCurParams].NumDetectedBluePhotons);
+						}
+						else if (PHG_IsCollimateOnTheFly()) {
+							PhgBinSPECTPhotons(&PhgBinParams[curBinParams],
+								&PhgBinData[curBinParams], &PhgBinFields[curBinParams],
+								&EmisListNewDecay,
+								EmisListCollimatedPhotons[ColCurParams].CollimatedTrkngBluePhotons,
+								EmisListCollimatedPhotons[ColCurParams].NumCollimatedBluePhotons);
+						}
+						else {
+							/* Bin up non-collimated photons */
+							PhgBinSPECTPhotons(&PhgBinParams[curBinParams], &PhgBinData[curBinParams], &PhgBinFields[curBinParams],
+							&EmisListNewDecay,
+								EmisListDetectdTrkngBluePhotons, EmisListCurBluePhotonIndex);
 						}
 					}
+				}
 
-					/* Now write them out (Abort on failure) */
-					if (PHG_IsHist()) {
-						if (PhoHFileWriteDetections(&EmisListPHGHistoryFileHk, &EmisListNewDecay,
-								EmisListTrackedBluePhotons, EmisListCurBluePhotonIndex,
-								EmisListTrackedPinkPhotons, EmisListCurPinkPhotonIndex) == false) {
-							
-							/* Abort Program execution */
-							PhgAbort("Unexpected failure from PhoHFileWriteDetections trapped in EmisListCreatePhotonList.", true);
-						}
+				/* Now write them out (Abort on failure) */
+				if (PHG_IsHist()) {
+					if (PhoHFileWriteDetections(&EmisListPHGHistoryFileHk, &EmisListNewDecay,
+							EmisListTrackedBluePhotons, EmisListCurBluePhotonIndex,
+							EmisListTrackedPinkPhotons, EmisListCurPinkPhotonIndex) == false) {
+						
+						/* Abort Program execution */
+						PhgAbort("Unexpected failure from PhoHFileWriteDetections trapped in EmisListCreatePhotonList.", true);
 					}
 				}
 			}
-			
-			/* Although these get cleared out at the beginning appropriate routines, they need to get cleared out
-				at the end also
-			*/
-			for (ColCurParams = 0; ColCurParams < ColNumParams; ColCurParams++) {
-				EmisListCollimatedPhotons[ColCurParams].NumCollimatedBluePhotons = 0;
-				EmisListCollimatedPhotons[ColCurParams].NumCollimatedPinkPhotons = 0;
-			}
-			for (DetCurParams = 0; DetCurParams < DetNumParams; DetCurParams++) {
-				EmisListDetectedPhotons[DetCurParams].NumDetectedBluePhotons = 0;			
-				EmisListDetectedPhotons[DetCurParams].NumDetectedPinkPhotons = 0;
-			}
-			EmisListCurBluePhotonIndex	 = 0;	
-			EmisListCurPinkPhotonIndex = 0;
-					
-		} /* End of loop for tracking photons */
-		
-		/* Get timing information */
-		timingValid = LbTmStopTiming(&trackPhotonsStartTime, &trackPhotonsTime, &trackPhotonsCPUTime);
-		
-		LbInPrintf("\n***************** Simulation Finished *************\n\n");
-		
-		/* Tell them how many photons we tracked */
-		if (PHG_IsPET()) {
-			LbInPrintf("\n\nTracked %lld photons.", SUBOBJGetDecaysProcessed()*2);
-		}
-		else {
-			LbInPrintf("\n\nTracked %lld photons.", SUBOBJGetDecaysProcessed());
 		}
 		
-		/* Print out timing information */
-		{
-			/* Only do this when we want it */
-			if (timingValid) {
-				LbInPrintf("\n\nReal time for calculating time bin decays = %3.1f seconds.", 
-						calcDecaysTime);
-				
-				LbInPrintf("\nReal time for tracking photons = %3.1f seconds.", 
-						trackPhotonsTime);
-				
-				LbInPrintf("\nTotal CPU time for calculating time bin decays = %3.1f seconds.",
-						calcDecaysCPUTime);
-				
-				LbInPrintf("\nTotal CPU time for tracking photons  = %3.1f. seconds",
-						trackPhotonsCPUTime);
-				
-				LbInPrintf("\n\nCPU time for simulation =  %3.1f.",
-						(calcDecaysCPUTime + trackPhotonsCPUTime));
-			}
+		/* Although these get cleared out at the beginning appropriate routines, they need to get cleared out
+			at the end also
+		*/
+		for (ColCurParams = 0; ColCurParams < ColNumParams; ColCurParams++) {
+			EmisListCollimatedPhotons[ColCurParams].NumCollimatedBluePhotons = 0;
+			EmisListCollimatedPhotons[ColCurParams].NumCollimatedPinkPhotons = 0;
 		}
-		
-		/* Write the photon statistics */
-		if (!PhoHStatWrite()) {
-			break;
+		for (DetCurParams = 0; DetCurParams < DetNumParams; DetCurParams++) {
+			EmisListDetectedPhotons[DetCurParams].NumDetectedBluePhotons = 0;			
+			EmisListDetectedPhotons[DetCurParams].NumDetectedPinkPhotons = 0;
 		}
-		
-		/* Close the photon history list */
-		if (PHG_IsHist()) {
-					
-			/* Print out history report */
-			if (EmisListPHGHistoryFileHk.doCustom) {
-				LbInPrintf("\n\n\tHistory file report for PHG history file");
-				PhoHFilePrintReport(&EmisListPHGHistoryFileHk);
-			}
-			
-			if (!PhoHFileClose(&EmisListPHGHistoryFileHk)) {
-				break;
-			}
-		}
-		
-		#ifdef __MWERKS__
-			ABORT:;
-		#endif
-		okay = true;
-	} while (false);
-	
-	/* If an error occured, do best to clean up */
-	if (!okay) {
-		ErIgnoreBegin();
-			if (histFileCreated)
-				(void) PhoHFileClose(&EmisListPHGHistoryFileHk);
-		ErIgnoreEnd();
-	}
-	
-	return (okay);
+		EmisListCurBluePhotonIndex	 = 0;	
+		EmisListCurPinkPhotonIndex = 0;
+				
+	} /* End of loop for tracking photons */
 }
 
 
@@ -2577,6 +2617,7 @@ void EmisLisTrackPhoton(PHG_TrackingPhoton *trackingPhotonPtr)
 	double				comptonToScatterProbability;	/* Probability of compton to probability of scatter */
 	double				interactionProbability;			/* Random number for selecting interaction type */
 	double				scatterProbability;				/* Probability of any type of scatter */
+	SubObjInteractionTy	*interactionPtr;				/* Interaction values of the material */
 	PHG_Position		newPosition;					/* New photon position */
 	PhoTrkActionTy		action;							/* Action to be taken based on new position */
 	
@@ -2706,8 +2747,9 @@ void EmisLisTrackPhoton(PHG_TrackingPhoton *trackingPhotonPtr)
 				}
 				
 				/* Get interaction type probability */
-				comptonToScatterProbability = SubObjGetProbComptToScatter(trackingPhotonPtr);
-				scatterProbability = SubObjGetProbScatterInObj(trackingPhotonPtr);
+				interactionPtr = SubObjGetInteractionInObj(trackingPhotonPtr);
+				comptonToScatterProbability = interactionPtr->probComptonToScatter;
+				scatterProbability = interactionPtr->probScatter;
 				interactionProbability = PhgMathGetRandomNumber();
 
 				/* See if non-absorption is being forced  */
@@ -0,0 +1,787 @@
+/*********************************************************************************
+*																				*
+*                       Source code developed by the							*
+*            Imaging Research Laboratory - University of Washington				*
+*                (C) Copyright 2026 Department of Radiology						*
+*                         University of Washington								*
+*                            All Rights Reserved								*
+*																				*
+*********************************************************************************/
+
+/*********************************************************************************
+*
+*		Module Name:		LbCompress.c
+*		Revision Number:	1.0
+*		Date last revised:	16 October 2026
+*		Programmer:
+*		Date Originated:	16 October 2026
+*
+*		Module Overview:	Lossless compression of byte planes.  Each plane
+*							is stored raw, as a single repeated byte, as an
+*							LZ77 block (LZ4 sequence layout), or with a
+*							length-limited canonical Huffman code, whichever
+*							is smallest.
+*
+*		References:			LZ4 block format description (Y. Collet).
+*							Moffat & Turpin (1997), canonical prefix codes.
+*
+**********************************************************************************
+*
+*		Global functions defined:
+*			LbCmPackBytes
+*			LbCmUnpackBytes
+*
+*		Global variables defined:	none
+*
+**********************************************************************************
+*
+*		Revision Section (Also update version number, if relevant)
+*
+*		Programmer(s):
+*
+*		Revision date:
+*
+*		Revision description:
+*
+*********************************************************************************/
+
+#include "LbCompress.h"
+
+
+#include <string.h>
+
+
+/*	LOCAL CONSTANTS */
+#define		LBCM_METHOD_RAW			0		/* Plane stored as is */
+#define		LBCM_METHOD_CONST		1		/* Plane is one repeated byte */
+#define		LBCM_METHOD_LZ			2		/* Plane is LZ77 compressed */
+#define		LBCM_METHOD_HUFFMAN		3		/* Plane is Huffman coded */
+
+#define		LBCM_HASH_BITS			14		/* Bits in the LZ match finder hash */
+#define		LBCM_HASH_SIZE			(1 << LBCM_HASH_BITS)
+#define		LBCM_MIN_MATCH			4		/* Shortest LZ match */
+#define		LBCM_MAX_OFFSET			65535	/* Farthest LZ match distance */
+#define		LBCM_LAST_LITERALS		5		/* Block always ends with this many literals */
+#define		LBCM_MATCH_LIMIT		12		/* No match may start this close to the end */
+#define		LBCM_SKIP_SHIFT			6		/* Search step grows every 2^shift misses */
+
+#define		LBCM_NUM_SYMBOLS		256		/* Byte alphabet */
+#define		LBCM_MAX_CODE_BITS		12		/* Longest Huffman code */
+#define		LBCM_TABLE_SIZE			(1 << LBCM_MAX_CODE_BITS)
+#define		LBCM_BITMAP_SIZE		(LBCM_NUM_SYMBOLS / 8)
+
+
+/*	LOCAL MACROS */
+#define		LBCM_HASH(seq)		((LbUsFourByte)((seq) * 2654435761U) >> (32 - LBCM_HASH_BITS))
+
+
+/*	LOCAL FUNCTIONS */
+LbUsFourByte	lbCmRead32(LbUsOneByte *buf);
+LbUsFourByte	lbCmLzPack(LbUsOneByte *srcBuf, LbUsFourByte numBytes,
+					LbUsOneByte *dstBuf, LbUsFourByte dstCapacity);
+Boolean			lbCmLzUnpack(LbUsOneByte *srcBuf, LbUsFourByte srcSize,
+					LbUsOneByte *dstBuf, LbUsFourByte numBytes);
+void			lbCmHuffLengths(LbUsFourByte *freqs, LbUsOneByte *codeLengths);
+Boolean			lbCmHuffCodes(LbUsOneByte *codeLengths, LbUsTwoByte *revCodes);
+LbUsFourByte	lbCmHuffSize(LbUsFourByte *freqs, LbUsOneByte *codeLengths);
+void			lbCmHuffPack(LbUsOneByte *srcBuf, LbUsFourByte numBytes,
+					LbUsOneByte *codeLengths, LbUsOneByte *dstBuf);
+Boolean			lbCmHuffUnpack(LbUsOneByte *srcBuf, LbUsFourByte srcSize,
+					LbUsOneByte *dstBuf, LbUsFourByte numBytes);
+
+
+/*	FUNCTIONS */
+
+/*********************************************************************************
+*
+*	Name:			LbCmPackBytes
+*
+*	Summary:		Compress a byte plane with the method that gives the
+*					smallest result.
+*
+*	Arguments:
+*		LbUsOneByte		*srcBuf		- The bytes to compress.
+*		LbUsFourByte	numBytes	- Number of bytes in srcBuf.
+*		LbUsOneByte		*dstBuf		- Receives the packed plane; must hold
+*									  LBCM_PACK_BOUND(numBytes) bytes.
+*
+*	Function return: Number of bytes written to dstBuf.
+*
+*********************************************************************************/
+LbUsFourByte LbCmPackBytes(LbUsOneByte *srcBuf, LbUsFourByte numBytes,
+					LbUsOneByte *dstBuf)
+{
+	LbUsFourByte	freqs[LBCM_NUM_SYMBOLS];		/* Byte frequencies */
+	LbUsOneByte		codeLengths[LBCM_NUM_SYMBOLS];	/* Huffman code lengths */
+	LbUsFourByte	bestSize;						/* Smallest payload so far */
+	LbUsFourByte	huffSize;						/* Huffman payload size */
+	LbUsFourByte	lzSize;							/* LZ payload size */
+	LbUsFourByte	i;								/* Loop index */
+
+
+	/* Check for a constant (or empty) plane */
+	for (i = 1; i < numBytes; i++) {
+		if (srcBuf[i] != srcBuf[0])
+			break;
+	}
+	if ((numBytes > 0) && (i == numBytes)) {
+		dstBuf[0] = LBCM_METHOD_CONST;
+		dstBuf[1] = srcBuf[0];
+		return (2);
+	}
+
+	bestSize = numBytes;
+	huffSize = numBytes;
+	if (numBytes > LBCM_PACK_OVERHEAD) {
+		/* Size the Huffman coding */
+		memset(freqs, 0, sizeof(freqs));
+		for (i = 0; i < numBytes; i++)
+			freqs[srcBuf[i]]++;
+		lbCmHuffLengths(freqs, codeLengths);
+		huffSize = lbCmHuffSize(freqs, codeLengths);
+		if (huffSize < bestSize)
+			bestSize = huffSize;
+
+		/* Try LZ, which only succeeds if it beats the best so far */
+		lzSize = lbCmLzPack(srcBuf, numBytes, dstBuf + LBCM_PACK_OVERHEAD, bestSize - 1);
+		if (lzSize != 0) {
+			dstBuf[0] = LBCM_METHOD_LZ;
+			memcpy(dstBuf + 1, &lzSize, sizeof(LbUsFourByte));
+			return (LBCM_PACK_OVERHEAD + lzSize);
+		}
+	}
+
+	if (huffSize < numBytes) {
+		dstBuf[0] = LBCM_METHOD_HUFFMAN;
+		memcpy(dstBuf + 1, &huffSize, sizeof(LbUsFourByte));
+		lbCmHuffPack(srcBuf, numBytes, codeLengths, dstBuf + LBCM_PACK_OVERHEAD);
+		return (LBCM_PACK_OVERHEAD + huffSize);
+	}
+
+	dstBuf[0] = LBCM_METHOD_RAW;
+	memcpy(dstBuf + 1, srcBuf, numBytes);
+	return (1 + numBytes);
+}
+
+/*********************************************************************************
+*
+*	Name:			LbCmUnpackBytes
+*
+*	Summary:		Decompress a byte plane written by LbCmPackBytes.
+*
+*	Arguments:
+*		LbUsOneByte		*srcBuf		- The packed plane.
+*		LbUsFourByte	srcSize		- Bytes available in srcBuf.
+*		LbUsOneByte		*dstBuf		- Receives the unpacked bytes.
+*		LbUsFourByte	numBytes	- Number of bytes the plane holds.
+*
+*	Function return: Number of bytes of srcBuf consumed, 0 if the data
+*					 is damaged.
+*
+*********************************************************************************/
+LbUsFourByte LbCmUnpackBytes(LbUsOneByte *srcBuf, LbUsFourByte srcSize,
+					LbUsOneByte *dstBuf, LbUsFourByte numBytes)
+{
+	LbUsFourByte	packedSize;		/* Size of LZ or Huffman payload */
+
+
+	if (srcSize < 1)
+		return (0);
+
+	switch (srcBuf[0]) {
+		case LBCM_METHOD_RAW:
+			if ((srcSize - 1) < numBytes)
+				return (0);
+			memcpy(dstBuf, srcBuf + 1, numBytes);
+			return (1 + numBytes);
+
+		case LBCM_METHOD_CONST:
+			if (srcSize < 2)
+				return (0);
+			memset(dstBuf, srcBuf[1], numBytes);
+			return (2);
+
+		case LBCM_METHOD_LZ:
+		case LBCM_METHOD_HUFFMAN:
+			if (srcSize < LBCM_PACK_OVERHEAD)
+				return (0);
+			memcpy(&packedSize, srcBuf + 1, sizeof(LbUsFourByte));
+			if (packedSize > (srcSize - LBCM_PACK_OVERHEAD))
+				return (0);
+
+			if (srcBuf[0] == LBCM_METHOD_LZ) {
+				if (!lbCmLzUnpack(srcBuf + LBCM_PACK_OVERHEAD, packedSize, dstBuf, numBytes))
+					return (0);
+			}
+			else {
+				if (!lbCmHuffUnpack(srcBuf + LBCM_PACK_OVERHEAD, packedSize, dstBuf, numBytes))
+					return (0);
+			}
+			return (LBCM_PACK_OVERHEAD + packedSize);
+
+		default:
+			return (0);
+	}
+}
+
+/*********************************************************************************
+*
+*	Name:			lbCmRead32
+*
+*	Summary:		Read four unaligned bytes as one value.
+*
+*	Arguments:
+*		LbUsOneByte		*buf		- The bytes.
+*
+*	Function return: The value.
+*
+*********************************************************************************/
+LbUsFourByte lbCmRead32(LbUsOneByte *buf)
+{
+	LbUsFourByte	value;		/* The returned value */
+
+
+	memcpy(&value, buf, sizeof(value));
+
+	return (value);
+}
+
+/*********************************************************************************
+*
+*	Name:			lbCmLzPack
+*
+*	Summary:		LZ77 compress a buffer using the LZ4 sequence layout:
+*					a token byte (literal count, match length - 4), extra
+*					length bytes, the literals, a two byte match offset, and
+*					extra match length bytes.  The final sequence holds
+*					literals only.
+*
+*	Arguments:
+*		LbUsOneByte		*srcBuf			- The bytes to compress.
+*		LbUsFourByte	numBytes		- Number of bytes in srcBuf.
+*		LbUsOneByte		*dstBuf			- Receives the compressed bytes.
+*		LbUsFourByte	dstCapacity		- Bytes available in dstBuf.
+*
+*	Function return: Compressed size, 0 if it would exceed dstCapacity.
+*
+*********************************************************************************/
+LbUsFourByte lbCmLzPack(LbUsOneByte *srcBuf, LbUsFourByte numBytes,
+					LbUsOneByte *dstBuf, LbUsFourByte dstCapacity)
+{
+	LbUsFourByte	hashTable[LBCM_HASH_SIZE];	/* Last position of each hashed sequence */
+	LbUsFourByte	srcPos = 0;					/* Current source position */
+	LbUsFourByte	anchor = 0;					/* Start of pending literals */
+	LbUsFourByte	dstPos = 0;					/* Current destination position */
+	LbUsFourByte	matchEnd;					/* Matches must end before here */
+	LbUsFourByte	searchEnd;					/* Matches must start before here */
+	LbUsFourByte	seq;						/* Four bytes at srcPos */
+	LbUsFourByte	hash;						/* Hash of seq */
+	LbUsFourByte	ref;						/* Candidate match position */
+	LbUsFourByte	matchLen;					/* Match length */
+	LbUsFourByte	litLen;						/* Literal count */
+	LbUsFourByte	len;						/* Remaining extra length */
+	LbUsOneByte		*tokenPtr;					/* Token of the current sequence */
+
+
+	if (numBytes >= LBCM_MATCH_LIMIT) {
+		memset(hashTable, 0, sizeof(hashTable));
+		matchEnd = numBytes - LBCM_LAST_LITERALS;
+		searchEnd = numBytes - LBCM_MATCH_LIMIT + 1;
+
+		while (srcPos < searchEnd) {
+			seq = lbCmRead32(srcBuf + srcPos);
+			hash = LBCM_HASH(seq);
+			ref = hashTable[hash];
+			hashTable[hash] = srcPos;
+
+			if ((ref >= srcPos) || ((srcPos - ref) > LBCM_MAX_OFFSET) ||
+					(lbCmRead32(srcBuf + ref) != seq)) {
+
+				/* Step faster through data that does not match */
+				srcPos += 1 + ((srcPos - anchor) >> LBCM_SKIP_SHIFT);
+				continue;
+			}
+
+			/* Extend the match */
+			matchLen = LBCM_MIN_MATCH;
+			while (((srcPos + matchLen) < matchEnd) &&
+					(srcBuf[ref + matchLen] == srcBuf[srcPos + matchLen])) {
+				matchLen++;
+			}
+
+			/* Check for room: token, lengths, literals, offset */
+			litLen = srcPos - anchor;
+			if ((dstPos + 1 + (litLen / 255) + 1 + litLen + 2 +
+					((matchLen - LBCM_MIN_MATCH) / 255) + 1) > dstCapacity) {
+				return (0);
+			}
+
+			/* Write the sequence */
+			tokenPtr = dstBuf + dstPos++;
+			if (litLen >= 15) {
+				*tokenPtr = 15 << 4;
+				for (len = litLen - 15; len >= 255; len -= 255)
+					dstBuf[dstPos++] = 255;
+				dstBuf[dstPos++] = (LbUsOneByte) len;
+			}
+			else {
+				*tokenPtr = (LbUsOneByte) (litLen << 4);
+			}
+			memcpy(dstBuf + dstPos, srcBuf + anchor, litLen);
+			dstPos += litLen;
+			dstBuf[dstPos++] = (LbUsOneByte) ((srcPos - ref) & 0xFF);
+			dstBuf[dstPos++] = (LbUsOneByte) ((srcPos - ref) >> 8);
+			len = matchLen - LBCM_MIN_MATCH;
+			if (len >= 15) {
+				*tokenPtr |= 15;
+				for (len -= 15; len >= 255; len -= 255)
+					dstBuf[dstPos++] = 255;
+				dstBuf[dstPos++] = (LbUsOneByte) len;
+			}
+			else {
+				*tokenPtr |= (LbUsOneByte) len;
+			}
+
+			srcPos += matchLen;
+			anchor = srcPos;
+		}
+	}
+
+	/* Write the final literals */
+	litLen = numBytes - anchor;
+	if ((dstPos + 1 + (litLen / 255) + 1 + litLen) > dstCapacity)
+		return (0);
+	if (litLen >= 15) {
+		dstBuf[dstPos++] = 15 << 4;
+		for (len = litLen - 15; len >= 255; len -= 255)
+			dstBuf[dstPos++] = 255;
+		dstBuf[dstPos++] = (LbUsOneByte) len;
+	}
+	else {
+		dstBuf[dstPos++] = (LbUsOneByte) (litLen << 4);
+	}
+	memcpy(dstBuf + dstPos, srcBuf + anchor, litLen);
+	dstPos += litLen;
+
+	return (dstPos);
+}
+
+/*********************************************************************************
+*
+*	Name:			lbCmLzUnpack
+*
+*	Summary:		Decompress a buffer written by lbCmLzPack.
+*
+*	Arguments:
+*		LbUsOneByte		*srcBuf		- The compressed bytes.
+*		LbUsFourByte	srcSize		- Number of compressed bytes.
+*		LbUsOneByte		*dstBuf		- Receives the decompressed bytes.
+*		LbUsFourByte	numBytes	- Expected decompressed size.
+*
+*	Function return: True unless the data is damaged.
+*
+*********************************************************************************/
+Boolean lbCmLzUnpack(LbUsOneByte *srcBuf, LbUsFourByte srcSize,
+					LbUsOneByte *dstBuf, LbUsFourByte numBytes)
+{
+	LbUsFourByte	srcPos = 0;		/* Current source position */
+	LbUsFourByte	dstPos = 0;		/* Current destination position */
+	LbUsFourByte	token;			/* Sequence token */
+	LbUsFourByte	len;			/* Literal or match length */
+	LbUsFourByte	extra;			/* Extra length byte */
+	LbUsFourByte	offset;			/* Match offset */
+
+
+	while (srcPos < srcSize) {
+		token = srcBuf[srcPos++];
+
+		/* Copy the literals */
+		len = token >> 4;
+		if (len == 15) {
+			do {
+				if ((srcPos >= srcSize) || (len > numBytes))
+					return (false);
+				extra = srcBuf[srcPos++];
+				len += extra;
+			} while (extra == 255);
+		}
+		if ((len > (srcSize - srcPos)) || (len > (numBytes - dstPos)))
+			return (false);
+		memcpy(dstBuf + dstPos, srcBuf + srcPos, len);
+		srcPos += len;
+		dstPos += len;
+
+		/* The last sequence has no match */
+		if (srcPos == srcSize)
+			break;
+
+		/* Copy the match, which may overlap its own output */
+		if ((srcSize - srcPos) < 2)
+			return (false);
+		offset = srcBuf[srcPos] | (srcBuf[srcPos + 1] << 8);
+		srcPos += 2;
+		if ((offset == 0) || (offset > dstPos))
+			return (false);
+		len = token & 15;
+		if (len == 15) {
+			do {
+				if ((srcPos >= srcSize) || (len > numBytes))
+					return (false);
+				extra = srcBuf[srcPos++];
+				len += extra;
+			} while (extra == 255);
+		}
+		len += LBCM_MIN_MATCH;
+		if (len > (numBytes - dstPos))
+			return (false);
+		for (; len > 0; len--) {
+			dstBuf[dstPos] = dstBuf[dstPos - offset];
+			dstPos++;
+		}
+	}
+
+	return (dstPos == numBytes);
+}
+
+/*********************************************************************************
+*
+*	Name:			lbCmHuffLengths
+*
+*	Summary:		Compute Huffman code lengths for the given byte
+*					frequencies, limited to LBCM_MAX_CODE_BITS.
+*
+*	Arguments:
+*		LbUsFourByte	*freqs			- Frequency of each byte value.
+*		LbUsOneByte		*codeLengths	- Receives the code lengths (0 for
+*										  absent bytes).
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void lbCmHuffLengths(LbUsFourByte *freqs, LbUsOneByte *codeLengths)
+{
+	LbUsFourByte	nodeFreqs[2 * LBCM_NUM_SYMBOLS];	/* Leaf then internal node weights */
+	LbUsTwoByte		nodeParents[2 * LBCM_NUM_SYMBOLS];	/* Parent of each node */
+	LbUsTwoByte		nodeDepths[2 * LBCM_NUM_SYMBOLS];	/* Depth of each node */
+	LbUsTwoByte		leafSymbols[LBCM_NUM_SYMBOLS];		/* Symbol of each leaf */
+	LbUsFourByte	numLeaves = 0;						/* Number of present symbols */
+	LbUsFourByte	nextLeaf;							/* Head of the leaf queue */
+	LbUsFourByte	nextNode;							/* Head of the internal node queue */
+	LbUsFourByte	numNodes;							/* Nodes created so far */
+	LbUsFourByte	pick[2];							/* The two lightest nodes */
+	LbUsFourByte	kraftSum;							/* Kraft sum in units of 2^-max */
+	LbUsFourByte	longest;							/* Longest code below the limit */
+	LbUsFourByte	sym;								/* Symbol index */
+	LbUsFourByte	i, j;								/* Loop indices */
+	LbUsTwoByte		tempSym;							/* Insertion sort temporary */
+
+
+	memset(codeLengths, 0, LBCM_NUM_SYMBOLS);
+
+	/* Sort the present symbols by increasing frequency */
+	for (sym = 0; sym < LBCM_NUM_SYMBOLS; sym++) {
+		if (freqs[sym] == 0)
+			continue;
+
+		tempSym = (LbUsTwoByte) sym;
+		for (j = numLeaves; (j > 0) && (freqs[leafSymbols[j-1]] > freqs[tempSym]); j--)
+			leafSymbols[j] = leafSymbols[j-1];
+		leafSymbols[j] = tempSym;
+		numLeaves++;
+	}
+	if (numLeaves == 0)
+		return;
+	if (numLeaves == 1) {
+		codeLengths[leafSymbols[0]] = 1;
+		return;
+	}
+
+	/* Build the tree with two queues:  sorted leaves and internal nodes,
+		which are created in non-decreasing weight order */
+	for (i = 0; i < numLeaves; i++)
+		nodeFreqs[i] = freqs[leafSymbols[i]];
+	nextLeaf = 0;
+	nextNode = numLeaves;
+	numNodes = numLeaves;
+	while (numNodes < (2 * numLeaves - 1)) {
+		for (j = 0; j < 2; j++) {
+			if ((nextLeaf < numLeaves) &&
+					((nextNode >= numNodes) || (nodeFreqs[nextLeaf] <= nodeFreqs[nextNode]))) {
+				pick[j] = nextLeaf++;
+			}
+			else {
+				pick[j] = nextNode++;
+			}
+		}
+		nodeFreqs[numNodes] = nodeFreqs[pick[0]] + nodeFreqs[pick[1]];
+		nodeParents[pick[0]] = (LbUsTwoByte) numNodes;
+		nodeParents[pick[1]] = (LbUsTwoByte) numNodes;
+		numNodes++;
+	}
+
+	/* Parents always follow their children, so depths fill in from the root down */
+	nodeDepths[numNodes - 1] = 0;
+	for (i = numNodes - 1; i > 0; i--)
+		nodeDepths[i - 1] = nodeDepths[nodeParents[i - 1]] + 1;
+
+	/* Clamp to the length limit */
+	kraftSum = 0;
+	for (i = 0; i < numLeaves; i++) {
+		if (nodeDepths[i] > LBCM_MAX_CODE_BITS)
+			nodeDepths[i] = LBCM_MAX_CODE_BITS;
+		codeLengths[leafSymbols[i]] = (LbUsOneByte) nodeDepths[i];
+		kraftSum += 1 << (LBCM_MAX_CODE_BITS - nodeDepths[i]);
+	}
+
+	/* Clamping can oversubscribe the code space; lengthen the rarest of the
+		longest codes still below the limit until it fits */
+	while (kraftSum > LBCM_TABLE_SIZE) {
+		longest = 0;
+		for (i = 0; i < numLeaves; i++) {
+			if ((codeLengths[leafSymbols[i]] < LBCM_MAX_CODE_BITS) &&
+					(codeLengths[leafSymbols[i]] > codeLengths[leafSymbols[longest]] ||
+					codeLengths[leafSymbols[longest]] == LBCM_MAX_CODE_BITS)) {
+				longest = i;
+			}
+		}
+		sym = leafSymbols[longest];
+		kraftSum -= 1 << (LBCM_MAX_CODE_BITS - codeLengths[sym] - 1);
+		codeLengths[sym]++;
+	}
+}
+
+/*********************************************************************************
+*
+*	Name:			lbCmHuffCodes
+*
+*	Summary:		Assign canonical Huffman codes from code lengths.  The
+*					codes are returned bit reversed, ready to be written
+*					least significant bit first.
+*
+*	Arguments:
+*		LbUsOneByte		*codeLengths	- Code length of each byte value.
+*		LbUsTwoByte		*revCodes		- Receives the reversed codes.
+*
+*	Function return: True unless the lengths oversubscribe the code space.
+*
+*********************************************************************************/
+Boolean lbCmHuffCodes(LbUsOneByte *codeLengths, LbUsTwoByte *revCodes)
+{
+	LbUsFourByte	lengthCounts[LBCM_MAX_CODE_BITS + 1];	/* Codes of each length */
+	LbUsFourByte	nextCodes[LBCM_MAX_CODE_BITS + 1];		/* Next code of each length */
+	LbUsFourByte	kraftSum = 0;							/* Used code space */
+	LbUsFourByte	code;									/* Current code */
+	LbUsFourByte	revCode;								/* Reversed code */
+	LbUsFourByte	sym;									/* Symbol index */
+	LbUsFourByte	bits;									/* Bit index */
+
+
+	memset(lengthCounts, 0, sizeof(lengthCounts));
+	for (sym = 0; sym < LBCM_NUM_SYMBOLS; sym++) {
+		if (codeLengths[sym] > LBCM_MAX_CODE_BITS)
+			return (false);
+		if (codeLengths[sym] != 0) {
+			lengthCounts[codeLengths[sym]]++;
+			kraftSum += 1 << (LBCM_MAX_CODE_BITS - codeLengths[sym]);
+		}
+	}
+	if (kraftSum > LBCM_TABLE_SIZE)
+		return (false);
+
+	code = 0;
+	nextCodes[0] = 0;
+	for (bits = 1; bits <= LBCM_MAX_CODE_BITS; bits++) {
+		code = (code + lengthCounts[bits - 1]) << 1;
+		nextCodes[bits] = code;
+	}
+	lengthCounts[0] = 0;
+
+	for (sym = 0; sym < LBCM_NUM_SYMBOLS; sym++) {
+		revCodes[sym] = 0;
+		if (codeLengths[sym] == 0)
+			continue;
+
+		code = nextCodes[codeLengths[sym]]++;
+		revCode = 0;
+		for (bits = 0; bits < codeLengths[sym]; bits++) {
+			revCode = (revCode << 1) | (code & 1);
+			code >>= 1;
+		}
+		revCodes[sym] = (LbUsTwoByte) revCode;
+	}
+
+	return (true);
+}
+
+/*********************************************************************************
+*
+*	Name:			lbCmHuffSize
+*
+*	Summary:		Return the size of a Huffman coded plane:  a bitmap of
+*					the present byte values, their code lengths as nibbles,
+*					and the coded bits.
+*
+*	Arguments:
+*		LbUsFourByte	*freqs			- Frequency of each byte value.
+*		LbUsOneByte		*codeLengths	- Code length of each byte value.
+*
+*	Function return: Size in bytes.
+*
+*********************************************************************************/
+LbUsFourByte lbCmHuffSize(LbUsFourByte *freqs, LbUsOneByte *codeLengths)
+{
+	LbUsEightByte	numBits = 0;	/* Coded bits */
+	LbUsFourByte	numSymbols = 0;	/* Present byte values */
+	LbUsFourByte	sym;			/* Symbol index */
+
+
+	for (sym = 0; sym < LBCM_NUM_SYMBOLS; sym++) {
+		if (codeLengths[sym] != 0) {
+			numSymbols++;
+			numBits += (LbUsEightByte) freqs[sym] * codeLengths[sym];
+		}
+	}
+
+	return (LBCM_BITMAP_SIZE + (numSymbols + 1) / 2 + (LbUsFourByte) ((numBits + 7) / 8));
+}
+
+/*********************************************************************************
+*
+*	Name:			lbCmHuffPack
+*
+*	Summary:		Huffman code a buffer (see lbCmHuffSize for the layout).
+*
+*	Arguments:
+*		LbUsOneByte		*srcBuf			- The bytes to code.
+*		LbUsFourByte	numBytes		- Number of bytes in srcBuf.
+*		LbUsOneByte		*codeLengths	- Code length of each byte value.
+*		LbUsOneByte		*dstBuf			- Receives the coded plane.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void lbCmHuffPack(LbUsOneByte *srcBuf, LbUsFourByte numBytes,
+					LbUsOneByte *codeLengths, LbUsOneByte *dstBuf)
+{
+	LbUsTwoByte		revCodes[LBCM_NUM_SYMBOLS];		/* Reversed canonical codes */
+	LbUsEightByte	bitBuffer = 0;					/* Pending output bits */
+	LbUsFourByte	bitCount = 0;					/* Number of pending bits */
+	LbUsFourByte	dstPos;							/* Destination position */
+	LbUsFourByte	numSymbols = 0;					/* Present byte values */
+	LbUsFourByte	sym;							/* Symbol index */
+	LbUsFourByte	i;								/* Loop index */
+
+
+	lbCmHuffCodes(codeLengths, revCodes);
+
+	/* Write the bitmap and the nibble lengths */
+	memset(dstBuf, 0, LBCM_BITMAP_SIZE);
+	dstPos = LBCM_BITMAP_SIZE;
+	for (sym = 0; sym < LBCM_NUM_SYMBOLS; sym++) {
+		if (codeLengths[sym] == 0)
+			continue;
+
+		dstBuf[sym >> 3] |= (LbUsOneByte) (1 << (sym & 7));
+		if ((numSymbols & 1) == 0)
+			dstBuf[dstPos] = codeLengths[sym];
+		else
+			dstBuf[dstPos++] |= (LbUsOneByte) (codeLengths[sym] << 4);
+		numSymbols++;
+	}
+	if ((numSymbols & 1) != 0)
+		dstPos++;
+
+	/* Write the codes */
+	for (i = 0; i < numBytes; i++) {
+		bitBuffer |= (LbUsEightByte) revCodes[srcBuf[i]] << bitCount;
+		bitCount += codeLengths[srcBuf[i]];
+		while (bitCount >= 8) {
+			dstBuf[dstPos++] = (LbUsOneByte) bitBuffer;
+			bitBuffer >>= 8;
+			bitCount -= 8;
+		}
+	}
+	if (bitCount > 0)
+		dstBuf[dstPos] = (LbUsOneByte) bitBuffer;
+}
+
+/*********************************************************************************
+*
+*	Name:			lbCmHuffUnpack
+*
+*	Summary:		Decode a buffer written by lbCmHuffPack.
+*
+*	Arguments:
+*		LbUsOneByte		*srcBuf		- The coded plane.
+*		LbUsFourByte	srcSize		- Number of coded bytes.
+*		LbUsOneByte		*dstBuf		- Receives the decoded bytes.
+*		LbUsFourByte	numBytes	- Number of bytes to decode.
+*
+*	Function return: True unless the data is damaged.
+*
+*********************************************************************************/
+Boolean lbCmHuffUnpack(LbUsOneByte *srcBuf, LbUsFourByte srcSize,
+					LbUsOneByte *dstBuf, LbUsFourByte numBytes)
+{
+	LbUsOneByte		codeLengths[LBCM_NUM_SYMBOLS];	/* Code length of each byte value */
+	LbUsTwoByte		revCodes[LBCM_NUM_SYMBOLS];		/* Reversed canonical codes */
+	LbUsTwoByte		decodeTable[LBCM_TABLE_SIZE];	/* Symbol and length by next bits */
+	LbUsEightByte	bitBuffer = 0;					/* Pending input bits */
+	LbUsFourByte	bitCount = 0;					/* Number of pending bits */
+	LbUsFourByte	srcPos;							/* Source position */
+	LbUsFourByte	numSymbols = 0;					/* Present byte values */
+	LbUsFourByte	entry;							/* Decode table entry */
+	LbUsFourByte	sym;							/* Symbol index */
+	LbUsFourByte	i;								/* Loop index */
+
+
+	/* Read the bitmap and the nibble lengths */
+	if (srcSize < LBCM_BITMAP_SIZE)
+		return (false);
+	srcPos = LBCM_BITMAP_SIZE;
+	for (sym = 0; sym < LBCM_NUM_SYMBOLS; sym++) {
+		codeLengths[sym] = 0;
+		if ((srcBuf[sym >> 3] & (1 << (sym & 7))) == 0)
+			continue;
+
+		if (srcPos >= srcSize)
+			return (false);
+		if ((numSymbols & 1) == 0)
+			codeLengths[sym] = srcBuf[srcPos] & 0x0F;
+		else
+			codeLengths[sym] = srcBuf[srcPos++] >> 4;
+		if (codeLengths[sym] == 0)
+			return (false);
+		numSymbols++;
+	}
+	if ((numSymbols & 1) != 0)
+		srcPos++;
+	if (!lbCmHuffCodes(codeLengths, revCodes))
+		return (false);
+
+	/* Every bit pattern that starts with a code maps to it; the rest stay 0 */
+	memset(decodeTable, 0, sizeof(decodeTable));
+	for (sym = 0; sym < LBCM_NUM_SYMBOLS; sym++) {
+		if (codeLengths[sym] == 0)
+			continue;
+
+		for (i = revCodes[sym]; i < LBCM_TABLE_SIZE; i += (1 << codeLengths[sym]))
+			decodeTable[i] = (LbUsTwoByte) (sym | (codeLengths[sym] << 8));
+	}
+
+	/* Decode */
+	for (i = 0; i < numBytes; i++) {
+		while ((bitCount <= 56) && (srcPos < srcSize)) {
+			bitBuffer |= (LbUsEightByte) srcBuf[srcPos++] << bitCount;
+			bitCount += 8;
+		}
+		entry = decodeTable[bitBuffer & (LBCM_TABLE_SIZE - 1)];
+		if (((entry >> 8) == 0) || ((entry >> 8) > bitCount))
+			return (false);
+		dstBuf[i] = (LbUsOneByte) entry;
+		bitBuffer >>= (entry >> 8);
+		bitCount -= (entry >> 8);
+	}
+
+	return (true);
+}
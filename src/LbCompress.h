@@ -0,0 +1,79 @@
+/*********************************************************************************
+*																				*
+*                       Source code developed by the							*
+*            Imaging Research Laboratory - University of Washington				*
+*                (C) Copyright 2026 Department of Radiology						*
+*                         University of Washington								*
+*                            All Rights Reserved								*
+*																				*
+*********************************************************************************/
+
+/*********************************************************************************
+*
+*			Module Name:		LbCompress.h
+*			Revision Number:	1.0
+*			Date last revised:	16 October 2026
+*			Programmer:
+*			Date Originated:	16 October 2026
+*
+*			Module Overview:	Declarations for the byte plane compression
+*								library.
+*
+*			References:			None.
+*
+**********************************************************************************
+*
+*			Global functions defined:
+*				LbCmPackBytes
+*				LbCmUnpackBytes
+*
+*			Global variables defined:		none
+*
+**********************************************************************************
+*
+*			Revision Section (Also update version number, if relevant)
+*
+*			Programmer(s):
+*
+*			Revision date:
+*
+*			Revision description:
+*
+*********************************************************************************/
+
+#ifndef LB_COMPRESS
+#define LB_COMPRESS
+
+#include "SystemDependent.h"
+#include "LbTypes.h"
+
+
+/* CONSTANTS */
+#define		LBCM_PACK_OVERHEAD		5		/* Method byte plus packed size */
+
+
+/* MACROS */
+
+/*********************************************************************************
+*
+*			Name:			LBCM_PACK_BOUND
+*
+*			Summary:		Return the largest number of bytes LbCmPackBytes
+*							can produce for the given number of input bytes.
+*
+*			Arguments:
+*				LbUsFourByte	numBytes	- The number of bytes to pack.
+*
+*			Function return: LbUsFourByte.
+*
+*********************************************************************************/
+#define		LBCM_PACK_BOUND(numBytes)	((numBytes) + LBCM_PACK_OVERHEAD)
+
+
+/* PROTOTYPES */
+LbUsFourByte	LbCmPackBytes(LbUsOneByte *srcBuf, LbUsFourByte numBytes,
+					LbUsOneByte *dstBuf);
+LbUsFourByte	LbCmUnpackBytes(LbUsOneByte *srcBuf, LbUsFourByte srcSize,
+					LbUsOneByte *dstBuf, LbUsFourByte numBytes);
+
+#endif /* LB_COMPRESS */
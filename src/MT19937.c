@@ -59,10 +59,9 @@
 #define MIXBITS(u,v) ( ((u) & UMASK) | ((v) & LMASK) )
 #define TWIST(u,v) ((MIXBITS(u,v) >> 1) ^ ((v)&1UL ? MATRIX_A : 0UL))
 
-static unsigned long state[N]; /* the array for the state vector  */
-static int left = 1;
-static int initf = 0;
-static unsigned long *next;
+/* The default state, and the state the generator currently draws from */
+static MTStateTy mtDefaultState = {{0UL}, 1, 0, 0};
+static MTStateTy *mtCur = &mtDefaultState;
 
 static void next_state(void);
 
@@ -71,16 +70,16 @@ static void next_state(void);
 void init_genrand(unsigned long s)
 {
     int j;
-    state[0]= s & 0xffffffffUL;
+    mtCur->state[0]= s & 0xffffffffUL;
     for (j=1; j<N; j++) {
-        state[j] = (1812433253UL * (state[j-1] ^ (state[j-1] >> 30)) + j); 
+        mtCur->state[j] = (1812433253UL * (mtCur->state[j-1] ^ (mtCur->state[j-1] >> 30)) + j); 
         /* See Knuth TAOCP Vol2. 3rd Ed. P.106 for multiplier. */
         /* In the previous versions, MSBs of the seed affect   */
         /* only MSBs of the array state[].                        */
         /* 2002/01/09 modified by Makoto Matsumoto             */
-        state[j] &= 0xffffffffUL;  /* for >32 bit machines */
+        mtCur->state[j] &= 0xffffffffUL;  /* for >32 bit machines */
     }
-    left = 1; initf = 1;
+    mtCur->left = 1; mtCur->initf = 1;
 }
 
 /* initialize by an array with array-length */
@@ -94,36 +93,36 @@ void init_by_array(unsigned long init_key[], int key_length)
     i=1; j=0;
     k = (N>key_length ? N : key_length);
     for (; k; k--) {
-        state[i] = (state[i] ^ ((state[i-1] ^ (state[i-1] >> 30)) * 1664525UL))
+        mtCur->state[i] = (mtCur->state[i] ^ ((mtCur->state[i-1] ^ (mtCur->state[i-1] >> 30)) * 1664525UL))
           + init_key[j] + j; /* non linear */
-        state[i] &= 0xffffffffUL; /* for WORDSIZE > 32 machines */
+        mtCur->state[i] &= 0xffffffffUL; /* for WORDSIZE > 32 machines */
         i++; j++;
-        if (i>=N) { state[0] = state[N-1]; i=1; }
+        if (i>=N) { mtCur->state[0] = mtCur->state[N-1]; i=1; }
         if (j>=key_length) j=0;
     }
     for (k=N-1; k; k--) {
-        state[i] = (state[i] ^ ((state[i-1] ^ (state[i-1] >> 30)) * 1566083941UL))
+        mtCur->state[i] = (mtCur->state[i] ^ ((mtCur->state[i-1] ^ (mtCur->state[i-1] >> 30)) * 1566083941UL))
           - i; /* non linear */
-        state[i] &= 0xffffffffUL; /* for WORDSIZE > 32 machines */
+        mtCur->state[i] &= 0xffffffffUL; /* for WORDSIZE > 32 machines */
         i++;
-        if (i>=N) { state[0] = state[N-1]; i=1; }
+        if (i>=N) { mtCur->state[0] = mtCur->state[N-1]; i=1; }
     }
 
-    state[0] = 0x80000000UL; /* MSB is 1; assuring non-zero initial array */ 
-    left = 1; initf = 1;
+    mtCur->state[0] = 0x80000000UL; /* MSB is 1; assuring non-zero initial array */ 
+    mtCur->left = 1; mtCur->initf = 1;
 }
 
 static void next_state(void)
 {
-    unsigned long *p=state;
+    unsigned long *p=mtCur->state;
     int j;
 
     /* if init_genrand() has not been called, */
     /* a default initial seed is used         */
-    if (initf==0) init_genrand(5489UL);
+    if (mtCur->initf==0) init_genrand(5489UL);
 
-    left = N;
-    next = state;
+    mtCur->left = N;
+    mtCur->next = mtCur->state;
     
     for (j=N-M+1; --j; p++) 
         *p = p[M] ^ TWIST(p[0], p[1]);
@@ -131,7 +130,7 @@ static void next_state(void)
     for (j=M; --j; p++) 
         *p = p[M-N] ^ TWIST(p[0], p[1]);
 
-    *p = p[M-N] ^ TWIST(p[0], state[0]);
+    *p = p[M-N] ^ TWIST(p[0], mtCur->state[0]);
 }
 
 /* generates a random number on [0,0xffffffff]-interval */
@@ -139,8 +138,8 @@ unsigned long genrand_int32(void)
 {
     unsigned long y;
 
-    if (--left == 0) next_state();
-    y = *next++;
+    if (--mtCur->left == 0) next_state();
+    y = *mtCur->next++;
 
     /* Tempering */
     y ^= (y >> 11);
@@ -156,8 +155,8 @@ long genrand_int31(void)
 {
     unsigned long y;
 
-    if (--left == 0) next_state();
-    y = *next++;
+    if (--mtCur->left == 0) next_state();
+    y = *mtCur->next++;
 
     /* Tempering */
     y ^= (y >> 11);
@@ -173,8 +172,8 @@ double genrand_real1(void)
 {
     unsigned long y;
 
-    if (--left == 0) next_state();
-    y = *next++;
+    if (--mtCur->left == 0) next_state();
+    y = *mtCur->next++;
 
     /* Tempering */
     y ^= (y >> 11);
@@ -191,8 +190,8 @@ double genrand_real2(void)
 {
     unsigned long y;
 
-    if (--left == 0) next_state();
-    y = *next++;
+    if (--mtCur->left == 0) next_state();
+    y = *mtCur->next++;
 
     /* Tempering */
     y ^= (y >> 11);
@@ -209,8 +208,8 @@ double genrand_real3(void)
 {
     unsigned long y;
 
-    if (--left == 0) next_state();
-    y = *next++;
+    if (--mtCur->left == 0) next_state();
+    y = *mtCur->next++;
 
     /* Tempering */
     y ^= (y >> 11);
@@ -256,9 +255,27 @@ int main(void)
 */
 
 
-/* The following two functions are UW functions for restoring and saving the current 
+/* The following are UW functions for selecting, restoring and saving the current 
 	state of the RNG */
 
+/*********************************************************************************
+*
+*		Name:		MTSelectState
+*
+*		Summary:	Select the state vector that the generator draws from.
+*
+*		Arguments:
+*				MTStateTy	*statePtr	- The state, or zero for the default state.
+*		
+*		Function return: None.
+*
+*********************************************************************************/
+void MTSelectState(MTStateTy *statePtr)
+{
+	mtCur = ((statePtr != 0) ? statePtr : &mtDefaultState);
+}
+
+
 /*********************************************************************************
 *
 *		Name:		MTReadState
@@ -284,22 +301,22 @@ Boolean MTReadState(FILE *phgMathRandSeedFile)
 	do {
 		/* Read in the state values */
 		/* NOTE:  File must already be open */
-		if ((numRead = fread((void *)&left,
-				sizeof(left), 1, phgMathRandSeedFile)) != 1) {
+		if ((numRead = fread((void *)&mtCur->left,
+				sizeof(mtCur->left), 1, phgMathRandSeedFile)) != 1) {
 			LbInPrintf("Unable to read MT random seed value 'left'");
 			result = false;
 			break;
 		}
-		if ((numRead = fread((void *)state,
-				sizeof(state[1]), N, phgMathRandSeedFile)) != N) {
+		if ((numRead = fread((void *)mtCur->state,
+				sizeof(mtCur->state[1]), N, phgMathRandSeedFile)) != N) {
 			LbInPrintf("Unable to read MT random seed value 'state'");
 			result = false;
 			break;
 		}
 		
 		/* Set the remaining values */
-		next = state + (N - left + 1);
-		initf = 1;
+		mtCur->next = mtCur->state + (N - mtCur->left + 1);
+		mtCur->initf = 1;
 	} while (false);
 #else
 	/* Eliminate compiler warning for unused parameter */
@@ -334,14 +351,14 @@ Boolean MTWriteState(FILE *phgMathRandSeedFile)
 	do {
 		/* Write out the state values */
 		/* NOTE:  File must already be open */
-		if ((numWritten = fwrite((void *)&left,
-				sizeof(left), 1, phgMathRandSeedFile)) != 1) {
+		if ((numWritten = fwrite((void *)&mtCur->left,
+				sizeof(mtCur->left), 1, phgMathRandSeedFile)) != 1) {
 			LbInPrintf("Unable to write MT random seed value 'left'");
 			result = false;
 			break;
 		}
-		if ((numWritten = fwrite((void *)state,
-				sizeof(state[1]), N, phgMathRandSeedFile)) != N) {
+		if ((numWritten = fwrite((void *)mtCur->state,
+				sizeof(mtCur->state[1]), N, phgMathRandSeedFile)) != N) {
 			LbInPrintf("Unable to write MT random seed value 'state'");
 			result = false;
 			break;
@@ -54,6 +54,16 @@
 #include "LbInterface.h"
 
 
+/* UW type holding the complete state of one generator, so that several
+	independent streams may be kept and switched between */
+typedef struct {
+	unsigned long	state[624];		/* the array for the state vector */
+	int				left;			/* values left before the next twist */
+	int				initf;			/* has the state been initialized? */
+	unsigned long	*next;			/* next value to temper */
+} MTStateTy;
+
+
 /* initializes state[N] with a seed */
 void init_genrand(unsigned long s);
 
@@ -89,4 +99,9 @@ double genrand_res53(void);
 Boolean MTReadState(FILE *phgMathRandSeedFile);
 Boolean MTWriteState(FILE *phgMathRandSeedFile);
 
+/* UW function selecting the state used by all of the above; zero selects the
+	default state.  A newly selected state must be initialized with
+	init_genrand or init_by_array before use */
+void MTSelectState(MTStateTy *statePtr);
+
 #endif /* MT19937_RNG */
@@ -118,6 +118,7 @@
 #include "phg.h"
 #include "PhgUsrBin.h"
 #include "PhgBin.h"
+#include "PhgParallel.h"
 
 
 /* Local Prototypes */
@@ -126,6 +127,16 @@ void	phgBinIncrementPETImage(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData,
 			LbUsFourByte imageIndex, PHG_Decay *decay,
 			PHG_TrackingPhoton *bluePhoton, PHG_TrackingPhoton *pinkPhoton,
 			double coincidenceWeight, double coincidenceSquWeight);
+void	phgBinPETPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData,
+			PHG_BinFieldsTy *binFields, PHG_Decay *decay,
+			PHG_TrackingPhoton *bluePhotons, PHG_DetectedPhoton *detectedBluePhotons,
+			LbUsFourByte numBluePhotons,
+			PHG_TrackingPhoton *pinkPhotons, PHG_DetectedPhoton *detectedPinkPhotons,
+			LbUsFourByte numPinkPhotons);
+void	phgBinSPECTPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData,
+			PHG_BinFieldsTy *binFields, PHG_Decay *decay,
+			PHG_TrackingPhoton *photons, PHG_DetectedPhoton *detectedPhotons,
+			LbUsFourByte numPhotons);
 
 /* Global variables */
 static	char	phgBinErrStr[1024];			/* Storage for creating error strings */
@@ -1277,6 +1288,32 @@ Boolean PhgBinInitialize(char *paramsName, PHG_BinParamsTy *binParams, PHG_BinDa
 			(*BinUsrInitializeFPtr)(binParams, binData);
 		}
 		
+		/* Register the images and counters with the worker processes */
+		if (binParams->doCounts == true) {
+			PhgParRegisterSum(binData->countImage,
+				((binParams->count_image_type == PHG_BIN_COUNT_TYPE_I1) ? PhgParEn_OneByte :
+				((binParams->count_image_type == PHG_BIN_COUNT_TYPE_I2) ? PhgParEn_TwoByte :
+				PhgParEn_FourByte)), binParams->numImageBins);
+		}
+		if (binParams->doWeights == true) {
+			PhgParRegisterSum(binData->weightImage,
+				(((binParams->sumAccordingToType == true) && (binParams->weight_image_type == PHG_BIN_WEIGHT_TYPE_R4))
+					? PhgParEn_Float : PhgParEn_Double), binParams->numImageBins);
+		}
+		if (binParams->doWeightsSquared == true) {
+			PhgParRegisterSum(binData->weightSquImage,
+				(((binParams->sumAccordingToType == true) && (binParams->weight_image_type == PHG_BIN_WEIGHT_TYPE_R4))
+					? PhgParEn_Float : PhgParEn_Double), binParams->numImageBins);
+		}
+		PhgParRegisterSum(&binFields->NumCoincidences, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&binFields->NumAcceptedCoincidences, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&binFields->TotBluePhotons, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&binFields->TotPinkPhotons, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&binFields->AccBluePhotons, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&binFields->AccPinkPhotons, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&binFields->AccCoincidenceWeight, PhgParEn_Double, 1);
+		PhgParRegisterSum(&binFields->AccCoincidenceSquWeight, PhgParEn_Double, 1);
+		
 		binFields->IsInitialized = true;
 		FAIL:;
 	} while (false);
@@ -1833,8 +1870,17 @@ Boolean PhgBinOpenImage(PHG_BinParamsTy *binParams, PHG_BinFieldsTy *binFields,
 		}
 		else  {
 		
-			/* Just create/open the file */
-			if ((*imageFile = LbFlFileOpen(imageName, "wb")) == 0) {
+			/* Just create/open the file; distributed ranks other than the root never
+				write their images, so they use an unnamed temporary file rather than
+				race the root (and each other) for the real one
+			*/
+			if (PHGPAR_IsRoot()) {
+				*imageFile = LbFlFileOpen(imageName, "wb");
+			}
+			else {
+				*imageFile = tmpfile();
+			}
+			if (*imageFile == 0) {
 				ErStFileError("Unable to create/open image file");
 				break;
 			}
@@ -1898,6 +1944,68 @@ void PhgBinPETPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_Bi
 		PHG_Decay *decay,
 		PHG_TrackingPhoton *bluePhotons, LbUsFourByte numBluePhotons,
 		PHG_TrackingPhoton *pinkPhotons, LbUsFourByte numPinkPhotons)
+{
+	phgBinPETPhotons(binParams, binData, binFields, decay,
+		bluePhotons, 0, numBluePhotons, pinkPhotons, 0, numPinkPhotons);
+}
+
+/*********************************************************************************
+*
+*			Name:			PhgBinPETDetectedPhotons
+*
+*			Summary:		Update the binning images with the photons of a decay
+*							read from a history file.  Each photon is made into a
+*							tracking photon only as it is binned.
+*
+*			Arguments:
+*				PHG_BinParamsTy		*binParams		- User defined binning parameters.
+*				PHG_BiDataTy		*binData	 	- Storage for binned data.
+*				PHG_BinFieldsTy *binFields			 - Various binning information.
+*				PHG_Decay			decay			- The decay that started the process.
+*				PHG_DetectedPhoton *bluePhotons		- The blue photons detected.
+*				LbUsFourByte 		numBluePhotons	- The number of blue photons.
+*				PHG_DetectedPhoton *pinkPhotons		- The  pink photons detected.
+*				LbUsFourByte		numPinkPhotons	- The number of pink photons.
+*			Function return: None.
+*
+*********************************************************************************/
+void PhgBinPETDetectedPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData,
+		PHG_BinFieldsTy *binFields, PHG_Decay *decay,
+		PHG_DetectedPhoton *bluePhotons, LbUsFourByte numBluePhotons,
+		PHG_DetectedPhoton *pinkPhotons, LbUsFourByte numPinkPhotons)
+{
+	phgBinPETPhotons(binParams, binData, binFields, decay,
+		0, bluePhotons, numBluePhotons, 0, pinkPhotons, numPinkPhotons);
+}
+
+/*********************************************************************************
+*
+*			Name:			phgBinPETPhotons
+*
+*			Summary:		Update the binning images with the current batch of
+*							detected photons, given either as tracking photons or
+*							as photons read from a history file.
+*
+*			Arguments:
+*				PHG_BinParamsTy		*binParams		- User defined binning parameters.
+*				PHG_BiDataTy		*binData	 	- Storage for binned data.
+*				PHG_BinFieldsTy *binFields			 - Various binning information.
+*				PHG_Decay			decay			- The decay that started the process.
+*				PHG_TrackingPhoton *bluePhotons		- The blue photons detected, or 0.
+*				PHG_DetectedPhoton *detectedBluePhotons	- Or the blue photons read.
+*				LbUsFourByte 		numBluePhotons	- The number of blue photons.
+*				PHG_TrackingPhoton *pinkPhotons		- The  pink photons detected, or 0.
+*				PHG_DetectedPhoton *detectedPinkPhotons	- Or the pink photons read.
+*				LbUsFourByte		numPinkPhotons	- The number of pink photons.
+*			Function return: None.
+*
+*********************************************************************************/
+void phgBinPETPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_BinFieldsTy *binFields,
+		PHG_Decay *decay,
+		PHG_TrackingPhoton *bluePhotons, PHG_DetectedPhoton *detectedBluePhotons,
+		LbUsFourByte numBluePhotons,
+		PHG_TrackingPhoton *pinkPhotons, PHG_DetectedPhoton *detectedPinkPhotons,
+		LbUsFourByte numPinkPhotons)
 {
 	double				distance = 0;				/* Computed transaxial distance */
 	double				angle = 0;					/* Computed azimuthal angle */
@@ -1944,6 +2052,7 @@ void PhgBinPETPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_Bi
 	double				flip;						/* For 3DRP */
 	PHG_TrackingPhoton	bluePhoton;				/* Current blue photon */	
 	PHG_TrackingPhoton	pinkPhoton;				/* Current pink photon */	
+	PHG_TrackingPhoton	blueSource;				/* Blue photon made from a detected photon */
 
 	/* Compute statistics */
 	binFields->NumCoincidences += (numBluePhotons * numPinkPhotons);
@@ -1968,12 +2077,22 @@ void PhgBinPETPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_Bi
 	/* Process coincidences */
 	for (blueIndex = 0; blueIndex < numBluePhotons; blueIndex++) {
 			
+		/* Photons read from a history file are converted as they are binned */
+		if (detectedBluePhotons != 0) {
+			PhgBinTrackingPhoton(decay, &detectedBluePhotons[blueIndex], &blueSource);
+		}
 
 		for (pinkIndex = 0; pinkIndex < numPinkPhotons; pinkIndex++) {
 			
 			/* Init local blue/pink photon copies */
-			bluePhoton = bluePhotons[blueIndex];
-			pinkPhoton = pinkPhotons[pinkIndex];
+			if (detectedBluePhotons != 0) {
+				bluePhoton = blueSource;
+				PhgBinTrackingPhoton(decay, &detectedPinkPhotons[pinkIndex], &pinkPhoton);
+			}
+			else {
+				bluePhoton = bluePhotons[blueIndex];
+				pinkPhoton = pinkPhotons[pinkIndex];
+			}
 			
 			/* Let user modify and/or reject photons */
 			if (BinUsrModPETPhotonsFPtr && 
@@ -2974,6 +3093,57 @@ void phgBinIncrementPETImage(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData,
 void PhgBinSPECTPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_BinFieldsTy *binFields,
 		PHG_Decay *decay,
 		PHG_TrackingPhoton *photons, LbUsFourByte numPhotons)
+{
+	phgBinSPECTPhotons(binParams, binData, binFields, decay, photons, 0, numPhotons);
+}
+
+/*********************************************************************************
+*
+*			Name:			PhgBinSPECTDetectedPhotons
+*
+*			Summary:		Update the binning images with the photons of a decay
+*							read from a history file.  Each photon is made into a
+*							tracking photon only as it is binned.
+*
+*			Arguments:
+*				PHG_BinParamsTy		*binParams		- User defined binning parameters.
+*				PHG_BiDataTy		*binData		- Storage for binned data.
+*				PHG_BinFieldsTy 	*binFields		- Various binning information.
+*				PHG_Decay			decay			- The decay that started the process.
+*				PHG_DetectedPhoton *photons			- The photons detected.
+*				LbUsFourByte 		numPhotons		- The number of photons.
+*			Function return: None.
+*
+*********************************************************************************/
+void PhgBinSPECTDetectedPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData,
+		PHG_BinFieldsTy *binFields, PHG_Decay *decay,
+		PHG_DetectedPhoton *photons, LbUsFourByte numPhotons)
+{
+	phgBinSPECTPhotons(binParams, binData, binFields, decay, 0, photons, numPhotons);
+}
+
+/*********************************************************************************
+*
+*			Name:			phgBinSPECTPhotons
+*
+*			Summary:		Update the binning images with the current batch of
+*							detected photons, given either as tracking photons or
+*							as photons read from a history file.
+*
+*			Arguments:
+*				PHG_BinParamsTy		*binParams		- User defined binning parameters.
+*				PHG_BiDataTy		*binData		- Storage for binned data.
+*				PHG_BinFieldsTy 	*binFields		- Various binning information.
+*				PHG_Decay			decay			- The decay that started the process.
+*				PHG_TrackingPhoton *photons			- The photons detected, or 0.
+*				PHG_DetectedPhoton *detectedPhotons	- Or the photons read.
+*				LbUsFourByte 		numPhotons		- The number of photons.
+*			Function return: None.
+*
+*********************************************************************************/
+void phgBinSPECTPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_BinFieldsTy *binFields,
+		PHG_Decay *decay,
+		PHG_TrackingPhoton *photons, PHG_DetectedPhoton *detectedPhotons, LbUsFourByte numPhotons)
 {
 	double			distance;			/* */
 	double			angle;				/* */
@@ -2988,6 +3158,8 @@ void PhgBinSPECTPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_
 	LbUsFourByte	crystalIndex = 0;	/* Index for crystal bin */
 	LbUsFourByte	zIndex = 0;			/* Index for z bin */
 	LbUsFourByte	imageIndex;			/* Index for image */
+	PHG_TrackingPhoton	*photonPtr;		/* Current photon */
+	PHG_TrackingPhoton	photon;			/* Current photon, made from a detected photon */
 	
 		
 	/* Compute statistics */
@@ -2996,17 +3168,26 @@ void PhgBinSPECTPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_
 	/* Process coincidences */
 	for (index = 0; index < numPhotons; index++) {
 		
+		/* Photons read from a history file are converted as they are binned */
+		if (detectedPhotons != 0) {
+			PhgBinTrackingPhoton(decay, &detectedPhotons[index], &photon);
+			photonPtr = &photon;
+		}
+		else {
+			photonPtr = &photons[index];
+		}
+		
 		/* Call the user binning routine and continue with next photon if rejected */
 		if (BinUsrModSPECTPhotonsFPtr && 
 				(*BinUsrModSPECTPhotonsFPtr)(binParams, binData, decay,
-					&(photons[index])) == false) {
+					photonPtr) == false) {
 			
 			continue;
 		}
 		
 		/* Get scatter count */
-		scatters = photons[index].num_of_scatters +
-			photons[index].scatters_in_col;
+		scatters = photonPtr->num_of_scatters +
+			photonPtr->scatters_in_col;
 		
 		/* See if this photon fails criteria */
 		{
@@ -3021,23 +3202,23 @@ void PhgBinSPECTPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_
 					(binParams->scatterRandomParam != 3))
 				continue;
 				
-			if ((binParams->numE1Bins > 0) && (photons[index].energy < binParams->minE))
+			if ((binParams->numE1Bins > 0) && (photonPtr->energy < binParams->minE))
 				continue;
 	
-			if ((binParams->numE1Bins > 0) && (photons[index].energy > binParams->maxE))
+			if ((binParams->numE1Bins > 0) && (photonPtr->energy > binParams->maxE))
 				continue;
 	
-			if ((binParams->numZBins > 0) && (photons[index].location.z_position <
+			if ((binParams->numZBins > 0) && (photonPtr->location.z_position <
 					binParams->minZ))
 				continue;
 	
-			if ((binParams->numZBins > 0) && (photons[index].location.z_position >
+			if ((binParams->numZBins > 0) && (photonPtr->location.z_position >
 					binParams->maxZ))
 				continue;
 		}
 
 		/* Compute distance angle */  			
-		PhgBinCompSpectDA(&(photons[index]),
+		PhgBinCompSpectDA(photonPtr,
 			&angle, &distance);
 		
 		/* See if outside distance range */
@@ -3130,7 +3311,7 @@ void PhgBinSPECTPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_
 		
 		/* Compute energy 1 index */
 		if ((binParams->eRange != 0) && (binParams->numE1Bins > 1)) {
-			energyIndex = (LbUsFourByte) (((photons[index].energy - binParams->minE) *
+			energyIndex = (LbUsFourByte) (((photonPtr->energy - binParams->minE) *
 					 binParams->numE1Bins) / binParams->eRange);
 						
 				/* Check Boundary */
@@ -3146,25 +3327,25 @@ void PhgBinSPECTPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_
 			
 			/* if debug is set, check to make sure that the crystal number is in range */
 			#ifdef PHG_DEBUG
-				if (photons[index].detCrystal < 0) {
+				if (photonPtr->detCrystal < 0) {
 					PhgAbort("Invalid computation of crystal index (1) (PhgBinPETPhotons)", true);
 				}
 			#endif
 					
 			#ifdef PHG_DEBUG
-				if (photons[index].detCrystal >= (LbFourByte)(binParams->numCrystalBins)) {
+				if (photonPtr->detCrystal >= (LbFourByte)(binParams->numCrystalBins)) {
 					PhgAbort("Invalid computation of crystal index (2) (PhgBinPETPhotons)", true);
 				}
 			#endif
 					
 			/* Assign index */
-			crystalIndex = photons[index].detCrystal;
+			crystalIndex = photonPtr->detCrystal;
 
 		}
 			
 		/* Compute z index */
 		if ((binParams->zRange != 0) && (binParams->numZBins > 1)) {
-			zIndex = (LbUsFourByte) floor(((photons[index].location.z_position - binParams->minZ) *
+			zIndex = (LbUsFourByte) floor(((photonPtr->location.z_position - binParams->minZ) *
 					 binParams->numZBins) / binParams->zRange);
 						
 				/* Check Boundary */
@@ -3186,7 +3367,7 @@ void PhgBinSPECTPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_
 		/* Call the user binning routine and continue with next photon if rejected */
 		if (BinUsrModSPECTPhotonsF2Ptr && 
 				(*BinUsrModSPECTPhotonsF2Ptr)(binParams, binData, decay,
-					&(photons[index]),
+					photonPtr,
 					&angleIndex,
 					&distIndex,
 					&scatterIndex,
@@ -3203,7 +3384,7 @@ void PhgBinSPECTPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_
 
 			/* Write the photons */
 			if (PhoHFileWriteDetections(&binFields->historyFileHk, decay,
-					&photons[index],
+					photonPtr,
 					1,
 					0,
 					0) == false) {
@@ -3281,7 +3462,7 @@ void PhgBinSPECTPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_
 		
 		/* Compute the weight variables */
 		detectionWeight = (decay->startWeight * 
-			photons[index].photon_current_weight) * binFields->WeightRatio;
+			photonPtr->photon_current_weight) * binFields->WeightRatio;
 		
 		/* Compute the adjusted detection weight squared */			
 		detectionSquWeight = PHGMATH_Square(detectionWeight);
@@ -3328,6 +3509,98 @@ void PhgBinSPECTPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_
 	}
 }
 
+/*********************************************************************************
+*
+*			Name:			PhgBinTrackingPhoton
+*
+*			Summary:		Make a tracking photon from a photon read from a
+*							standard history file.
+*
+*			Arguments:
+*				PHG_Decay			*decayPtr		- The photon's decay.
+*				PHG_DetectedPhoton	*detectedPhoton	- The photon read.
+*				PHG_TrackingPhoton	*trackingPhoton	- The tracking photon made.
+*			Function return: None.
+*
+*********************************************************************************/
+void PhgBinTrackingPhoton(PHG_Decay *decayPtr, PHG_DetectedPhoton *detectedPhoton,
+			PHG_TrackingPhoton *trackingPhoton)
+{
+	double 				angle_norm;					/* for normalizing photon direction */
+	
+	/* initialize fields not stored in standard history file */
+	trackingPhoton->sliceIndex = 0;
+	trackingPhoton->angleIndex =  -1;
+	trackingPhoton->origSliceIndex = -1;
+	trackingPhoton->origAngleIndex = -1;
+	trackingPhoton->xIndex = -1;
+	trackingPhoton->yIndex = -1;
+	trackingPhoton->scatters_in_col = 0; /* We don't know this value--user must
+											create a custom history file if they
+											want it, otherwise these scatters are
+											folded into the num_of_scatters field below  */
+	trackingPhoton->scatter_target_weight  = 0;
+	trackingPhoton->num_det_interactions = 0;
+	trackingPhoton->det_interactions = 0;
+	
+	/* copy decay weight from decay */
+	trackingPhoton->decay_weight = decayPtr->startWeight;
+	
+	/* the rest of the tracking photon is copied from detectedPhoton */
+	{
+		
+		/* Flags are currently stored in first two bytes, with upper bits
+			representing number of scatters
+		*/
+		trackingPhoton->flags = (detectedPhoton->flags & 3);
+		trackingPhoton->num_of_scatters =
+			(detectedPhoton->flags >> 2);
+		
+		trackingPhoton->location.x_position = detectedPhoton->location.x_position;
+		trackingPhoton->location.y_position = detectedPhoton->location.y_position;
+		trackingPhoton->location.z_position = detectedPhoton->location.z_position;
+		trackingPhoton->angle.cosine_x = detectedPhoton->angle.cosine_x;
+		trackingPhoton->angle.cosine_y = detectedPhoton->angle.cosine_y;
+		trackingPhoton->angle.cosine_z = detectedPhoton->angle.cosine_z;
+		
+		{
+			/* normalize photon direction - it is written out as float but needs to be
+				double precision unit length for som,e functions */
+			angle_norm = sqrt(	(double)detectedPhoton->angle.cosine_x * (double)detectedPhoton->angle.cosine_x +
+								(double)detectedPhoton->angle.cosine_y * (double)detectedPhoton->angle.cosine_y +
+								(double)detectedPhoton->angle.cosine_z * (double)detectedPhoton->angle.cosine_z );
+			trackingPhoton->angle.cosine_x = (double)detectedPhoton->angle.cosine_x / angle_norm;
+			trackingPhoton->angle.cosine_y = (double)detectedPhoton->angle.cosine_y / angle_norm;
+			trackingPhoton->angle.cosine_z = (double)detectedPhoton->angle.cosine_z / angle_norm;
+		}
+		
+		trackingPhoton->transaxialPosition = detectedPhoton->transaxialPosition;
+		trackingPhoton->azimuthalAngleIndex = detectedPhoton->azimuthalAngleIndex;
+		trackingPhoton->detectorAngle = detectedPhoton->detectorAngle;
+		trackingPhoton->detCrystal = detectedPhoton->detCrystal;
+		if (trackingPhoton->num_of_scatters == 0){
+			trackingPhoton->photon_scatter_weight = 0;
+			trackingPhoton->photon_primary_weight =
+				detectedPhoton->photon_weight;
+			trackingPhoton->photon_current_weight =
+				detectedPhoton->photon_weight;
+		}
+		else {
+			trackingPhoton->photon_scatter_weight =
+				detectedPhoton->photon_weight;
+			trackingPhoton->photon_current_weight =
+				detectedPhoton->photon_weight;
+			trackingPhoton->photon_primary_weight = 0;
+		}
+		trackingPhoton->energy = detectedPhoton->energy;
+		trackingPhoton->travel_distance  =
+			detectedPhoton->time_since_creation * PHGMATH_SPEED_OF_LIGHT;
+		trackingPhoton->numStarts = 0;
+		trackingPhoton->number = (LbUsEightByte) -1;
+		
+	}
+}
+
 /*********************************************************************************
 *
 *			Name:			PhgBinCompSpectDA
@@ -3666,7 +3939,14 @@ void PhgBinTerminate(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_Bin
 		if (BinUsrTerminateFPtr) {
 			(*BinUsrTerminateFPtr)(binParams, binData);
 		}
-		
+
+		/* Write out the buffered history records */
+		if (binParams->isHistoryFile) {
+			if (PhoHFileEndWrites(&binFields->historyFileHk) == false) {
+				break;
+			}
+		}
+
 		/* Process the count image */
 		if (binParams->doCounts == true) {
 		
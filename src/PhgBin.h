@@ -95,9 +95,18 @@ void		PhgBinPETPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_B
 					PHG_Decay *decay,
 					PHG_TrackingPhoton *bluePhotons, LbUsFourByte numBluePhotons,
 					PHG_TrackingPhoton *pinkPhotons, LbUsFourByte numPinkPhotons);
+void		PhgBinPETDetectedPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData,
+					PHG_BinFieldsTy *binFields, PHG_Decay *decay,
+					PHG_DetectedPhoton *bluePhotons, LbUsFourByte numBluePhotons,
+					PHG_DetectedPhoton *pinkPhotons, LbUsFourByte numPinkPhotons);
 void		PhgBinSPECTPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_BinFieldsTy *binFields,
 					PHG_Decay *decay,
 					PHG_TrackingPhoton *photons, LbUsFourByte numPhotons);
+void		PhgBinSPECTDetectedPhotons(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData,
+					PHG_BinFieldsTy *binFields, PHG_Decay *decay,
+					PHG_DetectedPhoton *photons, LbUsFourByte numPhotons);
+void		PhgBinTrackingPhoton(PHG_Decay *decayPtr, PHG_DetectedPhoton *detectedPhoton,
+					PHG_TrackingPhoton *trackingPhoton);
 void		PhgBinTerminate(PHG_BinParamsTy *binParams, PHG_BinDataTy *binData, PHG_BinFieldsTy *binFields);
 Boolean		PhgBinOpenImage(PHG_BinParamsTy *binParams, PHG_BinFieldsTy *binFields,
 				PhoHFileHdrKindTy hdrKind, char *imageName,
@@ -1046,6 +1046,10 @@ LbFourByte PhgHdrGtFieldSize(LbUsFourByte fieldID)
 			fieldSize = sizeof(params.H.isRandomsAdded);
 			break;
 
+		case HDR_HISTORY_FILE_IS_COMPRESSED_ID:
+			fieldSize = sizeof(params.H.isCompressed);
+			break;
+
 		default:
 			fieldSize = -1;
 			break;
@@ -3515,6 +3519,17 @@ Boolean PhgHdrGtParams(FILE *headerFile, PhoHFileHdrTy *paramsPtr, LbHdrHkTy *he
 				ErClearIf(ERMgCdHeader, ERErCdHdElemNotFound, &cleared);
 			}
 			
+			/* Get the compressed indicator  */
+			if (LbHdrGtElem(headerHk, HDR_HISTORY_FILE_IS_COMPRESSED_ID,
+					sizeof(paramsPtr->H.isCompressed),
+					(void *)&paramsPtr->H.isCompressed) == false){
+				
+				paramsPtr->H.isCompressed = false;	/* Written only when true */
+
+				/* Clear the error */
+				ErClearIf(ERMgCdHeader, ERErCdHdElemNotFound, &cleared);
+			}
+			
 		} while (false);
 		okay = true;
 		FAIL:;
@@ -3563,6 +3578,7 @@ Boolean PhgHdrCreateRunTimeHeader(PhoHFileHdrKindTy hdrKind, PhoHFileHdrTy *hdrT
 		hdrTyPtr->H.weightSquSum = 0.0;
 		hdrTyPtr->H.isTimeSorted = false;
 		hdrTyPtr->H.isRandomsAdded = false;
+		hdrTyPtr->H.isCompressed = false;
 		
 		/* Copy Runtime parameters */
 		memcpy(&(hdrTyPtr->H.PhgRunTimeParams),
@@ -5605,6 +5621,18 @@ Boolean  PhgHdrStFields(PhoHFileHdrTy *paramsPtr, LbHdrHkTy *headerHk)
 				PhgAbort("Unable to set header 'randoms added indicator' parameter", false);
 				break;
 			}
+			
+			/* Set the compressed indicator; left out of uncompressed files'
+				headers, where its absence reads as false */
+			if (paramsPtr->H.isCompressed) {
+				if (LbHdrStElem(headerHk, HDR_HISTORY_FILE_IS_COMPRESSED_ID,
+						sizeof(paramsPtr->H.isCompressed),
+						(void *)&paramsPtr->H.isCompressed) == false){
+					
+					PhgAbort("Unable to set header 'compressed indicator' parameter", false);
+					break;
+				}
+			}
 
 			if (LbHdrStElem(headerHk, HDR_BIN_NUM_TOF_BINS_ID,
 					sizeof(paramsPtr->H.BinRunTimeParams.numTOFBins),
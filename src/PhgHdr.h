@@ -316,6 +316,8 @@
 #define HDR_HISTORY_FILE_IS_RANDOMS_ADDED_ID	70201
 #define HDR_PHG_ADDRAND_PARAMS_ID			70202
 
+#define HDR_HISTORY_FILE_IS_COMPRESSED_ID	70301
+
 /* GLOBAL TYPES */
 /* PROTOTYPES */
 
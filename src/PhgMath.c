@@ -26,6 +26,8 @@
 *				PhgMathInit
 *				PhgMathTerminate
 *				PhgMathInitRNGFromSeed
+*				PhgMathInitRNGStream
+*				PhgMathGetRNGStream
 *				PhgMathReadSeed
 *				PhgMathWriteSeed
 *				PhgMathGetRandomNumberOld
@@ -142,6 +144,10 @@ LbFourByte	phgMathRandTable[PHGMATH_NUM_SEEDS];
 LbFourByte	phgMathNextIntegerRand1;
 LbFourByte	phgMathNextIntegerRand2;
 #endif
+#ifdef PHGMATH_USE_MT_RNG
+MTStateTy	phgMathStreamState;					/* State of the current non-compatibility stream */
+#endif
+LbUsFourByte	phgMathCurStream = PHGMATH_COMPAT_STREAM;	/* Index of the current stream */
 
 #ifdef PHG_DEBUG
 char		phgMathRandSeedPath[] = "phgmath.randseed";
@@ -161,6 +167,10 @@ Boolean		phgMathResetRandSeedFile = false;
 /* LOCAL MACROS */
 
 /* PROTOTYPES */
+void	phgMathSelectStream(LbUsFourByte streamIndex);
+#ifdef PHG_DEBUG
+FILE	*phgMathOpenRandSeedFile(char *openMode);
+#endif
 #ifdef PHGMATH_USE_LC_RNG
 Boolean phgMathLCReadState(FILE *phgMathRandSeedFile);
 Boolean phgMathLCWriteState(FILE *phgMathRandSeedFile);
@@ -300,6 +310,9 @@ void PhgMathInitRNGFromSeed(LbFourByte randSeed)
 {
 	do {
 		
+		/* This is the compatibility stream */
+		phgMathSelectStream(PHGMATH_COMPAT_STREAM);
+		
 		/* Original (now considered obsolete) SimSET RNG */
 		#ifdef PHGMATH_USE_ORIG_RNG
 		{
@@ -349,6 +362,113 @@ void PhgMathInitRNGFromSeed(LbFourByte randSeed)
 	} while (false);
 }
 
+/*********************************************************************************
+*
+*			Name:		PhgMathInitRNGStream
+*
+*			Summary:	Initialize the RNG to one of a family of independent
+*							streams derived from the provided seed value.
+*							Stream PHGMATH_COMPAT_STREAM is the sequence
+*							PhgMathInitRNGFromSeed gives for the same seed, so
+*							serial results are unchanged; every other stream
+*							has its own generator state.
+*							In debug builds with reading from the random seed
+*							file enabled, stream n is then restored from its
+*							own file, phgmath.randseed.n, as PhgMathInit
+*							restores stream 0 from phgmath.randseed.
+*
+*			Arguments:
+*				LbFourByte		randSeed	- Seed for generator
+*				LbUsFourByte	streamIndex	- Index of the stream
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void PhgMathInitRNGStream(LbFourByte randSeed, LbUsFourByte streamIndex)
+{
+	/* Discard any Gauss deviate computed from the previous stream */
+	phgMathHaveGaussDeviate = false;
+	
+	if (streamIndex == PHGMATH_COMPAT_STREAM) {
+		PhgMathInitRNGFromSeed(randSeed);
+	}
+	else {
+		phgMathSelectStream(streamIndex);
+		
+		/* Mersenne Twister RNG */
+		#ifdef PHGMATH_USE_MT_RNG
+		{
+			unsigned long	initKey[2];		/* Key built from seed and stream */
+			
+			initKey[0] = (unsigned long) randSeed;
+			initKey[1] = (unsigned long) streamIndex;
+			init_by_array(initKey, 2);
+		}
+		#else
+		{
+			/* The other generators only take a seed; offset it by a large prime */
+			LbUsFourByte	streamSeed = (LbUsFourByte) randSeed + (streamIndex * 1000003UL);
+			
+			PhgMathInitRNGFromSeed((LbFourByte) streamSeed);
+			phgMathSelectStream(streamIndex);
+		}
+		#endif
+		
+		#ifdef PHG_DEBUG
+			/* If requested, overwrite the seeding with the state saved for this stream */
+			if (PHGDEBUG_ReadFromRandSeedFile()) {
+				PhgMathReadSeed(-1);
+			}
+		#endif
+	}
+}
+
+/*********************************************************************************
+*
+*			Name:		PhgMathGetRNGStream
+*
+*			Summary:	Return the index of the current RNG stream.
+*
+*			Arguments:	None.
+*
+*			Function return: The stream index.
+*
+*********************************************************************************/
+LbUsFourByte PhgMathGetRNGStream()
+{
+	return (phgMathCurStream);
+}
+
+/*********************************************************************************
+*
+*			Name:		phgMathSelectStream
+*
+*			Summary:	Make the given stream current.  Each stream keeps its
+*							own random seed file, so a seed file left open for
+*							another stream is closed.
+*
+*			Arguments:
+*				LbUsFourByte	streamIndex	- Index of the stream
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phgMathSelectStream(LbUsFourByte streamIndex)
+{
+	#ifdef PHG_DEBUG
+		if ((streamIndex != phgMathCurStream) && (phgMathRandSeedFile != NULL)) {
+			fclose(phgMathRandSeedFile);
+			phgMathRandSeedFile = NULL;
+		}
+	#endif
+	
+	#ifdef PHGMATH_USE_MT_RNG
+		MTSelectState((streamIndex == PHGMATH_COMPAT_STREAM) ? 0 : &phgMathStreamState);
+	#endif
+	
+	phgMathCurStream = streamIndex;
+}
+
 #ifdef PHGMATH_USE_LC_RNG
 /*********************************************************************************
 *
@@ -484,7 +604,7 @@ void PhgMathReadSeed(LbFourByte	resetCount)
 		if (phgMathRandSeedFile == NULL) {
 			
 			/* Open the file */
-			if ((phgMathRandSeedFile = LbFlFileOpen(phgMathRandSeedPath, "r+b")) == NULL) {
+			if ((phgMathRandSeedFile = phgMathOpenRandSeedFile("r+b")) == NULL) {
 				LbInPrintf("Unable to open random seed file.");
 				break;
 			}
@@ -564,7 +684,7 @@ void PhgMathWriteSeed(LbFourByte resetCount)
 		if (phgMathRandSeedFile == NULL) {
 			
 			/* Open the file */
-			if ((phgMathRandSeedFile = LbFlFileOpen(phgMathRandSeedPath, "w+b")) == NULL) {
+			if ((phgMathRandSeedFile = phgMathOpenRandSeedFile("w+b")) == NULL) {
 				LbInPrintf("Unable to open random seed file.");
 				break;
 			}
@@ -621,6 +741,35 @@ void PhgMathWriteSeed(LbFourByte resetCount)
 #endif
 }
 
+#ifdef PHG_DEBUG
+/*********************************************************************************
+*
+*			Name:		phgMathOpenRandSeedFile
+*
+*			Summary:	Open the random seed file of the current stream.  The
+*							compatibility stream uses the original file name,
+*							other streams append their index to it.
+*			Arguments:
+*				char	*openMode	- Mode to open the file with.
+*				
+*			Function return: The open file, or NULL on failure.
+*
+*********************************************************************************/
+FILE *phgMathOpenRandSeedFile(char *openMode)	
+{
+	char	streamSeedPath[sizeof(phgMathRandSeedPath)+16];	/* Path for the current stream */
+	
+	if (phgMathCurStream == PHGMATH_COMPAT_STREAM) {
+		strcpy(streamSeedPath, phgMathRandSeedPath);
+	}
+	else {
+		sprintf(streamSeedPath, "%s.%lu", phgMathRandSeedPath, (unsigned long) phgMathCurStream);
+	}
+	
+	return (LbFlFileOpen(streamSeedPath, openMode));
+}
+#endif
+
 /*********************************************************************************
 *
 *			Name:		PhgMathGetRandomNumberOld
@@ -106,6 +106,8 @@
 									/* What we'll use for  pi/2 */
 #define PHGMATH_SPEED_OF_LIGHT		2.99792458E10
 									/* Centimeters per second */
+#define PHGMATH_COMPAT_STREAM		0
+									/* The RNG stream seeded as by PhgMathInitRNGFromSeed */
 
 /* TYPES */
 
@@ -113,6 +115,8 @@
 Boolean			PhgMathInit(LbFourByte *randSeed);
 void			PhgMathTerminate(void);
 void			PhgMathInitRNGFromSeed(LbFourByte randSeed);
+void			PhgMathInitRNGStream(LbFourByte randSeed, LbUsFourByte streamIndex);
+LbUsFourByte	PhgMathGetRNGStream(void);
 void			PhgMathReadSeed(LbFourByte	resetCount);
 void			PhgMathWriteSeed(LbFourByte	resetCount);
 double 			PhgMathGetRandomNumberOld(void);
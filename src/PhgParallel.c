@@ -0,0 +1,1349 @@
+/*********************************************************************************
+*                                                                                *
+*                       Source code developed by the                             *
+*           Imaging Research Laboratory - University of Washington               *
+*               (C) Copyright 1992-2013 Department of Radiology                  *
+*                           University of Washington                             *
+*                              All Rights Reserved                               *
+*                                                                                *
+*********************************************************************************/
+
+/*********************************************************************************
+*
+*			Module Name:		PhgParallel.c
+*			Revision Number:	1.0
+*			Date last revised:	16 October 2026
+*			Programmer:
+*			Date Originated:	16 October 2026
+*
+*			Module Overview:	Parallel tracking of decays by worker processes.
+*
+*								The decays to simulate are divided into blocks
+*								whose number depends only on the number of decays.
+*								Each worker is forked after initialization, so it
+*								owns a private copy of every module's tracking state
+*								(its simulation context).  Workers claim blocks
+*								from a shared counter, and each block is tracked
+*								with its own random number stream, making every
+*								block an independent simulation of its share of
+*								the decays.
+*
+*								Modules register their accumulators (statistics,
+*								productivity, report counters, bin images) and
+*								history files as they initialize.  A worker starts
+*								each block from the accumulators' values at the
+*								fork, and when the block is done adds the change
+*								in each accumulator to a shared sum.  The blocks'
+*								changes are added in block order, whichever worker
+*								tracked them, so floating point sums come out the
+*								same for any number of workers.  The parent adds
+*								the sums to its own accumulators and appends the
+*								history written for each block, in block order,
+*								to its history files.
+*
+*								When built with PHG_MPI the PHG may also be
+*								launched as several distributed ranks (e.g. with
+*								mpirun).  The blocks are dealt out to the ranks
+*								in turn, each rank tracks its own with its workers
+*								(or by itself), and the ranks' changes to the
+*								accumulators are summed into the root rank, which
+*								alone writes the results.  Since each block keeps
+*								its own random number stream the same events are
+*								tracked for any number of ranks and workers.  The
+*								ranks' sums are combined by MPI_Reduce, though,
+*								so floating point sums (e.g. weights) may differ
+*								in their last bits with the number of ranks.  The
+*								ranks must share the file system holding the
+*								history files.
+*
+*								Other programs may divide their own work into
+*								blocks (e.g. bin dividing a history file) and
+*								have them processed the same way, with
+*								PhgParProcessBlocks.
+*
+*			References:			'Emission List Gen Processes' PHG design.
+*
+**********************************************************************************
+*
+*			Global functions defined:
+*				PhgParInitialize
+*				PhgParBeginInitialize
+*				PhgParEndInitialize
+*				PhgParRegisterSum
+*				PhgParRegisterHistFile
+*				PhgParProcessBlocks
+*				PhgParTrackDecays
+*				PhgParGetOtherCPUTime
+*				PhgParTerminate
+*
+*			Global variables defined:
+*				PhgParNumWorkers
+*				PhgParIsWorker
+*				PhgParWorkerIndex
+*				PhgParNumRanks
+*				PhgParRankIndex
+*
+**********************************************************************************
+*
+*			Revision Section (Also update version number, if relevant)
+*
+*			Programmer(s):
+*
+*			Revision date:
+*
+*			Revision description:
+*
+*********************************************************************************/
+
+#define PHG_PARALLEL
+
+#include <stdio.h>
+#include <string.h>
+
+#include "SystemDependent.h"
+
+#ifdef GEN_UNIX
+	#include <unistd.h>
+	#include <pthread.h>
+	#include <sys/types.h>
+	#include <sys/wait.h>
+	#include <sys/mman.h>
+#endif
+
+#ifdef PHG_MPI
+	#include <mpi.h>
+#endif
+
+#include "LbTypes.h"
+#include "LbMacros.h"
+#include "LbError.h"
+#include "LbMemory.h"
+#include "LbParamFile.h"
+#include "LbFile.h"
+#include "LbInterface.h"
+#include "LbHeader.h"
+#include "LbTiming.h"
+
+#include "Photon.h"
+#include "PhgParams.h"
+#include "ProdTbl.h"
+#include "SubObj.h"
+#include "ColTypes.h"
+#include "ColParams.h"
+#include "PhgMath.h"
+#include "CylPos.h"
+#include "DetTypes.h"
+#include "DetParams.h"
+#include "PhoHFile.h"
+#include "PhoTrk.h"
+#include "phg.h"
+#include "PhgParallel.h"
+
+/* LOCAL CONSTANTS */
+#define PHGPAR_ALIGNMENT		8		/* Alignment of areas within shared memory */
+
+/* LOCAL TYPES */
+typedef struct {
+	void				*dataPtr;		/* The accumulator */
+	PhgParEn_SumTy		sumType;		/* Type of its elements */
+	LbUsFourByte		numElements;	/* Number of elements */
+	LbUsEightByte		offset;			/* Offset of its copies within the base and sum areas */
+} phgParSumTy;
+
+#ifdef GEN_UNIX
+typedef struct {
+	volatile LbUsFourByte	nextBlock;		/* Next unclaimed block of decays */
+	volatile LbUsFourByte	blocksDone;		/* Number of blocks tracked */
+	volatile LbUsFourByte	blocksAdded;	/* Number of blocks added to the sum area */
+	volatile LbUsFourByte	failed;			/* Has a worker failed */
+	pthread_mutex_t			addLock;		/* Guards blocksAdded and failed */
+	pthread_cond_t			addTurn;		/* Signalled when either changes */
+} phgParControlTy;
+#endif
+
+/* LOCAL GLOBALS */
+static char				phgParErrStr[1024];						/* Storage for creating error strings */
+static phgParSumTy		phgParSums[PHGPAR_MAX_SUMS];			/* The registered accumulators */
+static LbUsFourByte		phgParNumSums = 0;						/* Number of registered accumulators */
+static PhoHFileHkTy		*phgParHistFiles[PHGPAR_MAX_HIST_FILES];	/* The registered history files */
+static LbUsFourByte		phgParNumHistFiles = 0;					/* Number of registered history files */
+static LbUsFourByte		phgParNumBlocks;						/* Number of blocks of decays */
+static LbUsFourByte		phgParRankNumBlocks;					/* Number of blocks tracked by this rank */
+static PhgParBlockFuncTy	phgParBlockFunc;					/* Processes a block */
+static char				*phgParDoneLabel;						/* Describes a processed block in reports */
+static PhgParTrackFuncTy	phgParTrackFunc;					/* Tracks the decays of a block */
+static double			phgParBlockCPUTime;						/* CPU time processing blocks, summed */
+static double			phgParOwnBlockCPUTime;					/* CPU time this process spent on blocks */
+#ifdef PHG_MPI
+static Boolean			phgParMPIStarted = false;				/* Have we joined the other ranks? */
+#endif
+
+/* LOCAL MACROS */
+/*********************************************************************************
+*
+*			Name:		PHGPAR_Align
+*
+*			Summary:	Round a size up to the shared memory alignment.
+*
+*			Arguments:
+*				LbUsEightByte	size	- The size.
+*
+*			Function return: LbUsEightByte.
+*
+*********************************************************************************/
+#define PHGPAR_Align(size)	((((size) + PHGPAR_ALIGNMENT - 1) / PHGPAR_ALIGNMENT) * PHGPAR_ALIGNMENT)
+
+/*********************************************************************************
+*
+*			Name:		PHGPAR_AddDeltas
+*
+*			Summary:	Add the change in an accumulator since the fork to its sum.
+*						Unchanged elements are skipped so that fields which
+*						are never accumulated (e.g. table boundaries) are left
+*						alone whatever their contents.
+*
+*			Arguments:
+*				type	- The element type (unsigned for integers).
+*
+*			Function return: None.
+*
+*********************************************************************************/
+#define PHGPAR_AddDeltas(type) { \
+	type	*curPtr = (type *) sumPtr->dataPtr; \
+	type	*basePtr = (type *) (baseArea + sumPtr->offset); \
+	type	*accPtr = (type *) (sumArea + sumPtr->offset); \
+	for (elemIndex = 0; elemIndex < sumPtr->numElements; elemIndex++) \
+		if (memcmp(&curPtr[elemIndex], &basePtr[elemIndex], sizeof(type)) != 0) \
+			accPtr[elemIndex] += (type) (curPtr[elemIndex] - basePtr[elemIndex]); \
+	}
+
+/*********************************************************************************
+*
+*			Name:		PHGPAR_ApplySums
+*
+*			Summary:	Add the sum of the workers' changes to an accumulator.
+*
+*			Arguments:
+*				type	- The element type (unsigned for integers).
+*
+*			Function return: None.
+*
+*********************************************************************************/
+#define PHGPAR_ApplySums(type) { \
+	type	*curPtr = (type *) sumPtr->dataPtr; \
+	type	*accPtr = (type *) (sumArea + sumPtr->offset); \
+	for (elemIndex = 0; elemIndex < sumPtr->numElements; elemIndex++) \
+		if (accPtr[elemIndex] != 0) \
+			curPtr[elemIndex] += accPtr[elemIndex]; \
+	}
+
+/* PROTOTYPES */
+LbUsFourByte	phgParElemSize(PhgParEn_SumTy sumType);
+LbUsEightByte	phgParBlockDecays(LbUsFourByte blockIndex);
+void			phgParPartPath(PhoHFileHkTy *histHkPtr, LbUsFourByte blockIndex, char *partPath);
+void			phgParAddDeltas(LbUsOneByte *baseArea, LbUsOneByte *sumArea);
+void			phgParResetSums(LbUsOneByte *baseArea);
+void			phgParApplySums(LbUsOneByte *sumArea);
+Boolean			phgParTrackBlock(LbUsFourByte blockIndex);
+#ifdef GEN_UNIX
+Boolean			phgParInitControl(phgParControlTy *controlPtr);
+void			phgParSetFailed(phgParControlTy *controlPtr);
+Boolean			phgParProcessRankBlocks(phgParControlTy *controlPtr,
+					LbUsOneByte *baseArea, LbUsOneByte *sumArea);
+void			phgParWorker(LbUsFourByte workerIndex, phgParControlTy *controlPtr,
+					LbUsOneByte *baseArea, LbUsOneByte *sumArea);
+#endif
+#ifdef PHG_MPI
+void			phgParReduceRanks(LbUsOneByte *baseArea, LbUsOneByte *sumArea,
+					LbUsEightByte sumsSize);
+void			phgParLeaveRank(void);
+#endif
+
+/* FUNCTIONS */
+
+/*********************************************************************************
+*
+*			Name:			PhgParInitialize
+*
+*			Summary:		Set the number of worker processes.  When built with
+*							PHG_MPI, also join the other distributed ranks;
+*							only the root rank prints.
+*
+*			Arguments:
+*				LbUsFourByte	numWorkers	- Number of worker processes, zero to
+*												track serially.
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean PhgParInitialize(LbUsFourByte numWorkers)
+{
+	Boolean	okay = false;	/* Process flag */
+
+	do { /* Process Loop */
+
+		/* Verify the number of workers */
+		if (numWorkers > PHGPAR_MAX_WORKERS) {
+			sprintf(phgParErrStr, "The number of worker processes must be at most %d, not %lu (PhgParInitialize).",
+				PHGPAR_MAX_WORKERS, (unsigned long) numWorkers);
+			ErStGeneric(phgParErrStr);
+			break;
+		}
+
+		#ifndef GEN_UNIX
+			/* Worker processes need fork and shared memory */
+			if (numWorkers != 0) {
+				LbInPrintf("\nWorker processes are not supported on this system, tracking serially.\n");
+				numWorkers = 0;
+			}
+		#endif
+
+		PhgParNumWorkers = numWorkers;
+		PhgParIsWorker = false;
+		PhgParWorkerIndex = 0;
+		PhgParNumRanks = 1;
+		PhgParRankIndex = 0;
+		phgParNumSums = 0;
+		phgParNumHistFiles = 0;
+
+		#ifdef PHG_MPI
+		{
+			int		mpiFlag;	/* Is MPI initialized */
+			int		mpiValue;	/* Rank or size from MPI */
+
+			/* Join the other ranks */
+			if (MPI_Initialized(&mpiFlag) != MPI_SUCCESS) {
+				ErStGeneric("Unable to query MPI (PhgParInitialize).");
+				break;
+			}
+			if (!mpiFlag) {
+				if (MPI_Init(0, 0) != MPI_SUCCESS) {
+					ErStGeneric("Unable to initialize MPI (PhgParInitialize).");
+					break;
+				}
+				phgParMPIStarted = true;
+			}
+
+			MPI_Comm_size(MPI_COMM_WORLD, &mpiValue);
+			PhgParNumRanks = (LbUsFourByte) mpiValue;
+			MPI_Comm_rank(MPI_COMM_WORLD, &mpiValue);
+			PhgParRankIndex = (LbUsFourByte) mpiValue;
+
+			/* Only the root rank reports */
+			if (!PHGPAR_IsRoot()) {
+				if (freopen("/dev/null", "w", stdout) == 0) {
+					ErStFileError("Unable to silence the output of a rank (PhgParInitialize).");
+					break;
+				}
+			}
+		}
+		#endif
+
+		/* Sum the CPU time spent on blocks like any other accumulator */
+		phgParBlockCPUTime = 0.0;
+		phgParOwnBlockCPUTime = 0.0;
+		PhgParRegisterSum(&phgParBlockCPUTime, PhgParEn_Double, 1);
+
+		okay = true;
+	} while (false);
+
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:			PhgParBeginInitialize
+*
+*			Summary:		Called before the PHG modules are initialized.  Every
+*							rank initializes the modules, creating the output
+*							files, so the root rank waits for the others to
+*							finish; the files it creates are the ones kept.
+*
+*			Arguments:
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void PhgParBeginInitialize(void)
+{
+	#ifdef PHG_MPI
+		if ((PhgParNumRanks > 1) && PHGPAR_IsRoot()) {
+			MPI_Barrier(MPI_COMM_WORLD);
+		}
+	#endif
+}
+
+/*********************************************************************************
+*
+*			Name:			PhgParEndInitialize
+*
+*			Summary:		Called after the PHG modules are initialized.  The other
+*							ranks flush what they have written before letting the
+*							root rank initialize, then all ranks take the root's
+*							random seed (it may have come from the clock).
+*
+*			Arguments:
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void PhgParEndInitialize(void)
+{
+	#ifdef PHG_MPI
+		if (PhgParNumRanks > 1) {
+			if (!PHGPAR_IsRoot()) {
+				fflush(0);
+				MPI_Barrier(MPI_COMM_WORLD);
+			}
+
+			MPI_Bcast(&PhgRunTimeParams.PhgRandomSeed, 1, MPI_UINT32_T, 0, MPI_COMM_WORLD);
+		}
+	#endif
+}
+
+/*********************************************************************************
+*
+*			Name:			PhgParRegisterSum
+*
+*			Summary:		Register an accumulator to be summed over the workers.
+*							Only the change made by each worker is added, so the
+*							accumulator may hold a starting value.  Nothing is
+*							registered unless tracking in parallel.
+*
+*			Arguments:
+*				void			*dataPtr		- The accumulator.
+*				PhgParEn_SumTy	sumType			- Type of its elements.
+*				LbUsFourByte	numElements		- Number of elements.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void PhgParRegisterSum(void *dataPtr, PhgParEn_SumTy sumType, LbUsFourByte numElements)
+{
+	if (PHGPAR_IsParallel() && (dataPtr != 0) && (numElements != 0)) {
+
+		if (phgParNumSums == PHGPAR_MAX_SUMS) {
+			PhgAbort("Too many accumulators registered for worker processes (PhgParRegisterSum).", false);
+		}
+
+		phgParSums[phgParNumSums].dataPtr = dataPtr;
+		phgParSums[phgParNumSums].sumType = sumType;
+		phgParSums[phgParNumSums].numElements = numElements;
+		phgParNumSums++;
+	}
+}
+
+/*********************************************************************************
+*
+*			Name:			PhgParRegisterHistFile
+*
+*			Summary:		Register a history file written while tracking.  Each
+*							block's records are written to a part file and
+*							appended to the history file in block order.
+*							Nothing is registered unless tracking in parallel.
+*
+*			Arguments:
+*				PhoHFileHkTy	*histHkPtr		- The history file hook.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void PhgParRegisterHistFile(PhoHFileHkTy *histHkPtr)
+{
+	if (PHGPAR_IsParallel()) {
+
+		if (phgParNumHistFiles == PHGPAR_MAX_HIST_FILES) {
+			PhgAbort("Too many history files registered for worker processes (PhgParRegisterHistFile).", false);
+		}
+
+		phgParHistFiles[phgParNumHistFiles] = histHkPtr;
+		phgParNumHistFiles++;
+	}
+}
+
+/*********************************************************************************
+*
+*			Name:			PhgParTrackDecays
+*
+*			Summary:		Track all decays with the worker processes and reduce
+*							their results into this process.  With distributed
+*							ranks, each tracks its share of the blocks and the
+*							results are reduced into the root rank; the other
+*							ranks end here.
+*
+*			Arguments:
+*				PhgParTrackFuncTy	trackFunc	- Tracks the decays of a block.
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean PhgParTrackDecays(PhgParTrackFuncTy trackFunc)
+{
+	LbUsFourByte	numBlocks;		/* Number of blocks of decays */
+	
+	/* Divide the decays into blocks; the division depends only on the
+		number of decays so results don't depend on the number of workers
+	*/
+	if (PhgRunTimeParams.Phg_EventsToSimulate/PHGPAR_BLOCK_DECAYS >= PHGPAR_MAX_BLOCKS) {
+		numBlocks = PHGPAR_MAX_BLOCKS;
+	}
+	else {
+		numBlocks = (LbUsFourByte) ((PhgRunTimeParams.Phg_EventsToSimulate +
+			PHGPAR_BLOCK_DECAYS - 1)/PHGPAR_BLOCK_DECAYS);
+		if (numBlocks == 0)
+			numBlocks = 1;
+	}
+	
+	if (PhgParNumRanks == 1) {
+		LbInPrintf("\nTracking %lld decays in %lu blocks with %lu worker processes.\n",
+			PhgRunTimeParams.Phg_EventsToSimulate, (unsigned long) numBlocks,
+			(unsigned long) PhgParNumWorkers);
+	}
+	else {
+		LbInPrintf("\nTracking %lld decays in %lu blocks on %lu ranks with %lu worker processes each.\n",
+			PhgRunTimeParams.Phg_EventsToSimulate, (unsigned long) numBlocks,
+			(unsigned long) PhgParNumRanks, (unsigned long) PhgParNumWorkers);
+	}
+	
+	phgParTrackFunc = trackFunc;
+	
+	return (PhgParProcessBlocks(numBlocks, phgParTrackBlock, "tracked"));
+}
+
+/*********************************************************************************
+*
+*			Name:			PhgParProcessBlocks
+*
+*			Summary:		Process blocks of work with the worker processes and
+*							reduce their results into this process.  The blocks
+*							are claimed in any order, so each must be
+*							independent of the others; their changes to the
+*							accumulators, and the history written while
+*							processing them, are added in block order.
+*							With distributed ranks, each processes its share of
+*							the blocks and the results are reduced into the root
+*							rank; the other ranks end here.
+*
+*			Arguments:
+*				LbUsFourByte		numBlocks	- Number of blocks.
+*				PhgParBlockFuncTy	blockFunc	- Processes a block.
+*				char				*doneLabel	- Describes a processed block
+*												  in the progress reports.
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean PhgParProcessBlocks(LbUsFourByte numBlocks, PhgParBlockFuncTy blockFunc,
+			char *doneLabel)
+{
+	Boolean				okay = false;			/* Process flag */
+#ifdef GEN_UNIX
+	LbUsOneByte			*sharedArea = 0;		/* Memory shared with the workers */
+	LbUsEightByte		sharedSize = 0;			/* Size of the shared memory */
+	LbUsEightByte		sumsSize;				/* Size of the base and sum areas */
+	phgParControlTy		*controlPtr = 0;		/* Shared control block */
+	LbUsOneByte			*baseArea;				/* Accumulators at the time of the fork */
+	LbUsOneByte			*sumArea;				/* Sum of the workers' changes */
+	pid_t				workerPid;				/* A worker */
+	LbUsFourByte		numForked = 0;			/* Number of workers started */
+	LbUsFourByte		numExited = 0;			/* Number of workers finished */
+	LbUsFourByte		numFailed = 0;			/* Number of workers that failed */
+	LbUsFourByte		workerIndex;			/* LCV for workers */
+	LbUsFourByte		sumIndex;				/* LCV for accumulators */
+	LbUsFourByte		histIndex;				/* LCV for history files */
+	LbUsFourByte		blockIndex;				/* LCV for blocks */
+	Boolean				blocksOkay;				/* Were our blocks tracked */
+	int					workerStatus;			/* Exit status of a worker */
+	char				partPath[PATH_LENGTH+16];	/* Path of a history part file */
+
+	phgParNumBlocks = numBlocks;
+	phgParBlockFunc = blockFunc;
+	phgParDoneLabel = doneLabel;
+
+	do { /* Process Loop */
+
+		/* The blocks are dealt out to the ranks in turn */
+		if (PhgParRankIndex < phgParNumBlocks) {
+			phgParRankNumBlocks = ((phgParNumBlocks - PhgParRankIndex) + PhgParNumRanks - 1)/PhgParNumRanks;
+		}
+		else {
+			phgParRankNumBlocks = 0;
+		}
+
+		/* Lay out the accumulators within the base and sum areas */
+		sumsSize = 0;
+		for (sumIndex = 0; sumIndex < phgParNumSums; sumIndex++) {
+			phgParSums[sumIndex].offset = sumsSize;
+			sumsSize += PHGPAR_Align((LbUsEightByte) phgParSums[sumIndex].numElements *
+				phgParElemSize(phgParSums[sumIndex].sumType));
+		}
+
+		/* Allocate the shared memory; it starts out zeroed */
+		sharedSize = PHGPAR_Align(sizeof(phgParControlTy)) + (2 * sumsSize);
+		sharedArea = (LbUsOneByte *) mmap(0, sharedSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_ANON, -1, 0);
+		if (sharedArea == (LbUsOneByte *) MAP_FAILED) {
+			sharedArea = 0;
+			ErStGeneric("Unable to allocate memory shared with worker processes (PhgParProcessBlocks).");
+			break;
+		}
+		if (phgParInitControl((phgParControlTy *) sharedArea) == false) {
+			break;
+		}
+		controlPtr = (phgParControlTy *) sharedArea;
+		baseArea = sharedArea + PHGPAR_Align(sizeof(phgParControlTy));
+		sumArea = baseArea + sumsSize;
+
+		/* Save the accumulators' starting values */
+		for (sumIndex = 0; sumIndex < phgParNumSums; sumIndex++) {
+			memcpy(baseArea + phgParSums[sumIndex].offset, phgParSums[sumIndex].dataPtr,
+				phgParSums[sumIndex].numElements * phgParElemSize(phgParSums[sumIndex].sumType));
+		}
+
+		/* Flush buffered output so the workers don't inherit it */
+		fflush(stdout);
+		for (histIndex = 0; histIndex < phgParNumHistFiles; histIndex++) {
+			if (phgParHistFiles[histIndex]->histFile != 0) {
+				if (PhoHFileFlush(phgParHistFiles[histIndex]) == false)
+					goto FAIL;
+				fflush(phgParHistFiles[histIndex]->histFile);
+			}
+		}
+
+		fflush(stdout);
+
+		/* Without workers (distributed ranks only) process our blocks ourselves */
+		if (PhgParNumWorkers == 0) {
+			PhgParIsWorker = true;
+			blocksOkay = phgParProcessRankBlocks(controlPtr, baseArea, sumArea);
+			PhgParIsWorker = false;
+
+			if (!blocksOkay) {
+				break;
+			}
+		}
+
+		/* Start the workers; blocks are claimed dynamically so any that start will
+			process every block
+		*/
+		for (workerIndex = 0; workerIndex < PhgParNumWorkers; workerIndex++) {
+			workerPid = fork();
+
+			if (workerPid == 0) {
+				/* Never returns */
+				phgParWorker(workerIndex, controlPtr, baseArea, sumArea);
+			}
+			else if (workerPid < 0) {
+				LbInPrintf("\nUnable to start worker process %lu, continuing with %lu.\n",
+					(unsigned long) workerIndex, (unsigned long) numForked);
+				break;
+			}
+
+			numForked++;
+		}
+
+		/* Wait for the workers to finish, in whatever order they do; if one
+			fails the others must stop waiting for its blocks to be added
+		*/
+		for (numExited = 0; numExited < numForked; numExited++) {
+			if (waitpid(-1, &workerStatus, 0) < 0) {
+				numFailed += numForked - numExited;
+				break;
+			}
+			if (!WIFEXITED(workerStatus) || (WEXITSTATUS(workerStatus) != 0)) {
+				numFailed++;
+				phgParSetFailed(controlPtr);
+			}
+		}
+		if ((PhgParNumWorkers != 0) && (numForked == 0)) {
+			ErStGeneric("Unable to start any worker processes (PhgParProcessBlocks).");
+			break;
+		}
+		if ((numFailed != 0) || (controlPtr->blocksDone != phgParRankNumBlocks)) {
+			sprintf(phgParErrStr, "%lu of %lu worker processes failed (PhgParProcessBlocks).",
+				(unsigned long) numFailed, (unsigned long) numForked);
+			ErStGeneric(phgParErrStr);
+			break;
+		}
+
+		/* Add the blocks' results to ours */
+		phgParApplySums(sumArea);
+
+		#ifdef PHG_MPI
+			/* Add the other ranks' results to the root's; once this is done every
+				rank has written its history part files
+			*/
+			if (PhgParNumRanks > 1) {
+				phgParReduceRanks(baseArea, sumArea, sumsSize);
+			}
+		#endif
+
+		/* The root appends the history from each block, in block order */
+		for (histIndex = 0; PHGPAR_IsRoot() && (histIndex < phgParNumHistFiles); histIndex++) {
+			for (blockIndex = 0; blockIndex < phgParNumBlocks; blockIndex++) {
+				phgParPartPath(phgParHistFiles[histIndex], blockIndex, partPath);
+				if (PhoHFileAppendPart(phgParHistFiles[histIndex], partPath) == false) {
+					goto FAIL;
+				}
+			}
+		}
+
+		okay = true;
+		FAIL:;
+	} while (false);
+
+	/* Remove any part files left behind by an error */
+	if (!okay) {
+		for (histIndex = 0; histIndex < phgParNumHistFiles; histIndex++) {
+			for (blockIndex = 0; blockIndex < phgParNumBlocks; blockIndex++) {
+				phgParPartPath(phgParHistFiles[histIndex], blockIndex, partPath);
+				(void) remove(partPath);
+			}
+		}
+	}
+
+	/* Release the shared memory */
+	if (controlPtr != 0) {
+		(void) pthread_cond_destroy(&controlPtr->addTurn);
+		(void) pthread_mutex_destroy(&controlPtr->addLock);
+	}
+	if (sharedArea != 0) {
+		(void) munmap(sharedArea, sharedSize);
+	}
+
+	#ifdef PHG_MPI
+		/* Only the root rank goes on to write the results */
+		if (okay && !PHGPAR_IsRoot()) {
+			phgParLeaveRank();
+		}
+	#endif
+#else
+	if (numBlocks && blockFunc && doneLabel) {};		/* Eliminate unused parameter compiler warning */
+
+	ErStGeneric("Worker processes are not supported on this system (PhgParProcessBlocks).");
+#endif
+
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:			PhgParGetOtherCPUTime
+*
+*			Summary:		Get the CPU time the worker processes and the other
+*							ranks spent processing blocks, which this process's
+*							own timing doesn't include.
+*
+*			Arguments:
+*
+*			Function return: The CPU time in seconds.
+*
+*********************************************************************************/
+double PhgParGetOtherCPUTime(void)
+{
+	return (phgParBlockCPUTime - phgParOwnBlockCPUTime);
+}
+
+/*********************************************************************************
+*
+*			Name:			PhgParTerminate
+*
+*			Summary:		Leave the other distributed ranks.  If the simulation
+*							failed in any rank, all of them are stopped.
+*
+*			Arguments:
+*				Boolean		okay	- Did the simulation succeed.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void PhgParTerminate(Boolean okay)
+{
+	#ifdef PHG_MPI
+		if (phgParMPIStarted) {
+			if (!okay && (PhgParNumRanks > 1)) {
+				fprintf(stderr, "\nRank %lu of the PHG failed, stopping all ranks.\n",
+					(unsigned long) PhgParRankIndex);
+				MPI_Abort(MPI_COMM_WORLD, 1);
+			}
+
+			MPI_Finalize();
+			phgParMPIStarted = false;
+		}
+	#else
+		if (okay) {};		/* Eliminate unused parameter compiler warning */
+	#endif
+}
+
+#ifdef GEN_UNIX
+/*********************************************************************************
+*
+*			Name:			phgParInitControl
+*
+*			Summary:		Initialize the lock and condition variable of the
+*							control block so the workers can share them.
+*
+*			Arguments:
+*				phgParControlTy		*controlPtr	- The shared control block.
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean phgParInitControl(phgParControlTy *controlPtr)
+{
+	Boolean				okay = false;		/* Process flag */
+	pthread_mutexattr_t	lockAttr;			/* Attributes of the lock */
+	pthread_condattr_t	turnAttr;			/* Attributes of the condition variable */
+
+	do { /* Process Loop */
+
+		if (pthread_mutexattr_init(&lockAttr) != 0) {
+			ErStGeneric("Unable to initialize worker lock attributes (phgParInitControl).");
+			break;
+		}
+		if ((pthread_mutexattr_setpshared(&lockAttr, PTHREAD_PROCESS_SHARED) != 0) ||
+				(pthread_mutex_init(&controlPtr->addLock, &lockAttr) != 0)) {
+			(void) pthread_mutexattr_destroy(&lockAttr);
+			ErStGeneric("Unable to initialize worker lock (phgParInitControl).");
+			break;
+		}
+		(void) pthread_mutexattr_destroy(&lockAttr);
+
+		if (pthread_condattr_init(&turnAttr) != 0) {
+			(void) pthread_mutex_destroy(&controlPtr->addLock);
+			ErStGeneric("Unable to initialize worker condition attributes (phgParInitControl).");
+			break;
+		}
+		if ((pthread_condattr_setpshared(&turnAttr, PTHREAD_PROCESS_SHARED) != 0) ||
+				(pthread_cond_init(&controlPtr->addTurn, &turnAttr) != 0)) {
+			(void) pthread_condattr_destroy(&turnAttr);
+			(void) pthread_mutex_destroy(&controlPtr->addLock);
+			ErStGeneric("Unable to initialize worker condition (phgParInitControl).");
+			break;
+		}
+		(void) pthread_condattr_destroy(&turnAttr);
+
+		okay = true;
+	} while (false);
+
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:			phgParSetFailed
+*
+*			Summary:		Mark the blocks as failed and wake any workers
+*							waiting for their turn to add a block's changes.
+*
+*			Arguments:
+*				phgParControlTy		*controlPtr	- The shared control block.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phgParSetFailed(phgParControlTy *controlPtr)
+{
+	pthread_mutex_lock(&controlPtr->addLock);
+	controlPtr->failed = 1;
+	pthread_cond_broadcast(&controlPtr->addTurn);
+	pthread_mutex_unlock(&controlPtr->addLock);
+}
+
+/*********************************************************************************
+*
+*			Name:			phgParProcessRankBlocks
+*
+*			Summary:		Claim this rank's blocks and process them until none
+*							are left.  Each block starts from the accumulators'
+*							values at the fork, and its changes are added to the
+*							sum area once those of the blocks claimed before it
+*							are, waiting on the control block's condition
+*							variable for its turn; the accumulators are left at
+*							their fork values.
+*
+*			Arguments:
+*				phgParControlTy		*controlPtr	- The shared control block.
+*				LbUsOneByte			*baseArea	- Accumulators at the time of the fork.
+*				LbUsOneByte			*sumArea	- Sum of the blocks' changes.
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean phgParProcessRankBlocks(phgParControlTy *controlPtr,
+			LbUsOneByte *baseArea, LbUsOneByte *sumArea)
+{
+	Boolean			okay = false;			/* Process flag */
+	LbUsFourByte	claimIndex;				/* Index of the block among this rank's */
+	LbUsFourByte	blockIndex;				/* Current block */
+	LbUsFourByte	blocksDone;				/* Blocks processed by all workers */
+	LbUsFourByte	histIndex;				/* LCV for history files */
+	char			partPath[PATH_LENGTH+16];	/* Path of a history part file */
+	LbTmTimingType	blockStartTime;			/* Start of the block */
+	double			blockRealTime;			/* Real time for the block */
+	double			blockCPUTime;			/* CPU time for the block */
+
+	do { /* Process Loop */
+
+		/* Claim blocks until there are none left */
+		while ((claimIndex = __sync_fetch_and_add(&controlPtr->nextBlock, 1)) < phgParRankNumBlocks) {
+			blockIndex = PhgParRankIndex + (claimIndex * PhgParNumRanks);
+			LbTmStartTiming(&blockStartTime);
+
+			/* Start from the fork's values, so the block's changes don't depend
+				on the blocks this process has already done
+			*/
+			phgParResetSums(baseArea);
+
+			/* Send the block's history to its own part files */
+			for (histIndex = 0; histIndex < phgParNumHistFiles; histIndex++) {
+				phgParPartPath(phgParHistFiles[histIndex], blockIndex, partPath);
+				if (PhoHFileOpenPart(phgParHistFiles[histIndex], partPath) == false) {
+					goto FAIL;
+				}
+			}
+
+			if ((*phgParBlockFunc)(blockIndex) == false) {
+				goto FAIL;
+			}
+
+			for (histIndex = 0; histIndex < phgParNumHistFiles; histIndex++) {
+				if (PhoHFileClosePart(phgParHistFiles[histIndex]) == false) {
+					goto FAIL;
+				}
+			}
+
+			if (LbTmStopTiming(&blockStartTime, &blockRealTime, &blockCPUTime)) {
+				phgParBlockCPUTime += blockCPUTime;
+				phgParOwnBlockCPUTime += blockCPUTime;
+			}
+
+			/* Add the block's changes after those of the blocks claimed before it;
+				only the block whose turn it is touches the sum area, so the lock
+				is not held while adding
+			*/
+			pthread_mutex_lock(&controlPtr->addLock);
+			while ((controlPtr->blocksAdded != claimIndex) && !controlPtr->failed) {
+				pthread_cond_wait(&controlPtr->addTurn, &controlPtr->addLock);
+			}
+			pthread_mutex_unlock(&controlPtr->addLock);
+			if (controlPtr->failed) {
+				goto FAIL;
+			}
+
+			phgParAddDeltas(baseArea, sumArea);
+
+			pthread_mutex_lock(&controlPtr->addLock);
+			controlPtr->blocksAdded++;
+			pthread_cond_broadcast(&controlPtr->addTurn);
+			pthread_mutex_unlock(&controlPtr->addLock);
+
+			/* Print status report if we're at a 10% increment */
+			blocksDone = __sync_add_and_fetch(&controlPtr->blocksDone, 1);
+			if (((blocksDone*10)/phgParRankNumBlocks) != (((blocksDone-1)*10)/phgParRankNumBlocks)) {
+				LbInPrintf(" %3.0f%% %s.\n", (100.0*blocksDone)/phgParRankNumBlocks, phgParDoneLabel);
+				fflush(stdout);
+			}
+		}
+
+		okay = true;
+		FAIL:;
+	} while (false);
+
+	/* Leave the accumulators as they were at the fork; their changes are all
+		in the sum area
+	*/
+	phgParResetSums(baseArea);
+
+	/* Don't leave the other workers waiting for our blocks */
+	if (!okay) {
+		phgParSetFailed(controlPtr);
+	}
+
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:			phgParWorker
+*
+*			Summary:		Process blocks, adding each one's results to the shared
+*							sums, until none are left, then exit.
+*
+*			Arguments:
+*				LbUsFourByte		workerIndex	- Index of this worker.
+*				phgParControlTy		*controlPtr	- The shared control block.
+*				LbUsOneByte			*baseArea	- Accumulators at the time of the fork.
+*				LbUsOneByte			*sumArea	- Sum of the workers' changes.
+*
+*			Function return: None, the process exits.
+*
+*********************************************************************************/
+void phgParWorker(LbUsFourByte workerIndex, phgParControlTy *controlPtr,
+		LbUsOneByte *baseArea, LbUsOneByte *sumArea)
+{
+	Boolean			okay = false;			/* Process flag */
+
+	/* Set our identity */
+	PhgParIsWorker = true;
+	PhgParWorkerIndex = workerIndex;
+
+	do { /* Process Loop */
+
+		/* Process blocks until there are none left */
+		if (phgParProcessRankBlocks(controlPtr, baseArea, sumArea) == false) {
+			break;
+		}
+
+		okay = true;
+	} while (false);
+
+	if (!okay) {
+		ErHandle("Worker process failed", false);
+	}
+
+	/* Close our own files (e.g. random seed files), then leave without running
+		exit handlers or flushing inherited files
+	*/
+	PhgMathTerminate();
+	fflush(stdout);
+	_exit(okay ? 0 : 1);
+}
+#endif
+
+#ifdef PHG_MPI
+/*********************************************************************************
+*
+*			Name:			phgParReduceRanks
+*
+*			Summary:		Sum the change in each accumulator made by the other
+*							ranks into the root rank's accumulators.
+*
+*			Arguments:
+*				LbUsOneByte		*baseArea	- Accumulators before tracking.
+*				LbUsOneByte		*sumArea	- Storage for the changes.
+*				LbUsEightByte	sumsSize	- Size of the sum area.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phgParReduceRanks(LbUsOneByte *baseArea, LbUsOneByte *sumArea, LbUsEightByte sumsSize)
+{
+	phgParSumTy		*sumPtr;		/* Current accumulator */
+	LbUsFourByte	sumIndex;		/* LCV for accumulators */
+	MPI_Datatype	mpiType;		/* MPI type of its elements */
+
+	/* The root's changes are already in its accumulators */
+	memset(sumArea, 0, sumsSize);
+	if (!PHGPAR_IsRoot()) {
+		phgParAddDeltas(baseArea, sumArea);
+	}
+
+	for (sumIndex = 0; sumIndex < phgParNumSums; sumIndex++) {
+		sumPtr = &phgParSums[sumIndex];
+
+		switch (sumPtr->sumType) {
+			case PhgParEn_OneByte:
+				mpiType = MPI_UINT8_T;
+				break;
+
+			case PhgParEn_TwoByte:
+				mpiType = MPI_UINT16_T;
+				break;
+
+			case PhgParEn_FourByte:
+				mpiType = MPI_UINT32_T;
+				break;
+
+			case PhgParEn_Float:
+				mpiType = MPI_FLOAT;
+				break;
+
+			case PhgParEn_Double:
+				mpiType = MPI_DOUBLE;
+				break;
+
+			case PhgParEn_EightByte:
+			default:
+				mpiType = MPI_UINT64_T;
+				break;
+		}
+
+		if (PHGPAR_IsRoot()) {
+			MPI_Reduce(MPI_IN_PLACE, sumArea + sumPtr->offset, (int) sumPtr->numElements,
+				mpiType, MPI_SUM, 0, MPI_COMM_WORLD);
+		}
+		else {
+			MPI_Reduce(sumArea + sumPtr->offset, 0, (int) sumPtr->numElements,
+				mpiType, MPI_SUM, 0, MPI_COMM_WORLD);
+		}
+	}
+
+	/* Make sure every rank has finished with its part files */
+	MPI_Barrier(MPI_COMM_WORLD);
+
+	if (PHGPAR_IsRoot()) {
+		phgParApplySums(sumArea);
+	}
+}
+
+/*********************************************************************************
+*
+*			Name:			phgParLeaveRank
+*
+*			Summary:		End a rank other than the root once its results have
+*							been reduced, without writing any of the output files
+*							it shares with the root.
+*
+*			Arguments:
+*
+*			Function return: None, the process exits.
+*
+*********************************************************************************/
+void phgParLeaveRank(void)
+{
+	PhgMathTerminate();
+	fflush(stdout);
+	PhgParTerminate(true);
+	_exit(0);
+}
+#endif
+
+/*********************************************************************************
+*
+*			Name:			phgParTrackBlock
+*
+*			Summary:		Track the decays of a block, with the block's own random
+*							number stream.
+*
+*			Arguments:
+*				LbUsFourByte	blockIndex	- The block.
+*
+*			Function return: True.
+*
+*********************************************************************************/
+Boolean phgParTrackBlock(LbUsFourByte blockIndex)
+{
+	/* Give the block its own random number stream */
+	PhgMathInitRNGStream(PhgRunTimeParams.PhgRandomSeed, blockIndex+1);
+	
+	/* Start the block with an empty attenuation cache, so it tracks the same
+		whichever worker gets it */
+	PhoTrkClearAttCache();
+
+	/* Calculate the block's decays and track them */
+	SubObjCalcTimeBinDecayBlock(0, phgParBlockDecays(blockIndex),
+		PhgRunTimeParams.Phg_EventsToSimulate);
+	(*phgParTrackFunc)();
+	
+	return (true);
+}
+
+/*********************************************************************************
+*
+*			Name:			phgParElemSize
+*
+*			Summary:		Get the size of an accumulator element.
+*
+*			Arguments:
+*				PhgParEn_SumTy	sumType		- The element type.
+*
+*			Function return: Size in bytes.
+*
+*********************************************************************************/
+LbUsFourByte phgParElemSize(PhgParEn_SumTy sumType)
+{
+	LbUsFourByte	elemSize;	/* The size */
+
+	switch (sumType) {
+		case PhgParEn_OneByte:
+			elemSize = sizeof(LbUsOneByte);
+			break;
+
+		case PhgParEn_TwoByte:
+			elemSize = sizeof(LbUsTwoByte);
+			break;
+
+		case PhgParEn_FourByte:
+			elemSize = sizeof(LbUsFourByte);
+			break;
+
+		case PhgParEn_Float:
+			elemSize = sizeof(float);
+			break;
+
+		case PhgParEn_EightByte:
+		case PhgParEn_Double:
+		default:
+			elemSize = sizeof(double);
+			break;
+	}
+
+	return (elemSize);
+}
+
+/*********************************************************************************
+*
+*			Name:			phgParBlockDecays
+*
+*			Summary:		Get the number of decays in a block; the remainder is
+*							spread over the first blocks.
+*
+*			Arguments:
+*				LbUsFourByte	blockIndex	- The block.
+*
+*			Function return: Number of decays.
+*
+*********************************************************************************/
+LbUsEightByte phgParBlockDecays(LbUsFourByte blockIndex)
+{
+	LbUsEightByte	blockDecays;	/* The number of decays */
+
+	blockDecays = PhgRunTimeParams.Phg_EventsToSimulate/phgParNumBlocks;
+	if (blockIndex < (PhgRunTimeParams.Phg_EventsToSimulate % phgParNumBlocks))
+		blockDecays++;
+
+	return (blockDecays);
+}
+
+/*********************************************************************************
+*
+*			Name:			phgParPartPath
+*
+*			Summary:		Build the path of a block's history part file.
+*
+*			Arguments:
+*				PhoHFileHkTy	*histHkPtr	- The history file hook.
+*				LbUsFourByte	blockIndex	- The block.
+*				char			*partPath	- Storage for the path.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phgParPartPath(PhoHFileHkTy *histHkPtr, LbUsFourByte blockIndex, char *partPath)
+{
+	sprintf(partPath, "%s.part%lu", histHkPtr->histFilePath, (unsigned long) blockIndex);
+}
+
+/*********************************************************************************
+*
+*			Name:			phgParAddDeltas
+*
+*			Summary:		Add the change in each accumulator since the fork (or
+*							the last reset) to the sum area.  Integers are summed unsigned so the
+*							changes wrap correctly.
+*
+*			Arguments:
+*				LbUsOneByte		*baseArea	- Accumulators at the time of the fork.
+*				LbUsOneByte		*sumArea	- Sum of the workers' changes.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phgParAddDeltas(LbUsOneByte *baseArea, LbUsOneByte *sumArea)
+{
+	phgParSumTy		*sumPtr;		/* Current accumulator */
+	LbUsFourByte	sumIndex;		/* LCV for accumulators */
+	LbUsFourByte	elemIndex;		/* LCV for elements */
+
+	for (sumIndex = 0; sumIndex < phgParNumSums; sumIndex++) {
+		sumPtr = &phgParSums[sumIndex];
+
+		switch (sumPtr->sumType) {
+			case PhgParEn_OneByte:
+				PHGPAR_AddDeltas(LbUsOneByte);
+				break;
+
+			case PhgParEn_TwoByte:
+				PHGPAR_AddDeltas(LbUsTwoByte);
+				break;
+
+			case PhgParEn_FourByte:
+				PHGPAR_AddDeltas(LbUsFourByte);
+				break;
+
+			case PhgParEn_EightByte:
+				PHGPAR_AddDeltas(LbUsEightByte);
+				break;
+
+			case PhgParEn_Float:
+				PHGPAR_AddDeltas(float);
+				break;
+
+			case PhgParEn_Double:
+				PHGPAR_AddDeltas(double);
+				break;
+		}
+	}
+}
+
+/*********************************************************************************
+*
+*			Name:			phgParResetSums
+*
+*			Summary:		Set each accumulator back to its value at the fork.
+*
+*			Arguments:
+*				LbUsOneByte		*baseArea	- Accumulators at the time of the fork.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phgParResetSums(LbUsOneByte *baseArea)
+{
+	LbUsFourByte	sumIndex;		/* LCV for accumulators */
+
+	for (sumIndex = 0; sumIndex < phgParNumSums; sumIndex++) {
+		memcpy(phgParSums[sumIndex].dataPtr, baseArea + phgParSums[sumIndex].offset,
+			phgParSums[sumIndex].numElements * phgParElemSize(phgParSums[sumIndex].sumType));
+	}
+}
+
+/*********************************************************************************
+*
+*			Name:			phgParApplySums
+*
+*			Summary:		Add the sum of the workers' changes to each accumulator.
+*
+*			Arguments:
+*				LbUsOneByte		*sumArea	- Sum of the workers' changes.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phgParApplySums(LbUsOneByte *sumArea)
+{
+	phgParSumTy		*sumPtr;		/* Current accumulator */
+	LbUsFourByte	sumIndex;		/* LCV for accumulators */
+	LbUsFourByte	elemIndex;		/* LCV for elements */
+
+	for (sumIndex = 0; sumIndex < phgParNumSums; sumIndex++) {
+		sumPtr = &phgParSums[sumIndex];
+
+		switch (sumPtr->sumType) {
+			case PhgParEn_OneByte:
+				PHGPAR_ApplySums(LbUsOneByte);
+				break;
+
+			case PhgParEn_TwoByte:
+				PHGPAR_ApplySums(LbUsTwoByte);
+				break;
+
+			case PhgParEn_FourByte:
+				PHGPAR_ApplySums(LbUsFourByte);
+				break;
+
+			case PhgParEn_EightByte:
+				PHGPAR_ApplySums(LbUsEightByte);
+				break;
+
+			case PhgParEn_Float:
+				PHGPAR_ApplySums(float);
+				break;
+
+			case PhgParEn_Double:
+				PHGPAR_ApplySums(double);
+				break;
+		}
+	}
+}
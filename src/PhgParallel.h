@@ -0,0 +1,152 @@
+/*********************************************************************************
+*                                                                                *
+*                       Source code developed by the                             *
+*           Imaging Research Laboratory - University of Washington               *
+*               (C) Copyright 1992-2013 Department of Radiology                  *
+*                           University of Washington                             *
+*                              All Rights Reserved                               *
+*                                                                                *
+*********************************************************************************/
+
+/*********************************************************************************
+*
+*			Module Name:		PhgParallel.h
+*			Revision Number:	1.0
+*			Date last revised:	16 October 2026
+*			Programmer:
+*			Date Originated:	16 October 2026
+*
+*			Module Overview:	Definitions for PhgParallel.c.
+*
+*			References:			'Emission List Gen Processes' PHG design.
+*
+**********************************************************************************
+*
+*			Global functions defined:
+*				PhgParInitialize
+*				PhgParBeginInitialize
+*				PhgParEndInitialize
+*				PhgParRegisterSum
+*				PhgParRegisterHistFile
+*				PhgParProcessBlocks
+*				PhgParTrackDecays
+*				PhgParGetOtherCPUTime
+*				PhgParTerminate
+*
+*			Global variables defined:
+*				PhgParNumWorkers
+*				PhgParIsWorker
+*				PhgParWorkerIndex
+*				PhgParNumRanks
+*				PhgParRankIndex
+*
+*			Global macros defined:
+*				PHGPAR_IsParallel
+*				PHGPAR_IsWorker
+*				PHGPAR_IsRoot
+*
+**********************************************************************************
+*
+*			Revision Section (Also update version number, if relevant)
+*
+*			Programmer(s):
+*
+*			Revision date:
+*
+*			Revision description:
+*
+*********************************************************************************/
+#ifndef PHG_PARALLEL_HDR
+#define PHG_PARALLEL_HDR
+
+#ifdef PHG_PARALLEL
+	#define	LOCALE
+#else
+	#define LOCALE	extern
+#endif
+
+/* CONSTANTS */
+#define	PHGPAR_MAX_WORKERS		256		/* Maximum number of worker processes */
+#define	PHGPAR_MAX_SUMS			1024	/* Maximum number of registered accumulators */
+#define	PHGPAR_MAX_HIST_FILES	(4*PHG_MAX_PARAM_FILES)	/* Maximum number of registered history files */
+#define	PHGPAR_MAX_BLOCKS		1024	/* Maximum number of decay blocks */
+#define	PHGPAR_BLOCK_DECAYS		10000	/* Nominal number of decays in a block */
+
+/* TYPES */
+typedef enum {
+	PhgParEn_OneByte,					/* One byte integer */
+	PhgParEn_TwoByte,					/* Two byte integer */
+	PhgParEn_FourByte,					/* Four byte integer */
+	PhgParEn_EightByte,					/* Eight byte integer */
+	PhgParEn_Float,						/* Four byte real */
+	PhgParEn_Double						/* Eight byte real */
+} PhgParEn_SumTy;
+
+typedef void (*PhgParTrackFuncTy)(void);	/* Tracks every decay of the current block */
+typedef Boolean (*PhgParBlockFuncTy)(LbUsFourByte blockIndex);	/* Processes a block of work */
+
+/* GLOBALS */
+LOCALE	LbUsFourByte		PhgParNumWorkers;		/* Number of worker processes (0 is serial) */
+LOCALE	Boolean				PhgParIsWorker;			/* Is this process a worker? */
+LOCALE	LbUsFourByte		PhgParWorkerIndex;		/* Index of this worker */
+LOCALE	LbUsFourByte		PhgParNumRanks;			/* Number of distributed ranks (1 unless PHG_MPI) */
+LOCALE	LbUsFourByte		PhgParRankIndex;		/* Index of this rank, 0 is the root */
+
+/* MACROS */
+/*********************************************************************************
+*
+*			Name:		PHGPAR_IsParallel
+*
+*			Summary:	Returns true if decays are being tracked in blocks by worker
+*						processes or distributed ranks.  Otherwise the decays are tracked serially with
+*						the compatibility random number stream, reproducing the
+*						results of earlier versions.
+*
+*			Arguments:
+*
+*			Function return: Boolean.
+*
+*********************************************************************************/
+#define	PHGPAR_IsParallel()		((PhgParNumWorkers != 0) || (PhgParNumRanks > 1))
+
+/*********************************************************************************
+*
+*			Name:		PHGPAR_IsWorker
+*
+*			Summary:	Returns true if called from within a worker process.
+*
+*			Arguments:
+*
+*			Function return: Boolean.
+*
+*********************************************************************************/
+#define	PHGPAR_IsWorker()		(PhgParIsWorker)
+
+/*********************************************************************************
+*
+*			Name:		PHGPAR_IsRoot
+*
+*			Summary:	Returns true if called from the root rank, the one that
+*						writes the results.  Always true unless PHG_MPI.
+*
+*			Arguments:
+*
+*			Function return: Boolean.
+*
+*********************************************************************************/
+#define	PHGPAR_IsRoot()			(PhgParRankIndex == 0)
+
+/* PROTOTYPES */
+Boolean		PhgParInitialize(LbUsFourByte numWorkers);
+void		PhgParBeginInitialize(void);
+void		PhgParEndInitialize(void);
+void		PhgParRegisterSum(void *dataPtr, PhgParEn_SumTy sumType, LbUsFourByte numElements);
+void		PhgParRegisterHistFile(PhoHFileHkTy *histHkPtr);
+Boolean		PhgParProcessBlocks(LbUsFourByte numBlocks, PhgParBlockFuncTy blockFunc,
+				char *doneLabel);
+Boolean		PhgParTrackDecays(PhgParTrackFuncTy trackFunc);
+double		PhgParGetOtherCPUTime(void);
+void		PhgParTerminate(Boolean okay);
+
+#undef LOCALE
+#endif /* PHG_PARALLEL_HDR */
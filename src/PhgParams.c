@@ -166,6 +166,12 @@ static	labelTy		phgRunTimeParamLabels[] = {	/* The parameter labels */
 					"history_file",
 					"history_params_file",
 					"forced_non_absorption",	/* correct spelling!, replacing forced_non_absorbtion */
+					"woodcock_tracking",
+					"alias_decay_sampling",
+					"compress_history_files",
+					"history_index_interval",
+					"history_sort_buffer_size",
+					"primary_attenuation_cache_error",
 					""};
 
 /* When changing the following list also change PhgEn_BinParamsTy in PhgParams.h.
@@ -408,6 +414,12 @@ Boolean PhgGetRunTimeParams()
 		PhgRunTimeParams.PhgIsModelCoherentInObj = false;
 		PhgRunTimeParams.PhgIsModelCoherentInTomo = false;
 		PhgRunTimeParams.PhgIsModelPolarization = false;
+		PhgRunTimeParams.PhgIsWoodcockTracking = false;
+		PhgRunTimeParams.PhgIsAliasDecaySampling = false;
+		PhgRunTimeParams.PhgIsCompressHistoryFiles = false;
+		PhgRunTimeParams.PhgHistoryIndexInterval = 0;
+		PhgRunTimeParams.PhgHistorySortBufferSize = 0;
+		PhgRunTimeParams.PhgPrimaryAttCacheError = 0.0;
 		PhgRunTimeParams.PhgNuclide.isotope = PhgEn_IsotopType_NULL;
 		EmisListIsotopeDataFilePath[0] = '\0';
 		
@@ -768,6 +780,36 @@ Boolean PhgGetRunTimeParams()
 								*((Boolean *) paramBuffer);
 						break;
 					
+					case PhgEn_woodcock_tracking:
+							PhgRunTimeParams.PhgIsWoodcockTracking =
+								*((Boolean *) paramBuffer);
+						break;
+					
+					case PhgEn_alias_decay_sampling:
+							PhgRunTimeParams.PhgIsAliasDecaySampling =
+								*((Boolean *) paramBuffer);
+						break;
+					
+					case PhgEn_compress_history_files:
+							PhgRunTimeParams.PhgIsCompressHistoryFiles =
+								*((Boolean *) paramBuffer);
+						break;
+					
+					case PhgEn_history_index_interval:
+							PhgRunTimeParams.PhgHistoryIndexInterval =
+								*((LbUsFourByte *) paramBuffer);
+						break;
+					
+					case PhgEn_history_sort_buffer_size:
+							PhgRunTimeParams.PhgHistorySortBufferSize =
+								*((LbUsFourByte *) paramBuffer);
+						break;
+					
+					case PhgEn_primary_attenuation_cache_error:
+							PhgRunTimeParams.PhgPrimaryAttCacheError =
+								*((double *) paramBuffer);
+						break;
+					
 					case PhgEn_bin_params_file:
 					
 							/* Verify a tomograph file hasn't already been specified */
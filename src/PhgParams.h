@@ -195,6 +195,24 @@
 	/* Are we modeling polarization */
 #define PHG_IsModelPolarization() 		PhgRunTimeParams.PhgIsModelPolarization
 
+	/* Are we delta (Woodcock) tracking photons through the object */
+#define PHG_IsWoodcockTracking() 		PhgRunTimeParams.PhgIsWoodcockTracking
+
+	/* Are we sampling decays from an alias table rather than voxel by voxel */
+#define PHG_IsAliasDecaySampling() 		PhgRunTimeParams.PhgIsAliasDecaySampling
+
+	/* Are history files written in the compressed (chunked, column) format */
+#define PHG_IsCompressHistoryFiles() 	PhgRunTimeParams.PhgIsCompressHistoryFiles
+
+	/* Are decay indexes written beside standard history files */
+#define PHG_IsIndexHistoryFiles() 		(PhgRunTimeParams.PhgHistoryIndexInterval != 0)
+
+	/* Are history files written in time order */
+#define PHG_IsSortHistoryFiles() 		(PhgRunTimeParams.PhgHistorySortBufferSize != 0)
+
+	/* Are primary forced detection attenuations cached */
+#define PHG_IsCachePrimaryAttenuation() (PhgRunTimeParams.PhgPrimaryAttCacheError > 0.0)
+
 
 /* PROGRAM TYPES */
 
@@ -267,6 +285,12 @@ typedef enum {
 	PhoHFileEn_history_file,
 	PhoHFileEn_history_params_file,
 	PhgEn_forced_non_absorption,	/* correct spelling!, replacing PhgEn_forced_non_absorbtion */
+	PhgEn_woodcock_tracking,
+	PhgEn_alias_decay_sampling,
+	PhgEn_compress_history_files,
+	PhgEn_history_index_interval,
+	PhgEn_history_sort_buffer_size,
+	PhgEn_primary_attenuation_cache_error,
 	PhgEn_NULL					/* NULL must always be left last when adding to list,
 								it is used to end loops */
 }PhgEn_RunTimeParamsTy;
@@ -541,6 +565,12 @@ Boolean			PhgIsModelCoherent;				/* Do we model coherent scatter in tomo and obj
 Boolean			PhgIsModelCoherentInTomo;		/* Do we model coherent scatter in tomo only? */
 Boolean			PhgIsModelCoherentInObj;		/* Do we model coherent scatter in obj only? */
 Boolean			PhgIsModelPolarization;			/* Do we model polarization? */
+Boolean			PhgIsWoodcockTracking;			/* Do we delta track photons through the object? */
+Boolean			PhgIsAliasDecaySampling;		/* Do we sample decays from an alias table? */
+Boolean			PhgIsCompressHistoryFiles;		/* Do we write compressed history files? */
+LbUsFourByte	PhgHistoryIndexInterval;		/* Decays per entry of history file decay indexes, 0 for none */
+LbUsFourByte	PhgHistorySortBufferSize;		/* Mbytes sorted at a time when writing history files in time order, 0 for none */
+double			PhgPrimaryAttCacheError;		/* Free path spread allowed in cached primary FD attenuations, 0 for no cache */
 
 char			PhgParamFilePath[PATH_LENGTH];						/* Our param file path */
 
@@ -23,16 +23,37 @@
 **********************************************************************************
 *
 *			Global functions defined:	
+*				PhoHFileAppendPart
 *				PhoHFileClose
+*				PhoHFileCloseCursor
+*				PhoHFileClosePart
 *				PhoHFileCreate
+*				PhoHFileEndIndex
+*				PhoHFileEndWrites
+*				PhoHFileFlush
+*				PhoHFileIndexDecays
+*				PhoHFileOpenCursor
+*				PhoHFileOpenPart
+*				PhoHFileSetCompressed
+*				PhoHFileSetIndexed
+*				PhoHFileSetIndexedLike
+*				PhoHFileSetSorted
+*				PhoHFileSetCursorRange
+*				PhoHFileSplitCursor
+*				PhoHFileSplitIndex
 *				PhoHFilePrintParams
 *				PhoHFilePrintReport
 *				PhoHFileWriteDetections
+*				PhoHFileRewriteDetections
 *				PhoHFileReadFields
 *				PhoHFilePrintFields
 *				PhoHFileGetRunTimeParams
 *				PhoHFileLookupRunTimeParamLabel
+*				PhoHFileReadAhead
+*				PhoHFileReadChunkIndex
+*				PhoHFileReadDecayIndex
 *				PhoHFileReadEvent
+*				PhoHFileCursorEvent
 *				PhoHFileOldReadEvent
 *
 *			Global variables defined:		none
@@ -111,17 +132,36 @@
 #define	PHOTON_HIST_FILE
 
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
+#include <math.h>
 
 #include "SystemDependent.h"
 
+/* Full record buffers are written by a separate thread on Unix systems */
+#if defined(GEN_UNIX) && !defined(PHOHFILE_SYNC_WRITES)
+	#define PHOHFILE_ASYNC_WRITES
+#endif
+
+#ifdef PHOHFILE_ASYNC_WRITES
+	#include <pthread.h>
+#endif
+
+#ifdef GEN_UNIX
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
 #include "LbTypes.h"
 #include "LbMacros.h"
 #include "LbError.h"
+#include "LbMemory.h"
 #include "LbParamFile.h"
 #include "LbHeader.h"
 #include "LbFile.h"
 #include "LbInterface.h"
+#include "LbCompress.h"
 
 #include "Photon.h"
 #include "PhgParams.h"
@@ -135,17 +175,214 @@
 #include "PhgHdr.h"
 #include "phg.h"
 #include "PhgBin.h"
+#include "PhgParallel.h"
 
 #define MAX_SCATTERS			20		/* Maximum number of scatters accounted for */
+#define PHOHFILE_FLUSH_SIZE		(1024*1024)	/* Buffered records are written once they reach this size */
+#define PHOHFILE_BUFFER_SIZE	(PHOHFILE_FLUSH_SIZE + 65536)	/* Initial record buffer size */
+
+#define PHOHFILE_CHUNK_MAGIC		"SH3C"	/* Starts every chunk of a compressed history file */
+#define PHOHFILE_CHUNK_EVENTS		0		/* Chunk of decays and photons */
+#define PHOHFILE_CHUNK_INDEX		1		/* Chunk holding the chunk index */
+#define PHOHFILE_CHUNK_TRAILER		2		/* Last chunk, holds the index chunk offset */
+#define PHOHFILE_MAX_CHUNK_EVENTS	(1 << 24)	/* Sanity limit on events in a chunk */
+#define PHOHFILE_XFORM_NONE			0		/* Field bytes stored as is */
+#define PHOHFILE_XFORM_DELTA		1		/* Field stored as zigzag coded differences */
+#define PHOHFILE_XFORM_XOR			2		/* Field stored xor an earlier field of the record */
+#define PHOHFILE_NUM_DECAY_FIELDS	6		/* Columns of a decay */
+#define PHOHFILE_NUM_PHOTON_FIELDS	14		/* Columns of a photon */
+#define PHOHFILE_SAMPLE_SIZE		2048	/* Most values sampled to choose how a column is stored */
+#define PHOHFILE_CURSOR_WINDOW		(16*1024*1024)	/* Mapped bytes requested ahead of, and released behind, a cursor */
+#define PHOHFILE_INDEX_MAGIC		"SDIX"	/* Starts a decay index */
+#define PHOHFILE_INDEX_VERSION		2		/* Version of the decay index format */
+#define PHOHFILE_RUN_SUFFIX			".run"	/* With a number, added to a history file's path to name its sorted runs */
+#define PHOHFILE_MAX_SORT_MBYTES	2047	/* Largest sort buffer; record offsets are four bytes */
+#define PHOHFILE_MAX_RECORD_SIZE	(1 + sizeof(PHG_Decay) + \
+			PHG_MAX_DETECTED_PHOTONS*(1 + sizeof(PHG_DetectedPhoton)))	/* Largest decay with its photons */
+#define PHOHFILE_RADIX_SIZE			256		/* Digit values of each radix sort pass */
+#define PHOHFILE_RADIX_PASSES		8		/* Byte passes over a sort key */
+#define PHOHFILE_SIGN_BIT			(((LbUsEightByte) 1) << 63)	/* Sign bit of a sort key */
+
+/* Describes one column of a compressed history file */
+#define PHOHFILE_FIELD(recordType, member) \
+	{ offsetof(recordType, member), sizeof(((recordType *) 0)->member) }
 
 typedef char labelTy[LBPF_LABEL_LEN];
 
+/* Compressed history files are a sequence of chunks.  An events chunk holds
+	a whole number of decays with their photons, stored column by column:
+	first the event flags, then each decay field and each photon field.
+	Every column is split into byte planes that are compressed separately
+	(see LbCompress.c); structure padding is not stored.  When the file is
+	closed an index chunk, listing where each events chunk starts, and a
+	trailer chunk, giving the index chunk's offset, are added.
+*/
+typedef struct {
+	char			magic[4];			/* PHOHFILE_CHUNK_MAGIC */
+	LbUsFourByte	kind;				/* PHOHFILE_CHUNK_EVENTS, _INDEX or _TRAILER */
+	LbUsFourByte	numDecays;			/* Decays in the chunk (or the file, for the index) */
+	LbUsFourByte	numPhotons;			/* Photons in the chunk (or the file, for the index) */
+	LbUsFourByte	dataSize;			/* Bytes following this header */
+	LbUsFourByte	reserved;			/* Zero */
+	double			firstDecayTime;		/* Time of the chunk's first decay */
+} phoHFileChunkHdrTy;
+
+typedef struct {
+	LbUsFourByte	offset;				/* Offset of the field in its record */
+	LbUsFourByte	size;				/* Size of the field */
+} phoHFileFieldTy;
+
+/* Writing state of a compressed history file */
+typedef struct {
+	LbUsOneByte				*packedBuffer;		/* The packed chunk */
+	LbUsFourByte			packedBufferSize;	/* Size of packedBuffer */
+	LbUsFourByte			packedBufferUsed;	/* Bytes of packedBuffer in use */
+	LbUsOneByte				*records;			/* The chunk's decays followed by its photons */
+	LbUsFourByte			recordsSize;		/* Size of records */
+	LbUsEightByte			*values;			/* One column of the chunk */
+	LbUsEightByte			*deltas;			/* The column as coded */
+	LbUsOneByte				*plane;				/* One byte plane of the column */
+	LbUsFourByte			maxEvents;			/* Length of values, deltas and plane */
+	PhoHFileChunkEntryTy	*index;				/* Index of the chunks written */
+	LbUsFourByte			numChunks;			/* Entries in the index */
+	LbUsFourByte			maxChunks;			/* Room in the index */
+	LbUsEightByte			nextChunkOffset;	/* File offset of the next chunk */
+	LbUsEightByte			numDecaysIndexed;	/* Decays in the indexed chunks */
+	Boolean					isIndexing;			/* False while writing a part file */
+} phoHFilePackerTy;
+
+/* Reading state of a compressed history file:  its current chunk, decoded */
+typedef struct {
+	FILE					*histFile;			/* The file being read */
+	LbUsEightByte			filePos;			/* File position following the chunk */
+	LbUsOneByte				*chunkData;			/* The chunk as read */
+	LbUsFourByte			chunkDataSize;		/* Size of chunkData */
+	LbUsOneByte				*kinds;				/* Event flags */
+	PHG_Decay				*decays;			/* Decoded decays */
+	PHG_DetectedPhoton		*photons;			/* Decoded photons */
+	LbUsEightByte			*values;			/* One column of the chunk */
+	LbUsOneByte				*plane;				/* One byte plane of the column */
+	LbUsFourByte			maxEvents;			/* Length of the arrays above */
+	LbUsFourByte			numEvents;			/* Events in the chunk */
+	LbUsFourByte			nextEvent;			/* Next event to return */
+	LbUsFourByte			nextDecay;			/* Next decay to return */
+	LbUsFourByte			nextPhoton;			/* Next photon to return */
+} phoHFileReaderTy;
+
+#ifdef PHOHFILE_ASYNC_WRITES
+/* The thread that writes a history file's full record buffers.  The
+	tracking code fills one buffer while the thread writes the other.
+*/
+typedef struct {
+	pthread_t		thread;			/* The writer thread */
+	pthread_mutex_t	lock;			/* Guards the fields below */
+	pthread_cond_t	changed;		/* Signalled when a buffer arrives or is written */
+	FILE			*histFile;		/* The file being written */
+	LbUsOneByte		*buffer;		/* The buffer being written, or the spare */
+	LbUsFourByte	bufferSize;		/* Size of the buffer */
+	LbUsFourByte	bufferUsed;		/* Bytes waiting to be written */
+	phoHFilePackerTy *packer;	/* Packs the buffer before it is written, or 0 */
+	Boolean			isBusy;			/* Is the buffer being written? */
+	Boolean			isStopping;		/* Should the thread finish? */
+	Boolean			isFailed;		/* Did a write fail? */
+} phoHFileWriterTy;
+#endif
+
+/* A history file written in time order collects its records in the record
+	buffer, up to the sorter's buffer size, rather than writing them.  A full
+	buffer is sorted by decay time and written to a run file beside the
+	history file.  When the file is closed the runs, and the records still
+	in the buffer, are merged into it.  Records arriving from worker part
+	files join the buffer in block order, so the result is the same as a
+	stable sort of the file written without sorting.
+*/
+typedef struct {
+	LbUsEightByte		radixKey;		/* Decay time as an unsigned integer of the same order */
+	LbUsFourByte		offset;			/* Offset of the decay's records in the buffer */
+	LbUsFourByte		size;			/* Size of the decay's records */
+} phoHFileSortItemTy;
+
+typedef struct {
+	LbUsFourByte		bufferSize;		/* Bytes of records sorted at a time */
+	Boolean				isCompressed;	/* Is the history file written compressed? */
+	Boolean				isMerging;		/* Are the sorted records being written? */
+	LbUsFourByte		numRuns;		/* Run files written */
+	phoHFileSortItemTy	*items;			/* Index of the buffer's decays */
+	phoHFileSortItemTy	*scratch;		/* Space for sorting the index */
+	LbUsFourByte		maxItems;		/* Length of items and scratch */
+} phoHFileSorterTy;
+
+/* A source of sorted records:  a run or part file read through a buffer,
+	or the sorted records of the record buffer */
+typedef struct {
+	FILE				*runFile;		/* The file, 0 for the record buffer */
+	LbUsOneByte			*buffer;		/* Read buffer, or the record buffer */
+	LbUsFourByte		bufferSize;		/* Size of the read buffer */
+	LbUsFourByte		dataStart;		/* Offset of the current record */
+	LbUsFourByte		dataEnd;		/* End of the data read */
+	phoHFileSortItemTy	*nextItem;		/* Next sorted record of the record buffer */
+	phoHFileSortItemTy	*endItem;		/* End of the sorted records */
+	LbUsOneByte			*record;		/* The current record, 0 when used up */
+	LbUsFourByte		recordSize;		/* Size of the record */
+	LbUsEightByte		radixKey;		/* Sort key of the record */
+} phoHFileSortInputTy;
+
+/* The decay index of a standard history file, built from the records as they
+	are written so the file needn't be read again to index it.  The header's
+	totals are kept up to date; the last entry is still growing.
+*/
+typedef struct {
+	PhoHFileDecayIndexHdrTy	header;		/* The index header */
+	PhoHFileChunkEntryTy	*entries;	/* The entries */
+	LbUsFourByte			maxEntries;	/* Length of entries */
+	LbUsEightByte			nextOffset;	/* File offset of the next record written */
+} phoHFileIndexerTy;
+
+/* Are the records being collected for sorting, rather than written? */
+#define PHOHFILE_IsSorting(hkPtr)	(((hkPtr)->sorter != 0) && ((hkPtr)->mainHistFile == 0) && \
+										!((phoHFileSorterTy *) (hkPtr)->sorter)->isMerging)
+
+/* Bytes of records collected before the buffer is passed on */
+#define PHOHFILE_FlushSize(hkPtr)	(PHOHFILE_IsSorting(hkPtr) ? \
+										((phoHFileSorterTy *) (hkPtr)->sorter)->bufferSize : \
+										PHOHFILE_FLUSH_SIZE)
+
 /* Local globals */
 static char			*phoHFileOpenMode =	"wb";	/* File access mode */
 static char			phoHFileErrString[1024];	/* Error string storage */
 static LbUsOneByte	PhoHFileDecayFlag;			/* Identification flags */
 static LbUsOneByte	PhoHFilePhotonFlag;			/* Identification flags */
 
+/* Columns of compressed history files */
+static phoHFileFieldTy	phoHFileDecayFields[PHOHFILE_NUM_DECAY_FIELDS] = {
+					PHOHFILE_FIELD(PHG_Decay, location.x_position),
+					PHOHFILE_FIELD(PHG_Decay, location.y_position),
+					PHOHFILE_FIELD(PHG_Decay, location.z_position),
+					PHOHFILE_FIELD(PHG_Decay, startWeight),
+					PHOHFILE_FIELD(PHG_Decay, decayTime),
+					PHOHFILE_FIELD(PHG_Decay, decayType)
+					};
+static phoHFileFieldTy	phoHFilePhotonFields[PHOHFILE_NUM_PHOTON_FIELDS] = {
+					PHOHFILE_FIELD(PHG_DetectedPhoton, location.x_position),
+					PHOHFILE_FIELD(PHG_DetectedPhoton, location.y_position),
+					PHOHFILE_FIELD(PHG_DetectedPhoton, location.z_position),
+					PHOHFILE_FIELD(PHG_DetectedPhoton, angle.cosine_x),
+					PHOHFILE_FIELD(PHG_DetectedPhoton, angle.cosine_y),
+					PHOHFILE_FIELD(PHG_DetectedPhoton, angle.cosine_z),
+					PHOHFILE_FIELD(PHG_DetectedPhoton, flags),
+					PHOHFILE_FIELD(PHG_DetectedPhoton, photon_weight),
+					PHOHFILE_FIELD(PHG_DetectedPhoton, energy),
+					PHOHFILE_FIELD(PHG_DetectedPhoton, time_since_creation),
+					PHOHFILE_FIELD(PHG_DetectedPhoton, transaxialPosition),
+					PHOHFILE_FIELD(PHG_DetectedPhoton, azimuthalAngleIndex),
+					PHOHFILE_FIELD(PHG_DetectedPhoton, detectorAngle),
+					PHOHFILE_FIELD(PHG_DetectedPhoton, detCrystal)
+					};
+
+/* Readers of compressed history files, one per file being read */
+static phoHFileReaderTy	**phoHFileReaders = 0;
+static LbUsFourByte		phoHFileNumReaders = 0;
+
 /* see comment above PhoHFileEn_RunTimeParamsTy (in PhoHFile.h) when altering
  this variable.  They must be altered in conjunction */
 static labelTy		PhoHFileRunTimeParamLabels[] = {	/* Our label table */
@@ -227,6 +464,61 @@ Boolean	phoHFileWriteFields(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay,
 
 void phoHFileCreateDetectedPhoton(PHG_TrackingPhoton *trackingphoton,
 		PHG_DetectedPhoton *detectedphoton);
+
+Boolean phoHFileBufferWrite(PhoHFileHkTy *hdrHkTyPtr, void *data, LbUsFourByte size);
+Boolean phoHFilePassBuffer(PhoHFileHkTy *hdrHkTyPtr);
+#ifdef PHOHFILE_ASYNC_WRITES
+Boolean phoHFileStartWriter(PhoHFileHkTy *hdrHkTyPtr);
+Boolean phoHFileStopWriter(PhoHFileHkTy *hdrHkTyPtr);
+void *phoHFileWriterMain(void *writerPtr);
+#endif
+phoHFilePackerTy *phoHFileGetPacker(PhoHFileHkTy *hdrHkTyPtr);
+void phoHFileFreePacker(PhoHFileHkTy *hdrHkTyPtr);
+Boolean phoHFileSizePacker(phoHFilePackerTy *packerPtr, LbUsFourByte recordBytes);
+void phoHFilePackChunk(phoHFilePackerTy *packerPtr, LbUsOneByte *recordBuffer,
+			LbUsFourByte recordBytes);
+Boolean phoHFileIndexChunk(phoHFilePackerTy *packerPtr, LbUsEightByte offset,
+			phoHFileChunkHdrTy *chunkHdr);
+Boolean phoHFileWriteIndex(PhoHFileHkTy *hdrHkTyPtr);
+Boolean phoHFileAppendChunks(PhoHFileHkTy *hdrHkTyPtr, FILE *partFile);
+double phoHFileSampleBits(LbUsEightByte *sample, LbUsFourByte count, LbUsFourByte size);
+void phoHFileGatherField(LbUsOneByte *records, LbUsFourByte recordSize,
+			LbUsFourByte count, LbUsFourByte stride, phoHFileFieldTy *field,
+			LbUsEightByte *values);
+LbUsFourByte phoHFilePackField(LbUsOneByte *records, LbUsFourByte recordSize,
+			LbUsFourByte count, phoHFileFieldTy *fields, LbUsFourByte fieldIndex,
+			LbUsEightByte *values, LbUsEightByte *coded, LbUsOneByte *plane,
+			LbUsOneByte *dstBuf);
+LbUsFourByte phoHFileUnpackField(LbUsOneByte *srcBuf, LbUsFourByte srcSize,
+			LbUsOneByte *records, LbUsFourByte recordSize, LbUsFourByte count,
+			phoHFileFieldTy *fields, LbUsFourByte fieldIndex, LbUsEightByte *values,
+			LbUsOneByte *plane);
+phoHFileReaderTy *phoHFileGetReader(FILE *historyFile, Boolean isNew);
+void phoHFileFreeReader(phoHFileReaderTy *readerPtr);
+Boolean phoHFileReadChunk(FILE *historyFile, phoHFileReaderTy **readerPtr);
+Boolean phoHFileDecodeChunk(phoHFileReaderTy *readerPtr, phoHFileChunkHdrTy *chunkHdrPtr,
+			LbUsOneByte *chunkData);
+PhoHFileEventType phoHFileNextChunkEvent(phoHFileReaderTy *readerPtr,
+			PHG_Decay *decayPtr, PHG_DetectedPhoton *photonPtr);
+void phoHFileAdviseCursor(PhoHFileCursorTy *cursorPtr);
+Boolean phoHFileCursorChunk(PhoHFileCursorTy *cursorPtr);
+Boolean phoHFileWriteRun(PhoHFileHkTy *hdrHkTyPtr);
+Boolean phoHFileSortPart(PhoHFileHkTy *hdrHkTyPtr, FILE *partFile);
+Boolean phoHFileMergeRuns(PhoHFileHkTy *hdrHkTyPtr);
+void phoHFileFreeSorter(PhoHFileHkTy *hdrHkTyPtr);
+Boolean phoHFileSortRecords(PhoHFileHkTy *hdrHkTyPtr, phoHFileSortItemTy **sortedItemsPtr,
+			LbUsFourByte *numItemsPtr);
+phoHFileSortItemTy *phoHFileRadixSort(phoHFileSortItemTy *items, phoHFileSortItemTy *scratch,
+			LbUsFourByte numItems);
+Boolean phoHFileNextSortRecord(phoHFileSortInputTy *inputPtr);
+LbUsFourByte phoHFileRecordSize(LbUsOneByte *record, LbUsFourByte available);
+LbUsEightByte phoHFileRecordKey(LbUsOneByte *record);
+void phoHFileRunPath(PhoHFileHkTy *hdrHkTyPtr, LbUsFourByte runIndex, char *runPath);
+phoHFileIndexerTy *phoHFileNewIndexer(LbUsFourByte interval, LbUsEightByte eventsStart);
+void phoHFileFreeIndexer(phoHFileIndexerTy *indexerPtr);
+Boolean phoHFileIndexRecords(phoHFileIndexerTy *indexerPtr, LbUsOneByte *records,
+			LbUsFourByte bytes, LbUsFourByte *usedPtr);
+Boolean phoHFileWriteDecayIndex(phoHFileIndexerTy *indexerPtr, char *histFilePath);
 			
 /*********************************************************************************
 *
@@ -250,6 +542,11 @@ Boolean PhoHFileClose(PhoHFileHkTy *hdrHkTyPtr)
 	else {
 		do { /* Process Loop */
 
+			/* Write out any records still in the buffer */
+			if (PhoHFileEndWrites(hdrHkTyPtr) == false) {
+				break;
+			}
+			
 			/* Update the image header, if its file exists */
 			if (hdrHkTyPtr->headerHk.fileRef) {
 				if (PhgHdrUpHeader(hdrHkTyPtr->histFile, &hdrHkTyPtr->header,
@@ -265,12 +562,228 @@ Boolean PhoHFileClose(PhoHFileHkTy *hdrHkTyPtr)
 				break;
 			}
 			
+			/* Write its decay index, if requested */
+			if (PhoHFileEndIndex(hdrHkTyPtr) == false) {
+				break;
+			}
+			
 			okay = true;
 		} while (false);
 	}
 	
 	/* Clear the file hook to prevent abuse */
 	hdrHkTyPtr->histFile = 0;
+	if (hdrHkTyPtr->recordBuffer != 0) {
+		LbMmFree((void **)&hdrHkTyPtr->recordBuffer);
+	}
+	hdrHkTyPtr->recordBufferSize = 0;
+	hdrHkTyPtr->recordBufferUsed = 0;
+	if (hdrHkTyPtr->indexer != 0) {
+		phoHFileFreeIndexer((phoHFileIndexerTy *) hdrHkTyPtr->indexer);
+		hdrHkTyPtr->indexer = 0;
+	}
+	
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:			PhoHFileOpenPart
+*
+*			Summary:		Send a block's history writes to a part file.  The
+*							history file is set aside untouched until the part
+*							file is closed.
+*
+*			Arguments:
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*				char			*partPath		- The path of the part file
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean PhoHFileOpenPart(PhoHFileHkTy *hdrHkTyPtr, char *partPath)	
+{
+	Boolean	okay = false;	/* Success flag */
+	
+	do { /* Process Loop */
+	
+		/* Records written so far belong to the history file */
+		if (PhoHFileFlush(hdrHkTyPtr) == false) {
+			break;
+		}
+		
+		/* Part file chunks are indexed when they are appended */
+		if (hdrHkTyPtr->packer != 0) {
+			((phoHFilePackerTy *) hdrHkTyPtr->packer)->isIndexing = false;
+		}
+		
+		/* Create the part file */
+		hdrHkTyPtr->mainHistFile = hdrHkTyPtr->histFile;
+		if ((hdrHkTyPtr->histFile = LbFlFileOpen(partPath, phoHFileOpenMode)) == 0) {
+			hdrHkTyPtr->histFile = hdrHkTyPtr->mainHistFile;
+			sprintf(phoHFileErrString, "Unable to open history part file named '%s'",
+				partPath);
+			ErStFileError(phoHFileErrString);
+			break;
+		}
+		
+		okay = true;
+	} while (false);
+	
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:			PhoHFileClosePart
+*
+*			Summary:		Close the part file opened by PhoHFileOpenPart and
+*							go back to the history file.
+*
+*			Arguments:
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean PhoHFileClosePart(PhoHFileHkTy *hdrHkTyPtr)	
+{
+	Boolean	okay = true;	/* Success flag */
+	
+	/* The buffered records belong to the part file */
+	if (PhoHFileFlush(hdrHkTyPtr) == false) {
+		okay = false;
+	}
+	
+	if (fclose(hdrHkTyPtr->histFile) != 0) {
+		ErStGeneric("Error closing history part file.");
+		okay = false;
+	}
+	
+	/* Go back to the history file */
+	hdrHkTyPtr->histFile = hdrHkTyPtr->mainHistFile;
+	hdrHkTyPtr->mainHistFile = 0;
+	if (hdrHkTyPtr->packer != 0) {
+		((phoHFilePackerTy *) hdrHkTyPtr->packer)->isIndexing = true;
+		((phoHFilePackerTy *) hdrHkTyPtr->packer)->nextChunkOffset =
+			(LbUsEightByte) ftello(hdrHkTyPtr->histFile);
+	}
+	
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:			PhoHFileAppendPart
+*
+*			Summary:		Append the records of a part file to the history file
+*							and remove the part file.
+*
+*			Arguments:
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*				char			*partPath		- The path of the part file
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean PhoHFileAppendPart(PhoHFileHkTy *hdrHkTyPtr, char *partPath)	
+{
+	Boolean				okay = false;		/* Success flag */
+	FILE				*partFile = 0;		/* The part file */
+	size_t				bytesRead;			/* Bytes read from the part file */
+	LbUsFourByte		bytesHeld = 0;		/* Bytes of a record held over for indexing */
+	LbUsFourByte		indexedBytes;		/* Bytes of whole records indexed */
+	phoHFileIndexerTy	*indexerPtr;		/* The history file's decay index, if any */
+	LbUsOneByte			copyBuffer[65536];	/* Buffer for copying */
+	
+	do { /* Process Loop */
+	
+		/* Open the part file */
+		if ((partFile = LbFlFileOpen(partPath, "rb")) == 0) {
+			sprintf(phoHFileErrString, "Unable to open history part file named '%s'",
+				partPath);
+			ErStFileError(phoHFileErrString);
+			break;
+		}
+		
+		/* A file written in time order sorts them with its own */
+		if (PHOHFILE_IsSorting(hdrHkTyPtr)) {
+			if (phoHFileSortPart(hdrHkTyPtr, partFile) == false) {
+				sprintf(phoHFileErrString, "Unable to sort history part file named '%s'",
+					partPath);
+				ErStFileError(phoHFileErrString);
+				break;
+			}
+			
+			okay = true;
+			break;
+		}
+		
+		/* Copy its records to the end of the history file */
+		if (PhoHFileFlush(hdrHkTyPtr) == false) {
+			break;
+		}
+		if (fseek(hdrHkTyPtr->histFile, 0, SEEK_END) != 0) {
+			ErStFileError("Unable to seek to end of history file (PhoHFileAppendPart).");
+			break;
+		}
+		
+		/* Compressed chunks are copied one by one so they can be indexed */
+		if (hdrHkTyPtr->isCompressed) {
+			if (phoHFileAppendChunks(hdrHkTyPtr, partFile) == false) {
+				sprintf(phoHFileErrString, "Unable to append history part file named '%s'",
+					partPath);
+				ErStFileError(phoHFileErrString);
+				break;
+			}
+			
+			okay = true;
+			break;
+		}
+		
+		/* Index the records as they are copied, holding over the start of a
+			record that doesn't fit in the copy buffer
+		*/
+		indexerPtr = (phoHFileIndexerTy *) hdrHkTyPtr->indexer;
+		while ((bytesRead = fread(copyBuffer + bytesHeld, 1, sizeof(copyBuffer) - bytesHeld,
+				partFile)) != 0) {
+			
+			if (fwrite(copyBuffer + bytesHeld, 1, bytesRead, hdrHkTyPtr->histFile) != bytesRead) {
+				ErStFileError("Unable to write to history file (PhoHFileAppendPart).");
+				goto FAIL;
+			}
+			if (indexerPtr != 0) {
+				if (phoHFileIndexRecords(indexerPtr, copyBuffer, bytesHeld + bytesRead,
+						&indexedBytes) == false) {
+					goto FAIL;
+				}
+				bytesHeld += bytesRead - indexedBytes;
+				memmove(copyBuffer, copyBuffer + indexedBytes, bytesHeld);
+			}
+		}
+		if (ferror(partFile)) {
+			sprintf(phoHFileErrString, "Unable to read history part file named '%s'",
+				partPath);
+			ErStFileError(phoHFileErrString);
+			break;
+		}
+		if (bytesHeld != 0) {
+			sprintf(phoHFileErrString, "History part file named '%s' ends part way through a record",
+				partPath);
+			ErStGeneric(phoHFileErrString);
+			break;
+		}
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	/* Close and remove the part file */
+	if (partFile != 0) {
+		fclose(partFile);
+		if (okay)
+			remove(partPath);
+	}
 	
 	return (okay);
 }
@@ -295,6 +808,17 @@ Boolean PhoHFileCreate(char *histFilePath, char *histParamsFilePath,
 {
 	Boolean	okay = false;		/* Process flags */
 	
+	/* Clear the record buffer, the hook may not have been initialized */
+	hdrHkTyPtr->recordBuffer = 0;
+	hdrHkTyPtr->recordBufferSize = 0;
+	hdrHkTyPtr->recordBufferUsed = 0;
+	hdrHkTyPtr->writer = 0;
+	hdrHkTyPtr->isCompressed = false;
+	hdrHkTyPtr->packer = 0;
+	hdrHkTyPtr->indexer = 0;
+	hdrHkTyPtr->sorter = 0;
+	hdrHkTyPtr->mainHistFile = 0;
+	
 	do { /* Process Loop */
 		
 		/* Set our type flags, used later on for marking what type of event is being written */
@@ -343,6 +867,41 @@ Boolean PhoHFileCreate(char *histFilePath, char *histParamsFilePath,
 		hdrHkTyPtr->pinksReceived = 0;
 		hdrHkTyPtr->pinksAccepted = 0;
 		
+		/* Standard format files may be compressed */
+		if (PhoHFileSetCompressed(hdrHkTyPtr, PHG_IsCompressHistoryFiles()) == false) {
+			break;
+		}
+		
+		/* Uncompressed standard format files may be indexed as they are written */
+		if (PhoHFileSetIndexed(hdrHkTyPtr, PhgRunTimeParams.PhgHistoryIndexInterval) == false) {
+			break;
+		}
+		
+		/* Allocate the buffer that collects records for writing */
+		if ((hdrHkTyPtr->recordBuffer = (LbUsOneByte *)
+				LbMmAlloc(PHOHFILE_BUFFER_SIZE)) == 0) {
+			break;
+		}
+		hdrHkTyPtr->recordBufferSize = PHOHFILE_BUFFER_SIZE;
+		
+		/* Save the path, worker processes write their history beside it */
+		strncpy(hdrHkTyPtr->histFilePath, histFilePath, PATH_LENGTH-1);
+		hdrHkTyPtr->histFilePath[PATH_LENGTH-1] = '\0';
+		
+		/* Standard format files may be written in time order */
+		if (PhoHFileSetSorted(hdrHkTyPtr, PhgRunTimeParams.PhgHistorySortBufferSize) == false) {
+			break;
+		}
+		
+		/* Register the file and its counters with the worker processes */
+		PhgParRegisterHistFile(hdrHkTyPtr);
+		PhgParRegisterSum(&hdrHkTyPtr->bluesReceived, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&hdrHkTyPtr->bluesAccepted, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&hdrHkTyPtr->pinksReceived, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&hdrHkTyPtr->pinksAccepted, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&hdrHkTyPtr->header.H.NumPhotons, PhgParEn_EightByte, 1);
+		PhgParRegisterSum(&hdrHkTyPtr->header.H.NumDecays, PhgParEn_EightByte, 1);
+		
 		okay = true;
 	} while (false);
 	return (okay);
@@ -351,463 +910,498 @@ Boolean PhoHFileCreate(char *histFilePath, char *histParamsFilePath,
 
 /*********************************************************************************
 *
-*			Name:			PhoHFilePrintParams
+*			Name:			PhoHFileFlush
 *
-*			Summary:		Print parameters for a given history file.
+*			Summary:		Write the buffered records to the history file and
+*							wait until they are written.  Records are collected
+*							in memory by the write routines and only reach the
+*							file in large blocks.  The file may be used directly
+*							once this returns.
 *
 *			Arguments:
-*				PhoHFileHkTy 		*hdrHkTyPtr			- The header hook
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
 *
-*			Function return: none.
+*			Function return: True unless an error occurs.
 *
 *********************************************************************************/
-void PhoHFilePrintParams(PhoHFileHkTy *hdrHkTyPtr)	
+Boolean PhoHFileFlush(PhoHFileHkTy *hdrHkTyPtr)	
 {
-	PhoHFileRunTimeParamsTy	*params = &hdrHkTyPtr->customParams;	/* Just a short cut for accessing the parameters */
-
-	LbInPrintf("\n\n\t\tParameters for history file '%s'\n", hdrHkTyPtr->customParamsName);
-
-	if (hdrHkTyPtr->customParams.doXposition == true) {
-		LbInPrintf("\n\t\tWriting X-position");
-	}
-	if (hdrHkTyPtr->customParams.doXrange == true) {
-		LbInPrintf("\n\t\t\tX-position range = [%3.2f, %3.2f] cm", params->xPosMin, params->xPosMax);
-	}
-
-	if (hdrHkTyPtr->customParams.doYposition == true) {
-		LbInPrintf("\n\t\tWriting Y-position");
-	}
-
-	if (hdrHkTyPtr->customParams.doYrange == true) {
-		LbInPrintf("\n\t\t\tY-position range = [%3.2f, %3.2f] cm", params->yPosMin, params->yPosMax);
-	}
-
-	if (hdrHkTyPtr->customParams.doZposition == true) {
-		LbInPrintf("\n\t\tWriting Z-position");
+	Boolean	okay = true;	/* Success flag */
+	
+	if ((hdrHkTyPtr->recordBufferUsed != 0) && (hdrHkTyPtr->histFile != 0)) {
+		okay = phoHFilePassBuffer(hdrHkTyPtr);
 	}
+	hdrHkTyPtr->recordBufferUsed = 0;
+	
+	#ifdef PHOHFILE_ASYNC_WRITES
+		/* Wait for the writer and let it go, so no thread holds the file */
+		if (hdrHkTyPtr->writer != 0) {
+			if (phoHFileStopWriter(hdrHkTyPtr) == false) {
+				okay = false;
+			}
+		}
+	#endif
+	
+	return (okay);
+}
 
-	if (hdrHkTyPtr->customParams.doZrange == true) {
-		LbInPrintf("\n\t\t\tZ-position range = [%3.2f, %3.2f] cm", params->zPosMin, params->zPosMax);
+/*********************************************************************************
+*
+*			Name:			phoHFilePassBuffer
+*
+*			Summary:		Pass the full record buffer on to be written.  With
+*							asynchronous writes the buffer is exchanged for the
+*							writer thread's spare, waiting first if the thread is
+*							still writing the previous one; this bounds the memory
+*							used while letting tracking continue during the write.
+*							Compressed files are packed by whoever writes the
+*							buffer, so with asynchronous writes the packing is
+*							also taken off the tracking thread.
+*
+*			Arguments:
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean phoHFilePassBuffer(PhoHFileHkTy *hdrHkTyPtr)	
+{
+	Boolean				okay = false;	/* Success flag */
+	phoHFilePackerTy	*packerPtr = 0;	/* Compressed writing state */
+	LbUsFourByte		indexedBytes;	/* Bytes of records indexed */
+	
+	#ifdef PHOHFILE_ASYNC_WRITES
+		phoHFileWriterTy	*writerPtr;		/* The writer thread */
+		LbUsOneByte			*spareBuffer;	/* The writer's spare buffer */
+		LbUsFourByte		spareSize;		/* Size of the spare */
+	#endif
+	
+	do { /* Process Loop */
+	
+		/* The records of a file written in time order are sorted into a run */
+		if (PHOHFILE_IsSorting(hdrHkTyPtr)) {
+			okay = phoHFileWriteRun(hdrHkTyPtr);
+			break;
+		}
+		
+		if (hdrHkTyPtr->isCompressed) {
+			if ((packerPtr = phoHFileGetPacker(hdrHkTyPtr)) == 0) {
+				break;
+			}
+		}
+		
+		/* Index the records of the history file itself; part files are indexed
+			when they are appended
+		*/
+		if ((hdrHkTyPtr->indexer != 0) && (hdrHkTyPtr->mainHistFile == 0)) {
+			if (phoHFileIndexRecords((phoHFileIndexerTy *) hdrHkTyPtr->indexer,
+					hdrHkTyPtr->recordBuffer, hdrHkTyPtr->recordBufferUsed,
+					&indexedBytes) == false) {
+				break;
+			}
+		}
+		
+		#ifdef PHOHFILE_ASYNC_WRITES
+			/* Start the writer with the first full buffer */
+			if (hdrHkTyPtr->writer == 0) {
+				if (phoHFileStartWriter(hdrHkTyPtr) == false) {
+					break;
+				}
+			}
+			writerPtr = (phoHFileWriterTy *) hdrHkTyPtr->writer;
+			
+			/* Wait for the previous buffer to be written */
+			pthread_mutex_lock(&writerPtr->lock);
+			while (writerPtr->isBusy) {
+				pthread_cond_wait(&writerPtr->changed, &writerPtr->lock);
+			}
+			if (writerPtr->isFailed) {
+				pthread_mutex_unlock(&writerPtr->lock);
+				ErStFileError("Unable to write records to history binary file (phoHFilePassBuffer).");
+				break;
+			}
+			
+			/* Make room to pack the buffer while the writer is idle */
+			if ((packerPtr != 0) &&
+					(phoHFileSizePacker(packerPtr, hdrHkTyPtr->recordBufferUsed) == false)) {
+				
+				pthread_mutex_unlock(&writerPtr->lock);
+				break;
+			}
+			
+			/* Exchange the full buffer for the spare */
+			spareBuffer = writerPtr->buffer;
+			spareSize = writerPtr->bufferSize;
+			writerPtr->buffer = hdrHkTyPtr->recordBuffer;
+			writerPtr->bufferSize = hdrHkTyPtr->recordBufferSize;
+			writerPtr->bufferUsed = hdrHkTyPtr->recordBufferUsed;
+			writerPtr->packer = packerPtr;
+			writerPtr->histFile = hdrHkTyPtr->histFile;
+			writerPtr->isBusy = true;
+			hdrHkTyPtr->recordBuffer = spareBuffer;
+			hdrHkTyPtr->recordBufferSize = spareSize;
+			hdrHkTyPtr->recordBufferUsed = 0;
+			
+			pthread_cond_broadcast(&writerPtr->changed);
+			pthread_mutex_unlock(&writerPtr->lock);
+		#else
+			if (packerPtr != 0) {
+				if (phoHFileSizePacker(packerPtr, hdrHkTyPtr->recordBufferUsed) == false) {
+					break;
+				}
+				phoHFilePackChunk(packerPtr, hdrHkTyPtr->recordBuffer,
+					hdrHkTyPtr->recordBufferUsed);
+				if (fwrite(packerPtr->packedBuffer, 1, packerPtr->packedBufferUsed,
+						hdrHkTyPtr->histFile) != packerPtr->packedBufferUsed) {
 					
-	}
+					ErStFileError("Unable to write records to history binary file (phoHFilePassBuffer).");
+					break;
+				}
+			}
+			else if (fwrite(hdrHkTyPtr->recordBuffer, 1, hdrHkTyPtr->recordBufferUsed,
+					hdrHkTyPtr->histFile) != hdrHkTyPtr->recordBufferUsed) {
+				
+				ErStFileError("Unable to write records to history binary file (phoHFilePassBuffer).");
+				break;
+			}
+			hdrHkTyPtr->recordBufferUsed = 0;
+		#endif
+		
+		okay = true;
+	} while (false);
+	
+	return (okay);
+}
 
-	if (hdrHkTyPtr->customParams.doXcosine == true) {
-		LbInPrintf("\n\t\tWriting cosine-X");
-	}
+#ifdef PHOHFILE_ASYNC_WRITES
+/*********************************************************************************
+*
+*			Name:			phoHFileStartWriter
+*
+*			Summary:		Create the thread that writes the full record buffers,
+*							along with its spare buffer.
+*
+*			Arguments:
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean phoHFileStartWriter(PhoHFileHkTy *hdrHkTyPtr)	
+{
+	Boolean				okay = false;		/* Success flag */
+	phoHFileWriterTy	*writerPtr = 0;		/* The new writer */
+	
+	do { /* Process Loop */
+	
+		if ((writerPtr = (phoHFileWriterTy *) LbMmAlloc(sizeof(phoHFileWriterTy))) == 0) {
+			break;
+		}
+		if ((writerPtr->buffer = (LbUsOneByte *) LbMmAlloc(PHOHFILE_BUFFER_SIZE)) == 0) {
+			LbMmFree((void **)&writerPtr);
+			break;
+		}
+		writerPtr->bufferSize = PHOHFILE_BUFFER_SIZE;
+		writerPtr->bufferUsed = 0;
+		writerPtr->packer = 0;
+		writerPtr->histFile = hdrHkTyPtr->histFile;
+		writerPtr->isBusy = false;
+		writerPtr->isStopping = false;
+		writerPtr->isFailed = false;
+		
+		pthread_mutex_init(&writerPtr->lock, NULL);
+		pthread_cond_init(&writerPtr->changed, NULL);
+		if (pthread_create(&writerPtr->thread, NULL, phoHFileWriterMain, writerPtr) != 0) {
+			pthread_cond_destroy(&writerPtr->changed);
+			pthread_mutex_destroy(&writerPtr->lock);
+			LbMmFree((void **)&writerPtr->buffer);
+			LbMmFree((void **)&writerPtr);
+			ErStGeneric("Unable to start history file writer thread (phoHFileStartWriter).");
+			break;
+		}
+		
+		hdrHkTyPtr->writer = writerPtr;
+		okay = true;
+	} while (false);
+	
+	return (okay);
+}
 
-	if (hdrHkTyPtr->customParams.doXCosRange == true) {
-		LbInPrintf("\n\t\t\tX-cosine range = [%3.2f, %3.2f] rd", params->xCosMin, params->xCosMax);
-	}
-
-	if (hdrHkTyPtr->customParams.doYcosine == true) {
-		LbInPrintf("\n\t\tWriting cosine-Y");
-	}
-
-	if (hdrHkTyPtr->customParams.doYCosRange == true) {
-		LbInPrintf("\n\t\t\tY-cosine range = [%3.2f, %3.2f] rd", params->yCosMin, params->yCosMax);
-	}
-
-	if (hdrHkTyPtr->customParams.doZcosine == true) {
-		LbInPrintf("\n\t\tWriting cosine-Z");
-	}
-
-	if (hdrHkTyPtr->customParams.doZCosRange == true) {
-		LbInPrintf("\n\t\t\tZ-cosine range = [%3.2f, %3.2f] rd", params->zCosMin, params->zCosMax);
-	}
-
-	if (hdrHkTyPtr->customParams.doScattersInObject == true) {
-		LbInPrintf("\n\t\tWriting number of scatters in object");
-	}
-
-	if (hdrHkTyPtr->customParams.doObjScatRange == true) {
-		LbInPrintf("\n\t\t\tNumber of scatters in object range = [%d, %d] ", params->objScattersMin, params->objScattersMax);
-	}
-
-	if (hdrHkTyPtr->customParams.doScattersInCollimator == true) {
-		LbInPrintf("\n\t\tWriting number of scatters in collimator");
-	}
-
-	if (hdrHkTyPtr->customParams.doColScatRange == true) {
-		LbInPrintf("\n\t\t\tNumber of scatters in collimator range = [%d, %d] ", params->colScattersMin, params->colScattersMax);
-	}
-
-	if (hdrHkTyPtr->customParams.doDecayWeight == true) {
-		LbInPrintf("\n\t\tWriting decay weight");
-	}
-
-	if (hdrHkTyPtr->customParams.doWeight == true) {
-		LbInPrintf("\n\t\tWriting photon weight");
-	}
-
-	if (hdrHkTyPtr->customParams.doEnergy == true) {
-		LbInPrintf("\n\t\tWriting energy");
-	}
-
-	if (hdrHkTyPtr->customParams.doEnergyRange == true) {
-		LbInPrintf("\n\t\t\tEnergy range = [%3.2f, %3.2f] keV", params->energyMin, params->energyMax);
-	}
-
-	if (hdrHkTyPtr->customParams.doTravelDistance == true) {
-		LbInPrintf("\n\t\tWriting travel distance");
-	}
-
-	if (hdrHkTyPtr->customParams.doTravDistRange == true) {
-		LbInPrintf("\n\t\t\tTravel distance range = [%3.2f, %3.2f] cm", params->travelDistanceMin, params->travelDistanceMax);
-	}
-
-	if (hdrHkTyPtr->customParams.doDecayXposition == true) {
-		LbInPrintf("\n\t\tWriting decay's X-position");
-	}
-
-	if (hdrHkTyPtr->customParams.doDecayXrange == true) {
-		LbInPrintf("\n\t\t\tDecay's X-position range = [%3.2f, %3.2f] cm", params->decayXPosMin, params->decayXPosMax);
-	}
-
-	if (hdrHkTyPtr->customParams.doDecayYposition == true) {
-		LbInPrintf("\n\t\tWriting decay's Y-position");
-	}
-
-	if (hdrHkTyPtr->customParams.doDecayYrange == true) {
-		LbInPrintf("\n\t\t\tDecay's Y-position range = [%3.2f, %3.2f] cm", params->decayYPosMin, params->decayYPosMax);
-	}
-
-	if (hdrHkTyPtr->customParams.doDecayZposition == true) {
-		LbInPrintf("\n\t\tWriting decay's Z-position");
-	}
-
-	if (hdrHkTyPtr->customParams.doDecayZrange == true) {
-		LbInPrintf("\n\t\t\tDecay's Z-position range = [%3.2f, %3.2f] cm", params->decayZPosMin, params->decayZPosMax);
-	}
-
-	if (hdrHkTyPtr->customParams.doDecayTime == true) {
-		LbInPrintf("\n\t\tWriting decay time");
-	}
-
-	if (hdrHkTyPtr->customParams.doDecayType == true) {
-		LbInPrintf("\n\t\tWriting decay type");
-	}
-
-	if (hdrHkTyPtr->customParams.doTransaxialDistance == true) {
-		LbInPrintf("\n\t\tWriting transaxial distance");
-	}
-
-	if (hdrHkTyPtr->customParams.doTransDistRange == true) {
-		LbInPrintf("\n\t\t\tTransaxial distance range = [%3.2f, %3.2f] cm", params->transaxialDistanceMin, params->transaxialDistanceMax);
-	}
-
-	if (hdrHkTyPtr->customParams.doAzimuthalAngleIndex == true) {
-		LbInPrintf("\n\t\tWriting azimuthal angle index");
-	}
-
-	if (hdrHkTyPtr->customParams.doAziAngRange == true) {
-		LbInPrintf("\n\t\t\tAzimuthal angle index range = [%d, %d] ", params->aaIndexMin, params->aaIndexMax);
-	}
-
-	if (hdrHkTyPtr->customParams.doAxialPosition == true) {
-		LbInPrintf("\n\t\tWriting axial position");
-	}
-
-	if (hdrHkTyPtr->customParams.doAxiPosRange == true) {
-		LbInPrintf("\n\t\t\tAxial poition range = [%3.2f, %3.2f] cm", params->axialPositionMin, params->axialPositionMax);
-	}
-
-	if (hdrHkTyPtr->customParams.doDetectorXposition == true) {
-		LbInPrintf("\n\t\tWriting detector X-position");
-	}
-
-	if (hdrHkTyPtr->customParams.doDetectorXposRange == true) {
-		LbInPrintf("\n\t\t\tDetector X-position range = [%3.2f, %3.2f] cm", params->detectorXpositionMin, params->detectorXpositionMax);
-	}
-
-	if (hdrHkTyPtr->customParams.doDetectorYposition == true) {
-		LbInPrintf("\n\t\tWriting detector Y-position");
-	}
-
-	if (hdrHkTyPtr->customParams.doDetectorYposRange == true) {
-		LbInPrintf("\n\t\t\tDetector Y-position range = [%3.2f, %3.2f] cm", params->detectorYpositionMin, params->detectorYpositionMax);
-	}
-
-	if (hdrHkTyPtr->customParams.doDetectorZposition == true) {
-		LbInPrintf("\n\t\tWriting detector Z-position");
+/*********************************************************************************
+*
+*			Name:			phoHFileStopWriter
+*
+*			Summary:		Wait for the writer thread to finish its buffer, then
+*							end the thread and free it.
+*
+*			Arguments:
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*
+*			Function return: True unless a write failed.
+*
+*********************************************************************************/
+Boolean phoHFileStopWriter(PhoHFileHkTy *hdrHkTyPtr)	
+{
+	Boolean				okay;		/* Success flag */
+	phoHFileWriterTy	*writerPtr;	/* The writer */
+	
+	writerPtr = (phoHFileWriterTy *) hdrHkTyPtr->writer;
+	
+	pthread_mutex_lock(&writerPtr->lock);
+	writerPtr->isStopping = true;
+	pthread_cond_broadcast(&writerPtr->changed);
+	pthread_mutex_unlock(&writerPtr->lock);
+	pthread_join(writerPtr->thread, NULL);
+	
+	okay = !writerPtr->isFailed;
+	if (!okay) {
+		ErStFileError("Unable to write records to history binary file (phoHFileStopWriter).");
 	}
+	
+	pthread_cond_destroy(&writerPtr->changed);
+	pthread_mutex_destroy(&writerPtr->lock);
+	LbMmFree((void **)&writerPtr->buffer);
+	LbMmFree((void **)&writerPtr);
+	hdrHkTyPtr->writer = 0;
+	
+	return (okay);
+}
 
-	if (hdrHkTyPtr->customParams.doDetectorZposRange == true) {
-		LbInPrintf("\n\t\t\tDetector Z-position range = [%3.2f, %3.2f] cm", params->detectorZpositionMin, params->detectorZpositionMax);
+/*********************************************************************************
+*
+*			Name:			phoHFileWriterMain
+*
+*			Summary:		The writer thread.  Writes each buffer it is passed,
+*							packing it first for a compressed file, until it is
+*							told to stop.  Errors are left for the tracking thread
+*							to report.
+*
+*			Arguments:
+*				void	*writerPtr		- The writer
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void *phoHFileWriterMain(void *writerPtr)	
+{
+	phoHFileWriterTy	*writer = (phoHFileWriterTy *) writerPtr;	/* The writer */
+	phoHFilePackerTy	*packerPtr;									/* Packs the buffer, or 0 */
+	Boolean				wrote;										/* Write flag */
+	
+	pthread_mutex_lock(&writer->lock);
+	for (;;) {
+		while (!writer->isBusy && !writer->isStopping) {
+			pthread_cond_wait(&writer->changed, &writer->lock);
+		}
+		if (!writer->isBusy) {
+			break;
+		}
+		
+		/* Pack and write the buffer without holding the lock */
+		pthread_mutex_unlock(&writer->lock);
+		packerPtr = writer->packer;
+		if (packerPtr != 0) {
+			phoHFilePackChunk(packerPtr, writer->buffer, writer->bufferUsed);
+			wrote = (fwrite(packerPtr->packedBuffer, 1, packerPtr->packedBufferUsed,
+				writer->histFile) == packerPtr->packedBufferUsed);
+		}
+		else {
+			wrote = (fwrite(writer->buffer, 1, writer->bufferUsed, writer->histFile) ==
+				writer->bufferUsed);
+		}
+		pthread_mutex_lock(&writer->lock);
+		
+		if (!wrote) {
+			writer->isFailed = true;
+		}
+		writer->bufferUsed = 0;
+		writer->packer = 0;
+		writer->isBusy = false;
+		pthread_cond_broadcast(&writer->changed);
 	}
+	pthread_mutex_unlock(&writer->lock);
+	
+	return (NULL);
+}
+#endif
 
-	if (hdrHkTyPtr->customParams.doDetectorAngle == true) {
-		LbInPrintf("\n\t\tWriting detector angle");
+/*********************************************************************************
+*
+*			Name:			PhoHFileEndWrites
+*
+*			Summary:		Write the buffered records to the history file and
+*							free the buffer.  Must be called before the header is
+*							updated by anyone closing the file without
+*							PhoHFileClose.
+*
+*			Arguments:
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean PhoHFileEndWrites(PhoHFileHkTy *hdrHkTyPtr)	
+{
+	Boolean	okay = true;	/* Success flag */
+	
+	/* Write the records of a file written in time order, merging its runs */
+	if (PHOHFILE_IsSorting(hdrHkTyPtr) && (hdrHkTyPtr->recordBuffer != 0) &&
+			(hdrHkTyPtr->histFile != 0)) {
+		
+		okay = phoHFileMergeRuns(hdrHkTyPtr);
 	}
-
-	if (hdrHkTyPtr->customParams.doDetectorAngleRange == true) {
-		LbInPrintf("\n\t\t\tDetector angle range = [%3.2f, %3.2f] radians", params->detectorAngleMin, params->detectorAngleMax);
+	phoHFileFreeSorter(hdrHkTyPtr);
+	
+	if (PhoHFileFlush(hdrHkTyPtr) == false) {
+		okay = false;
 	}
-
-	if (hdrHkTyPtr->customParams.doNumDetectorInteractions == true) {
-		LbInPrintf("\n\t\tWriting number of detector interactions");
+	
+	/* Finish a compressed file with its chunk index */
+	if (okay && hdrHkTyPtr->isCompressed && (hdrHkTyPtr->recordBuffer != 0) &&
+			(hdrHkTyPtr->histFile != 0) && (hdrHkTyPtr->mainHistFile == 0)) {
+		
+		okay = phoHFileWriteIndex(hdrHkTyPtr);
 	}
-
-	if (hdrHkTyPtr->customParams.doDetectorCrystal == true) {
-		LbInPrintf("\n\t\tWriting detector crystal for detection");
+	phoHFileFreePacker(hdrHkTyPtr);
+	
+	if (hdrHkTyPtr->recordBuffer != 0) {
+		LbMmFree((void **)&hdrHkTyPtr->recordBuffer);
 	}
-
+	hdrHkTyPtr->recordBufferSize = 0;
+	hdrHkTyPtr->recordBufferUsed = 0;
+	
+	return (okay);
 }
 
 /*********************************************************************************
 *
-*			Name:			PhoHFilePrintReport
+*			Name:			PhoHFileEndIndex
 *
-*			Summary:		Print report for a given history file.
+*			Summary:		Write the decay index built while the history file
+*							was written, if it is being indexed, and free it.
+*							Call once the file has been closed; PhoHFileClose
+*							does so itself.
 *
 *			Arguments:
-*				PhoHFileHkTy 		*hdrHkTyPtr			- The header hook
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
 *
-*			Function return: none.
+*			Function return: True unless an error occurs.
 *
 *********************************************************************************/
-void PhoHFilePrintReport(PhoHFileHkTy *hdrHkTyPtr)	
+Boolean PhoHFileEndIndex(PhoHFileHkTy *hdrHkTyPtr)	
 {
-	LbInPrintf("\n\n\tNumber of blue photons reaching history file = %lld", hdrHkTyPtr->bluesReceived);
-	LbInPrintf("\n\tNumber of blue photons written to history file = %lld", hdrHkTyPtr->bluesAccepted);
-	LbInPrintf("\n\tNumber of pink photons reaching history file = %lld", hdrHkTyPtr->pinksReceived);
-	LbInPrintf("\n\tNumber of pink photons written to history file = %lld", hdrHkTyPtr->pinksAccepted);
-	LbInPrintf("\n");
+	Boolean	okay = true;	/* Success flag */
+	
+	if (hdrHkTyPtr->indexer != 0) {
+		okay = phoHFileWriteDecayIndex((phoHFileIndexerTy *) hdrHkTyPtr->indexer,
+			hdrHkTyPtr->histFilePath);
+		
+		phoHFileFreeIndexer((phoHFileIndexerTy *) hdrHkTyPtr->indexer);
+		hdrHkTyPtr->indexer = 0;
+	}
 	
+	return (okay);
 }
 
 /*********************************************************************************
 *
-*			Name:			PhoHFileWriteDetections
+*			Name:			phoHFileBufferWrite
 *
-*			Summary:		Write the detected decay and photons.
+*			Summary:		Add data to the end of the record buffer.  The buffer
+*							grows rather than being written part way through a
+*							record, so that record counts can be filled in later.
 *
 *			Arguments:
-*				PhoHFileHkTy 		*hdrHkTyPtr		- The history hook
-*				PHG_Decay			decay			- The decay that started the process.
-*				PHG_TrackingPhoton *bluePhotons		- The blue photons detected.
-*				LbUsFourByte 		numBluePhotons	- The number of blue photons.
-*				PHG_TrackingPhoton *pinkPhotons		- The  pink photons detected.
-*				LbUsFourByte		numPinkPhotons	- The number of pink photons.
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*				void			*data			- The data to add
+*				LbUsFourByte	size			- The size of the data
+*
 *			Function return: True unless an error occurs.
 *
 *********************************************************************************/
-Boolean PhoHFileWriteDetections(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay,
-			PHG_TrackingPhoton *bluePhotons, LbUsFourByte numBluePhotons,
-			PHG_TrackingPhoton *pinkPhotons, LbUsFourByte numPinkPhotons)
+Boolean phoHFileBufferWrite(PhoHFileHkTy *hdrHkTyPtr, void *data, LbUsFourByte size)	
 {
-	Boolean				okay = false;
-	LbUsFourByte		blueIndex;
-	LbUsFourByte		pinkIndex;
-	LbUsOneByte			numBlueAccepted = 0;
-	LbUsOneByte			numPinkAccepted = 0;
-	LbFourByte			firstPos;
-	LbFourByte			secondPos;
-	PHG_DetectedPhoton	detectedPhoton;
+	Boolean			okay = false;	/* Success flag */
+	LbUsOneByte		*newBuffer;		/* Replacement for a full buffer */
+	LbUsFourByte	newSize;		/* Size of the replacement */
 	
 	do { /* Process Loop */
-
-		/* Write out the binary flag and record */
-		if ((numBluePhotons != 0) || (numPinkPhotons != 0)) {
-			if (hdrHkTyPtr->doCustom == false) {
-
-				if (fwrite(&PhoHFileDecayFlag, sizeof(LbUsOneByte), 1, hdrHkTyPtr->histFile) != 1) {
+	
+		if ((hdrHkTyPtr->recordBufferUsed + size) > hdrHkTyPtr->recordBufferSize) {
+			
+			newSize = 2*hdrHkTyPtr->recordBufferSize;
+			if (newSize < (hdrHkTyPtr->recordBufferUsed + size))
+				newSize = hdrHkTyPtr->recordBufferUsed + size + PHOHFILE_BUFFER_SIZE;
+			
+			if ((newBuffer = (LbUsOneByte *) LbMmAlloc(newSize)) == 0) {
+				break;
+			}
+			if (hdrHkTyPtr->recordBuffer != 0) {
+				memcpy(newBuffer, hdrHkTyPtr->recordBuffer, hdrHkTyPtr->recordBufferUsed);
+				LbMmFree((void **)&hdrHkTyPtr->recordBuffer);
+			}
+			hdrHkTyPtr->recordBuffer = newBuffer;
+			hdrHkTyPtr->recordBufferSize = newSize;
+		}
 		
-					ErStGeneric("Unable to write decay flag to history binary file.");
-					goto FAILURE;
-				}
-
-				if (fwrite(decay, sizeof(PHG_Decay), 1, hdrHkTyPtr->histFile) != 1) {
+		memcpy(hdrHkTyPtr->recordBuffer + hdrHkTyPtr->recordBufferUsed, data, size);
+		hdrHkTyPtr->recordBufferUsed += size;
 		
-					ErStGeneric("Unable to write decay to history binary file.");
-					goto FAILURE;
-				}							
-						
-				/* Increment count of outputed decays */
-				hdrHkTyPtr->header.H.NumDecays += 1;
-			}	
-		}
+		okay = true;
+	} while (false);
 	
-		if (hdrHkTyPtr->doCustom == false) {
-
-			/* Process coincidences */
-			for (blueIndex = 0; blueIndex < numBluePhotons; blueIndex++) {
-				
-				/* Incremement Count */
-				hdrHkTyPtr->bluesReceived++;
-			
-				/* Write out the binary flag and record */
-				if (fwrite(&PhoHFilePhotonFlag, sizeof(LbUsOneByte), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write photon flag to history binary file.");
-					goto FAILURE;
-				}
-				
-				/* Convert to detected photon */
-				phoHFileCreateDetectedPhoton(&(bluePhotons[blueIndex]),
-					&detectedPhoton);
-
-				if (fwrite(&detectedPhoton, sizeof(PHG_DetectedPhoton), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write blue photon to history binary file.");
-					goto FAILURE;
-				}
-				
-				hdrHkTyPtr->bluesAccepted++;
-			}
-		}	/* Do custom header if there is at least one photon to write */
-		else if ((numBluePhotons != 0) || (numPinkPhotons != 0)) {
-			
-			/* Clear counter */
-			numBlueAccepted = 0;
+	return (okay);
+}
 
-			/* Save current location */
-			if ((firstPos = ftell(hdrHkTyPtr->histFile)) == -1) {
-				ErStFileError("Unable to get current file position when writing photons fields (PhoHFileWriteDetections)");
-				goto FAILURE;
-			}
-			
-			/* Seek past count position */
-			if (fseek(hdrHkTyPtr->histFile, sizeof(LbUsOneByte), SEEK_CUR) != 0) {
-				ErStFileError("Unable to seek while writing photons (PhoHFileWriteDetections)");
-				goto FAILURE;
-			}
+/*********************************************************************************
+*
+*			Name:			PhoHFileSetCompressed
+*
+*			Summary:		Choose whether the history file is written in
+*							compressed chunks.  Call before any records are
+*							written; custom format files are never compressed.
+*							The indicator is set in the file's header directly,
+*							as history headers do not get the binning fields.
+*
+*			Arguments:
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*				Boolean			isCompressed	- Compress the file?
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean PhoHFileSetCompressed(PhoHFileHkTy *hdrHkTyPtr, Boolean isCompressed)	
+{
+	Boolean	okay = false;	/* Success flag */
+	Boolean	wasCompressed;	/* Previous setting */
+	
+	do { /* Process Loop */
+		
+		wasCompressed = hdrHkTyPtr->isCompressed;
+		hdrHkTyPtr->isCompressed = (isCompressed && !hdrHkTyPtr->doCustom);
+		hdrHkTyPtr->header.H.isCompressed = hdrHkTyPtr->isCompressed;
+		
+		/* Uncompressed headers leave the indicator out unless it was set */
+		if ((hdrHkTyPtr->isCompressed || wasCompressed) &&
+				(hdrHkTyPtr->headerHk.headerData != 0)) {
 			
-			/* Process coincidences */
-			for (blueIndex = 0; blueIndex < numBluePhotons; blueIndex++) {
-				
-				/* Incremement Count */
-				hdrHkTyPtr->bluesReceived++;
+			if (LbHdrStElem(&(hdrHkTyPtr->headerHk), HDR_HISTORY_FILE_IS_COMPRESSED_ID,
+					sizeof(hdrHkTyPtr->header.H.isCompressed),
+					(void *)&(hdrHkTyPtr->header.H.isCompressed)) == false){
 				
-				if (phoHFileWriteFields(hdrHkTyPtr, decay, &bluePhotons[blueIndex],
-						&numBlueAccepted) == false) {
-						
-					goto FAILURE;
-				}
-				hdrHkTyPtr->bluesAccepted += numBlueAccepted;
-			}
-			
-			/* Save current location */
-			if ((secondPos = ftell(hdrHkTyPtr->histFile)) == -1) {
-				ErStFileError("Unable to get current file position when writing photons fields (PhoHFileWriteDetections)");
-				goto FAILURE;
-			}
-			/* Seek back to count position */
-			if (fseek(hdrHkTyPtr->histFile, firstPos, SEEK_SET) != 0) {
-				ErStFileError("Unable to seek to count position while writing photons (PhoHFileWriteDetections)");
-				goto FAILURE;
-			}
-			
-			/* Write the number of blue photons */
-			if (fwrite(&numBlueAccepted, sizeof(LbUsOneByte), 1, hdrHkTyPtr->histFile) != 1) {
-
-				ErStGeneric("Unable to write number of blues accepted to history binary file (PhoHFileWriteDetections).");
-				goto FAILURE;
+				ErStGeneric("Unable to set header 'compressed indicator' parameter.");
+				break;
 			}
-			
-			/* Seek past blue photons */
-			if (fseek(hdrHkTyPtr->histFile, secondPos, SEEK_SET) != 0) {
-				ErStFileError("Unable to seek while writing photons (PhoHFileWriteDetections)");
-				goto FAILURE;
-			}			
 		}
 		
-		/* Now process pink photons */
-		if (hdrHkTyPtr->doCustom == false) {
-					
-			for (pinkIndex = 0; pinkIndex < numPinkPhotons; pinkIndex++) {
-
-				/* Incremement Count */
-				hdrHkTyPtr->pinksReceived++;
-				
-				/* Write out the binary flag and record */
-				if (fwrite(&PhoHFilePhotonFlag, sizeof(LbUsOneByte), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write photon flag to history binary file.");
-					goto FAILURE;
-				}
-
-				/* Convert to detected photon */
-				phoHFileCreateDetectedPhoton(&(pinkPhotons[pinkIndex]),
-					&detectedPhoton);	
-				
-				if (fwrite(&detectedPhoton, sizeof(PHG_DetectedPhoton), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write pink photon to history binary file.");
-					goto FAILURE;
-				}
-				
-				hdrHkTyPtr->pinksAccepted++;
-			}
-		}
-		/* Custom history file bug fix */
-		else if (PHG_IsPET() & ((numBluePhotons != 0) || (numPinkPhotons != 0))) {
-
-		       /* old code replaced by above line */
-		       /* else if (PHG_IsPET()) */
-			
-			/* Clear counter */	
-			numPinkAccepted = 0;
-
-			if ((firstPos = ftell(hdrHkTyPtr->histFile)) == -1) {
-				ErStFileError("Unable to get current file position when writing photons fields (PhoHFileWriteDetections)");
-				goto FAILURE;
-			}
-			
-			/* Seek past count position */
-			if (fseek(hdrHkTyPtr->histFile, sizeof(LbUsOneByte), SEEK_CUR) != 0) {
-				ErStFileError("Unable to seek while writing photons (PhoHFileWriteDetections)");
-				goto FAILURE;
-			}
-			
-			for (pinkIndex = 0; pinkIndex < numPinkPhotons; pinkIndex++) {
-			
-				/* Incremement Count */
-				hdrHkTyPtr->pinksReceived++;
-
-				if (phoHFileWriteFields(hdrHkTyPtr, decay, &pinkPhotons[pinkIndex],
-						&numPinkAccepted) == false) {
-
-					goto FAILURE;
-				}
-				hdrHkTyPtr->pinksAccepted += numPinkAccepted;
-			}
-			
-			/* Save current location */
-			if ((secondPos = ftell(hdrHkTyPtr->histFile)) == -1) {
-				ErStFileError("Unable to get current file position when writing photons fields (PhoHFileWriteDetections)");
-				goto FAILURE;
-			}
-			
-			/* Seek back to count position */
-			if (fseek(hdrHkTyPtr->histFile, firstPos, SEEK_SET) != 0) {
-				ErStFileError("Unable to seek to count position while writing photons (PhoHFileWriteDetections)");
-				goto FAILURE;
-			}
-			
-			/* Write the number of pink photons */
-			if (fwrite(&numPinkAccepted, sizeof(LbUsOneByte), 1, hdrHkTyPtr->histFile) != 1) {
-
-				ErStGeneric("Unable to write number of pinks accepted to history binary file (PhoHFileWriteDetections).");
-				goto FAILURE;
+		/* Compressed files carry their own chunk index instead of a decay index */
+		if (hdrHkTyPtr->isCompressed && (hdrHkTyPtr->indexer != 0)) {
+			if (PhoHFileSetIndexed(hdrHkTyPtr, 0) == false) {
+				break;
 			}
-			
-			/* Seek past pink photons */
-			if (fseek(hdrHkTyPtr->histFile, secondPos, SEEK_SET) != 0) {
-				ErStFileError("Unable to seek while writing photons (PhoHFileWriteDetections)");
-				goto FAILURE;
-			}			
 		}
 		
-		/* Increment count of outputed photons */
-		if (hdrHkTyPtr->doCustom == false) {
-			hdrHkTyPtr->header.H.NumPhotons += (numBluePhotons + numPinkPhotons);
-		}
-		else {
-			hdrHkTyPtr->header.H.NumPhotons += (numBlueAccepted + numPinkAccepted);
-		}
-
 		okay = true;
-		FAILURE:;
 	} while (false);
 	
 	return (okay);
@@ -815,584 +1409,1068 @@ Boolean PhoHFileWriteDetections(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay,
 
 /*********************************************************************************
 *
-*	Name:			PhoHFileRewriteDetections
+*			Name:			PhoHFileSetIndexed
 *
-*	Summary:		Write the decay and photons.
-*					Match the blue/pink scheme.
-*					Similar to PhoHFileWriteDetections except has 
-*					PHG_DetectedPhoton for arguments rather than
-*					PHG_TrackingPhoton.  This allows history decays
-*					to be copied more easily from file to file.
+*			Summary:		Choose whether a decay index is built as the history
+*							file is written, and written beside it once it is
+*							closed (see PhoHFileEndIndex).  Call after
+*							PhoHFileSetCompressed, before any records are
+*							written; custom format and compressed files are never
+*							indexed this way.
 *
-*	Arguments:
-*		PhoHFileHkTy 		*hdrHkTyPtr		- The history hook
-*		PHG_Decay			decay			- The decay that started the process.
-*		PHG_DetectedPhoton *bluePhotons		- The blue photons detected.
-*		LbUsFourByte 		numBluePhotons	- The number of blue photons.
-*		PHG_DetectedPhoton *pinkPhotons		- The  pink photons detected.
-*		LbUsFourByte		numPinkPhotons	- The number of pink photons.
+*			Arguments:
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*				LbUsFourByte	interval		- Decays per index entry, 0 for
+*												  no index
 *
-*	Function return: True unless an error occurs.
+*			Function return: True unless an error occurs.
 *
 *********************************************************************************/
-Boolean PhoHFileRewriteDetections(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay,
-			PHG_DetectedPhoton *bluePhotons, LbUsFourByte numBluePhotons,
-			PHG_DetectedPhoton *pinkPhotons, LbUsFourByte numPinkPhotons)
+Boolean PhoHFileSetIndexed(PhoHFileHkTy *hdrHkTyPtr, LbUsFourByte interval)	
 {
-	Boolean				okay = false;
-	LbUsFourByte		blueIndex;
-	LbUsFourByte		pinkIndex;
-	LbUsOneByte			numBlueAccepted = 0;
-	LbUsOneByte			numPinkAccepted = 0;
-	
+	Boolean	okay = false;	/* Success flag */
 	
 	do { /* Process Loop */
 		
-		/* Write out the binary flag and record */
-		if ((numBluePhotons != 0) || (numPinkPhotons != 0)) {
-			if (fwrite(&PhoHFileDecayFlag, sizeof(LbUsOneByte), 1, hdrHkTyPtr->histFile) != 1) {
-	
-				ErStGeneric("Unable to write decay flag to history binary file.");
-				goto FAILURE;
-			}
-
-			if (fwrite(decay, sizeof(PHG_Decay), 1, hdrHkTyPtr->histFile) != 1) {
-	
-				ErStGeneric("Unable to write decay to history binary file.");
-				goto FAILURE;
-			}							
-					
-			/* Increment count of outputed decays */
-			hdrHkTyPtr->header.H.NumDecays += 1;
-		}
-		
-		/* Process coincidences */
-		for (blueIndex = 0; blueIndex < numBluePhotons; blueIndex++) {
-			
-			/* Incremement Count */
-			hdrHkTyPtr->bluesReceived++;
-		
-			/* Write out the binary flag and record */
-			if (fwrite(&PhoHFilePhotonFlag, sizeof(LbUsOneByte), 1, hdrHkTyPtr->histFile) != 1) {
-
-				ErStGeneric("Unable to write photon flag to history binary file.");
-				goto FAILURE;
-			}
-			
-			/* Write out the detected photon */
-			if (fwrite(&(bluePhotons[blueIndex]), sizeof(PHG_DetectedPhoton), 1, hdrHkTyPtr->histFile) != 1) {
-
-				ErStGeneric("Unable to write blue photon to history binary file.");
-				goto FAILURE;
-			}
-			
-			hdrHkTyPtr->bluesAccepted++;
+		if (hdrHkTyPtr->indexer != 0) {
+			phoHFileFreeIndexer((phoHFileIndexerTy *) hdrHkTyPtr->indexer);
+			hdrHkTyPtr->indexer = 0;
 		}
 		
-		/* Now process pink photons */
-		for (pinkIndex = 0; pinkIndex < numPinkPhotons; pinkIndex++) {
-
-			/* Incremement Count */
-			hdrHkTyPtr->pinksReceived++;
-			
-			/* Write out the binary flag and record */
-			if (fwrite(&PhoHFilePhotonFlag, sizeof(LbUsOneByte), 1, hdrHkTyPtr->histFile) != 1) {
-
-				ErStGeneric("Unable to write photon flag to history binary file.");
-				goto FAILURE;
-			}
-
-			/* Write out the detected photon */
-			if (fwrite(&(pinkPhotons[pinkIndex]), sizeof(PHG_DetectedPhoton), 1, hdrHkTyPtr->histFile) != 1) {
-				
-				ErStGeneric("Unable to write pink photon to history binary file.");
-				goto FAILURE;
+		if ((interval != 0) && !hdrHkTyPtr->doCustom && !hdrHkTyPtr->isCompressed) {
+			if ((hdrHkTyPtr->indexer = phoHFileNewIndexer(interval,
+					(LbUsEightByte) ftello(hdrHkTyPtr->histFile))) == 0) {
+				break;
 			}
-			
-			hdrHkTyPtr->pinksAccepted++;
 		}
 		
-		/* Increment count of outputed photons */
-		if (hdrHkTyPtr->doCustom == false) {
-			hdrHkTyPtr->header.H.NumPhotons += (numBluePhotons + numPinkPhotons);
-		}
-		else {
-			hdrHkTyPtr->header.H.NumPhotons += (numBlueAccepted + numPinkAccepted);
-		}
-
 		okay = true;
-		FAILURE:;
 	} while (false);
 	
 	return (okay);
 }
 
-
 /*********************************************************************************
 *
-*			Name:			phoHFileWriteFields
+*			Name:			PhoHFileSetIndexedLike
 *
-*			Summary:		Write the detected decay and photons.
+*			Summary:		Index the history file, as PhoHFileSetIndexed, if the
+*							file it is made from has a decay index, using the
+*							same interval.  The tools that rewrite history files
+*							use this so that an indexed file's index follows it.
 *
 *			Arguments:
-*				PhoHFileHkTy 		*hdrHkTyPtr		- The history hook
-*				PHG_Decay			*decay			- The decay that started the process.
-*				PHG_TrackingPhoton 	*photon			- The blue photons detected.
-*				LbUsOneByte			*numAccepted	- Count of accepted (written)
-*			Function return: None.
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*				char			*fromFilePath	- The history file it is made from
+*
+*			Function return: True unless an error occurs.
 *
 *********************************************************************************/
-Boolean phoHFileWriteFields(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay,
-			PHG_TrackingPhoton *photon, LbUsOneByte *numAccepted)
+Boolean PhoHFileSetIndexedLike(PhoHFileHkTy *hdrHkTyPtr, char *fromFilePath)	
 {
-	Boolean			okay = false;
-	LbUsFourByte	i, size;
+	Boolean					okay = false;		/* Success flag */
+	PhoHFileDecayIndexHdrTy	indexHdr;			/* Header of the other file's index */
+	PhoHFileChunkEntryTy	*entries = 0;		/* Its entries */
 	
 	do { /* Process Loop */
-	
-		#ifdef PHG_DEBUG_INTENSELY
-			PhoHFilePrintFields(hdrHkTyPtr, decay, photon);
-		#endif
 		
-		/* First, filter acceptable photons */
-		
-		if (hdrHkTyPtr->customParams.doXrange == true) {
-			if ((photon->location.x_position < hdrHkTyPtr->customParams.xPosMin) ||
-					(photon->location.x_position > hdrHkTyPtr->customParams.xPosMax)) {
-
-				goto FILTERED_OUT;
-
-			}						
-		}
-
-		if (hdrHkTyPtr->customParams.doYrange == true) {
-			if ((photon->location.y_position < hdrHkTyPtr->customParams.yPosMin) ||
-					(photon->location.y_position > hdrHkTyPtr->customParams.yPosMax)) {
-
-				goto FILTERED_OUT;
-
-			}							
+		if (PhoHFileReadDecayIndex(fromFilePath, &indexHdr, &entries) == false) {
+			break;
 		}
-
-		if (hdrHkTyPtr->customParams.doZrange == true) {
-			if ((photon->location.z_position < hdrHkTyPtr->customParams.zPosMin) ||
-					(photon->location.z_position > hdrHkTyPtr->customParams.zPosMax)) {
-
-				goto FILTERED_OUT;
-
-			}							
+		if (entries != 0) {
+			LbMmFree((void **)&entries);
 		}
-
-		if (hdrHkTyPtr->customParams.doXCosRange == true) {
-			if ((photon->angle.cosine_x < hdrHkTyPtr->customParams.xCosMin) ||
-					(photon->angle.cosine_x > hdrHkTyPtr->customParams.xCosMax)) {
-
-				goto FILTERED_OUT;
-
-			}						
+		
+		/* A file without a current index gives an interval of 0 */
+		if (PhoHFileSetIndexed(hdrHkTyPtr, indexHdr.interval) == false) {
+			break;
 		}
+		
+		okay = true;
+	} while (false);
+	
+	return (okay);
+}
 
-		if (hdrHkTyPtr->customParams.doYCosRange == true) {
-			if ((photon->angle.cosine_y < hdrHkTyPtr->customParams.yCosMin) ||
-					(photon->angle.cosine_y > hdrHkTyPtr->customParams.yCosMax)) {
-
-				goto FILTERED_OUT;
-
-			}							
+/*********************************************************************************
+*
+*			Name:			PhoHFileSetSorted
+*
+*			Summary:		Choose whether the history file's decays are written
+*							in time order, and how many Mbytes of records are
+*							sorted at a time.  Call after PhoHFileSetCompressed,
+*							before any records are written; custom format files
+*							are never sorted.  A file whose records fit in the
+*							sort buffer is sorted in memory; otherwise sorted
+*							runs are written beside it and merged on closing.
+*
+*			Arguments:
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*				LbUsFourByte	bufferMBytes	- Mbytes sorted at a time, 0 to
+*												  write the records as they come
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean PhoHFileSetSorted(PhoHFileHkTy *hdrHkTyPtr, LbUsFourByte bufferMBytes)	
+{
+	Boolean				okay = false;		/* Success flag */
+	phoHFileSorterTy	*sorterPtr;			/* The sorting state */
+	LbUsOneByte			*newBuffer;			/* Record buffer holding a whole sort */
+	
+	do { /* Process Loop */
+		
+		if ((bufferMBytes == 0) || hdrHkTyPtr->doCustom || (hdrHkTyPtr->sorter != 0)) {
+			okay = true;
+			break;
 		}
-
-		if (hdrHkTyPtr->customParams.doZCosRange == true) {
-			if ((photon->angle.cosine_z < hdrHkTyPtr->customParams.zCosMin) ||
-					(photon->angle.cosine_z > hdrHkTyPtr->customParams.zCosMax)) {
-
-				goto FILTERED_OUT;
-
-			}							
+		
+		if ((sorterPtr = (phoHFileSorterTy *) LbMmAlloc(sizeof(phoHFileSorterTy))) == 0) {
+			break;
 		}
-
-		if (hdrHkTyPtr->customParams.doObjScatRange == true) {
-			if (((LbFourByte)photon->num_of_scatters < hdrHkTyPtr->customParams.objScattersMin) ||
-					((LbFourByte)photon->num_of_scatters > hdrHkTyPtr->customParams.objScattersMax)) {
-
-				goto FILTERED_OUT;
-
-			}						
+		memset(sorterPtr, 0, sizeof(phoHFileSorterTy));
+		if (bufferMBytes > PHOHFILE_MAX_SORT_MBYTES) {
+			bufferMBytes = PHOHFILE_MAX_SORT_MBYTES;
 		}
-
-		if (hdrHkTyPtr->customParams.doColScatRange == true) {
-			if (((LbFourByte)photon->scatters_in_col < hdrHkTyPtr->customParams.colScattersMin) ||
-					((LbFourByte)photon->scatters_in_col > hdrHkTyPtr->customParams.colScattersMax)) {
-
-				goto FILTERED_OUT;
-
-			}						
+		sorterPtr->bufferSize = bufferMBytes*1024*1024;
+		
+		/* Records only reach the file, compressed or not, once they are sorted */
+		sorterPtr->isCompressed = hdrHkTyPtr->isCompressed;
+		hdrHkTyPtr->isCompressed = false;
+		hdrHkTyPtr->sorter = sorterPtr;
+		
+		/* Collect a whole sort buffer before writing */
+		if ((newBuffer = (LbUsOneByte *) LbMmAlloc(sorterPtr->bufferSize +
+				PHOHFILE_BUFFER_SIZE)) == 0) {
+			break;
 		}
-
-		if (hdrHkTyPtr->customParams.doEnergyRange == true) {
-			if ((photon->energy < hdrHkTyPtr->customParams.energyMin) ||
-					(photon->energy > hdrHkTyPtr->customParams.energyMax)) {
-
-				goto FILTERED_OUT;
-
-			}						
+		if (hdrHkTyPtr->recordBuffer != 0) {
+			memcpy(newBuffer, hdrHkTyPtr->recordBuffer, hdrHkTyPtr->recordBufferUsed);
+			LbMmFree((void **)&hdrHkTyPtr->recordBuffer);
 		}
-
-		if (hdrHkTyPtr->customParams.doTravDistRange == true) {
-			if ((photon->travel_distance < hdrHkTyPtr->customParams.travelDistanceMin) ||
-					(photon->travel_distance > hdrHkTyPtr->customParams.travelDistanceMax)) {
-
-				goto FILTERED_OUT;
-
+		hdrHkTyPtr->recordBuffer = newBuffer;
+		hdrHkTyPtr->recordBufferSize = sorterPtr->bufferSize + PHOHFILE_BUFFER_SIZE;
+		
+		/* Mark the file as time sorted */
+		hdrHkTyPtr->header.H.isTimeSorted = true;
+		if (hdrHkTyPtr->headerHk.headerData != 0) {
+			if (LbHdrStElem(&(hdrHkTyPtr->headerHk), HDR_HISTORY_FILE_IS_SORTED_ID,
+					sizeof(hdrHkTyPtr->header.H.isTimeSorted),
+					(void *)&(hdrHkTyPtr->header.H.isTimeSorted)) == false){
+				
+				ErStGeneric("Unable to set header 'timesorted indicator' parameter.");
+				break;
 			}
 		}
+		
+		okay = true;
+	} while (false);
+	
+	return (okay);
+}
 
-		if (hdrHkTyPtr->customParams.doDecayXrange == true) {
-			if ((decay->location.x_position < hdrHkTyPtr->customParams.decayXPosMin) ||
-					(decay->location.x_position > hdrHkTyPtr->customParams.decayXPosMax)) {
-
-				goto FILTERED_OUT;
-
-			}
+/*********************************************************************************
+*
+*			Name:			phoHFileWriteRun
+*
+*			Summary:		Sort the record buffer by decay time and write it to
+*							the history file's next run file.
+*
+*			Arguments:
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean phoHFileWriteRun(PhoHFileHkTy *hdrHkTyPtr)	
+{
+	Boolean				okay = false;		/* Success flag */
+	phoHFileSorterTy	*sorterPtr;			/* The sorting state */
+	phoHFileSortItemTy	*sortedItems;		/* The buffer's decays in time order */
+	LbUsFourByte		numItems;			/* Number of decays */
+	LbUsFourByte		itemIndex;			/* LCV for the decays */
+	FILE				*runFile = 0;		/* The run file */
+	char				runPath[PATH_LENGTH+16];	/* Its path */
+	
+	sorterPtr = (phoHFileSorterTy *) hdrHkTyPtr->sorter;
+	
+	do { /* Process Loop */
+	
+		if (phoHFileSortRecords(hdrHkTyPtr, &sortedItems, &numItems) == false) {
+			break;
 		}
-
-		if (hdrHkTyPtr->customParams.doDecayYrange == true) {
-			if ((decay->location.y_position < hdrHkTyPtr->customParams.decayYPosMin) ||
-					(decay->location.y_position > hdrHkTyPtr->customParams.decayYPosMax)) {
-
-				goto FILTERED_OUT;
-
-			}
+		
+		/* Write the decays in order */
+		phoHFileRunPath(hdrHkTyPtr, sorterPtr->numRuns, runPath);
+		if ((runFile = LbFlFileOpen(runPath, "wb")) == 0) {
+			sprintf(phoHFileErrString, "Unable to create sorted history run file named '%s'",
+				runPath);
+			ErStFileError(phoHFileErrString);
+			break;
 		}
-
-		if (hdrHkTyPtr->customParams.doDecayZrange == true) {
-			if ((decay->location.z_position < hdrHkTyPtr->customParams.decayZPosMin) ||
-					(decay->location.z_position > hdrHkTyPtr->customParams.decayZPosMax)) {
-
-				goto FILTERED_OUT;
-
+		sorterPtr->numRuns++;
+		
+		for (itemIndex = 0; itemIndex < numItems; itemIndex++) {
+			if (fwrite(hdrHkTyPtr->recordBuffer + sortedItems[itemIndex].offset, 1,
+					sortedItems[itemIndex].size, runFile) != sortedItems[itemIndex].size) {
+				
+				sprintf(phoHFileErrString, "Unable to write sorted history run file named '%s'",
+					runPath);
+				ErStFileError(phoHFileErrString);
+				goto FAIL;
 			}
 		}
-
-		if (hdrHkTyPtr->customParams.doTransDistRange == true) {
-			if ((photon->transaxialPosition < hdrHkTyPtr->customParams.transaxialDistanceMin) ||
-					(photon->transaxialPosition > hdrHkTyPtr->customParams.transaxialDistanceMax)) {
-
-				goto FILTERED_OUT;
-
-			}
+		
+		if (fclose(runFile) != 0) {
+			runFile = 0;
+			sprintf(phoHFileErrString, "Unable to close sorted history run file named '%s'",
+				runPath);
+			ErStFileError(phoHFileErrString);
+			break;
 		}
+		runFile = 0;
+		hdrHkTyPtr->recordBufferUsed = 0;
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	if (runFile != 0) {
+		fclose(runFile);
+	}
+	
+	return (okay);
+}
 
-		if (hdrHkTyPtr->customParams.doAziAngRange == true) {
-			if ((photon->azimuthalAngleIndex < hdrHkTyPtr->customParams.aaIndexMin) ||
-					(photon->azimuthalAngleIndex > hdrHkTyPtr->customParams.aaIndexMax)) {
-
-				goto FILTERED_OUT;
-
-			}
+/*********************************************************************************
+*
+*			Name:			phoHFileSortPart
+*
+*			Summary:		Add the records of a worker part file to the record
+*							buffer of a file written in time order, writing a
+*							run whenever the buffer fills.
+*
+*			Arguments:
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*				FILE			*partFile		- The part file
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean phoHFileSortPart(PhoHFileHkTy *hdrHkTyPtr, FILE *partFile)	
+{
+	Boolean				okay = false;	/* Success flag */
+	phoHFileSortInputTy	partInput;		/* The part file's records */
+	
+	memset(&partInput, 0, sizeof(partInput));
+	partInput.runFile = partFile;
+	
+	do { /* Process Loop */
+	
+		if ((partInput.buffer = (LbUsOneByte *) LbMmAlloc(PHOHFILE_BUFFER_SIZE)) == 0) {
+			break;
 		}
-
-		if (hdrHkTyPtr->customParams.doAxiPosRange == true) {
-			if ((photon->axialPosition < hdrHkTyPtr->customParams.axialPositionMin) ||
-					(photon->axialPosition > hdrHkTyPtr->customParams.axialPositionMax)) {
-
-				goto FILTERED_OUT;
-
-			}
+		partInput.bufferSize = PHOHFILE_BUFFER_SIZE;
+		
+		if (phoHFileNextSortRecord(&partInput) == false) {
+			break;
 		}
-
-		if (hdrHkTyPtr->customParams.doDetectorXposRange == true) {
-			if ((photon->detLocation.x_position < hdrHkTyPtr->customParams.detectorXpositionMin) ||
-					(photon->detLocation.x_position > hdrHkTyPtr->customParams.detectorXpositionMax)) {
-
-				goto FILTERED_OUT;
-
+		while (partInput.record != 0) {
+			if (hdrHkTyPtr->recordBufferUsed >= PHOHFILE_FlushSize(hdrHkTyPtr)) {
+				if (phoHFilePassBuffer(hdrHkTyPtr) == false) {
+					goto FAIL;
+				}
 			}
-		}
-
-		if (hdrHkTyPtr->customParams.doDetectorYposRange == true) {
-			if ((photon->detLocation.y_position < hdrHkTyPtr->customParams.detectorYpositionMin) ||
-					(photon->detLocation.y_position > hdrHkTyPtr->customParams.detectorYpositionMax)) {
-
-				goto FILTERED_OUT;
-
+			if (phoHFileBufferWrite(hdrHkTyPtr, partInput.record, partInput.recordSize) == false) {
+				goto FAIL;
 			}
-		}
-
-		if (hdrHkTyPtr->customParams.doDetectorZposRange == true) {
-			if ((photon->detLocation.z_position < hdrHkTyPtr->customParams.detectorZpositionMin) ||
-					(photon->detLocation.z_position > hdrHkTyPtr->customParams.detectorZpositionMax)) {
-
-				goto FILTERED_OUT;
-
+			if (phoHFileNextSortRecord(&partInput) == false) {
+				goto FAIL;
 			}
 		}
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	if (partInput.buffer != 0) {
+		LbMmFree((void **)&partInput.buffer);
+	}
+	
+	return (okay);
+}
 
-		if (hdrHkTyPtr->customParams.doDetectorAngleRange == true) {
-			if ((photon->detectorAngle < hdrHkTyPtr->customParams.detectorAngleMin) ||
-					(photon->detectorAngle > hdrHkTyPtr->customParams.detectorAngleMax)) {
-
-				goto FILTERED_OUT;
-
-			}
+/*********************************************************************************
+*
+*			Name:			phoHFileMergeRuns
+*
+*			Summary:		Write the records of a file written in time order:
+*							the sorted record buffer merged with the run files
+*							written before it, which are then removed.  Records
+*							with equal decay times keep the order they came in.
+*
+*			Arguments:
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean phoHFileMergeRuns(PhoHFileHkTy *hdrHkTyPtr)	
+{
+	Boolean				okay = false;		/* Success flag */
+	phoHFileSorterTy	*sorterPtr;			/* The sorting state */
+	phoHFileSortInputTy	*inputs = 0;		/* The runs, then the record buffer */
+	LbUsFourByte		numInputs = 0;		/* Number of inputs set up */
+	LbUsFourByte		inputIndex;			/* LCV for the inputs */
+	LbUsFourByte		firstIndex;			/* Input with the earliest record */
+	LbUsOneByte			*sortedBuffer = 0;	/* The sorted record buffer */
+	phoHFileSortItemTy	*sortedItems;		/* Its decays in time order */
+	LbUsFourByte		numItems;			/* Number of decays */
+	char				runPath[PATH_LENGTH+16];	/* Path of a run file */
+	
+	sorterPtr = (phoHFileSorterTy *) hdrHkTyPtr->sorter;
+	
+	do { /* Process Loop */
+	
+		if (phoHFileSortRecords(hdrHkTyPtr, &sortedItems, &numItems) == false) {
+			break;
 		}
-
-		/* Now do the actual writing of fields */
-
-		if (hdrHkTyPtr->customParams.doXposition == true) {
-				if (fwrite(&photon->location.x_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'x_position' to history file.");
-					goto FAILURE;
-				}
+		if ((inputs = (phoHFileSortInputTy *) LbMmAlloc((sorterPtr->numRuns + 1) *
+				sizeof(phoHFileSortInputTy))) == 0) {
+			break;
 		}
-
-		if (hdrHkTyPtr->customParams.doYposition == true) {
-				if (fwrite(&photon->location.y_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'y_position' to history file.");
-					goto FAILURE;
-				}
+		memset(inputs, 0, (sorterPtr->numRuns + 1) * sizeof(phoHFileSortInputTy));
+		
+		/* The records are written through a new record buffer, as usual */
+		sortedBuffer = hdrHkTyPtr->recordBuffer;
+		if ((hdrHkTyPtr->recordBuffer = (LbUsOneByte *) LbMmAlloc(PHOHFILE_BUFFER_SIZE)) == 0) {
+			hdrHkTyPtr->recordBuffer = sortedBuffer;
+			sortedBuffer = 0;
+			break;
 		}
-
-		if (hdrHkTyPtr->customParams.doZposition == true) {
-				if (fwrite(&photon->location.z_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'z_position' to history file.");
-					goto FAILURE;
-				}
+		hdrHkTyPtr->recordBufferSize = PHOHFILE_BUFFER_SIZE;
+		hdrHkTyPtr->recordBufferUsed = 0;
+		hdrHkTyPtr->isCompressed = sorterPtr->isCompressed;
+		sorterPtr->isMerging = true;
+		
+		/* Open the runs, earliest first */
+		for (numInputs = 0; numInputs < sorterPtr->numRuns; numInputs++) {
+			phoHFileRunPath(hdrHkTyPtr, numInputs, runPath);
+			if ((inputs[numInputs].runFile = LbFlFileOpen(runPath, "rb")) == 0) {
+				sprintf(phoHFileErrString, "Unable to open sorted history run file named '%s'",
+					runPath);
+				ErStFileError(phoHFileErrString);
+				goto FAIL;
+			}
+			if ((inputs[numInputs].buffer = (LbUsOneByte *) LbMmAlloc(PHOHFILE_BUFFER_SIZE)) == 0) {
+				fclose(inputs[numInputs].runFile);
+				goto FAIL;
+			}
+			inputs[numInputs].bufferSize = PHOHFILE_BUFFER_SIZE;
+			if (phoHFileNextSortRecord(&inputs[numInputs]) == false) {
+				numInputs++;
+				goto FAIL;
+			}
 		}
-
-		if (hdrHkTyPtr->customParams.doXcosine == true) {
-				if (fwrite(&photon->angle.cosine_x, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'cosine_x' to history file.");
-					goto FAILURE;
+		
+		/* The record buffer holds the latest records */
+		inputs[numInputs].buffer = sortedBuffer;
+		inputs[numInputs].nextItem = sortedItems;
+		inputs[numInputs].endItem = sortedItems + numItems;
+		(void) phoHFileNextSortRecord(&inputs[numInputs]);
+		numInputs++;
+		
+		/* Write the earliest record until all are written */
+		for (;;) {
+			firstIndex = numInputs;
+			for (inputIndex = 0; inputIndex < numInputs; inputIndex++) {
+				if ((inputs[inputIndex].record != 0) && ((firstIndex == numInputs) ||
+						(inputs[inputIndex].radixKey < inputs[firstIndex].radixKey))) {
+					
+					firstIndex = inputIndex;
 				}
-		}
-
-		if (hdrHkTyPtr->customParams.doYcosine == true) {
-				if (fwrite(&photon->angle.cosine_y, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'cosine_y' to history file.");
-					goto FAILURE;
+			}
+			if (firstIndex == numInputs) {
+				break;
+			}
+			
+			if (hdrHkTyPtr->recordBufferUsed >= PHOHFILE_FLUSH_SIZE) {
+				if (phoHFilePassBuffer(hdrHkTyPtr) == false) {
+					goto FAIL;
 				}
+			}
+			if (phoHFileBufferWrite(hdrHkTyPtr, inputs[firstIndex].record,
+					inputs[firstIndex].recordSize) == false) {
+				goto FAIL;
+			}
+			if (phoHFileNextSortRecord(&inputs[firstIndex]) == false) {
+				goto FAIL;
+			}
 		}
-
-		if (hdrHkTyPtr->customParams.doZcosine == true) {
-				if (fwrite(&photon->angle.cosine_z, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'cosine_z' to history file.");
-					goto FAILURE;
-				}
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	/* Close and remove the runs */
+	for (inputIndex = 0; inputIndex < numInputs; inputIndex++) {
+		if (inputs[inputIndex].runFile != 0) {
+			fclose(inputs[inputIndex].runFile);
+			LbMmFree((void **)&inputs[inputIndex].buffer);
 		}
+	}
+	for (inputIndex = 0; inputIndex < sorterPtr->numRuns; inputIndex++) {
+		phoHFileRunPath(hdrHkTyPtr, inputIndex, runPath);
+		(void) remove(runPath);
+	}
+	sorterPtr->numRuns = 0;
+	
+	if (inputs != 0) {
+		LbMmFree((void **)&inputs);
+	}
+	if (sortedBuffer != 0) {
+		LbMmFree((void **)&sortedBuffer);
+	}
+	
+	return (okay);
+}
 
-		if (hdrHkTyPtr->customParams.doScattersInObject == true) {
-				if (fwrite(&photon->num_of_scatters, sizeof(LbUsFourByte), 1, hdrHkTyPtr->histFile) != 1) {
+/*********************************************************************************
+*
+*			Name:			phoHFileFreeSorter
+*
+*			Summary:		Free the time order writing state of the history file.
+*
+*			Arguments:
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phoHFileFreeSorter(PhoHFileHkTy *hdrHkTyPtr)	
+{
+	phoHFileSorterTy	*sorterPtr;		/* The state */
+	
+	if (hdrHkTyPtr->sorter != 0) {
+		sorterPtr = (phoHFileSorterTy *) hdrHkTyPtr->sorter;
+		
+		if (sorterPtr->items != 0)
+			LbMmFree((void **)&sorterPtr->items);
+		if (sorterPtr->scratch != 0)
+			LbMmFree((void **)&sorterPtr->scratch);
+		
+		LbMmFree((void **)&hdrHkTyPtr->sorter);
+	}
+}
 
-					ErStGeneric("Unable to write 'scatters in object' to history file.");
-					goto FAILURE;
+/*********************************************************************************
+*
+*			Name:			phoHFileSortRecords
+*
+*			Summary:		Index the decays of the record buffer and sort the
+*							index by decay time.
+*
+*			Arguments:
+*				PhoHFileHkTy 		*hdrHkTyPtr		- The header hook
+*				phoHFileSortItemTy	**sortedItemsPtr	- The sorted index
+*				LbUsFourByte		*numItemsPtr	- Its number of decays
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean phoHFileSortRecords(PhoHFileHkTy *hdrHkTyPtr, phoHFileSortItemTy **sortedItemsPtr,
+			LbUsFourByte *numItemsPtr)
+{
+	Boolean				okay = false;		/* Success flag */
+	phoHFileSorterTy	*sorterPtr;			/* The sorting state */
+	phoHFileSortItemTy	*newItems;			/* Larger index */
+	LbUsFourByte		newMaxItems;		/* Its length */
+	LbUsFourByte		numItems = 0;		/* Decays indexed */
+	LbUsFourByte		offset = 0;			/* Offset of the current decay */
+	LbUsFourByte		size;				/* Size of its records */
+	
+	sorterPtr = (phoHFileSorterTy *) hdrHkTyPtr->sorter;
+	
+	do { /* Process Loop */
+	
+		/* Index the decays */
+		while (offset < hdrHkTyPtr->recordBufferUsed) {
+			size = phoHFileRecordSize(hdrHkTyPtr->recordBuffer + offset,
+				hdrHkTyPtr->recordBufferUsed - offset);
+			if (size == 0) {
+				ErStGeneric("Unexpected event in history records being sorted (phoHFileSortRecords).");
+				goto FAIL;
+			}
+			
+			if (numItems == sorterPtr->maxItems) {
+				newMaxItems = (sorterPtr->maxItems == 0) ? 65536 : 2*sorterPtr->maxItems;
+				if ((newItems = (phoHFileSortItemTy *)
+						LbMmAlloc(newMaxItems*sizeof(phoHFileSortItemTy))) == 0) {
+					goto FAIL;
 				}
-		}
-
-		if (hdrHkTyPtr->customParams.doScattersInCollimator == true) {
-				if (fwrite(&photon->scatters_in_col, sizeof(LbUsFourByte), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'scatters in collimator' to history file.");
-					goto FAILURE;
+				if (sorterPtr->items != 0) {
+					memcpy(newItems, sorterPtr->items, numItems*sizeof(phoHFileSortItemTy));
+					LbMmFree((void **)&sorterPtr->items);
+					LbMmFree((void **)&sorterPtr->scratch);
+				}
+				sorterPtr->items = newItems;
+				sorterPtr->maxItems = newMaxItems;
+				if ((sorterPtr->scratch = (phoHFileSortItemTy *)
+						LbMmAlloc(newMaxItems*sizeof(phoHFileSortItemTy))) == 0) {
+					goto FAIL;
 				}
-		}
-
-		if (hdrHkTyPtr->customParams.doDecayWeight == true) {
-			if (fwrite(&decay->startWeight, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-				ErStGeneric("Unable to write 'decay weight' to history file.");
-				goto FAILURE;
 			}
+			
+			sorterPtr->items[numItems].radixKey =
+				phoHFileRecordKey(hdrHkTyPtr->recordBuffer + offset);
+			sorterPtr->items[numItems].offset = offset;
+			sorterPtr->items[numItems].size = size;
+			numItems++;
+			offset += size;
 		}
+		
+		*sortedItemsPtr = phoHFileRadixSort(sorterPtr->items, sorterPtr->scratch, numItems);
+		*numItemsPtr = numItems;
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	return (okay);
+}
 
-		if (hdrHkTyPtr->customParams.doWeight == true) {
-			if (fwrite(&photon->photon_current_weight, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-				ErStGeneric("Unable to write 'photon weight' to history file.");
-				goto FAILURE;
-			}
+/*********************************************************************************
+*
+*			Name:			phoHFileRadixSort
+*
+*			Summary:		Sort a decay index by its radix keys, least
+*							significant byte first.  The sort is stable, and
+*							passes where every key has the same byte are skipped.
+*
+*			Arguments:
+*				phoHFileSortItemTy	*items			- The index to sort
+*				phoHFileSortItemTy	*scratch		- Space for as many entries
+*				LbUsFourByte		numItems		- Number of entries
+*
+*			Function return: items or scratch, whichever holds the sorted index.
+*
+*********************************************************************************/
+phoHFileSortItemTy *phoHFileRadixSort(phoHFileSortItemTy *items, phoHFileSortItemTy *scratch,
+			LbUsFourByte numItems)
+{
+	LbUsFourByte		counts[PHOHFILE_RADIX_PASSES][PHOHFILE_RADIX_SIZE];	/* Digit counts, then positions */
+	phoHFileSortItemTy	*fromItems = items;		/* Entries sorted from */
+	phoHFileSortItemTy	*toItems = scratch;		/* Entries sorted into */
+	phoHFileSortItemTy	*swapItems;				/* Exchange of the two */
+	LbUsEightByte		radixKey;				/* Key of the current entry */
+	LbUsFourByte		pass;					/* LCV for the passes */
+	LbUsFourByte		digit;					/* The current digit */
+	LbUsFourByte		total;					/* Running total of digit counts */
+	LbUsFourByte		count;					/* Count of the current digit */
+	LbUsFourByte		itemIndex;				/* LCV for the entries */
+	
+	/* Count the digits of every pass at once */
+	memset(counts, 0, sizeof(counts));
+	for (itemIndex = 0; itemIndex < numItems; itemIndex++) {
+		radixKey = items[itemIndex].radixKey;
+		for (pass = 0; pass < PHOHFILE_RADIX_PASSES; pass++) {
+			counts[pass][radixKey & (PHOHFILE_RADIX_SIZE-1)]++;
+			radixKey >>= 8;
 		}
-
-		if (hdrHkTyPtr->customParams.doEnergy == true) {
-				if (fwrite(&photon->energy, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'energy' to history file.");
-					goto FAILURE;
-				}
+	}
+	
+	for (pass = 0; (pass < PHOHFILE_RADIX_PASSES) && (numItems != 0); pass++) {
+		
+		/* Skip the pass if every key has the same digit */
+		digit = (LbUsFourByte) ((fromItems[0].radixKey >> (8*pass)) & (PHOHFILE_RADIX_SIZE-1));
+		if (counts[pass][digit] == numItems) {
+			continue;
 		}
-
-		if (hdrHkTyPtr->customParams.doTravelDistance == true) {
-				if (fwrite(&photon->travel_distance, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'travel distance' to history file.");
-					goto FAILURE;
-				}
+		
+		/* Turn the counts into the first position of each digit */
+		total = 0;
+		for (digit = 0; digit < PHOHFILE_RADIX_SIZE; digit++) {
+			count = counts[pass][digit];
+			counts[pass][digit] = total;
+			total += count;
 		}
-
-		if (hdrHkTyPtr->customParams.doDecayXposition == true) {
-				if (fwrite(&decay->location.x_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'decay x position' to history file.");
-					goto FAILURE;
-				}
+		
+		/* Distribute the entries by digit */
+		for (itemIndex = 0; itemIndex < numItems; itemIndex++) {
+			digit = (LbUsFourByte)
+				((fromItems[itemIndex].radixKey >> (8*pass)) & (PHOHFILE_RADIX_SIZE-1));
+			toItems[counts[pass][digit]++] = fromItems[itemIndex];
 		}
+		
+		swapItems = fromItems;
+		fromItems = toItems;
+		toItems = swapItems;
+	}
+	
+	return (fromItems);
+}
 
-		if (hdrHkTyPtr->customParams.doDecayYposition == true) {
-				if (fwrite(&decay->location.y_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'decay y position' to history file.");
-					goto FAILURE;
-				}
+/*********************************************************************************
+*
+*			Name:			phoHFileNextSortRecord
+*
+*			Summary:		Move a source of sorted records on to its next
+*							decay, refilling a file's read buffer as needed.
+*
+*			Arguments:
+*				phoHFileSortInputTy	*inputPtr		- The source
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean phoHFileNextSortRecord(phoHFileSortInputTy *inputPtr)
+{
+	Boolean			okay = false;	/* Success flag */
+	LbUsFourByte	dataLeft;		/* Bytes read and not yet used */
+	
+	do { /* Process Loop */
+	
+		/* The sorted record buffer */
+		if (inputPtr->runFile == 0) {
+			if (inputPtr->nextItem < inputPtr->endItem) {
+				inputPtr->record = inputPtr->buffer + inputPtr->nextItem->offset;
+				inputPtr->recordSize = inputPtr->nextItem->size;
+				inputPtr->radixKey = inputPtr->nextItem->radixKey;
+				inputPtr->nextItem++;
+			}
+			else {
+				inputPtr->record = 0;
+			}
+			
+			okay = true;
+			break;
 		}
-
-		if (hdrHkTyPtr->customParams.doDecayZposition == true) {
-				if (fwrite(&decay->location.z_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'decay z position' to history file.");
-					goto FAILURE;
-				}
+		
+		/* Keep a whole decay in the read buffer */
+		inputPtr->dataStart += inputPtr->recordSize;
+		dataLeft = inputPtr->dataEnd - inputPtr->dataStart;
+		if (dataLeft < PHOHFILE_MAX_RECORD_SIZE) {
+			memmove(inputPtr->buffer, inputPtr->buffer + inputPtr->dataStart, dataLeft);
+			inputPtr->dataStart = 0;
+			inputPtr->dataEnd = dataLeft + (LbUsFourByte) fread(inputPtr->buffer + dataLeft, 1,
+				inputPtr->bufferSize - dataLeft, inputPtr->runFile);
+			if (ferror(inputPtr->runFile)) {
+				ErStFileError("Unable to read sorted history records (phoHFileNextSortRecord).");
+				break;
+			}
 		}
-
-		if (hdrHkTyPtr->customParams.doDecayTime == true) {
-				if (fwrite(&decay->decayTime, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'decay time' to history file.");
-					goto FAILURE;
-				}
+		
+		if (inputPtr->dataStart == inputPtr->dataEnd) {
+			inputPtr->record = 0;
+			inputPtr->recordSize = 0;
 		}
-
-		if (hdrHkTyPtr->customParams.doDecayType == true) {
-				if (fwrite(&decay->decayType, sizeof(LbUsOneByte), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'decay type' to history file.");
-					goto FAILURE;
-				}
+		else {
+			inputPtr->record = inputPtr->buffer + inputPtr->dataStart;
+			inputPtr->recordSize = phoHFileRecordSize(inputPtr->record,
+				inputPtr->dataEnd - inputPtr->dataStart);
+			if (inputPtr->recordSize == 0) {
+				ErStGeneric("Unexpected event in sorted history records (phoHFileNextSortRecord).");
+				break;
+			}
+			inputPtr->radixKey = phoHFileRecordKey(inputPtr->record);
 		}
+		
+		okay = true;
+	} while (false);
+	
+	return (okay);
+}
 
-		if (hdrHkTyPtr->customParams.doTransaxialDistance == true) {
-				if (fwrite(&photon->transaxialPosition, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+/*********************************************************************************
+*
+*			Name:			phoHFileRecordSize
+*
+*			Summary:		Return the size of a decay's records:  its flag and
+*							decay followed by the flags and photons after it.
+*
+*			Arguments:
+*				LbUsOneByte		*record			- The decay's flag
+*				LbUsFourByte	available		- Bytes of records from there on
+*
+*			Function return: The size, 0 if the records don't hold a whole decay.
+*
+*********************************************************************************/
+LbUsFourByte phoHFileRecordSize(LbUsOneByte *record, LbUsFourByte available)
+{
+	LbUsFourByte	size;		/* Size of the records */
+	
+	if ((available < (1 + sizeof(PHG_Decay))) || !PHG_IsADecay((LbUsFourByte) record[0])) {
+		return (0);
+	}
+	
+	size = 1 + sizeof(PHG_Decay);
+	while ((size < available) && PHG_IsAPhoton((LbUsFourByte) record[size])) {
+		size += 1 + sizeof(PHG_DetectedPhoton);
+	}
+	if (size > available) {
+		return (0);
+	}
+	
+	return (size);
+}
 
-					ErStGeneric("Unable to write 'transaxial position' to history file.");
-					goto FAILURE;
-				}
-		}
-
-		if (hdrHkTyPtr->customParams.doAzimuthalAngleIndex == true) {
-				if (fwrite(&photon->azimuthalAngleIndex, sizeof(LbUsFourByte), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'azimuthal angle index' to history file.");
-					goto FAILURE;
-				}
-		}
+/*********************************************************************************
+*
+*			Name:			phoHFileRecordKey
+*
+*			Summary:		Return a decay's time as an unsigned integer that
+*							orders the same way, for sorting.
+*
+*			Arguments:
+*				LbUsOneByte		*record			- The decay's flag
+*
+*			Function return: The sort key.
+*
+*********************************************************************************/
+LbUsEightByte phoHFileRecordKey(LbUsOneByte *record)
+{
+	LbUsEightByte	radixKey;		/* The decay time's bits */
+	
+	memcpy(&radixKey, record + 1 + offsetof(PHG_Decay, decayTime), sizeof(radixKey));
+	
+	/* Flip negative times entirely and positive times' sign bit */
+	if (radixKey & PHOHFILE_SIGN_BIT) {
+		radixKey = ~radixKey;
+	}
+	else {
+		radixKey |= PHOHFILE_SIGN_BIT;
+	}
+	
+	return (radixKey);
+}
 
-		if (hdrHkTyPtr->customParams.doAxialPosition == true) {
-				if (fwrite(&photon->axialPosition, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+/*********************************************************************************
+*
+*			Name:			phoHFileRunPath
+*
+*			Summary:		Make the path of one of the history file's sorted
+*							run files.
+*
+*			Arguments:
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*				LbUsFourByte	runIndex		- Index of the run
+*				char			*runPath		- The path made
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phoHFileRunPath(PhoHFileHkTy *hdrHkTyPtr, LbUsFourByte runIndex, char *runPath)
+{
+	sprintf(runPath, "%s%s%lu", hdrHkTyPtr->histFilePath, PHOHFILE_RUN_SUFFIX,
+		(unsigned long) runIndex);
+}
 
-					ErStGeneric("Unable to write 'axial position' to history file.");
-					goto FAILURE;
-				}
+/*********************************************************************************
+*
+*			Name:			phoHFileGetPacker
+*
+*			Summary:		Return the compressed writing state of the history
+*							file, creating it if needed.  Chunks are counted from
+*							the current file position.
+*
+*			Arguments:
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*
+*			Function return: The state, 0 if it could not be created.
+*
+*********************************************************************************/
+phoHFilePackerTy *phoHFileGetPacker(PhoHFileHkTy *hdrHkTyPtr)	
+{
+	phoHFilePackerTy	*packerPtr;		/* The new state */
+	
+	if (hdrHkTyPtr->packer == 0) {
+		if ((packerPtr = (phoHFilePackerTy *) LbMmAlloc(sizeof(phoHFilePackerTy))) != 0) {
+			memset(packerPtr, 0, sizeof(phoHFilePackerTy));
+			packerPtr->nextChunkOffset = (LbUsEightByte) ftello(hdrHkTyPtr->histFile);
+			packerPtr->isIndexing = (hdrHkTyPtr->mainHistFile == 0);
+			hdrHkTyPtr->packer = packerPtr;
 		}
+	}
+	
+	return ((phoHFilePackerTy *) hdrHkTyPtr->packer);
+}
 
-		if (hdrHkTyPtr->customParams.doDetectorXposition == true) {
-				if (fwrite(&photon->detLocation.x_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+/*********************************************************************************
+*
+*			Name:			phoHFileFreePacker
+*
+*			Summary:		Free the compressed writing state of the history file.
+*
+*			Arguments:
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phoHFileFreePacker(PhoHFileHkTy *hdrHkTyPtr)	
+{
+	phoHFilePackerTy	*packerPtr;		/* The state */
+	
+	if (hdrHkTyPtr->packer != 0) {
+		packerPtr = (phoHFilePackerTy *) hdrHkTyPtr->packer;
+		
+		if (packerPtr->packedBuffer != 0)
+			LbMmFree((void **)&packerPtr->packedBuffer);
+		if (packerPtr->records != 0)
+			LbMmFree((void **)&packerPtr->records);
+		if (packerPtr->values != 0)
+			LbMmFree((void **)&packerPtr->values);
+		if (packerPtr->deltas != 0)
+			LbMmFree((void **)&packerPtr->deltas);
+		if (packerPtr->plane != 0)
+			LbMmFree((void **)&packerPtr->plane);
+		if (packerPtr->index != 0)
+			LbMmFree((void **)&packerPtr->index);
+		
+		LbMmFree((void **)&hdrHkTyPtr->packer);
+	}
+}
 
-					ErStGeneric("Unable to write 'detector X-axis position' to history file.");
-					goto FAILURE;
-				}
+/*********************************************************************************
+*
+*			Name:			phoHFileSizePacker
+*
+*			Summary:		Make room in the compressed writing state for packing
+*							a record buffer, so that packing it allocates nothing
+*							and can be left to the writer thread.
+*
+*			Arguments:
+*				phoHFilePackerTy	*packerPtr		- Compressed writing state
+*				LbUsFourByte		recordBytes		- Bytes of records to pack
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean phoHFileSizePacker(phoHFilePackerTy *packerPtr, LbUsFourByte recordBytes)	
+{
+	Boolean					okay = false;	/* Success flag */
+	PhoHFileChunkEntryTy	*newIndex;		/* Replacement for a full index */
+	LbUsFourByte			newMaxChunks;	/* Size of the replacement */
+	LbUsFourByte			maxEvents;		/* Most events the records can hold */
+	LbUsFourByte			packedBound;	/* Largest possible packed chunk */
+	
+	do { /* Process Loop */
+	
+		/* Decays are the smaller records */
+		maxEvents = recordBytes / (1 + sizeof(PHG_Decay)) + 1;
+		
+		if (packerPtr->recordsSize < recordBytes) {
+			if (packerPtr->records != 0)
+				LbMmFree((void **)&packerPtr->records);
+			packerPtr->recordsSize = 0;
+			if ((packerPtr->records = (LbUsOneByte *) LbMmAlloc(recordBytes)) == 0) {
+				break;
+			}
+			packerPtr->recordsSize = recordBytes;
+		}
+		if (packerPtr->maxEvents < maxEvents) {
+			if (packerPtr->values != 0)
+				LbMmFree((void **)&packerPtr->values);
+			if (packerPtr->deltas != 0)
+				LbMmFree((void **)&packerPtr->deltas);
+			if (packerPtr->plane != 0)
+				LbMmFree((void **)&packerPtr->plane);
+			packerPtr->maxEvents = 0;
+			if ((packerPtr->values = (LbUsEightByte *)
+					LbMmAlloc(maxEvents * sizeof(LbUsEightByte))) == 0) {
+				break;
+			}
+			if ((packerPtr->deltas = (LbUsEightByte *)
+					LbMmAlloc(maxEvents * sizeof(LbUsEightByte))) == 0) {
+				break;
+			}
+			if ((packerPtr->plane = (LbUsOneByte *) LbMmAlloc(maxEvents)) == 0) {
+				break;
+			}
+			packerPtr->maxEvents = maxEvents;
+		}
+		packedBound = sizeof(phoHFileChunkHdrTy) + LBCM_PACK_BOUND(maxEvents) +
+			(PHOHFILE_NUM_DECAY_FIELDS + PHOHFILE_NUM_PHOTON_FIELDS) *
+			(2 + sizeof(LbUsEightByte) * LBCM_PACK_OVERHEAD) + recordBytes;
+		if (packerPtr->packedBufferSize < packedBound) {
+			if (packerPtr->packedBuffer != 0)
+				LbMmFree((void **)&packerPtr->packedBuffer);
+			packerPtr->packedBufferSize = 0;
+			if ((packerPtr->packedBuffer = (LbUsOneByte *) LbMmAlloc(packedBound)) == 0) {
+				break;
+			}
+			packerPtr->packedBufferSize = packedBound;
 		}
-
-		if (hdrHkTyPtr->customParams.doDetectorYposition == true) {
-				if (fwrite(&photon->detLocation.y_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'detector Y-axis position' to history file.");
-					goto FAILURE;
-				}
+		
+		/* Room for the chunk's index entry */
+		if (packerPtr->isIndexing && (packerPtr->numChunks == packerPtr->maxChunks)) {
+			newMaxChunks = (packerPtr->maxChunks == 0) ? 256 : 2*packerPtr->maxChunks;
+			if ((newIndex = (PhoHFileChunkEntryTy *)
+					LbMmAlloc(newMaxChunks * sizeof(PhoHFileChunkEntryTy))) == 0) {
+				break;
+			}
+			if (packerPtr->index != 0) {
+				memcpy(newIndex, packerPtr->index,
+					packerPtr->numChunks * sizeof(PhoHFileChunkEntryTy));
+				LbMmFree((void **)&packerPtr->index);
+			}
+			packerPtr->index = newIndex;
+			packerPtr->maxChunks = newMaxChunks;
 		}
+		
+		okay = true;
+	} while (false);
+	
+	return (okay);
+}
 
-		if (hdrHkTyPtr->customParams.doDetectorZposition == true) {
-				if (fwrite(&photon->detLocation.z_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'detector Z-axis position' to history file.");
-					goto FAILURE;
-				}
+/*********************************************************************************
+*
+*			Name:			phoHFilePackChunk
+*
+*			Summary:		Pack a record buffer into an events chunk, left in
+*							the packed buffer.  The buffer always begins with a
+*							decay, so every chunk holds whole decays and can be
+*							read on its own.  phoHFileSizePacker must have made
+*							room for the records.
+*
+*			Arguments:
+*				phoHFilePackerTy	*packerPtr		- Compressed writing state
+*				LbUsOneByte			*recordBuffer	- The records
+*				LbUsFourByte		recordBytes		- Bytes of records
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phoHFilePackChunk(phoHFilePackerTy *packerPtr, LbUsOneByte *recordBuffer,
+			LbUsFourByte recordBytes)	
+{
+	phoHFileChunkHdrTy	chunkHdr;			/* The chunk header */
+	LbUsOneByte			*recordPtr;			/* Current buffered record */
+	LbUsOneByte			*bufferEnd;			/* End of the buffered records */
+	LbUsOneByte			*photonRecords;		/* The photons among packerPtr->records */
+	LbUsFourByte		numDecays = 0;		/* Decays in the chunk */
+	LbUsFourByte		numPhotons = 0;		/* Photons in the chunk */
+	LbUsFourByte		numEvents;			/* Events in the chunk */
+	LbUsFourByte		packedUsed;			/* Bytes packed so far */
+	LbUsFourByte		fieldIndex;			/* Current column */
+	
+	/* Count the decays */
+	bufferEnd = recordBuffer + recordBytes;
+	for (recordPtr = recordBuffer; recordPtr < bufferEnd; ) {
+		if (PHG_IsADecay((LbUsFourByte) *recordPtr)) {
+			numDecays++;
+			recordPtr += 1 + sizeof(PHG_Decay);
 		}
-
-		if (hdrHkTyPtr->customParams.doDetectorAngle == true) {
-				if (fwrite(&photon->detectorAngle, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'detector angle' to history file.");
-					goto FAILURE;
-				}
+		else {
+			recordPtr += 1 + sizeof(PHG_DetectedPhoton);
 		}
-
-		if (hdrHkTyPtr->customParams.doDetectorCrystal == true) {
-				if (fwrite(&photon->detCrystal, sizeof(LbFourByte), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'detector crystal' to history file.");
-					goto FAILURE;
-				}
+	}
+	
+	/* Separate the event flags, the decays, and the photons */
+	photonRecords = packerPtr->records + numDecays * sizeof(PHG_Decay);
+	numDecays = 0;
+	for (recordPtr = recordBuffer; recordPtr < bufferEnd; ) {
+		packerPtr->plane[numDecays + numPhotons] = *recordPtr;
+		if (PHG_IsADecay((LbUsFourByte) *recordPtr)) {
+			memcpy(packerPtr->records + numDecays * sizeof(PHG_Decay),
+				recordPtr + 1, sizeof(PHG_Decay));
+			numDecays++;
+			recordPtr += 1 + sizeof(PHG_Decay);
 		}
-
-		if (hdrHkTyPtr->customParams.doNumDetectorInteractions == true) {
-			if (fwrite(&photon->num_det_interactions, sizeof(LbUsFourByte), 1, hdrHkTyPtr->histFile) != 1) {
-
-				ErStGeneric("Unable to write 'number of detector interactions' to history file.");
-				goto FAILURE;
-			}
+		else {
+			memcpy(photonRecords + numPhotons * sizeof(PHG_DetectedPhoton),
+				recordPtr + 1, sizeof(PHG_DetectedPhoton));
+			numPhotons++;
+			recordPtr += 1 + sizeof(PHG_DetectedPhoton);
 		}
+	}
+	numEvents = numDecays + numPhotons;
+	
+	/* Pack the columns after the chunk header */
+	packedUsed = sizeof(phoHFileChunkHdrTy);
+	packedUsed += LbCmPackBytes(packerPtr->plane, numEvents,
+		packerPtr->packedBuffer + packedUsed);
+	for (fieldIndex = 0; fieldIndex < PHOHFILE_NUM_DECAY_FIELDS; fieldIndex++) {
+		packedUsed += phoHFilePackField(packerPtr->records, sizeof(PHG_Decay),
+			numDecays, phoHFileDecayFields, fieldIndex, packerPtr->values,
+			packerPtr->deltas, packerPtr->plane, packerPtr->packedBuffer + packedUsed);
+	}
+	for (fieldIndex = 0; fieldIndex < PHOHFILE_NUM_PHOTON_FIELDS; fieldIndex++) {
+		packedUsed += phoHFilePackField(photonRecords, sizeof(PHG_DetectedPhoton),
+			numPhotons, phoHFilePhotonFields, fieldIndex, packerPtr->values,
+			packerPtr->deltas, packerPtr->plane, packerPtr->packedBuffer + packedUsed);
+	}
+	
+	/* Fill in the chunk header */
+	memcpy(chunkHdr.magic, PHOHFILE_CHUNK_MAGIC, sizeof(chunkHdr.magic));
+	chunkHdr.kind = PHOHFILE_CHUNK_EVENTS;
+	chunkHdr.numDecays = numDecays;
+	chunkHdr.numPhotons = numPhotons;
+	chunkHdr.dataSize = packedUsed - sizeof(phoHFileChunkHdrTy);
+	chunkHdr.reserved = 0;
+	chunkHdr.firstDecayTime = 0.0;
+	if (numDecays != 0) {
+		chunkHdr.firstDecayTime = ((PHG_Decay *) packerPtr->records)->decayTime;
+	}
+	memcpy(packerPtr->packedBuffer, &chunkHdr, sizeof(phoHFileChunkHdrTy));
+	packerPtr->packedBufferUsed = packedUsed;
+	
+	/* Add the chunk to the index, which phoHFileSizePacker made room in */
+	if (packerPtr->isIndexing) {
+		phoHFileIndexChunk(packerPtr, packerPtr->nextChunkOffset, &chunkHdr);
+	}
+	packerPtr->nextChunkOffset += packedUsed;
+}
 
-		if (hdrHkTyPtr->customParams.doDetInteractionPos == true) {
-			
-			if (fwrite(&photon->num_det_interactions, sizeof(LbUsFourByte), 1, hdrHkTyPtr->histFile) != 1) {
-
-				ErStGeneric("Unable to write 'number of detector interactions' to history file for list of interaction positions.");
-				goto FAILURE;
+/*********************************************************************************
+*
+*			Name:			phoHFileIndexChunk
+*
+*			Summary:		Add an events chunk to the chunk index.
+*
+*			Arguments:
+*				phoHFilePackerTy	*packerPtr	- Compressed writing state
+*				LbUsEightByte		offset		- File offset of the chunk
+*				phoHFileChunkHdrTy	*chunkHdr	- The chunk's header
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean phoHFileIndexChunk(phoHFilePackerTy *packerPtr, LbUsEightByte offset,
+			phoHFileChunkHdrTy *chunkHdr)	
+{
+	Boolean					okay = false;	/* Success flag */
+	PhoHFileChunkEntryTy	*newIndex;		/* Replacement for a full index */
+	PhoHFileChunkEntryTy	*entryPtr;		/* The new entry */
+	LbUsFourByte			newMaxChunks;	/* Size of the replacement */
+	
+	do { /* Process Loop */
+	
+		if (packerPtr->numChunks == packerPtr->maxChunks) {
+			newMaxChunks = (packerPtr->maxChunks == 0) ? 256 : 2*packerPtr->maxChunks;
+			if ((newIndex = (PhoHFileChunkEntryTy *)
+					LbMmAlloc(newMaxChunks * sizeof(PhoHFileChunkEntryTy))) == 0) {
+				break;
 			}
-			for (i = 0; i < photon->num_det_interactions; i++) {
-
-				if (fwrite(&photon->det_interactions[i].pos.x_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'x-position of interaction' to history file for list of interaction positions.");
-					goto FAILURE;
-				}
-
-				if (fwrite(&photon->det_interactions[i].pos.y_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'y-position of interaction' to history file for list of interaction positions.");
-					goto FAILURE;
-				}
-
-				if (fwrite(&photon->det_interactions[i].pos.z_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'z-position of interaction' to history file for list of interaction positions.");
-					goto FAILURE;
-				}
-
-				if (fwrite(&photon->det_interactions[i].energy_deposited, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'energy of interaction' to history file for list of interaction positions.");
-					goto FAILURE;
-				}
-				size = sizeof(Boolean);
-				
-				if (fwrite(&photon->det_interactions[i].isActive, size, 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to write 'is-Active of interaction' to history file for list of interaction positions.");
-					goto FAILURE;
-				}
+			if (packerPtr->index != 0) {
+				memcpy(newIndex, packerPtr->index,
+					packerPtr->numChunks * sizeof(PhoHFileChunkEntryTy));
+				LbMmFree((void **)&packerPtr->index);
 			}
+			packerPtr->index = newIndex;
+			packerPtr->maxChunks = newMaxChunks;
 		}
 		
-		(*numAccepted)++;
+		entryPtr = &packerPtr->index[packerPtr->numChunks++];
+		entryPtr->offset = offset;
+		entryPtr->firstDecay = packerPtr->numDecaysIndexed;
+		entryPtr->firstDecayTime = chunkHdr->firstDecayTime;
+		entryPtr->numDecays = chunkHdr->numDecays;
+		entryPtr->numPhotons = chunkHdr->numPhotons;
+		packerPtr->numDecaysIndexed += chunkHdr->numDecays;
 		
-		FILTERED_OUT:;
 		okay = true;
-		FAILURE:;
 	} while (false);
 	
 	return (okay);
@@ -1400,484 +2478,863 @@ Boolean phoHFileWriteFields(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay,
 
 /*********************************************************************************
 *
-*			Name:			PhoHFileReadFields
+*			Name:			phoHFileWriteIndex
 *
-*			Summary:		Read photon fields from a custom history file.
+*			Summary:		End a compressed history file with the chunk index
+*							and the trailer that locates it.  The buffered records
+*							must already be written.
 *
 *			Arguments:
-*				PhoHFileHkTy 		*hdrHkTyPtr		- The history hook.
-*				PHG_Decay			*decay			- The decay that started the process.
-*				PHG_TrackingPhoton 	*photon			- The blue photons detected.
-*				Boolean				*photonAccepted	- Flag indicating the photon was accepted.
-*			Function return: None.
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*
+*			Function return: True unless an error occurs.
 *
 *********************************************************************************/
-Boolean PhoHFileReadFields(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay,
-			PHG_TrackingPhoton *photon, Boolean *photonAccepted)
+Boolean phoHFileWriteIndex(PhoHFileHkTy *hdrHkTyPtr)	
 {
-	Boolean			okay = false;
-	LbUsFourByte	i;
+	Boolean				okay = false;	/* Success flag */
+	phoHFilePackerTy	*packerPtr;		/* Compressed writing state */
+	phoHFileChunkHdrTy	chunkHdr;		/* The chunk header */
+	LbUsEightByte		indexOffset;	/* File offset of the index chunk */
 	
 	do { /* Process Loop */
-
-
-		/* Clear the acceptance flag */
-		*photonAccepted = false;
+	
+		/* A file with no events still gets an (empty) index */
+		if ((packerPtr = phoHFileGetPacker(hdrHkTyPtr)) == 0) {
+			break;
+		}
 		
-		/* Read the fields */
-
-		if (hdrHkTyPtr->customParams.doXposition == true) {
-
-			if (fread(&photon->location.x_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-				ErStGeneric("Unable to read 'x_position' from history file.");
-				goto FAILURE;
-			}
-			
-			/* Check range */
-			if (hdrHkTyPtr->customParams.doXrange == true) {
-				if ((photon->location.x_position < hdrHkTyPtr->customParams.xPosMin) ||
-						(photon->location.x_position > hdrHkTyPtr->customParams.xPosMax)) {
-
-					goto FILTERED_OUT;
-
-				}						
-			}
+		indexOffset = (LbUsEightByte) ftello(hdrHkTyPtr->histFile);
+		memcpy(chunkHdr.magic, PHOHFILE_CHUNK_MAGIC, sizeof(chunkHdr.magic));
+		chunkHdr.kind = PHOHFILE_CHUNK_INDEX;
+		chunkHdr.numDecays = 0;
+		chunkHdr.numPhotons = 0;
+		chunkHdr.dataSize = packerPtr->numChunks * sizeof(PhoHFileChunkEntryTy);
+		chunkHdr.reserved = 0;
+		chunkHdr.firstDecayTime = 0.0;
+		if (fwrite(&chunkHdr, sizeof(phoHFileChunkHdrTy), 1, hdrHkTyPtr->histFile) != 1) {
+			ErStFileError("Unable to write chunk index to history binary file (phoHFileWriteIndex).");
+			break;
 		}
+		if ((packerPtr->numChunks != 0) && (fwrite(packerPtr->index, chunkHdr.dataSize, 1,
+				hdrHkTyPtr->histFile) != 1)) {
+			ErStFileError("Unable to write chunk index to history binary file (phoHFileWriteIndex).");
+			break;
+		}
+		
+		chunkHdr.kind = PHOHFILE_CHUNK_TRAILER;
+		chunkHdr.dataSize = sizeof(indexOffset);
+		if ((fwrite(&chunkHdr, sizeof(phoHFileChunkHdrTy), 1, hdrHkTyPtr->histFile) != 1) ||
+				(fwrite(&indexOffset, sizeof(indexOffset), 1, hdrHkTyPtr->histFile) != 1)) {
+			ErStFileError("Unable to write trailer to history binary file (phoHFileWriteIndex).");
+			break;
+		}
+		
+		okay = true;
+	} while (false);
+	
+	return (okay);
+}
 
-		if (hdrHkTyPtr->customParams.doYposition == true) {
-				if (fread(&photon->location.y_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to read 'y_position' from history file.");
-					goto FAILURE;
-				}
-
-			if (hdrHkTyPtr->customParams.doYrange == true) {
-				if ((photon->location.y_position < hdrHkTyPtr->customParams.yPosMin) ||
-						(photon->location.y_position > hdrHkTyPtr->customParams.yPosMax)) {
-
-					goto FILTERED_OUT;
-
-				}							
+/*********************************************************************************
+*
+*			Name:			phoHFileAppendChunks
+*
+*			Summary:		Copy the chunks of a compressed part file to the end
+*							of the history file, adding them to its index.
+*
+*			Arguments:
+*				PhoHFileHkTy 	*hdrHkTyPtr		- The header hook
+*				FILE			*partFile		- The part file
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean phoHFileAppendChunks(PhoHFileHkTy *hdrHkTyPtr, FILE *partFile)	
+{
+	Boolean				okay = false;	/* Success flag */
+	phoHFilePackerTy	*packerPtr;		/* Compressed writing state */
+	phoHFileChunkHdrTy	chunkHdr;		/* The chunk header */
+	LbUsEightByte		chunkOffset;	/* File offset of the copied chunk */
+	
+	do { /* Process Loop */
+	
+		if ((packerPtr = phoHFileGetPacker(hdrHkTyPtr)) == 0) {
+			break;
+		}
+		
+		/* The packed chunk buffer is free for copying, the writer has stopped */
+		while (fread(&chunkHdr, sizeof(phoHFileChunkHdrTy), 1, partFile) == 1) {
+			if (memcmp(chunkHdr.magic, PHOHFILE_CHUNK_MAGIC, sizeof(chunkHdr.magic)) != 0) {
+				ErStGeneric("History part file is not made of compressed chunks.");
+				goto FAIL;
+			}
+			
+			if (packerPtr->packedBufferSize < chunkHdr.dataSize) {
+				if (packerPtr->packedBuffer != 0)
+					LbMmFree((void **)&packerPtr->packedBuffer);
+				packerPtr->packedBufferSize = 0;
+				if ((packerPtr->packedBuffer = (LbUsOneByte *) LbMmAlloc(chunkHdr.dataSize)) == 0) {
+					goto FAIL;
+				}
+				packerPtr->packedBufferSize = chunkHdr.dataSize;
+			}
+			if (fread(packerPtr->packedBuffer, 1, chunkHdr.dataSize, partFile) != chunkHdr.dataSize) {
+				goto FAIL;
+			}
+			
+			chunkOffset = (LbUsEightByte) ftello(hdrHkTyPtr->histFile);
+			if ((fwrite(&chunkHdr, sizeof(phoHFileChunkHdrTy), 1, hdrHkTyPtr->histFile) != 1) ||
+					(fwrite(packerPtr->packedBuffer, 1, chunkHdr.dataSize, hdrHkTyPtr->histFile) !=
+					chunkHdr.dataSize)) {
+				goto FAIL;
+			}
+			
+			if ((chunkHdr.kind == PHOHFILE_CHUNK_EVENTS) && packerPtr->isIndexing) {
+				if (phoHFileIndexChunk(packerPtr, chunkOffset, &chunkHdr) == false) {
+					goto FAIL;
+				}
 			}
 		}
+		if (ferror(partFile)) {
+			break;
+		}
+		packerPtr->nextChunkOffset = (LbUsEightByte) ftello(hdrHkTyPtr->histFile);
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	return (okay);
+}
 
-		if (hdrHkTyPtr->customParams.doZposition == true) {
-				if (fread(&photon->location.z_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to read 'z_position' from history file.");
-					goto FAILURE;
-				}
+/*********************************************************************************
+*
+*			Name:			phoHFileSampleBits
+*
+*			Summary:		Estimate the bits needed to code a sample of a column
+*							from the byte frequencies of each of its planes.
+*
+*			Arguments:
+*				LbUsEightByte	*sample		- The sampled values
+*				LbUsFourByte	count		- Number of values
+*				LbUsFourByte	size		- Bytes in each value
+*
+*			Function return: The estimated number of bits.
+*
+*********************************************************************************/
+double phoHFileSampleBits(LbUsEightByte *sample, LbUsFourByte count, LbUsFourByte size)	
+{
+	LbUsFourByte	byteCounts[sizeof(LbUsEightByte)][256];	/* Frequency of each byte */
+	double			numBits = 0.0;							/* The estimate */
+	LbUsEightByte	value;									/* Current value */
+	LbUsFourByte	byteIndex;								/* Current byte plane */
+	LbUsFourByte	i;										/* Loop index */
+	
+	memset(byteCounts, 0, size * sizeof(byteCounts[0]));
+	for (i = 0; i < count; i++) {
+		value = sample[i];
+		for (byteIndex = 0; byteIndex < size; byteIndex++) {
+			byteCounts[byteIndex][value & 0xFF]++;
+			value >>= 8;
+		}
+	}
+	for (byteIndex = 0; byteIndex < size; byteIndex++) {
+		for (i = 0; i < 256; i++) {
+			if (byteCounts[byteIndex][i] != 0) {
+				numBits -= byteCounts[byteIndex][i] *
+					log((double) byteCounts[byteIndex][i] / count);
+			}
+		}
+	}
+	
+	return (numBits / log(2.0));
+}
 
-			if (hdrHkTyPtr->customParams.doZrange == true) {
-				if ((photon->location.z_position < hdrHkTyPtr->customParams.zPosMin) ||
-						(photon->location.z_position > hdrHkTyPtr->customParams.zPosMax)) {
+/*********************************************************************************
+*
+*			Name:			phoHFileGatherField
+*
+*			Summary:		Gather one column from the records, least significant
+*							byte first.
+*
+*			Arguments:
+*				LbUsOneByte		*records		- The records
+*				LbUsFourByte	recordSize		- Size of a record
+*				LbUsFourByte	count			- Number of records
+*				LbUsFourByte	stride			- Records between values gathered
+*				phoHFileFieldTy	*field			- The column
+*				LbUsEightByte	*values			- Receives the values
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phoHFileGatherField(LbUsOneByte *records, LbUsFourByte recordSize,
+			LbUsFourByte count, LbUsFourByte stride, phoHFileFieldTy *field,
+			LbUsEightByte *values)	
+{
+	LbUsEightByte	value;				/* Current value */
+	LbUsOneByte		*fieldPtr;			/* The field in the current record */
+	LbUsFourByte	byteIndex;			/* Current byte */
+	LbUsFourByte	i;					/* Loop index */
+	
+	for (i = 0; i < count; i += stride) {
+		fieldPtr = records + i*recordSize + field->offset;
+		value = 0;
+		for (byteIndex = field->size; byteIndex > 0; byteIndex--) {
+			value = (value << 8) | fieldPtr[byteIndex - 1];
+		}
+		*values++ = value;
+	}
+}
 
-					goto FILTERED_OUT;
+/*********************************************************************************
+*
+*			Name:			phoHFilePackField
+*
+*			Summary:		Pack one column:  a transform byte followed by the
+*							column's byte planes.  The column is stored as is;
+*							as the zigzag coded differences between successive
+*							values (which suits slowly changing fields such as
+*							sorted decay times); or, for a field that repeats or
+*							nearly repeats an earlier field of the same size
+*							(such as a PET photon's transaxial position, which is
+*							its y position), xor that field, whose index then
+*							follows the transform byte.  The form is chosen by
+*							its estimated size over a sample of the column.
+*
+*			Arguments:
+*				LbUsOneByte		*records		- The records
+*				LbUsFourByte	recordSize		- Size of a record
+*				LbUsFourByte	count			- Number of records
+*				phoHFileFieldTy	*fields			- The record's columns
+*				LbUsFourByte	fieldIndex		- The column to pack
+*				LbUsEightByte	*values			- Scratch for count values
+*				LbUsEightByte	*coded			- Scratch for count values
+*				LbUsOneByte		*plane			- Scratch for count bytes
+*				LbUsOneByte		*dstBuf			- Receives the packed column
+*
+*			Function return: Number of bytes written to dstBuf.
+*
+*********************************************************************************/
+LbUsFourByte phoHFilePackField(LbUsOneByte *records, LbUsFourByte recordSize,
+			LbUsFourByte count, phoHFileFieldTy *fields, LbUsFourByte fieldIndex,
+			LbUsEightByte *values, LbUsEightByte *coded, LbUsOneByte *plane,
+			LbUsOneByte *dstBuf)	
+{
+	phoHFileFieldTy	*field;				/* The column */
+	LbUsEightByte	sample[PHOHFILE_SAMPLE_SIZE];	/* Sampled values of a form */
+	LbUsEightByte	mask;				/* Bits of the field */
+	LbUsEightByte	signBit;			/* Top bit of the field */
+	LbUsEightByte	delta;				/* Difference from the previous value */
+	LbUsEightByte	*packValues;		/* The column as stored */
+	double			bestBits;			/* Estimated size of the chosen form */
+	double			numBits;			/* Estimated size of the current form */
+	LbUsFourByte	stride;				/* Values between samples */
+	LbUsFourByte	numSamples;			/* Number of samples */
+	LbUsFourByte	refIndex;			/* Earlier column tried as a reference */
+	LbUsFourByte	bestRef;			/* Reference of the chosen form */
+	LbUsFourByte	packedUsed;			/* Bytes written */
+	LbUsFourByte	byteIndex;			/* Current byte plane */
+	LbUsFourByte	i, j;				/* Loop indices */
+	
+	field = &fields[fieldIndex];
+	mask = (field->size == sizeof(LbUsEightByte)) ? ~((LbUsEightByte) 0) :
+		(((LbUsEightByte) 1 << (8*field->size)) - 1);
+	signBit = (LbUsEightByte) 1 << (8*field->size - 1);
+	
+	phoHFileGatherField(records, recordSize, count, 1, field, values);
+	
+	/* Estimate the size of each form from evenly spaced values */
+	stride = (count + PHOHFILE_SAMPLE_SIZE - 1) / PHOHFILE_SAMPLE_SIZE;
+	if (stride == 0)
+		stride = 1;
+	numSamples = 0;
+	for (i = 0; i < count; i += stride) {
+		sample[numSamples++] = values[i];
+	}
+	bestBits = phoHFileSampleBits(sample, numSamples, field->size);
+	dstBuf[0] = PHOHFILE_XFORM_NONE;
+	
+	for (i = 0, j = 0; i < count; i += stride, j++) {
+		delta = (values[i] - ((i == 0) ? 0 : values[i - 1])) & mask;
+		sample[j] = (delta & signBit) ? ((((~delta) & mask) << 1) | 1) : (delta << 1);
+	}
+	numBits = phoHFileSampleBits(sample, numSamples, field->size);
+	if (numBits < bestBits) {
+		bestBits = numBits;
+		dstBuf[0] = PHOHFILE_XFORM_DELTA;
+	}
+	
+	bestRef = fieldIndex;
+	for (refIndex = 0; (refIndex < fieldIndex) && (bestBits > 0.0); refIndex++) {
+		if (fields[refIndex].size != field->size)
+			continue;
+		
+		phoHFileGatherField(records, recordSize, count, stride, &fields[refIndex], sample);
+		for (i = 0, j = 0; i < count; i += stride, j++) {
+			sample[j] ^= values[i];
+		}
+		numBits = phoHFileSampleBits(sample, numSamples, field->size);
+		if (numBits < bestBits) {
+			bestBits = numBits;
+			bestRef = refIndex;
+			dstBuf[0] = PHOHFILE_XFORM_XOR;
+		}
+	}
+	
+	/* Code the whole column in the chosen form */
+	packedUsed = 1;
+	packValues = values;
+	if (dstBuf[0] == PHOHFILE_XFORM_DELTA) {
+		for (i = 0; i < count; i++) {
+			delta = (values[i] - ((i == 0) ? 0 : values[i - 1])) & mask;
+			coded[i] = (delta & signBit) ? ((((~delta) & mask) << 1) | 1) : (delta << 1);
+		}
+		packValues = coded;
+	}
+	else if (dstBuf[0] == PHOHFILE_XFORM_XOR) {
+		dstBuf[packedUsed++] = (LbUsOneByte) bestRef;
+		phoHFileGatherField(records, recordSize, count, 1, &fields[bestRef], coded);
+		for (i = 0; i < count; i++) {
+			coded[i] ^= values[i];
+		}
+		packValues = coded;
+	}
+	
+	for (byteIndex = 0; byteIndex < field->size; byteIndex++) {
+		for (i = 0; i < count; i++) {
+			plane[i] = (LbUsOneByte) (packValues[i] >> (8*byteIndex));
+		}
+		packedUsed += LbCmPackBytes(plane, count, dstBuf + packedUsed);
+	}
+	
+	return (packedUsed);
+}
 
-				}							
+/*********************************************************************************
+*
+*			Name:			phoHFileUnpackField
+*
+*			Summary:		Unpack one column written by phoHFilePackField into
+*							the records.  The earlier columns must already be
+*							unpacked.
+*
+*			Arguments:
+*				LbUsOneByte		*srcBuf			- The packed column
+*				LbUsFourByte	srcSize			- Bytes available in srcBuf
+*				LbUsOneByte		*records		- The records
+*				LbUsFourByte	recordSize		- Size of a record
+*				LbUsFourByte	count			- Number of records
+*				phoHFileFieldTy	*fields			- The record's columns
+*				LbUsFourByte	fieldIndex		- The column to unpack
+*				LbUsEightByte	*values			- Scratch for count values
+*				LbUsOneByte		*plane			- Scratch for count bytes
+*
+*			Function return: Number of bytes read from srcBuf, or zero if the
+*							column is damaged.
+*
+*********************************************************************************/
+LbUsFourByte phoHFileUnpackField(LbUsOneByte *srcBuf, LbUsFourByte srcSize,
+			LbUsOneByte *records, LbUsFourByte recordSize, LbUsFourByte count,
+			phoHFileFieldTy *fields, LbUsFourByte fieldIndex, LbUsEightByte *values,
+			LbUsOneByte *plane)	
+{
+	phoHFileFieldTy	*field;				/* The column */
+	phoHFileFieldTy	*refField = 0;		/* The column xor'ed with this one */
+	LbUsEightByte	mask;				/* Bits of the field */
+	LbUsEightByte	value = 0;			/* Current value */
+	LbUsEightByte	zigzag;				/* Coded difference */
+	LbUsOneByte		*fieldPtr;			/* The field (byte) in the first or current record */
+	LbUsOneByte		*refPtr;			/* The reference field's byte in the first record */
+	LbUsFourByte	packedUsed;			/* Bytes read */
+	LbUsFourByte	planeSize;			/* Bytes read for one plane */
+	LbUsFourByte	byteIndex;			/* Current byte plane */
+	LbUsFourByte	i;					/* Loop index */
+	
+	field = &fields[fieldIndex];
+	if ((srcSize < 1) || (srcBuf[0] > PHOHFILE_XFORM_XOR))
+		return (0);
+	packedUsed = 1;
+	if (srcBuf[0] == PHOHFILE_XFORM_XOR) {
+		if ((srcSize < 2) || (srcBuf[1] >= fieldIndex) ||
+				(fields[srcBuf[1]].size != field->size)) {
+			return (0);
+		}
+		refField = &fields[srcBuf[1]];
+		packedUsed = 2;
+	}
+	
+	mask = (field->size == sizeof(LbUsEightByte)) ? ~((LbUsEightByte) 0) :
+		(((LbUsEightByte) 1 << (8*field->size)) - 1);
+	
+	/* Plain and xor'ed columns go straight from their byte planes to the records */
+	if (srcBuf[0] != PHOHFILE_XFORM_DELTA) {
+		for (byteIndex = 0; byteIndex < field->size; byteIndex++) {
+			planeSize = LbCmUnpackBytes(srcBuf + packedUsed, srcSize - packedUsed, plane, count);
+			if (planeSize == 0)
+				return (0);
+			packedUsed += planeSize;
+			
+			fieldPtr = records + field->offset + byteIndex;
+			if (refField != 0) {
+				refPtr = records + refField->offset + byteIndex;
+				for (i = 0; i < count; i++) {
+					fieldPtr[i*recordSize] = plane[i] ^ refPtr[i*recordSize];
+				}
+			}
+			else {
+				for (i = 0; i < count; i++) {
+					fieldPtr[i*recordSize] = plane[i];
+				}
 			}
 		}
+		
+		return (packedUsed);
+	}
+	
+	/* Assemble the differences from their byte planes */
+	memset(values, 0, count * sizeof(LbUsEightByte));
+	for (byteIndex = 0; byteIndex < field->size; byteIndex++) {
+		planeSize = LbCmUnpackBytes(srcBuf + packedUsed, srcSize - packedUsed, plane, count);
+		if (planeSize == 0)
+			return (0);
+		packedUsed += planeSize;
+		
+		for (i = 0; i < count; i++) {
+			values[i] |= (LbUsEightByte) plane[i] << (8*byteIndex);
+		}
+	}
+	
+	/* Undo the differences and store the field in each record */
+	for (i = 0; i < count; i++) {
+		zigzag = values[i];
+		if (zigzag & 1)
+			value += ~(zigzag >> 1);
+		else
+			value += zigzag >> 1;
+		value &= mask;
+		
+		fieldPtr = records + i*recordSize + field->offset;
+		for (byteIndex = 0; byteIndex < field->size; byteIndex++) {
+			fieldPtr[byteIndex] = (LbUsOneByte) (value >> (8*byteIndex));
+		}
+	}
+	
+	return (packedUsed);
+}
 
-		if (hdrHkTyPtr->customParams.doXcosine == true) {
-				if (fread(&photon->angle.cosine_x, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+/*********************************************************************************
+*
+*			Name:			PhoHFilePrintParams
+*
+*			Summary:		Print parameters for a given history file.
+*
+*			Arguments:
+*				PhoHFileHkTy 		*hdrHkTyPtr			- The header hook
+*
+*			Function return: none.
+*
+*********************************************************************************/
+void PhoHFilePrintParams(PhoHFileHkTy *hdrHkTyPtr)	
+{
+	PhoHFileRunTimeParamsTy	*params = &hdrHkTyPtr->customParams;	/* Just a short cut for accessing the parameters */
 
-					ErStGeneric("Unable to read 'cosine_x' from history file.");
-					goto FAILURE;
-				}
+	LbInPrintf("\n\n\t\tParameters for history file '%s'\n", hdrHkTyPtr->customParamsName);
 
-			if (hdrHkTyPtr->customParams.doXCosRange == true) {
-				if ((photon->angle.cosine_x < hdrHkTyPtr->customParams.xCosMin) ||
-						(photon->angle.cosine_x > hdrHkTyPtr->customParams.xCosMax)) {
+	if (hdrHkTyPtr->customParams.doXposition == true) {
+		LbInPrintf("\n\t\tWriting X-position");
+	}
+	if (hdrHkTyPtr->customParams.doXrange == true) {
+		LbInPrintf("\n\t\t\tX-position range = [%3.2f, %3.2f] cm", params->xPosMin, params->xPosMax);
+	}
 
-					goto FILTERED_OUT;
+	if (hdrHkTyPtr->customParams.doYposition == true) {
+		LbInPrintf("\n\t\tWriting Y-position");
+	}
 
-				}						
-			}
-		}
+	if (hdrHkTyPtr->customParams.doYrange == true) {
+		LbInPrintf("\n\t\t\tY-position range = [%3.2f, %3.2f] cm", params->yPosMin, params->yPosMax);
+	}
 
-		if (hdrHkTyPtr->customParams.doYcosine == true) {
-				if (fread(&photon->angle.cosine_y, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+	if (hdrHkTyPtr->customParams.doZposition == true) {
+		LbInPrintf("\n\t\tWriting Z-position");
+	}
 
-					ErStGeneric("Unable to read 'cosine_y' from history file.");
-					goto FAILURE;
-				}
+	if (hdrHkTyPtr->customParams.doZrange == true) {
+		LbInPrintf("\n\t\t\tZ-position range = [%3.2f, %3.2f] cm", params->zPosMin, params->zPosMax);
+					
+	}
 
-			if (hdrHkTyPtr->customParams.doYCosRange == true) {
-				if ((photon->angle.cosine_y < hdrHkTyPtr->customParams.yCosMin) ||
-						(photon->angle.cosine_y> hdrHkTyPtr->customParams.yCosMax)) {
+	if (hdrHkTyPtr->customParams.doXcosine == true) {
+		LbInPrintf("\n\t\tWriting cosine-X");
+	}
 
-					goto FILTERED_OUT;
+	if (hdrHkTyPtr->customParams.doXCosRange == true) {
+		LbInPrintf("\n\t\t\tX-cosine range = [%3.2f, %3.2f] rd", params->xCosMin, params->xCosMax);
+	}
 
-				}							
-			}
-		}
+	if (hdrHkTyPtr->customParams.doYcosine == true) {
+		LbInPrintf("\n\t\tWriting cosine-Y");
+	}
 
-		if (hdrHkTyPtr->customParams.doZcosine == true) {
-				if (fread(&photon->angle.cosine_z, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+	if (hdrHkTyPtr->customParams.doYCosRange == true) {
+		LbInPrintf("\n\t\t\tY-cosine range = [%3.2f, %3.2f] rd", params->yCosMin, params->yCosMax);
+	}
 
-					ErStGeneric("Unable to read 'cosine_z' from history file.");
-					goto FAILURE;
-				}
+	if (hdrHkTyPtr->customParams.doZcosine == true) {
+		LbInPrintf("\n\t\tWriting cosine-Z");
+	}
 
-			if (hdrHkTyPtr->customParams.doZCosRange == true) {
-				if ((photon->angle.cosine_z < hdrHkTyPtr->customParams.zCosMin) ||
-						(photon->angle.cosine_z > hdrHkTyPtr->customParams.zCosMax)) {
+	if (hdrHkTyPtr->customParams.doZCosRange == true) {
+		LbInPrintf("\n\t\t\tZ-cosine range = [%3.2f, %3.2f] rd", params->zCosMin, params->zCosMax);
+	}
 
-					goto FILTERED_OUT;
+	if (hdrHkTyPtr->customParams.doScattersInObject == true) {
+		LbInPrintf("\n\t\tWriting number of scatters in object");
+	}
 
-				}							
-			}
-		}
+	if (hdrHkTyPtr->customParams.doObjScatRange == true) {
+		LbInPrintf("\n\t\t\tNumber of scatters in object range = [%d, %d] ", params->objScattersMin, params->objScattersMax);
+	}
 
-		if (hdrHkTyPtr->customParams.doScattersInObject == true) {
-				if (fread(&photon->num_of_scatters, sizeof(LbUsFourByte), 1, hdrHkTyPtr->histFile) != 1) {
+	if (hdrHkTyPtr->customParams.doScattersInCollimator == true) {
+		LbInPrintf("\n\t\tWriting number of scatters in collimator");
+	}
 
-					ErStGeneric("Unable to read 'scatters in object' from history file.");
-					goto FAILURE;
-				}
+	if (hdrHkTyPtr->customParams.doColScatRange == true) {
+		LbInPrintf("\n\t\t\tNumber of scatters in collimator range = [%d, %d] ", params->colScattersMin, params->colScattersMax);
+	}
 
-			if (hdrHkTyPtr->customParams.doObjScatRange == true) {
-				if (((LbFourByte)photon->num_of_scatters < hdrHkTyPtr->customParams.objScattersMin) ||
-						((LbFourByte)photon->num_of_scatters > hdrHkTyPtr->customParams.objScattersMax)) {
+	if (hdrHkTyPtr->customParams.doDecayWeight == true) {
+		LbInPrintf("\n\t\tWriting decay weight");
+	}
 
-					goto FILTERED_OUT;
+	if (hdrHkTyPtr->customParams.doWeight == true) {
+		LbInPrintf("\n\t\tWriting photon weight");
+	}
 
-				}						
-			}
-		}
+	if (hdrHkTyPtr->customParams.doEnergy == true) {
+		LbInPrintf("\n\t\tWriting energy");
+	}
 
-		if (hdrHkTyPtr->customParams.doScattersInCollimator == true) {
-				if (fread(&photon->scatters_in_col, sizeof(LbUsFourByte), 1, hdrHkTyPtr->histFile) != 1) {
+	if (hdrHkTyPtr->customParams.doEnergyRange == true) {
+		LbInPrintf("\n\t\t\tEnergy range = [%3.2f, %3.2f] keV", params->energyMin, params->energyMax);
+	}
 
-					ErStGeneric("Unable to read 'scatters in collimator' from history file.");
-					goto FAILURE;
-				}
+	if (hdrHkTyPtr->customParams.doTravelDistance == true) {
+		LbInPrintf("\n\t\tWriting travel distance");
+	}
 
-			if (hdrHkTyPtr->customParams.doColScatRange == true) {
-				if (((LbFourByte)photon->scatters_in_col < hdrHkTyPtr->customParams.colScattersMin) ||
-						((LbFourByte)photon->scatters_in_col > hdrHkTyPtr->customParams.colScattersMax)) {
+	if (hdrHkTyPtr->customParams.doTravDistRange == true) {
+		LbInPrintf("\n\t\t\tTravel distance range = [%3.2f, %3.2f] cm", params->travelDistanceMin, params->travelDistanceMax);
+	}
 
-					goto FILTERED_OUT;
+	if (hdrHkTyPtr->customParams.doDecayXposition == true) {
+		LbInPrintf("\n\t\tWriting decay's X-position");
+	}
 
-				}						
-			}
-		}
+	if (hdrHkTyPtr->customParams.doDecayXrange == true) {
+		LbInPrintf("\n\t\t\tDecay's X-position range = [%3.2f, %3.2f] cm", params->decayXPosMin, params->decayXPosMax);
+	}
 
-		if (hdrHkTyPtr->customParams.doDecayWeight == true) {
-			if (fread(&decay->startWeight, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+	if (hdrHkTyPtr->customParams.doDecayYposition == true) {
+		LbInPrintf("\n\t\tWriting decay's Y-position");
+	}
 
-				ErStGeneric("Unable to read 'decay weight' from history file.");
-				goto FAILURE;
-			}
-		}
+	if (hdrHkTyPtr->customParams.doDecayYrange == true) {
+		LbInPrintf("\n\t\t\tDecay's Y-position range = [%3.2f, %3.2f] cm", params->decayYPosMin, params->decayYPosMax);
+	}
 
-		if (hdrHkTyPtr->customParams.doWeight == true) {
-			/* read in the current weight field */
-			if (fread(&photon->photon_current_weight, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+	if (hdrHkTyPtr->customParams.doDecayZposition == true) {
+		LbInPrintf("\n\t\tWriting decay's Z-position");
+	}
 
-				ErStGeneric("Unable to read 'photon weight' from history file.");
-				goto FAILURE;
-			}
-			/* copy to the scatter or primary weight field */
-			if ((photon->num_of_scatters > 0)) {
-				photon->photon_scatter_weight = photon->photon_current_weight;
-			}
-			else {
-				photon->photon_primary_weight = photon->photon_current_weight;
-			}						
-		}
+	if (hdrHkTyPtr->customParams.doDecayZrange == true) {
+		LbInPrintf("\n\t\t\tDecay's Z-position range = [%3.2f, %3.2f] cm", params->decayZPosMin, params->decayZPosMax);
+	}
 
-		if (hdrHkTyPtr->customParams.doEnergy == true) {
-				if (fread(&photon->energy, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+	if (hdrHkTyPtr->customParams.doDecayTime == true) {
+		LbInPrintf("\n\t\tWriting decay time");
+	}
 
-					ErStGeneric("Unable to read 'energy' from history file.");
-					goto FAILURE;
-				}
+	if (hdrHkTyPtr->customParams.doDecayType == true) {
+		LbInPrintf("\n\t\tWriting decay type");
+	}
 
-			if (hdrHkTyPtr->customParams.doEnergyRange == true) {
-				if ((photon->energy < hdrHkTyPtr->customParams.energyMin) &&
-						(photon->energy > hdrHkTyPtr->customParams.energyMax)) {
+	if (hdrHkTyPtr->customParams.doTransaxialDistance == true) {
+		LbInPrintf("\n\t\tWriting transaxial distance");
+	}
 
-					goto FILTERED_OUT;
+	if (hdrHkTyPtr->customParams.doTransDistRange == true) {
+		LbInPrintf("\n\t\t\tTransaxial distance range = [%3.2f, %3.2f] cm", params->transaxialDistanceMin, params->transaxialDistanceMax);
+	}
 
-				}						
-			}
-		}
+	if (hdrHkTyPtr->customParams.doAzimuthalAngleIndex == true) {
+		LbInPrintf("\n\t\tWriting azimuthal angle index");
+	}
 
-		if (hdrHkTyPtr->customParams.doTravelDistance == true) {
-				if (fread(&photon->travel_distance, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+	if (hdrHkTyPtr->customParams.doAziAngRange == true) {
+		LbInPrintf("\n\t\t\tAzimuthal angle index range = [%d, %d] ", params->aaIndexMin, params->aaIndexMax);
+	}
 
-					ErStGeneric("Unable to read 'travel distance' from history file.");
-					goto FAILURE;
-				}
+	if (hdrHkTyPtr->customParams.doAxialPosition == true) {
+		LbInPrintf("\n\t\tWriting axial position");
+	}
 
-			if (hdrHkTyPtr->customParams.doTravDistRange == true) {
-				if ((photon->travel_distance < hdrHkTyPtr->customParams.travelDistanceMin) ||
-						(photon->travel_distance > hdrHkTyPtr->customParams.travelDistanceMax)) {
+	if (hdrHkTyPtr->customParams.doAxiPosRange == true) {
+		LbInPrintf("\n\t\t\tAxial poition range = [%3.2f, %3.2f] cm", params->axialPositionMin, params->axialPositionMax);
+	}
 
-					goto FILTERED_OUT;
+	if (hdrHkTyPtr->customParams.doDetectorXposition == true) {
+		LbInPrintf("\n\t\tWriting detector X-position");
+	}
 
-				}
-			}
-		}
+	if (hdrHkTyPtr->customParams.doDetectorXposRange == true) {
+		LbInPrintf("\n\t\t\tDetector X-position range = [%3.2f, %3.2f] cm", params->detectorXpositionMin, params->detectorXpositionMax);
+	}
 
-		if (hdrHkTyPtr->customParams.doDecayXposition == true) {
-				if (fread(&decay->location.x_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+	if (hdrHkTyPtr->customParams.doDetectorYposition == true) {
+		LbInPrintf("\n\t\tWriting detector Y-position");
+	}
 
-					ErStGeneric("Unable to read 'decay x position' from history file.");
-					goto FAILURE;
-				}
+	if (hdrHkTyPtr->customParams.doDetectorYposRange == true) {
+		LbInPrintf("\n\t\t\tDetector Y-position range = [%3.2f, %3.2f] cm", params->detectorYpositionMin, params->detectorYpositionMax);
+	}
 
-			if (hdrHkTyPtr->customParams.doDecayXrange == true) {
-				if ((decay->location.x_position < hdrHkTyPtr->customParams.decayXPosMin) ||
-						(decay->location.x_position > hdrHkTyPtr->customParams.decayXPosMax)) {
+	if (hdrHkTyPtr->customParams.doDetectorZposition == true) {
+		LbInPrintf("\n\t\tWriting detector Z-position");
+	}
 
-					goto FILTERED_OUT;
+	if (hdrHkTyPtr->customParams.doDetectorZposRange == true) {
+		LbInPrintf("\n\t\t\tDetector Z-position range = [%3.2f, %3.2f] cm", params->detectorZpositionMin, params->detectorZpositionMax);
+	}
 
-				}
-			}
-		}
+	if (hdrHkTyPtr->customParams.doDetectorAngle == true) {
+		LbInPrintf("\n\t\tWriting detector angle");
+	}
 
-		if (hdrHkTyPtr->customParams.doDecayYposition == true) {
-				if (fread(&decay->location.y_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+	if (hdrHkTyPtr->customParams.doDetectorAngleRange == true) {
+		LbInPrintf("\n\t\t\tDetector angle range = [%3.2f, %3.2f] radians", params->detectorAngleMin, params->detectorAngleMax);
+	}
 
-					ErStGeneric("Unable to read 'decay y position' from history file.");
-					goto FAILURE;
-				}
+	if (hdrHkTyPtr->customParams.doNumDetectorInteractions == true) {
+		LbInPrintf("\n\t\tWriting number of detector interactions");
+	}
 
-			if (hdrHkTyPtr->customParams.doDecayYrange == true) {
-				if ((decay->location.y_position < hdrHkTyPtr->customParams.decayYPosMin) ||
-						(decay->location.y_position > hdrHkTyPtr->customParams.decayYPosMax)) {
+	if (hdrHkTyPtr->customParams.doDetectorCrystal == true) {
+		LbInPrintf("\n\t\tWriting detector crystal for detection");
+	}
 
-					goto FILTERED_OUT;
+}
 
-				}
+/*********************************************************************************
+*
+*			Name:			PhoHFilePrintReport
+*
+*			Summary:		Print report for a given history file.
+*
+*			Arguments:
+*				PhoHFileHkTy 		*hdrHkTyPtr			- The header hook
+*
+*			Function return: none.
+*
+*********************************************************************************/
+void PhoHFilePrintReport(PhoHFileHkTy *hdrHkTyPtr)	
+{
+	LbInPrintf("\n\n\tNumber of blue photons reaching history file = %lld", hdrHkTyPtr->bluesReceived);
+	LbInPrintf("\n\tNumber of blue photons written to history file = %lld", hdrHkTyPtr->bluesAccepted);
+	LbInPrintf("\n\tNumber of pink photons reaching history file = %lld", hdrHkTyPtr->pinksReceived);
+	LbInPrintf("\n\tNumber of pink photons written to history file = %lld", hdrHkTyPtr->pinksAccepted);
+	LbInPrintf("\n");
+	
+}
+
+/*********************************************************************************
+*
+*			Name:			PhoHFileWriteDetections
+*
+*			Summary:		Write the detected decay and photons.
+*
+*			Arguments:
+*				PhoHFileHkTy 		*hdrHkTyPtr		- The history hook
+*				PHG_Decay			decay			- The decay that started the process.
+*				PHG_TrackingPhoton *bluePhotons		- The blue photons detected.
+*				LbUsFourByte 		numBluePhotons	- The number of blue photons.
+*				PHG_TrackingPhoton *pinkPhotons		- The  pink photons detected.
+*				LbUsFourByte		numPinkPhotons	- The number of pink photons.
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean PhoHFileWriteDetections(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay,
+			PHG_TrackingPhoton *bluePhotons, LbUsFourByte numBluePhotons,
+			PHG_TrackingPhoton *pinkPhotons, LbUsFourByte numPinkPhotons)
+{
+	Boolean				okay = false;
+	LbUsFourByte		blueIndex;
+	LbUsFourByte		pinkIndex;
+	LbUsOneByte			numBlueAccepted = 0;
+	LbUsOneByte			numPinkAccepted = 0;
+	LbUsFourByte		countOffset;
+	PHG_DetectedPhoton	detectedPhoton;
+	
+	do { /* Process Loop */
+
+		/* Pass a full buffer on to the file before starting the decay */
+		if (hdrHkTyPtr->recordBufferUsed >= PHOHFILE_FlushSize(hdrHkTyPtr)) {
+			if (phoHFilePassBuffer(hdrHkTyPtr) == false) {
+				goto FAILURE;
 			}
 		}
+		
+		/* Write out the binary flag and record */
+		if ((numBluePhotons != 0) || (numPinkPhotons != 0)) {
+			if (hdrHkTyPtr->doCustom == false) {
 
-		if (hdrHkTyPtr->customParams.doDecayZposition == true) {
-				if (fread(&decay->location.z_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to read 'decay z position' from history file.");
+				if (phoHFileBufferWrite(hdrHkTyPtr, &PhoHFileDecayFlag, sizeof(LbUsOneByte)) == false) {
+		
+					ErStGeneric("Unable to write decay flag to history binary file.");
 					goto FAILURE;
 				}
 
-			if (hdrHkTyPtr->customParams.doDecayZrange == true) {
-				if ((decay->location.z_position < hdrHkTyPtr->customParams.decayZPosMin) ||
-						(decay->location.z_position > hdrHkTyPtr->customParams.decayZPosMax)) {
-
-					goto FILTERED_OUT;
-
-				}
-			}
-		}
-
-		if (hdrHkTyPtr->customParams.doDecayTime == true) {
-			/* read in the current weight field */
-			if (fread(&decay->decayTime, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-				ErStGeneric("Unable to read 'decay time' from history file.");
-				goto FAILURE;
-			}
-		}
-
-		if (hdrHkTyPtr->customParams.doDecayType == true) {
-			/* read in the current weight field */
-			if (fread(&decay->decayType, sizeof(LbUsOneByte), 1, hdrHkTyPtr->histFile) != 1) {
-
-				ErStGeneric("Unable to read 'decay type' from history file.");
-				goto FAILURE;
-			}
-		}
-
-		if (hdrHkTyPtr->customParams.doTransaxialDistance == true) {
-				if (fread(&photon->transaxialPosition, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to read 'transaxial position' from history file.");
+				if (phoHFileBufferWrite(hdrHkTyPtr, decay, sizeof(PHG_Decay)) == false) {
+		
+					ErStGeneric("Unable to write decay to history binary file.");
 					goto FAILURE;
-				}
-
-			if (hdrHkTyPtr->customParams.doTransDistRange == true) {
-				if ((photon->transaxialPosition < hdrHkTyPtr->customParams.transaxialDistanceMin) ||
-						(photon->transaxialPosition > hdrHkTyPtr->customParams.transaxialDistanceMax)) {
-
-					goto FILTERED_OUT;
-
-				}
-			}
+				}							
+						
+				/* Increment count of outputed decays */
+				hdrHkTyPtr->header.H.NumDecays += 1;
+			}	
 		}
+	
+		if (hdrHkTyPtr->doCustom == false) {
 
-		if (hdrHkTyPtr->customParams.doAzimuthalAngleIndex == true) {
-				if (fread(&photon->azimuthalAngleIndex, sizeof(LbUsFourByte), 1, hdrHkTyPtr->histFile) != 1) {
+			/* Process coincidences */
+			for (blueIndex = 0; blueIndex < numBluePhotons; blueIndex++) {
+				
+				/* Incremement Count */
+				hdrHkTyPtr->bluesReceived++;
+			
+				/* Write out the binary flag and record */
+				if (phoHFileBufferWrite(hdrHkTyPtr, &PhoHFilePhotonFlag, sizeof(LbUsOneByte)) == false) {
 
-					ErStGeneric("Unable to read 'azimuthal angle index' from history file.");
+					ErStGeneric("Unable to write photon flag to history binary file.");
 					goto FAILURE;
 				}
+				
+				/* Convert to detected photon */
+				phoHFileCreateDetectedPhoton(&(bluePhotons[blueIndex]),
+					&detectedPhoton);
 
-			if (hdrHkTyPtr->customParams.doAziAngRange == true) {
-				if ((photon->azimuthalAngleIndex < hdrHkTyPtr->customParams.aaIndexMin) ||
-						(photon->azimuthalAngleIndex > hdrHkTyPtr->customParams.aaIndexMax)) {
-
-					goto FILTERED_OUT;
-
-				}
-			}
-		}
-
-		if (hdrHkTyPtr->customParams.doAxialPosition == true) {
-
-			if (fread(&photon->axialPosition, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-				ErStGeneric("Unable to read 'axial position' from history file.");
-				goto FAILURE;
-			}
-
-			if (hdrHkTyPtr->customParams.doAxiPosRange == true) {
-				if ((photon->axialPosition < hdrHkTyPtr->customParams.axialPositionMin) ||
-						(photon->axialPosition > hdrHkTyPtr->customParams.axialPositionMax)) {
-
-					goto FILTERED_OUT;
-
-				}
-			}
-		}
-
-		if (hdrHkTyPtr->customParams.doDetectorXposition == true) {
-			if (fread(&photon->detLocation.x_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-				ErStGeneric("Unable to read 'detector X-axis position' from history file.");
-				goto FAILURE;
-			}
-
-			if (hdrHkTyPtr->customParams.doDetectorXposRange == true) {
-				if ((photon->detLocation.x_position < hdrHkTyPtr->customParams.detectorXpositionMin) ||
-						(photon->detLocation.x_position > hdrHkTyPtr->customParams.detectorXpositionMax)) {
-
-					goto FILTERED_OUT;
+				if (phoHFileBufferWrite(hdrHkTyPtr, &detectedPhoton, sizeof(PHG_DetectedPhoton)) == false) {
 
+					ErStGeneric("Unable to write blue photon to history binary file.");
+					goto FAILURE;
 				}
+				
+				hdrHkTyPtr->bluesAccepted++;
 			}
-		}
-
-		if (hdrHkTyPtr->customParams.doDetectorYposition == true) {
-			if (fread(&photon->detLocation.y_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+		}	/* Do custom header if there is at least one photon to write */
+		else if ((numBluePhotons != 0) || (numPinkPhotons != 0)) {
+			
+			/* Clear counter */
+			numBlueAccepted = 0;
 
-				ErStGeneric("Unable to read 'detector Y-axis position' from history file.");
+			/* Leave room for the count, it is filled in once the photons are written */
+			countOffset = hdrHkTyPtr->recordBufferUsed;
+			if (phoHFileBufferWrite(hdrHkTyPtr, &numBlueAccepted, sizeof(LbUsOneByte)) == false) {
+				ErStGeneric("Unable to write number of blues accepted to history binary file (PhoHFileWriteDetections).");
 				goto FAILURE;
 			}
-
-			if (hdrHkTyPtr->customParams.doDetectorYposRange == true) {
-				if ((photon->detLocation.y_position < hdrHkTyPtr->customParams.detectorYpositionMin) ||
-						(photon->detLocation.y_position > hdrHkTyPtr->customParams.detectorYpositionMax)) {
-
-					goto FILTERED_OUT;
-
-				}
-			}
-		}
-
-		if (hdrHkTyPtr->customParams.doDetectorZposition == true) {
-				if (fread(&photon->detLocation.z_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to read 'detector Z-axis position' from history file.");
+			
+			/* Process coincidences */
+			for (blueIndex = 0; blueIndex < numBluePhotons; blueIndex++) {
+				
+				/* Incremement Count */
+				hdrHkTyPtr->bluesReceived++;
+				
+				if (phoHFileWriteFields(hdrHkTyPtr, decay, &bluePhotons[blueIndex],
+						&numBlueAccepted) == false) {
+						
 					goto FAILURE;
 				}
-
-			if (hdrHkTyPtr->customParams.doDetectorZposRange == true) {
-				if ((photon->detLocation.z_position < hdrHkTyPtr->customParams.detectorZpositionMin) ||
-						(photon->detLocation.z_position > hdrHkTyPtr->customParams.detectorZpositionMax)) {
-
-					goto FILTERED_OUT;
-
-				}
+				hdrHkTyPtr->bluesAccepted += numBlueAccepted;
 			}
+			
+			/* Write the number of blue photons */
+			hdrHkTyPtr->recordBuffer[countOffset] = numBlueAccepted;
 		}
+		
+		/* Now process pink photons */
+		if (hdrHkTyPtr->doCustom == false) {
+					
+			for (pinkIndex = 0; pinkIndex < numPinkPhotons; pinkIndex++) {
 
-		if (hdrHkTyPtr->customParams.doDetectorAngle == true) {
-				if (fread(&photon->detectorAngle, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+				/* Incremement Count */
+				hdrHkTyPtr->pinksReceived++;
+				
+				/* Write out the binary flag and record */
+				if (phoHFileBufferWrite(hdrHkTyPtr, &PhoHFilePhotonFlag, sizeof(LbUsOneByte)) == false) {
 
-					ErStGeneric("Unable to read 'detector angle' from history file.");
+					ErStGeneric("Unable to write photon flag to history binary file.");
 					goto FAILURE;
 				}
 
-			if (hdrHkTyPtr->customParams.doDetectorAngleRange == true) {
-				if ((photon->detectorAngle < hdrHkTyPtr->customParams.detectorAngleMin) ||
-						(photon->detectorAngle > hdrHkTyPtr->customParams.detectorAngleMax)) {
-
-					goto FILTERED_OUT;
-
-				}
-			}
-		}
-
-		if (hdrHkTyPtr->customParams.doDetectorCrystal == true) {
-				if (fread(&photon->detCrystal, sizeof(LbFourByte), 1, hdrHkTyPtr->histFile) != 1) {
+				/* Convert to detected photon */
+				phoHFileCreateDetectedPhoton(&(pinkPhotons[pinkIndex]),
+					&detectedPhoton);	
+				
+				if (phoHFileBufferWrite(hdrHkTyPtr, &detectedPhoton, sizeof(PHG_DetectedPhoton)) == false) {
 
-					ErStGeneric("Unable to read 'detector crystal' from history file.");
+					ErStGeneric("Unable to write pink photon to history binary file.");
 					goto FAILURE;
 				}
-
-		}
-
-		if (hdrHkTyPtr->customParams.doNumDetectorInteractions == true) {
-			if (fread(&photon->num_det_interactions, sizeof(LbUsFourByte), 1, hdrHkTyPtr->histFile) != 1) {
-
-				ErStGeneric("Unable to read 'number of detector interactions' from history file.");
-				goto FAILURE;
-			}
-
-			if ((photon->detLocation.z_position < hdrHkTyPtr->customParams.detectorZpositionMin) ||
-					(photon->detLocation.z_position > hdrHkTyPtr->customParams.detectorZpositionMax)) {
-
-				goto FILTERED_OUT;
-
+				
+				hdrHkTyPtr->pinksAccepted++;
 			}
 		}
+		/* Custom history file bug fix */
+		else if (PHG_IsPET() & ((numBluePhotons != 0) || (numPinkPhotons != 0))) {
 
-		if (hdrHkTyPtr->customParams.doDetInteractionPos == true) {
-			if (fread(&photon->num_det_interactions, sizeof(LbUsFourByte), 1, hdrHkTyPtr->histFile) != 1) {
+		       /* old code replaced by above line */
+		       /* else if (PHG_IsPET()) */
+			
+			/* Clear counter */	
+			numPinkAccepted = 0;
 
-				ErStGeneric("Unable to read 'number of detector interactions' from history file for list of interaction positions.");
+			/* Leave room for the count, it is filled in once the photons are written */
+			countOffset = hdrHkTyPtr->recordBufferUsed;
+			if (phoHFileBufferWrite(hdrHkTyPtr, &numPinkAccepted, sizeof(LbUsOneByte)) == false) {
+				ErStGeneric("Unable to write number of pinks accepted to history binary file (PhoHFileWriteDetections).");
 				goto FAILURE;
 			}
-			for (i = 0; i < photon->num_det_interactions; i++) {
-
-				if (fread(&photon->det_interactions[i].pos.x_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to read 'x-position of interaction' from history file for list of interaction positions.");
-					goto FAILURE;
-				}
-
-				if (fread(&photon->det_interactions[i].pos.y_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to read 'y-position of interaction' from history file for list of interaction positions.");
-					goto FAILURE;
-				}
-
-				if (fread(&photon->det_interactions[i].pos.z_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to read 'z-position of interaction' from history file for list of interaction positions.");
-					goto FAILURE;
-				}
-
-				if (fread(&photon->det_interactions[i].energy_deposited, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
-
-					ErStGeneric("Unable to read 'energy of interaction' from history file for list of interaction positions.");
-					goto FAILURE;
-				}
+			
+			for (pinkIndex = 0; pinkIndex < numPinkPhotons; pinkIndex++) {
+			
+				/* Incremement Count */
+				hdrHkTyPtr->pinksReceived++;
 
-				if (fread(&photon->det_interactions[i].isActive, sizeof(Boolean), 1, hdrHkTyPtr->histFile) != 1) {
+				if (phoHFileWriteFields(hdrHkTyPtr, decay, &pinkPhotons[pinkIndex],
+						&numPinkAccepted) == false) {
 
-					ErStGeneric("Unable to read 'is-Active of interaction' from history file for list of interaction positions.");
 					goto FAILURE;
 				}
+				hdrHkTyPtr->pinksAccepted += numPinkAccepted;
 			}
+			
+			/* Write the number of pink photons */
+			hdrHkTyPtr->recordBuffer[countOffset] = numPinkAccepted;
 		}
 		
-		
-		*photonAccepted = true;
-		FILTERED_OUT:;
+		/* Increment count of outputed photons */
+		if (hdrHkTyPtr->doCustom == false) {
+			hdrHkTyPtr->header.H.NumPhotons += (numBluePhotons + numPinkPhotons);
+		}
+		else {
+			hdrHkTyPtr->header.H.NumPhotons += (numBlueAccepted + numPinkAccepted);
+		}
+
 		okay = true;
 		FAILURE:;
 	} while (false);
@@ -1887,841 +3344,3170 @@ Boolean PhoHFileReadFields(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay,
 
 /*********************************************************************************
 *
-*			Name:			PhoHFilePrintFields
-*
-*			Summary:		Print the fields of photons.
+*	Name:			PhoHFileRewriteDetections
 *
-*			Arguments:
-*				PhoHFileHkTy 		*hdrHkTyPtr		- Header information 
-*				PHG_Decay			*decay			- The decay that started the process.
-*				PHG_TrackingPhoton 	*photon			- The blue photons detected.
-*			Function return: None.
+*	Summary:		Write the decay and photons.
+*					Match the blue/pink scheme.
+*					Similar to PhoHFileWriteDetections except has 
+*					PHG_DetectedPhoton for arguments rather than
+*					PHG_TrackingPhoton.  This allows history decays
+*					to be copied more easily from file to file.
+*
+*	Arguments:
+*		PhoHFileHkTy 		*hdrHkTyPtr		- The history hook
+*		PHG_Decay			decay			- The decay that started the process.
+*		PHG_DetectedPhoton *bluePhotons		- The blue photons detected.
+*		LbUsFourByte 		numBluePhotons	- The number of blue photons.
+*		PHG_DetectedPhoton *pinkPhotons		- The  pink photons detected.
+*		LbUsFourByte		numPinkPhotons	- The number of pink photons.
+*
+*	Function return: True unless an error occurs.
 *
 *********************************************************************************/
-void PhoHFilePrintFields(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay, PHG_TrackingPhoton *photon)
+Boolean PhoHFileRewriteDetections(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay,
+			PHG_DetectedPhoton *bluePhotons, LbUsFourByte numBluePhotons,
+			PHG_DetectedPhoton *pinkPhotons, LbUsFourByte numPinkPhotons)
 {
+	Boolean				okay = false;
+	LbUsFourByte		blueIndex;
+	LbUsFourByte		pinkIndex;
+	LbUsOneByte			numBlueAccepted = 0;
+	LbUsOneByte			numPinkAccepted = 0;
 	
-
-		if (hdrHkTyPtr->customParams.doXposition == true) {
-				LbInPrintf("\nx position = %3.3e", photon->location.x_position);
+	
+	do { /* Process Loop */
+		
+		/* Pass a full buffer on to the file before starting the decay */
+		if (hdrHkTyPtr->recordBufferUsed >= PHOHFILE_FlushSize(hdrHkTyPtr)) {
+			if (phoHFilePassBuffer(hdrHkTyPtr) == false) {
+				goto FAILURE;
+			}
 		}
+		
+		/* Write out the binary flag and record */
+		if ((numBluePhotons != 0) || (numPinkPhotons != 0)) {
+			if (phoHFileBufferWrite(hdrHkTyPtr, &PhoHFileDecayFlag, sizeof(LbUsOneByte)) == false) {
+	
+				ErStGeneric("Unable to write decay flag to history binary file.");
+				goto FAILURE;
+			}
 
-		if (hdrHkTyPtr->customParams.doYposition == true) {
-				LbInPrintf("\ny position = %3.3e", photon->location.y_position);
+			if (phoHFileBufferWrite(hdrHkTyPtr, decay, sizeof(PHG_Decay)) == false) {
+	
+				ErStGeneric("Unable to write decay to history binary file.");
+				goto FAILURE;
+			}							
+					
+			/* Increment count of outputed decays */
+			hdrHkTyPtr->header.H.NumDecays += 1;
 		}
+		
+		/* Process coincidences */
+		for (blueIndex = 0; blueIndex < numBluePhotons; blueIndex++) {
+			
+			/* Incremement Count */
+			hdrHkTyPtr->bluesReceived++;
+		
+			/* Write out the binary flag and record */
+			if (phoHFileBufferWrite(hdrHkTyPtr, &PhoHFilePhotonFlag, sizeof(LbUsOneByte)) == false) {
 
-		if (hdrHkTyPtr->customParams.doZposition == true) {
-				LbInPrintf("\nz position = %3.3e", photon->location.z_position);
-		}
+				ErStGeneric("Unable to write photon flag to history binary file.");
+				goto FAILURE;
+			}
+			
+			/* Write out the detected photon */
+			if (phoHFileBufferWrite(hdrHkTyPtr, &(bluePhotons[blueIndex]), sizeof(PHG_DetectedPhoton)) == false) {
 
-		if (hdrHkTyPtr->customParams.doXcosine == true) {
-				LbInPrintf("\ncosine x = %3.3e", photon->angle.cosine_x);
+				ErStGeneric("Unable to write blue photon to history binary file.");
+				goto FAILURE;
+			}
+			
+			hdrHkTyPtr->bluesAccepted++;
 		}
+		
+		/* Now process pink photons */
+		for (pinkIndex = 0; pinkIndex < numPinkPhotons; pinkIndex++) {
 
-		if (hdrHkTyPtr->customParams.doYcosine == true) {
-				LbInPrintf("\ncosine y = %3.3e", photon->angle.cosine_y);
-		}
+			/* Incremement Count */
+			hdrHkTyPtr->pinksReceived++;
+			
+			/* Write out the binary flag and record */
+			if (phoHFileBufferWrite(hdrHkTyPtr, &PhoHFilePhotonFlag, sizeof(LbUsOneByte)) == false) {
 
-		if (hdrHkTyPtr->customParams.doZcosine == true) {
-				LbInPrintf("\ncosine z = %3.3e", photon->angle.cosine_z);
-		}
+				ErStGeneric("Unable to write photon flag to history binary file.");
+				goto FAILURE;
+			}
 
-		if (hdrHkTyPtr->customParams.doScattersInObject == true) {
-				LbInPrintf("\nnumber of scatters = %d", photon->num_of_scatters);
+			/* Write out the detected photon */
+			if (phoHFileBufferWrite(hdrHkTyPtr, &(pinkPhotons[pinkIndex]), sizeof(PHG_DetectedPhoton)) == false) {
+				
+				ErStGeneric("Unable to write pink photon to history binary file.");
+				goto FAILURE;
+			}
+			
+			hdrHkTyPtr->pinksAccepted++;
 		}
-
-		if (hdrHkTyPtr->customParams.doScattersInCollimator == true) {
-				LbInPrintf("\nnumber of scatters in collimator = %d", photon->scatters_in_col);
+		
+		/* Increment count of outputed photons */
+		if (hdrHkTyPtr->doCustom == false) {
+			hdrHkTyPtr->header.H.NumPhotons += (numBluePhotons + numPinkPhotons);
 		}
-
-		if (hdrHkTyPtr->customParams.doDecayWeight == true) {
-			LbInPrintf("\ndecay weight = %3.3e", decay->startWeight);
+		else {
+			hdrHkTyPtr->header.H.NumPhotons += (numBlueAccepted + numPinkAccepted);
 		}
 
-		if (hdrHkTyPtr->customParams.doWeight == true) {
-			LbInPrintf("\nphoton weight = %3.3e", photon->photon_current_weight);
-		}
+		okay = true;
+		FAILURE:;
+	} while (false);
+	
+	return (okay);
+}
 
-		if (hdrHkTyPtr->customParams.doEnergy == true) {
-				LbInPrintf("\nenergy = %3.1f", photon->energy);
-		}
 
-		if (hdrHkTyPtr->customParams.doTravelDistance == true) {
-				LbInPrintf("\ntravel distance = %3.3e", photon->travel_distance);
-		}
+/*********************************************************************************
+*
+*			Name:			phoHFileWriteFields
+*
+*			Summary:		Write the detected decay and photons.
+*
+*			Arguments:
+*				PhoHFileHkTy 		*hdrHkTyPtr		- The history hook
+*				PHG_Decay			*decay			- The decay that started the process.
+*				PHG_TrackingPhoton 	*photon			- The blue photons detected.
+*				LbUsOneByte			*numAccepted	- Count of accepted (written)
+*			Function return: None.
+*
+*********************************************************************************/
+Boolean phoHFileWriteFields(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay,
+			PHG_TrackingPhoton *photon, LbUsOneByte *numAccepted)
+{
+	Boolean			okay = false;
+	LbUsFourByte	i, size;
+	
+	do { /* Process Loop */
+	
+		#ifdef PHG_DEBUG_INTENSELY
+			PhoHFilePrintFields(hdrHkTyPtr, decay, photon);
+		#endif
+		
+		/* First, filter acceptable photons */
+		
+		if (hdrHkTyPtr->customParams.doXrange == true) {
+			if ((photon->location.x_position < hdrHkTyPtr->customParams.xPosMin) ||
+					(photon->location.x_position > hdrHkTyPtr->customParams.xPosMax)) {
 
-		if (hdrHkTyPtr->customParams.doDecayXposition == true) {
-				LbInPrintf("\n decay x position = %3.3e", decay->location.x_position);
-		}
+				goto FILTERED_OUT;
 
-		if (hdrHkTyPtr->customParams.doDecayYposition == true) {
-				LbInPrintf("\n decay y position = %3.3e", decay->location.y_position);
+			}						
 		}
 
-		if (hdrHkTyPtr->customParams.doDecayZposition == true) {
-				LbInPrintf("\n decay z position = %3.3e", decay->location.z_position);
-		}
+		if (hdrHkTyPtr->customParams.doYrange == true) {
+			if ((photon->location.y_position < hdrHkTyPtr->customParams.yPosMin) ||
+					(photon->location.y_position > hdrHkTyPtr->customParams.yPosMax)) {
 
-		if (hdrHkTyPtr->customParams.doDecayTime == true) {
-				LbInPrintf("\n decay time = %4.4e", decay->decayTime);
-		}
+				goto FILTERED_OUT;
 
-		if (hdrHkTyPtr->customParams.doDecayType == true) {
-			if (decay->decayType == PhgEn_SinglePhoton)
-				LbInPrintf("\n decay type = single photon");
-			else if (decay->decayType == PhgEn_Positron)
-				LbInPrintf("\n decay type = positron");
-			else if (decay->decayType == PhgEn_PETRandom)
-				LbInPrintf("\n decay type = random");
-			else if (decay->decayType == PhgEn_Complex)
-				LbInPrintf("\n decay type = complex");
-			else 
-				LbInPrintf("\n WARNING: decay type UNKNOWN.");
+			}							
 		}
 
-		if (hdrHkTyPtr->customParams.doTransaxialDistance == true) {
-				LbInPrintf("\ntransaxial distance = %3.3e", photon->transaxialPosition);
-		}
+		if (hdrHkTyPtr->customParams.doZrange == true) {
+			if ((photon->location.z_position < hdrHkTyPtr->customParams.zPosMin) ||
+					(photon->location.z_position > hdrHkTyPtr->customParams.zPosMax)) {
 
-		if (hdrHkTyPtr->customParams.doAzimuthalAngleIndex == true) {
-				LbInPrintf("\nazimuthal angle = %d", photon->azimuthalAngleIndex);
-		}
+				goto FILTERED_OUT;
 
-		if (hdrHkTyPtr->customParams.doAxialPosition == true) {
-				LbInPrintf("\naxial position = %3.3e", photon->axialPosition);
+			}							
 		}
 
-		if (hdrHkTyPtr->customParams.doDetectorXposition == true) {
-				LbInPrintf("\ndetector x position = %3.3e", photon->detLocation.x_position);
-		}
+		if (hdrHkTyPtr->customParams.doXCosRange == true) {
+			if ((photon->angle.cosine_x < hdrHkTyPtr->customParams.xCosMin) ||
+					(photon->angle.cosine_x > hdrHkTyPtr->customParams.xCosMax)) {
 
-		if (hdrHkTyPtr->customParams.doDetectorYposition == true) {
-				LbInPrintf("\ndetector y position = %3.3e", photon->detLocation.y_position);
+				goto FILTERED_OUT;
+
+			}						
 		}
 
-		if (hdrHkTyPtr->customParams.doDetectorZposition == true) {
-				LbInPrintf("\ndetector z position = %3.3e", photon->detLocation.z_position);
+		if (hdrHkTyPtr->customParams.doYCosRange == true) {
+			if ((photon->angle.cosine_y < hdrHkTyPtr->customParams.yCosMin) ||
+					(photon->angle.cosine_y > hdrHkTyPtr->customParams.yCosMax)) {
+
+				goto FILTERED_OUT;
+
+			}							
 		}
 
-		if (hdrHkTyPtr->customParams.doDetectorAngle == true) {
-				LbInPrintf("\ndetector angle = %3.3e", photon->detectorAngle);
+		if (hdrHkTyPtr->customParams.doZCosRange == true) {
+			if ((photon->angle.cosine_z < hdrHkTyPtr->customParams.zCosMin) ||
+					(photon->angle.cosine_z > hdrHkTyPtr->customParams.zCosMax)) {
+
+				goto FILTERED_OUT;
+
+			}							
 		}
 
-		if (hdrHkTyPtr->customParams.doDetectorCrystal == true) {
-				LbInPrintf("\ndetector crystal = %d", photon->detCrystal);
+		if (hdrHkTyPtr->customParams.doObjScatRange == true) {
+			if (((LbFourByte)photon->num_of_scatters < hdrHkTyPtr->customParams.objScattersMin) ||
+					((LbFourByte)photon->num_of_scatters > hdrHkTyPtr->customParams.objScattersMax)) {
+
+				goto FILTERED_OUT;
+
+			}						
 		}
 
-		if (hdrHkTyPtr->customParams.doNumDetectorInteractions == true) {
-			LbInPrintf("\nnumber of detector interactions = %d", photon->num_det_interactions);
+		if (hdrHkTyPtr->customParams.doColScatRange == true) {
+			if (((LbFourByte)photon->scatters_in_col < hdrHkTyPtr->customParams.colScattersMin) ||
+					((LbFourByte)photon->scatters_in_col > hdrHkTyPtr->customParams.colScattersMax)) {
+
+				goto FILTERED_OUT;
+
+			}						
 		}
-		
-		LbInPrintf("\n");
-}
 
-/*********************************************************************************
-*
-*			Name:		phoHFileCreateDetectedPhoton
-*
-*			Summary:	Make a new detected photon (To write to the history file).
-*			Arguments:
-*				PHG_TrackingPhoton	*trackingphoton	- The tracking photon.
-*				PHG_DetectedPhoton	*detectedphoton	- The detected photon.
-*				
-*			Function return: None.
-*
-*********************************************************************************/
-void phoHFileCreateDetectedPhoton(PHG_TrackingPhoton *trackingphoton,
-		PHG_DetectedPhoton *detectedphoton)	
-{
-	LbUsFourByte		numScatters;	/* sum of the scatters in object and collimator */
-	
-	/* Convert tracking photon travel distance to "time since creation" */
-	detectedphoton->time_since_creation = trackingphoton->travel_distance/PHGMATH_SPEED_OF_LIGHT;
-
-	/* Convert the tracking photon to an detected photon */
-	detectedphoton->location.x_position = (float) trackingphoton->location.x_position;
-	detectedphoton->location.y_position = (float) trackingphoton->location.y_position;
-	detectedphoton->location.z_position = (float) trackingphoton->location.z_position;
+		if (hdrHkTyPtr->customParams.doEnergyRange == true) {
+			if ((photon->energy < hdrHkTyPtr->customParams.energyMin) ||
+					(photon->energy > hdrHkTyPtr->customParams.energyMax)) {
 
-	detectedphoton->angle.cosine_x = (float) trackingphoton->angle.cosine_x;
-	detectedphoton->angle.cosine_y = (float) trackingphoton->angle.cosine_y;
-	detectedphoton->angle.cosine_z = (float) trackingphoton->angle.cosine_z;
+				goto FILTERED_OUT;
 
-	detectedphoton->energy = (float) trackingphoton->energy;
-	detectedphoton->transaxialPosition = trackingphoton->transaxialPosition;
-	detectedphoton->azimuthalAngleIndex = trackingphoton->azimuthalAngleIndex;
-	detectedphoton->detectorAngle = trackingphoton->detectorAngle;
-	detectedphoton->detCrystal = trackingphoton->detCrystal;
-	
-	/* Set the weight */
-	detectedphoton->photon_weight = trackingphoton->photon_current_weight;
-		
-	/* Construct the flags */
-	{
-		/* Start by setting number of scatters flags */
+			}						
+		}
 
-		/* sum the scatters in the object and collimator--if the user wants to preserve
-		the difference between the two, they need to use the custom history file */
-		numScatters = trackingphoton->num_of_scatters + trackingphoton->scatters_in_col;
-		
-		if (numScatters >= MAX_SCATTERS)
-			detectedphoton->flags = (MAX_SCATTERS << 2);
-		else
-			detectedphoton->flags = (numScatters << 2);
-		
-		/* Now set "blue" flag */
-		if (PHG_IsBlue(trackingphoton))
-			LbFgSet(detectedphoton->flags, PHGFg_PhotonBlue);
-	}
-}
-					
-/*********************************************************************************
-*
-*			Name:			PhoHFileGetRunTimeParams
-*
-*			Summary:	Read in the runtime parameters.
-*			Arguments:
-*
-*			Function return: true unless an error occurs.
-*
-*********************************************************************************/
-Boolean PhoHFileGetRunTimeParams(char *paramPath, PhoHFileRunTimeParamsTy *customParams)	
-{
-	double					paramBuffer[LBPF_PARAM_LEN];
-	Boolean					okay = false;					/* Process flag */
-	Boolean					isEOF;							/* End of file flag */
-	Boolean					switchOkay;						/* Switch flag */
-	LbPfEnPfTy				paramType;
-	LbUsFourByte			paramSize;
-	char					paramLabel[LBPF_LABEL_LEN];
-	PhoHFileEn_RunTimeParamsTy	whichParam;
-	LbPfHkTy				paramFileHk;
-	
-	do { /* Process Loop */
+		if (hdrHkTyPtr->customParams.doTravDistRange == true) {
+			if ((photon->travel_distance < hdrHkTyPtr->customParams.travelDistanceMin) ||
+					(photon->travel_distance > hdrHkTyPtr->customParams.travelDistanceMax)) {
 
+				goto FILTERED_OUT;
 
-		
-		/* Attempt to open parameter file */
-		if (!LbPfOpen(paramPath, 0, &paramFileHk)) {
-			break;
+			}
 		}
-		
-		/* Set default boolean values */
-		customParams->doXposition = false;
-		customParams->doXrange = false;
-		customParams->doYposition = false;
-		customParams->doYrange = false;
-		customParams->doZposition = false;
-		customParams->doZrange = false;
-		customParams->doXcosine = false;
-		customParams->doXCosRange = false;
-		customParams->doYcosine = false;
-		customParams->doYCosRange = false;
-		customParams->doZcosine = false;
-		customParams->doZCosRange = false;
-		customParams->doScattersInObject = false;
-		customParams->doObjScatRange = false;
-		customParams->doScattersInCollimator = false;
-		customParams->doColScatRange = false;
-		customParams->doDecayWeight = false;
-		customParams->doEnergy = false;
-		customParams->doEnergyRange = false;
-		customParams->doTravelDistance = false;
-		customParams->doTravDistRange = false;
-		customParams->doDecayXposition = false;
-		customParams->doDecayXrange = false;
-		customParams->doDecayYposition = false;
-		customParams->doDecayYrange = false;
-		customParams->doDecayZposition = false;
-		customParams->doDecayZrange = false;
-		customParams->doDecayTime = false;
-		customParams->doDecayType = false;
-		customParams->doTransaxialDistance = false;
-		customParams->doTransDistRange = false;
-		customParams->doAzimuthalAngleIndex = false;
-		customParams->doAziAngRange = false;
-		customParams->doAxialPosition = false;
-		customParams->doAxiPosRange = false;
-		customParams->doDetectorXposition = false;
-		customParams->doDetectorXposRange = false;
-		customParams->doDetectorYposition = false;
-		customParams->doDetectorYposRange = false;
-		customParams->doDetectorZposition = false;
-		customParams->doDetectorZposRange = false;
-		customParams->doNumDetectorInteractions = false;
-		customParams->doNumDetInteractionsRange = false;
-		customParams->doDetInteractionPos = false;
-		customParams->doDetectorAngle = false;
-		customParams->doDetectorAngleRange = false;
-		customParams->doDetectorCrystal = false;
-		
-		customParams->xPosMin = LBDOUBLE_MAX;
-		customParams->xPosMax = LBDOUBLE_MIN;
-		customParams->yPosMin = LBDOUBLE_MAX;
-		customParams->yPosMax = LBDOUBLE_MIN;
-		customParams->zPosMin = LBDOUBLE_MAX;
-		customParams->zPosMax = LBDOUBLE_MIN;
-		customParams->xCosMin = LBDOUBLE_MAX;
-		customParams->xCosMax = LBDOUBLE_MIN;
-		customParams->yCosMin = LBDOUBLE_MAX;
-		customParams->yCosMax = LBDOUBLE_MIN;
-		customParams->zCosMin = LBDOUBLE_MAX;
-		customParams->zCosMax = LBDOUBLE_MIN;
-		customParams->objScattersMin = LBFOURBYTE_MAX;
-		customParams->objScattersMax = LBFOURBYTE_MIN;
-		customParams->colScattersMin = LBFOURBYTE_MAX;
-		customParams->colScattersMax  = LBFOURBYTE_MIN;
-		customParams->energyMin = LBDOUBLE_MAX;
-		customParams->energyMax = LBDOUBLE_MIN;
-		customParams->travelDistanceMin = LBDOUBLE_MAX;
-		customParams->travelDistanceMax = LBDOUBLE_MIN;
-		customParams->decayXPosMin = LBDOUBLE_MAX;
-		customParams->decayXPosMax = LBDOUBLE_MIN;
-		customParams->decayYPosMin = LBDOUBLE_MAX;
-		customParams->decayYPosMax = LBDOUBLE_MIN;
-		customParams->decayZPosMin = LBDOUBLE_MAX;
-		customParams->decayZPosMax = LBDOUBLE_MIN;
-		customParams->transaxialDistanceMin = LBDOUBLE_MAX;
-		customParams->transaxialDistanceMax = LBDOUBLE_MIN;
-		customParams->aaIndexMin = LBFOURBYTE_MAX;
-		customParams->aaIndexMax = LBFOURBYTE_MIN;
-		customParams->axialPositionMin = LBDOUBLE_MAX;
-		customParams->axialPositionMax = LBDOUBLE_MIN;
-		customParams->detectorXpositionMin = LBDOUBLE_MAX;
-		customParams->detectorXpositionMax = LBDOUBLE_MIN;
-		customParams->detectorYpositionMin = LBDOUBLE_MAX;
-		customParams->detectorYpositionMax = LBDOUBLE_MIN;
-		customParams->detectorZpositionMin = LBDOUBLE_MAX;
-		customParams->detectorZpositionMax = LBDOUBLE_MIN;
-		customParams->detectorAngleMin = LBDOUBLE_MAX;
-		customParams->detectorAngleMax = LBDOUBLE_MIN;
-		customParams->numDetInteractionsMin = LBFOURBYTE_MAX;
-		customParams->numDetInteractionsMax = LBFOURBYTE_MIN;
-		customParams->detectorAngleMin = LBDOUBLE_MAX;
-		customParams->detectorAngleMax = LBDOUBLE_MIN;
-			
-		/* Loop through the parameters */
-		while(LbPfGetParam(&paramFileHk, (void *)paramBuffer,
-				&paramType, &paramSize, paramLabel, &isEOF)) {
-				
-				/* Find the runtime parameter */
-				whichParam = PhoHFileLookupRunTimeParamLabel(paramLabel);
-				
-				
-				switchOkay = true;
-				switch (whichParam) {
 
-					case PhoHFileEn_x_position:
-						customParams->doXposition =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doDecayXrange == true) {
+			if ((decay->location.x_position < hdrHkTyPtr->customParams.decayXPosMin) ||
+					(decay->location.x_position > hdrHkTyPtr->customParams.decayXPosMax)) {
 
-					case PhoHFileEn_x_pos_min:
-						customParams->xPosMin =
-							*((double *) paramBuffer);
-						customParams->doXrange = true;
-						break;
+				goto FILTERED_OUT;
 
-					case PhoHFileEn_x_pos_max:
-						customParams->xPosMax =
-							*((double *) paramBuffer);
-						break;
+			}
+		}
 
-					case PhoHFileEn_y_position:
-						customParams->doYposition =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doDecayYrange == true) {
+			if ((decay->location.y_position < hdrHkTyPtr->customParams.decayYPosMin) ||
+					(decay->location.y_position > hdrHkTyPtr->customParams.decayYPosMax)) {
 
-					case PhoHFileEn_y_pos_min:
-						customParams->yPosMin =
-							*((double *) paramBuffer);
-						customParams->doYrange = true;
-						break;
+				goto FILTERED_OUT;
 
-					case PhoHFileEn_y_pos_max:
-						customParams->yPosMax =
-							*((double *) paramBuffer);
-						break;
+			}
+		}
 
-					case PhoHFileEn_z_position:
-						customParams->doZposition =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doDecayZrange == true) {
+			if ((decay->location.z_position < hdrHkTyPtr->customParams.decayZPosMin) ||
+					(decay->location.z_position > hdrHkTyPtr->customParams.decayZPosMax)) {
 
-					case PhoHFileEn_z_pos_min:
-						customParams->zPosMin =
-							*((double *) paramBuffer);
-						customParams->doZrange = true;
-						break;
+				goto FILTERED_OUT;
 
-					case PhoHFileEn_z_pos_max:
-						customParams->zPosMax =
-							*((double *) paramBuffer);
-						break;
+			}
+		}
 
-					case PhoHFileEn_x_cosine:
-						customParams->doXcosine =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doTransDistRange == true) {
+			if ((photon->transaxialPosition < hdrHkTyPtr->customParams.transaxialDistanceMin) ||
+					(photon->transaxialPosition > hdrHkTyPtr->customParams.transaxialDistanceMax)) {
 
-					case PhoHFileEn_x_cos_min:
-						customParams->xCosMin =
-							*((double *) paramBuffer);
-						customParams->doXCosRange = true;
-						break;
+				goto FILTERED_OUT;
 
-					case PhoHFileEn_x_cos_max:
-						customParams->xCosMax =
-							*((double *) paramBuffer);
-						break;
+			}
+		}
 
-					case PhoHFileEn_y_cosine:
-						customParams->doYcosine =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doAziAngRange == true) {
+			if ((photon->azimuthalAngleIndex < hdrHkTyPtr->customParams.aaIndexMin) ||
+					(photon->azimuthalAngleIndex > hdrHkTyPtr->customParams.aaIndexMax)) {
 
-					case PhoHFileEn_y_cos_min:
-						customParams->yCosMin =
-							*((double *) paramBuffer);
-						customParams->doYCosRange = true;
-						break;
+				goto FILTERED_OUT;
 
-					case PhoHFileEn_y_cos_max:
-						customParams->yCosMax =
-							*((double *) paramBuffer);
-						break;
+			}
+		}
 
-					case PhoHFileEn_z_cosine:
-						customParams->doZcosine =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doAxiPosRange == true) {
+			if ((photon->axialPosition < hdrHkTyPtr->customParams.axialPositionMin) ||
+					(photon->axialPosition > hdrHkTyPtr->customParams.axialPositionMax)) {
 
-					case PhoHFileEn_z_cos_min:
-						customParams->zCosMin =
-							*((double *) paramBuffer);
-						customParams->doZCosRange = true;
-						break;
+				goto FILTERED_OUT;
 
-					case PhoHFileEn_z_cos_max:
-						customParams->zCosMax =
-							*((double *) paramBuffer);
-						break;
+			}
+		}
 
-					case PhoHFileEn_scatters_in_object:
-						customParams->doScattersInObject =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doDetectorXposRange == true) {
+			if ((photon->detLocation.x_position < hdrHkTyPtr->customParams.detectorXpositionMin) ||
+					(photon->detLocation.x_position > hdrHkTyPtr->customParams.detectorXpositionMax)) {
 
-					case PhoHFileEn_obj_scatters_min:
-						customParams->objScattersMin =
-							*((LbUsFourByte *) paramBuffer);
-						customParams->doObjScatRange = true;
-						break;
+				goto FILTERED_OUT;
 
-					case PhoHFileEn_obj_scatters_max:
-						customParams->objScattersMax =
-							*((LbUsFourByte *) paramBuffer);
-						break;
+			}
+		}
 
-					case PhoHFileEn_scatters_in_collimator:
-						customParams->doScattersInCollimator =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doDetectorYposRange == true) {
+			if ((photon->detLocation.y_position < hdrHkTyPtr->customParams.detectorYpositionMin) ||
+					(photon->detLocation.y_position > hdrHkTyPtr->customParams.detectorYpositionMax)) {
 
-					case PhoHFileEn_col_scatters_min:
-						customParams->colScattersMin =
-							*((LbUsFourByte *) paramBuffer);
-						customParams->doColScatRange = true;
-						break;
+				goto FILTERED_OUT;
 
-					case PhoHFileEn_col_scatters_max:
-						customParams->colScattersMax =
-							*((LbUsFourByte *) paramBuffer);
-						break;
+			}
+		}
 
-					case PhoHFileEn_decay_weight:
-						customParams->doDecayWeight =
-							*((Boolean *) paramBuffer);
+		if (hdrHkTyPtr->customParams.doDetectorZposRange == true) {
+			if ((photon->detLocation.z_position < hdrHkTyPtr->customParams.detectorZpositionMin) ||
+					(photon->detLocation.z_position > hdrHkTyPtr->customParams.detectorZpositionMax)) {
 
-					case PhoHFileEn_weight:
-						customParams->doWeight =
-							*((Boolean *) paramBuffer);
-						break;
-						
-					case PhoHFileEn_energy:
-						customParams->doEnergy =
-							*((Boolean *) paramBuffer);
-						break;
+				goto FILTERED_OUT;
 
-					case PhoHFileEn_energy_min:
-						customParams->energyMin =
-							*((double *) paramBuffer);
-						customParams->doEnergyRange = true;
-						break;
+			}
+		}
 
-					case PhoHFileEn_energy_max:
-						customParams->energyMax =
-							*((double *) paramBuffer);
-						break;
-						
-					case PhoHFileEn_travel_distance:
-						customParams->doTravelDistance =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doDetectorAngleRange == true) {
+			if ((photon->detectorAngle < hdrHkTyPtr->customParams.detectorAngleMin) ||
+					(photon->detectorAngle > hdrHkTyPtr->customParams.detectorAngleMax)) {
 
-					case PhoHFileEn_travel_distance_min:
-						customParams->travelDistanceMin =
-							*((double *) paramBuffer);
-						customParams->doTravDistRange = true;
-						break;
+				goto FILTERED_OUT;
 
-					case PhoHFileEn_travel_distance_max:
-						customParams->travelDistanceMax =
-							*((double *) paramBuffer);
-						break;
-						
-					case PhoHFileEn_decay_x_position:
-						customParams->doDecayXposition =
-							*((Boolean *) paramBuffer);
-						break;
+			}
+		}
 
-					case PhoHFileEn_decay_x_pos_min:
-						customParams->decayXPosMin =
-							*((double *) paramBuffer);
-						customParams->doDecayXrange = true;
-						break;
+		/* Now do the actual writing of fields */
 
-					case PhoHFileEn_decay_x_pos_max:
-						customParams->decayXPosMax =
-							*((double *) paramBuffer);
-						break;
-						
-					case PhoHFileEn_decay_y_position:
-						customParams->doDecayYposition =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doXposition == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->location.x_position, sizeof(double)) == false) {
 
-					case PhoHFileEn_decay_y_pos_min:
-						customParams->decayYPosMin =
-							*((double *) paramBuffer);
-						customParams->doDecayYrange = true;
-						break;
+					ErStGeneric("Unable to write 'x_position' to history file.");
+					goto FAILURE;
+				}
+		}
 
-					case PhoHFileEn_decay_y_pos_max:
-						customParams->decayYPosMax =
-							*((double *) paramBuffer);
-						break;
-						
-					case PhoHFileEn_decay_z_position:
-						customParams->doDecayZposition =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doYposition == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->location.y_position, sizeof(double)) == false) {
 
-					case PhoHFileEn_decay_z_pos_min:
-						customParams->decayZPosMin =
-							*((double *) paramBuffer);
-						customParams->doDecayZrange = true;
-						break;
+					ErStGeneric("Unable to write 'y_position' to history file.");
+					goto FAILURE;
+				}
+		}
 
-					case PhoHFileEn_decay_z_pos_max:
-						customParams->decayZPosMax =
-							*((double *) paramBuffer);
-						break;
-						
-					case PhoHFileEn_decay_time:
-						customParams->doDecayTime =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doZposition == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->location.z_position, sizeof(double)) == false) {
 
-					case PhoHFileEn_decay_type:
-						customParams->doDecayType =
-							*((Boolean *) paramBuffer);
-						break;
+					ErStGeneric("Unable to write 'z_position' to history file.");
+					goto FAILURE;
+				}
+		}
 
-					case PhoHFileEn_transaxial_distance:
-						customParams->doTransaxialDistance =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doXcosine == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->angle.cosine_x, sizeof(double)) == false) {
 
-					case PhoHFileEn_transaxial_distance_min:
-						customParams->transaxialDistanceMin =
-							*((double *) paramBuffer);
-						customParams->doTransDistRange = true;
-						break;
+					ErStGeneric("Unable to write 'cosine_x' to history file.");
+					goto FAILURE;
+				}
+		}
 
-					case PhoHFileEn_transaxial_distance_max:
-						customParams->transaxialDistanceMax =
-							*((double *) paramBuffer);
-						break;
-						
-					case PhoHFileEn_azimuthal_angle_index:
-						customParams->doAzimuthalAngleIndex =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doYcosine == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->angle.cosine_y, sizeof(double)) == false) {
 
-					case PhoHFileEn_aa_index_min:
-						customParams->aaIndexMin =
-							*((LbUsFourByte *) paramBuffer);
-						customParams->doAziAngRange = true;
-						break;
+					ErStGeneric("Unable to write 'cosine_y' to history file.");
+					goto FAILURE;
+				}
+		}
 
-					case PhoHFileEn_aa_index_max:
-						customParams->aaIndexMax =
-							*((LbUsFourByte *) paramBuffer);
-						break;
-						
-					case PhoHFileEn_axial_position:
-						customParams->doAxialPosition =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doZcosine == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->angle.cosine_z, sizeof(double)) == false) {
 
-					case PhoHFileEn_axial_position_min:
-						customParams->axialPositionMin =
-							*((double *) paramBuffer);
-						customParams->doAxiPosRange = true;
-						break;
+					ErStGeneric("Unable to write 'cosine_z' to history file.");
+					goto FAILURE;
+				}
+		}
 
-					case PhoHFileEn_axial_position_max:
-						customParams->axialPositionMax =
-							*((double *) paramBuffer);
-						break;
-						
-					case 	PhoHFileEn_detector_x_position:
-						customParams->doDetectorXposition =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doScattersInObject == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->num_of_scatters, sizeof(LbUsFourByte)) == false) {
 
-					case PhoHFileEn_detector_x_position_min:
-						customParams->detectorXpositionMin =
-							*((double *) paramBuffer);
-						customParams->doDetectorXposRange = true;
-						break;
+					ErStGeneric("Unable to write 'scatters in object' to history file.");
+					goto FAILURE;
+				}
+		}
 
-					case PhoHFileEn_detector_x_position_max:
-						customParams->detectorXpositionMax =
-							*((double *) paramBuffer);
-						break;
-						
-					case 	PhoHFileEn_detector_y_position:
-						customParams->doDetectorYposition =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doScattersInCollimator == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->scatters_in_col, sizeof(LbUsFourByte)) == false) {
 
-					case PhoHFileEn_detector_y_position_min:
-						customParams->detectorYpositionMin =
-							*((double *) paramBuffer);
-						customParams->doDetectorYposRange = true;
-						break;
+					ErStGeneric("Unable to write 'scatters in collimator' to history file.");
+					goto FAILURE;
+				}
+		}
 
-					case PhoHFileEn_detector_y_position_max:
-						customParams->detectorYpositionMax =
-							*((double *) paramBuffer);
-						break;
-						
-					case 	PhoHFileEn_detector_z_position:
-						customParams->doDetectorZposition =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doDecayWeight == true) {
+			if (phoHFileBufferWrite(hdrHkTyPtr, &decay->startWeight, sizeof(double)) == false) {
 
-					case PhoHFileEn_detector_z_position_min:
-						customParams->detectorZpositionMin =
-							*((double *) paramBuffer);
-						customParams->doDetectorZposRange = true;
-						break;
+				ErStGeneric("Unable to write 'decay weight' to history file.");
+				goto FAILURE;
+			}
+		}
 
-					case PhoHFileEn_detector_z_position_max:
-						customParams->detectorZpositionMax =
-							*((double *) paramBuffer);
-						break;
-						
-					case 	PhoHFileEn_num_detector_interactions:
-						customParams->doNumDetectorInteractions =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doWeight == true) {
+			if (phoHFileBufferWrite(hdrHkTyPtr, &photon->photon_current_weight, sizeof(double)) == false) {
 
-					case PhoHFileEn_num_detector_interactions_min:
-						customParams->numDetInteractionsMin =
-							*((LbFourByte *) paramBuffer);
-						break;
+				ErStGeneric("Unable to write 'photon weight' to history file.");
+				goto FAILURE;
+			}
+		}
 
-					case PhoHFileEn_num_detector_interactions_max:
-						customParams->numDetInteractionsMax =
-							*((LbFourByte *) paramBuffer);
-						customParams->doNumDetInteractionsRange = true;
-						break;
-						
-					case 	PhoHFileEn_det_interaction_positions:
-						customParams->doDetInteractionPos =
-							*((Boolean *) paramBuffer);
-						break;
-						
-					case 	PhoHFileEn_detector_angle:
-						customParams->doDetectorAngle =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doEnergy == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->energy, sizeof(double)) == false) {
 
-					case PhoHFileEn_detector_angle_min:
-						customParams->detectorAngleMin =
-							*((double *) paramBuffer);
-						customParams->doDetectorAngleRange = true;
-						break;
+					ErStGeneric("Unable to write 'energy' to history file.");
+					goto FAILURE;
+				}
+		}
 
-					case PhoHFileEn_detector_angle_max:
-						customParams->detectorAngleMax =
-							*((double *) paramBuffer);
-						break;
-						
-					case 	PhoHFileEn_detector_crystal:
-						customParams->doDetectorCrystal =
-							*((Boolean *) paramBuffer);
-						break;
+		if (hdrHkTyPtr->customParams.doTravelDistance == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->travel_distance, sizeof(double)) == false) {
 
-					default:
-						sprintf(phoHFileErrString, "(PhoHFileGetRunTimeParams) Unknown (hence unused) parameter (%s).\n",
-                            paramLabel);
-						ErAlert(phoHFileErrString, false);
-						break;
+					ErStGeneric("Unable to write 'travel distance' to history file.");
+					goto FAILURE;
+				}
+		}
+
+		if (hdrHkTyPtr->customParams.doDecayXposition == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &decay->location.x_position, sizeof(double)) == false) {
+
+					ErStGeneric("Unable to write 'decay x position' to history file.");
+					goto FAILURE;
+				}
+		}
+
+		if (hdrHkTyPtr->customParams.doDecayYposition == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &decay->location.y_position, sizeof(double)) == false) {
+
+					ErStGeneric("Unable to write 'decay y position' to history file.");
+					goto FAILURE;
+				}
+		}
+
+		if (hdrHkTyPtr->customParams.doDecayZposition == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &decay->location.z_position, sizeof(double)) == false) {
+
+					ErStGeneric("Unable to write 'decay z position' to history file.");
+					goto FAILURE;
+				}
+		}
+
+		if (hdrHkTyPtr->customParams.doDecayTime == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &decay->decayTime, sizeof(double)) == false) {
+
+					ErStGeneric("Unable to write 'decay time' to history file.");
+					goto FAILURE;
+				}
+		}
+
+		if (hdrHkTyPtr->customParams.doDecayType == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &decay->decayType, sizeof(LbUsOneByte)) == false) {
+
+					ErStGeneric("Unable to write 'decay type' to history file.");
+					goto FAILURE;
+				}
+		}
+
+		if (hdrHkTyPtr->customParams.doTransaxialDistance == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->transaxialPosition, sizeof(double)) == false) {
+
+					ErStGeneric("Unable to write 'transaxial position' to history file.");
+					goto FAILURE;
+				}
+		}
+
+		if (hdrHkTyPtr->customParams.doAzimuthalAngleIndex == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->azimuthalAngleIndex, sizeof(LbUsFourByte)) == false) {
+
+					ErStGeneric("Unable to write 'azimuthal angle index' to history file.");
+					goto FAILURE;
+				}
+		}
+
+		if (hdrHkTyPtr->customParams.doAxialPosition == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->axialPosition, sizeof(double)) == false) {
+
+					ErStGeneric("Unable to write 'axial position' to history file.");
+					goto FAILURE;
+				}
+		}
+
+		if (hdrHkTyPtr->customParams.doDetectorXposition == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->detLocation.x_position, sizeof(double)) == false) {
+
+					ErStGeneric("Unable to write 'detector X-axis position' to history file.");
+					goto FAILURE;
+				}
+		}
+
+		if (hdrHkTyPtr->customParams.doDetectorYposition == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->detLocation.y_position, sizeof(double)) == false) {
+
+					ErStGeneric("Unable to write 'detector Y-axis position' to history file.");
+					goto FAILURE;
+				}
+		}
+
+		if (hdrHkTyPtr->customParams.doDetectorZposition == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->detLocation.z_position, sizeof(double)) == false) {
+
+					ErStGeneric("Unable to write 'detector Z-axis position' to history file.");
+					goto FAILURE;
+				}
+		}
+
+		if (hdrHkTyPtr->customParams.doDetectorAngle == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->detectorAngle, sizeof(double)) == false) {
+
+					ErStGeneric("Unable to write 'detector angle' to history file.");
+					goto FAILURE;
+				}
+		}
+
+		if (hdrHkTyPtr->customParams.doDetectorCrystal == true) {
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->detCrystal, sizeof(LbFourByte)) == false) {
+
+					ErStGeneric("Unable to write 'detector crystal' to history file.");
+					goto FAILURE;
+				}
+		}
+
+		if (hdrHkTyPtr->customParams.doNumDetectorInteractions == true) {
+			if (phoHFileBufferWrite(hdrHkTyPtr, &photon->num_det_interactions, sizeof(LbUsFourByte)) == false) {
+
+				ErStGeneric("Unable to write 'number of detector interactions' to history file.");
+				goto FAILURE;
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doDetInteractionPos == true) {
+			
+			if (phoHFileBufferWrite(hdrHkTyPtr, &photon->num_det_interactions, sizeof(LbUsFourByte)) == false) {
+
+				ErStGeneric("Unable to write 'number of detector interactions' to history file for list of interaction positions.");
+				goto FAILURE;
+			}
+			for (i = 0; i < photon->num_det_interactions; i++) {
+
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->det_interactions[i].pos.x_position, sizeof(double)) == false) {
+
+					ErStGeneric("Unable to write 'x-position of interaction' to history file for list of interaction positions.");
+					goto FAILURE;
+				}
+
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->det_interactions[i].pos.y_position, sizeof(double)) == false) {
+
+					ErStGeneric("Unable to write 'y-position of interaction' to history file for list of interaction positions.");
+					goto FAILURE;
+				}
+
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->det_interactions[i].pos.z_position, sizeof(double)) == false) {
+
+					ErStGeneric("Unable to write 'z-position of interaction' to history file for list of interaction positions.");
+					goto FAILURE;
+				}
+
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->det_interactions[i].energy_deposited, sizeof(double)) == false) {
+
+					ErStGeneric("Unable to write 'energy of interaction' to history file for list of interaction positions.");
+					goto FAILURE;
+				}
+				size = sizeof(Boolean);
+				
+				if (phoHFileBufferWrite(hdrHkTyPtr, &photon->det_interactions[i].isActive, size) == false) {
+
+					ErStGeneric("Unable to write 'is-Active of interaction' to history file for list of interaction positions.");
+					goto FAILURE;
+				}
+			}
+		}
+		
+		(*numAccepted)++;
+		
+		FILTERED_OUT:;
+		okay = true;
+		FAILURE:;
+	} while (false);
+	
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:			PhoHFileReadFields
+*
+*			Summary:		Read photon fields from a custom history file.
+*
+*			Arguments:
+*				PhoHFileHkTy 		*hdrHkTyPtr		- The history hook.
+*				PHG_Decay			*decay			- The decay that started the process.
+*				PHG_TrackingPhoton 	*photon			- The blue photons detected.
+*				Boolean				*photonAccepted	- Flag indicating the photon was accepted.
+*			Function return: None.
+*
+*********************************************************************************/
+Boolean PhoHFileReadFields(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay,
+			PHG_TrackingPhoton *photon, Boolean *photonAccepted)
+{
+	Boolean			okay = false;
+	LbUsFourByte	i;
+	
+	do { /* Process Loop */
+
+
+		/* Clear the acceptance flag */
+		*photonAccepted = false;
+		
+		/* Read the fields */
+
+		if (hdrHkTyPtr->customParams.doXposition == true) {
+
+			if (fread(&photon->location.x_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+				ErStGeneric("Unable to read 'x_position' from history file.");
+				goto FAILURE;
+			}
+			
+			/* Check range */
+			if (hdrHkTyPtr->customParams.doXrange == true) {
+				if ((photon->location.x_position < hdrHkTyPtr->customParams.xPosMin) ||
+						(photon->location.x_position > hdrHkTyPtr->customParams.xPosMax)) {
+
+					goto FILTERED_OUT;
+
+				}						
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doYposition == true) {
+				if (fread(&photon->location.y_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'y_position' from history file.");
+					goto FAILURE;
+				}
+
+			if (hdrHkTyPtr->customParams.doYrange == true) {
+				if ((photon->location.y_position < hdrHkTyPtr->customParams.yPosMin) ||
+						(photon->location.y_position > hdrHkTyPtr->customParams.yPosMax)) {
+
+					goto FILTERED_OUT;
+
+				}							
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doZposition == true) {
+				if (fread(&photon->location.z_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'z_position' from history file.");
+					goto FAILURE;
+				}
+
+			if (hdrHkTyPtr->customParams.doZrange == true) {
+				if ((photon->location.z_position < hdrHkTyPtr->customParams.zPosMin) ||
+						(photon->location.z_position > hdrHkTyPtr->customParams.zPosMax)) {
+
+					goto FILTERED_OUT;
+
+				}							
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doXcosine == true) {
+				if (fread(&photon->angle.cosine_x, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'cosine_x' from history file.");
+					goto FAILURE;
+				}
+
+			if (hdrHkTyPtr->customParams.doXCosRange == true) {
+				if ((photon->angle.cosine_x < hdrHkTyPtr->customParams.xCosMin) ||
+						(photon->angle.cosine_x > hdrHkTyPtr->customParams.xCosMax)) {
+
+					goto FILTERED_OUT;
+
+				}						
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doYcosine == true) {
+				if (fread(&photon->angle.cosine_y, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'cosine_y' from history file.");
+					goto FAILURE;
+				}
+
+			if (hdrHkTyPtr->customParams.doYCosRange == true) {
+				if ((photon->angle.cosine_y < hdrHkTyPtr->customParams.yCosMin) ||
+						(photon->angle.cosine_y> hdrHkTyPtr->customParams.yCosMax)) {
+
+					goto FILTERED_OUT;
+
+				}							
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doZcosine == true) {
+				if (fread(&photon->angle.cosine_z, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'cosine_z' from history file.");
+					goto FAILURE;
+				}
+
+			if (hdrHkTyPtr->customParams.doZCosRange == true) {
+				if ((photon->angle.cosine_z < hdrHkTyPtr->customParams.zCosMin) ||
+						(photon->angle.cosine_z > hdrHkTyPtr->customParams.zCosMax)) {
+
+					goto FILTERED_OUT;
+
+				}							
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doScattersInObject == true) {
+				if (fread(&photon->num_of_scatters, sizeof(LbUsFourByte), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'scatters in object' from history file.");
+					goto FAILURE;
+				}
+
+			if (hdrHkTyPtr->customParams.doObjScatRange == true) {
+				if (((LbFourByte)photon->num_of_scatters < hdrHkTyPtr->customParams.objScattersMin) ||
+						((LbFourByte)photon->num_of_scatters > hdrHkTyPtr->customParams.objScattersMax)) {
+
+					goto FILTERED_OUT;
+
+				}						
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doScattersInCollimator == true) {
+				if (fread(&photon->scatters_in_col, sizeof(LbUsFourByte), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'scatters in collimator' from history file.");
+					goto FAILURE;
+				}
+
+			if (hdrHkTyPtr->customParams.doColScatRange == true) {
+				if (((LbFourByte)photon->scatters_in_col < hdrHkTyPtr->customParams.colScattersMin) ||
+						((LbFourByte)photon->scatters_in_col > hdrHkTyPtr->customParams.colScattersMax)) {
+
+					goto FILTERED_OUT;
+
+				}						
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doDecayWeight == true) {
+			if (fread(&decay->startWeight, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+				ErStGeneric("Unable to read 'decay weight' from history file.");
+				goto FAILURE;
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doWeight == true) {
+			/* read in the current weight field */
+			if (fread(&photon->photon_current_weight, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+				ErStGeneric("Unable to read 'photon weight' from history file.");
+				goto FAILURE;
+			}
+			/* copy to the scatter or primary weight field */
+			if ((photon->num_of_scatters > 0)) {
+				photon->photon_scatter_weight = photon->photon_current_weight;
+			}
+			else {
+				photon->photon_primary_weight = photon->photon_current_weight;
+			}						
+		}
+
+		if (hdrHkTyPtr->customParams.doEnergy == true) {
+				if (fread(&photon->energy, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'energy' from history file.");
+					goto FAILURE;
+				}
+
+			if (hdrHkTyPtr->customParams.doEnergyRange == true) {
+				if ((photon->energy < hdrHkTyPtr->customParams.energyMin) &&
+						(photon->energy > hdrHkTyPtr->customParams.energyMax)) {
+
+					goto FILTERED_OUT;
+
+				}						
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doTravelDistance == true) {
+				if (fread(&photon->travel_distance, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'travel distance' from history file.");
+					goto FAILURE;
+				}
+
+			if (hdrHkTyPtr->customParams.doTravDistRange == true) {
+				if ((photon->travel_distance < hdrHkTyPtr->customParams.travelDistanceMin) ||
+						(photon->travel_distance > hdrHkTyPtr->customParams.travelDistanceMax)) {
+
+					goto FILTERED_OUT;
+
+				}
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doDecayXposition == true) {
+				if (fread(&decay->location.x_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'decay x position' from history file.");
+					goto FAILURE;
+				}
+
+			if (hdrHkTyPtr->customParams.doDecayXrange == true) {
+				if ((decay->location.x_position < hdrHkTyPtr->customParams.decayXPosMin) ||
+						(decay->location.x_position > hdrHkTyPtr->customParams.decayXPosMax)) {
+
+					goto FILTERED_OUT;
+
+				}
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doDecayYposition == true) {
+				if (fread(&decay->location.y_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'decay y position' from history file.");
+					goto FAILURE;
+				}
+
+			if (hdrHkTyPtr->customParams.doDecayYrange == true) {
+				if ((decay->location.y_position < hdrHkTyPtr->customParams.decayYPosMin) ||
+						(decay->location.y_position > hdrHkTyPtr->customParams.decayYPosMax)) {
+
+					goto FILTERED_OUT;
+
+				}
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doDecayZposition == true) {
+				if (fread(&decay->location.z_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'decay z position' from history file.");
+					goto FAILURE;
+				}
+
+			if (hdrHkTyPtr->customParams.doDecayZrange == true) {
+				if ((decay->location.z_position < hdrHkTyPtr->customParams.decayZPosMin) ||
+						(decay->location.z_position > hdrHkTyPtr->customParams.decayZPosMax)) {
+
+					goto FILTERED_OUT;
+
+				}
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doDecayTime == true) {
+			/* read in the current weight field */
+			if (fread(&decay->decayTime, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+				ErStGeneric("Unable to read 'decay time' from history file.");
+				goto FAILURE;
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doDecayType == true) {
+			/* read in the current weight field */
+			if (fread(&decay->decayType, sizeof(LbUsOneByte), 1, hdrHkTyPtr->histFile) != 1) {
+
+				ErStGeneric("Unable to read 'decay type' from history file.");
+				goto FAILURE;
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doTransaxialDistance == true) {
+				if (fread(&photon->transaxialPosition, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'transaxial position' from history file.");
+					goto FAILURE;
+				}
+
+			if (hdrHkTyPtr->customParams.doTransDistRange == true) {
+				if ((photon->transaxialPosition < hdrHkTyPtr->customParams.transaxialDistanceMin) ||
+						(photon->transaxialPosition > hdrHkTyPtr->customParams.transaxialDistanceMax)) {
+
+					goto FILTERED_OUT;
+
+				}
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doAzimuthalAngleIndex == true) {
+				if (fread(&photon->azimuthalAngleIndex, sizeof(LbUsFourByte), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'azimuthal angle index' from history file.");
+					goto FAILURE;
+				}
+
+			if (hdrHkTyPtr->customParams.doAziAngRange == true) {
+				if ((photon->azimuthalAngleIndex < hdrHkTyPtr->customParams.aaIndexMin) ||
+						(photon->azimuthalAngleIndex > hdrHkTyPtr->customParams.aaIndexMax)) {
+
+					goto FILTERED_OUT;
+
+				}
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doAxialPosition == true) {
+
+			if (fread(&photon->axialPosition, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+				ErStGeneric("Unable to read 'axial position' from history file.");
+				goto FAILURE;
+			}
+
+			if (hdrHkTyPtr->customParams.doAxiPosRange == true) {
+				if ((photon->axialPosition < hdrHkTyPtr->customParams.axialPositionMin) ||
+						(photon->axialPosition > hdrHkTyPtr->customParams.axialPositionMax)) {
+
+					goto FILTERED_OUT;
+
+				}
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doDetectorXposition == true) {
+			if (fread(&photon->detLocation.x_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+				ErStGeneric("Unable to read 'detector X-axis position' from history file.");
+				goto FAILURE;
+			}
+
+			if (hdrHkTyPtr->customParams.doDetectorXposRange == true) {
+				if ((photon->detLocation.x_position < hdrHkTyPtr->customParams.detectorXpositionMin) ||
+						(photon->detLocation.x_position > hdrHkTyPtr->customParams.detectorXpositionMax)) {
+
+					goto FILTERED_OUT;
+
+				}
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doDetectorYposition == true) {
+			if (fread(&photon->detLocation.y_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+				ErStGeneric("Unable to read 'detector Y-axis position' from history file.");
+				goto FAILURE;
+			}
+
+			if (hdrHkTyPtr->customParams.doDetectorYposRange == true) {
+				if ((photon->detLocation.y_position < hdrHkTyPtr->customParams.detectorYpositionMin) ||
+						(photon->detLocation.y_position > hdrHkTyPtr->customParams.detectorYpositionMax)) {
+
+					goto FILTERED_OUT;
+
+				}
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doDetectorZposition == true) {
+				if (fread(&photon->detLocation.z_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'detector Z-axis position' from history file.");
+					goto FAILURE;
+				}
+
+			if (hdrHkTyPtr->customParams.doDetectorZposRange == true) {
+				if ((photon->detLocation.z_position < hdrHkTyPtr->customParams.detectorZpositionMin) ||
+						(photon->detLocation.z_position > hdrHkTyPtr->customParams.detectorZpositionMax)) {
+
+					goto FILTERED_OUT;
+
+				}
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doDetectorAngle == true) {
+				if (fread(&photon->detectorAngle, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'detector angle' from history file.");
+					goto FAILURE;
+				}
+
+			if (hdrHkTyPtr->customParams.doDetectorAngleRange == true) {
+				if ((photon->detectorAngle < hdrHkTyPtr->customParams.detectorAngleMin) ||
+						(photon->detectorAngle > hdrHkTyPtr->customParams.detectorAngleMax)) {
+
+					goto FILTERED_OUT;
+
+				}
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doDetectorCrystal == true) {
+				if (fread(&photon->detCrystal, sizeof(LbFourByte), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'detector crystal' from history file.");
+					goto FAILURE;
+				}
+
+		}
+
+		if (hdrHkTyPtr->customParams.doNumDetectorInteractions == true) {
+			if (fread(&photon->num_det_interactions, sizeof(LbUsFourByte), 1, hdrHkTyPtr->histFile) != 1) {
+
+				ErStGeneric("Unable to read 'number of detector interactions' from history file.");
+				goto FAILURE;
+			}
+
+			if ((photon->detLocation.z_position < hdrHkTyPtr->customParams.detectorZpositionMin) ||
+					(photon->detLocation.z_position > hdrHkTyPtr->customParams.detectorZpositionMax)) {
+
+				goto FILTERED_OUT;
+
+			}
+		}
+
+		if (hdrHkTyPtr->customParams.doDetInteractionPos == true) {
+			if (fread(&photon->num_det_interactions, sizeof(LbUsFourByte), 1, hdrHkTyPtr->histFile) != 1) {
+
+				ErStGeneric("Unable to read 'number of detector interactions' from history file for list of interaction positions.");
+				goto FAILURE;
+			}
+			
+			/* The interactions are read into storage supplied by the caller */
+			if ((photon->det_interactions == NULL) && (photon->num_det_interactions > 0)) {
+				ErStGeneric("No storage supplied for the detector interactions being read from history file.");
+				goto FAILURE;
+			}
+			if (photon->num_det_interactions > (MAX_DET_INTERACTIONS+1)) {
+				ErStGeneric("Too many detector interactions in history file record.");
+				goto FAILURE;
+			}
+			for (i = 0; i < photon->num_det_interactions; i++) {
+
+				if (fread(&photon->det_interactions[i].pos.x_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'x-position of interaction' from history file for list of interaction positions.");
+					goto FAILURE;
+				}
+
+				if (fread(&photon->det_interactions[i].pos.y_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'y-position of interaction' from history file for list of interaction positions.");
+					goto FAILURE;
+				}
+
+				if (fread(&photon->det_interactions[i].pos.z_position, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'z-position of interaction' from history file for list of interaction positions.");
+					goto FAILURE;
+				}
+
+				if (fread(&photon->det_interactions[i].energy_deposited, sizeof(double), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'energy of interaction' from history file for list of interaction positions.");
+					goto FAILURE;
+				}
+
+				if (fread(&photon->det_interactions[i].isActive, sizeof(Boolean), 1, hdrHkTyPtr->histFile) != 1) {
+
+					ErStGeneric("Unable to read 'is-Active of interaction' from history file for list of interaction positions.");
+					goto FAILURE;
+				}
+			}
+		}
+		
+		
+		*photonAccepted = true;
+		FILTERED_OUT:;
+		okay = true;
+		FAILURE:;
+	} while (false);
+	
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:			PhoHFilePrintFields
+*
+*			Summary:		Print the fields of photons.
+*
+*			Arguments:
+*				PhoHFileHkTy 		*hdrHkTyPtr		- Header information 
+*				PHG_Decay			*decay			- The decay that started the process.
+*				PHG_TrackingPhoton 	*photon			- The blue photons detected.
+*			Function return: None.
+*
+*********************************************************************************/
+void PhoHFilePrintFields(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay, PHG_TrackingPhoton *photon)
+{
+	
+
+		if (hdrHkTyPtr->customParams.doXposition == true) {
+				LbInPrintf("\nx position = %3.3e", photon->location.x_position);
+		}
+
+		if (hdrHkTyPtr->customParams.doYposition == true) {
+				LbInPrintf("\ny position = %3.3e", photon->location.y_position);
+		}
+
+		if (hdrHkTyPtr->customParams.doZposition == true) {
+				LbInPrintf("\nz position = %3.3e", photon->location.z_position);
+		}
+
+		if (hdrHkTyPtr->customParams.doXcosine == true) {
+				LbInPrintf("\ncosine x = %3.3e", photon->angle.cosine_x);
+		}
+
+		if (hdrHkTyPtr->customParams.doYcosine == true) {
+				LbInPrintf("\ncosine y = %3.3e", photon->angle.cosine_y);
+		}
+
+		if (hdrHkTyPtr->customParams.doZcosine == true) {
+				LbInPrintf("\ncosine z = %3.3e", photon->angle.cosine_z);
+		}
+
+		if (hdrHkTyPtr->customParams.doScattersInObject == true) {
+				LbInPrintf("\nnumber of scatters = %d", photon->num_of_scatters);
+		}
+
+		if (hdrHkTyPtr->customParams.doScattersInCollimator == true) {
+				LbInPrintf("\nnumber of scatters in collimator = %d", photon->scatters_in_col);
+		}
+
+		if (hdrHkTyPtr->customParams.doDecayWeight == true) {
+			LbInPrintf("\ndecay weight = %3.3e", decay->startWeight);
+		}
+
+		if (hdrHkTyPtr->customParams.doWeight == true) {
+			LbInPrintf("\nphoton weight = %3.3e", photon->photon_current_weight);
+		}
+
+		if (hdrHkTyPtr->customParams.doEnergy == true) {
+				LbInPrintf("\nenergy = %3.1f", photon->energy);
+		}
+
+		if (hdrHkTyPtr->customParams.doTravelDistance == true) {
+				LbInPrintf("\ntravel distance = %3.3e", photon->travel_distance);
+		}
+
+		if (hdrHkTyPtr->customParams.doDecayXposition == true) {
+				LbInPrintf("\n decay x position = %3.3e", decay->location.x_position);
+		}
+
+		if (hdrHkTyPtr->customParams.doDecayYposition == true) {
+				LbInPrintf("\n decay y position = %3.3e", decay->location.y_position);
+		}
+
+		if (hdrHkTyPtr->customParams.doDecayZposition == true) {
+				LbInPrintf("\n decay z position = %3.3e", decay->location.z_position);
+		}
+
+		if (hdrHkTyPtr->customParams.doDecayTime == true) {
+				LbInPrintf("\n decay time = %4.4e", decay->decayTime);
+		}
+
+		if (hdrHkTyPtr->customParams.doDecayType == true) {
+			if (decay->decayType == PhgEn_SinglePhoton)
+				LbInPrintf("\n decay type = single photon");
+			else if (decay->decayType == PhgEn_Positron)
+				LbInPrintf("\n decay type = positron");
+			else if (decay->decayType == PhgEn_PETRandom)
+				LbInPrintf("\n decay type = random");
+			else if (decay->decayType == PhgEn_Complex)
+				LbInPrintf("\n decay type = complex");
+			else 
+				LbInPrintf("\n WARNING: decay type UNKNOWN.");
+		}
+
+		if (hdrHkTyPtr->customParams.doTransaxialDistance == true) {
+				LbInPrintf("\ntransaxial distance = %3.3e", photon->transaxialPosition);
+		}
+
+		if (hdrHkTyPtr->customParams.doAzimuthalAngleIndex == true) {
+				LbInPrintf("\nazimuthal angle = %d", photon->azimuthalAngleIndex);
+		}
+
+		if (hdrHkTyPtr->customParams.doAxialPosition == true) {
+				LbInPrintf("\naxial position = %3.3e", photon->axialPosition);
+		}
+
+		if (hdrHkTyPtr->customParams.doDetectorXposition == true) {
+				LbInPrintf("\ndetector x position = %3.3e", photon->detLocation.x_position);
+		}
+
+		if (hdrHkTyPtr->customParams.doDetectorYposition == true) {
+				LbInPrintf("\ndetector y position = %3.3e", photon->detLocation.y_position);
+		}
+
+		if (hdrHkTyPtr->customParams.doDetectorZposition == true) {
+				LbInPrintf("\ndetector z position = %3.3e", photon->detLocation.z_position);
+		}
+
+		if (hdrHkTyPtr->customParams.doDetectorAngle == true) {
+				LbInPrintf("\ndetector angle = %3.3e", photon->detectorAngle);
+		}
+
+		if (hdrHkTyPtr->customParams.doDetectorCrystal == true) {
+				LbInPrintf("\ndetector crystal = %d", photon->detCrystal);
+		}
+
+		if (hdrHkTyPtr->customParams.doNumDetectorInteractions == true) {
+			LbInPrintf("\nnumber of detector interactions = %d", photon->num_det_interactions);
+		}
+		
+		if (hdrHkTyPtr->customParams.doDetInteractionPos == true) {
+			LbUsFourByte	i;
+			
+			for (i = 0; i < photon->num_det_interactions; i++) {
+				LbInPrintf("\ndetector interaction = %3.3e %3.3e %3.3e %3.3e %d",
+					photon->det_interactions[i].pos.x_position,
+					photon->det_interactions[i].pos.y_position,
+					photon->det_interactions[i].pos.z_position,
+					photon->det_interactions[i].energy_deposited,
+					photon->det_interactions[i].isActive);
+			}
+		}
+		
+		LbInPrintf("\n");
+}
+
+/*********************************************************************************
+*
+*			Name:		phoHFileCreateDetectedPhoton
+*
+*			Summary:	Make a new detected photon (To write to the history file).
+*			Arguments:
+*				PHG_TrackingPhoton	*trackingphoton	- The tracking photon.
+*				PHG_DetectedPhoton	*detectedphoton	- The detected photon.
+*				
+*			Function return: None.
+*
+*********************************************************************************/
+void phoHFileCreateDetectedPhoton(PHG_TrackingPhoton *trackingphoton,
+		PHG_DetectedPhoton *detectedphoton)	
+{
+	LbUsFourByte		numScatters;	/* sum of the scatters in object and collimator */
+	
+	/* Convert tracking photon travel distance to "time since creation" */
+	detectedphoton->time_since_creation = trackingphoton->travel_distance/PHGMATH_SPEED_OF_LIGHT;
+
+	/* Convert the tracking photon to an detected photon */
+	detectedphoton->location.x_position = (float) trackingphoton->location.x_position;
+	detectedphoton->location.y_position = (float) trackingphoton->location.y_position;
+	detectedphoton->location.z_position = (float) trackingphoton->location.z_position;
+
+	detectedphoton->angle.cosine_x = (float) trackingphoton->angle.cosine_x;
+	detectedphoton->angle.cosine_y = (float) trackingphoton->angle.cosine_y;
+	detectedphoton->angle.cosine_z = (float) trackingphoton->angle.cosine_z;
+
+	detectedphoton->energy = (float) trackingphoton->energy;
+	detectedphoton->transaxialPosition = trackingphoton->transaxialPosition;
+	detectedphoton->azimuthalAngleIndex = trackingphoton->azimuthalAngleIndex;
+	detectedphoton->detectorAngle = trackingphoton->detectorAngle;
+	detectedphoton->detCrystal = trackingphoton->detCrystal;
+	
+	/* Set the weight */
+	detectedphoton->photon_weight = trackingphoton->photon_current_weight;
+		
+	/* Construct the flags */
+	{
+		/* Start by setting number of scatters flags */
+
+		/* sum the scatters in the object and collimator--if the user wants to preserve
+		the difference between the two, they need to use the custom history file */
+		numScatters = trackingphoton->num_of_scatters + trackingphoton->scatters_in_col;
+		
+		if (numScatters >= MAX_SCATTERS)
+			detectedphoton->flags = (MAX_SCATTERS << 2);
+		else
+			detectedphoton->flags = (numScatters << 2);
+		
+		/* Now set "blue" flag */
+		if (PHG_IsBlue(trackingphoton))
+			LbFgSet(detectedphoton->flags, PHGFg_PhotonBlue);
+	}
+}
+					
+/*********************************************************************************
+*
+*			Name:			PhoHFileGetRunTimeParams
+*
+*			Summary:	Read in the runtime parameters.
+*			Arguments:
+*
+*			Function return: true unless an error occurs.
+*
+*********************************************************************************/
+Boolean PhoHFileGetRunTimeParams(char *paramPath, PhoHFileRunTimeParamsTy *customParams)	
+{
+	double					paramBuffer[LBPF_PARAM_LEN];
+	Boolean					okay = false;					/* Process flag */
+	Boolean					isEOF;							/* End of file flag */
+	Boolean					switchOkay;						/* Switch flag */
+	LbPfEnPfTy				paramType;
+	LbUsFourByte			paramSize;
+	char					paramLabel[LBPF_LABEL_LEN];
+	PhoHFileEn_RunTimeParamsTy	whichParam;
+	LbPfHkTy				paramFileHk;
+	
+	do { /* Process Loop */
+
+
+		
+		/* Attempt to open parameter file */
+		if (!LbPfOpen(paramPath, 0, &paramFileHk)) {
+			break;
+		}
+		
+		/* Set default boolean values */
+		customParams->doXposition = false;
+		customParams->doXrange = false;
+		customParams->doYposition = false;
+		customParams->doYrange = false;
+		customParams->doZposition = false;
+		customParams->doZrange = false;
+		customParams->doXcosine = false;
+		customParams->doXCosRange = false;
+		customParams->doYcosine = false;
+		customParams->doYCosRange = false;
+		customParams->doZcosine = false;
+		customParams->doZCosRange = false;
+		customParams->doScattersInObject = false;
+		customParams->doObjScatRange = false;
+		customParams->doScattersInCollimator = false;
+		customParams->doColScatRange = false;
+		customParams->doDecayWeight = false;
+		customParams->doEnergy = false;
+		customParams->doEnergyRange = false;
+		customParams->doTravelDistance = false;
+		customParams->doTravDistRange = false;
+		customParams->doDecayXposition = false;
+		customParams->doDecayXrange = false;
+		customParams->doDecayYposition = false;
+		customParams->doDecayYrange = false;
+		customParams->doDecayZposition = false;
+		customParams->doDecayZrange = false;
+		customParams->doDecayTime = false;
+		customParams->doDecayType = false;
+		customParams->doTransaxialDistance = false;
+		customParams->doTransDistRange = false;
+		customParams->doAzimuthalAngleIndex = false;
+		customParams->doAziAngRange = false;
+		customParams->doAxialPosition = false;
+		customParams->doAxiPosRange = false;
+		customParams->doDetectorXposition = false;
+		customParams->doDetectorXposRange = false;
+		customParams->doDetectorYposition = false;
+		customParams->doDetectorYposRange = false;
+		customParams->doDetectorZposition = false;
+		customParams->doDetectorZposRange = false;
+		customParams->doNumDetectorInteractions = false;
+		customParams->doNumDetInteractionsRange = false;
+		customParams->doDetInteractionPos = false;
+		customParams->doDetectorAngle = false;
+		customParams->doDetectorAngleRange = false;
+		customParams->doDetectorCrystal = false;
+		
+		customParams->xPosMin = LBDOUBLE_MAX;
+		customParams->xPosMax = LBDOUBLE_MIN;
+		customParams->yPosMin = LBDOUBLE_MAX;
+		customParams->yPosMax = LBDOUBLE_MIN;
+		customParams->zPosMin = LBDOUBLE_MAX;
+		customParams->zPosMax = LBDOUBLE_MIN;
+		customParams->xCosMin = LBDOUBLE_MAX;
+		customParams->xCosMax = LBDOUBLE_MIN;
+		customParams->yCosMin = LBDOUBLE_MAX;
+		customParams->yCosMax = LBDOUBLE_MIN;
+		customParams->zCosMin = LBDOUBLE_MAX;
+		customParams->zCosMax = LBDOUBLE_MIN;
+		customParams->objScattersMin = LBFOURBYTE_MAX;
+		customParams->objScattersMax = LBFOURBYTE_MIN;
+		customParams->colScattersMin = LBFOURBYTE_MAX;
+		customParams->colScattersMax  = LBFOURBYTE_MIN;
+		customParams->energyMin = LBDOUBLE_MAX;
+		customParams->energyMax = LBDOUBLE_MIN;
+		customParams->travelDistanceMin = LBDOUBLE_MAX;
+		customParams->travelDistanceMax = LBDOUBLE_MIN;
+		customParams->decayXPosMin = LBDOUBLE_MAX;
+		customParams->decayXPosMax = LBDOUBLE_MIN;
+		customParams->decayYPosMin = LBDOUBLE_MAX;
+		customParams->decayYPosMax = LBDOUBLE_MIN;
+		customParams->decayZPosMin = LBDOUBLE_MAX;
+		customParams->decayZPosMax = LBDOUBLE_MIN;
+		customParams->transaxialDistanceMin = LBDOUBLE_MAX;
+		customParams->transaxialDistanceMax = LBDOUBLE_MIN;
+		customParams->aaIndexMin = LBFOURBYTE_MAX;
+		customParams->aaIndexMax = LBFOURBYTE_MIN;
+		customParams->axialPositionMin = LBDOUBLE_MAX;
+		customParams->axialPositionMax = LBDOUBLE_MIN;
+		customParams->detectorXpositionMin = LBDOUBLE_MAX;
+		customParams->detectorXpositionMax = LBDOUBLE_MIN;
+		customParams->detectorYpositionMin = LBDOUBLE_MAX;
+		customParams->detectorYpositionMax = LBDOUBLE_MIN;
+		customParams->detectorZpositionMin = LBDOUBLE_MAX;
+		customParams->detectorZpositionMax = LBDOUBLE_MIN;
+		customParams->detectorAngleMin = LBDOUBLE_MAX;
+		customParams->detectorAngleMax = LBDOUBLE_MIN;
+		customParams->numDetInteractionsMin = LBFOURBYTE_MAX;
+		customParams->numDetInteractionsMax = LBFOURBYTE_MIN;
+		customParams->detectorAngleMin = LBDOUBLE_MAX;
+		customParams->detectorAngleMax = LBDOUBLE_MIN;
+			
+		/* Loop through the parameters */
+		while(LbPfGetParam(&paramFileHk, (void *)paramBuffer,
+				&paramType, &paramSize, paramLabel, &isEOF)) {
+				
+				/* Find the runtime parameter */
+				whichParam = PhoHFileLookupRunTimeParamLabel(paramLabel);
+				
+				
+				switchOkay = true;
+				switch (whichParam) {
+
+					case PhoHFileEn_x_position:
+						customParams->doXposition =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_x_pos_min:
+						customParams->xPosMin =
+							*((double *) paramBuffer);
+						customParams->doXrange = true;
+						break;
+
+					case PhoHFileEn_x_pos_max:
+						customParams->xPosMax =
+							*((double *) paramBuffer);
+						break;
+
+					case PhoHFileEn_y_position:
+						customParams->doYposition =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_y_pos_min:
+						customParams->yPosMin =
+							*((double *) paramBuffer);
+						customParams->doYrange = true;
+						break;
+
+					case PhoHFileEn_y_pos_max:
+						customParams->yPosMax =
+							*((double *) paramBuffer);
+						break;
+
+					case PhoHFileEn_z_position:
+						customParams->doZposition =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_z_pos_min:
+						customParams->zPosMin =
+							*((double *) paramBuffer);
+						customParams->doZrange = true;
+						break;
+
+					case PhoHFileEn_z_pos_max:
+						customParams->zPosMax =
+							*((double *) paramBuffer);
+						break;
+
+					case PhoHFileEn_x_cosine:
+						customParams->doXcosine =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_x_cos_min:
+						customParams->xCosMin =
+							*((double *) paramBuffer);
+						customParams->doXCosRange = true;
+						break;
+
+					case PhoHFileEn_x_cos_max:
+						customParams->xCosMax =
+							*((double *) paramBuffer);
+						break;
+
+					case PhoHFileEn_y_cosine:
+						customParams->doYcosine =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_y_cos_min:
+						customParams->yCosMin =
+							*((double *) paramBuffer);
+						customParams->doYCosRange = true;
+						break;
+
+					case PhoHFileEn_y_cos_max:
+						customParams->yCosMax =
+							*((double *) paramBuffer);
+						break;
+
+					case PhoHFileEn_z_cosine:
+						customParams->doZcosine =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_z_cos_min:
+						customParams->zCosMin =
+							*((double *) paramBuffer);
+						customParams->doZCosRange = true;
+						break;
+
+					case PhoHFileEn_z_cos_max:
+						customParams->zCosMax =
+							*((double *) paramBuffer);
+						break;
+
+					case PhoHFileEn_scatters_in_object:
+						customParams->doScattersInObject =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_obj_scatters_min:
+						customParams->objScattersMin =
+							*((LbUsFourByte *) paramBuffer);
+						customParams->doObjScatRange = true;
+						break;
+
+					case PhoHFileEn_obj_scatters_max:
+						customParams->objScattersMax =
+							*((LbUsFourByte *) paramBuffer);
+						break;
+
+					case PhoHFileEn_scatters_in_collimator:
+						customParams->doScattersInCollimator =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_col_scatters_min:
+						customParams->colScattersMin =
+							*((LbUsFourByte *) paramBuffer);
+						customParams->doColScatRange = true;
+						break;
+
+					case PhoHFileEn_col_scatters_max:
+						customParams->colScattersMax =
+							*((LbUsFourByte *) paramBuffer);
+						break;
+
+					case PhoHFileEn_decay_weight:
+						customParams->doDecayWeight =
+							*((Boolean *) paramBuffer);
+
+					case PhoHFileEn_weight:
+						customParams->doWeight =
+							*((Boolean *) paramBuffer);
+						break;
+						
+					case PhoHFileEn_energy:
+						customParams->doEnergy =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_energy_min:
+						customParams->energyMin =
+							*((double *) paramBuffer);
+						customParams->doEnergyRange = true;
+						break;
+
+					case PhoHFileEn_energy_max:
+						customParams->energyMax =
+							*((double *) paramBuffer);
+						break;
+						
+					case PhoHFileEn_travel_distance:
+						customParams->doTravelDistance =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_travel_distance_min:
+						customParams->travelDistanceMin =
+							*((double *) paramBuffer);
+						customParams->doTravDistRange = true;
+						break;
+
+					case PhoHFileEn_travel_distance_max:
+						customParams->travelDistanceMax =
+							*((double *) paramBuffer);
+						break;
+						
+					case PhoHFileEn_decay_x_position:
+						customParams->doDecayXposition =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_decay_x_pos_min:
+						customParams->decayXPosMin =
+							*((double *) paramBuffer);
+						customParams->doDecayXrange = true;
+						break;
+
+					case PhoHFileEn_decay_x_pos_max:
+						customParams->decayXPosMax =
+							*((double *) paramBuffer);
+						break;
+						
+					case PhoHFileEn_decay_y_position:
+						customParams->doDecayYposition =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_decay_y_pos_min:
+						customParams->decayYPosMin =
+							*((double *) paramBuffer);
+						customParams->doDecayYrange = true;
+						break;
+
+					case PhoHFileEn_decay_y_pos_max:
+						customParams->decayYPosMax =
+							*((double *) paramBuffer);
+						break;
+						
+					case PhoHFileEn_decay_z_position:
+						customParams->doDecayZposition =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_decay_z_pos_min:
+						customParams->decayZPosMin =
+							*((double *) paramBuffer);
+						customParams->doDecayZrange = true;
+						break;
+
+					case PhoHFileEn_decay_z_pos_max:
+						customParams->decayZPosMax =
+							*((double *) paramBuffer);
+						break;
+						
+					case PhoHFileEn_decay_time:
+						customParams->doDecayTime =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_decay_type:
+						customParams->doDecayType =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_transaxial_distance:
+						customParams->doTransaxialDistance =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_transaxial_distance_min:
+						customParams->transaxialDistanceMin =
+							*((double *) paramBuffer);
+						customParams->doTransDistRange = true;
+						break;
+
+					case PhoHFileEn_transaxial_distance_max:
+						customParams->transaxialDistanceMax =
+							*((double *) paramBuffer);
+						break;
+						
+					case PhoHFileEn_azimuthal_angle_index:
+						customParams->doAzimuthalAngleIndex =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_aa_index_min:
+						customParams->aaIndexMin =
+							*((LbUsFourByte *) paramBuffer);
+						customParams->doAziAngRange = true;
+						break;
+
+					case PhoHFileEn_aa_index_max:
+						customParams->aaIndexMax =
+							*((LbUsFourByte *) paramBuffer);
+						break;
+						
+					case PhoHFileEn_axial_position:
+						customParams->doAxialPosition =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_axial_position_min:
+						customParams->axialPositionMin =
+							*((double *) paramBuffer);
+						customParams->doAxiPosRange = true;
+						break;
+
+					case PhoHFileEn_axial_position_max:
+						customParams->axialPositionMax =
+							*((double *) paramBuffer);
+						break;
+						
+					case 	PhoHFileEn_detector_x_position:
+						customParams->doDetectorXposition =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_detector_x_position_min:
+						customParams->detectorXpositionMin =
+							*((double *) paramBuffer);
+						customParams->doDetectorXposRange = true;
+						break;
+
+					case PhoHFileEn_detector_x_position_max:
+						customParams->detectorXpositionMax =
+							*((double *) paramBuffer);
+						break;
+						
+					case 	PhoHFileEn_detector_y_position:
+						customParams->doDetectorYposition =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_detector_y_position_min:
+						customParams->detectorYpositionMin =
+							*((double *) paramBuffer);
+						customParams->doDetectorYposRange = true;
+						break;
+
+					case PhoHFileEn_detector_y_position_max:
+						customParams->detectorYpositionMax =
+							*((double *) paramBuffer);
+						break;
+						
+					case 	PhoHFileEn_detector_z_position:
+						customParams->doDetectorZposition =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_detector_z_position_min:
+						customParams->detectorZpositionMin =
+							*((double *) paramBuffer);
+						customParams->doDetectorZposRange = true;
+						break;
+
+					case PhoHFileEn_detector_z_position_max:
+						customParams->detectorZpositionMax =
+							*((double *) paramBuffer);
+						break;
+						
+					case 	PhoHFileEn_num_detector_interactions:
+						customParams->doNumDetectorInteractions =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_num_detector_interactions_min:
+						customParams->numDetInteractionsMin =
+							*((LbFourByte *) paramBuffer);
+						break;
+
+					case PhoHFileEn_num_detector_interactions_max:
+						customParams->numDetInteractionsMax =
+							*((LbFourByte *) paramBuffer);
+						customParams->doNumDetInteractionsRange = true;
+						break;
+						
+					case 	PhoHFileEn_det_interaction_positions:
+						customParams->doDetInteractionPos =
+							*((Boolean *) paramBuffer);
+						break;
+						
+					case 	PhoHFileEn_detector_angle:
+						customParams->doDetectorAngle =
+							*((Boolean *) paramBuffer);
+						break;
+
+					case PhoHFileEn_detector_angle_min:
+						customParams->detectorAngleMin =
+							*((double *) paramBuffer);
+						customParams->doDetectorAngleRange = true;
+						break;
+
+					case PhoHFileEn_detector_angle_max:
+						customParams->detectorAngleMax =
+							*((double *) paramBuffer);
+						break;
+						
+					case 	PhoHFileEn_detector_crystal:
+						customParams->doDetectorCrystal =
+							*((Boolean *) paramBuffer);
+						break;
+
+					default:
+						sprintf(phoHFileErrString, "(PhoHFileGetRunTimeParams) Unknown (hence unused) parameter (%s).\n",
+                            paramLabel);
+						ErAlert(phoHFileErrString, false);
+						break;
+				}
+				if (!switchOkay)
+					break;
+		}
+		/* Close the parameter file */
+		LbPfClose(&paramFileHk);
+
+		
+		/* See if we quit due to error */
+		if (!isEOF)
+			break;
+		
+		/* Verify that if we specified a maximum range value we also specified a minimum */
+		if ((customParams->xPosMax != LBDOUBLE_MAX) && (customParams->xPosMin == LBDOUBLE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum x-position range in the history parameters, but not a minimum x-position\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+			break;
+		}
+		if ((customParams->yPosMax != LBDOUBLE_MAX) && (customParams->yPosMin == LBDOUBLE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum y-position range in the history parameters, but not a minimum y-position\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}	
+		if ((customParams->zPosMax != LBDOUBLE_MAX) && (customParams->zPosMin == LBDOUBLE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum z-position range in the history parameters, but not a minimum z-position\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}	
+		if ((customParams->xCosMax != LBDOUBLE_MAX) && (customParams->xCosMin == LBDOUBLE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum x-cosine range in the history parameters, but not a minimum x-cosine\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}	
+		if ((customParams->yCosMax != LBDOUBLE_MAX) && (customParams->yCosMin == LBDOUBLE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum y-cosine range in the history parameters, but not a minimum y-cosine\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}	
+		if ((customParams->zCosMax != LBDOUBLE_MAX) && (customParams->zCosMin == LBDOUBLE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum z-cosine range in the history parameters, but not a minimum z-cosine\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}
+		if ((customParams->objScattersMax != LBFOURBYTE_MAX) && (customParams->objScattersMin == LBFOURBYTE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum number of scatters in the object in the history parameters, but not a minimum\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}
+		if ((customParams->colScattersMax != LBFOURBYTE_MAX) && (customParams->colScattersMin == LBFOURBYTE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum number of scatters in the collimator in the history parameters, but not a minimum\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}
+		if ((customParams->energyMax != LBDOUBLE_MAX) && (customParams->energyMin == LBDOUBLE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum energy in the history parameters, but not a minimum\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}
+		if ((customParams->travelDistanceMax != LBDOUBLE_MAX) && (customParams->travelDistanceMin == LBDOUBLE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum travel distance in the history parameters, but not a minimum\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}
+		if ((customParams->decayXPosMax != LBDOUBLE_MAX) && (customParams->decayXPosMin == LBDOUBLE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum travel distance in the history parameters, but not a minimum\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}
+		if ((customParams->decayYPosMax != LBDOUBLE_MAX) && (customParams->decayYPosMin == LBDOUBLE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum travel distance in the history parameters, but not a minimum\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}
+		if ((customParams->decayZPosMax != LBDOUBLE_MAX) && (customParams->decayZPosMin == LBDOUBLE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum travel distance in the history parameters, but not a minimum\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}
+		if ((customParams->transaxialDistanceMax != LBDOUBLE_MAX) && (customParams->transaxialDistanceMin == LBDOUBLE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum transaxial distance in the history parameters, but not a minimum\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}
+		if ((customParams->aaIndexMax != LBFOURBYTE_MAX) && (customParams->aaIndexMin == LBFOURBYTE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum azimuthal angle index in the history parameters, but not a minimum\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}
+		if ((customParams->axialPositionMax != LBDOUBLE_MAX) && (customParams->axialPositionMin == LBDOUBLE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum axial position in the history parameters, but not a minimum\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}
+		if ((customParams->detectorXpositionMax != LBDOUBLE_MAX) && (customParams->detectorXpositionMin == LBDOUBLE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum x-position within the detector in the history parameters, but not a minimum\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}
+		if ((customParams->detectorYpositionMax != LBDOUBLE_MAX) && (customParams->detectorYpositionMin == LBDOUBLE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum y-position within the detector in the history parameters, but not a minimum\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}
+		if ((customParams->detectorZpositionMax != LBDOUBLE_MAX) && (customParams->detectorZpositionMin == LBDOUBLE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum z-position within the detector in the history parameters, but not a minimum\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}
+		if ((customParams->numDetInteractionsMax != LBFOURBYTE_MAX) && (customParams->numDetInteractionsMin == LBFOURBYTE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum number of detector interactions in the history parameters, but not a minimum\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}		
+		if ((customParams->detectorAngleMax != LBDOUBLE_MAX) && (customParams->detectorAngleMin == LBDOUBLE_MIN)) {
+			sprintf(phoHFileErrString,"You specified a maximum detector angle in the history parameters, but not a minimum\n"
+				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
+				"or a specification for both maximum and minimum", paramPath);
+			ErStGeneric(phoHFileErrString);
+		}
+		okay = true;
+	} while (false);
+	
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:			PhoHFileLookupRunTimeParamLabel
+*
+*			Summary:	Find the given label in the label table and return
+*						its enumeration value.
+*			Arguments:
+*				char		*label	- The label to find.
+*			Function return: Enumerated type corresponding to label.
+*
+*********************************************************************************/
+PhoHFileEn_RunTimeParamsTy  PhoHFileLookupRunTimeParamLabel(char *label)	
+{
+	PhoHFileEn_RunTimeParamsTy	whichParam;			/* Parameter we find */
+	LbUsFourByte			labelIndex;			/* Label we are checking */
+
+	/* Set param to null */
+	whichParam = PhoHFileEn_NULL;
+	
+	/* Search table for given label */
+	for (labelIndex = 0; labelIndex < (PhoHFileEn_NULL); labelIndex++){
+	
+		/* See if it matches */
+		if (strcmp(label, PhoHFileRunTimeParamLabels[labelIndex]) == 0) {
+			whichParam = (PhoHFileEn_RunTimeParamsTy) labelIndex;
+			break;
+		}
+	}
+	
+	return (whichParam);
+}
+
+/*********************************************************************************
+*
+*			Name:		PhoHFileReadAhead
+*
+*			Summary:	Tell the system that a history file will be read from
+*						start to end, so that it reads well ahead of the caller
+*						and the disk works while the events are processed.
+*
+*			Arguments:
+*				FILE				*historyFile	- The history file.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void PhoHFileReadAhead(FILE *historyFile)
+{
+	#if defined(GEN_UNIX) && defined(POSIX_FADV_SEQUENTIAL)
+		(void) posix_fadvise(fileno(historyFile), 0, 0, POSIX_FADV_SEQUENTIAL);
+	#else
+		if (historyFile) {};		/* Eliminate unused parameter compiler warning */
+	#endif
+}
+
+/*********************************************************************************
+*
+*			Name:		PhoHFileReadChunkIndex
+*
+*			Summary:	Read the chunk index of a compressed history file.  Each
+*						entry gives a chunk's file offset and first decay, so
+*						reading can start at any chunk:  seek to its offset
+*						and call PhoHFileReadEvent.  The file position is left
+*						undefined.
+*
+*			Arguments:
+*				FILE					*historyFile	- The history file.
+*				PhoHFileChunkEntryTy	**entriesPtr	- Receives the index,
+*														  free with LbMmFree.
+*				LbUsFourByte			*numEntriesPtr	- Receives the number of
+*														  entries.
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean PhoHFileReadChunkIndex(FILE *historyFile, PhoHFileChunkEntryTy **entriesPtr,
+			LbUsFourByte *numEntriesPtr)
+{
+	Boolean				okay = false;	/* Success flag */
+	phoHFileChunkHdrTy	chunkHdr;		/* A chunk header */
+	LbUsEightByte		indexOffset;	/* File offset of the index chunk */
+	
+	*entriesPtr = 0;
+	*numEntriesPtr = 0;
+	
+	do { /* Process Loop */
+	
+		/* The trailer at the end of the file locates the index */
+		if ((fseeko(historyFile, -(off_t) (sizeof(phoHFileChunkHdrTy) + sizeof(indexOffset)),
+				SEEK_END) != 0) ||
+				(fread(&chunkHdr, sizeof(phoHFileChunkHdrTy), 1, historyFile) != 1) ||
+				(fread(&indexOffset, sizeof(indexOffset), 1, historyFile) != 1) ||
+				(memcmp(chunkHdr.magic, PHOHFILE_CHUNK_MAGIC, sizeof(chunkHdr.magic)) != 0) ||
+				(chunkHdr.kind != PHOHFILE_CHUNK_TRAILER)) {
+			
+			ErStGeneric("History file has no chunk index (PhoHFileReadChunkIndex).");
+			break;
+		}
+		
+		if ((fseeko(historyFile, (off_t) indexOffset, SEEK_SET) != 0) ||
+				(fread(&chunkHdr, sizeof(phoHFileChunkHdrTy), 1, historyFile) != 1) ||
+				(memcmp(chunkHdr.magic, PHOHFILE_CHUNK_MAGIC, sizeof(chunkHdr.magic)) != 0) ||
+				(chunkHdr.kind != PHOHFILE_CHUNK_INDEX) ||
+				((chunkHdr.dataSize % sizeof(PhoHFileChunkEntryTy)) != 0)) {
+			
+			ErStGeneric("Unable to read history file chunk index (PhoHFileReadChunkIndex).");
+			break;
+		}
+		
+		*numEntriesPtr = chunkHdr.dataSize / sizeof(PhoHFileChunkEntryTy);
+		if (*numEntriesPtr != 0) {
+			if ((*entriesPtr = (PhoHFileChunkEntryTy *) LbMmAlloc(chunkHdr.dataSize)) == 0) {
+				*numEntriesPtr = 0;
+				break;
+			}
+			if (fread(*entriesPtr, chunkHdr.dataSize, 1, historyFile) != 1) {
+				LbMmFree((void **)entriesPtr);
+				*numEntriesPtr = 0;
+				ErStGeneric("Unable to read history file chunk index (PhoHFileReadChunkIndex).");
+				break;
+			}
+		}
+		
+		okay = true;
+	} while (false);
+	
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:		phoHFileNewIndexer
+*
+*			Summary:	Start building the decay index of a standard history file.
+*
+*			Arguments:
+*				LbUsFourByte	interval		- Decays per index entry.
+*				LbUsEightByte	eventsStart		- File offset of the first event.
+*
+*			Function return: The new index, 0 if it could not be created.
+*
+*********************************************************************************/
+phoHFileIndexerTy *phoHFileNewIndexer(LbUsFourByte interval, LbUsEightByte eventsStart)
+{
+	phoHFileIndexerTy	*indexerPtr = 0;	/* The new index */
+	
+	do { /* Process Loop */
+		
+		if (interval == 0) {
+			ErStGeneric("The decay index interval must be at least 1 (phoHFileNewIndexer).");
+			break;
+		}
+		
+		if ((indexerPtr = (phoHFileIndexerTy *) LbMmAlloc(sizeof(phoHFileIndexerTy))) == 0) {
+			break;
+		}
+		memset(indexerPtr, 0, sizeof(phoHFileIndexerTy));
+		memcpy(indexerPtr->header.magic, PHOHFILE_INDEX_MAGIC, sizeof(indexerPtr->header.magic));
+		indexerPtr->header.version = PHOHFILE_INDEX_VERSION;
+		indexerPtr->header.interval = interval;
+		indexerPtr->header.eventsStart = eventsStart;
+		indexerPtr->nextOffset = eventsStart;
+	} while (false);
+	
+	return (indexerPtr);
+}
+
+/*********************************************************************************
+*
+*			Name:		phoHFileFreeIndexer
+*
+*			Summary:	Free a decay index being built.
+*
+*			Arguments:
+*				phoHFileIndexerTy	*indexerPtr		- The index.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phoHFileFreeIndexer(phoHFileIndexerTy *indexerPtr)
+{
+	if (indexerPtr->entries != 0) {
+		LbMmFree((void **)&indexerPtr->entries);
+	}
+	LbMmFree((void **)&indexerPtr);
+}
+
+/*********************************************************************************
+*
+*			Name:		phoHFileIndexRecords
+*
+*			Summary:	Add records about to be written at the end of the history
+*						file to its decay index, starting an entry every interval
+*						decays.  Only the flags, and the time of each decay that
+*						starts an entry, are looked at.  A record cut off by the
+*						end of the records is left for the next call.
+*
+*			Arguments:
+*				phoHFileIndexerTy	*indexerPtr		- The index.
+*				LbUsOneByte			*records		- The records.
+*				LbUsFourByte		bytes			- Bytes of records.
+*				LbUsFourByte		*usedPtr		- Receives the bytes of whole
+*													  records indexed.
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean phoHFileIndexRecords(phoHFileIndexerTy *indexerPtr, LbUsOneByte *records,
+			LbUsFourByte bytes, LbUsFourByte *usedPtr)
+{
+	Boolean					okay = false;	/* Success flag */
+	PhoHFileDecayIndexHdrTy	*headerPtr;		/* The index header */
+	PhoHFileChunkEntryTy	*entryPtr = 0;	/* The growing entry */
+	PhoHFileChunkEntryTy	*newEntries;	/* Replacement for full entries */
+	LbUsFourByte			newMaxEntries;	/* Length of the replacement */
+	LbUsOneByte				*recordPtr;		/* The current record */
+	LbUsFourByte			recordSize;		/* Its size */
+	PHG_Decay				decay;			/* A decay starting an entry */
+	
+	headerPtr = &indexerPtr->header;
+	if (headerPtr->numEntries != 0) {
+		entryPtr = &indexerPtr->entries[headerPtr->numEntries - 1];
+	}
+	
+	do { /* Process Loop */
+		
+		for (recordPtr = records; recordPtr < (records + bytes); recordPtr += recordSize) {
+			
+			if (PHG_IsADecay((LbUsFourByte) *recordPtr)) {
+				recordSize = 1 + sizeof(PHG_Decay);
+				if ((recordPtr + recordSize) > (records + bytes)) {
+					break;
+				}
+				
+				/* Start an entry every interval decays */
+				if ((headerPtr->numDecays % headerPtr->interval) == 0) {
+					if (headerPtr->numEntries == indexerPtr->maxEntries) {
+						newMaxEntries = (indexerPtr->maxEntries == 0) ? 256 :
+							2*indexerPtr->maxEntries;
+						if ((newEntries = (PhoHFileChunkEntryTy *)
+								LbMmAlloc(newMaxEntries * sizeof(PhoHFileChunkEntryTy))) == 0) {
+							goto FAIL;
+						}
+						if (indexerPtr->entries != 0) {
+							memcpy(newEntries, indexerPtr->entries,
+								headerPtr->numEntries * sizeof(PhoHFileChunkEntryTy));
+							LbMmFree((void **)&indexerPtr->entries);
+						}
+						indexerPtr->entries = newEntries;
+						indexerPtr->maxEntries = newMaxEntries;
+					}
+					
+					memcpy(&decay, recordPtr + 1, sizeof(PHG_Decay));
+					entryPtr = &indexerPtr->entries[headerPtr->numEntries++];
+					entryPtr->offset = indexerPtr->nextOffset + (recordPtr - records);
+					entryPtr->firstDecay = headerPtr->numDecays;
+					entryPtr->firstDecayTime = decay.decayTime;
+					entryPtr->numDecays = 0;
+					entryPtr->numPhotons = 0;
+				}
+				entryPtr->numDecays++;
+				headerPtr->numDecays++;
+			}
+			else {
+				recordSize = 1 + sizeof(PHG_DetectedPhoton);
+				if ((recordPtr + recordSize) > (records + bytes)) {
+					break;
+				}
+				
+				if (entryPtr == 0) {
+					ErStGeneric("History events don't start with a decay, they can't be indexed (phoHFileIndexRecords).");
+					goto FAIL;
+				}
+				entryPtr->numPhotons++;
+				headerPtr->numPhotons++;
+			}
+		}
+		
+		*usedPtr = (LbUsFourByte) (recordPtr - records);
+		indexerPtr->nextOffset += *usedPtr;
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:		phoHFileWriteDecayIndex
+*
+*			Summary:	Write a decay index beside the closed history file it was
+*						built for, noting the file's size and modification time so
+*						that a changed file's index isn't used.
+*
+*			Arguments:
+*				phoHFileIndexerTy	*indexerPtr		- The index.
+*				char				*histFilePath	- The path of the history file.
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean phoHFileWriteDecayIndex(phoHFileIndexerTy *indexerPtr, char *histFilePath)
+{
+	Boolean			okay = false;		/* Success flag */
+	FILE			*indexFile = 0;		/* The index file */
+	char			indexPath[PATH_LENGTH+sizeof(PHOHFILE_INDEX_SUFFIX)];	/* Path of the index file */
+	struct stat		fileInfo;			/* Size and time of the history file */
+	
+	sprintf(indexPath, "%s%s", histFilePath, PHOHFILE_INDEX_SUFFIX);
+	
+	do { /* Process Loop */
+		
+		/* The index must cover the whole file */
+		if (stat(histFilePath, &fileInfo) != 0) {
+			sprintf(phoHFileErrString, "Unable to find the size of history file named '%s'",
+				histFilePath);
+			ErStFileError(phoHFileErrString);
+			break;
+		}
+		if ((LbUsEightByte) fileInfo.st_size != indexerPtr->nextOffset) {
+			sprintf(phoHFileErrString, "History file '%s' holds events that weren't indexed",
+				histFilePath);
+			ErStGeneric(phoHFileErrString);
+			break;
+		}
+		indexerPtr->header.fileSize = (LbUsEightByte) fileInfo.st_size;
+		indexerPtr->header.fileTime = (LbUsEightByte) fileInfo.st_mtime;
+		
+		if ((indexFile = LbFlFileOpen(indexPath, "wb")) == 0) {
+			sprintf(phoHFileErrString, "Unable to create decay index named '%s'",
+				indexPath);
+			ErStFileError(phoHFileErrString);
+			break;
+		}
+		if ((fwrite(&indexerPtr->header, sizeof(PhoHFileDecayIndexHdrTy), 1, indexFile) != 1) ||
+				((indexerPtr->header.numEntries != 0) &&
+				(fwrite(indexerPtr->entries, sizeof(PhoHFileChunkEntryTy),
+				indexerPtr->header.numEntries, indexFile) != indexerPtr->header.numEntries))) {
+			
+			sprintf(phoHFileErrString, "Unable to write decay index named '%s'",
+				indexPath);
+			ErStFileError(phoHFileErrString);
+			break;
+		}
+		
+		if (fclose(indexFile) != 0) {
+			indexFile = 0;
+			sprintf(phoHFileErrString, "Unable to write decay index named '%s'",
+				indexPath);
+			ErStFileError(phoHFileErrString);
+			break;
+		}
+		indexFile = 0;
+		
+		okay = true;
+	} while (false);
+	
+	/* Don't leave a partial or stale index */
+	if (indexFile != 0) {
+		fclose(indexFile);
+	}
+	if (!okay) {
+		remove(indexPath);
+	}
+	
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:		PhoHFileIndexDecays
+*
+*			Summary:	Write the decay index of an existing standard history
+*						file:  an entry for every interval decays giving the file
+*						offset, number and time of the first of them.  The index
+*						is written beside the file (see PHOHFILE_INDEX_SUFFIX).
+*						Files written with history_index_interval set are indexed
+*						as they are written; this is for other files.  Compressed
+*						files are not indexed this way as they carry their own
+*						chunk index.
+*
+*			Arguments:
+*				char			*histFilePath	- The path of the history file.
+*				LbUsFourByte	interval		- Decays per index entry.
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean PhoHFileIndexDecays(char *histFilePath, LbUsFourByte interval)
+{
+	Boolean				okay = false;			/* Success flag */
+	FILE				*historyFile = 0;		/* The history file */
+	PhoHFileHdrTy		histHeader;				/* Header of the history file */
+	LbHdrHkTy			headerHk;				/* Hook to the history file header */
+	Boolean				isHeaderRead = false;	/* Was the header read? */
+	phoHFileIndexerTy	*indexerPtr = 0;		/* The index */
+	size_t				bytesRead;				/* Bytes read from the history file */
+	LbUsFourByte		bytesHeld = 0;			/* Bytes of a record held over */
+	LbUsFourByte		indexedBytes;			/* Bytes of whole records indexed */
+	LbUsOneByte			readBuffer[65536];		/* Buffer for reading */
+	
+	do { /* Process Loop */
+		
+		if ((historyFile = LbFlFileOpen(histFilePath, "rb")) == 0) {
+			sprintf(phoHFileErrString, "Unable to open history file named '%s'",
+				histFilePath);
+			ErStFileError(phoHFileErrString);
+			break;
+		}
+		
+		/* Read the header, which leaves the file at the first event */
+		if (PhgHdrGtParams(historyFile, &histHeader, &headerHk) == false) {
+			break;
+		}
+		isHeaderRead = true;
+		
+		/* Only current standard format files can be read event by event */
+		if ((histHeader.H.HdrKind != PhoHFileEn_PHG) &&
+				(histHeader.H.HdrKind != PhoHFileEn_COL) &&
+				(histHeader.H.HdrKind != PhoHFileEn_DET)) {
+			sprintf(phoHFileErrString, "'%s' is not a current format history file, it can't be indexed",
+				histFilePath);
+			ErStGeneric(phoHFileErrString);
+			break;
+		}
+		if (histHeader.H.isCompressed) {
+			sprintf(phoHFileErrString, "'%s' is compressed, it is indexed by its own chunk index",
+				histFilePath);
+			ErStGeneric(phoHFileErrString);
+			break;
+		}
+		
+		if ((indexerPtr = phoHFileNewIndexer(interval,
+				(LbUsEightByte) ftello(historyFile))) == 0) {
+			break;
+		}
+		
+		/* Index the events as they would be written */
+		while ((bytesRead = fread(readBuffer + bytesHeld, 1, sizeof(readBuffer) - bytesHeld,
+				historyFile)) != 0) {
+			
+			if (phoHFileIndexRecords(indexerPtr, readBuffer, bytesHeld + bytesRead,
+					&indexedBytes) == false) {
+				goto FAIL;
+			}
+			bytesHeld += bytesRead - indexedBytes;
+			memmove(readBuffer, readBuffer + indexedBytes, bytesHeld);
+		}
+		if (ferror(historyFile)) {
+			sprintf(phoHFileErrString, "Unable to read history file named '%s'",
+				histFilePath);
+			ErStFileError(phoHFileErrString);
+			break;
+		}
+		if (bytesHeld != 0) {
+			sprintf(phoHFileErrString, "History file '%s' ends part way through a record",
+				histFilePath);
+			ErStGeneric(phoHFileErrString);
+			break;
+		}
+		
+		fclose(historyFile);
+		historyFile = 0;
+		
+		if (phoHFileWriteDecayIndex(indexerPtr, histFilePath) == false) {
+			break;
+		}
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	if (indexerPtr != 0) {
+		phoHFileFreeIndexer(indexerPtr);
+	}
+	if (isHeaderRead) {
+		PhgHdrFrHeader(&headerHk);
+	}
+	if (historyFile != 0) {
+		fclose(historyFile);
+	}
+	
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:		PhoHFileReadDecayIndex
+*
+*			Summary:	Read the decay index of a standard history file.  Each
+*						entry gives the file offset, number and time of a decay
+*						that starts a run of interval decays, so reading can
+*						start at any of them:  seek to the offset and call
+*						PhoHFileReadEvent.  A file without an index, or whose
+*						index no longer matches it, gives no entries.  The index
+*						matches while the file has the size and modification time
+*						noted in it and there is a decay at every entry's offset.
+*
+*			Arguments:
+*				char					*histFilePath	- The path of the history file.
+*				PhoHFileDecayIndexHdrTy	*indexHdrPtr	- Receives the index header,
+*														  numEntries is 0 if there
+*														  is no index.
+*				PhoHFileChunkEntryTy	**entriesPtr	- Receives the entries, free
+*														  with LbMmFree.
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean PhoHFileReadDecayIndex(char *histFilePath, PhoHFileDecayIndexHdrTy *indexHdrPtr,
+			PhoHFileChunkEntryTy **entriesPtr)
+{
+	Boolean				okay = false;		/* Success flag */
+	Boolean				isStale = false;	/* Doesn't the index match the file? */
+	FILE				*indexFile = 0;		/* The index file */
+	FILE				*historyFile = 0;	/* The history file */
+	char				indexPath[PATH_LENGTH+sizeof(PHOHFILE_INDEX_SUFFIX)];	/* Path of the index file */
+	struct stat			fileInfo;			/* Size and time of the history file */
+	LbUsFourByte		entryIndex;			/* LCV for the entries */
+	LbUsEightByte		prevOffset;			/* Offset of the previous entry */
+	int					flag;				/* Flag of the event at an entry */
+	
+	*entriesPtr = 0;
+	memset(indexHdrPtr, 0, sizeof(PhoHFileDecayIndexHdrTy));
+	sprintf(indexPath, "%s%s", histFilePath, PHOHFILE_INDEX_SUFFIX);
+	
+	do { /* Process Loop */
+		
+		/* It's fine for there to be no index */
+		if ((indexFile = LbFlFileOpen(indexPath, "rb")) == 0) {
+			okay = true;
+			break;
+		}
+		
+		/* Nor is an index used that isn't one, or that's out of date */
+		if ((fread(indexHdrPtr, sizeof(PhoHFileDecayIndexHdrTy), 1, indexFile) != 1) ||
+				(memcmp(indexHdrPtr->magic, PHOHFILE_INDEX_MAGIC, sizeof(indexHdrPtr->magic)) != 0) ||
+				(indexHdrPtr->version != PHOHFILE_INDEX_VERSION)) {
+			isStale = true;
+			okay = true;
+			break;
+		}
+		if ((stat(histFilePath, &fileInfo) != 0) ||
+				((LbUsEightByte) fileInfo.st_size != indexHdrPtr->fileSize) ||
+				((LbUsEightByte) fileInfo.st_mtime != indexHdrPtr->fileTime)) {
+			isStale = true;
+			okay = true;
+			break;
+		}
+		
+		/* Read the entries */
+		if (indexHdrPtr->numEntries != 0) {
+			if ((*entriesPtr = (PhoHFileChunkEntryTy *)
+					LbMmAlloc(indexHdrPtr->numEntries * sizeof(PhoHFileChunkEntryTy))) == 0) {
+				break;
+			}
+			if (fread(*entriesPtr, sizeof(PhoHFileChunkEntryTy), indexHdrPtr->numEntries,
+					indexFile) != indexHdrPtr->numEntries) {
+				sprintf(phoHFileErrString, "Unable to read decay index named '%s'",
+					indexPath);
+				ErStFileError(phoHFileErrString);
+				break;
+			}
+		}
+		
+		/* Every entry must start at a decay, in order, within the events */
+		if ((historyFile = LbFlFileOpen(histFilePath, "rb")) == 0) {
+			isStale = true;
+			okay = true;
+			break;
+		}
+		prevOffset = indexHdrPtr->eventsStart;
+		for (entryIndex = 0; entryIndex < indexHdrPtr->numEntries; entryIndex++) {
+			if (((*entriesPtr)[entryIndex].offset < prevOffset) ||
+					((*entriesPtr)[entryIndex].offset >= indexHdrPtr->fileSize) ||
+					(fseeko(historyFile, (off_t) (*entriesPtr)[entryIndex].offset, SEEK_SET) != 0) ||
+					((flag = fgetc(historyFile)) == EOF) ||
+					!PHG_IsADecay((LbUsFourByte) flag)) {
+				
+				isStale = true;
+				break;
+			}
+			prevOffset = (*entriesPtr)[entryIndex].offset + 1;
+		}
+		
+		okay = true;
+	} while (false);
+	
+	if (!okay || isStale) {
+		if (*entriesPtr != 0) {
+			LbMmFree((void **)entriesPtr);
+		}
+		memset(indexHdrPtr, 0, sizeof(PhoHFileDecayIndexHdrTy));
+	}
+	if (indexFile != 0) {
+		fclose(indexFile);
+	}
+	if (historyFile != 0) {
+		fclose(historyFile);
+	}
+	
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:		phoHFileGetReader
+*
+*			Summary:	Find the compressed file reader of a history file.  A new
+*						reader takes the place of one whose chunk is used up.
+*
+*			Arguments:
+*				FILE		*historyFile	- The history file.
+*				Boolean		isNew			- Create the reader if there is none.
+*
+*			Function return: The reader, 0 if none (or it could not be created).
+*
+*********************************************************************************/
+phoHFileReaderTy *phoHFileGetReader(FILE *historyFile, Boolean isNew)
+{
+	phoHFileReaderTy	*readerPtr = 0;		/* The reader */
+	phoHFileReaderTy	**newReaders;		/* Replacement for a full reader table */
+	LbUsFourByte		i;					/* Loop index */
+	
+	for (i = 0; i < phoHFileNumReaders; i++) {
+		if (phoHFileReaders[i]->histFile == historyFile)
+			return (phoHFileReaders[i]);
+	}
+	
+	do { /* Process Loop */
+	
+		if (!isNew)
+			break;
+		
+		/* Reuse an idle reader */
+		for (i = 0; i < phoHFileNumReaders; i++) {
+			if (phoHFileReaders[i]->nextEvent >= phoHFileReaders[i]->numEvents) {
+				readerPtr = phoHFileReaders[i];
+				break;
+			}
+		}
+		
+		/* Or add one */
+		if (readerPtr == 0) {
+			if ((newReaders = (phoHFileReaderTy **)
+					LbMmAlloc((phoHFileNumReaders + 1) * sizeof(phoHFileReaderTy *))) == 0) {
+				break;
+			}
+			if ((readerPtr = (phoHFileReaderTy *) LbMmAlloc(sizeof(phoHFileReaderTy))) == 0) {
+				LbMmFree((void **)&newReaders);
+				break;
+			}
+			memset(readerPtr, 0, sizeof(phoHFileReaderTy));
+			if (phoHFileReaders != 0) {
+				memcpy(newReaders, phoHFileReaders, phoHFileNumReaders * sizeof(phoHFileReaderTy *));
+				LbMmFree((void **)&phoHFileReaders);
+			}
+			phoHFileReaders = newReaders;
+			phoHFileReaders[phoHFileNumReaders++] = readerPtr;
+		}
+		
+		readerPtr->histFile = historyFile;
+		readerPtr->numEvents = 0;
+		readerPtr->nextEvent = 0;
+	} while (false);
+	
+	return (readerPtr);
+}
+
+/*********************************************************************************
+*
+*			Name:		phoHFileFreeReader
+*
+*			Summary:	Remove a compressed file reader once its file is read.
+*
+*			Arguments:
+*				phoHFileReaderTy	*readerPtr		- The reader.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phoHFileFreeReader(phoHFileReaderTy *readerPtr)
+{
+	LbUsFourByte		i;					/* Loop index */
+	
+	for (i = 0; i < phoHFileNumReaders; i++) {
+		if (phoHFileReaders[i] == readerPtr) {
+			phoHFileReaders[i] = phoHFileReaders[--phoHFileNumReaders];
+			break;
+		}
+	}
+	
+	if (readerPtr->chunkData != 0)
+		LbMmFree((void **)&readerPtr->chunkData);
+	if (readerPtr->kinds != 0)
+		LbMmFree((void **)&readerPtr->kinds);
+	if (readerPtr->decays != 0)
+		LbMmFree((void **)&readerPtr->decays);
+	if (readerPtr->photons != 0)
+		LbMmFree((void **)&readerPtr->photons);
+	if (readerPtr->values != 0)
+		LbMmFree((void **)&readerPtr->values);
+	if (readerPtr->plane != 0)
+		LbMmFree((void **)&readerPtr->plane);
+	LbMmFree((void **)&readerPtr);
+	
+	if ((phoHFileNumReaders == 0) && (phoHFileReaders != 0)) {
+		LbMmFree((void **)&phoHFileReaders);
+	}
+}
+
+/*********************************************************************************
+*
+*			Name:		phoHFileReadChunk
+*
+*			Summary:	Read and decode the next events chunk of a compressed
+*						history file, whose first byte has been read.  Index
+*						and trailer chunks are skipped.
+*
+*			Arguments:
+*				FILE				*historyFile	- The history file.
+*				phoHFileReaderTy	**readerPtr		- Receives the file's reader,
+*													  0 at the end of the events.
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean phoHFileReadChunk(FILE *historyFile, phoHFileReaderTy **readerPtr)
+{
+	Boolean				okay = false;		/* Success flag */
+	phoHFileReaderTy	*theReader = 0;		/* The file's reader */
+	phoHFileChunkHdrTy	chunkHdr;			/* The chunk header */
+	int					nextByte;			/* First byte of the next chunk */
+	
+	*readerPtr = 0;
+	
+	do { /* Process Loop */
+	
+		/* Find the next events chunk */
+		chunkHdr.magic[0] = PHOHFILE_CHUNK_MAGIC[0];
+		for (;;) {
+			if ((fread(&chunkHdr.magic[1], sizeof(phoHFileChunkHdrTy) - 1, 1, historyFile) != 1) ||
+					(memcmp(chunkHdr.magic, PHOHFILE_CHUNK_MAGIC, sizeof(chunkHdr.magic)) != 0)) {
+				ErStGeneric("Unable to read history file chunk header.");
+				goto FAIL;
+			}
+			if ((chunkHdr.kind == PHOHFILE_CHUNK_EVENTS) &&
+					((chunkHdr.numDecays != 0) || (chunkHdr.numPhotons != 0))) {
+				break;
+			}
+			
+			if (fseeko(historyFile, (off_t) chunkHdr.dataSize, SEEK_CUR) != 0) {
+				ErStGeneric("Unable to skip history file chunk.");
+				goto FAIL;
+			}
+			if ((nextByte = fgetc(historyFile)) == EOF) {
+				/* No more events; the reader has served its purpose */
+				if ((theReader = phoHFileGetReader(historyFile, false)) != 0) {
+					phoHFileFreeReader(theReader);
 				}
-				if (!switchOkay)
-					break;
+				okay = true;
+				goto FAIL;
+			}
+			if (nextByte != PHOHFILE_CHUNK_MAGIC[0]) {
+				ErStGeneric("Unable to read history file chunk header.");
+				goto FAIL;
+			}
 		}
-		/* Close the parameter file */
-		LbPfClose(&paramFileHk);
-
 		
-		/* See if we quit due to error */
-		if (!isEOF)
+		/* Make room for the chunk */
+		if ((theReader = phoHFileGetReader(historyFile, true)) == 0) {
 			break;
+		}
+		if (theReader->chunkDataSize < chunkHdr.dataSize) {
+			if (theReader->chunkData != 0)
+				LbMmFree((void **)&theReader->chunkData);
+			theReader->chunkDataSize = 0;
+			if ((theReader->chunkData = (LbUsOneByte *) LbMmAlloc(chunkHdr.dataSize)) == 0) {
+				break;
+			}
+			theReader->chunkDataSize = chunkHdr.dataSize;
+		}
 		
-		/* Verify that if we specified a maximum range value we also specified a minimum */
-		if ((customParams->xPosMax != LBDOUBLE_MAX) && (customParams->xPosMin == LBDOUBLE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum x-position range in the history parameters, but not a minimum x-position\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
+		if (fread(theReader->chunkData, 1, chunkHdr.dataSize, historyFile) != chunkHdr.dataSize) {
+			ErStGeneric("Unable to read history file chunk.");
 			break;
 		}
-		if ((customParams->yPosMax != LBDOUBLE_MAX) && (customParams->yPosMin == LBDOUBLE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum y-position range in the history parameters, but not a minimum y-position\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
-		}	
-		if ((customParams->zPosMax != LBDOUBLE_MAX) && (customParams->zPosMin == LBDOUBLE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum z-position range in the history parameters, but not a minimum z-position\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
-		}	
-		if ((customParams->xCosMax != LBDOUBLE_MAX) && (customParams->xCosMin == LBDOUBLE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum x-cosine range in the history parameters, but not a minimum x-cosine\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
-		}	
-		if ((customParams->yCosMax != LBDOUBLE_MAX) && (customParams->yCosMin == LBDOUBLE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum y-cosine range in the history parameters, but not a minimum y-cosine\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
-		}	
-		if ((customParams->zCosMax != LBDOUBLE_MAX) && (customParams->zCosMin == LBDOUBLE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum z-cosine range in the history parameters, but not a minimum z-cosine\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
+		
+		if (phoHFileDecodeChunk(theReader, &chunkHdr, theReader->chunkData) == false) {
+			break;
 		}
-		if ((customParams->objScattersMax != LBFOURBYTE_MAX) && (customParams->objScattersMin == LBFOURBYTE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum number of scatters in the object in the history parameters, but not a minimum\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
+		
+		theReader->filePos = (LbUsEightByte) ftello(historyFile);
+		*readerPtr = theReader;
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:		phoHFileDecodeChunk
+*
+*			Summary:	Decode the events of a compressed history file chunk
+*						into its reader, which then returns them from the first.
+*
+*			Arguments:
+*				phoHFileReaderTy	*readerPtr		- The reader.
+*				phoHFileChunkHdrTy	*chunkHdrPtr	- The chunk's header.
+*				LbUsOneByte			*chunkData		- The chunk following its header.
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean phoHFileDecodeChunk(phoHFileReaderTy *readerPtr, phoHFileChunkHdrTy *chunkHdrPtr,
+			LbUsOneByte *chunkData)
+{
+	Boolean				okay = false;		/* Success flag */
+	LbUsOneByte			*photonRecords;		/* The photons, as bytes */
+	LbUsFourByte		numEvents;			/* Events in the chunk */
+	LbUsFourByte		numDecays;			/* Decay flags found */
+	LbUsFourByte		dataUsed;			/* Bytes of the chunk decoded */
+	LbUsFourByte		fieldSize;			/* Bytes of a decoded column */
+	LbUsFourByte		fieldIndex;			/* Current column */
+	LbUsFourByte		i;					/* Loop index */
+	
+	readerPtr->numEvents = 0;
+	readerPtr->nextEvent = 0;
+	
+	do { /* Process Loop */
+	
+		numEvents = chunkHdrPtr->numDecays + chunkHdrPtr->numPhotons;
+		if ((numEvents > PHOHFILE_MAX_CHUNK_EVENTS) || (numEvents < chunkHdrPtr->numDecays)) {
+			ErStGeneric("History file chunk header is damaged.");
+			break;
 		}
-		if ((customParams->colScattersMax != LBFOURBYTE_MAX) && (customParams->colScattersMin == LBFOURBYTE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum number of scatters in the collimator in the history parameters, but not a minimum\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
+		
+		/* Make room for the events */
+		if (readerPtr->maxEvents < numEvents) {
+			if (readerPtr->kinds != 0)
+				LbMmFree((void **)&readerPtr->kinds);
+			if (readerPtr->decays != 0)
+				LbMmFree((void **)&readerPtr->decays);
+			if (readerPtr->photons != 0)
+				LbMmFree((void **)&readerPtr->photons);
+			if (readerPtr->values != 0)
+				LbMmFree((void **)&readerPtr->values);
+			if (readerPtr->plane != 0)
+				LbMmFree((void **)&readerPtr->plane);
+			readerPtr->maxEvents = 0;
+			if (((readerPtr->kinds = (LbUsOneByte *) LbMmAlloc(numEvents)) == 0) ||
+					((readerPtr->decays = (PHG_Decay *)
+						LbMmAlloc(numEvents * sizeof(PHG_Decay))) == 0) ||
+					((readerPtr->photons = (PHG_DetectedPhoton *)
+						LbMmAlloc(numEvents * sizeof(PHG_DetectedPhoton))) == 0) ||
+					((readerPtr->values = (LbUsEightByte *)
+						LbMmAlloc(numEvents * sizeof(LbUsEightByte))) == 0) ||
+					((readerPtr->plane = (LbUsOneByte *) LbMmAlloc(numEvents)) == 0)) {
+				break;
+			}
+			readerPtr->maxEvents = numEvents;
 		}
-		if ((customParams->energyMax != LBDOUBLE_MAX) && (customParams->energyMin == LBDOUBLE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum energy in the history parameters, but not a minimum\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
+		
+		/* Decode the event flags, and check that they agree with the counts */
+		if ((dataUsed = LbCmUnpackBytes(chunkData, chunkHdrPtr->dataSize,
+				readerPtr->kinds, numEvents)) == 0) {
+			ErStGeneric("History file chunk is damaged.");
+			break;
 		}
-		if ((customParams->travelDistanceMax != LBDOUBLE_MAX) && (customParams->travelDistanceMin == LBDOUBLE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum travel distance in the history parameters, but not a minimum\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
+		numDecays = 0;
+		for (i = 0; i < numEvents; i++) {
+			if (PHG_IsADecay((LbUsFourByte) readerPtr->kinds[i]))
+				numDecays++;
 		}
-		if ((customParams->decayXPosMax != LBDOUBLE_MAX) && (customParams->decayXPosMin == LBDOUBLE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum travel distance in the history parameters, but not a minimum\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
+		if (numDecays != chunkHdrPtr->numDecays) {
+			ErStGeneric("History file chunk is damaged.");
+			break;
 		}
-		if ((customParams->decayYPosMax != LBDOUBLE_MAX) && (customParams->decayYPosMin == LBDOUBLE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum travel distance in the history parameters, but not a minimum\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
+		
+		/* Decode the columns; the structure padding is left zero */
+		memset(readerPtr->decays, 0, chunkHdrPtr->numDecays * sizeof(PHG_Decay));
+		memset(readerPtr->photons, 0, chunkHdrPtr->numPhotons * sizeof(PHG_DetectedPhoton));
+		for (fieldIndex = 0; fieldIndex < PHOHFILE_NUM_DECAY_FIELDS; fieldIndex++) {
+			fieldSize = phoHFileUnpackField(chunkData + dataUsed,
+				chunkHdrPtr->dataSize - dataUsed, (LbUsOneByte *) readerPtr->decays,
+				sizeof(PHG_Decay), chunkHdrPtr->numDecays, phoHFileDecayFields, fieldIndex,
+				readerPtr->values, readerPtr->plane);
+			if (fieldSize == 0) {
+				ErStGeneric("History file chunk is damaged.");
+				goto FAIL;
+			}
+			dataUsed += fieldSize;
+		}
+		photonRecords = (LbUsOneByte *) readerPtr->photons;
+		for (fieldIndex = 0; fieldIndex < PHOHFILE_NUM_PHOTON_FIELDS; fieldIndex++) {
+			fieldSize = phoHFileUnpackField(chunkData + dataUsed,
+				chunkHdrPtr->dataSize - dataUsed, photonRecords,
+				sizeof(PHG_DetectedPhoton), chunkHdrPtr->numPhotons, phoHFilePhotonFields,
+				fieldIndex, readerPtr->values, readerPtr->plane);
+			if (fieldSize == 0) {
+				ErStGeneric("History file chunk is damaged.");
+				goto FAIL;
+			}
+			dataUsed += fieldSize;
 		}
-		if ((customParams->decayZPosMax != LBDOUBLE_MAX) && (customParams->decayZPosMin == LBDOUBLE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum travel distance in the history parameters, but not a minimum\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
+		
+		readerPtr->numEvents = numEvents;
+		readerPtr->nextDecay = 0;
+		readerPtr->nextPhoton = 0;
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:		phoHFileNextChunkEvent
+*
+*			Summary:	Return the next event of a decoded chunk.
+*
+*			Arguments:
+*				phoHFileReaderTy	*readerPtr		- The file's reader.
+*				PHG_Decay 			*decayPtr		- Storage for decay.
+*				PHG_DetectedPhoton	*photonPtr		- Storage for photon.
+*
+*			Function return: PhoHFileEventType corresponding to event type.
+*
+*********************************************************************************/
+PhoHFileEventType phoHFileNextChunkEvent(phoHFileReaderTy *readerPtr,
+			PHG_Decay *decayPtr, PHG_DetectedPhoton *photonPtr)
+{
+	if (PHG_IsADecay((LbUsFourByte) readerPtr->kinds[readerPtr->nextEvent++])) {
+		*decayPtr = readerPtr->decays[readerPtr->nextDecay++];
+		return (PhoHFileDecayEvent);
+	}
+	else {
+		*photonPtr = readerPtr->photons[readerPtr->nextPhoton++];
+		return (PhoHFilePhotonEvent);
+	}
+}
+
+/*********************************************************************************
+*
+*			Name:		PhoHFileReadEvent
+*
+*			Summary:	Read the next event from the history file.  Compressed
+*						files are decoded a chunk at a time.
+*
+*			Arguments:
+*				FILE				*historyFile	- The history file.
+*				PHG_Decay 			*decayPtr		- Storage for decay.
+*				PHG_DetectedPhoton	*photonPtr		- Storage for photon.
+*				(Note:  decayPtr can equal photonPtr, if desired.)
+*
+*			Function return: PhoHFileEventType corresponding to event type.
+*
+*********************************************************************************/
+PhoHFileEventType PhoHFileReadEvent(FILE *historyFile, 
+			PHG_Decay *decayPtr, PHG_DetectedPhoton *photonPtr)
+{
+	PhoHFileEventType	eventType = PhoHFileNullEvent;	/* The event we read */
+	LbUsOneByte			flag;				/* Storage for type of event to read */
+	LbUsFourByte		decaySize;			/* Size of a decay */
+	LbUsFourByte		photonSize;			/* Size of a photon */
+	phoHFileReaderTy	*readerPtr;			/* Reader of a compressed file */
+	
+	do { /* Process Loop */
+
+		/* Continue with the decoded chunk, unless the file has been moved */
+		if (phoHFileNumReaders != 0) {
+			readerPtr = phoHFileGetReader(historyFile, false);
+			if ((readerPtr != 0) && (readerPtr->nextEvent < readerPtr->numEvents) &&
+					((LbUsEightByte) ftello(historyFile) == readerPtr->filePos)) {
+				
+				eventType = phoHFileNextChunkEvent(readerPtr, decayPtr, photonPtr);
+				break;
+			}
 		}
-		if ((customParams->transaxialDistanceMax != LBDOUBLE_MAX) && (customParams->transaxialDistanceMin == LBDOUBLE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum transaxial distance in the history parameters, but not a minimum\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
+		
+		/* See what type of event we have */
+		if ((fread(&flag, sizeof(LbUsOneByte), 1, historyFile)) != 1) {
+		
+			/* See if we are not at end of file */
+			if (feof(historyFile) == 0) {
+				ErAbort("Unable to read event type.");
+			}
+			else {
+				/* We are end of file so just break */
+				break;
+			}
 		}
-		if ((customParams->aaIndexMax != LBFOURBYTE_MAX) && (customParams->aaIndexMin == LBFOURBYTE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum azimuthal angle index in the history parameters, but not a minimum\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
+		
+		/* A compressed file's chunk */
+		if (flag == (LbUsOneByte) PHOHFILE_CHUNK_MAGIC[0]) {
+			if (phoHFileReadChunk(historyFile, &readerPtr) == false) {
+				ErAbort("Unable to read compressed history file.");
+			}
+			if (readerPtr != 0) {
+				eventType = phoHFileNextChunkEvent(readerPtr, decayPtr, photonPtr);
+			}
+			break;
 		}
-		if ((customParams->axialPositionMax != LBDOUBLE_MAX) && (customParams->axialPositionMin == LBDOUBLE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum axial position in the history parameters, but not a minimum\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
+	
+		/* See if we have a decay or a photon */
+		if (PHG_IsADecay((LbUsFourByte) flag)) {
+			
+			/* Set our event type */
+			eventType = PhoHFileDecayEvent;
+			
+			/* Read the decay */
+			decaySize = sizeof(PHG_Decay);
+			
+			if ((fread(decayPtr, decaySize, 1, historyFile)) != 1) {
+				ErAbort("Unable to read decay.");
+			}
+			
 		}
-		if ((customParams->detectorXpositionMax != LBDOUBLE_MAX) && (customParams->detectorXpositionMin == LBDOUBLE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum x-position within the detector in the history parameters, but not a minimum\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
+		else if (PHG_IsAPhoton((LbUsFourByte) flag)) {
+			/* Set our event type */
+			eventType = PhoHFilePhotonEvent;
+			
+			/* Read the photon */
+			photonSize = sizeof(PHG_DetectedPhoton);
+			
+			if ((fread(photonPtr, photonSize, 1, historyFile)) != 1) {
+				ErAbort("Unable to read photon.");
+			}
+		}
+		else
+			ErAbort("Unexpected type from flag in PhoHFileReadEvent.");
+		
+	} while (false);
+	
+	return (eventType);
+}
+
+/*********************************************************************************
+*
+*			Name:		PhoHFileOpenCursor
+*
+*			Summary:	Prepare to read the events of a history file from a
+*						mapping of the file.  The events start at the file's
+*						current position, just past its header.  The chunks of
+*						a compressed file are decoded from the mapping.  A file
+*						that can't be mapped is read with PhoHFileReadEvent.
+*
+*			Arguments:
+*				FILE				*historyFile	- The history file.
+*				PhoHFileCursorTy	*cursorPtr		- The cursor.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void PhoHFileOpenCursor(FILE *historyFile, PhoHFileCursorTy *cursorPtr)
+{
+#ifdef GEN_UNIX
+	struct stat		fileInfo;		/* Size of the history file */
+	void			*mapping;		/* The mapped file */
+#endif
+	
+	memset(cursorPtr, 0, sizeof(PhoHFileCursorTy));
+	cursorPtr->historyFile = historyFile;
+	cursorPtr->position = (LbUsEightByte) ftello(historyFile);
+	
+#ifdef GEN_UNIX
+	/* Files with no events, or too large for our address space, are read */
+	if ((fstat(fileno(historyFile), &fileInfo) != 0) ||
+			((LbUsEightByte) fileInfo.st_size <= cursorPtr->position) ||
+			((LbUsEightByte) (size_t) fileInfo.st_size != (LbUsEightByte) fileInfo.st_size)) {
+		return;
+	}
+	
+	mapping = mmap(0, (size_t) fileInfo.st_size, PROT_READ, MAP_SHARED, fileno(historyFile), 0);
+	if (mapping == MAP_FAILED) {
+		return;
+	}
+	
+	/* Compressed files need somewhere to decode their chunks */
+	if (((LbUsOneByte *) mapping)[cursorPtr->position] == (LbUsOneByte) PHOHFILE_CHUNK_MAGIC[0]) {
+		if ((cursorPtr->reader = LbMmAlloc(sizeof(phoHFileReaderTy))) == 0) {
+			munmap(mapping, (size_t) fileInfo.st_size);
+			return;
 		}
-		if ((customParams->detectorYpositionMax != LBDOUBLE_MAX) && (customParams->detectorYpositionMin == LBDOUBLE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum y-position within the detector in the history parameters, but not a minimum\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
+		memset(cursorPtr->reader, 0, sizeof(phoHFileReaderTy));
+	}
+	
+	cursorPtr->mapping = (LbUsOneByte *) mapping;
+	cursorPtr->mapSize = (LbUsEightByte) fileInfo.st_size;
+	cursorPtr->rangeEnd = cursorPtr->mapSize;
+	
+	#ifdef MADV_SEQUENTIAL
+		(void) madvise(mapping, (size_t) cursorPtr->mapSize, MADV_SEQUENTIAL);
+	#endif
+	
+	/* Start the reading of the first events */
+	PhoHFileSetCursorRange(cursorPtr, cursorPtr->position, cursorPtr->rangeEnd);
+#endif
+}
+
+/*********************************************************************************
+*
+*			Name:		PhoHFileSetCursorRange
+*
+*			Summary:	Limit a mapped cursor to the events in a range of the
+*						file, starting with the first of them.  The range must
+*						start with an event, or with a chunk of a compressed
+*						file, and is usually one found by PhoHFileSplitCursor.
+*						Copies of a cursor may be given different ranges; they
+*						share the decoding of compressed chunks, so they are
+*						read one at a time.  Only the original is closed.
+*
+*			Arguments:
+*				PhoHFileCursorTy	*cursorPtr		- The cursor.
+*				LbUsEightByte		rangeStart		- File offset of the first event.
+*				LbUsEightByte		rangeEnd		- File offset past the last event.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void PhoHFileSetCursorRange(PhoHFileCursorTy *cursorPtr, LbUsEightByte rangeStart,
+		LbUsEightByte rangeEnd)
+{
+	if (cursorPtr->mapping != 0) {
+		cursorPtr->position = rangeStart;
+		cursorPtr->rangeEnd = rangeEnd;
+		
+		/* Drop any chunk decoded for another range */
+		if (cursorPtr->reader != 0) {
+			((phoHFileReaderTy *) cursorPtr->reader)->numEvents = 0;
+			((phoHFileReaderTy *) cursorPtr->reader)->nextEvent = 0;
 		}
-		if ((customParams->detectorZpositionMax != LBDOUBLE_MAX) && (customParams->detectorZpositionMin == LBDOUBLE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum z-position within the detector in the history parameters, but not a minimum\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
+		
+		cursorPtr->adviseEnd = rangeStart - (rangeStart % PHOHFILE_CURSOR_WINDOW);
+		cursorPtr->releaseEnd = cursorPtr->adviseEnd;
+		phoHFileAdviseCursor(cursorPtr);
+	}
+}
+
+/*********************************************************************************
+*
+*			Name:		PhoHFileSplitCursor
+*
+*			Summary:	Divide the events remaining in a mapped cursor into
+*						ranges of about equal size that each start with a
+*						decay, so that each range can be processed on its own.
+*						Only the event flags are examined.  A range may be
+*						empty if a single decay spans more than one range.
+*
+*			Arguments:
+*				PhoHFileCursorTy	*cursorPtr		- The cursor.
+*				LbUsFourByte		numRanges		- Number of ranges.
+*				LbUsEightByte		*boundaries		- The numRanges+1 file
+*													  offsets bounding the ranges.
+*
+*			Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean PhoHFileSplitCursor(PhoHFileCursorTy *cursorPtr, LbUsFourByte numRanges,
+			LbUsEightByte *boundaries)
+{
+	Boolean			okay = false;		/* Process flag */
+	LbUsEightByte	position;			/* File offset of the current event */
+	LbUsEightByte	rangeStart;			/* File offset of the first event */
+	LbUsEightByte	rangeBytes;			/* Bytes of events */
+	LbUsEightByte	target;				/* Offset sought for the next boundary */
+	LbUsFourByte	rangeIndex;			/* Next boundary to find */
+	LbUsOneByte		flag;				/* Type of the current event */
+	
+	do { /* Process Loop */
+		
+		if ((cursorPtr->mapping == 0) || (cursorPtr->reader != 0)) {
+			ErStGeneric("Only mapped standard history files can be divided (PhoHFileSplitCursor).");
+			break;
 		}
-		if ((customParams->numDetInteractionsMax != LBFOURBYTE_MAX) && (customParams->numDetInteractionsMin == LBFOURBYTE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum number of detector interactions in the history parameters, but not a minimum\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
-		}		
-		if ((customParams->detectorAngleMax != LBDOUBLE_MAX) && (customParams->detectorAngleMin == LBDOUBLE_MIN)) {
-			sprintf(phoHFileErrString,"You specified a maximum detector angle in the history parameters, but not a minimum\n"
-				"Your history parameter range file is named %s, please correct this to either no maximum specification\n"
-				"or a specification for both maximum and minimum", paramPath);
-			ErStGeneric(phoHFileErrString);
+		
+		rangeStart = cursorPtr->position;
+		rangeBytes = cursorPtr->rangeEnd - rangeStart;
+		
+		boundaries[0] = rangeStart;
+		rangeIndex = 1;
+		target = rangeStart + rangeBytes/numRanges;
+		
+		/* Hop from event to event, placing each boundary at the first decay
+			at or past its target
+		*/
+		position = rangeStart;
+		while ((position < cursorPtr->rangeEnd) && (rangeIndex < numRanges)) {
+			flag = cursorPtr->mapping[position];
+			
+			if (PHG_IsADecay((LbUsFourByte) flag)) {
+				while ((rangeIndex < numRanges) && (position >= target)) {
+					boundaries[rangeIndex] = position;
+					rangeIndex++;
+					target = rangeStart + (rangeBytes*rangeIndex)/numRanges;
+				}
+				position += 1 + sizeof(PHG_Decay);
+			}
+			else if (PHG_IsAPhoton((LbUsFourByte) flag)) {
+				position += 1 + sizeof(PHG_DetectedPhoton);
+			}
+			else {
+				ErStGeneric("Unexpected type from flag in PhoHFileSplitCursor.");
+				goto FAIL;
+			}
+		}
+		
+		/* Any boundaries left fall at the end */
+		while (rangeIndex <= numRanges) {
+			boundaries[rangeIndex] = cursorPtr->rangeEnd;
+			rangeIndex++;
 		}
+		
 		okay = true;
+		FAIL:;
 	} while (false);
 	
 	return (okay);
@@ -2729,44 +6515,140 @@ Boolean PhoHFileGetRunTimeParams(char *paramPath, PhoHFileRunTimeParamsTy *custo
 
 /*********************************************************************************
 *
-*			Name:			PhoHFileLookupRunTimeParamLabel
+*			Name:		PhoHFileSplitIndex
+*
+*			Summary:	Divide the events of a history file into ranges of about
+*						equal size using its decay index, or the chunk index of
+*						a compressed file, without reading the file.  Each
+*						boundary is the first indexed decay or chunk at or past
+*						its target, so a range may be empty.
 *
-*			Summary:	Find the given label in the label table and return
-*						its enumeration value.
 *			Arguments:
-*				char		*label	- The label to find.
-*			Function return: Enumerated type corresponding to label.
+*				PhoHFileDecayIndexHdrTy	*indexHdrPtr	- The index header.
+*				PhoHFileChunkEntryTy	*entries		- The index entries.
+*				LbUsFourByte			numRanges		- Number of ranges.
+*				LbUsEightByte			*boundaries		- The numRanges+1 file
+*														  offsets bounding the ranges.
+*
+*			Function return: None.
 *
 *********************************************************************************/
-PhoHFileEn_RunTimeParamsTy  PhoHFileLookupRunTimeParamLabel(char *label)	
+void PhoHFileSplitIndex(PhoHFileDecayIndexHdrTy *indexHdrPtr, PhoHFileChunkEntryTy *entries,
+			LbUsFourByte numRanges, LbUsEightByte *boundaries)
 {
-	PhoHFileEn_RunTimeParamsTy	whichParam;			/* Parameter we find */
-	LbUsFourByte			labelIndex;			/* Label we are checking */
+	LbUsEightByte	rangeBytes;			/* Bytes of events */
+	LbUsEightByte	target;				/* Offset sought for the boundary */
+	LbUsFourByte	rangeIndex;			/* Boundary being placed */
+	LbUsFourByte	entryIndex = 0;		/* Entry being considered */
+	
+	rangeBytes = indexHdrPtr->fileSize - indexHdrPtr->eventsStart;
+	
+	boundaries[0] = indexHdrPtr->eventsStart;
+	for (rangeIndex = 1; rangeIndex < numRanges; rangeIndex++) {
+		target = indexHdrPtr->eventsStart + (rangeBytes*rangeIndex)/numRanges;
+		
+		while ((entryIndex < indexHdrPtr->numEntries) && (entries[entryIndex].offset < target)) {
+			entryIndex++;
+		}
+		
+		boundaries[rangeIndex] = (entryIndex < indexHdrPtr->numEntries) ?
+			entries[entryIndex].offset : indexHdrPtr->fileSize;
+	}
+	boundaries[numRanges] = indexHdrPtr->fileSize;
+}
 
-	/* Set param to null */
-	whichParam = PhoHFileEn_NULL;
+/*********************************************************************************
+*
+*			Name:		PhoHFileCloseCursor
+*
+*			Summary:	Finish reading with a cursor.  The history file is left
+*						positioned after the last event taken from the cursor,
+*						or for a compressed file after the last chunk decoded.
+*
+*			Arguments:
+*				PhoHFileCursorTy	*cursorPtr		- The cursor.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void PhoHFileCloseCursor(PhoHFileCursorTy *cursorPtr)
+{
+#ifdef GEN_UNIX
+	if (cursorPtr->mapping != 0) {
+		(void) fseeko(cursorPtr->historyFile, (off_t) cursorPtr->position, SEEK_SET);
+		munmap(cursorPtr->mapping, (size_t) cursorPtr->mapSize);
+		cursorPtr->mapping = 0;
+		cursorPtr->mapSize = 0;
+	}
 	
-	/* Search table for given label */
-	for (labelIndex = 0; labelIndex < (PhoHFileEn_NULL); labelIndex++){
+	if (cursorPtr->reader != 0) {
+		phoHFileFreeReader((phoHFileReaderTy *) cursorPtr->reader);
+		cursorPtr->reader = 0;
+	}
+#endif
+}
+
+/*********************************************************************************
+*
+*			Name:		phoHFileAdviseCursor
+*
+*			Summary:	Ask the system to read the next window of a mapped
+*						history file ahead of the cursor, and to drop the pages
+*						more than a window behind it.  The file is read once,
+*						from start to end, so pages that have been passed are
+*						not needed again.
+*
+*			Arguments:
+*				PhoHFileCursorTy	*cursorPtr		- The cursor.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phoHFileAdviseCursor(PhoHFileCursorTy *cursorPtr)
+{
+#ifdef GEN_UNIX
+	LbUsEightByte	adviseSize;		/* Bytes in the window requested */
 	
-		/* See if it matches */
-		if (strcmp(label, PhoHFileRunTimeParamLabels[labelIndex]) == 0) {
-			whichParam = (PhoHFileEn_RunTimeParamsTy) labelIndex;
-			break;
+	/* Request the window past the one being read */
+	while ((cursorPtr->adviseEnd < cursorPtr->rangeEnd) &&
+			(cursorPtr->adviseEnd < cursorPtr->position + PHOHFILE_CURSOR_WINDOW)) {
+		
+		adviseSize = cursorPtr->rangeEnd - cursorPtr->adviseEnd;
+		if (adviseSize > PHOHFILE_CURSOR_WINDOW) {
+			adviseSize = PHOHFILE_CURSOR_WINDOW;
 		}
+		
+		#ifdef MADV_WILLNEED
+			(void) madvise(cursorPtr->mapping + cursorPtr->adviseEnd, (size_t) adviseSize,
+				MADV_WILLNEED);
+		#endif
+		cursorPtr->adviseEnd += adviseSize;
 	}
 	
-	return (whichParam);
+	/* Release the windows already read */
+	while (cursorPtr->releaseEnd + 2*PHOHFILE_CURSOR_WINDOW <= cursorPtr->position) {
+		#ifdef MADV_DONTNEED
+			(void) madvise(cursorPtr->mapping + cursorPtr->releaseEnd, PHOHFILE_CURSOR_WINDOW,
+				MADV_DONTNEED);
+		#endif
+		cursorPtr->releaseEnd += PHOHFILE_CURSOR_WINDOW;
+	}
+#else
+	if (cursorPtr) {};		/* Eliminate unused parameter compiler warning */
+#endif
 }
 
 /*********************************************************************************
 *
-*			Name:		PhoHFileReadEvent
+*			Name:		PhoHFileCursorEvent
 *
-*			Summary:	Read the next event from the history file.
+*			Summary:	Take the next event from a history file cursor.  Events
+*						of a mapped file are copied straight from memory, or
+*						from the chunk decoded from it, with no call to the
+*						system.
 *
 *			Arguments:
-*				FILE				*historyFile	- The history file.
+*				PhoHFileCursorTy	*cursorPtr		- The cursor.
 *				PHG_Decay 			*decayPtr		- Storage for decay.
 *				PHG_DetectedPhoton	*photonPtr		- Storage for photon.
 *				(Note:  decayPtr can equal photonPtr, if desired.)
@@ -2774,62 +6656,277 @@ PhoHFileEn_RunTimeParamsTy  PhoHFileLookupRunTimeParamLabel(char *label)
 *			Function return: PhoHFileEventType corresponding to event type.
 *
 *********************************************************************************/
-PhoHFileEventType PhoHFileReadEvent(FILE *historyFile, 
+PhoHFileEventType PhoHFileCursorEvent(PhoHFileCursorTy *cursorPtr, 
 			PHG_Decay *decayPtr, PHG_DetectedPhoton *photonPtr)
 {
 	PhoHFileEventType	eventType = PhoHFileNullEvent;	/* The event we read */
-	LbUsOneByte			flag;				/* Storage for type of event to read */
-	LbUsFourByte		decaySize;			/* Size of a decay */
-	LbUsFourByte		photonSize;			/* Size of a photon */
+	LbUsOneByte			flag;				/* Type of event to read */
+	LbUsOneByte			*eventPtr;			/* The event in the mapping */
 	
 	do { /* Process Loop */
-
-		/* See what type of event we have */
-		if ((fread(&flag, sizeof(LbUsOneByte), 1, historyFile)) != 1) {
 		
-			/* See if we are not at end of file */
-			if (feof(historyFile) == 0) {
-				ErAbort("Unable to read event type.");
-			}
-			else {
-				/* We are end of file so just break */
-				break;
+		/* Files that aren't mapped are read */
+		if (cursorPtr->mapping == 0) {
+			eventType = PhoHFileReadEvent(cursorPtr->historyFile, decayPtr, photonPtr);
+			break;
+		}
+		
+		/* Compressed files are taken from their decoded chunks */
+		if (cursorPtr->reader != 0) {
+			if (phoHFileCursorChunk(cursorPtr) == true) {
+				eventType = phoHFileNextChunkEvent((phoHFileReaderTy *) cursorPtr->reader,
+					decayPtr, photonPtr);
 			}
+			break;
 		}
-	
+		
+		/* See if we are at end of file, or of the cursor's range */
+		if (cursorPtr->position >= cursorPtr->rangeEnd) {
+			break;
+		}
+		
+		/* Keep the reading ahead of us */
+		if (cursorPtr->position + PHOHFILE_CURSOR_WINDOW > cursorPtr->adviseEnd) {
+			phoHFileAdviseCursor(cursorPtr);
+		}
+		
 		/* See if we have a decay or a photon */
+		eventPtr = cursorPtr->mapping + cursorPtr->position;
+		flag = *eventPtr++;
+		
 		if (PHG_IsADecay((LbUsFourByte) flag)) {
+			if (cursorPtr->position + 1 + sizeof(PHG_Decay) > cursorPtr->mapSize) {
+				ErAbort("Unable to read decay.");
+			}
 			
-			/* Set our event type */
+			/* Events aren't aligned in the file, so they are copied */
+			memcpy(decayPtr, eventPtr, sizeof(PHG_Decay));
+			cursorPtr->position += 1 + sizeof(PHG_Decay);
 			eventType = PhoHFileDecayEvent;
+		}
+		else if (PHG_IsAPhoton((LbUsFourByte) flag)) {
+			if (cursorPtr->position + 1 + sizeof(PHG_DetectedPhoton) > cursorPtr->mapSize) {
+				ErAbort("Unable to read photon.");
+			}
 			
-			/* Read the decay */
-			decaySize = sizeof(PHG_Decay);
+			memcpy(photonPtr, eventPtr, sizeof(PHG_DetectedPhoton));
+			cursorPtr->position += 1 + sizeof(PHG_DetectedPhoton);
+			eventType = PhoHFilePhotonEvent;
+		}
+		else
+			ErAbort("Unexpected type from flag in PhoHFileCursorEvent.");
+		
+	} while (false);
+	
+	return (eventType);
+}
+
+/*********************************************************************************
+*
+*			Name:		PhoHFileCursorDecay
+*
+*			Summary:	Take the next decay, with its photons, from a history
+*						file cursor.  The records are not converted:  the
+*						decay and photons of a compressed file are left where
+*						their chunk was decoded, and those of a standard file
+*						are copied out of the mapping only to align them.
+*						They remain valid until the cursor is next used.
+*
+*			Arguments:
+*				PhoHFileCursorTy	*cursorPtr		- The cursor.
+*				PHG_Decay			**decayPtr		- Receives the decay.
+*				PHG_DetectedPhoton	**photonsPtr	- Receives its photons.
+*				LbUsFourByte		*numPhotonsPtr	- Receives the number of photons.
+*
+*			Function return: PhoHFileDecayEvent, PhoHFileNullEvent at the end of
+*							the events, or PhoHFilePhotonEvent if the next event
+*							is a photon with no decay.
+*
+*********************************************************************************/
+PhoHFileEventType PhoHFileCursorDecay(PhoHFileCursorTy *cursorPtr, PHG_Decay **decayPtr,
+			PHG_DetectedPhoton **photonsPtr, LbUsFourByte *numPhotonsPtr)
+{
+	PhoHFileEventType	eventType = PhoHFileNullEvent;	/* The event we read */
+	phoHFileReaderTy	*readerPtr;			/* Decoded chunk of a compressed file */
+	LbUsOneByte			flag;				/* Type of event to read */
+	LbUsOneByte			*eventPtr;			/* The event in the mapping */
+	LbUsFourByte		numPhotons = 0;		/* Photons of the decay */
+	
+	do { /* Process Loop */
+		
+		/* Files that aren't mapped are read, one event ahead */
+		if (cursorPtr->mapping == 0) {
+			if (cursorPtr->nextEventType == PhoHFileNullEvent) {
+				cursorPtr->nextEventType = PhoHFileReadEvent(cursorPtr->historyFile,
+					&cursorPtr->decays[1], &cursorPtr->photons[0]);
+			}
 			
-			if ((fread(decayPtr, decaySize, 1, historyFile)) != 1) {
-				ErAbort("Unable to read decay.");
+			eventType = cursorPtr->nextEventType;
+			if (eventType != PhoHFileDecayEvent) {
+				break;
+			}
+			cursorPtr->decays[0] = cursorPtr->decays[1];
+			
+			while ((cursorPtr->nextEventType = PhoHFileReadEvent(cursorPtr->historyFile,
+					&cursorPtr->decays[1], &cursorPtr->photons[numPhotons])) == PhoHFilePhotonEvent) {
+				
+				if (++numPhotons == PHG_MAX_DETECTED_PHOTONS) {
+					ErAbort("Too many photons for one decay (PhoHFileCursorDecay).");
+				}
 			}
 			
+			*decayPtr = &cursorPtr->decays[0];
+			*photonsPtr = cursorPtr->photons;
+			break;
 		}
-		else if (PHG_IsAPhoton((LbUsFourByte) flag)) {
-			/* Set our event type */
+		
+		/* Compressed files are viewed where their chunks are decoded;
+			a chunk holds whole decays
+		*/
+		if (cursorPtr->reader != 0) {
+			if (phoHFileCursorChunk(cursorPtr) == false) {
+				break;
+			}
+			readerPtr = (phoHFileReaderTy *) cursorPtr->reader;
+			
+			if (!PHG_IsADecay((LbUsFourByte) readerPtr->kinds[readerPtr->nextEvent])) {
+				eventType = PhoHFilePhotonEvent;
+				break;
+			}
+			*decayPtr = &readerPtr->decays[readerPtr->nextDecay];
+			readerPtr->nextDecay++;
+			readerPtr->nextEvent++;
+			
+			*photonsPtr = &readerPtr->photons[readerPtr->nextPhoton];
+			while ((readerPtr->nextEvent < readerPtr->numEvents) &&
+					!PHG_IsADecay((LbUsFourByte) readerPtr->kinds[readerPtr->nextEvent])) {
+				
+				numPhotons++;
+				readerPtr->nextEvent++;
+			}
+			readerPtr->nextPhoton += numPhotons;
+			
+			eventType = PhoHFileDecayEvent;
+			break;
+		}
+		
+		/* See if we are at end of file, or of the cursor's range */
+		if (cursorPtr->position >= cursorPtr->rangeEnd) {
+			break;
+		}
+		
+		/* Keep the reading ahead of us */
+		if (cursorPtr->position + PHOHFILE_CURSOR_WINDOW > cursorPtr->adviseEnd) {
+			phoHFileAdviseCursor(cursorPtr);
+		}
+		
+		eventPtr = cursorPtr->mapping + cursorPtr->position;
+		if (!PHG_IsADecay((LbUsFourByte) *eventPtr)) {
 			eventType = PhoHFilePhotonEvent;
+			break;
+		}
+		if (cursorPtr->position + 1 + sizeof(PHG_Decay) > cursorPtr->mapSize) {
+			ErAbort("Unable to read decay.");
+		}
+		
+		/* Events aren't aligned in the file, so they are copied */
+		memcpy(&cursorPtr->decays[0], eventPtr + 1, sizeof(PHG_Decay));
+		cursorPtr->position += 1 + sizeof(PHG_Decay);
+		
+		/* Then the photons that follow */
+		while (cursorPtr->position < cursorPtr->rangeEnd) {
+			eventPtr = cursorPtr->mapping + cursorPtr->position;
+			flag = *eventPtr;
 			
-			/* Read the photon */
-			photonSize = sizeof(PHG_DetectedPhoton);
+			if (PHG_IsADecay((LbUsFourByte) flag)) {
+				break;
+			}
+			else if (!PHG_IsAPhoton((LbUsFourByte) flag)) {
+				ErAbort("Unexpected type from flag in PhoHFileCursorDecay.");
+			}
 			
-			if ((fread(photonPtr, photonSize, 1, historyFile)) != 1) {
+			if (cursorPtr->position + 1 + sizeof(PHG_DetectedPhoton) > cursorPtr->mapSize) {
 				ErAbort("Unable to read photon.");
 			}
+			if (numPhotons == PHG_MAX_DETECTED_PHOTONS) {
+				ErAbort("Too many photons for one decay (PhoHFileCursorDecay).");
+			}
+			
+			memcpy(&cursorPtr->photons[numPhotons], eventPtr + 1, sizeof(PHG_DetectedPhoton));
+			numPhotons++;
+			cursorPtr->position += 1 + sizeof(PHG_DetectedPhoton);
 		}
-		else
-			ErAbort("Unexpected type from flag in PhoHFileReadEvent.");
 		
+		*decayPtr = &cursorPtr->decays[0];
+		*photonsPtr = cursorPtr->photons;
+		eventType = PhoHFileDecayEvent;
 	} while (false);
 	
+	*numPhotonsPtr = numPhotons;
+	
 	return (eventType);
 }
 
+/*********************************************************************************
+*
+*			Name:		phoHFileCursorChunk
+*
+*			Summary:	Make sure a compressed file's cursor has events to
+*						take, decoding the next events chunk of its range from
+*						the mapping when the last one is used up.  Index and
+*						trailer chunks are skipped.
+*
+*			Arguments:
+*				PhoHFileCursorTy	*cursorPtr		- The cursor.
+*
+*			Function return: True if there are events, false at the end of
+*							the range.
+*
+*********************************************************************************/
+Boolean phoHFileCursorChunk(PhoHFileCursorTy *cursorPtr)
+{
+	phoHFileReaderTy	*readerPtr;			/* The decoded chunk */
+	phoHFileChunkHdrTy	chunkHdr;			/* The next chunk's header */
+	LbUsEightByte		dataStart;			/* File offset of the chunk's data */
+	
+	readerPtr = (phoHFileReaderTy *) cursorPtr->reader;
+	
+	while (readerPtr->nextEvent >= readerPtr->numEvents) {
+		
+		/* See if we are at end of file, or of the cursor's range */
+		if (cursorPtr->position >= cursorPtr->rangeEnd) {
+			return (false);
+		}
+		
+		/* Keep the reading ahead of us */
+		if (cursorPtr->position + PHOHFILE_CURSOR_WINDOW > cursorPtr->adviseEnd) {
+			phoHFileAdviseCursor(cursorPtr);
+		}
+		
+		dataStart = cursorPtr->position + sizeof(phoHFileChunkHdrTy);
+		if (dataStart > cursorPtr->mapSize) {
+			ErAbort("Unable to read history file chunk header.");
+		}
+		memcpy(&chunkHdr, cursorPtr->mapping + cursorPtr->position, sizeof(phoHFileChunkHdrTy));
+		if ((memcmp(chunkHdr.magic, PHOHFILE_CHUNK_MAGIC, sizeof(chunkHdr.magic)) != 0) ||
+				(dataStart + chunkHdr.dataSize > cursorPtr->mapSize)) {
+			ErAbort("Unable to read history file chunk header.");
+		}
+		cursorPtr->position = dataStart + chunkHdr.dataSize;
+		
+		/* Chunks are decoded straight from the mapping */
+		if ((chunkHdr.kind == PHOHFILE_CHUNK_EVENTS) &&
+				((chunkHdr.numDecays != 0) || (chunkHdr.numPhotons != 0))) {
+			
+			if (phoHFileDecodeChunk(readerPtr, &chunkHdr, cursorPtr->mapping + dataStart) == false) {
+				ErAbort("Unable to read compressed history file.");
+			}
+		}
+	}
+	
+	return (true);
+}
+
 /*********************************************************************************
 *
 *			Name:		PhoHFileOldReadEvent
@@ -129,6 +129,7 @@
 												All attempts will be made to
 												provide backward compatibility.
 												*/
+#define	PHOHFILE_INDEX_SUFFIX		".dindex"	/* Added to a history file's path to name its decay index */
 										
 /* GLOBAL TYPES */
 
@@ -206,6 +207,7 @@ typedef union {
 		double				weightSquSum;				/* Sum of weights squared in image */
 		Boolean				isTimeSorted;				/* True if history file has been timesorted */
 		Boolean				isRandomsAdded;				/* True if history file has been timesorted */
+		Boolean				isCompressed;				/* True if history file is in compressed chunks */
 	} H;
 	char Buffer[8192];
 } PhoHFileHdrTy;
@@ -407,13 +409,92 @@ typedef struct {
 	LbUsEightByte				pinksAccepted;			/* Pinks accepted */
 	FILE						*histFile;				/* The history file */
 	LbHdrHkTy					headerHk;				/* Hook to the file header */
+	char						histFilePath[PATH_LENGTH];	/* Path of the history file */
+	FILE						*mainHistFile;			/* The history file while writing a part file */
+	LbUsOneByte					*recordBuffer;			/* Records waiting to be written */
+	LbUsFourByte				recordBufferSize;		/* Size of the record buffer */
+	LbUsFourByte				recordBufferUsed;		/* Bytes of records in the buffer */
+	void						*writer;				/* Thread writing full record buffers, if running */
+	Boolean						isCompressed;			/* Write compressed chunks? */
+	void						*packer;				/* Compressed writing state, if any */
+	void						*indexer;				/* Decay index built as records are written, if any */
+	void						*sorter;				/* Time order writing state, if sorting */
 } PhoHFileHkTy;
 
+/* An entry of a compressed history file's chunk index.  Seeking to offset
+	and calling PhoHFileReadEvent reads from the chunk's first decay on.
+	The decay index of a standard history file has the same entries, each
+	covering a run of decays that starts at a multiple of the index interval.
+*/
+typedef struct {
+	LbUsEightByte		offset;				/* File offset of the chunk */
+	LbUsEightByte		firstDecay;			/* Number of decays before the chunk */
+	double				firstDecayTime;		/* Time of the chunk's first decay */
+	LbUsFourByte		numDecays;			/* Decays in the chunk */
+	LbUsFourByte		numPhotons;			/* Photons in the chunk */
+} PhoHFileChunkEntryTy;
+
+/*	The decay index of a standard history file is kept in a separate file,
+	named by adding PHOHFILE_INDEX_SUFFIX to the history file's path.  It is
+	this header followed by the entries.  An index is only used while the
+	history file still has the size and modification time it had when it was
+	indexed, and while each entry's offset still holds a decay.
+*/
+typedef struct {
+	char				magic[4];			/* Identifies a decay index */
+	LbUsFourByte		version;			/* Version of the index format */
+	LbUsFourByte		interval;			/* Decays per entry */
+	LbUsFourByte		numEntries;			/* Entries following the header */
+	LbUsEightByte		eventsStart;		/* File offset of the first event */
+	LbUsEightByte		fileSize;			/* Size of the history file indexed */
+	LbUsEightByte		fileTime;			/* Its modification time */
+	LbUsEightByte		numDecays;			/* Decays in the history file */
+	LbUsEightByte		numPhotons;			/* Photons in the history file */
+} PhoHFileDecayIndexHdrTy;
+
+/*	A history file being read through a mapping of the file, so that events are
+	taken from memory rather than read one at a time.  The chunks of a compressed
+	file are decoded from the mapping, a chunk at a time.  Files that can't be
+	mapped are read with PhoHFileReadEvent instead.
+*/
+typedef struct {
+	FILE				*historyFile;		/* The history file */
+	LbUsOneByte			*mapping;			/* The mapped file, 0 if not mapped */
+	LbUsEightByte		mapSize;			/* Bytes mapped */
+	LbUsEightByte		position;			/* File offset of the next event, or chunk */
+	LbUsEightByte		rangeEnd;			/* File offset where the events end */
+	LbUsEightByte		adviseEnd;			/* End of the bytes requested ahead */
+	LbUsEightByte		releaseEnd;			/* End of the bytes released behind */
+	void				*reader;			/* Decoded chunk of a compressed file, else 0 */
+	PhoHFileEventType	nextEventType;		/* Event read ahead from a file that isn't mapped */
+	PHG_Decay			decays[2];			/* The decay viewed, and the one read ahead */
+	PHG_DetectedPhoton	photons[PHG_MAX_DETECTED_PHOTONS];	/* The photons viewed */
+} PhoHFileCursorTy;
+
 
 /* PROTOTYPES */
 Boolean	PhoHFileClose(PhoHFileHkTy *hdrHkTyPtr);
+void	PhoHFileCloseCursor(PhoHFileCursorTy *cursorPtr);
+Boolean	PhoHFileAppendPart(PhoHFileHkTy *hdrHkTyPtr, char *partPath);
+Boolean	PhoHFileClosePart(PhoHFileHkTy *hdrHkTyPtr);
+Boolean	PhoHFileOpenPart(PhoHFileHkTy *hdrHkTyPtr, char *partPath);
 Boolean PhoHFileCreate(char *histFilePath, char *histParamsFilePath, PhoHFileHdrKindTy hdrType,
 			PhoHFileHkTy *hdrHkTyPtr);	
+Boolean	PhoHFileEndIndex(PhoHFileHkTy *hdrHkTyPtr);
+Boolean	PhoHFileEndWrites(PhoHFileHkTy *hdrHkTyPtr);
+Boolean	PhoHFileFlush(PhoHFileHkTy *hdrHkTyPtr);
+Boolean	PhoHFileIndexDecays(char *histFilePath, LbUsFourByte interval);
+void	PhoHFileOpenCursor(FILE *historyFile, PhoHFileCursorTy *cursorPtr);
+void	PhoHFileSetCursorRange(PhoHFileCursorTy *cursorPtr, LbUsEightByte rangeStart,
+			LbUsEightByte rangeEnd);
+Boolean	PhoHFileSplitCursor(PhoHFileCursorTy *cursorPtr, LbUsFourByte numRanges,
+			LbUsEightByte *boundaries);
+void	PhoHFileSplitIndex(PhoHFileDecayIndexHdrTy *indexHdrPtr, PhoHFileChunkEntryTy *entries,
+			LbUsFourByte numRanges, LbUsEightByte *boundaries);
+Boolean	PhoHFileSetCompressed(PhoHFileHkTy *hdrHkTyPtr, Boolean isCompressed);
+Boolean	PhoHFileSetIndexed(PhoHFileHkTy *hdrHkTyPtr, LbUsFourByte interval);
+Boolean	PhoHFileSetIndexedLike(PhoHFileHkTy *hdrHkTyPtr, char *fromFilePath);
+Boolean	PhoHFileSetSorted(PhoHFileHkTy *hdrHkTyPtr, LbUsFourByte bufferMBytes);
 Boolean PhoHFileWriteDetections(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay,
 			PHG_TrackingPhoton *bluePhotons, LbUsFourByte numBluePhotons,
 			PHG_TrackingPhoton *pinkPhotons, LbUsFourByte numPinkPhotons);
@@ -428,8 +509,17 @@ Boolean PhoHFileReadFields(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay,
 			PHG_TrackingPhoton *photon, Boolean *photonAccepted);
 void	PhoHFilePrintFields(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay,
 			PHG_TrackingPhoton *photon);
+void	PhoHFileReadAhead(FILE *historyFile);
+Boolean	PhoHFileReadChunkIndex(FILE *historyFile, PhoHFileChunkEntryTy **entriesPtr,
+			LbUsFourByte *numEntriesPtr);
+Boolean	PhoHFileReadDecayIndex(char *histFilePath, PhoHFileDecayIndexHdrTy *indexHdrPtr,
+			PhoHFileChunkEntryTy **entriesPtr);
 PhoHFileEventType PhoHFileReadEvent(FILE *historyFile, 
 			PHG_Decay *decayPtr, PHG_DetectedPhoton *photonPtr);
+PhoHFileEventType PhoHFileCursorEvent(PhoHFileCursorTy *cursorPtr, 
+			PHG_Decay *decayPtr, PHG_DetectedPhoton *photonPtr);
+PhoHFileEventType PhoHFileCursorDecay(PhoHFileCursorTy *cursorPtr, PHG_Decay **decayPtr,
+			PHG_DetectedPhoton **photonsPtr, LbUsFourByte *numPhotonsPtr);
 PhoHFileEventType PhoHFileOldReadEvent(FILE *historyFile, 
 			PHG_OldDecay *oldDecayPtr, PHG_DetectedPhoton *photonPtr, Boolean isOldPhotons1, Boolean isOldPhotons2 );
 
@@ -92,6 +92,7 @@
 #include "PhoHStat.h"
 #include "phg.h"
 #include "PhgBin.h"
+#include "PhgParallel.h"
 
 #define MAX_ENERGY_BINS   200 	/* Maximum number of energy bins */
 #define ENERGY_BIN_SIZE    10 	/* Size of energy bins (in energy units) */
@@ -533,6 +534,39 @@ void PhoHStatInitPhgStatistics()
 		
 	}
 	
+	/* Register the statistics with the worker processes */
+	PhgParRegisterSum(&PhoHStat_CurStats.total_started_photons, PhgParEn_EightByte, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.total_started_prim_photons, PhgParEn_EightByte, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.total_started_prim_only_photons, PhgParEn_EightByte, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.total_prim_only_that_scattered, PhgParEn_EightByte, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.total_started_scat_photons, PhgParEn_EightByte, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.total_low_energy_photons, PhgParEn_EightByte, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.total_absorbed_photons, PhgParEn_EightByte, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.total_split_photons, PhgParEn_EightByte, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.total_split_attempts, PhgParEn_EightByte, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.total_rouletted_photons, PhgParEn_EightByte, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.total_roulette_attempts, PhgParEn_EightByte, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.number_forced_detection_attempts, PhgParEn_EightByte, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.number_forced_detection_hits, PhgParEn_EightByte, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.total_escaped_photons, PhgParEn_EightByte, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.total_detected_photons, PhgParEn_EightByte, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.invalid_photon_decay_locations, PhgParEn_EightByte, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.total_scat_photon_starting_weight, PhgParEn_Double, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.total_prim_photon_starting_weight, PhgParEn_Double, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.total_absorbed_photons_weight, PhgParEn_Double, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.forced_detection_attempt_weight, PhgParEn_Double, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.forced_detection_hits_weight, PhgParEn_Double, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.total_detected_photon_scatter_weight, PhgParEn_Double, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.total_detected_photon_primary_weight, PhgParEn_Double, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.detected_photon_scatter_weight_squ, PhgParEn_Double, 1);
+	PhgParRegisterSum(&PhoHStat_CurStats.detected_photon_primary_weight_squ, PhgParEn_Double, 1);
+	PhgParRegisterSum(PhoHStat_CurStats.detected_photon_energy_histogram, PhgParEn_EightByte, MAX_ENERGY_BINS);
+	PhgParRegisterSum(PhoHStat_CurStats.detected_photon_number_of_scatters, PhgParEn_EightByte, MAX_SCATTER_BINS);
+	PhgParRegisterSum(PhoHStat_CurStats.detected_photon_weight_by_energy, PhgParEn_Double, MAX_ENERGY_BINS);
+	PhgParRegisterSum(PhoHStat_CurStats.detected_weight_squ_by_energy, PhgParEn_Double, MAX_ENERGY_BINS);
+	PhgParRegisterSum(PhoHStat_CurStats.detected_photon_weight_by_scatters, PhgParEn_Double, MAX_SCATTER_BINS);
+	PhgParRegisterSum(PhoHStat_CurStats.detected_weight_squ_by_scatters, PhgParEn_Double, MAX_SCATTER_BINS);
+	
 	/* Attempt to create the file just to verify it can be done */
 	if (PhgRunTimeParams.PhgPhoHStatFilePath[0] != '\0') {
 		if ((statFile_ptr = LbFlFileOpen(PhgRunTimeParams.PhgPhoHStatFilePath,"w")) == (FILE *) NULL) {
@@ -28,6 +28,7 @@
 *				PhoTrkAttemptForcedDetection
 *				PhoTrkAttInitForcedDetection
 *				PhoTrkCalcNewPosition
+*				PhoTrkClearAttCache
 *				PhoTrkInitialize
 *				PhoTrkTerminate
 *				PhoTrkUpdatePhotonPosition
@@ -68,6 +69,7 @@
 #include "LbParamFile.h"
 #include "LbInterface.h"
 #include "LbHeader.h"
+#include "LbTiming.h"
 
 #include "Photon.h"
 #include "PhgParams.h"
@@ -87,10 +89,19 @@
 #include "PhoHFile.h"
 #include "phg.h"
 #include "PhgBin.h"
+#include "PhgParallel.h"
 
 /* LOCAL CONSTANTS */
 #define MAX_INDEX	256		/* Maximum voxel index (temporary) */
 #define PHOTRK_MAX_CELLS	(MAX_INDEX * 2 * 6)
+#define PHOTRK_SURFACE_GUARD	0.000001	/* Moves shorter than the surface by this can't be "equal" to it (tolerance is 1e-7) */
+#define PHOTRK_ATT_CACHE_BITS		18		/* Log 2 of the number of primary attenuation cache entries */
+#define PHOTRK_ATT_CACHE_SIZE		(1UL << PHOTRK_ATT_CACHE_BITS)
+#define PHOTRK_ATT_CACHE_MAX_INDEX	4096	/* Energy bins and voxel indexes must be below this to be cached */
+#define PHOTRK_ATT_CACHE_COS_BINS	64		/* Direction z cosine bins of a cache key */
+#define PHOTRK_ATT_CACHE_AZ_BINS	128		/* Direction azimuth bins of a cache key */
+#define PHOTRK_ATT_CACHE_SAMPLES	4		/* Traced attenuations that must agree before an entry is used */
+#define PHOTRK_ATT_CACHE_REJECTED	0xFFFFFFFF	/* numTraced of an entry whose attenuations disagreed */
 
 /* LOCAL TYPES */
 typedef struct {
@@ -100,8 +111,42 @@ typedef struct {
 	LbFourByte	xIndex;			/* X index of voxel represented by this cell */
 	LbFourByte	yIndex;			/* Y index of voxel represented by this cell */
 	LbFourByte	sliceIndex;		/* Z index of voxel represented by this cell */
+	double		cumDistance;	/* Distance traveled through this and all previous cells */
+	double		cumFreePaths;	/* Free paths used through this and all previous cells */
 } phoTrkCellInfoTy;
 
+/* Values of the FD scatter table that depend only on the incoming ray, shared by
+	all the forced detection attempts made for it */
+typedef struct {
+	double			incomingEnergy;		/* Incoming energy in units of electron mass */
+	double			incomingAzimuth;	/* Incoming azimuth angle */
+	double			totKNCrossSection;	/* Klein Nishina cross section for the incoming energy */
+	double			fdFactor;			/* Product of phi_out & w_out bin size */
+	LbUsFourByte	inEnIndex;			/* Incoming energy FD Table index */
+	LbUsFourByte	inZCosIndex;		/* Incoming z cosine FD Table index */
+} phoTrkFDRayTy;
+
+/* An entry of the primary attenuation cache: the free paths out of the object
+	for photons of one energy bin leaving one voxel in one direction bin */
+typedef struct {
+	LbUsEightByte	key;			/* Energy, voxel and direction bins of the entry */
+	double			freePaths;		/* Sum of the traced free paths, their mean once trusted */
+	double			minFreePaths;	/* Fewest free paths traced */
+	double			maxFreePaths;	/* Most free paths traced */
+	LbUsFourByte	generation;		/* Cache generation the entry was made in */
+	LbUsFourByte	numTraced;		/* Number of free paths traced, or PHOTRK_ATT_CACHE_REJECTED */
+} phoTrkAttCacheEntryTy;
+
+/* The timed components of forced detection */
+typedef enum {
+	phoTrkFDRay,			/* Critical zone intersection, free paths and ray values */
+	phoTrkFDInteraction,	/* Picking the interaction point */
+	phoTrkFDAngle,			/* Picking the scatter angle */
+	phoTrkFDExit,			/* Tracking out of the object */
+	phoTrkFDRecord,			/* Recording the detection */
+	phoTrkFDNumParts
+} phoTrkFDPartTy;
+
 /* LOCAL GLOBALS */
 Boolean						phoTrkIsInitialized = false;			/* Initialization flag */
 char						phoTrkErrString[1024];					/* Handy error string */
@@ -124,6 +169,18 @@ double						phoTrkFocalLength;						/* Used for cone beam FD */
 double						phoTrkCollimatorZMin;					/* Used for cone beam FD */
 double						phoTrkCollimatorZMax;					/* Used for cone beam FD */
 
+phoTrkAttCacheEntryTy		*phoTrkAttCache = 0;					/* Primary attenuation cache, 0 when not in use */
+LbUsFourByte				phoTrkAttCacheGeneration;				/* Entries of older generations are empty */
+LbUsEightByte				phoTrkAttCacheLookups;					/* Attenuations asked of the cache */
+LbUsEightByte				phoTrkAttCacheHits;						/* Attenuations the cache answered without tracing */
+LbUsEightByte				phoTrkAttCacheReplaced;					/* Entries replaced by another key */
+LbUsEightByte				phoTrkAttCacheRejected;					/* Entries whose traced attenuations disagreed */
+
+Boolean						phoTrkTimeFD = false;					/* Time the components of FD? */
+LbTmTimingType				phoTrkFDTimer;							/* Timer for the current FD component */
+double						phoTrkFDRealTime[phoTrkFDNumParts];		/* Real time of each FD component */
+double						phoTrkFDCPUTime[phoTrkFDNumParts];		/* CPU time of each FD component */
+
 
 /* LOCAL MACROS */
 /*********************************************************************************
@@ -143,6 +200,54 @@ double						phoTrkCollimatorZMax;					/* Used for cone beam FD */
 #define	PHOTRKGetMinDeltaT(dtx, dty, dtz) ((((dtx) <= (dty)) && ((dtx) <= (dtz))) ? (dtx) : \
  (((dty) <= (dtx)) && ((dty) <= (dtz))) ? (dty) : (dtz))
 
+/*********************************************************************************
+*
+*			Name:		PHOTRKGetCellsDistance
+*
+*			Summary:	Return the distance traveled through the cells before
+*						the given cell of the cell list.
+*
+*			Arguments:
+*				cellIndex	- Index of the cell.
+*
+*			Function return: Distance before the cell.
+*
+*********************************************************************************/
+#define	PHOTRKGetCellsDistance(cellIndex) (((cellIndex) == 0) ? 0.0 : \
+ phoTrkCellInfoTable[(cellIndex)-1].cumDistance)
+
+/*********************************************************************************
+*
+*			Name:		PHOTRKGetCellsFreePaths
+*
+*			Summary:	Return the free paths used in the cells before
+*						the given cell of the cell list.
+*
+*			Arguments:
+*				cellIndex	- Index of the cell.
+*
+*			Function return: Free paths before the cell.
+*
+*********************************************************************************/
+#define	PHOTRKGetCellsFreePaths(cellIndex) (((cellIndex) == 0) ? 0.0 : \
+ phoTrkCellInfoTable[(cellIndex)-1].cumFreePaths)
+
+/*********************************************************************************
+*
+*			Name:		PHOTRKTimeFD
+*
+*			Summary:	Charge the time since the last call to a component of
+*						forced detection, when timing was requested with the
+*						PHGDEBUG_TimeForcedDetection debug option.
+*
+*			Arguments:
+*				part	- The component.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+#define	PHOTRKTimeFD(part) { if (phoTrkTimeFD) phoTrkTimeFDPart(part); }
+
 /* LOCAL PROTOTYPES */
 void			phoTrkCalcFreePaths(PHG_TrackingPhoton *trackingPhotonPtr,
 					PHG_Position *startingPosPtr,
@@ -151,7 +256,10 @@ void			phoTrkCalcFreePaths(PHG_TrackingPhoton *trackingPhotonPtr,
 					double photonEnergy,
 					double *freePathsPtr);
 Boolean			phoTrkCalcScatterAngleSPECT(PHG_TrackingPhoton	*trackingPhotonPtr);
-Boolean			phoTrkCalcScatterAnglePET(PHG_TrackingPhoton	*trackingPhotonPtr);
+Boolean			phoTrkCalcScatterAnglePET(PHG_TrackingPhoton	*trackingPhotonPtr,
+					phoTrkFDRayTy *rayPtr);
+void			phoTrkSetFDRay(PHG_TrackingPhoton *trackingPhotonPtr, phoTrkFDRayTy *rayPtr);
+LbUsFourByte	phoTrkFindCell(double limit, Boolean byFreePaths, Boolean orEqual);
 Boolean				phoTrkCalcAcceptanceRange(PHG_TrackingPhoton	*trackingPhotonPtr,
 					double *minSinePtr, double *maxSinePtr);
 void 			phoTrkCalcAzimuthToDir(double inclination, double azimuth,
@@ -170,6 +278,14 @@ double			phoTrkCalcCBFDOmega(double deltaRphi, double phoTrkRadiusOfFocalCircle,
 					double radialPos, double zPos);		
 Boolean			phoTrkPositionIsAcceptable(PHG_TrackingPhoton	*photonPtr,
 					double *minSinePtr, double *maxSinePtr);
+PhoTrkActionTy	phoTrkWoodcockNewPosition(PHG_TrackingPhoton *trackingPhotonPtr,
+					PHG_Position *startingPosPtr, PHG_Direction *directionPtr,
+					double photonEnergy, double freePath_Length, double distToObjectSurface,
+					PHG_Position *newPosition, double *distTraveled, double *freePathsUsed);
+Boolean			phoTrkLocateVoxel(PHG_Position *positionPtr, PHG_TrackingPhoton *trackingPhotonPtr);
+void			phoTrkCalcExitFreePaths(PHG_TrackingPhoton *trackingPhotonPtr, double *freePathsPtr);
+void			phoTrkLookupAttCache(PHG_TrackingPhoton *trackingPhotonPtr, double *freePathsPtr);
+void			phoTrkTimeFDPart(phoTrkFDPartTy part);
 
 /* Functions */
 /*********************************************************************************
@@ -263,18 +379,19 @@ phtrkEn_ActionTy PhoTrkDecidePhotonAction(LbUsFourByte material, double photonEn
 															prob of scatter */
 	double				interactionProbability;			/* Interaction-type probability */
 	double				comptonScatterProb;				/* Probability of a Compton scatter */
+	SubObjInteractionTy	*interactionPtr;				/* Interaction values of the material */
 	
 	
 	/* Look up the fixed probabilities that define the type of interaction; 
 		note that these vary whether coherent scatter is being modeled or not */
 	
+	interactionPtr = SubObjGetInteraction(material, photonEnergy, modelingCohScatter);
+	
 	/* Get probability of any scatter */
-	scatterProbability = 
-		SubObjGetProbScatter(material, photonEnergy, modelingCohScatter);
+	scatterProbability = interactionPtr->probScatter;
 	
 	/* Get conditional probability of a Compton scatter */
-	comptonToScatterProbability = 
-		SubObjGetProbComptonCondnl(material, photonEnergy, modelingCohScatter);
+	comptonToScatterProbability = interactionPtr->probComptonToScatter;
 	
 	
 	/* Get the random probability that determines the type of interaction */
@@ -336,7 +453,6 @@ phtrkEn_ActionTy PhoTrkDecidePhotonAction(LbUsFourByte material, double photonEn
 void PhoTrkAttInitForcedDetection(PHG_TrackingPhoton *trackingPhotonPtr)
 {
 	Boolean			photonDetected;		/* Did we detect the photon */
-	double			distToObject;		/* Distance to object cylinder */
 	double			distToTarget;		/* Distance to target cylinder */
 	double			freePaths;			/* Free paths necessary to exit */
 	PHG_Position	posOnTarCylinder;	/* Projected position on target cylinder */
@@ -367,17 +483,17 @@ void PhoTrkAttInitForcedDetection(PHG_TrackingPhoton *trackingPhotonPtr)
 			break;
 		}
 		
-		/* Compute the distance to the object cylinder */
-		CylPosCalcDistanceToObjectSurface(&(trackingPhotonPtr->location),
-			&(trackingPhotonPtr->angle), &distToObject);
-			
 		/*	Compute attenuation (free paths) through object
-			NOTE: phoTrkCalcFreePaths routine sets the local global 
-			"phoTrkCellsInUse" for later use.
+			NOTE: tracing the free paths sets the local global 
+			"phoTrkCellsInUse" for later use; it stays clear when
+			the attenuation cache answers.
 		*/
-		phoTrkCalcFreePaths(trackingPhotonPtr, &(trackingPhotonPtr->location),
-			distToObject, trackingPhotonPtr->angle,
-			trackingPhotonPtr->energy, &freePaths);
+		if (phoTrkAttCache != 0) {
+			phoTrkLookupAttCache(trackingPhotonPtr, &freePaths);
+		}
+		else {
+			phoTrkCalcExitFreePaths(trackingPhotonPtr, &freePaths);
+		}
 		
 		/* Adjust the photon's weight */
 		trackingPhotonPtr->photon_primary_weight *=  exp(-freePaths);
@@ -419,6 +535,26 @@ void PhoTrkAttInitForcedDetection(PHG_TrackingPhoton *trackingPhotonPtr)
 }
 
 
+/*********************************************************************************
+*
+*			Name:		PhoTrkClearAttCache
+*
+*			Summary:	Empty the primary attenuation cache, so that the
+*						following decays are tracked as if it were new.
+*			Arguments:
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void PhoTrkClearAttCache()
+{
+	/* Entries made before the new generation are taken as empty */
+	if (phoTrkAttCache != 0) {
+		phoTrkAttCacheGeneration++;
+	}
+}
+
+
 /*********************************************************************************
  *
  *			Name:		PhoTrkAttemptForcedDetection
@@ -457,7 +593,13 @@ void PhoTrkAttemptForcedDetection(PHG_TrackingPhoton *trackingPhotonPtr)
 	LbUsFourByte		wholeNum;				/* Whole number temp variable */
 	LbUsFourByte		cellIndex;				/* Current cell for tracking */
 	LbUsFourByte		cellsInUseCopy;			/* Storage for a copy of this local global */
+	Boolean				angleFound;				/* Was a detectable scatter angle found */
+	phoTrkFDRayTy		fdRay;					/* FD table values for the incoming ray */
 	PHG_TrackingPhoton	incomingPhoton;			/* Storage for restoring photon */
+	
+	if (phoTrkTimeFD) {
+		LbTmStartTiming(&phoTrkFDTimer);
+	}
 						
 	do { /* Process Loop */
 		
@@ -535,6 +677,12 @@ void PhoTrkAttemptForcedDetection(PHG_TrackingPhoton *trackingPhotonPtr)
 				break;
 		}
 		
+		/* Look up the FD table values for the incoming ray once for all attempts */
+		if (!PHOTRKIsConeBeamForcedDetection()) {
+			phoTrkSetFDRay(trackingPhotonPtr, &fdRay);
+		}
+		PHOTRKTimeFD(phoTrkFDRay);
+		
 		/*	Adjust photon weight by probability that it will interact 
 			in the critical zone
 		*/
@@ -599,37 +747,22 @@ void PhoTrkAttemptForcedDetection(PHG_TrackingPhoton *trackingPhotonPtr)
 			    	freePathsToTravel = freePathsToEnter +
 						fpToMoveCoeff;
 				
-					/* Clear looping variables */
-					distanceTraveled  = 0;
-					freePathsToInteraction = 0;
-				
-					/* Loop through cell table until freePathsToTravel have been used up */
-					for (cellIndex = 0; cellIndex < phoTrkCellsInUse; cellIndex++) {
+					/* Find the cell where the free paths travelled so far + the free
+						paths in the cell reach the selected free paths to interact,
+						and force the interaction in this cell
+					*/
+					cellIndex = phoTrkFindCell(freePathsToTravel, true, true);
+					distanceTraveled = PHOTRKGetCellsDistance(cellIndex);
+					freePathsToInteraction = PHOTRKGetCellsFreePaths(cellIndex);
 					
-						/* If the free paths travelled so far + the free paths in this cell
-							are greater than the selected free paths to interact, force the
-							interaction in this cell
-						*/ 
-						 if ((freePathsToInteraction + phoTrkCellInfoTable[cellIndex].freePaths)
-								>= freePathsToTravel) {
+					if (cellIndex < phoTrkCellsInUse) {
 								
-							/* Only use necessary amount of cell */
-							distanceTraveled += (freePathsToTravel - freePathsToInteraction)/
-								phoTrkCellInfoTable[cellIndex].attenuation;
-								
-							/* Set free paths used */
-							freePathsToInteraction = freePathsToTravel;
-				
-							/* We are done */
-							break;
-								
-						}
-						else {
-						
-							/* Accumulate the distance traveled plus the free paths of this cell */
-							distanceTraveled += phoTrkCellInfoTable[cellIndex].distance;
-							freePathsToInteraction += phoTrkCellInfoTable[cellIndex].freePaths;
-						}
+						/* Only use necessary amount of cell */
+						distanceTraveled += (freePathsToTravel - freePathsToInteraction)/
+							phoTrkCellInfoTable[cellIndex].attenuation;
+							
+						/* Set free paths used */
+						freePathsToInteraction = freePathsToTravel;
 					}
 					
 					/* Verify we did not fall out of the above loop without accumulating the
@@ -666,6 +799,7 @@ void PhoTrkAttemptForcedDetection(PHG_TrackingPhoton *trackingPhotonPtr)
                 /* Adjust the weight for probability of compton scatter */
                 trackingPhotonPtr->photon_scatter_weight *=
                     SubObjGetProbScatterInObj(trackingPhotonPtr);
+				PHOTRKTimeFD(phoTrkFDInteraction);
 				
 			    /* Try to update photon with scatter angle that assures 
 				   detection.
@@ -673,14 +807,15 @@ void PhoTrkAttemptForcedDetection(PHG_TrackingPhoton *trackingPhotonPtr)
 				   If no detectable angle exits, break.
 				*/
 			    if (PHOTRKIsConeBeamForcedDetection()) {
-			    	if (phoTrkCalcScatterAngleSPECT(trackingPhotonPtr) == false) {
-			        	break;
-			    	}
+			    	angleFound = phoTrkCalcScatterAngleSPECT(trackingPhotonPtr);
 			    }
 			    else {
-			    	if (phoTrkCalcScatterAnglePET(trackingPhotonPtr) == false) {
-			        	break;
-			    	}
+			    	angleFound = phoTrkCalcScatterAnglePET(trackingPhotonPtr, &fdRay);
+			    }
+				PHOTRKTimeFD(phoTrkFDAngle);
+				
+			    if (angleFound == false) {
+			        break;
 			    }
 			    
 					
@@ -711,6 +846,7 @@ void PhoTrkAttemptForcedDetection(PHG_TrackingPhoton *trackingPhotonPtr)
 						
 					/* Restore cells in use from copy */
 					phoTrkCellsInUse = cellsInUseCopy;
+					PHOTRKTimeFD(phoTrkFDExit);
 			    }
 				
 			    /* If we missed the target, get out of here */
@@ -748,6 +884,7 @@ void PhoTrkAttemptForcedDetection(PHG_TrackingPhoton *trackingPhotonPtr)
 					   	trackingPhotonPtr->decay_weight *
 						trackingPhotonPtr->photon_scatter_weight);
 				}
+				PHOTRKTimeFD(phoTrkFDRecord);
 			}
 
 			/* Restore the incoming photon */
@@ -1095,6 +1232,15 @@ void	phoTrkCalcFreePaths(PHG_TrackingPhoton	*trackingPhotonPtr,
 	
 			phoTrkCellInfoTable[phoTrkCellsInUse].sliceIndex = 
 				trackingPhotonPtr->sliceIndex;
+				
+			/* Running totals let later searches of the list skip the summing */
+			phoTrkCellInfoTable[phoTrkCellsInUse].cumDistance = 
+				PHOTRKGetCellsDistance(phoTrkCellsInUse) +
+				phoTrkCellInfoTable[phoTrkCellsInUse].distance;
+				
+			phoTrkCellInfoTable[phoTrkCellsInUse].cumFreePaths = 
+				PHOTRKGetCellsFreePaths(phoTrkCellsInUse) +
+				phoTrkCellInfoTable[phoTrkCellsInUse].freePaths;
 		}
 		
 		/* Add up our free paths */
@@ -1438,28 +1584,17 @@ void phoTrkCalcCritZoneFreePaths(PHG_TrackingPhoton	*trackingPhotonPtr,
 		/* If we have a voxel (cell) list, then compute free paths from it */
 		if (phoTrkCellsInUse != 0) {
 			
-			distanceTraveled = 0;
-			*freePathsToExitPtr = 0;
+			/* Find the cell the photon exits the zone in */
+			cellIndex = phoTrkFindCell(intersectionPtr->distToExit, false, false);
+			distanceTraveled = PHOTRKGetCellsDistance(cellIndex);
+			*freePathsToExitPtr = PHOTRKGetCellsFreePaths(cellIndex);
 			
-			/* Loop through cell table until freePathsToTravel have been used up */
-			for (cellIndex = 0; cellIndex < phoTrkCellsInUse; cellIndex++) {
-				 if ((distanceTraveled + phoTrkCellInfoTable[cellIndex].distance)
-						> intersectionPtr->distToExit) {
-						
-					/* Add freepaths used within this cell */
-					*freePathsToExitPtr += 
-						((intersectionPtr->distToExit -
-						distanceTraveled) *
-						phoTrkCellInfoTable[cellIndex].attenuation);
-
-					/* We are done */
-					break;
-					
-				}
-				else {
-					distanceTraveled += phoTrkCellInfoTable[cellIndex].distance;
-					*freePathsToExitPtr += phoTrkCellInfoTable[cellIndex].freePaths;
-				}
+			/* Add freepaths used within this cell */
+			if (cellIndex < phoTrkCellsInUse) {
+				*freePathsToExitPtr += 
+					((intersectionPtr->distToExit -
+					distanceTraveled) *
+					phoTrkCellInfoTable[cellIndex].attenuation);
 			}
 		}
 		else {
@@ -1481,28 +1616,17 @@ void phoTrkCalcCritZoneFreePaths(PHG_TrackingPhoton	*trackingPhotonPtr,
 		}
 		else {
 
-			distanceTraveled = 0;
-			*freePathsToEnterPtr = 0;
+			/* Find the cell the photon enters the critical zone in */
+			cellIndex = phoTrkFindCell(intersectionPtr->distToEnter, false, false);
+			distanceTraveled = PHOTRKGetCellsDistance(cellIndex);
+			*freePathsToEnterPtr = PHOTRKGetCellsFreePaths(cellIndex);
 			
-			/* Loop through cell table until we enter the critical zone */
-			for (cellIndex = 0; cellIndex < phoTrkCellsInUse; cellIndex++) {
-				 if ((distanceTraveled + phoTrkCellInfoTable[cellIndex].distance)
-						> intersectionPtr->distToEnter) {
-						
-					/* Add freepaths used within this cell */
-					*freePathsToEnterPtr += 
-						((intersectionPtr->distToEnter - 
-						distanceTraveled) *
-						phoTrkCellInfoTable[cellIndex].attenuation);
-						
-					/* We are done */
-					break;
-						
-				}
-				else {
-					distanceTraveled += phoTrkCellInfoTable[cellIndex].distance;
-					*freePathsToEnterPtr += phoTrkCellInfoTable[cellIndex].freePaths;
-				}
+			/* Add freepaths used within this cell */
+			if (cellIndex < phoTrkCellsInUse) {
+				*freePathsToEnterPtr += 
+					((intersectionPtr->distToEnter - 
+					distanceTraveled) *
+					phoTrkCellInfoTable[cellIndex].attenuation);
 			}
 			#ifdef PHG_DEBUG
 				/* If we got here because we ran out of cells, it is an error */
@@ -1725,6 +1849,13 @@ PhoTrkActionTy PhoTrkCalcNewPosition(PHG_TrackingPhoton	*trackingPhotonPtr,
 	double			nextFreePathsToUse;		/* Amount of free paths next move will use */
 	LbFourByte		newSliceIndex;			/* Computed slice index for entering new slices */
 	LbFourByte		cellIndex;				/* Computed slice index for entering new slices */
+	double			*attenuations;			/* Attenuation of each material at photonEnergy */
+	LbFourByte		voxelOffset;			/* Offset of the current voxel in SubObjAttIndexes */
+	LbFourByte		xOffsetStep;			/* Change in voxelOffset for an x crossing */
+	LbFourByte		yOffsetStep;			/* Change in voxelOffset for a y crossing */
+	LbUsFourByte	tissueIndex;			/* Tissue of the current voxel */
+	LbUsFourByte	lastTissueIndex;		/* Tissue whose attenuation is in attenuation */
+	double			nearObjectSurface;		/* Moves shorter than this stay well inside the object */
 	PhoTrkActionTy	action;					/* Return value */
 	
 
@@ -1749,46 +1880,31 @@ PhoTrkActionTy PhoTrkCalcNewPosition(PHG_TrackingPhoton	*trackingPhotonPtr,
 		/* If we have a voxel (cell) list, then use it to update position */
 		if (phoTrkCellsInUse != 0) {
 
-			/* Clearloop variables */
-			distanceTracked = 0;
-			*freePathsUsed = 0.0;
+			/* Find the cell in which the free paths will be used up */
+			cellIndex = (LbFourByte) phoTrkFindCell(freePath_Length, true, false);
+			distanceTracked = PHOTRKGetCellsDistance(cellIndex);
+			*freePathsUsed = PHOTRKGetCellsFreePaths(cellIndex);
+			
+			/* If we did not run out of cells, we interacted so we are done */
+			if (cellIndex < phoTrkCellsInUse){
 			
-			/* Loop through cell table until freePathsToTravel have been used up */
-			for (cellIndex = 0; cellIndex < phoTrkCellsInUse; cellIndex++) {
-				 
-				 /* See if we will use available freepaths on this cell */
-				 if ((*freePathsUsed + phoTrkCellInfoTable[cellIndex].freePaths)
-						> freePath_Length) {
+				/* Only use necessary amount of cell */
+				distanceTracked += (freePath_Length - *freePathsUsed)/
+					phoTrkCellInfoTable[cellIndex].attenuation;
+				
+				/* Indicate we used all free paths */
+				*freePathsUsed = freePath_Length;
+	
+				/* Calculate new position and object indexes */
+				{
+					PhoTrkProject(&startingPosition, &direction, distanceTracked, newPosition);
 						
-					/* Only use necessary amount of cell */
-					distanceTracked += (freePath_Length - *freePathsUsed)/
-						phoTrkCellInfoTable[cellIndex].attenuation;
+					trackingPhotonPtr->xIndex = phoTrkCellInfoTable[cellIndex].xIndex;
+					trackingPhotonPtr->yIndex = phoTrkCellInfoTable[cellIndex].yIndex;
+					trackingPhotonPtr->sliceIndex = phoTrkCellInfoTable[cellIndex].sliceIndex;
 					
-					/* Indicate we used all free paths */
-					*freePathsUsed = freePath_Length;
-		
-					/* Calculate new position and object indexes */
-					{
-						PhoTrkProject(&startingPosition, &direction, distanceTracked, newPosition);
-							
-						trackingPhotonPtr->xIndex = phoTrkCellInfoTable[cellIndex].xIndex;
-						trackingPhotonPtr->yIndex = phoTrkCellInfoTable[cellIndex].yIndex;
-						trackingPhotonPtr->sliceIndex = phoTrkCellInfoTable[cellIndex].sliceIndex;
-						
-					}
-
-					/* We are done */
-					break;
-						
 				}
-				else {
-					distanceTracked += phoTrkCellInfoTable[cellIndex].distance;
-					*freePathsUsed += phoTrkCellInfoTable[cellIndex].freePaths;
-				}
-			}
-			/* If we got here without running out of cells, we interacted so we are done */
-			if (cellIndex < phoTrkCellsInUse){
-			
+
 				break;
 			}
 			else {
@@ -1952,6 +2068,14 @@ PhoTrkActionTy PhoTrkCalcNewPosition(PHG_TrackingPhoton	*trackingPhotonPtr,
 
 		}
 		
+		/* With Woodcock tracking, sampled flights skip the voxel walk entirely */
+		if (PHG_IsWoodcockTracking() && (freePath_Length != -1)) {
+			action = phoTrkWoodcockNewPosition(trackingPhotonPtr, &startingPosition,
+				&direction, photonEnergy, freePath_Length, distToObjectSurface,
+				newPosition, &distanceTracked, freePathsUsed);
+			break;
+		}
+		
 		/* Get initial distance to cell wall */
 		SubObjGetInnerCellDistance(&startingPosition, &direction, trackingPhotonPtr->sliceIndex,
 			trackingPhotonPtr->xIndex, trackingPhotonPtr->yIndex,
@@ -1993,6 +2117,27 @@ PhoTrkActionTy PhoTrkCalcNewPosition(PHG_TrackingPhoton	*trackingPhotonPtr,
 				fabs(direction.cosine_z);
 		}
 		
+		/* Set up the voxel walk: the attenuations are fixed for this energy, so
+			each crossing only steps an offset into the slice's tissue indexes
+			and looks the attenuation up again when the tissue changes
+		*/
+		{
+			attenuations = SubObjGetAttenuationsInObj(photonEnergy);
+			lastTissueIndex = SubObjNumTissues;
+			attenuation = 0.0;
+			
+			xOffsetStep = ((direction.cosine_x >= 0) ? 1 : -1);
+			yOffsetStep = ((direction.cosine_y >= 0) ? -1 : 1) *
+				(LbFourByte) SubObjObject[trackingPhotonPtr->sliceIndex].attNumXBins;
+			voxelOffset = SubObjObject[trackingPhotonPtr->sliceIndex].attVoxelOffset +
+				(trackingPhotonPtr->yIndex *
+				(LbFourByte) SubObjObject[trackingPhotonPtr->sliceIndex].attNumXBins) +
+				trackingPhotonPtr->xIndex;
+			
+			/* Only moves ending near the surface need the tolerant comparison */
+			nearObjectSurface = distToObjectSurface - PHOTRK_SURFACE_GUARD;
+		}
+		
 		/* Zero loop variables */
 		distanceTracked = 0;
 		nextDist = 0;
@@ -2007,17 +2152,22 @@ PhoTrkActionTy PhoTrkCalcNewPosition(PHG_TrackingPhoton	*trackingPhotonPtr,
 			/* See if this will take us out of the object.
 				If so, adjust distance to go onto object cylinder
 			*/
-			if ((nextDist > distToObjectSurface) || (PhgMathRealNumAreEqual(nextDist, distToObjectSurface, -7, 0,0,0) == true)) {
+			if ((nextDist >= nearObjectSurface) &&
+					((nextDist > distToObjectSurface) || (PhgMathRealNumAreEqual(nextDist, distToObjectSurface, -7, 0,0,0) == true))) {
 
 				/* Set distance to put us onto cylinder */
 				nextDist = distToObjectSurface;		
 			}
 			
-			/* Get attenutation of current cell, fails if we are out of the object */
-			if (!SubObjGetCellAttenuation(trackingPhotonPtr->sliceIndex,
-					trackingPhotonPtr->xIndex, trackingPhotonPtr->yIndex, photonEnergy, &attenuation)) {
-				PhgAbort("Attempt to get attenuation for cell not in subobject (PhoTrkCalcNewPosition)",
-					true);
+			/* Get attenutation of current cell */
+			tissueIndex = SUBOBJGetVolumeIndex(SubObjAttIndexes, voxelOffset);
+			if (tissueIndex != lastTissueIndex) {
+				if (tissueIndex >= SubObjNumTissues) {
+					PhgAbort("Tissue index greater than number of supported tissues (PhoTrkCalcNewPosition)",
+						true);
+				}
+				attenuation = attenuations[tissueIndex];
+				lastTissueIndex = tissueIndex;
 			}
 	
 			/* Calculate amount of free paths to be used */
@@ -2044,9 +2194,10 @@ PhoTrkActionTy PhoTrkCalcNewPosition(PHG_TrackingPhoton	*trackingPhotonPtr,
 			else {
 			
 
-				/* If we moved to surface, project to target */
-				if (PhgMathRealNumAreEqual(nextDist, distToObjectSurface, -7, 
-				        0, 0, 0)){
+				/* If we moved to surface, project to target (nextDist was set to
+					exactly the surface distance above if it was within tolerance)
+				*/
+				if (nextDist == distToObjectSurface) {
 
 					/* Move the photon to its new location */
 					PhoTrkProject(&startingPosition, &direction, nextDist, newPosition);
@@ -2115,7 +2266,8 @@ PhoTrkActionTy PhoTrkCalcNewPosition(PHG_TrackingPhoton	*trackingPhotonPtr,
 			/* See which value we used */
 			if (nextDist == distToNextX) {
 				distToNextX += generalDistToX;
-				trackingPhotonPtr->xIndex += ((direction.cosine_x >= 0) ? 1 : -1);
+				trackingPhotonPtr->xIndex += xOffsetStep;
+				voxelOffset += xOffsetStep;
 				
 				#ifdef PHG_DEBUG
 				if ((trackingPhotonPtr->xIndex < 0) || ((LbUsFourByte)trackingPhotonPtr->xIndex >= SubObjObject[trackingPhotonPtr->sliceIndex].attNumXBins)) {
@@ -2129,6 +2281,7 @@ PhoTrkActionTy PhoTrkCalcNewPosition(PHG_TrackingPhoton	*trackingPhotonPtr,
 				
 				/* Notice that Y goes top to bottom so it is reversed from X */
 				trackingPhotonPtr->yIndex += ((direction.cosine_y >= 0) ? -1 : 1);
+				voxelOffset += yOffsetStep;
 				
 				#ifdef PHG_DEBUG
 				if ((trackingPhotonPtr->yIndex < 0) || ((LbUsFourByte)trackingPhotonPtr->yIndex >= SubObjObject[trackingPhotonPtr->sliceIndex].attNumYBins)) {
@@ -2197,6 +2350,14 @@ PhoTrkActionTy PhoTrkCalcNewPosition(PHG_TrackingPhoton	*trackingPhotonPtr,
 			   		&generalDistToX, &generalDistToY, &generalDistToZ,
 					&(trackingPhotonPtr->sliceIndex), &(trackingPhotonPtr->xIndex),
 					&(trackingPhotonPtr->yIndex));
+
+				/* Move the voxel walk to the new slice, whose geometry may differ */
+				yOffsetStep = ((direction.cosine_y >= 0) ? -1 : 1) *
+					(LbFourByte) SubObjObject[trackingPhotonPtr->sliceIndex].attNumXBins;
+				voxelOffset = SubObjObject[trackingPhotonPtr->sliceIndex].attVoxelOffset +
+					(trackingPhotonPtr->yIndex *
+					(LbFourByte) SubObjObject[trackingPhotonPtr->sliceIndex].attNumXBins) +
+					trackingPhotonPtr->xIndex;
 			}
 			
 		} while (true);
@@ -2211,6 +2372,206 @@ PhoTrkActionTy PhoTrkCalcNewPosition(PHG_TrackingPhoton	*trackingPhotonPtr,
 	return (action);
 }
 
+/*********************************************************************************
+*
+*			Name:		phoTrkWoodcockNewPosition
+*
+*			Summary:	Move a photon through the attenuation object by Woodcock
+*						(delta) tracking.  Flights are sampled against the
+*						object's majorant attenuation and a collision at a point
+*						is real with probability attenuation/majorant; otherwise
+*						a new flight is sampled from there.  No voxel boundaries
+*						are visited.  Points outside the attenuation voxels hold
+*						no material, so collisions there are always virtual and
+*						the photon goes on to escape.  Exits from the object are
+*						handled as in PhoTrkCalcNewPosition.
+*						The free paths used are the sum of attenuation/majorant
+*						over the tentative collisions: the number of tentative
+*						collisions in ds averages majorant*ds, so this is an
+*						unbiased estimate of the integral of the attenuation
+*						along the path (the exact value would need the voxel
+*						walk this mode avoids).
+*
+*			Arguments:
+*				PHG_TrackingPhoton	*trackingPhotonPtr	- The photon we are tracking.
+*				PHG_Position		*startingPosPtr		- The photon's starting position.
+*				PHG_Direction		*directionPtr		- The photon's direction.
+*				double				photonEnergy		- The current energy.
+*				double				freePath_Length		- Free paths of the first flight.
+*				double				distToObjectSurface	- Distance to the object cylinder.
+*				PHG_Position		*newPosition		- The new position.
+*				double				*distTraveled		- The distance the photon traveled.
+*				double				*freePathsUsed		- Estimated free paths used.
+*
+*			Function return: Action to take based on calculation.
+*
+*********************************************************************************/
+PhoTrkActionTy phoTrkWoodcockNewPosition(PHG_TrackingPhoton *trackingPhotonPtr,
+					PHG_Position *startingPosPtr, PHG_Direction *directionPtr,
+					double photonEnergy, double freePath_Length, double distToObjectSurface,
+					PHG_Position *newPosition, double *distTraveled, double *freePathsUsed)
+{
+	double			majorant;				/* Largest attenuation in the object */
+	double			*attenuations;			/* Attenuation of each material at photonEnergy */
+	double			distToExit;				/* Distance to leave the object */
+	double			distToEnd;				/* Distance to the end of the object */
+	double			distToTargetSurface;	/* Distance to target surface */
+	double			distanceTracked;		/* Total distance tracked */
+	double			freePaths;				/* Free paths of the current flight */
+	double			attenuation;			/* Attenuation at a tentative collision */
+	PhoTrkActionTy	action;					/* Return value */
+	
+	majorant = SubObjGetMajorantInObj(photonEnergy);
+	attenuations = SubObjGetAttenuationsInObj(photonEnergy);
+	
+	/* The photon leaves through the object cylinder or through one of its ends */
+	distToExit = distToObjectSurface;
+	if (directionPtr->cosine_z != 0.0) {
+		distToEnd = (((directionPtr->cosine_z > 0) ? CYLPOSGetObjZMax() : CYLPOSGetObjZMin())
+			- startingPosPtr->z_position) / directionPtr->cosine_z;
+		
+		if (distToEnd < distToExit) {
+			distToExit = distToEnd;
+		}
+	}
+	
+	action = PhoTrkInteract;
+	distanceTracked = 0.0;
+	freePaths = freePath_Length;
+	*freePathsUsed = 0.0;
+	
+	do { /* Loop until a real collision or the photon leaves the object */
+	
+		/* Fly to the next tentative collision */
+		if (majorant > 0.0) {
+			distanceTracked += freePaths/majorant;
+		}
+		else {
+			distanceTracked = distToExit;
+		}
+		
+		if (distanceTracked >= distToExit) {
+			
+			/* Move the photon onto the object's surface */
+			distanceTracked = distToExit;
+			PhoTrkProject(startingPosPtr, directionPtr, distanceTracked, newPosition);
+			
+			/* See if we are beyond end of limit cylinder */
+			if ((newPosition->z_position <= CylPosLimitCylinder.zMin) ||
+					(newPosition->z_position >= CylPosLimitCylinder.zMax)) {
+				
+				action = PhoTrkDiscard;
+			}
+			
+			/* Check our acceptance angle */
+			else if (fabs(directionPtr->cosine_z) > PHGGetSineOfAccAngle()) {
+				
+				action = PhoTrkDiscard;
+			}
+			
+			/* If target = object then this is a detection */
+			else if (CylPosGetTargetRadius() <= CylPosGetObjectRadius()) {
+				
+				action = PhoTrkDetect;
+			}
+			
+			/* Project to target cylinder */
+			else if (!CylPosProjectToTargetCylinder(newPosition, directionPtr,
+					&distToTargetSurface)) {
+				
+				action = PhoTrkDiscard;
+			}
+			else {
+				
+				/* Photon reached target cylinder within limits */
+				action = PhoTrkDetect;
+				distanceTracked += distToTargetSurface;
+			}
+			break;
+		}
+		
+		PhoTrkProject(startingPosPtr, directionPtr, distanceTracked, newPosition);
+		if (phoTrkLocateVoxel(newPosition, trackingPhotonPtr)) {
+			attenuation = attenuations[SUBOBJGetTissueIndex(trackingPhotonPtr)];
+		}
+		else {
+			attenuation = 0.0;
+		}
+		*freePathsUsed += attenuation/majorant;
+		
+		/* Accept the collision with probability attenuation/majorant */
+		if ((PhgMathGetRandomNumber() * majorant) < attenuation) {
+			
+			break;
+		}
+		
+		/* It was a virtual collision, so start a new flight from here */
+		PhgMathGetTotalFreePaths(&freePaths);
+	} while (true);
+	
+	*distTraveled = distanceTracked;
+	
+	return (action);
+}
+
+/*********************************************************************************
+*
+*			Name:		phoTrkLocateVoxel
+*
+*			Summary:	Set a photon's slice, x and y indexes to the attenuation
+*						voxel containing a position.  The slice search starts
+*						from the photon's current slice, since Woodcock flights
+*						only ever move a short way along the photon's path.
+*						A position outside the attenuation voxels leaves the
+*						photon's indexes unchanged.
+*
+*			Arguments:
+*				PHG_Position		*positionPtr		- The position.
+*				PHG_TrackingPhoton	*trackingPhotonPtr	- The photon to update.
+*
+*			Function return: True if the position is within the voxels.
+*
+*********************************************************************************/
+Boolean phoTrkLocateVoxel(PHG_Position *positionPtr, PHG_TrackingPhoton *trackingPhotonPtr)
+{
+	LbFourByte		sliceIndex;		/* The slice */
+	LbFourByte		xIndex;			/* The x index */
+	LbFourByte		yIndex;			/* The y index */
+	
+	/* Find the slice */
+	sliceIndex = trackingPhotonPtr->sliceIndex;
+	while ((sliceIndex < (LbFourByte)(SubObjNumSlices-1)) &&
+			(positionPtr->z_position > SUBOBJGetSliceMaxZ(sliceIndex))) {
+		sliceIndex++;
+	}
+	while ((sliceIndex > 0) &&
+			(positionPtr->z_position < SUBOBJGetSliceMinZ(sliceIndex))) {
+		sliceIndex--;
+	}
+	if ((positionPtr->z_position < SUBOBJGetSliceMinZ(sliceIndex)) ||
+			(positionPtr->z_position > SUBOBJGetSliceMaxZ(sliceIndex))) {
+		return (false);
+	}
+	
+	/* Find the x and y bins, y goes top to bottom */
+	xIndex = (LbFourByte) floor((positionPtr->x_position - SUBOBJGetSliceMinX(sliceIndex))/
+		SUBOBJGetSliceAttVoxelWidth(sliceIndex));
+	yIndex = (LbFourByte) floor((SUBOBJGetSliceMaxY(sliceIndex) - positionPtr->y_position)/
+		SUBOBJGetSliceAttVoxelHeight(sliceIndex));
+	
+	/* Points beyond the slice's edges are outside the voxels */
+	if ((xIndex < 0) || (xIndex >= (LbFourByte) SUBOBJGetSliceAttNumXBins(sliceIndex)) ||
+			(yIndex < 0) || (yIndex >= (LbFourByte) SUBOBJGetSliceAttNumYBins(sliceIndex))) {
+		return (false);
+	}
+	
+	trackingPhotonPtr->sliceIndex = sliceIndex;
+	trackingPhotonPtr->xIndex = xIndex;
+	trackingPhotonPtr->yIndex = yIndex;
+	
+	return (true);
+}
+
 /*********************************************************************************
 *
 *			Name:		PhoTrkProject
@@ -2389,17 +2750,16 @@ Boolean phoTrkCalcScatterAngleSPECT(PHG_TrackingPhoton	*photonPtr)
 *
 *			Arguments:
 *				PHG_TrackingPhoton	*trackingPhotonPtr	- The tracking photon.
+*				phoTrkFDRayTy		*rayPtr				- FD table values for the incoming ray.
 *
 *			Function return: True if valid angle computed.
 *
 *********************************************************************************/
-Boolean phoTrkCalcScatterAnglePET(PHG_TrackingPhoton	*trackingPhotonPtr)
+Boolean phoTrkCalcScatterAnglePET(PHG_TrackingPhoton	*trackingPhotonPtr,
+			phoTrkFDRayTy *rayPtr)
 {
 	Boolean			angleFound;			/* Did we find an acceptable angle? */
 	double			deltaAzimuth;		/* Change in azimuth */
-	double			incomingAzimuth;	/* The incoming azimuth angle */
-	double			incomingEnergy;		/* The incoming energy */
-	double			inclination;		/* The inclination */
 	double			minAccSine;			/* Minimum acceptable angle (to be detected) */
 	double			maxAccSine;			/* Maximum accetpable angle (to be detected) */
 	double			normalizedEnergy;	/* Energy value normalized by 511 */
@@ -2410,8 +2770,6 @@ Boolean phoTrkCalcScatterAnglePET(PHG_TrackingPhoton	*trackingPhotonPtr)
 	double			cosScatterAngle;	/* Cosine of the scatter angle */
 	double			knValue;			/* Klien Nishina probability */
 	double			forcedProb;			/* Probability with which the photon was forced into the detection angle */
-	double			fdFactor;			/* Product of phi_out & w_out bin size */
-	double			totKNCrossSection;	/* Klien Nishina cross section for given energy */
 	LbUsFourByte	inEnIndex;			/* Incoming energy FD Table index */
 	LbUsFourByte	inZCosIndex;		/* Incoming z cosine FD Table index */
 	LbUsFourByte	minAccAngSineIndex;	/* Minimum acceptance angle sine FD Table index */
@@ -2430,36 +2788,10 @@ Boolean phoTrkCalcScatterAnglePET(PHG_TrackingPhoton	*trackingPhotonPtr)
 			
 			break;
 		}
-				
-		#ifdef PHG_DEBUG
-			if (trackingPhotonPtr->energy < phoTrkFDTInfo.min_iei) {
-			
-				sprintf(phoTrkErrString, "Incoming energy below FD Table minimum energy (phoTrkCalcScatterAnglePET).\n"
-					"FD Table minimum = %2.4f\t incoming energy = %2.4f\n", phoTrkFDTInfo.min_iei,
-					trackingPhotonPtr->energy);
-					
-				PhgAbort(phoTrkErrString, true);
-			}
-		#endif
-		
-		/* Compute incoming energy in units of electron mass */
-		incomingEnergy = trackingPhotonPtr->energy/511.0;
-
-		/* Compute the incoming energy index (into the FD table) */
-		inEnIndex = (LbUsFourByte) ((trackingPhotonPtr->energy -
-			phoTrkFDTInfo.min_iei)/phoTrkFDTInfo.delta_iei);
 		
-		/* Check boundary (Necessary if energy index == max value in table) */
-		if (inEnIndex >= phoTrkFDTInfo.num_iei)
-			inEnIndex = phoTrkFDTInfo.num_iei - 1;
-			
-		/* Compute incoming z cosine index (into FD table) */
-		inZCosIndex = (LbUsFourByte) ((trackingPhotonPtr->angle.cosine_z+1)/
-		   (phoTrkFDTInfo.delta_iwi));
-	
-		/* Check boundary (Necessary if index == max value in table) */
-		if (inZCosIndex >= phoTrkFDTInfo.num_iwi)
-			inZCosIndex = phoTrkFDTInfo.num_iwi - 1;
+		/* Get the incoming ray's FD table indexes */
+		inEnIndex = rayPtr->inEnIndex;
+		inZCosIndex = rayPtr->inZCosIndex;
 			
 		/* Compute minimum acceptance angle range index. */
 		minAccAngSineIndex = (minAccSine+phoTrkFDTInfo.range_normalizer)/
@@ -2518,12 +2850,8 @@ Boolean phoTrkCalcScatterAnglePET(PHG_TrackingPhoton	*trackingPhotonPtr)
 			+
 			(PhgMathGetRandomNumber() * phoTrkFDTInfo.delta_ipo);
 		
-		/* Compute incoming azimuth and inclination */
-		phoTrkCalcDirToAzimuth(&(trackingPhotonPtr->angle), &inclination,
-			&incomingAzimuth);
-			
 		/* Compute azimuth out from azimuth in and azimuth change */
-		outgoingAzimuth = incomingAzimuth + deltaAzimuth;
+		outgoingAzimuth = rayPtr->incomingAzimuth + deltaAzimuth;
 		
 		/* Convert cosines and azimuths to direction cosine */
 		phoTrkCalcAzimuthToDir(newDir.cosine_z, outgoingAzimuth, &newDir);
@@ -2561,29 +2889,22 @@ Boolean phoTrkCalcScatterAnglePET(PHG_TrackingPhoton	*trackingPhotonPtr)
 		normalizedEnergy = trackingPhotonPtr->energy/511.0;
 
 		knValue = 0.5 * 
-		    (PHGMATH_Square(normalizedEnergy/incomingEnergy)) *
-			(normalizedEnergy/incomingEnergy +
-			 	 incomingEnergy/normalizedEnergy - 1 +
+		    (PHGMATH_Square(normalizedEnergy/rayPtr->incomingEnergy)) *
+			(normalizedEnergy/rayPtr->incomingEnergy +
+			 	 rayPtr->incomingEnergy/normalizedEnergy - 1 +
 			 	PHGMATH_Square(cosScatterAngle));
 
-		/* Compute azimuth/inclination bin size */
-		fdFactor = phoTrkFDTInfo.delta_ipo * phoTrkFDTInfo.delta_iwo;
-		
 		/* Compute the probability used to pick the chosen azimuth/inclination
-			and divide by fdFactor 
+			and divide by the azimuth/inclination bin size
 		*/
 		forcedProb = 
 			(phoTrkFDTable[inEnIndex][inZCosIndex].ipoTable[deltaAzimuthIndex]/
-			(targetDensityRange * fdFactor));
+			(targetDensityRange * rayPtr->fdFactor));
 
-		
-		/* Lookup Integral of KN formula at incoming energy */
-		totKNCrossSection = phoTrkTotalKN[(LbUsFourByte) (incomingEnergy * 511.0)];
-		
 		/* Adjust photon weight according to probability of chosen scatter */
 		trackingPhotonPtr->photon_scatter_weight = 
 			trackingPhotonPtr->photon_scatter_weight *
-			(knValue/(totKNCrossSection * forcedProb));
+			(knValue/(rayPtr->totKNCrossSection * forcedProb));
 		
 		angleFound = true;
 	} while (false);
@@ -2591,6 +2912,286 @@ Boolean phoTrkCalcScatterAnglePET(PHG_TrackingPhoton	*trackingPhotonPtr)
 	return (angleFound);
 }
 
+/*********************************************************************************
+*
+*			Name:		phoTrkSetFDRay
+*
+*			Summary:	Compute the FD table values that depend only on the
+*						incoming ray, so all the forced detection attempts
+*						for it can share them.
+*
+*			Arguments:
+*				PHG_TrackingPhoton	*trackingPhotonPtr	- The incoming photon.
+*				phoTrkFDRayTy		*rayPtr				- The computed values.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phoTrkSetFDRay(PHG_TrackingPhoton *trackingPhotonPtr, phoTrkFDRayTy *rayPtr)
+{
+	double			inclination;		/* The inclination (unused) */
+	
+	#ifdef PHG_DEBUG
+		if (trackingPhotonPtr->energy < phoTrkFDTInfo.min_iei) {
+		
+			sprintf(phoTrkErrString, "Incoming energy below FD Table minimum energy (phoTrkSetFDRay).\n"
+				"FD Table minimum = %2.4f\t incoming energy = %2.4f\n", phoTrkFDTInfo.min_iei,
+				trackingPhotonPtr->energy);
+				
+			PhgAbort(phoTrkErrString, true);
+		}
+	#endif
+	
+	/* Compute incoming energy in units of electron mass */
+	rayPtr->incomingEnergy = trackingPhotonPtr->energy/511.0;
+
+	/* Compute the incoming energy index (into the FD table) */
+	rayPtr->inEnIndex = (LbUsFourByte) ((trackingPhotonPtr->energy -
+		phoTrkFDTInfo.min_iei)/phoTrkFDTInfo.delta_iei);
+	
+	/* Check boundary (Necessary if energy index == max value in table) */
+	if (rayPtr->inEnIndex >= phoTrkFDTInfo.num_iei)
+		rayPtr->inEnIndex = phoTrkFDTInfo.num_iei - 1;
+		
+	/* Compute incoming z cosine index (into FD table) */
+	rayPtr->inZCosIndex = (LbUsFourByte) ((trackingPhotonPtr->angle.cosine_z+1)/
+	   (phoTrkFDTInfo.delta_iwi));
+
+	/* Check boundary (Necessary if index == max value in table) */
+	if (rayPtr->inZCosIndex >= phoTrkFDTInfo.num_iwi)
+		rayPtr->inZCosIndex = phoTrkFDTInfo.num_iwi - 1;
+	
+	/* Compute incoming azimuth */
+	phoTrkCalcDirToAzimuth(&(trackingPhotonPtr->angle), &inclination,
+		&(rayPtr->incomingAzimuth));
+	
+	/* Lookup Integral of KN formula at incoming energy */
+	rayPtr->totKNCrossSection = phoTrkTotalKN[(LbUsFourByte) (rayPtr->incomingEnergy * 511.0)];
+	
+	/* Compute azimuth/inclination bin size */
+	rayPtr->fdFactor = phoTrkFDTInfo.delta_ipo * phoTrkFDTInfo.delta_iwo;
+}
+
+/*********************************************************************************
+*
+*			Name:		phoTrkFindCell
+*
+*			Summary:	Find the first cell of the cell list whose running
+*						distance (or free paths) exceeds a limit.  The running
+*						totals never decrease, so a binary search finds the same
+*						cell as walking the list.
+*
+*			Arguments:
+*				double		limit		- The distance or free paths to reach.
+*				Boolean		byFreePaths	- Search free paths instead of distance.
+*				Boolean		orEqual		- Also accept a total equal to the limit.
+*
+*			Function return: Index of the cell, phoTrkCellsInUse if none.
+*
+*********************************************************************************/
+LbUsFourByte phoTrkFindCell(double limit, Boolean byFreePaths, Boolean orEqual)
+{
+	LbUsFourByte	minIndex;		/* Lowest cell that may be the one */
+	LbUsFourByte	maxIndex;		/* Highest cell that may be the one */
+	LbUsFourByte	testIndex;		/* The cell we will test */
+	double			total;			/* Running total of the test cell */
+	
+	minIndex = 0;
+	maxIndex = phoTrkCellsInUse;
+	
+	while (minIndex < maxIndex) {
+		
+		/* Calculate index to test */
+		testIndex = minIndex + (maxIndex - minIndex)/2;
+		
+		total = (byFreePaths ? phoTrkCellInfoTable[testIndex].cumFreePaths :
+			phoTrkCellInfoTable[testIndex].cumDistance);
+		
+		if ((total > limit) || (orEqual && (total == limit)))
+			maxIndex = testIndex;
+		else
+			minIndex = testIndex + 1;
+	}
+	
+	return (minIndex);
+}
+
+/*********************************************************************************
+*
+*			Name:		phoTrkTimeFDPart
+*
+*			Summary:	Charge the time since the last call to a component of
+*						forced detection and restart the timer.
+*
+*			Arguments:
+*				phoTrkFDPartTy	part	- The component.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phoTrkTimeFDPart(phoTrkFDPartTy part)
+{
+	double	realSecs;	/* Real time since the last call */
+	double	cpuSecs;	/* CPU time since the last call */
+	
+	if (LbTmStopTiming(&phoTrkFDTimer, &realSecs, &cpuSecs)) {
+		phoTrkFDRealTime[part] += realSecs;
+		phoTrkFDCPUTime[part] += cpuSecs;
+	}
+	
+	LbTmStartTiming(&phoTrkFDTimer);
+}
+
+/*********************************************************************************
+*
+*			Name:		phoTrkCalcExitFreePaths
+*
+*			Summary:	Trace the free paths a photon uses leaving the object
+*						from its current location.
+*						NOTE: sets the local global "phoTrkCellsInUse".
+*
+*			Arguments:
+*				PHG_TrackingPhoton	*trackingPhotonPtr	- The tracking photon.
+*				double				*freePathsPtr		- The free paths.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phoTrkCalcExitFreePaths(PHG_TrackingPhoton *trackingPhotonPtr, double *freePathsPtr)
+{
+	double	distToObject;		/* Distance to object cylinder */
+	
+	/* Compute the distance to the object cylinder */
+	CylPosCalcDistanceToObjectSurface(&(trackingPhotonPtr->location),
+		&(trackingPhotonPtr->angle), &distToObject);
+	
+	/* Compute attenuation (free paths) through object */
+	phoTrkCalcFreePaths(trackingPhotonPtr, &(trackingPhotonPtr->location),
+		distToObject, trackingPhotonPtr->angle,
+		trackingPhotonPtr->energy, freePathsPtr);
+}
+
+/*********************************************************************************
+*
+*			Name:		phoTrkLookupAttCache
+*
+*			Summary:	Get the free paths a primary photon uses leaving the
+*						object from the attenuation cache.
+*
+*						Entries are keyed by energy bin, starting voxel and
+*						direction bin, and made as photons need them.  An
+*						entry is trusted once PHOTRK_ATT_CACHE_SAMPLES traced
+*						attenuations spread over no more than the allowed
+*						error (in free paths, roughly the relative error in
+*						weight); it then answers with their mean.  Entries
+*						whose attenuations spread further are rejected and
+*						their photons are always traced.
+*
+*			Arguments:
+*				PHG_TrackingPhoton	*trackingPhotonPtr	- The tracking photon.
+*				double				*freePathsPtr		- The free paths.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void phoTrkLookupAttCache(PHG_TrackingPhoton *trackingPhotonPtr, double *freePathsPtr)
+{
+	LbUsFourByte			energyBin;		/* Energy bin, as binned by the attenuation tables */
+	LbUsFourByte			cosBin;			/* Direction z cosine bin */
+	LbUsFourByte			azBin;			/* Direction azimuth bin */
+	LbUsFourByte			hashIndex;		/* Index of the key's entry */
+	LbUsEightByte			key;			/* The photon's cache key */
+	phoTrkAttCacheEntryTy	*entryPtr;		/* The key's entry */
+	
+	do { /* Process Loop */
+	
+		phoTrkAttCacheLookups++;
+		
+		/* Photons whose energy or voxel don't fit in a key are traced */
+		energyBin = (LbUsFourByte) (trackingPhotonPtr->energy + 0.499);
+		if ((energyBin >= PHOTRK_ATT_CACHE_MAX_INDEX) ||
+				((LbUsFourByte) trackingPhotonPtr->sliceIndex >= PHOTRK_ATT_CACHE_MAX_INDEX) ||
+				((LbUsFourByte) trackingPhotonPtr->yIndex >= PHOTRK_ATT_CACHE_MAX_INDEX) ||
+				((LbUsFourByte) trackingPhotonPtr->xIndex >= PHOTRK_ATT_CACHE_MAX_INDEX)) {
+			
+			phoTrkCalcExitFreePaths(trackingPhotonPtr, freePathsPtr);
+			break;
+		}
+		
+		/* Bin the direction */
+		cosBin = (LbUsFourByte) ((trackingPhotonPtr->angle.cosine_z + 1.0) * 0.5 *
+			PHOTRK_ATT_CACHE_COS_BINS);
+		if (cosBin >= PHOTRK_ATT_CACHE_COS_BINS)
+			cosBin = PHOTRK_ATT_CACHE_COS_BINS - 1;
+		azBin = (LbUsFourByte) ((atan2(trackingPhotonPtr->angle.cosine_y,
+			trackingPhotonPtr->angle.cosine_x) + PHGMATH_PI) / PHGMATH_2PI *
+			PHOTRK_ATT_CACHE_AZ_BINS);
+		if (azBin >= PHOTRK_ATT_CACHE_AZ_BINS)
+			azBin = PHOTRK_ATT_CACHE_AZ_BINS - 1;
+		
+		/* Build the key and find its entry */
+		key = energyBin;
+		key = (key * PHOTRK_ATT_CACHE_MAX_INDEX) + (LbUsFourByte) trackingPhotonPtr->sliceIndex;
+		key = (key * PHOTRK_ATT_CACHE_MAX_INDEX) + (LbUsFourByte) trackingPhotonPtr->yIndex;
+		key = (key * PHOTRK_ATT_CACHE_MAX_INDEX) + (LbUsFourByte) trackingPhotonPtr->xIndex;
+		key = (key * PHOTRK_ATT_CACHE_COS_BINS) + cosBin;
+		key = (key * PHOTRK_ATT_CACHE_AZ_BINS) + azBin;
+		hashIndex = ((LbUsFourByte) (key ^ (key >> 32)) * 2654435769U) >>
+			(32 - PHOTRK_ATT_CACHE_BITS);
+		entryPtr = &(phoTrkAttCache[hashIndex]);
+		
+		/* Start the entry over if it is empty or holds another key */
+		if ((entryPtr->generation != phoTrkAttCacheGeneration) || (entryPtr->key != key)) {
+			if (entryPtr->generation == phoTrkAttCacheGeneration)
+				phoTrkAttCacheReplaced++;
+			
+			entryPtr->key = key;
+			entryPtr->generation = phoTrkAttCacheGeneration;
+			entryPtr->numTraced = 0;
+		}
+		
+		/* Answer from a trusted entry */
+		if (entryPtr->numTraced == PHOTRK_ATT_CACHE_SAMPLES) {
+			*freePathsPtr = entryPtr->freePaths;
+			phoTrkAttCacheHits++;
+			break;
+		}
+		
+		/* Otherwise trace the photon */
+		phoTrkCalcExitFreePaths(trackingPhotonPtr, freePathsPtr);
+		
+		if (entryPtr->numTraced == PHOTRK_ATT_CACHE_REJECTED) {
+			break;
+		}
+		
+		/* Add the traced attenuation to the entry */
+		if (entryPtr->numTraced == 0) {
+			entryPtr->freePaths = *freePathsPtr;
+			entryPtr->minFreePaths = *freePathsPtr;
+			entryPtr->maxFreePaths = *freePathsPtr;
+		}
+		else {
+			entryPtr->freePaths += *freePathsPtr;
+			if (*freePathsPtr < entryPtr->minFreePaths)
+				entryPtr->minFreePaths = *freePathsPtr;
+			if (*freePathsPtr > entryPtr->maxFreePaths)
+				entryPtr->maxFreePaths = *freePathsPtr;
+		}
+		entryPtr->numTraced++;
+		
+		/* Reject the entry if its attenuations disagree, or trust it once enough agree */
+		if ((entryPtr->maxFreePaths - entryPtr->minFreePaths) >
+				PhgRunTimeParams.PhgPrimaryAttCacheError) {
+			
+			entryPtr->numTraced = PHOTRK_ATT_CACHE_REJECTED;
+			phoTrkAttCacheRejected++;
+		}
+		else if (entryPtr->numTraced == PHOTRK_ATT_CACHE_SAMPLES) {
+			entryPtr->freePaths /= PHOTRK_ATT_CACHE_SAMPLES;
+		}
+	} while (false);
+}
+
 /*********************************************************************************
 *
 *			Name:		phoTrkDoWeightWindow
@@ -2799,6 +3400,38 @@ Boolean PhoTrkInitialize()
 					((a1/pow(a,3.0)) * (2.*a*a1/a2 - log(a2)) + log(a2)/(2.*a) -
 					a3/pow(a2,2.0));
 			}
+			
+			/* Time the components of forced detection if requested; worker
+				processes add their times to ours */
+			phoTrkTimeFD = PHGDEBUG_TimeForcedDetection();
+			if (phoTrkTimeFD) {
+				memset(phoTrkFDRealTime, 0, sizeof(phoTrkFDRealTime));
+				memset(phoTrkFDCPUTime, 0, sizeof(phoTrkFDCPUTime));
+				PhgParRegisterSum(phoTrkFDRealTime, PhgParEn_Double, phoTrkFDNumParts);
+				PhgParRegisterSum(phoTrkFDCPUTime, PhgParEn_Double, phoTrkFDNumParts);
+			}
+			
+			/* Allocate the primary attenuation cache if requested */
+			if (PHG_IsCachePrimaryAttenuation() && !PHOTRKIsConeBeamForcedDetection()) {
+				if ((phoTrkAttCache = (phoTrkAttCacheEntryTy *) LbMmAlloc(
+						PHOTRK_ATT_CACHE_SIZE * sizeof(phoTrkAttCacheEntryTy))) == 0) {
+					break;
+				}
+				memset(phoTrkAttCache, 0, PHOTRK_ATT_CACHE_SIZE * sizeof(phoTrkAttCacheEntryTy));
+				
+				/* Generation 0 marks the cleared entries */
+				phoTrkAttCacheGeneration = 1;
+				phoTrkAttCacheLookups = 0;
+				phoTrkAttCacheHits = 0;
+				phoTrkAttCacheReplaced = 0;
+				phoTrkAttCacheRejected = 0;
+				
+				/* Worker processes add their counts to ours */
+				PhgParRegisterSum(&phoTrkAttCacheLookups, PhgParEn_EightByte, 1);
+				PhgParRegisterSum(&phoTrkAttCacheHits, PhgParEn_EightByte, 1);
+				PhgParRegisterSum(&phoTrkAttCacheReplaced, PhgParEn_EightByte, 1);
+				PhgParRegisterSum(&phoTrkAttCacheRejected, PhgParEn_EightByte, 1);
+			}
 		}
 		phoTrkIsInitialized = true;
 	} while (false);
@@ -3822,6 +4455,37 @@ void PhoTrkTerminate()
 		/* Only deal with this if we've been initialized */
 		if (phoTrkIsInitialized == true) {
 			if (PHG_IsForcedDetection() == true) {
+				
+				if (phoTrkTimeFD) {
+					LbUsFourByte	part;		/* Index through FD components */
+					char			*partNames[phoTrkFDNumParts] = {
+										"critical zone and ray", "interaction point",
+										"scatter angle", "tracking out", "recording"};
+					
+					LbInPrintf("\n\nForced detection time by component (real/CPU seconds):");
+					for (part = 0; part < phoTrkFDNumParts; part++) {
+						LbInPrintf("\n\t%-24s%10.3f%10.3f", partNames[part],
+							phoTrkFDRealTime[part], phoTrkFDCPUTime[part]);
+					}
+					LbInPrintf("\n");
+				}
+				
+				/* Report on and free the primary attenuation cache */
+				if (phoTrkAttCache != 0) {
+					LbInPrintf("\n\nPrimary attenuation cache:");
+					LbInPrintf("\n\tMemory used = %.1f MB (%lu entries)",
+						(PHOTRK_ATT_CACHE_SIZE * sizeof(phoTrkAttCacheEntryTy)) / (1024.0 * 1024.0),
+						(unsigned long) PHOTRK_ATT_CACHE_SIZE);
+					LbInPrintf("\n\tAttenuations looked up = %lld", phoTrkAttCacheLookups);
+					LbInPrintf("\n\tAttenuations answered without tracing = %lld (%.1f%%)",
+						phoTrkAttCacheHits, ((phoTrkAttCacheLookups == 0) ? 0.0 :
+						(100.0 * phoTrkAttCacheHits) / phoTrkAttCacheLookups));
+					LbInPrintf("\n\tEntries replaced by another key = %lld", phoTrkAttCacheReplaced);
+					LbInPrintf("\n\tEntries rejected for exceeding the error bound = %lld\n",
+						phoTrkAttCacheRejected);
+					
+					LbMmFree((void **) &phoTrkAttCache);
+				}
 			
 				/* Free the memory used by the FDT tables */
 				for (ieiIndex = 0; ieiIndex < phoTrkFDTInfo.num_iei; ieiIndex++) {
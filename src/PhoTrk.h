@@ -129,6 +129,7 @@ PhoTrkActionTy 	PhoTrkCalcNewPosition(PHG_TrackingPhoton *trackingPhotonPtr,
 					PHG_Position startingPosition, PHG_Direction startingDirection,
 					double photonEnergy, double freePath_Length, PHG_Position *newPosition,
 					double *distTraveled, double *freePathsUsed);
+void			PhoTrkClearAttCache(void);
 Boolean			PhoTrkInitialize(void);
 void			PhoTrkTerminate(void);
 void			 PhoTrkUpdatePhotonPosition(PHG_TrackingPhoton *trackingPhotonPtr,
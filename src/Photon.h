@@ -241,6 +241,11 @@ typedef struct {
 
 #define MAX_DET_INTERACTIONS	30
 
+/* Detector interactions of one photon, kept outside the tracking photon (see
+	DetNewInteractions); the extra entry holds the interaction that forces
+	absorption at MAX_DET_INTERACTIONS */
+typedef detInteractionInfoTy	PHG_DetInteractionsTy[MAX_DET_INTERACTIONS+1];
+
 /* Tracking Photon */
 typedef struct  {	
 	LbUsOneByte					flags;									/* Modifier flags for the photon - see PHGFg_... above */
@@ -267,8 +272,8 @@ typedef struct  {
 	double						axialPosition;							/* For SPECT, axial position on "back" of collimator */
 	double						detectorAngle;							/* For SPECT, DHCI, angle of detector */
 	LbUsFourByte				numStarts;								/* Number of starts used */
-	PHG_InteractionInfo			starts_list[PHG_MAXIMUM_STARTS];		/* Photon starts list */
-	detInteractionInfoTy		det_interactions[MAX_DET_INTERACTIONS];	/* Interactions in the detector */
+	PHG_InteractionInfo			*starts_list;							/* Photon starts list, PHG_MAXIMUM_STARTS long (set by EmisList) */
+	detInteractionInfoTy		*det_interactions;						/* Interactions in the detector (set by detector tracking) */
 	LbUsFourByte				num_det_interactions;					/* The number of detector interactions */
 	PHG_Position				detLocation;							/* Centroid location in detector coordinates */
 	LbFourByte					detCrystal;								/* for block detectors, the crystal number for detection */
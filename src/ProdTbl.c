@@ -94,6 +94,7 @@
 #include "PhoHFile.h"
 #include "phg.h"
 #include "PhgBin.h"
+#include "PhgParallel.h"
 
 /* LOCAL CONSTANTS */
 #define PRODTBL_PRODTBL_FILEPREFIX	"phgprod."						/* Prefix to starting productivity table */
@@ -937,6 +938,18 @@ Boolean ProdTblCreateTable(ProdTblProdTblInfoTy *prodTableInfoPtr)
 				ProdTblDetPerBinTbl[sliceIndex].productivity[angleIndex].cellProductivity = 0;
 			}
 		}
+		
+		/* Register the accumulated tables with the worker processes */
+		PhgParRegisterSum(ProdTblStartPrimPhoSquWeights, PhgParEn_Double, PRODTBL_TOT_STRAT_CELLS*ProdTblNumSlices);
+		PhgParRegisterSum(ProdTblStartScatPhoSquWeights, PhgParEn_Double, PRODTBL_TOT_STRAT_CELLS*ProdTblNumSlices);
+		PhgParRegisterSum(ProdTblDetPrimPhoSquWeights, PhgParEn_Double, PRODTBL_TOT_STRAT_CELLS*ProdTblNumSlices);
+		PhgParRegisterSum(ProdTblDetScatPhoSquWeights, PhgParEn_Double, PRODTBL_TOT_STRAT_CELLS*ProdTblNumSlices);
+		PhgParRegisterSum(ProdTblStartPrimPhoWeights, PhgParEn_Double, PRODTBL_TOT_STRAT_CELLS*ProdTblNumSlices);
+		PhgParRegisterSum(ProdTblStartScatPhoWeights, PhgParEn_Double, PRODTBL_TOT_STRAT_CELLS*ProdTblNumSlices);
+		PhgParRegisterSum(ProdTblDetPrimPhoWeights, PhgParEn_Double, PRODTBL_TOT_STRAT_CELLS*ProdTblNumSlices);
+		PhgParRegisterSum(ProdTblDetScatPhoWeights, PhgParEn_Double, PRODTBL_TOT_STRAT_CELLS*ProdTblNumSlices);
+		PhgParRegisterSum(ProdTblDetPerBinTbl, PhgParEn_Double,
+			(sizeof(ProdTblProdTblElemTy)/sizeof(double))*ProdTblNumSlices);
 
 		okay = true;
 		FAIL:;
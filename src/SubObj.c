@@ -24,11 +24,20 @@
 *
 *			Global functions defined:
 *				SubObjAdjPosDecayLocation
+*				SubObjAllocIndexes
 *				SubObjCalcTimeBinDecays
+*				SubObjCalcTimeBinDecayBlock
 *				SubObjCreate
+*				SubObjFreeIndexes
 *				SubObjGenVoxAngCellDecay
 *				SubObjGetAttCellIndexes
+*				SubObjGetAttenuationsInObj
+*				SubObjGetMajorantInObj
 *				SubObjGetInnerCellDistance
+*				SubObjGetInteraction
+*				SubObjGetInteractionInObj
+*				SubObjGetInteractionInObj2
+*				SubObjGetInteractionInTomo2
 *				SubObjGetObjCylinder
 *				SubObjGetProbComptToScatter
 *				SubObjGetStartingProdValues
@@ -165,6 +174,12 @@
 
 #include "SystemDependent.h"
 
+#ifdef GEN_UNIX
+	#include <sys/types.h>
+	#include <sys/stat.h>
+	#include <sys/mman.h>
+#endif
+
 #include "LbTypes.h"
 #include "LbMacros.h"
 #include "LbError.h"
@@ -174,6 +189,7 @@
 #include "LbInterface.h"
 #include "LbHeader.h"
 #include "LbTiming.h"
+#include "LbConvert.h"
 
 #include "Photon.h"
 #include "PhgParams.h"
@@ -190,6 +206,7 @@
 #include "ColUsr.h"
 #include "phg.h"
 #include "PhgBin.h"
+#include "PhgParallel.h"
 
 /* LOCAL CONSTANTS */
 #define SUBOBJ_ACC_STRAT_BINS			48								/* Count of stratification bins within acceptance angle */
@@ -201,6 +218,7 @@
 #define SUBOBJ_VERYSMALLATTENUATION		0.0000000001
 #define SUBOBJ_NUM_ENERGY_BINS			1000								/* Number of energy bins */
 #define SUBOBJ_NUM_TISSUE_TRANSLATIONS	256								/* Entries in the translation tables */
+#define SUBOBJ_MAX_PLAUSIBLE_INDEX		0x01000000						/* Indexes at least this large mean a byte-swapped index file */
 #define SUBOBJ_NUM_COH_THETAS			180								/* Number of angles in coherent scatter angle table */
 
 #define SUBOBJ_NUM_1KEV_ENERGIES	150
@@ -227,20 +245,27 @@ typedef LbUsEightByte					subObjDecaySliceTy;
 
 typedef double							subObjDecayWeightSliceTy;		/* Decay weight per angle */
 
+	/* An entry of an alias table: pick a uniform entry and a uniform fraction,
+		keep the entry if the fraction is below its threshold, else take its alias
+	*/
+typedef struct {
+	double			probability;	/* Probability of sampling the entry */
+	double			threshold;		/* Fraction below which the entry itself is kept */
+	LbUsFourByte	alias;			/* Entry taken otherwise */
+} subObjAliasEntryTy;
+
+typedef struct {
+	LbUsFourByte	sliceIndex;		/* Slice of the voxel */
+	LbUsFourByte	voxelIndex;		/* Voxel within the slice */
+} subObjAliasVoxelTy;
+
 typedef struct {
 	double	D;		/* Density */
 	double	A;		/* Effective Atomic Weight */
 	double	Z;		/* Effective Atomic Number */
 } subObjMaterialDAZTy;
 
-typedef struct {
-	double	energy;														/* Energy level */
-	double	attenuation;												/* Attenuation coefficient */
-	double	probComptonToScatter;										/* Probability of compton/scatter */
-	double	probScatter;												/* Probability of compton + coherent */
-} subObjAttenTy;
-
-typedef subObjAttenTy					subObjTissueAttenTy[SUBOBJ_NUM_ENERGY_BINS];		/* Attenuation values for a given tissue */
+typedef SubObjInteractionTy				subObjTissueAttenTy[SUBOBJ_NUM_ENERGY_BINS];		/* Attenuation values for a given tissue */
 typedef subObjTissueAttenTy				*subObjTissueAttenTblTy;		/* Attenuation table */
 
 #ifdef ABANDONED_WAY
@@ -270,11 +295,25 @@ static	LbUsFourByte				subObjCurTimeBin;					/* Our current time bin */
 static	LbUsFourByte				SubObjNumActIndexes;				/* Number of activity indexes */
 static	double						SubObjCurTimeBinDuration;			/* Duration of current time bin */
 static	LbUsFourByte				SubObjAngleRoundUpCount;			/* Count of number of times an angle was rounded up */
+static	double						subObjDecayWeightScale = 1.0;		/* Fraction of all decays in the current block */
+static	LbUsEightByte				subObjBlockDecays;					/* Number of decays in the current block */
+static	LbUsEightByte				subObjBlockStart;					/* Decays processed before the current block */
 static	subObjDecaySliceTy			*SubObjDecaySlice = 0;				/* Number of decays for the slice */
 static	subObjDecayWeightSliceTy	*SubObjDecayWeightSlice = 0;			/* Weight of decays for the slice */
+static	subObjAliasEntryTy			*subObjAliasVoxelTbl = 0;			/* Alias table over voxels with activity */
+static	subObjAliasVoxelTy			*subObjAliasVoxels = 0;				/* The voxel of each voxel table entry */
+static	LbUsFourByte				subObjAliasNumVoxels = 0;			/* Entries in the voxel table */
+static	subObjAliasEntryTy			*subObjAliasAngleTbl = 0;			/* Alias table over angle cells, per slice */
+static	LbUsFourByte				subObjAliasTimeBin;					/* Time bin the alias tables were built for */
+static	LbUsEightByte				subObjAliasDecaysLeft = 0;			/* Decays left to sample in the block */
+static	double						subObjAliasDecayWeight;				/* Weight of the last sampled decay */
 static	SubObjTissueTableTy			SubObjTissueTable;					/* Tissue activity table */
 static	subObjTissueAttenTblTy		SubObjTissueAttenTableNoCoh = 0;	/* Tissue attenuation table */
 static	subObjTissueAttenTblTy		SubObjTissueAttenTableCoh = 0;		/* Tissue attenuation table */
+static	subObjTissueAttenTblTy		subObjAttenTableInObj = 0;			/* Table for the object's coherent modelling */
+static	subObjTissueAttenTblTy		subObjAttenTableInTomo = 0;			/* Table for the tomograph's coherent modelling */
+static	double						*subObjAttenByEnergyInObj = 0;		/* Object attenuations, energy major, for voxel walks */
+static	double						subObjMajorantInObj[SUBOBJ_NUM_ENERGY_BINS];	/* Largest attenuation in the object by energy */
 static	subObjNameTy				*subObjMaterialNames;				/* Names of attenuation materials */
 static 	subObjMaterialDAZTy			*subObjMaterialDAZ;					/* Density, weight, and number of material */
 static	subObjCoScatAngleTblTy		*subObjCohScatAngles;
@@ -361,7 +400,7 @@ static	Boolean	subObjDoReadRandSeed = false;
 *
 *********************************************************************************/
 #define SubObjGetTissueIndex(sliceIndex, yIndex, xIndex) \
-	(SubObjObject[(sliceIndex)].activityArray[(yIndex) * SubObjObject[(sliceIndex)].actNumXBins + (xIndex)])
+	SUBOBJGetActIndex((sliceIndex), (yIndex) * SubObjObject[(sliceIndex)].actNumXBins + (xIndex))
 
 
 /*********************************************************************************
@@ -388,6 +427,19 @@ double			subObjVoxelCellGetNumReal(LbUsFourByte sliceIndex, LbUsFourByte angleIn
 void			subObjCalcSliceTimeBinDecays(LbUsFourByte currentTimeBin,
 					LbUsFourByte sliceIndex);
 Boolean			subObjAllocDecaySlice(LbUsFourByte sliceIndex);
+Boolean			subObjBuildAliasTables(LbUsFourByte currentTimeBin);
+void			subObjBuildAliasTable(subObjAliasEntryTy *table, LbUsFourByte numEntries,
+					LbUsFourByte *workList);
+LbUsFourByte	subObjSampleAliasTable(subObjAliasEntryTy *table, LbUsFourByte numEntries);
+Boolean			subObjGetNextAliasDecay(void);
+void			subObjFreeAliasTables(void);
+void			subObjLayOutIndexes(void);
+Boolean			subObjAllocIndexVolume(SubObjIndexVolumeTy *volumePtr);
+Boolean			subObjMapIndexVolume(FILE *indexFile, SubObjIndexVolumeTy *volumePtr);
+void			subObjReleaseIndexVolume(SubObjIndexVolumeTy *volumePtr);
+Boolean			subObjIndexesAreSwapped(LbUsFourByte *indexes, LbUsFourByte numIndexes);
+void			subObjSwapIndexes(SubObjIndexVolumeTy *volumePtr);
+Boolean			subObjPackIndexes(SubObjIndexVolumeTy *volumePtr);
 Boolean			subObjInitCoherentTbl(void);
 Boolean			subObjInitCoherentBinaryTbl(void);
 void			subObjPrintStatus(void);
@@ -555,6 +607,91 @@ Boolean	SubObjGetObjGeometry(LbPfHkTy paramFlHk, LbUsFourByte numParams)
 }
 
 
+/*********************************************************************************
+*
+*			Name:		SubObjGetInteractionInObj2
+*
+*			Summary:	Get the interaction values in the object for a given
+*						material and photon energy.  The coherent modelling
+*						choice was resolved when the tables were created.
+*			Arguments:
+*			LbUsFourByte	index	- The tissue index.
+*			double			energy	- The tissue energy.
+*
+*			Function return: The attenuation, scatter and compton probabilities.
+*
+*********************************************************************************/
+SubObjInteractionTy	*SubObjGetInteractionInObj2(LbUsFourByte index, double energy)
+{
+	LbUsFourByte	energyIndex;		/* Energy index */
+	
+	/* Convert energy to tissue index */
+	energyIndex = (LbUsFourByte) energy;
+	
+	/* Round up */
+	if ((energy - (LbUsFourByte) energy) > .5) {
+		energyIndex++;
+	}				
+	/* Subtract for lowest supported energy */
+	energyIndex -= PHG_MIN_PHOTON_ENERGY;
+	
+	return (&subObjAttenTableInObj[index][energyIndex]);
+}
+
+/*********************************************************************************
+*
+*			Name:		SubObjGetInteractionInTomo2
+*
+*			Summary:	Get the interaction values in the tomograph for a given
+*						material and photon energy.  The coherent modelling
+*						choice was resolved when the tables were created.
+*			Arguments:
+*			LbUsFourByte	index	- The tissue index.
+*			double			energy	- The tissue energy.
+*
+*			Function return: The attenuation, scatter and compton probabilities.
+*
+*********************************************************************************/
+SubObjInteractionTy	*SubObjGetInteractionInTomo2(LbUsFourByte index, double energy)
+{
+	LbUsFourByte	energyIndex;		/* Energy index */
+	
+	/* Convert energy to tissue index */
+	energyIndex = (LbUsFourByte) energy;
+	
+	/* Round up */
+	if ((energy - (LbUsFourByte) energy) > .5) {
+		energyIndex++;
+	}				
+	/* Subtract for lowest supported energy */
+	energyIndex -= PHG_MIN_PHOTON_ENERGY;
+	
+	return (&subObjAttenTableInTomo[index][energyIndex]);
+}
+
+/*********************************************************************************
+*
+*			Name:		SubObjGetInteractionInObj
+*
+*			Summary:	Get the interaction values for photon's current state.
+*			Arguments:
+*			PHG_TrackingPhoton	*trackingPhotonPtr	- Our photon
+*
+*			Function return: The attenuation, scatter and compton probabilities.
+*
+*********************************************************************************/
+SubObjInteractionTy	*SubObjGetInteractionInObj(PHG_TrackingPhoton *trackingPhotonPtr)
+{
+	LbUsFourByte	index;				/* The tissue index */
+
+	/* Get tissue index */
+	index = SUBOBJGetTissueIndex(trackingPhotonPtr);
+	if (index >= SubObjNumTissues)
+		PhgAbort("Index out of bounds for photon position (SubObjGetInteractionInObj)", true);
+	
+	return (SubObjGetInteractionInObj2(index, trackingPhotonPtr->energy));
+}
+
 /*********************************************************************************
 *
 *			Name:		SubObjGetProbScatterInObj2
@@ -570,32 +707,7 @@ Boolean	SubObjGetObjGeometry(LbPfHkTy paramFlHk, LbUsFourByte numParams)
 *********************************************************************************/
 double	SubObjGetProbScatterInObj2(LbUsFourByte index, double energy)
 {
-	double			probScatter;		/* Probability of coherent scatter */
-	LbUsFourByte	energyIndex;		/* Energy index */
-	
-	do { /* Process Loop  */
-		
-		/* Convert energy to tissue index */
-		energyIndex = (LbUsFourByte) energy;
-		
-		/* Round up */
-		if ((energy - (LbUsFourByte) energy) > .5) {
-			energyIndex++;
-		}				
-		/* Subtract for lowest supported energy */
-		energyIndex -= PHG_MIN_PHOTON_ENERGY;
-		
-		/* Get attenuation for given energy */
-		if (PHG_IsModelCoherentInObj()){
-			probScatter = SubObjTissueAttenTableCoh[index][energyIndex].probScatter;
-		}
-		else {
-			probScatter = SubObjTissueAttenTableNoCoh[index][energyIndex].probScatter;
-		}
-		
-	} while (false);
-	
-	return (probScatter);
+	return (SubObjGetInteractionInObj2(index, energy)->probScatter);
 }
 
 /*********************************************************************************
@@ -619,7 +731,7 @@ double	SubObjGetProbScatterInObj(PHG_TrackingPhoton *trackingPhotonPtr)
 	do { /* Process Loop  */
 		
 		/* Get tissue index */
-		index = SubObjObject[trackingPhotonPtr->sliceIndex].attenuationArray[(trackingPhotonPtr->yIndex*SubObjObject[trackingPhotonPtr->sliceIndex].attNumXBins)+trackingPhotonPtr->xIndex];
+		index = SUBOBJGetTissueIndex(trackingPhotonPtr);
 		if (index >= SubObjNumTissues)
 			PhgAbort("Index out of bounds for photon position (SubObjGetProbScatterInObj)", true);
 			
@@ -646,32 +758,7 @@ double	SubObjGetProbScatterInObj(PHG_TrackingPhoton *trackingPhotonPtr)
 *********************************************************************************/
 double	SubObjGetProbScatterInTomo2(LbUsFourByte index, double energy)
 {
-	double			probScatter;		/* Probability of coherent scatter */
-	LbUsFourByte	energyIndex;		/* Energy index */
-	
-	do { /* Process Loop  */
-		
-		/* Convert energy to tissue index */
-		energyIndex = (LbUsFourByte) energy;
-		
-		/* Round up */
-		if ((energy - (LbUsFourByte) energy) > .5) {
-			energyIndex++;
-		}				
-		/* Subtract for lowest supported energy */
-		energyIndex -= PHG_MIN_PHOTON_ENERGY;
-		
-		/* Get attenuation for given energy */
-		if (PHG_IsModelCoherentInTomo()){
-			probScatter = SubObjTissueAttenTableCoh[index][energyIndex].probScatter;
-		}
-		else {
-			probScatter = SubObjTissueAttenTableNoCoh[index][energyIndex].probScatter;
-		}
-		
-	} while (false);
-	
-	return (probScatter);
+	return (SubObjGetInteractionInTomo2(index, energy)->probScatter);
 }
 
 /*********************************************************************************
@@ -695,7 +782,7 @@ double	SubObjGetProbScatterInTomo(PHG_TrackingPhoton *trackingPhotonPtr)
 	do { /* Process Loop  */
 		
 		/* Get tissue index */
-		index = SubObjObject[trackingPhotonPtr->sliceIndex].attenuationArray[(trackingPhotonPtr->yIndex*SubObjObject[trackingPhotonPtr->sliceIndex].attNumXBins)+trackingPhotonPtr->xIndex];
+		index = SUBOBJGetTissueIndex(trackingPhotonPtr);
 		if (index >= SubObjNumTissues)
 			PhgAbort("Index out of bounds for photon position (SubObjGetProbScatterInTomo)", true);
 			
@@ -722,29 +809,7 @@ double	SubObjGetProbScatterInTomo(PHG_TrackingPhoton *trackingPhotonPtr)
 *********************************************************************************/
 double	SubObjGetProbComptToScatInTomo2(LbUsFourByte index, double energy)
 {
-	double			probComptonToScatter;	/* Probability of compton scatter */
-	LbUsFourByte	energyIndex;			/* Energy index */
-
-		
-	/* Convert energy to tissue index */
-	energyIndex = (LbUsFourByte) energy;
-	
-	/* Round up */
-	if ((energy - (LbUsFourByte) energy) > .5) {
-		energyIndex++;
-	}				
-	/* Subtract for lowest supported energy */
-	energyIndex -= PHG_MIN_PHOTON_ENERGY;
-	
-	/* Get attenuation for given energy */
-	if (PHG_IsModelCoherentInTomo()) {
-		probComptonToScatter = SubObjTissueAttenTableCoh[index][energyIndex].probComptonToScatter;
-	}
-	else {
-		probComptonToScatter = SubObjTissueAttenTableNoCoh[index][energyIndex].probComptonToScatter;
-	}
-	
-	return (probComptonToScatter);
+	return (SubObjGetInteractionInTomo2(index, energy)->probComptonToScatter);
 }
 
 /*********************************************************************************
@@ -762,29 +827,7 @@ double	SubObjGetProbComptToScatInTomo2(LbUsFourByte index, double energy)
 *********************************************************************************/
 double	SubObjGetProbComptToScatInObj2(LbUsFourByte index, double energy)
 {
-	double			probComptonToScatter;	/* Probability of compton scatter */
-	LbUsFourByte	energyIndex;			/* Energy index */
-
-		
-	/* Convert energy to tissue index */
-	energyIndex = (LbUsFourByte) energy;
-	
-	/* Round up */
-	if ((energy - (LbUsFourByte) energy) > .5) {
-		energyIndex++;
-	}				
-	/* Subtract for lowest supported energy */
-	energyIndex -= PHG_MIN_PHOTON_ENERGY;
-	
-	/* Get attenuation for given energy */
-	if (PHG_IsModelCoherentInObj()) {
-		probComptonToScatter = SubObjTissueAttenTableCoh[index][energyIndex].probComptonToScatter;
-	}
-	else {
-		probComptonToScatter = SubObjTissueAttenTableNoCoh[index][energyIndex].probComptonToScatter;
-	}
-	
-	return (probComptonToScatter);
+	return (SubObjGetInteractionInObj2(index, energy)->probComptonToScatter);
 }
 
 
@@ -807,7 +850,7 @@ double	SubObjGetProbComptToScatter(PHG_TrackingPhoton *trackingPhotonPtr)
 	
 	
 	/* Get tissue index */
-	index = SubObjObject[trackingPhotonPtr->sliceIndex].attenuationArray[(trackingPhotonPtr->yIndex*SubObjObject[trackingPhotonPtr->sliceIndex].attNumXBins)+trackingPhotonPtr->xIndex];
+	index = SUBOBJGetTissueIndex(trackingPhotonPtr);
 	
 	#ifdef PHG_DEBUG
 	if (index >= SubObjNumTissues)
@@ -822,9 +865,9 @@ double	SubObjGetProbComptToScatter(PHG_TrackingPhoton *trackingPhotonPtr)
 
 /*********************************************************************************
 *
-*		Name:		SubObjGetProbScatter
+*		Name:		SubObjGetInteraction
 *
-*		Summary:	Get probability of scatter, depending on modelingCohScatter, 
+*		Summary:	Get the interaction values, depending on modelingCohScatter, 
 *						given material and photon energy.
 *
 *		Arguments:
@@ -832,16 +875,15 @@ double	SubObjGetProbComptToScatter(PHG_TrackingPhoton *trackingPhotonPtr)
 *			double			energy				- The photon energy.
 *			Boolean			modelingCohScatter	- If coherent scatter is simulated.
 *
-*		Function return: Probability of a scatter.
+*		Function return: The attenuation, scatter and compton probabilities.
 *
 *********************************************************************************/
 
-double	SubObjGetProbScatter(LbUsFourByte index, double energy, 
+SubObjInteractionTy	*SubObjGetInteraction(LbUsFourByte index, double energy, 
 								Boolean modelingCohScatter)
 
 {
 	LbUsFourByte	energyIndex;		/* Energy index */
-	double			probScatter;		/* Probability of scatter */
 	
 	
 	/* Convert energy to tissue index (rounding up) */
@@ -852,15 +894,36 @@ double	SubObjGetProbScatter(LbUsFourByte index, double energy,
 		energyIndex = (LbUsFourByte)(energy - PHG_MIN_PHOTON_ENERGY + 0.5);
 	}
 	
-	/* Get scatter probability for the given energy */
+	/* Get the values for the given energy */
 	if (modelingCohScatter){
-		probScatter = SubObjTissueAttenTableCoh[index][energyIndex].probScatter;
+		return (&SubObjTissueAttenTableCoh[index][energyIndex]);
 	}
 	else {
-		probScatter = SubObjTissueAttenTableNoCoh[index][energyIndex].probScatter;
+		return (&SubObjTissueAttenTableNoCoh[index][energyIndex]);
 	}
-	
-	return (probScatter);
+}
+
+/*********************************************************************************
+*
+*		Name:		SubObjGetProbScatter
+*
+*		Summary:	Get probability of scatter, depending on modelingCohScatter, 
+*						given material and photon energy.
+*
+*		Arguments:
+*			LbUsFourByte	index				- The tissue index.
+*			double			energy				- The photon energy.
+*			Boolean			modelingCohScatter	- If coherent scatter is simulated.
+*
+*		Function return: Probability of a scatter.
+*
+*********************************************************************************/
+
+double	SubObjGetProbScatter(LbUsFourByte index, double energy, 
+								Boolean modelingCohScatter)
+
+{
+	return (SubObjGetInteraction(index, energy, modelingCohScatter)->probScatter);
 }
 
 /*********************************************************************************
@@ -884,27 +947,7 @@ double	SubObjGetProbComptonCondnl(LbUsFourByte index, double energy,
 									Boolean modelingCohScatter)
 
 {
-	LbUsFourByte	energyIndex;		/* Energy index */
-	double			probScatter;		/* Conditional probability of scatter */
-	
-	
-	/* Convert energy to tissue index (rounding up) */
-	if (energy <= PHG_MIN_PHOTON_ENERGY) {
-		energyIndex = 0;
-	}
-	else {
-		energyIndex = (LbUsFourByte)(energy - PHG_MIN_PHOTON_ENERGY + 0.5);
-	}
-	
-	/* Get conditional scatter probability for the given energy */
-	if (modelingCohScatter){
-		probScatter = SubObjTissueAttenTableCoh[index][energyIndex].probComptonToScatter;
-	}
-	else {
-		probScatter = SubObjTissueAttenTableNoCoh[index][energyIndex].probComptonToScatter;
-	}
-	
-	return (probScatter);
+	return (SubObjGetInteraction(index, energy, modelingCohScatter)->probComptonToScatter);
 }
 
 /*********************************************************************************
@@ -923,6 +966,32 @@ double	SubObjGetProbComptonCondnl(LbUsFourByte index, double energy,
 *********************************************************************************/
 void SubObjCalcTimeBinDecays(LbUsFourByte currentTimeBin,
 		LbUsEightByte numDecaysToSimulate)	
+{
+	SubObjCalcTimeBinDecayBlock(currentTimeBin, numDecaysToSimulate,
+		numDecaysToSimulate);
+}
+
+/*********************************************************************************
+*
+*			Name:			SubObjCalcTimeBinDecayBlock
+*
+*			Summary:		Calculate decay distribution for one block of the
+*							decays of the current simulation time bin.  Decay
+*							weights are scaled by the block's share of the
+*							decays, so the blocks sum to the whole simulation.
+*							May be called again once the previous block's
+*							decays have all been generated.
+*
+*			Arguments:
+*				LbUsFourByte	currentTimeBin			- The current time bin.
+*				LbUsEightByte	numBlockDecays			- Decays in the block.
+*				LbUsEightByte	numDecaysToSimulate		- Decays in all blocks.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void SubObjCalcTimeBinDecayBlock(LbUsFourByte currentTimeBin,
+		LbUsEightByte numBlockDecays, LbUsEightByte numDecaysToSimulate)	
 {
     double			sliceProductivity;			/* Productivity of a given slice */
     double			estimatedRealDetected;			/* Number of events that would be detected */
@@ -930,6 +999,23 @@ void SubObjCalcTimeBinDecays(LbUsFourByte currentTimeBin,
     LbUsFourByte	angleIndex;					/* Current angle */
     
     
+	/* If a previous block finished, its decay slice may be sized for the last slice */
+	if (!PHG_IsAliasDecaySampling() && (SubObjCurSliceIndex == SubObjNumSlices) &&
+			(SubObjGetNumActVoxels(SubObjNumSlices-1) != SubObjGetNumActVoxels(0))) {
+		
+		LbMmFree((void **)&(SubObjDecaySlice));
+		LbMmFree((void **)&(SubObjDecayWeightSlice));
+		
+		if (subObjAllocDecaySlice(0) == false) {
+			PhgAbort("Unable to allocate memory for first slice!", true);
+		}
+	}
+	
+	/* Save the block's share of the decays */
+	subObjBlockDecays = numBlockDecays;
+	subObjBlockStart = SubObjDecaysProcessed;
+	subObjDecayWeightScale = (double) numBlockDecays / (double) numDecaysToSimulate;
+	
     /* Clear counters */
     sliceProductivity = 0.0;
     estimatedRealDetected = 0.0;
@@ -963,18 +1049,31 @@ void SubObjCalcTimeBinDecays(LbUsFourByte currentTimeBin,
     
    	/* Verify we have a valid productivity situation */
    	if (estimatedRealDetected == 0) {
-		PhgAbort("Computed zero for estimated real decays, please check your object (SubObjCalcTimeBinDecays).",
+		PhgAbort("Computed zero for estimated real decays, please check your object (SubObjCalcTimeBinDecayBlock).",
 			false);
    	}
     
     /* Calculate subObjSimulatedDivRealDetected (Ratio of desired/real) */
-    subObjSimulatedDivRealDetected = numDecaysToSimulate/estimatedRealDetected;
+    subObjSimulatedDivRealDetected = numBlockDecays/estimatedRealDetected;
     
 	/* Clear count of "round ups" this is for statistical info and error checking */
     SubObjAngleRoundUpCount = 0;
 
-	/* Compute the slice time bin decays for slice zero */
-	subObjCalcSliceTimeBinDecays(subObjCurTimeBin, 0);    
+	if (PHG_IsAliasDecaySampling()) {
+		
+		/* Build the alias tables once per time bin; each block just samples them */
+		if ((subObjAliasVoxelTbl == 0) || (subObjAliasTimeBin != currentTimeBin)) {
+			if (subObjBuildAliasTables(currentTimeBin) == false) {
+				PhgAbort("Unable to build the decay alias tables (SubObjCalcTimeBinDecayBlock).", true);
+			}
+		}
+		
+		subObjAliasDecaysLeft = numBlockDecays;
+	}
+	else {
+		/* Compute the slice time bin decays for slice zero */
+		subObjCalcSliceTimeBinDecays(subObjCurTimeBin, 0);    
+	}
 
     /* Now reset current indexes because we'll be retreiving these decays next */
     SubObjCurSliceIndex = 0;
@@ -1037,7 +1136,7 @@ void subObjCalcSliceTimeBinDecays(LbUsFourByte currentTimeBin,
     
     	/* Compute total voxel activity */
     	voxelActivity = 
-			SubObjGetTissueActivity(SubObjObject[(sliceIndex)].activityArray[voxelIndex], 
+			SubObjGetTissueActivity(SUBOBJGetActIndex(sliceIndex, voxelIndex), 
 			currentTimeBin)
 	    	* voxelSize * SubObjCurTimeBinDuration;
     
@@ -1082,9 +1181,11 @@ void subObjCalcSliceTimeBinDecays(LbUsFourByte currentTimeBin,
 						SubObjAngleRoundUpCount++;
 					}
 	
-					/* Set decay weight to expected real decays divided by simulated decays */
+					/* Set decay weight to expected real decays divided by simulated decays,
+						scaled to the block's share of the decays
+					*/
 					SubObjDecayWeightSlice[(voxelIndex*PRODTBLGetNumAngleCells()) + angleIndex] = 
-						realDecaysInVoxelAng / numDecaysForCell;
+						(realDecaysInVoxelAng / numDecaysForCell) * subObjDecayWeightScale;
 	    		}
 
 	    		/* the following branch should never be used, but is here as safety precaution */
@@ -1362,7 +1463,7 @@ double	SubObjGetCohTheta(PHG_TrackingPhoton *trPhoton)
 	double			cosTheta;
 	
 	/* Get tissue index */
-	index = SubObjObject[trPhoton->sliceIndex].attenuationArray[(trPhoton->yIndex*SubObjObject[trPhoton->sliceIndex].attNumXBins)+trPhoton->xIndex];
+	index = SUBOBJGetTissueIndex(trPhoton);
 	
 	#ifdef PHG_DEBUG
 	if (index >= subObjNumCohMaterials)
@@ -1753,10 +1854,13 @@ Boolean	SubObjCreate()
 	LbUsFourByte	xIndex;						/* Current x index */
 	LbUsFourByte	yIndex;						/* Current y index */
 	LbUsFourByte	attenIndex;					/* Attenuation coefficient index */
+	double			tableEnergy;				/* Energy of an attenuation table line */
 	LbUsFourByte	tissueIndex;				/* Attenuation tissue index */
 	unsigned long	tissueIndexUSL;
 	LbUsFourByte	loopIndex;					/* Loop control variable */
 	LbUsFourByte	*attenuationTransTbl = 0;	/* Attenuation index translation table */
+	Boolean			*tissueIsUsed = 0;			/* Which materials appear in the object */
+	double			majorant;					/* Largest attenuation at an energy */
 	LbUsFourByte	*activityTransTbl = 0;		/* Activity index translation table */
 	LbUsFourByte	tissueIndexTranslation;		/* Translated value of tissue index */
 	unsigned long	tissueIndexTranslationUSL;
@@ -2035,7 +2139,7 @@ Boolean	SubObjCreate()
 					}
 					
 					/* Parse the string */
-					numColumns = sscanf(inputBuffer, " %lf %lf %lf %lf", &(SubObjTissueAttenTableCoh[tissueIndex][attenIndex].energy),
+					numColumns = sscanf(inputBuffer, " %lf %lf %lf %lf", &tableEnergy,
 								&(SubObjTissueAttenTableCoh[tissueIndex][attenIndex].attenuation),
 								&(SubObjTissueAttenTableCoh[tissueIndex][attenIndex].probScatter),
 								&(SubObjTissueAttenTableCoh[tissueIndex][attenIndex].probComptonToScatter));
@@ -2050,7 +2154,6 @@ Boolean	SubObjCreate()
 					}
 					
 					/* Copy  coherent data into non coherent table */
-					SubObjTissueAttenTableNoCoh[tissueIndex][attenIndex].energy = SubObjTissueAttenTableCoh[tissueIndex][attenIndex].energy;
 					SubObjTissueAttenTableNoCoh[tissueIndex][attenIndex].attenuation = SubObjTissueAttenTableCoh[tissueIndex][attenIndex].attenuation;
 					SubObjTissueAttenTableNoCoh[tissueIndex][attenIndex].probScatter = SubObjTissueAttenTableCoh[tissueIndex][attenIndex].probScatter;
 					SubObjTissueAttenTableNoCoh[tissueIndex][attenIndex].probComptonToScatter = SubObjTissueAttenTableCoh[tissueIndex][attenIndex].probComptonToScatter;
@@ -2071,6 +2174,25 @@ Boolean	SubObjCreate()
  					}
 				}
 			}
+			
+			/* Choose the object's and tomograph's tables once, rather than on every lookup */
+			subObjAttenTableInObj = (PHG_IsModelCoherentInObj() ?
+				SubObjTissueAttenTableCoh : SubObjTissueAttenTableNoCoh);
+			subObjAttenTableInTomo = (PHG_IsModelCoherentInTomo() ?
+				SubObjTissueAttenTableCoh : SubObjTissueAttenTableNoCoh);
+			
+			/* Transpose the object's attenuations so that all materials for an energy are contiguous */
+			if ((subObjAttenByEnergyInObj = (double *) LbMmAlloc(
+					sizeof(double) * SUBOBJ_NUM_ENERGY_BINS * SubObjNumTissues)) == 0) {
+				
+				goto FAIL;
+			}
+			for (attenIndex = 0; attenIndex < SUBOBJ_NUM_ENERGY_BINS; attenIndex++) {
+				for (tissueIndex = 0; tissueIndex < SubObjNumTissues; tissueIndex++) {
+					subObjAttenByEnergyInObj[(attenIndex * SubObjNumTissues) + tissueIndex] =
+						subObjAttenTableInObj[tissueIndex][attenIndex].attenuation;
+				}
+			}
 		}
 
 		/* Create the attenuation translation table */
@@ -2188,7 +2310,7 @@ Boolean	SubObjCreate()
 					for (xIndex = 0; xIndex < SubObjObject[sliceIndex].attNumXBins; xIndex++) {
 																	
 						/* Translate the voxel index */
-						tissueIndex = SubObjObject[sliceIndex].attenuationArray[
+						tissueIndex = SUBOBJGetAttSliceIndexes(sliceIndex)[
 							(yIndex * SubObjObject[sliceIndex].attNumXBins)
 							+ xIndex];
 							
@@ -2202,7 +2324,7 @@ Boolean	SubObjCreate()
 						}
 						
 						/* Stuff the translation value in the attenuation array */
-						SubObjObject[sliceIndex].attenuationArray[
+						SUBOBJGetAttSliceIndexes(sliceIndex)[
 							(yIndex * SubObjObject[sliceIndex].attNumXBins)
 							+ xIndex] = 
 							attenuationTransTbl[tissueIndex];				
@@ -2210,6 +2332,40 @@ Boolean	SubObjCreate()
 				}
 			}
 			
+			/* Woodcock tracking samples flights against the largest attenuation, at
+				each energy, of the materials that actually appear in the object
+			*/
+			if (PHG_IsWoodcockTracking()) {
+				if ((tissueIsUsed = (Boolean *) LbMmAlloc(sizeof(Boolean) * SubObjNumTissues)) == 0) {
+					goto FAIL;
+				}
+				for (tissueIndex = 0; tissueIndex < SubObjNumTissues; tissueIndex++) {
+					tissueIsUsed[tissueIndex] = false;
+				}
+				for (sliceIndex = 0; sliceIndex < SubObjNumSlices; sliceIndex++) {
+					for (loopIndex = 0; loopIndex < (SubObjObject[sliceIndex].attNumXBins *
+							SubObjObject[sliceIndex].attNumYBins); loopIndex++) {
+						
+						tissueIndex = SUBOBJGetAttIndex(sliceIndex, loopIndex);
+						if (tissueIndex < SubObjNumTissues) {
+							tissueIsUsed[tissueIndex] = true;
+						}
+					}
+				}
+				for (attenIndex = 0; attenIndex < SUBOBJ_NUM_ENERGY_BINS; attenIndex++) {
+					majorant = 0.0;
+					for (tissueIndex = 0; tissueIndex < SubObjNumTissues; tissueIndex++) {
+						if ((tissueIsUsed[tissueIndex]) &&
+								(subObjAttenTableInObj[tissueIndex][attenIndex].attenuation > majorant)) {
+							
+							majorant = subObjAttenTableInObj[tissueIndex][attenIndex].attenuation;
+						}
+					}
+					subObjMajorantInObj[attenIndex] = majorant;
+				}
+				LbMmFree((void **) &tissueIsUsed);
+			}
+			
 			/* Dump the attenuation image if they requested it. */
 			if (strlen(PhgRunTimeParams.PhgSubObjAttImgFilePath) != 0) {
 				
@@ -2342,7 +2498,7 @@ Boolean	SubObjCreate()
 					for (xIndex = 0; xIndex < SubObjObject[sliceIndex].actNumXBins; xIndex++) {
 						
 						/* Verify index will not be too large */
-						if (SubObjObject[sliceIndex].activityArray[
+						if (SUBOBJGetActSliceIndexes(sliceIndex)[
 								(yIndex * SubObjObject[sliceIndex].actNumXBins)
 								+ xIndex] > SUBOBJ_NUM_TISSUE_TRANSLATIONS) {
 								
@@ -2351,10 +2507,10 @@ Boolean	SubObjCreate()
 						}
 						
 						/* Translate the voxel index */
-						SubObjObject[sliceIndex].activityArray[
+						SUBOBJGetActSliceIndexes(sliceIndex)[
 							(yIndex * SubObjObject[sliceIndex].actNumXBins)
 							+ xIndex] = 
-							activityTransTbl[SubObjObject[sliceIndex].activityArray[
+							activityTransTbl[SUBOBJGetActSliceIndexes(sliceIndex)[
 							(yIndex * SubObjObject[sliceIndex].actNumXBins)
 							+ xIndex]];				
 					}
@@ -2422,6 +2578,15 @@ Boolean	SubObjCreate()
 			/* Free the memory */
 			LbMmFree((void **)&activityTransTbl);
 		}
+		
+		/* Now that the indexes are final, store them in the narrowest size that holds them */
+		if (!subObjPackIndexes(&SubObjActIndexes)) {
+			goto FAIL;
+		}
+		
+		if (!subObjPackIndexes(&SubObjAttIndexes)) {
+			goto FAIL;
+		}
 
 		okay = true;
 		FAIL:;
@@ -2446,6 +2611,12 @@ Boolean	SubObjCreate()
 		if (SubObjTissueAttenTableCoh != 0) {
 			LbMmFree((void **) &SubObjTissueAttenTableCoh);
 		}
+		subObjAttenTableInObj = 0;
+		subObjAttenTableInTomo = 0;
+
+		if (subObjAttenByEnergyInObj != 0) {
+			LbMmFree((void **) &subObjAttenByEnergyInObj);
+		}
 
 		if (attenuationTransTbl != 0) {
 			LbMmFree((void **) &attenuationTransTbl);
@@ -2455,16 +2626,7 @@ Boolean	SubObjCreate()
 			LbMmFree((void **) &attenuationTransTbl);
 		}
 
-		for (sliceIndex = 0; sliceIndex < SubObjNumSlices; sliceIndex++) {
-		
-			if (SubObjObject[sliceIndex].activityArray != 0) {
-				LbMmFree((void **) &(SubObjObject[sliceIndex].activityArray));
-			}
-		
-			if (SubObjObject[sliceIndex].attenuationArray != 0) {
-				LbMmFree((void **) &(SubObjObject[sliceIndex].attenuationArray));
-			}
-		}
+		SubObjFreeIndexes();
 	}
 	
 	return (okay);
@@ -2510,6 +2672,21 @@ Boolean	subObjCreateObject()
 			goto FAIL;
 		}
 		
+		/* Map the index files when we can, otherwise read them into memory */
+		subObjLayOutIndexes();
+		
+		if (!subObjMapIndexVolume(actIndexFile, &SubObjActIndexes)) {
+			if (!subObjAllocIndexVolume(&SubObjActIndexes)) {
+				goto FAIL;
+			}
+		}
+		
+		if (!subObjMapIndexVolume(attIndexFile, &SubObjAttIndexes)) {
+			if (!subObjAllocIndexVolume(&SubObjAttIndexes)) {
+				goto FAIL;
+			}
+		}
+		
 		/* Calculate the computed values from those initialized by the parameter file */
 		for (sliceIndex = 0; sliceIndex < SubObjNumSlices; sliceIndex++) {
 
@@ -2569,24 +2746,9 @@ Boolean	subObjCreateObject()
 			SubObjObject[sliceIndex].attVoxelHeight = SubObjObject[sliceIndex].sliceHeight/
 				SubObjObject[sliceIndex].attNumYBins;
 
-			/* Allocate slices for activity slice */
-			if ((SubObjObject[sliceIndex].activityArray = (SubObjActVoxelTy *) LbMmAlloc(
-					(sizeof(SubObjActVoxelTy) * (SubObjObject[sliceIndex].actNumXBins * 
-					SubObjObject[sliceIndex].actNumYBins)))) == 0) {
-				
-				goto FAIL;
-			}
-	
-			/* Allocate slices for attenuation slice */
-			if ((SubObjObject[sliceIndex].attenuationArray = (LbUsFourByte *) LbMmAlloc(
-					(sizeof(LbUsFourByte) * (SubObjObject[sliceIndex].attNumXBins * 
-					SubObjObject[sliceIndex].attNumYBins)))) == 0) {
-				
-				goto FAIL;
-			}
-			
-			/* Read in activity index data */
-			for (yIndex = 0; yIndex < SubObjObject[sliceIndex].actNumYBins; yIndex++) {
+			/* Read in activity index data, unless the file is mapped */
+			for (yIndex = 0; (yIndex < SubObjObject[sliceIndex].actNumYBins) &&
+					!SubObjActIndexes.isMapped; yIndex++) {
 				
 				for (xIndex = 0; xIndex < SubObjObject[sliceIndex].actNumXBins; xIndex++) {
 				
@@ -2599,14 +2761,15 @@ Boolean	subObjCreateObject()
 					}
 					
 					/* Save the voxel index */
-					SubObjObject[sliceIndex].activityArray[
+					SUBOBJGetActSliceIndexes(sliceIndex)[
 					    (yIndex * SubObjObject[sliceIndex].actNumXBins)
 						+ xIndex] = voxelIndex;
 				}
 			}
 
-			/* Read  in attenuation index data */
-			for (yIndex = 0; yIndex < SubObjObject[sliceIndex].attNumYBins; yIndex++) {
+			/* Read  in attenuation index data, unless the file is mapped */
+			for (yIndex = 0; (yIndex < SubObjObject[sliceIndex].attNumYBins) &&
+					!SubObjAttIndexes.isMapped; yIndex++) {
 				
 				for (xIndex = 0; xIndex < SubObjObject[sliceIndex].attNumXBins; xIndex++) {
 										
@@ -2619,12 +2782,23 @@ Boolean	subObjCreateObject()
 					}
 					
 					/* Save the voxel index */
-					SubObjObject[sliceIndex].attenuationArray[
+					SUBOBJGetAttSliceIndexes(sliceIndex)[
 						(yIndex * SubObjObject[sliceIndex].attNumXBins)
 						+ xIndex] = voxelIndex;				
 				}
 			}
 		 }
+		
+		/* Files that were read may have been written with the opposite byte order */
+		if (!SubObjActIndexes.isMapped &&
+				subObjIndexesAreSwapped((LbUsFourByte *) SubObjActIndexes.voxels, SubObjActIndexes.numVoxels)) {
+			subObjSwapIndexes(&SubObjActIndexes);
+		}
+		
+		if (!SubObjAttIndexes.isMapped &&
+				subObjIndexesAreSwapped((LbUsFourByte *) SubObjAttIndexes.voxels, SubObjAttIndexes.numVoxels)) {
+			subObjSwapIndexes(&SubObjAttIndexes);
+		}
 
 		/* Verify that the slices are contiguous and of the same x/y dimension */
 		for (sliceIndex = 1; sliceIndex < (SubObjNumSlices); sliceIndex++) {
@@ -2713,15 +2887,7 @@ Boolean	subObjCreateObject()
 	
 	/* If we failed free any memory that was allocated */
 	if (!okay) {
-		for (sliceIndex = 0; sliceIndex < SubObjNumSlices; sliceIndex++) {
-			if (SubObjObject[sliceIndex].activityArray != 0) {
-				LbMmFree((void **) &(SubObjObject[sliceIndex].activityArray));
-			}
-			/* Allocate slices for activity slice */
-			if (SubObjObject[sliceIndex].attenuationArray != 0) {
-				LbMmFree((void **) &(SubObjObject[sliceIndex].attenuationArray));
-			}
-		}
+		SubObjFreeIndexes();
 	}
 	
 	return (okay);
@@ -2892,12 +3058,22 @@ Boolean	SubObjGenVoxAngCellDecay(PHG_Decay *newDecayPtr,
 	    #endif
 		
 		/* Setup next voxel decay */
-		if ((gotOne = subObjGetNextVoxAngCellDecay()) == false) {
+		if (PHG_IsAliasDecaySampling()) {
+			gotOne = subObjGetNextAliasDecay();
+		}
+		else {
+			gotOne = subObjGetNextVoxAngCellDecay();
+		}
+		
+		if (gotOne == false) {
 		
 			/* Note, to get a screen output of 100% always test to see if we need to print a message */
-			if (SubObjDecaysProcessed < PhgRunTimeParams.Phg_EventsToSimulate) {
-				SubObjDecaysProcessed = PhgRunTimeParams.Phg_EventsToSimulate;
-				subObjPrintStatus();
+			if ((SubObjDecaysProcessed - subObjBlockStart) < subObjBlockDecays) {
+				SubObjDecaysProcessed = subObjBlockStart + subObjBlockDecays;
+				
+				/* Worker processes report progress by block */
+				if (!PHGPAR_IsWorker())
+					subObjPrintStatus();
 			}
 			
 			/* Since there are no more decays, bust out of here */	
@@ -2908,7 +3084,8 @@ Boolean	SubObjGenVoxAngCellDecay(PHG_Decay *newDecayPtr,
 		SubObjDecaysProcessed++;
 
 		/* Print status report if we're at a 10% increment */
-		if ((SubObjDecaysProcessed % (PhgRunTimeParams.Phg_EventsToSimulate/10)) == 0)
+		if (!PHGPAR_IsWorker() &&
+				((SubObjDecaysProcessed % (PhgRunTimeParams.Phg_EventsToSimulate/10)) == 0))
 			subObjPrintStatus();
 			
 			
@@ -2999,8 +3176,13 @@ Boolean	SubObjGenVoxAngCellDecay(PHG_Decay *newDecayPtr,
 		}
 
 		/* Get the decay weight */
-		newDecayPtr->startWeight =
-			SubObjDecayWeightSlice[(SubObjCurVoxelIndex*PRODTBLGetNumAngleCells())+SubObjCurAngleIndex];
+		if (PHG_IsAliasDecaySampling()) {
+			newDecayPtr->startWeight = subObjAliasDecayWeight;
+		}
+		else {
+			newDecayPtr->startWeight =
+				SubObjDecayWeightSlice[(SubObjCurVoxelIndex*PRODTBLGetNumAngleCells())+SubObjCurAngleIndex];
+		}
 		
 		/* Set the decay time randomly within the scan */
 		newDecayPtr->decayTime = PhgMathGetDPRandomNumber() * 
@@ -3228,6 +3410,338 @@ Boolean	subObjGetNextVoxAngCellDecay()
 	return (gotOne);
 }
 
+/*********************************************************************************
+*
+*			Name:		subObjGetNextAliasDecay
+*
+*			Summary:	Sample the voxel and angle cell of the next decay from the
+*						alias tables.  Every decay is drawn independently, so
+*						blocks of decays need no state beyond their count.  The
+*						decay's weight is its expected real decays over its
+*						expected simulated decays, as for the stratified decays.
+*
+*			Arguments:
+*
+*			Function return: True if there is another decay in the block.
+*
+*********************************************************************************/
+Boolean	subObjGetNextAliasDecay()
+{
+	LbUsFourByte		voxelEntry;		/* Sampled voxel table entry */
+	subObjAliasEntryTy	*angleTbl;		/* Angle table of the sampled slice */
+	double				cellProb;		/* Probability of the sampled voxel/angle cell */
+	
+	if (subObjAliasDecaysLeft == 0) {
+		return (false);
+	}
+	subObjAliasDecaysLeft--;
+	
+	/* Sample the voxel, then the angle cell within its slice */
+	voxelEntry = subObjSampleAliasTable(subObjAliasVoxelTbl, subObjAliasNumVoxels);
+	SubObjCurSliceIndex = subObjAliasVoxels[voxelEntry].sliceIndex;
+	SubObjCurVoxelIndex = subObjAliasVoxels[voxelEntry].voxelIndex;
+	
+	angleTbl = subObjAliasAngleTbl + (SubObjCurSliceIndex * PRODTBLGetNumAngleCells());
+	SubObjCurAngleIndex = subObjSampleAliasTable(angleTbl, PRODTBLGetNumAngleCells());
+	
+	/* Expected simulated decays in the cell are the block's decays times its probability */
+	cellProb = subObjAliasVoxelTbl[voxelEntry].probability *
+		angleTbl[SubObjCurAngleIndex].probability;
+	
+	subObjAliasDecayWeight = (subObjVoxelCellGetNumReal(SubObjCurSliceIndex,
+		SubObjCurAngleIndex, SubObjCurVoxelIndex, 0) / (cellProb * subObjBlockDecays)) *
+		subObjDecayWeightScale;
+	
+	return (true);
+}
+
+/*********************************************************************************
+*
+*			Name:		subObjBuildAliasTables
+*
+*			Summary:	Build the alias tables decays are sampled from.  The
+*						probability of a voxel/angle cell is proportional to the
+*						decays the stratified sampling would simulate there: the
+*						voxel's activity times the angle cell's size and maximum
+*						productivity.  This factors into a table over the voxels
+*						with activity, weighted by their slice's productivity,
+*						and a table per slice over its angle cells.  Voxels
+*						without activity are left out.
+*
+*			Arguments:
+*				LbUsFourByte	currentTimeBin	- The current time bin.
+*
+*			Function return: True unless an allocation failed.
+*
+*********************************************************************************/
+Boolean	subObjBuildAliasTables(LbUsFourByte currentTimeBin)
+{
+	Boolean				okay = false;				/* Process flag */
+	double				*sliceProductivity = 0;		/* Productivity of each slice */
+	LbUsFourByte		*workList = 0;				/* Work space for building the tables */
+	double				voxelSize;					/* Size of a voxel in the slice */
+	double				voxelWeight;				/* Unnormalized weight of a voxel */
+	double				totalWeight;				/* Sum of the weights */
+	LbUsFourByte		numAngles;					/* Angle cells per slice */
+	LbUsFourByte		sliceIndex;					/* Current slice */
+	LbUsFourByte		voxelIndex;					/* Current voxel */
+	LbUsFourByte		angleIndex;					/* Current angle */
+	LbUsFourByte		entryIndex;					/* Current voxel table entry */
+	subObjAliasEntryTy	*angleTbl;					/* Angle table of the current slice */
+	
+	do { /* Process Loop */
+		
+		subObjFreeAliasTables();
+		
+		numAngles = PRODTBLGetNumAngleCells();
+		
+		/* Allocate the per slice storage */
+		if ((sliceProductivity = (double *) LbMmAlloc(sizeof(double) * SubObjNumSlices)) == 0) {
+			goto FAIL;
+		}
+		
+		if ((subObjAliasAngleTbl = (subObjAliasEntryTy *) LbMmAlloc(
+				sizeof(subObjAliasEntryTy) * SubObjNumSlices * numAngles)) == 0) {
+			goto FAIL;
+		}
+		
+		/* Weight each slice's angle cells by size and maximum productivity */
+		for (sliceIndex = 0; sliceIndex < SubObjNumSlices; sliceIndex++) {
+			angleTbl = subObjAliasAngleTbl + (sliceIndex * numAngles);
+			
+			sliceProductivity[sliceIndex] = 0.0;
+			for (angleIndex = 0; angleIndex < numAngles; angleIndex++) {
+				angleTbl[angleIndex].probability =
+					PRODTBLGetMaxCellProductivity(sliceIndex, angleIndex) *
+					(PRODTBLGetProdTblAngleSize(sliceIndex, angleIndex)/2);
+				
+				sliceProductivity[sliceIndex] += angleTbl[angleIndex].probability;
+			}
+			
+			/* Slices that can't be detected get no voxels, so their angle table is never used */
+			for (angleIndex = 0; angleIndex < numAngles; angleIndex++) {
+				if (sliceProductivity[sliceIndex] > 0.0) {
+					angleTbl[angleIndex].probability /= sliceProductivity[sliceIndex];
+				}
+				else {
+					angleTbl[angleIndex].probability = 1.0/numAngles;
+				}
+			}
+		}
+		
+		/* Count the voxels that produce decays */
+		subObjAliasNumVoxels = 0;
+		for (sliceIndex = 0; sliceIndex < SubObjNumSlices; sliceIndex++) {
+			if (sliceProductivity[sliceIndex] <= 0.0)
+				continue;
+			
+			for (voxelIndex = 0; voxelIndex < SubObjGetNumActVoxels(sliceIndex); voxelIndex++) {
+				if (SubObjGetTissueActivity(SUBOBJGetActIndex(sliceIndex, voxelIndex),
+						currentTimeBin) > 0.0) {
+					
+					subObjAliasNumVoxels++;
+				}
+			}
+		}
+		
+		if (subObjAliasNumVoxels == 0) {
+			ErStGeneric("No voxel of the object can produce a detected decay (subObjBuildAliasTables).");
+			goto FAIL;
+		}
+		
+		/* Allocate the voxel table */
+		if ((subObjAliasVoxelTbl = (subObjAliasEntryTy *) LbMmAlloc(
+				sizeof(subObjAliasEntryTy) * subObjAliasNumVoxels)) == 0) {
+			goto FAIL;
+		}
+		
+		if ((subObjAliasVoxels = (subObjAliasVoxelTy *) LbMmAlloc(
+				sizeof(subObjAliasVoxelTy) * subObjAliasNumVoxels)) == 0) {
+			goto FAIL;
+		}
+		
+		/* Weight each voxel by its activity and its slice's productivity */
+		entryIndex = 0;
+		totalWeight = 0.0;
+		for (sliceIndex = 0; sliceIndex < SubObjNumSlices; sliceIndex++) {
+			if (sliceProductivity[sliceIndex] <= 0.0)
+				continue;
+			
+			voxelSize = SubObjObject[sliceIndex].actVoxelWidth *
+				SubObjObject[sliceIndex].actVoxelHeight *
+				SubObjObject[sliceIndex].sliceDepth;
+			
+			for (voxelIndex = 0; voxelIndex < SubObjGetNumActVoxels(sliceIndex); voxelIndex++) {
+				voxelWeight = SubObjGetTissueActivity(SUBOBJGetActIndex(sliceIndex, voxelIndex),
+					currentTimeBin);
+				
+				if (voxelWeight > 0.0) {
+					voxelWeight *= voxelSize * SubObjCurTimeBinDuration *
+						sliceProductivity[sliceIndex];
+					
+					subObjAliasVoxelTbl[entryIndex].probability = voxelWeight;
+					subObjAliasVoxels[entryIndex].sliceIndex = sliceIndex;
+					subObjAliasVoxels[entryIndex].voxelIndex = voxelIndex;
+					
+					totalWeight += voxelWeight;
+					entryIndex++;
+				}
+			}
+		}
+		
+		for (entryIndex = 0; entryIndex < subObjAliasNumVoxels; entryIndex++) {
+			subObjAliasVoxelTbl[entryIndex].probability /= totalWeight;
+		}
+		
+		/* Build the tables, the work list is big enough for either */
+		if ((workList = (LbUsFourByte *) LbMmAlloc(sizeof(LbUsFourByte) *
+				((subObjAliasNumVoxels > numAngles) ? subObjAliasNumVoxels : numAngles))) == 0) {
+			goto FAIL;
+		}
+		
+		subObjBuildAliasTable(subObjAliasVoxelTbl, subObjAliasNumVoxels, workList);
+		
+		for (sliceIndex = 0; sliceIndex < SubObjNumSlices; sliceIndex++) {
+			subObjBuildAliasTable(subObjAliasAngleTbl + (sliceIndex * numAngles),
+				numAngles, workList);
+		}
+		
+		subObjAliasTimeBin = currentTimeBin;
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	if (sliceProductivity != 0)
+		LbMmFree((void **) &sliceProductivity);
+	
+	if (workList != 0)
+		LbMmFree((void **) &workList);
+	
+	if (!okay)
+		subObjFreeAliasTables();
+	
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:		subObjBuildAliasTable
+*
+*			Summary:	Fill in the thresholds and aliases of an alias table
+*						whose entry probabilities are set (Vose's method).
+*						Entries below the average probability are topped up from
+*						one above it, which becomes their alias.
+*
+*			Arguments:
+*				subObjAliasEntryTy	*table		- The table.
+*				LbUsFourByte		numEntries	- The number of entries.
+*				LbUsFourByte		*workList	- Space for numEntries indexes.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void subObjBuildAliasTable(subObjAliasEntryTy *table, LbUsFourByte numEntries,
+		LbUsFourByte *workList)
+{
+	LbUsFourByte	numSmall = 0;		/* Small entries, from the start of the work list */
+	LbUsFourByte	numLarge = 0;		/* Large entries, from the end of the work list */
+	LbUsFourByte	entryIndex;			/* Current entry */
+	LbUsFourByte	smallIndex;			/* Entry being topped up */
+	LbUsFourByte	largeIndex;			/* Entry topping it up */
+	
+	/* Scale the probabilities so the average is one */
+	for (entryIndex = 0; entryIndex < numEntries; entryIndex++) {
+		table[entryIndex].threshold = table[entryIndex].probability * numEntries;
+		table[entryIndex].alias = entryIndex;
+		
+		if (table[entryIndex].threshold < 1.0) {
+			workList[numSmall++] = entryIndex;
+		}
+		else {
+			workList[numEntries - ++numLarge] = entryIndex;
+		}
+	}
+	
+	/* Top up each small entry from a large one */
+	while ((numSmall > 0) && (numLarge > 0)) {
+		smallIndex = workList[--numSmall];
+		largeIndex = workList[numEntries - numLarge--];
+		
+		table[smallIndex].alias = largeIndex;
+		table[largeIndex].threshold -= (1.0 - table[smallIndex].threshold);
+		
+		if (table[largeIndex].threshold < 1.0) {
+			workList[numSmall++] = largeIndex;
+		}
+		else {
+			workList[numEntries - ++numLarge] = largeIndex;
+		}
+	}
+	
+	/* What is left is one up to rounding */
+	while (numSmall > 0) {
+		table[workList[--numSmall]].threshold = 1.0;
+	}
+	while (numLarge > 0) {
+		table[workList[numEntries - numLarge--]].threshold = 1.0;
+	}
+}
+
+/*********************************************************************************
+*
+*			Name:		subObjSampleAliasTable
+*
+*			Summary:	Sample an entry of an alias table using one random number.
+*
+*			Arguments:
+*				subObjAliasEntryTy	*table		- The table.
+*				LbUsFourByte		numEntries	- The number of entries.
+*
+*			Function return: The sampled entry.
+*
+*********************************************************************************/
+LbUsFourByte subObjSampleAliasTable(subObjAliasEntryTy *table, LbUsFourByte numEntries)
+{
+	double			scaledRand;		/* Random number scaled to the entries */
+	LbUsFourByte	entryIndex;		/* The uniformly chosen entry */
+	
+	scaledRand = PhgMathGetDPRandomNumber() * numEntries;
+	entryIndex = (LbUsFourByte) scaledRand;
+	if (entryIndex >= numEntries)
+		entryIndex = numEntries - 1;
+	
+	if ((scaledRand - entryIndex) < table[entryIndex].threshold)
+		return (entryIndex);
+	else
+		return (table[entryIndex].alias);
+}
+
+/*********************************************************************************
+*
+*			Name:		subObjFreeAliasTables
+*
+*			Summary:	Free the decay alias tables.
+*
+*			Arguments:
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void subObjFreeAliasTables()
+{
+	if (subObjAliasVoxelTbl != 0)
+		LbMmFree((void **) &subObjAliasVoxelTbl);
+	
+	if (subObjAliasVoxels != 0)
+		LbMmFree((void **) &subObjAliasVoxels);
+	
+	if (subObjAliasAngleTbl != 0)
+		LbMmFree((void **) &subObjAliasAngleTbl);
+	
+	subObjAliasNumVoxels = 0;
+}
+
 /*********************************************************************************
 *
 *			Name:		SubObjGetCellAttenuation
@@ -3275,7 +3789,7 @@ Boolean	SubObjGetCellAttenuation(LbFourByte sliceIndex,
 		
  
 	   	/* Get tissue index */
-		index = SubObjObject[sliceIndex].attenuationArray[(yIndex*SubObjObject[sliceIndex].attNumXBins)+xIndex];
+		index = SUBOBJGetAttIndex(sliceIndex, (yIndex*SubObjObject[sliceIndex].attNumXBins)+xIndex);
 		if (index >= SubObjNumTissues) {
 			sprintf(subObjErrStr, "Tissue index '%ld' retrieved for sliceIndex = %ld"
 				" xIndex = %ld and yIndex = %ld is greater than number of supported tissues = %ld (SubObjGetCellAttenuation)",
@@ -3382,12 +3896,84 @@ void	SubObjGetAttenuationInObj(LbFourByte materialIndex,
 	
 	
 	/* Get attenuation for given energy */
-	if (PHG_IsModelCoherentInObj()){
-		*attenPtr = SubObjTissueAttenTableCoh[materialIndex][energyIndex].attenuation;	
-	}
-	else {
-		*attenPtr = SubObjTissueAttenTableNoCoh[materialIndex][energyIndex].attenuation;	
-	}
+	*attenPtr = subObjAttenTableInObj[materialIndex][energyIndex].attenuation;
+}
+
+/*********************************************************************************
+*
+*			Name:		SubObjGetAttenuationsInObj
+*
+*			Summary:	Return the object's attenuation for every material at
+*						the given energy.  The values are contiguous, indexed by
+*						material, and identical to those of SubObjGetAttenuationInObj.
+*
+*			Arguments:
+*				double				energy			- The energy of the photon.
+*
+*			Function return: Attenuations indexed by material.
+*
+*********************************************************************************/
+double	*SubObjGetAttenuationsInObj(double energy)
+{
+	LbUsFourByte	energyIndex;		/* Energy index */
+	
+	/* Convert energy to tissue index */
+	energyIndex = ((LbUsFourByte) (energy + .499));
+		
+	#ifdef PHG_DEBUG
+		if (subObjIsInitialized == false) {
+			PhgAbort("\nYou are trying to call a SubObj routine before it is initialized\n", false);
+		}
+		
+		/* Verify we are within the supported energies */
+		if ((energyIndex < PHG_MIN_PHOTON_ENERGY) ||
+				((energyIndex - PHG_MIN_PHOTON_ENERGY) >= SUBOBJ_NUM_ENERGY_BINS)) {
+		
+			sprintf(subObjErrStr, "Invalid energy for attenuation retrieval.\t"
+				" energy = %f, integer index = %ld (SubObjGetAttenuationsInObj).",
+				energy, (unsigned long)energyIndex);
+				
+			PhgAbort(subObjErrStr, false);
+		}
+	#endif
+	
+	/* Subtract for lowest supported energy */
+	energyIndex -= PHG_MIN_PHOTON_ENERGY;
+	
+	return (&subObjAttenByEnergyInObj[energyIndex * SubObjNumTissues]);
+}
+
+/*********************************************************************************
+*
+*			Name:		SubObjGetMajorantInObj
+*
+*			Summary:	Return the largest attenuation, at the given energy, of
+*						the materials in the object.  Only valid when Woodcock
+*						tracking is on.
+*
+*			Arguments:
+*				double				energy			- The energy of the photon.
+*
+*			Function return: The majorant attenuation.
+*
+*********************************************************************************/
+double	SubObjGetMajorantInObj(double energy)
+{
+	LbUsFourByte	energyIndex;		/* Energy index */
+	
+	/* Convert energy to tissue index, as SubObjGetAttenuationInObj does */
+	energyIndex = ((LbUsFourByte) (energy + .499)) - PHG_MIN_PHOTON_ENERGY;
+	
+	#ifdef PHG_DEBUG
+		if (energyIndex >= SUBOBJ_NUM_ENERGY_BINS) {
+			sprintf(subObjErrStr, "Invalid energy for majorant retrieval.\t"
+				" energy = %f (SubObjGetMajorantInObj).", energy);
+				
+			PhgAbort(subObjErrStr, false);
+		}
+	#endif
+	
+	return (subObjMajorantInObj[energyIndex]);
 }
 
 /*********************************************************************************
@@ -3453,12 +4039,7 @@ void	SubObjGetAttenuationInTomo(LbFourByte materialIndex,
 	
 	
 	/* Get attenuation for given energy */
-	if (PHG_IsModelCoherentInTomo()){
-		*attenPtr = SubObjTissueAttenTableCoh[materialIndex][energyIndex].attenuation;	
-	}
-	else {
-		*attenPtr = SubObjTissueAttenTableNoCoh[materialIndex][energyIndex].attenuation;	
-	}
+	*attenPtr = subObjAttenTableInTomo[materialIndex][energyIndex].attenuation;
 }
 
 /*********************************************************************************
@@ -3751,6 +4332,7 @@ Boolean SubObjInitialize()
 		SubObjTissueTable.tissueValues = 0;
 		
 		SubObjDecaysProcessed = 0;
+		PhgParRegisterSum(&SubObjDecaysProcessed, PhgParEn_EightByte, 1);
 		
 		
 		/* Do some verification on subobject related parameters */
@@ -3819,7 +4401,7 @@ Boolean	SubObjGetCellPosRangeConstants(LbFourByte sliceIndex,
 		
  
 	   	/* Get tissue index */
-		index = SubObjObject[sliceIndex].attenuationArray[(yIndex*SubObjObject[sliceIndex].attNumXBins)+xIndex];
+		index = SUBOBJGetAttIndex(sliceIndex, (yIndex*SubObjObject[sliceIndex].attNumXBins)+xIndex);
 
 		#ifdef PHG_DEBUG
 		if (index >= SubObjNumTissues) {
@@ -3936,6 +4518,341 @@ void	subObjComputePosRangeConstants(	double atomicNumber, double atomicWeight,
 }
 
 
+/*********************************************************************************
+*
+*			Name:			SubObjAllocIndexes
+*
+*			Summary:		Allocate the activity and attenuation index volumes
+*							as four byte indexes, one contiguous block per volume,
+*							and set each slice's offset into them.  The slices'
+*							bin counts must already be set.
+*
+*			Arguments:
+*
+*			Function return: True unless an allocation failed.
+*
+*********************************************************************************/
+Boolean SubObjAllocIndexes()	
+{
+	Boolean			okay = false;		/* Process flag */
+	
+	do { /* Process Loop */
+		
+		subObjLayOutIndexes();
+		
+		/* Allocate the activity indexes */
+		if (!subObjAllocIndexVolume(&SubObjActIndexes)) {
+			goto FAIL;
+		}
+		
+		/* Allocate the attenuation indexes */
+		if (!subObjAllocIndexVolume(&SubObjAttIndexes)) {
+			goto FAIL;
+		}
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	if (!okay) {
+		SubObjFreeIndexes();
+	}
+	
+	return (okay);
+}
+
+/*********************************************************************************
+*
+*			Name:			SubObjFreeIndexes
+*
+*			Summary:		Free the activity and attenuation index volumes.
+*
+*			Arguments:
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void SubObjFreeIndexes()	
+{
+	subObjReleaseIndexVolume(&SubObjActIndexes);
+	SubObjActIndexes.numVoxels = 0;
+	
+	subObjReleaseIndexVolume(&SubObjAttIndexes);
+	SubObjAttIndexes.numVoxels = 0;
+}
+
+/*********************************************************************************
+*
+*			Name:			subObjLayOutIndexes
+*
+*			Summary:		Set each slice's offset into the index volumes, each
+*							slice following the one before it, and the number of
+*							voxels in each volume.  The slices' bin counts must
+*							already be set.
+*
+*			Arguments:
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void subObjLayOutIndexes()	
+{
+	LbUsFourByte	sliceIndex;			/* Current slice */
+	LbUsFourByte	numActVoxels = 0;	/* Activity voxels in all slices */
+	LbUsFourByte	numAttVoxels = 0;	/* Attenuation voxels in all slices */
+	
+	for (sliceIndex = 0; sliceIndex < SubObjNumSlices; sliceIndex++) {
+		SubObjObject[sliceIndex].actVoxelOffset = numActVoxels;
+		SubObjObject[sliceIndex].attVoxelOffset = numAttVoxels;
+		
+		numActVoxels += SubObjObject[sliceIndex].actNumXBins *
+			SubObjObject[sliceIndex].actNumYBins;
+		numAttVoxels += SubObjObject[sliceIndex].attNumXBins *
+			SubObjObject[sliceIndex].attNumYBins;
+	}
+	
+	SubObjActIndexes.numVoxels = numActVoxels;
+	SubObjAttIndexes.numVoxels = numAttVoxels;
+}
+
+/*********************************************************************************
+*
+*			Name:			subObjAllocIndexVolume
+*
+*			Summary:		Allocate four byte indexes for every voxel of an
+*							index volume.
+*
+*			Arguments:
+*				SubObjIndexVolumeTy	*volumePtr	- The index volume.
+*
+*			Function return: True unless the allocation failed.
+*
+*********************************************************************************/
+Boolean subObjAllocIndexVolume(SubObjIndexVolumeTy *volumePtr)	
+{
+	if ((volumePtr->voxels = LbMmAlloc(sizeof(LbUsFourByte) * volumePtr->numVoxels)) == 0) {
+		return (false);
+	}
+	volumePtr->indexSize = sizeof(LbUsFourByte);
+	volumePtr->isMapped = false;
+	
+	return (true);
+}
+
+/*********************************************************************************
+*
+*			Name:			subObjMapIndexVolume
+*
+*			Summary:		Map an index file as the four byte indexes of an
+*							index volume, rather than reading it into memory.
+*							The mapping is private: pages that are only read
+*							stay shared with every other process using the file,
+*							while any that are translated become copies.
+*							Files whose byte order differs from ours, or that
+*							can't be mapped, are left to be read instead.
+*
+*			Arguments:
+*				FILE				*indexFile	- The index file.
+*				SubObjIndexVolumeTy	*volumePtr	- The index volume.
+*
+*			Function return: True if the file was mapped.
+*
+*********************************************************************************/
+Boolean subObjMapIndexVolume(FILE *indexFile, SubObjIndexVolumeTy *volumePtr)	
+{
+#ifdef GEN_UNIX
+	struct stat		fileInfo;		/* Size of the index file */
+	size_t			mapSize;		/* Bytes to map */
+	void			*mapping;		/* The mapped indexes */
+	
+	mapSize = sizeof(LbUsFourByte) * (size_t) volumePtr->numVoxels;
+	
+	/* Short files are left for the read to report */
+	if ((mapSize == 0) || (fstat(fileno(indexFile), &fileInfo) != 0) ||
+			((size_t) fileInfo.st_size < mapSize)) {
+		return (false);
+	}
+	
+	mapping = mmap(0, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(indexFile), 0);
+	if (mapping == MAP_FAILED) {
+		return (false);
+	}
+	
+	if (subObjIndexesAreSwapped((LbUsFourByte *) mapping, volumePtr->numVoxels)) {
+		munmap(mapping, mapSize);
+		return (false);
+	}
+	
+	volumePtr->voxels = mapping;
+	volumePtr->indexSize = sizeof(LbUsFourByte);
+	volumePtr->isMapped = true;
+	
+	return (true);
+#else
+	return (false);
+#endif
+}
+
+/*********************************************************************************
+*
+*			Name:			subObjReleaseIndexVolume
+*
+*			Summary:		Free or unmap the indexes of an index volume.
+*
+*			Arguments:
+*				SubObjIndexVolumeTy	*volumePtr	- The index volume.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void subObjReleaseIndexVolume(SubObjIndexVolumeTy *volumePtr)	
+{
+	if (volumePtr->voxels == 0) {
+		return;
+	}
+	
+#ifdef GEN_UNIX
+	if (volumePtr->isMapped) {
+		munmap(volumePtr->voxels, sizeof(LbUsFourByte) * (size_t) volumePtr->numVoxels);
+		volumePtr->voxels = 0;
+		volumePtr->isMapped = false;
+		return;
+	}
+#endif
+	
+	LbMmFree((void **) &(volumePtr->voxels));
+}
+
+/*********************************************************************************
+*
+*			Name:			subObjIndexesAreSwapped
+*
+*			Summary:		Decide whether four byte indexes were written with the
+*							opposite byte order.  The index files carry no header,
+*							so this relies on real indexes being far below 2^24:
+*							the file is taken to be swapped when some index is
+*							that large but none are once their bytes are swapped.
+*
+*			Arguments:
+*				LbUsFourByte	*indexes	- The indexes.
+*				LbUsFourByte	numIndexes	- The number of indexes.
+*
+*			Function return: True if the indexes need their bytes swapped.
+*
+*********************************************************************************/
+Boolean subObjIndexesAreSwapped(LbUsFourByte *indexes, LbUsFourByte numIndexes)	
+{
+	LbUsFourByte	voxelIndex;		/* Current voxel */
+	LbUsFourByte	maxIndex = 0;	/* Largest index as stored */
+	LbUsFourByte	swappedIndex;	/* An index with its bytes swapped */
+	
+	for (voxelIndex = 0; voxelIndex < numIndexes; voxelIndex++) {
+		if (indexes[voxelIndex] > maxIndex)
+			maxIndex = indexes[voxelIndex];
+	}
+	
+	if (maxIndex < SUBOBJ_MAX_PLAUSIBLE_INDEX) {
+		return (false);
+	}
+	
+	for (voxelIndex = 0; voxelIndex < numIndexes; voxelIndex++) {
+		LbCvSwap((char *) &(indexes[voxelIndex]), (char *) &swappedIndex, sizeof(LbUsFourByte));
+		
+		if (swappedIndex >= SUBOBJ_MAX_PLAUSIBLE_INDEX) {
+			return (false);
+		}
+	}
+	
+	return (true);
+}
+
+/*********************************************************************************
+*
+*			Name:			subObjSwapIndexes
+*
+*			Summary:		Swap the bytes of a four byte index volume read from a
+*							file written with the opposite byte order.
+*
+*			Arguments:
+*				SubObjIndexVolumeTy	*volumePtr	- The index volume.
+*
+*			Function return: None.
+*
+*********************************************************************************/
+void subObjSwapIndexes(SubObjIndexVolumeTy *volumePtr)	
+{
+	LbUsFourByte	*indexes;		/* The four byte indexes */
+	LbUsFourByte	voxelIndex;		/* Current voxel */
+	LbUsFourByte	swappedIndex;	/* An index with its bytes swapped */
+	
+	indexes = (LbUsFourByte *) volumePtr->voxels;
+	
+	for (voxelIndex = 0; voxelIndex < volumePtr->numVoxels; voxelIndex++) {
+		LbCvSwap((char *) &(indexes[voxelIndex]), (char *) &swappedIndex, sizeof(LbUsFourByte));
+		indexes[voxelIndex] = swappedIndex;
+	}
+}
+
+/*********************************************************************************
+*
+*			Name:			subObjPackIndexes
+*
+*			Summary:		Repack a four byte index volume into the narrowest
+*							index size that holds its largest index.  A mapped
+*							volume that still needs four bytes stays mapped.
+*
+*			Arguments:
+*				SubObjIndexVolumeTy	*volumePtr	- The index volume.
+*
+*			Function return: True unless an allocation failed.
+*
+*********************************************************************************/
+Boolean subObjPackIndexes(SubObjIndexVolumeTy *volumePtr)	
+{
+	LbUsFourByte	*wideVoxels;	/* The four byte indexes */
+	LbUsFourByte	maxIndex = 0;	/* Largest index in the volume */
+	LbUsFourByte	voxelIndex;		/* Current voxel */
+	void			*packedVoxels;	/* The packed indexes */
+	
+	wideVoxels = (LbUsFourByte *) volumePtr->voxels;
+	
+	for (voxelIndex = 0; voxelIndex < volumePtr->numVoxels; voxelIndex++) {
+		if (wideVoxels[voxelIndex] > maxIndex)
+			maxIndex = wideVoxels[voxelIndex];
+	}
+	
+	/* Leave four byte volumes as they are */
+	if (maxIndex > USHRT_MAX) {
+		return (true);
+	}
+	
+	if (maxIndex <= UCHAR_MAX) {
+		if ((packedVoxels = LbMmAlloc(sizeof(LbUsOneByte) * volumePtr->numVoxels)) == 0) {
+			return (false);
+		}
+		
+		for (voxelIndex = 0; voxelIndex < volumePtr->numVoxels; voxelIndex++) {
+			((LbUsOneByte *) packedVoxels)[voxelIndex] = (LbUsOneByte) wideVoxels[voxelIndex];
+		}
+		volumePtr->indexSize = sizeof(LbUsOneByte);
+	}
+	else {
+		if ((packedVoxels = LbMmAlloc(sizeof(LbUsTwoByte) * volumePtr->numVoxels)) == 0) {
+			return (false);
+		}
+		
+		for (voxelIndex = 0; voxelIndex < volumePtr->numVoxels; voxelIndex++) {
+			((LbUsTwoByte *) packedVoxels)[voxelIndex] = (LbUsTwoByte) wideVoxels[voxelIndex];
+		}
+		volumePtr->indexSize = sizeof(LbUsTwoByte);
+	}
+	
+	subObjReleaseIndexVolume(volumePtr);
+	volumePtr->voxels = packedVoxels;
+	
+	return (true);
+}
+
 /*********************************************************************************
 *
 *			Name:			SubObjTerminate
@@ -3949,23 +4866,13 @@ void	subObjComputePosRangeConstants(	double atomicNumber, double atomicWeight,
 *********************************************************************************/
 void SubObjTerminate()	
 {
-	LbUsFourByte	sliceIndex;				/* Current slice */
 	LbUsFourByte	tissueIndex;			/* The number of voxels */
 	
 	/* Only do this if we were initialized */
 	if (subObjIsInitialized) {
 		/* Free the activity arrays */
 		if (SubObjObject != 0) {
-			for (sliceIndex = 0; sliceIndex < SubObjNumSlices; sliceIndex++) {
-			
-				if (SubObjObject[sliceIndex].activityArray != 0) {
-					LbMmFree((void **) &(SubObjObject[sliceIndex].activityArray));
-				}
-			
-				if (SubObjObject[sliceIndex].attenuationArray != 0) {
-					LbMmFree((void **) &(SubObjObject[sliceIndex].attenuationArray));
-				}
-			}
+			SubObjFreeIndexes();
 	
 			LbMmFree((void **) &SubObjObject);
 		}
@@ -3977,6 +4884,9 @@ void SubObjTerminate()
 		if (SubObjDecayWeightSlice != 0){
 			LbMmFree((void **)&(SubObjDecayWeightSlice));
 		}
+		
+		/* Free the decay alias tables */
+		subObjFreeAliasTables();
 	
 		if (SubObjTissueTable.tissueValues != 0) {
 			for (tissueIndex = 0; tissueIndex < SubObjNumActIndexes; tissueIndex++) {
@@ -3991,6 +4901,11 @@ void SubObjTerminate()
 		
 		if (SubObjTissueAttenTableCoh != 0)
 			LbMmFree((void **)&(SubObjTissueAttenTableCoh));
+		subObjAttenTableInObj = 0;
+		subObjAttenTableInTomo = 0;
+		
+		if (subObjAttenByEnergyInObj != 0)
+			LbMmFree((void **)&(subObjAttenByEnergyInObj));
 		
 		if (subObjCohScatAngles != 0)
 			LbMmFree((void **)&(subObjCohScatAngles));
@@ -4031,7 +4946,7 @@ double subObjVoxelCellGetNumReal(LbUsFourByte sliceIndex, LbUsFourByte angleInde
 
 	/* Calculate the activity value for the voxel */
 	voxelActivity = (SUBOBJ_DECAYS_PER_CURIE * SubObjGetTissueActivity(
-		SubObjObject[sliceIndex].activityArray[voxelIndex], currentTime)
+		SUBOBJGetActIndex(sliceIndex, voxelIndex), currentTime)
 		* voxelSize * SubObjCurTimeBinDuration);
 		
 	/* Calculate the number of real decays for the voxel/cell */
@@ -4101,8 +5016,8 @@ void SubObjDumpObjects()
 		
 					/* Print out tissue index */
 					LbInPrintf("%d ",
-						SubObjObject[sliceIndex].activityArray[
-						(yIndex * SubObjObject[sliceIndex].actNumXBins) + xIndex]);
+						SUBOBJGetActIndex(sliceIndex,
+						(yIndex * SubObjObject[sliceIndex].actNumXBins) + xIndex));
 				}
 				LbInPrintf("\n");
 			}
@@ -4116,8 +5031,8 @@ void SubObjDumpObjects()
 					
 					/* Print out attenuation index */
 					LbInPrintf("(%ld) ",
-						(unsigned long)(SubObjObject[sliceIndex].attenuationArray[
-						(yIndex * SubObjObject[sliceIndex].attNumXBins) + xIndex]));
+						(unsigned long)(SUBOBJGetAttIndex(sliceIndex,
+						(yIndex * SubObjObject[sliceIndex].attNumXBins) + xIndex)));
 				}
 				LbInPrintf("\n");
 			}
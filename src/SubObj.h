@@ -105,6 +105,17 @@
 	/* Activity Object */
 typedef	LbUsFourByte				SubObjActVoxelTy;		/* A voxel is a tissue type, is an index */
 
+	/* Voxel indexes of every slice, stored one slice after another.  They are mapped
+		or read and translated as four byte indexes, then packed to the narrowest size
+		that holds the largest index.
+	*/
+typedef struct {
+	void				*voxels;			/* The indexes */
+	LbUsFourByte		indexSize;			/* Bytes per index: 1, 2 or 4 */
+	LbUsFourByte		numVoxels;			/* Number of voxels in all slices */
+	Boolean				isMapped;			/* Indexes are mapped from the index file */
+} SubObjIndexVolumeTy;
+
 
 	/* Time activity curve */
 typedef struct {
@@ -125,6 +136,13 @@ typedef struct {
 	SubObjTissueArrayTy	tissueValues;				/* Array of tissues */
 } SubObjTissueTableTy;
 
+	/* Interaction values of a material at one energy */
+typedef struct {
+	double	attenuation;							/* Attenuation coefficient */
+	double	probScatter;							/* Probability of compton + coherent */
+	double	probComptonToScatter;					/* Probability of compton/scatter */
+} SubObjInteractionTy;
+
 
 	/* Slice Information */
 typedef struct {
@@ -147,14 +165,16 @@ typedef struct {
 	LbUsFourByte		attNumXBins;		/* Number of x bins in attenuation object */
 	LbUsFourByte		attNumYBins;		/* Number of y bins in attenuation object */
 	double				sliceActivity;		/* Total activity in the slice */
-	SubObjActVoxelTy	*activityArray;		/* The voxel activity information */
-	LbUsFourByte		*attenuationArray;	/* The voxel attenuation information */
+	LbUsFourByte		actVoxelOffset;		/* First voxel of the slice in SubObjActIndexes */
+	LbUsFourByte		attVoxelOffset;		/* First voxel of the slice in SubObjAttIndexes */
 } SubObjSliceInfoTy;
 typedef SubObjSliceInfoTy	*SubObjSliceInfoArrayTy;
 
 /* GLOBALS */
 LOCALE	LbUsFourByte				SubObjNumSlices;			/* Number of slices in object */
 LOCALE	SubObjSliceInfoArrayTy		SubObjObject;				/* Our Object */
+LOCALE	SubObjIndexVolumeTy			SubObjActIndexes;			/* Activity index of every voxel */
+LOCALE	SubObjIndexVolumeTy			SubObjAttIndexes;			/* Attenuation index of every voxel */
 LOCALE	LbUsFourByte				SubObjCurSliceIndex;		/* Current slice index */
 LOCALE	LbUsFourByte				SubObjCurVoxelIndex;		/* Current voxel index */
 LOCALE	LbUsFourByte				SubObjCurAngleIndex;		/* Current angle index */
@@ -358,6 +378,84 @@ LOCALE	double						SubObjTotalRealDecays;		/* Total expected real-world decays *
 *********************************************************************************/
 #define SUBOBJGetSliceSliceHeight(sliceIndex) (SubObjObject[sliceIndex].sliceHeight)
 
+/*********************************************************************************
+*
+*			Name:		SUBOBJGetVolumeIndex
+*
+*			Summary:	Return the index of a voxel in an index volume, whatever
+*						size the indexes are stored in.
+*			Arguments:
+*				SubObjIndexVolumeTy	volume		- The index volume.
+*				LbUsFourByte		voxel		- The voxel's offset in the volume.
+*				
+*			Function return: LbUsFourByte, the index.
+*
+*********************************************************************************/
+#define SUBOBJGetVolumeIndex(volume, voxel) \
+	(((volume).indexSize == 1) ? (LbUsFourByte) ((LbUsOneByte *) (volume).voxels)[(voxel)] : \
+	(((volume).indexSize == 2) ? (LbUsFourByte) ((LbUsTwoByte *) (volume).voxels)[(voxel)] : \
+	((LbUsFourByte *) (volume).voxels)[(voxel)]))
+
+/*********************************************************************************
+*
+*			Name:		SUBOBJGetActIndex
+*
+*			Summary:	Return the activity index of a voxel in a slice.
+*			Arguments:
+*				LbUsFourByte	sliceIndex	- The slice.
+*				LbUsFourByte	voxelIndex	- The voxel, (yIndex * actNumXBins) + xIndex.
+*				
+*			Function return: LbUsFourByte, the activity index.
+*
+*********************************************************************************/
+#define SUBOBJGetActIndex(sliceIndex, voxelIndex) \
+	SUBOBJGetVolumeIndex(SubObjActIndexes, SubObjObject[sliceIndex].actVoxelOffset + (voxelIndex))
+
+/*********************************************************************************
+*
+*			Name:		SUBOBJGetAttIndex
+*
+*			Summary:	Return the attenuation index of a voxel in a slice.
+*			Arguments:
+*				LbUsFourByte	sliceIndex	- The slice.
+*				LbUsFourByte	voxelIndex	- The voxel, (yIndex * attNumXBins) + xIndex.
+*				
+*			Function return: LbUsFourByte, the attenuation index.
+*
+*********************************************************************************/
+#define SUBOBJGetAttIndex(sliceIndex, voxelIndex) \
+	SUBOBJGetVolumeIndex(SubObjAttIndexes, SubObjObject[sliceIndex].attVoxelOffset + (voxelIndex))
+
+/*********************************************************************************
+*
+*			Name:		SUBOBJGetActSliceIndexes
+*
+*			Summary:	Return the four byte activity indexes of a slice, for
+*						building the object before its indexes are packed.
+*			Arguments:
+*				LbUsFourByte	sliceIndex	- The slice.
+*				
+*			Function return: LbUsFourByte *, the slice's indexes.
+*
+*********************************************************************************/
+#define SUBOBJGetActSliceIndexes(sliceIndex) \
+	(((LbUsFourByte *) SubObjActIndexes.voxels) + SubObjObject[sliceIndex].actVoxelOffset)
+
+/*********************************************************************************
+*
+*			Name:		SUBOBJGetAttSliceIndexes
+*
+*			Summary:	Return the four byte attenuation indexes of a slice, for
+*						building the object before its indexes are packed.
+*			Arguments:
+*				LbUsFourByte	sliceIndex	- The slice.
+*				
+*			Function return: LbUsFourByte *, the slice's indexes.
+*
+*********************************************************************************/
+#define SUBOBJGetAttSliceIndexes(sliceIndex) \
+	(((LbUsFourByte *) SubObjAttIndexes.voxels) + SubObjObject[sliceIndex].attVoxelOffset)
+
 /*********************************************************************************
 *
 *			Name:		SUBOBJGetTissueIndex
@@ -366,10 +464,11 @@ LOCALE	double						SubObjTotalRealDecays;		/* Total expected real-world decays *
 *			Arguments:
 *				PHG_TrackingPhotonPtr	trPhoton.
 *				
-*			Function return: double, the slice's height.
+*			Function return: LbUsFourByte, the tissue index.
 *
 *********************************************************************************/
-#define SUBOBJGetTissueIndex(trPhoton) (SubObjObject[trPhoton->sliceIndex].attenuationArray[(trPhoton->yIndex*SubObjObject[trPhoton->sliceIndex].attNumXBins)+trPhoton->xIndex])
+#define SUBOBJGetTissueIndex(trPhoton) SUBOBJGetAttIndex(trPhoton->sliceIndex, \
+	(trPhoton->yIndex*SubObjObject[trPhoton->sliceIndex].attNumXBins)+trPhoton->xIndex)
 
 /*********************************************************************************
 *
@@ -415,6 +514,8 @@ void	SubObjGtPositionIndexes(PHG_Position *posPtr,
 			LbFourByte *yIndexPtr);
 void	SubObjCalcTimeBinDecays(LbUsFourByte currentTimeBin,
 			LbUsEightByte numberOfDecaysToSimulate);
+void	SubObjCalcTimeBinDecayBlock(LbUsFourByte currentTimeBin,
+			LbUsEightByte numBlockDecays, LbUsEightByte numberOfDecaysToSimulate);
 Boolean	SubObjCreate(void);
 Boolean	SubObjGenVoxAngCellDecay(PHG_Decay *newDecayPtr,
 			PHG_Direction *newDecayEmissionAnglePtr, LbFourByte *sliceIndexPtr,
@@ -424,6 +525,10 @@ Boolean	SubObjGetCellAttenuation(LbFourByte sliceIndex, LbFourByte xIndex,
 			LbFourByte yIndex, double energy, double *attenPtr);
 void	SubObjGetAttenuationInObj(LbFourByte materialIndex,
 			double energy, double *attenPtr);
+double	*SubObjGetAttenuationsInObj(double energy);
+double	SubObjGetMajorantInObj(double energy);
+Boolean	SubObjAllocIndexes(void);
+void	SubObjFreeIndexes(void);
 void	SubObjGetAttenuationInTomo(LbFourByte materialIndex,
 			double energy, double *attenPtr);
 void	SubObjGetInnerCellDistance(PHG_Position *posPtr, PHG_Direction *dirPtr,
@@ -444,6 +549,11 @@ double	SubObjGetProbScatter(LbUsFourByte index, double energy,
 double	SubObjGetProbComptonCondnl(LbUsFourByte index, double energy, 
 			Boolean modelingCohScatter);
 char *	SubObjGtAttenuationMaterialName(LbFourByte materialIndex);
+SubObjInteractionTy	*SubObjGetInteraction(LbUsFourByte index, double energy,
+			Boolean modelingCohScatter);
+SubObjInteractionTy	*SubObjGetInteractionInObj(PHG_TrackingPhoton *trackingPhotonPtr);
+SubObjInteractionTy	*SubObjGetInteractionInObj2(LbUsFourByte index, double energy);
+SubObjInteractionTy	*SubObjGetInteractionInTomo2(LbUsFourByte index, double energy);
 Boolean	SubObjGetStartingProdValues(ProdTblProdTblInfoTy *prodTableInfoPtr);
 Boolean	SubObjInitialize(void);
 void	SubObjTerminate(void);
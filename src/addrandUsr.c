@@ -25,6 +25,15 @@
 *								add system-specific detector/electronics 
 *								algorithms.
 *
+*								On Unix systems addrandoms may process the
+*								time windows of a sorted file on several
+*								threads, but not while addrandUsrModDecays1FPtr
+*								or addrandUsrModDecays2FPtr is set:  the windows
+*								are then processed serially, in time order, so
+*								these functions may keep their state in
+*								addrandUsrVars and write through the
+*								randoms-added file hook as before.
+*
 *			References:			
 *
 **********************************************************************************
@@ -17,13 +17,31 @@
 *		Date Originated:	15 Aug 2005
 *
 *		Module Overview:	Scan a previously sorted list mode file and add
-*							randoms, delete triples.
+*							randoms, delete triples.  The same time window
+*							processing is offered to bin as a stream of
+*							sorted decays (AdRandBeginStream), so randoms
+*							can be added while binning without writing the
+*							randoms-added file.
+*
+*							On Unix systems the time windows of a sorted
+*							history file are processed by several threads:
+*							the stream is partitioned at time window
+*							boundaries, each partition's windows are
+*							processed into its own buffer and the buffers
+*							are written out in time order.  They are
+*							processed serially when addrandUsrModDecays1FPtr
+*							or addrandUsrModDecays2FPtr is set, or when
+*							ADRAND_SERIAL_WINDOWS is defined.
 *
 *		References:			RandomsCodeChanges.doc
 *
 **********************************************************************************
 *
-*		Global functions defined:		None.
+*		Global functions defined:
+*				AdRandBeginStream
+*				AdRandAddDecay
+*				AdRandAddPhoton
+*				AdRandEndStream
 *
 *		Global macros defined:			None.
 *				
@@ -69,6 +87,16 @@
 
 #include "SystemDependent.h"
 
+/* Time windows of a sorted file are processed by several threads on Unix systems */
+#if defined(GEN_UNIX) && !defined(ADRAND_SERIAL_WINDOWS)
+	#define ADRAND_THREADED_WINDOWS
+#endif
+
+#ifdef ADRAND_THREADED_WINDOWS
+	#include <pthread.h>
+	#include <unistd.h>
+#endif
+
 #include "LbTypes.h"
 #include "LbError.h"
 #include "LbDebug.h"
@@ -112,9 +140,46 @@
 
 #define	ADRAND_NumFlags	2						/* Number of flags defined */
 
+#define	ADRAND_MAX_THREADS			8				/* Most threads processing time windows */
+#define	ADRAND_PARTITION_DECAYS		32768			/* Decays in a partition before it ends at the next time window */
+#define	ADRAND_PARTITION_BYTES		(4*1024*1024)	/* Starting size of a partition's buffers */
+
+#define	ADRAND_DecayRecord			1				/* Partition buffer record of a decay */
+#define	ADRAND_PhotonRecord			2				/* Partition buffer record of an input photon */
+#define	ADRAND_BlueRecord			3				/* Partition buffer record of a blue photon written out */
+#define	ADRAND_PinkRecord			4				/* Partition buffer record of a pink photon written out */
+
 /* LOCAL TYPES */
 typedef enum  {Null, Decay, Photon} EventTy;
 
+typedef struct {				/* Time window processing of the stream, or of a partition of it */
+	timeWindowDetectionsTy	window;					/* The decays, photons in current time window */
+	LbUsFourByte			curDecayNum;			/* Index of the last decay in the time window */
+	LbUsFourByte			numDecaysWritten;		/* Number of created random decays written out */
+	LbUsFourByte			numDecaysUnchanged;		/* Number of decays written out unchanged */
+	LbUsFourByte			numDecaysRandom;		/* Number of random decays created */
+	LbUsFourByte			numDecaysLostTriples;	/* Number of decays lost to the triples rule */
+	LbUsFourByte			histDecaysPerWindow[ADRAND_MaxTWDecays];	/* Histogram of decays per time window */
+	LbUsFourByte			numLostCorrectWindow;	/* Number randoms lost to the by-photon windowing */
+	LbUsOneByte				*outBuffer;				/* Records of the decays written out, or NULL to write them directly */
+	LbUsFourByte			outBufferSize;			/* Size of outBuffer */
+	LbUsFourByte			outBufferUsed;			/* Bytes of outBuffer used */
+	Boolean					isOkay;					/* False once buffering a decay has failed */
+} TimeWindowStateTy;
+
+typedef struct {				/* A run of whole time windows of the stream */
+	TimeWindowStateTy		state;					/* Processing of the partition's time windows */
+	LbUsOneByte				*events;				/* Records of the partition's decays and photons */
+	LbUsFourByte			eventsSize;				/* Size of events */
+	LbUsFourByte			eventsUsed;				/* Bytes of events used */
+	LbUsFourByte			numDecays;				/* Number of decays in events */
+	Boolean					isFileStart;			/* Does the partition start the file? */
+	#ifdef ADRAND_THREADED_WINDOWS
+	pthread_t				thread;					/* Thread processing the partition */
+	Boolean					isThreaded;				/* Is the partition processed by thread? */
+	#endif
+} WindowPartitionTy;
+
 /* LOCAL GLOBALS */
 static Boolean				adrandCancelled;				/* Global cancellation flag */
 static Boolean				adrandDoRandoms = false;		/* True randoms should be done */
@@ -128,30 +193,67 @@ static char					adrandRandomsFileName[256];		/* Name of output randoms history f
 static char					adrandHistParamsName[256];		/* Name of history parameters file */
 static double				adrandTimingWindow = 0.0;		/* the coincidence timing window in seconds */
 static LbUsFourByte			adrandArgIndex;					/* Index through command line arguments */
-static timeWindowDetectionsTy	timeWindowDetections;		/* The decays, photons in current time window */
 static PhoHFileHdrTy		adrandHdrParams;				/* Input header */
 /*static LbHdrHkTy			adrandHeaderHk;*/					/* Hook to original history file header */
 static PhoHFileHkTy			adrandHistParamsHk;				/* Hook to custom history file information */
 static PhoHFileHkTy			adrandHistHk;					/* Hook to input  sorted history file */
 static PhoHFileHkTy			adrandRandomsFileHk;			/* Hook to randoms list mode file */
 static LbUsFourByte			numDecaysRead;					/* Number of decays read in so far */
-static LbUsFourByte			numDecaysWritten;				/* Number of created random decays written out */
-static LbUsFourByte			numDecaysUnchanged;				/* Number of decays written out unchanged */
-static LbUsFourByte			numDecaysRandom;				/* Number of random decays created */
-static LbUsFourByte			numDecaysLostTriples;			/* Number of decays lost to the triples rule */
-static LbUsFourByte			histDecaysPerWindow[ADRAND_MaxTWDecays];	/* Histogram of decays per time window */
-static LbUsFourByte			numLostCorrectWindow;			/* Number randoms lost to the by-photon windowing */
+static TimeWindowStateTy	adrandWindowState;				/* Serial time window processing, and the totals */
+static AdRandDecayFType		*adrandDecayFPtr = 0;			/* Receives the decays of a stream, if any */
+static LbUsFourByte			adrandNumThreads = 1;			/* Number of threads processing time windows */
+static WindowPartitionTy	*adrandPartitions = 0;			/* Two sets of adrandNumThreads partitions */
+static LbUsFourByte			adrandFillSet;					/* Set of partitions being read into */
+static LbUsFourByte			adrandNumFilled;				/* Number of partitions of the set read */
+static LbUsFourByte			adrandNumRunning;				/* Number of partitions of the other set being processed */
+static double				adrandLastDecayTime;			/* Time of the last decay read into a partition */
+static double				adrandLastDetectionTime;		/* Last detection time of its time window */
+#ifdef ADRAND_THREADED_WINDOWS
+static pthread_mutex_t		adrandMemoryLock = PTHREAD_MUTEX_INITIALIZER;	/* Serializes buffer allocation */
+#endif
 
 
 /* PROTOTYPES */
 Boolean			adrand(int argc, char *argv[]);
 Boolean 		adrandInitialize(int argc, char *argv[]);
 Boolean			adrandGetParams(void);
+void			adrandSaveParams(void);
 void			adrandTerminate(void);
 Boolean			adrandTest(char *argv[]);
 Boolean			adrandAddRandoms(char *argv[]);
+Boolean			adrandSetHeader(void);
+Boolean			adrandCreateRandomsFile(void);
+Boolean			adrandCloseRandomsFile(void);
+void			adrandClearCounts(TimeWindowStateTy *statePtr);
+void			adrandClearWindow(TimeWindowStateTy *statePtr);
 Boolean			adrandCreateRandomsList(void);
-Boolean 		adrandProcessTimeWindow(void);
+void			adrandAddDecay(TimeWindowStateTy *statePtr, PHG_Decay *decayPtr);
+void			adrandAddPhoton(TimeWindowStateTy *statePtr, PHG_DetectedPhoton *photonPtr);
+Boolean 		adrandProcessTimeWindow(TimeWindowStateTy *statePtr);
+void			adrandWriteDecay(TimeWindowStateTy *statePtr, PHG_Decay *decayPtr,
+					PHG_DetectedPhoton *bluePhotons, LbUsFourByte numBluePhotons,
+					PHG_DetectedPhoton *pinkPhotons, LbUsFourByte numPinkPhotons);
+void			adrandPassDecay(PHG_Decay *decayPtr,
+					PHG_DetectedPhoton *bluePhotons, LbUsFourByte numBluePhotons,
+					PHG_DetectedPhoton *pinkPhotons, LbUsFourByte numPinkPhotons);
+Boolean			adrandAppendRecord(LbUsOneByte **bufferPtr, LbUsFourByte *bufferSizePtr,
+					LbUsFourByte *bufferUsedPtr, LbUsOneByte recordType,
+					void *dataPtr, LbUsFourByte dataSize);
+Boolean			adrandBeginPartitions(void);
+Boolean			adrandPartitionDecay(PHG_Decay *decayPtr);
+Boolean			adrandPartitionPhoton(PHG_DetectedPhoton *photonPtr);
+Boolean			adrandStartPartitions(void);
+Boolean			adrandFinishPartitions(void);
+void			adrandReplayPartition(WindowPartitionTy *partitionPtr, TimeWindowStateTy *statePtr);
+void			adrandProcessPartition(WindowPartitionTy *partitionPtr);
+void			adrandProcessPartitionHere(WindowPartitionTy *partitionPtr);
+Boolean			adrandEndParallel(void);
+Boolean			adrandDrainPartition(WindowPartitionTy *partitionPtr);
+void			adrandEndPartitions(void);
+#ifdef ADRAND_THREADED_WINDOWS
+void			*adrandPartitionMain(void *partitionPtr);
+#endif
+void			adrandPrintReport(void);
 
 
 /* FUNCTIONS */
@@ -166,7 +268,6 @@ Boolean adrand(int argc, char *argv[])
 {
 	Boolean				okay = false;	/* Process Loop */
 					/* Error condition results unless this is changed in body */
-	LbUsFourByte	numDecays;			/* counter */
 	time_t 			curTime;			/* Current time for stamping execution date */
 	LbFourByte		argIndex;			/* Index through command line arguments */
 	char			executionTimeStr[33];
@@ -231,24 +332,7 @@ Boolean adrand(int argc, char *argv[])
 		}
 		
 		/* write out report for module */
-		LbInPrintf("\n\tNumber of decays read in: %d", numDecaysRead);
-		
-		LbInPrintf("\n\n\tNumber of decays written out: %d", numDecaysWritten);
-		LbInPrintf("\n\tOf the decays written out, %d were written out unchanged.", numDecaysUnchanged);
-		LbInPrintf("\n\tOf the decays written out, %d were randoms created by addrandoms.", numDecaysRandom);
-		
-		LbInPrintf("\n\n\tNumber of decays lost as triples: %d", numDecaysLostTriples);
-		LbInPrintf("\n\n\tNumber of decays lost to correct windowing: %d", numLostCorrectWindow);
-		
-		/* write out histogram of decays found per time window */
-		LbInPrintf("\n\n\tHistogram of the number of decays found per time window:");
-		LbInPrintf("\n\n\tTime windows with 1 decay  =\t\t%d", histDecaysPerWindow[0]);
-		for ( numDecays = 2; numDecays < ADRAND_MaxTWDecays; numDecays++ ) {
-			
-			LbInPrintf("\n\tTime windows with %d decays =\t\t%d", numDecays, histDecaysPerWindow[numDecays-1]);
-			
-		}
-		LbInPrintf("\n\tTime windows with %d or more decays =\t%d\n\n", numDecays, histDecaysPerWindow[numDecays-1]);
+		adrandPrintReport();
 
 		/* Get current time */
 		time(&curTime);
@@ -295,7 +379,6 @@ Boolean adrandInitialize(int argc, char *argv[])
 	LbUsFourByte		optArgFlags = (LBFlag0);
 	char				fileName[1024];		/* Name of param file */
 	LbFourByte			randSeed;
-	LbUsFourByte		numDecays;			/* counter */
 	
 	
 	do { /* Process Loop */
@@ -339,16 +422,7 @@ Boolean adrandInitialize(int argc, char *argv[])
 		
 		/* initialize counters */
 		numDecaysRead = 0;
-		numDecaysWritten = 0;
-		numDecaysUnchanged = 0;
-		numDecaysRandom = 0;
-		numDecaysLostTriples = 0;
-		numLostCorrectWindow = 0;
-		for ( numDecays = 0; numDecays < ADRAND_MaxTWDecays; numDecays++ ) {
-			
-			histDecaysPerWindow[numDecays] = 0;
-			
-		}
+		adrandClearCounts(&adrandWindowState);
 		
 		/* Initialize the math library */
 		/* NOTE:  Random numbers not known to be used in this program */
@@ -446,20 +520,7 @@ Boolean adrandGetParams()
 		}
 		
 		/* Save the randoms-processing related parameters to local variables. */
-		{
-			/* input history file name */
-			strcpy(adrandHistName, DetRunTimeParams[DetCurParams].DetHistoryFilePath);
-			/* custom history params */
-			strcpy(adrandHistParamsName, DetRunTimeParams[DetCurParams].DetHistoryParamsFilePath);
-			/* should randoms be done? */
-			adrandDoRandoms = DetRunTimeParams[DetCurParams].DoRandomsProcessing;
-			/* coincidence window - convert from nanoseconds to seconds as all times in tracking are seconds */
-			adrandTimingWindow = DetRunTimeParams[DetCurParams].CoincidenceTimingWindowNS * 1.0E-9;
-			/*	how do we handle triples? */
-			adrandTriplesMethod = DetRunTimeParams[DetCurParams].TriplesMethod;
-			/* output randoms-added list data */
-			strcpy( adrandRandomsFileName, DetRunTimeParams[DetCurParams].DetRandomsHistoryFilePath);
-		}
+		adrandSaveParams();
 		
 		okay = true;
 		FAIL:;
@@ -469,6 +530,35 @@ Boolean adrandGetParams()
 }
 
 
+/*********************************************************************************
+*
+*	Name:			adrandSaveParams
+*
+*	Summary:		Save the randoms-processing related detector parameters
+*					to local variables.
+*
+*	Arguments:		None.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void adrandSaveParams()	
+{
+	/* input history file name */
+	strcpy(adrandHistName, DetRunTimeParams[DetCurParams].DetHistoryFilePath);
+	/* custom history params */
+	strcpy(adrandHistParamsName, DetRunTimeParams[DetCurParams].DetHistoryParamsFilePath);
+	/* should randoms be done? */
+	adrandDoRandoms = DetRunTimeParams[DetCurParams].DoRandomsProcessing;
+	/* coincidence window - convert from nanoseconds to seconds as all times in tracking are seconds */
+	adrandTimingWindow = DetRunTimeParams[DetCurParams].CoincidenceTimingWindowNS * 1.0E-9;
+	/*	how do we handle triples? */
+	adrandTriplesMethod = DetRunTimeParams[DetCurParams].TriplesMethod;
+	/* output randoms-added list data */
+	strcpy( adrandRandomsFileName, DetRunTimeParams[DetCurParams].DetRandomsHistoryFilePath);
+}
+
+
 /**********************
 *	Name:		adrandTerminate
 *
@@ -561,6 +651,9 @@ Boolean adrandAddRandoms(char *argv[])
 	Boolean				okay = false;		/* Process flag (function return) */
 	LbUsFourByte		curFileIndex;		/* Current file index */
 	FILE				*historyFile;		/* The detector history file to add randoms to */
+	#ifdef ADRAND_THREADED_WINDOWS
+	long				numProcessors;		/* Processors available for time windows */
+	#endif
 	
 	
 	do { /* Process Loop */
@@ -568,6 +661,18 @@ Boolean adrandAddRandoms(char *argv[])
 		/* Process the files */
 		for (curFileIndex = 1; curFileIndex <= adrandNumToProc; curFileIndex++){
 			
+			/* Decide how many threads process the time windows; the user
+				hooks are given the shared randoms-added file hook and may keep
+				their own state, so they are only ever called serially */
+			adrandNumThreads = 1;
+			#ifdef ADRAND_THREADED_WINDOWS
+				numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+				if ((numProcessors > 1) && (addrandUsrModDecays1FPtr == NULL) &&
+						(addrandUsrModDecays2FPtr == NULL)) {
+					adrandNumThreads = PHGMATH_Min((LbUsFourByte) numProcessors, ADRAND_MAX_THREADS);
+				}
+			#endif
+			
 			/* open files and verify parameters */
 			{
 			
@@ -608,6 +713,7 @@ Boolean adrandAddRandoms(char *argv[])
 				}
 				
 				adrandHistHk.histFile = historyFile;
+				PhoHFileReadAhead(historyFile);
 				
 				/* Init header hook, read in input header and copy to output header and save it */
 				/* This will overwrite the DetRunTimeParams previously read in with those actually
@@ -619,62 +725,12 @@ Boolean adrandAddRandoms(char *argv[])
 					goto FAIL;
 				}
 				
-				/* Modify the parameters that are specific to addrandoms */
-				adrandHdrParams.H.DetRunTimeParams.DoRandomsProcessing = adrandDoRandoms;
-				/* convert timing window for header back to nanoseconds */
-				adrandHdrParams.H.DetRunTimeParams.CoincidenceTimingWindowNS = adrandTimingWindow * 1.0E9;
-				adrandHdrParams.H.DetRunTimeParams.TriplesMethod = adrandTriplesMethod;
-				strcpy( adrandHdrParams.H.DetRunTimeParams.DetRandomsHistoryFilePath, adrandRandomsFileName );
-				
-				/* Check that all the importance sampling features are off */
-				{
-					
-					if ( adrandHdrParams.H.PhgRunTimeParams.PhgIsCalcEventsToSimulate != true ) {
-						sprintf(adrandErrStr, "Data for randoms processing must be generated with num_to_simulate = 0.");
-						ErStFileError(adrandErrStr);
-						goto FAIL;
-					}
-						
-					if ( adrandHdrParams.H.PhgRunTimeParams.PhgIsForcedDetection ) {
-						sprintf(adrandErrStr, "Randoms processing is incompatible with Forced Detection.");
-						ErStFileError(adrandErrStr);
-						goto FAIL;
-					}
-						
-					if ( adrandHdrParams.H.PhgRunTimeParams.PhgIsStratification ) {
-						sprintf(adrandErrStr, "Randoms processing is incompatible with Stratification.");
-						ErStFileError(adrandErrStr);
-						goto FAIL;
-					}
-						
-					if ( adrandHdrParams.H.PhgRunTimeParams.PhgIsForcedNonAbsorbtion ) {
-						sprintf(adrandErrStr, "Randoms processing is incompatible with Forced Non-Absorption.");
-						ErStFileError(adrandErrStr);
-						goto FAIL;
-					}
-					
-					if ( adrandHdrParams.H.DetRunTimeParams.DoForcedInteraction ) {
-						sprintf(adrandErrStr, "Randoms processing is incompatible with Forced Interaction in detector.");
-						ErStFileError(adrandErrStr);
-						goto FAIL;
-					}
-					
-				}
-
-				/* Check that this is a simulate_PET_coincidences_plus_singles scan */
-				if ( adrandHdrParams.H.PhgRunTimeParams.PhgIsPETCoincPlusSingles != true ) {
-					sprintf(adrandErrStr, "Randoms processing requires simulate_PET_coincidences_plus_singles.");
-					ErStFileError(adrandErrStr);
-					goto FAIL;
-				}
-				
-				/* Check that this file has been time sorted */
-				if ( adrandHdrParams.H.isTimeSorted != true ) {
-					sprintf(adrandErrStr, "Randoms processing requires a time-sorted history file.");
-					ErStFileError(adrandErrStr);
+				/* Set the header for the output and check the input is fit for randoms */
+				if (adrandSetHeader() == false) {
+					/* Error should already have been reported */
 					goto FAIL;
 				}
-				
+
 				/* Open and initialize the custom history file parameters, if any */
 				{
 					
@@ -721,16 +777,12 @@ Boolean adrandAddRandoms(char *argv[])
 				}
 				
 				/* Open the randoms-added output file */
-				if (PhoHFileCreate(adrandRandomsFileName, "", 
-						adrandHdrParams.H.HdrKind, &adrandRandomsFileHk) == false) {
-					sprintf(adrandErrStr,"Unable to create output randoms file named:\n"
-						"'%s'\n"
-						" (adrandAddRandoms)",
-						adrandRandomsFileName);
-					ErStFileError(adrandErrStr);
+				if (adrandCreateRandomsFile() == false) {
+					/* Error should already have been reported */
 					goto FAIL;
 				}
 				
+				
 			}
 			
 			/* Create the list mode data with randoms */
@@ -740,38 +792,9 @@ Boolean adrandAddRandoms(char *argv[])
 			}
 			
 			/* write header to output randoms added file and close */
-			{
-				
-				/* mark the file as having randoms added */
-				adrandHdrParams.H.isRandomsAdded = true;
-				if (LbHdrStElem(&(adrandRandomsFileHk.headerHk), HDR_HISTORY_FILE_IS_RANDOMS_ADDED_ID,
-						sizeof(adrandHdrParams.H.isRandomsAdded),
-						(void *)&(adrandHdrParams.H.isRandomsAdded)) == false){
-					
-					sprintf(adrandErrStr,"Unable to set header 'randoms added indicator' parameter.");
-					ErStFileError(adrandErrStr);
-					goto FAIL;
-				}
-				
-				/* update the file header */
-				if (PhgHdrUpHeader(NULL, &adrandHdrParams, &(adrandRandomsFileHk.headerHk)) == false) {
-					sprintf(adrandErrStr, "Unable to write header to randoms added history file\n'%s'.",
-						adrandRandomsFileName);
-					ErStFileError(adrandErrStr);
-					goto FAIL;
-				}
-				
-				/* close the output file */
-				if (fclose(adrandRandomsFileHk.histFile) != 0) {
-					adrandRandomsFileHk.histFile = NULL;
-					sprintf(adrandErrStr,"Unable to close randoms added file named:\n"
-						"'%s'\n"
-						" (adrandAddRandoms)",
-						adrandRandomsFileName);
-					ErStFileError(adrandErrStr);
-					goto FAIL;
-				}
-				
+			if (adrandCloseRandomsFile() == false) {
+				/* Error should already have been reported */
+				goto FAIL;
 			}
 			
 			
@@ -822,6 +845,263 @@ Boolean adrandAddRandoms(char *argv[])
 }
 
 
+/*********************************************************************************
+*
+*	Name:			adrandSetHeader
+*
+*	Summary:		Set the addrandoms parameters in the input header, which
+*					becomes the header of the randoms-added output, and check
+*					that the input is fit for randoms processing.
+*
+*	Arguments:		None.
+*
+*	Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean adrandSetHeader()
+{
+	Boolean				okay = false;		/* Process flag (function return) */
+	
+	
+	do { /* Process Loop */
+		
+		/* Modify the parameters that are specific to addrandoms */
+		adrandHdrParams.H.DetRunTimeParams.DoRandomsProcessing = adrandDoRandoms;
+		/* convert timing window for header back to nanoseconds */
+		adrandHdrParams.H.DetRunTimeParams.CoincidenceTimingWindowNS = adrandTimingWindow * 1.0E9;
+		adrandHdrParams.H.DetRunTimeParams.TriplesMethod = adrandTriplesMethod;
+		strcpy( adrandHdrParams.H.DetRunTimeParams.DetRandomsHistoryFilePath, adrandRandomsFileName );
+	
+		/* Check that all the importance sampling features are off */
+		{
+		
+			if ( adrandHdrParams.H.PhgRunTimeParams.PhgIsCalcEventsToSimulate != true ) {
+				sprintf(adrandErrStr, "Data for randoms processing must be generated with num_to_simulate = 0.");
+				ErStFileError(adrandErrStr);
+				goto FAIL;
+			}
+			
+			if ( adrandHdrParams.H.PhgRunTimeParams.PhgIsForcedDetection ) {
+				sprintf(adrandErrStr, "Randoms processing is incompatible with Forced Detection.");
+				ErStFileError(adrandErrStr);
+				goto FAIL;
+			}
+			
+			if ( adrandHdrParams.H.PhgRunTimeParams.PhgIsStratification ) {
+				sprintf(adrandErrStr, "Randoms processing is incompatible with Stratification.");
+				ErStFileError(adrandErrStr);
+				goto FAIL;
+			}
+			
+			if ( adrandHdrParams.H.PhgRunTimeParams.PhgIsForcedNonAbsorbtion ) {
+				sprintf(adrandErrStr, "Randoms processing is incompatible with Forced Non-Absorption.");
+				ErStFileError(adrandErrStr);
+				goto FAIL;
+			}
+		
+			if ( adrandHdrParams.H.DetRunTimeParams.DoForcedInteraction ) {
+				sprintf(adrandErrStr, "Randoms processing is incompatible with Forced Interaction in detector.");
+				ErStFileError(adrandErrStr);
+				goto FAIL;
+			}
+		
+		}
+
+		/* Check that this is a simulate_PET_coincidences_plus_singles scan */
+		if ( adrandHdrParams.H.PhgRunTimeParams.PhgIsPETCoincPlusSingles != true ) {
+			sprintf(adrandErrStr, "Randoms processing requires simulate_PET_coincidences_plus_singles.");
+			ErStFileError(adrandErrStr);
+			goto FAIL;
+		}
+	
+		/* Check that this file has been time sorted */
+		if ( adrandHdrParams.H.isTimeSorted != true ) {
+			sprintf(adrandErrStr, "Randoms processing requires a time-sorted history file.");
+			ErStFileError(adrandErrStr);
+			goto FAIL;
+		}
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	
+	return (okay);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandCreateRandomsFile
+*
+*	Summary:		Create the randoms-added output file.
+*
+*	Arguments:		None.
+*
+*	Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean adrandCreateRandomsFile()
+{
+	Boolean				okay = false;		/* Process flag (function return) */
+	
+	
+	do { /* Process Loop */
+		
+		/* Open the randoms-added output file */
+		if (PhoHFileCreate(adrandRandomsFileName, "", 
+				adrandHdrParams.H.HdrKind, &adrandRandomsFileHk) == false) {
+			sprintf(adrandErrStr,"Unable to create output randoms file named:\n"
+				"'%s'\n"
+				" (adrandCreateRandomsFile)",
+				adrandRandomsFileName);
+			ErStFileError(adrandErrStr);
+			goto FAIL;
+		}
+		if (PhoHFileSetCompressed(&adrandRandomsFileHk, adrandHdrParams.H.isCompressed) == false) {
+			/* Error should already have been reported */
+			goto FAIL;
+		}
+		if (PhoHFileSetIndexedLike(&adrandRandomsFileHk, adrandHistName) == false) {
+			/* Error should already have been reported */
+			goto FAIL;
+		}
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	
+	return (okay);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandCloseRandomsFile
+*
+*	Summary:		Write the header to the randoms-added output file and
+*					close it.
+*
+*	Arguments:		None.
+*
+*	Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean adrandCloseRandomsFile()
+{
+	Boolean				okay = false;		/* Process flag (function return) */
+	
+	
+	do { /* Process Loop */
+		
+		/* mark the file as having randoms added */
+		adrandHdrParams.H.isRandomsAdded = true;
+		if (LbHdrStElem(&(adrandRandomsFileHk.headerHk), HDR_HISTORY_FILE_IS_RANDOMS_ADDED_ID,
+				sizeof(adrandHdrParams.H.isRandomsAdded),
+				(void *)&(adrandHdrParams.H.isRandomsAdded)) == false){
+	
+			sprintf(adrandErrStr,"Unable to set header 'randoms added indicator' parameter.");
+			ErStFileError(adrandErrStr);
+			goto FAIL;
+		}
+
+		/* write out the buffered records */
+		if (PhoHFileEndWrites(&adrandRandomsFileHk) == false) {
+			goto FAIL;
+		}
+
+		/* update the file header */
+		if (PhgHdrUpHeader(NULL, &adrandHdrParams, &(adrandRandomsFileHk.headerHk)) == false) {
+			sprintf(adrandErrStr, "Unable to write header to randoms added history file\n'%s'.",
+				adrandRandomsFileName);
+			ErStFileError(adrandErrStr);
+			goto FAIL;
+		}
+
+		/* close the output file */
+		if (fclose(adrandRandomsFileHk.histFile) != 0) {
+			adrandRandomsFileHk.histFile = NULL;
+			sprintf(adrandErrStr,"Unable to close randoms added file named:\n"
+				"'%s'\n"
+				" (adrandCloseRandomsFile)",
+				adrandRandomsFileName);
+			ErStFileError(adrandErrStr);
+			goto FAIL;
+		}
+		adrandRandomsFileHk.histFile = NULL;
+		
+		/* write its decay index, if requested */
+		if (PhoHFileEndIndex(&adrandRandomsFileHk) == false) {
+			goto FAIL;
+		}
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	
+	return (okay);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandClearCounts
+*
+*	Summary:		Clear the time window counters of a stream or partition.
+*
+*	Arguments:
+*		TimeWindowStateTy	*statePtr		- The time window processing.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void adrandClearCounts(TimeWindowStateTy *statePtr)
+{
+	LbUsFourByte		numDecays;			/* counter */
+	
+	
+	statePtr->numDecaysWritten = 0;
+	statePtr->numDecaysUnchanged = 0;
+	statePtr->numDecaysRandom = 0;
+	statePtr->numDecaysLostTriples = 0;
+	statePtr->numLostCorrectWindow = 0;
+	for ( numDecays = 0; numDecays < ADRAND_MaxTWDecays; numDecays++ ) {
+		
+		statePtr->histDecaysPerWindow[numDecays] = 0;
+		
+	}
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandClearWindow
+*
+*	Summary:		Empty the time window before the first decay.
+*
+*	Arguments:
+*		TimeWindowStateTy	*statePtr		- The time window processing.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void adrandClearWindow(TimeWindowStateTy *statePtr)
+{
+	LbUsFourByte		curDecayNum;		/* current decay counter */
+	
+	
+	statePtr->window.numDecays = 0;
+	statePtr->window.lastDetectionTime = 0.0;
+	for (curDecayNum = 0; curDecayNum < ADRAND_MaxTWDecays; curDecayNum++) {
+		statePtr->window.decays[curDecayNum].numBluePhotons = 0;
+		statePtr->window.decays[curDecayNum].numPinkPhotons = 0;
+	}
+	statePtr->curDecayNum = 0;
+}
+
+
 /*********************************************************************************
 *
 *	Name:			adrandCreateRandomsList
@@ -840,12 +1120,9 @@ Boolean adrandCreateRandomsList( )
 	#define				PROGRESScheckNum	1000000	/* number decays between progress displays */
 	
 	Boolean				okay = false;				/* Function return value */
-	double				photonDetectionTime;		/* time between beginning of scan and detection */
 	PHG_Decay			nextDecay;					/* Current decay data for input or output */
 	PHG_DetectedPhoton	nextPhoton;					/* Current photon data for input or output */
 	PhoHFileEventType	eventType;					/* Type of current event */
-	LbUsFourByte		curDecayNum;				/* current decay counter */
-	LbUsFourByte		curPhotonNum;				/* current photon number */
 	LbUsFourByte		progressDecayCounter;		/* decay count since last progress report check */
 	double				accumSecs;					/* Seconds since last progress display */
 	double				accumCPUSecs;				/* Total used CPU time */
@@ -883,30 +1160,37 @@ Boolean adrandCreateRandomsList( )
 	}
 	
 	/* initialize time window */
-	timeWindowDetections.numDecays = 0;
-	timeWindowDetections.lastDetectionTime = 0.0;
-	for (curDecayNum = 0; curDecayNum < ADRAND_MaxTWDecays; curDecayNum++) {
-		timeWindowDetections.decays[curDecayNum].numBluePhotons = 0;
-		timeWindowDetections.decays[curDecayNum].numPinkPhotons = 0;
+	adrandClearWindow(&adrandWindowState);
+	
+	/* read into partitions if their time windows are processed by threads */
+	if (adrandNumThreads > 1) {
+		if (adrandBeginPartitions() == false) {
+			/* Error should already have been reported */
+			goto FAIL;
+		}
 	}
-			
 
 	if (! adrandCustomFile) {
 		/* standard history file processing */
 		
 		/* Fill the first time window decay buffer */
 		{
-			eventType = PhoHFileReadEvent(adrandHistHk.histFile, &(timeWindowDetections.decays[0].decay), 
-							&nextPhoton);
+			eventType = PhoHFileReadEvent(adrandHistHk.histFile, &nextDecay, &nextPhoton);
 			if (eventType != Decay) {
 				ErStGeneric("Expected first event to be decay, and it wasn't.");
 				goto FAIL;
 			}
 			bytesReadIn += decaySize;
-			timeWindowDetections.numDecays++;
-			numDecaysRead = 1;
+			numDecaysRead = 0;
+			if (adrandNumThreads > 1) {
+				if (adrandPartitionDecay(&nextDecay) == false) {
+					goto FAIL;
+				}
+			}
+			else {
+				AdRandAddDecay(&nextDecay);
+			}
 			progressDecayCounter = 1;
-			curDecayNum = 0;
 		}
 		
 		/* Loop until the list mode file is empty */
@@ -918,26 +1202,14 @@ Boolean adrandCreateRandomsList( )
 				/* increment the number of input bytes read in */
 				bytesReadIn += photonSize;
 				
-				/* check if this photon extends our time window */
-				photonDetectionTime = timeWindowDetections.decays[curDecayNum].decay.decayTime +
-									nextPhoton.time_since_creation;
-									
-				if ( photonDetectionTime > timeWindowDetections.lastDetectionTime ) {
-					timeWindowDetections.lastDetectionTime = photonDetectionTime;
+				/* add the photon to its decay in the time window */
+				if (adrandNumThreads > 1) {
+					if (adrandPartitionPhoton(&nextPhoton) == false) {
+						goto FAIL;
+					}
 				}
-				
-				if ( PHG_IsBlue(&nextPhoton) ) {
-					
-					curPhotonNum = timeWindowDetections.decays[curDecayNum].numBluePhotons;
-					timeWindowDetections.decays[curDecayNum].bluePhotons[curPhotonNum] = nextPhoton;
-					timeWindowDetections.decays[curDecayNum].numBluePhotons += 1;
-					
-				} else {
-					
-					curPhotonNum = timeWindowDetections.decays[curDecayNum].numPinkPhotons;
-					timeWindowDetections.decays[curDecayNum].pinkPhotons[curPhotonNum] = nextPhoton;
-					timeWindowDetections.decays[curDecayNum].numPinkPhotons += 1;
-					
+				else {
+					AdRandAddPhoton(&nextPhoton);
 				}
 			}
 			
@@ -982,97 +1254,866 @@ Boolean adrandCreateRandomsList( )
 					
 				}
 				
-				if ( nextDecay.decayTime >= (timeWindowDetections.lastDetectionTime + adrandTimingWindow) ) {
-					
-					
-					/* process last time window */
-					adrandProcessTimeWindow();
+				/* add the decay to the time window, processing the window if it is past it */
+				if (adrandNumThreads > 1) {
+					if (adrandPartitionDecay(&nextDecay) == false) {
+						goto FAIL;
+					}
+				}
+				else {
+					AdRandAddDecay(&nextDecay);
+				}
+								
+			}
+		
+		}
+		
+		/* it is probable there are still decay(s) in the time window, flush them before leaving */
+		if (adrandNumThreads > 1) {
+			
+			/* process the last partition and write out all that are left */
+			if (adrandPartitions[(adrandFillSet * adrandNumThreads) + adrandNumFilled].numDecays > 0) {
+				adrandNumFilled++;
+			}
+			if ((adrandStartPartitions() == false) || (adrandFinishPartitions() == false)) {
+				goto FAIL;
+			}
+		}
+		else if ( adrandWindowState.window.numDecays > 0 ) {
+			adrandProcessTimeWindow(&adrandWindowState);
+		}
+		
+		/* print out final progress message */
+		if (LbTmStopTiming(&clockTiming, &realSecs, &cpuSecs)) {
+			accumSecs += realSecs;
+			accumCPUSecs += cpuSecs;
+			
+			/* Get current time */
+			time(&curTime);
+			
+			/* Convert time to string format */
+			strftime(timeStr, 31, "(%H:%M %e-%b-%y)", localtime(&curTime));
+			
+			/* Display a progress message */
+			LbInPrintf("%d MB read in,  CPU seconds = %3.0f %s.\n",
+				(int)(bytesReadIn/1024/1024), 
+				accumCPUSecs, timeStr);
+		}
 					
-					/* start new time window with the last decay */
-					timeWindowDetections.decays[0].decay = nextDecay;
-					timeWindowDetections.lastDetectionTime = nextDecay.decayTime;
-					timeWindowDetections.decays[0].numBluePhotons = 0;
-					timeWindowDetections.decays[0].numPinkPhotons = 0;				
-					timeWindowDetections.numDecays = 1;
-					numDecaysRead++;
-					curDecayNum = 0;
+		/* Report end of file creation */
+		{
+			/* Get current time */
+			time(&curTime);
+			
+			/* Convert time to string format */
+			strftime(timeStr, 31, "(%H:%M %e-%b-%y)", localtime(&curTime));
+			
+			/* Display first progress message */
+			LbInPrintf("******* Creation of randoms-added data complete %s *******\n",
+				timeStr);
+		}
+	}
+	
+	okay = true;
+	
+	FAIL:;
+	/* NOTE:  In case of failure, files may be left unclosed; therefore,
+		it is best to completely exit the program on failure and let the 
+		system clean up these files. */
+	
+	adrandEndPartitions();
+		
+	return (okay);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandAddDecay
+*
+*	Summary:		Add the next decay, in time order, to a time window.
+*					If it falls past the window, the window is processed
+*					first and the decay starts a new one.
+*
+*	Arguments:
+*		TimeWindowStateTy	*statePtr		- The time window processing.
+*		PHG_Decay			*decayPtr		- The decay.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void adrandAddDecay(TimeWindowStateTy *statePtr, PHG_Decay *decayPtr)
+{
+	if ( statePtr->window.numDecays == 0 ) {
+		
+		/* the first decay starts the first time window */
+		statePtr->window.decays[0].decay = *decayPtr;
+		statePtr->window.numDecays = 1;
+		statePtr->curDecayNum = 0;
+		
+	} else if ( decayPtr->decayTime >= (statePtr->window.lastDetectionTime + adrandTimingWindow) ) {
+		
+		
+		/* process last time window */
+		adrandProcessTimeWindow(statePtr);
+		
+		/* start new time window with the last decay */
+		statePtr->window.decays[0].decay = *decayPtr;
+		statePtr->window.lastDetectionTime = decayPtr->decayTime;
+		statePtr->window.decays[0].numBluePhotons = 0;
+		statePtr->window.decays[0].numPinkPhotons = 0;				
+		statePtr->window.numDecays = 1;
+		statePtr->curDecayNum = 0;
+	
+	} else if ( statePtr->window.numDecays < (ADRAND_MaxTWDecays - 1) ) {
+		
+		/* add decay to current time window */
+		statePtr->curDecayNum++;
+		statePtr->window.decays[statePtr->curDecayNum].decay = *decayPtr;
+		if ( decayPtr->decayTime > statePtr->window.lastDetectionTime )
+			statePtr->window.lastDetectionTime = decayPtr->decayTime;
+		statePtr->window.decays[statePtr->curDecayNum].numBluePhotons = 0;
+		statePtr->window.decays[statePtr->curDecayNum].numPinkPhotons = 0;				
+		statePtr->window.numDecays += 1;
+		
+	} else {
+		
+		/* place this decay as last decay in current time window, 
+		 bouncing previous last decay.  This is okay as long as one doesn't
+		 use a window with so many decays in it, e.g. currently all decays
+		 in the window will be dumped anyway as we reject triples. */
+		statePtr->window.decays[statePtr->curDecayNum].decay = *decayPtr;
+		if ( decayPtr->decayTime > statePtr->window.lastDetectionTime )
+			statePtr->window.lastDetectionTime = decayPtr->decayTime;
+		statePtr->window.decays[statePtr->curDecayNum].numBluePhotons = 0;
+		statePtr->window.decays[statePtr->curDecayNum].numPinkPhotons = 0;				
+		statePtr->window.numDecays = ADRAND_MaxTWDecays;
+		
+	}
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandAddPhoton
+*
+*	Summary:		Add a photon of the last decay added to a time window.
+*
+*	Arguments:
+*		TimeWindowStateTy	*statePtr		- The time window processing.
+*		PHG_DetectedPhoton	*photonPtr		- The photon.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void adrandAddPhoton(TimeWindowStateTy *statePtr, PHG_DetectedPhoton *photonPtr)
+{
+	double				photonDetectionTime;		/* time between beginning of scan and detection */
+	LbUsFourByte		curPhotonNum;				/* current photon number */
+	timeWindowDecayTy	*decayPtr;					/* the decay of the photon */
+	
+	
+	decayPtr = &(statePtr->window.decays[statePtr->curDecayNum]);
+	
+	/* check if this photon extends our time window */
+	photonDetectionTime = decayPtr->decay.decayTime + photonPtr->time_since_creation;
+						
+	if ( photonDetectionTime > statePtr->window.lastDetectionTime ) {
+		statePtr->window.lastDetectionTime = photonDetectionTime;
+	}
+	
+	if ( PHG_IsBlue(photonPtr) ) {
+		
+		curPhotonNum = decayPtr->numBluePhotons;
+		decayPtr->bluePhotons[curPhotonNum] = *photonPtr;
+		decayPtr->numBluePhotons += 1;
+		
+	} else {
+		
+		curPhotonNum = decayPtr->numPinkPhotons;
+		decayPtr->pinkPhotons[curPhotonNum] = *photonPtr;
+		decayPtr->numPinkPhotons += 1;
+		
+	}
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandAppendRecord
+*
+*	Summary:		Append a record, a type byte followed by its data, to a
+*					partition buffer, doubling the buffer if it is full.
+*
+*	Arguments:
+*		LbUsOneByte			**bufferPtr		- The buffer.
+*		LbUsFourByte		*bufferSizePtr	- The size of the buffer.
+*		LbUsFourByte		*bufferUsedPtr	- The bytes of the buffer used.
+*		LbUsOneByte			recordType		- The type of the record.
+*		void				*dataPtr		- The data of the record.
+*		LbUsFourByte		dataSize		- The size of the data.
+*
+*	Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean adrandAppendRecord(LbUsOneByte **bufferPtr, LbUsFourByte *bufferSizePtr,
+			LbUsFourByte *bufferUsedPtr, LbUsOneByte recordType,
+			void *dataPtr, LbUsFourByte dataSize)
+{
+	Boolean				okay = false;		/* Process flag (function return) */
+	LbUsOneByte			*newBuffer;			/* The doubled buffer */
+	
+	
+	do { /* Process Loop */
+		
+		if ((*bufferUsedPtr + 1 + dataSize) > *bufferSizePtr) {
+			
+			/* A partition ends at the first time window boundary past
+				ADRAND_PARTITION_DECAYS decays, so only a time window
+				that never closes can get this far; the caller then
+				goes on serially */
+			if (*bufferSizePtr >= 0x40000000) {
+				goto FAIL;
+			}
+			
+			/* Worker threads grow their output buffers too */
+			#ifdef ADRAND_THREADED_WINDOWS
+				pthread_mutex_lock(&adrandMemoryLock);
+			#endif
+			
+			newBuffer = (LbUsOneByte *) LbMmAlloc(2 * (*bufferSizePtr));
+			if (newBuffer != 0) {
+				memcpy(newBuffer, *bufferPtr, *bufferUsedPtr);
+				LbMmFree((void **) bufferPtr);
+			}
+			
+			#ifdef ADRAND_THREADED_WINDOWS
+				pthread_mutex_unlock(&adrandMemoryLock);
+			#endif
+			
+			if (newBuffer == 0) {
+				goto FAIL;
+			}
+			
+			*bufferPtr = newBuffer;
+			*bufferSizePtr = 2 * (*bufferSizePtr);
+		}
+		
+		(*bufferPtr)[*bufferUsedPtr] = recordType;
+		memcpy((*bufferPtr) + (*bufferUsedPtr) + 1, dataPtr, dataSize);
+		*bufferUsedPtr += 1 + dataSize;
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	
+	return (okay);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandBeginPartitions
+*
+*	Summary:		Allocate the partitions the sorted history file is read
+*					into: two sets of adrandNumThreads, one read into while
+*					the other's time windows are processed.
+*
+*	Arguments:		None.
+*
+*	Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean adrandBeginPartitions()
+{
+	Boolean				okay = false;		/* Process flag (function return) */
+	LbUsFourByte		partNum;			/* Current partition */
+	WindowPartitionTy	*partitionPtr;		/* The partition */
+	
+	
+	do { /* Process Loop */
+		
+		if ((adrandPartitions = (WindowPartitionTy *) LbMmAlloc(
+				2 * adrandNumThreads * sizeof(WindowPartitionTy))) == 0) {
+			goto FAIL;
+		}
+		
+		for (partNum = 0; partNum < (2 * adrandNumThreads); partNum++) {
+			partitionPtr = &adrandPartitions[partNum];
+			
+			if ((partitionPtr->events = (LbUsOneByte *) LbMmAlloc(ADRAND_PARTITION_BYTES)) == 0) {
+				goto FAIL;
+			}
+			partitionPtr->eventsSize = ADRAND_PARTITION_BYTES;
+			
+			if ((partitionPtr->state.outBuffer = (LbUsOneByte *) LbMmAlloc(ADRAND_PARTITION_BYTES)) == 0) {
+				goto FAIL;
+			}
+			partitionPtr->state.outBufferSize = ADRAND_PARTITION_BYTES;
+		}
+		
+		adrandFillSet = 0;
+		adrandNumFilled = 0;
+		adrandNumRunning = 0;
+		adrandLastDecayTime = 0.0;
+		adrandLastDetectionTime = 0.0;
+		adrandPartitions[0].isFileStart = true;
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	
+	return (okay);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandPartitionDecay
+*
+*	Summary:		Read the next decay into the current partition.  The
+*					time windows are followed as adrandAddDecay does; once
+*					the partition has ADRAND_PARTITION_DECAYS decays, a
+*					decay starting a new window starts the next partition.
+*					If the partition cannot hold the decay, the rest of
+*					the stream is processed serially (see adrandEndParallel).
+*
+*	Arguments:
+*		PHG_Decay			*decayPtr		- The decay.
+*
+*	Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean adrandPartitionDecay(PHG_Decay *decayPtr)
+{
+	Boolean				okay = false;		/* Process flag (function return) */
+	WindowPartitionTy	*partitionPtr;		/* The current partition */
+	
+	
+	do { /* Process Loop */
+		
+		partitionPtr = &adrandPartitions[(adrandFillSet * adrandNumThreads) + adrandNumFilled];
+		
+		if ( partitionPtr->isFileStart && (partitionPtr->numDecays == 0) ) {
+			
+			/* the first decay starts the first time window */
+			
+		} else if ( decayPtr->decayTime >= (adrandLastDetectionTime + adrandTimingWindow) ) {
+			
+			/* the decay starts a new time window, and maybe a new partition */
+			if ( partitionPtr->numDecays >= ADRAND_PARTITION_DECAYS ) {
+				adrandNumFilled++;
+				
+				if (adrandNumFilled == adrandNumThreads) {
+					if (adrandStartPartitions() == false) {
+						/* Error should already have been reported */
+						goto FAIL;
+					}
+				}
+				
+				partitionPtr = &adrandPartitions[(adrandFillSet * adrandNumThreads) + adrandNumFilled];
+			}
+			
+			adrandLastDetectionTime = decayPtr->decayTime;
+			
+		} else if ( decayPtr->decayTime > adrandLastDetectionTime ) {
+			
+			adrandLastDetectionTime = decayPtr->decayTime;
+			
+		}
+		
+		adrandLastDecayTime = decayPtr->decayTime;
+		numDecaysRead++;
+		partitionPtr->numDecays++;
+		
+		if (adrandAppendRecord(&partitionPtr->events, &partitionPtr->eventsSize,
+				&partitionPtr->eventsUsed, ADRAND_DecayRecord, decayPtr, sizeof(PHG_Decay)) == false) {
+			
+			if (adrandEndParallel() == false) {
+				/* Error should already have been reported */
+				goto FAIL;
+			}
+			adrandAddDecay(&adrandWindowState, decayPtr);
+		}
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	
+	return (okay);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandPartitionPhoton
+*
+*	Summary:		Read a photon of the last decay into the current partition.
+*					If the partition cannot hold the photon, the rest of
+*					the stream is processed serially (see adrandEndParallel).
+*
+*	Arguments:
+*		PHG_DetectedPhoton	*photonPtr		- The photon.
+*
+*	Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean adrandPartitionPhoton(PHG_DetectedPhoton *photonPtr)
+{
+	Boolean				okay = false;			/* Process flag (function return) */
+	double				photonDetectionTime;	/* time between beginning of scan and detection */
+	WindowPartitionTy	*partitionPtr;			/* The current partition */
+	
+	
+	do { /* Process Loop */
+		
+		/* check if this photon extends the time window */
+		photonDetectionTime = adrandLastDecayTime + photonPtr->time_since_creation;
+		
+		if ( photonDetectionTime > adrandLastDetectionTime ) {
+			adrandLastDetectionTime = photonDetectionTime;
+		}
+		
+		partitionPtr = &adrandPartitions[(adrandFillSet * adrandNumThreads) + adrandNumFilled];
+		
+		if (adrandAppendRecord(&partitionPtr->events, &partitionPtr->eventsSize,
+				&partitionPtr->eventsUsed, ADRAND_PhotonRecord, photonPtr,
+				sizeof(PHG_DetectedPhoton)) == false) {
+			
+			if (adrandEndParallel() == false) {
+				/* Error should already have been reported */
+				goto FAIL;
+			}
+			adrandAddPhoton(&adrandWindowState, photonPtr);
+		}
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	
+	return (okay);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandStartPartitions
+*
+*	Summary:		Finish the partitions being processed, then start
+*					processing the partitions read, each on its own thread
+*					where possible, and read into the other set.
+*
+*	Arguments:		None.
+*
+*	Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean adrandStartPartitions()
+{
+	Boolean				okay = false;		/* Process flag (function return) */
+	LbUsFourByte		partNum;			/* Current partition */
+	WindowPartitionTy	*partitionPtr;		/* The partition */
+	
+	
+	do { /* Process Loop */
+		
+		/* The earlier partitions are written out first */
+		if (adrandFinishPartitions() == false) {
+			/* Error should already have been reported */
+			goto FAIL;
+		}
+		
+		for (partNum = 0; partNum < adrandNumFilled; partNum++) {
+			partitionPtr = &adrandPartitions[(adrandFillSet * adrandNumThreads) + partNum];
+			
+			#ifdef ADRAND_THREADED_WINDOWS
+				partitionPtr->isThreaded = (pthread_create(&partitionPtr->thread, NULL,
+					adrandPartitionMain, partitionPtr) == 0);
+				
+				/* A partition whose thread does not start is processed here */
+				if (!partitionPtr->isThreaded)
+			#endif
+			{
+				adrandProcessPartition(partitionPtr);
+			}
+		}
+		
+		adrandNumRunning = adrandNumFilled;
+		adrandFillSet = 1 - adrandFillSet;
+		adrandNumFilled = 0;
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	
+	return (okay);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandFinishPartitions
+*
+*	Summary:		Wait for the partitions being processed and write out
+*					their decays in time order.
+*
+*	Arguments:		None.
+*
+*	Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean adrandFinishPartitions()
+{
+	Boolean				okay = false;		/* Process flag (function return) */
+	LbUsFourByte		partNum;			/* Current partition */
+	WindowPartitionTy	*partitionPtr;		/* The partition */
+	
+	
+	do { /* Process Loop */
+		
+		for (partNum = 0; partNum < adrandNumRunning; partNum++) {
+			partitionPtr = &adrandPartitions[((1 - adrandFillSet) * adrandNumThreads) + partNum];
+			
+			#ifdef ADRAND_THREADED_WINDOWS
+				if (partitionPtr->isThreaded) {
+					pthread_join(partitionPtr->thread, NULL);
+					partitionPtr->isThreaded = false;
+				}
+			#endif
+			
+			if (adrandDrainPartition(partitionPtr) == false) {
+				/* Error should already have been reported */
+				goto FAIL;
+			}
+		}
+		
+		adrandNumRunning = 0;
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	
+	return (okay);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandReplayPartition
+*
+*	Summary:		Add the decays and photons read into a partition to a
+*					time window processing.  Every partition but the file's
+*					first starts with a new time window.
+*
+*	Arguments:
+*		WindowPartitionTy	*partitionPtr	- The partition.
+*		TimeWindowStateTy	*statePtr		- The time window processing.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void adrandReplayPartition(WindowPartitionTy *partitionPtr, TimeWindowStateTy *statePtr)
+{
+	LbUsFourByte		eventOffset;		/* Offset of the current record */
+	PHG_Decay			decay;				/* The current decay */
+	PHG_DetectedPhoton	photon;				/* The current photon */
+	Boolean				isNewWindow;		/* Does the decay start a new time window? */
+	
+	
+	eventOffset = 0;
+	while (eventOffset < partitionPtr->eventsUsed) {
+		
+		if (partitionPtr->events[eventOffset] == ADRAND_DecayRecord) {
+			memcpy(&decay, partitionPtr->events + eventOffset + 1, sizeof(PHG_Decay));
+			eventOffset += 1 + sizeof(PHG_Decay);
+			
+			/* a partition's first decay starts a new time window */
+			isNewWindow = ( (statePtr->window.numDecays == 0) && !partitionPtr->isFileStart );
+			adrandAddDecay(statePtr, &decay);
+			if (isNewWindow) {
+				statePtr->window.lastDetectionTime = decay.decayTime;
+			}
+		}
+		else {
+			memcpy(&photon, partitionPtr->events + eventOffset + 1, sizeof(PHG_DetectedPhoton));
+			eventOffset += 1 + sizeof(PHG_DetectedPhoton);
+			
+			adrandAddPhoton(statePtr, &photon);
+		}
+	}
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandProcessPartition
+*
+*	Summary:		Process the time windows of a partition into its output
+*					buffer.
+*
+*	Arguments:
+*		WindowPartitionTy	*partitionPtr	- The partition.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void adrandProcessPartition(WindowPartitionTy *partitionPtr)
+{
+	TimeWindowStateTy	*statePtr;			/* The partition's time window processing */
+	
+	
+	statePtr = &partitionPtr->state;
+	adrandClearCounts(statePtr);
+	adrandClearWindow(statePtr);
+	statePtr->outBufferUsed = 0;
+	statePtr->isOkay = true;
+	
+	adrandReplayPartition(partitionPtr, statePtr);
+	
+	/* the partition ends with a whole time window */
+	if ( statePtr->window.numDecays > 0 ) {
+		adrandProcessTimeWindow(statePtr);
+	}
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandProcessPartitionHere
+*
+*	Summary:		Process the time windows of a partition on this thread,
+*					writing its decays out directly rather than into its
+*					output buffer.  The partitions before it must already
+*					be written out.
+*
+*	Arguments:
+*		WindowPartitionTy	*partitionPtr	- The partition.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void adrandProcessPartitionHere(WindowPartitionTy *partitionPtr)
+{
+	LbUsOneByte			*outBuffer;			/* The partition's output buffer */
+	
+	
+	outBuffer = partitionPtr->state.outBuffer;
+	partitionPtr->state.outBuffer = NULL;
+	
+	adrandProcessPartition(partitionPtr);
+	
+	partitionPtr->state.outBuffer = outBuffer;
+	partitionPtr->state.outBufferUsed = 0;
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandEndParallel
+*
+*	Summary:		Go on processing the stream serially, when a partition
+*					cannot hold any more of it.  The partitions being
+*					processed and those already read are written out, the
+*					partition being read is added to the serial time window
+*					processing, and the partitions are freed.
+*
+*	Arguments:		None.
+*
+*	Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean adrandEndParallel()
+{
+	Boolean				okay = false;		/* Process flag (function return) */
+	LbUsFourByte		partNum;			/* Current partition */
+	WindowPartitionTy	*partitionPtr;		/* The partition */
+	
+	
+	do { /* Process Loop */
+		
+		if (adrandFinishPartitions() == false) {
+			/* Error should already have been reported */
+			goto FAIL;
+		}
+		
+		for (partNum = 0; partNum < adrandNumFilled; partNum++) {
+			partitionPtr = &adrandPartitions[(adrandFillSet * adrandNumThreads) + partNum];
+			
+			adrandProcessPartitionHere(partitionPtr);
+			if (adrandDrainPartition(partitionPtr) == false) {
+				/* Error should already have been reported */
+				goto FAIL;
+			}
+		}
+		
+		/* The partition being read holds the start of the current time window */
+		partitionPtr = &adrandPartitions[(adrandFillSet * adrandNumThreads) + adrandNumFilled];
+		adrandReplayPartition(partitionPtr, &adrandWindowState);
+		
+		adrandEndPartitions();
+		adrandNumThreads = 1;
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	
+	return (okay);
+}
+
+
+#ifdef ADRAND_THREADED_WINDOWS
+/*********************************************************************************
+*
+*	Name:			adrandPartitionMain
+*
+*	Summary:		Thread entry processing a partition.
+*
+*	Arguments:
+*		void				*partitionPtr	- The partition.
+*
+*	Function return: NULL.
+*
+*********************************************************************************/
+void *adrandPartitionMain(void *partitionPtr)
+{
+	adrandProcessPartition((WindowPartitionTy *) partitionPtr);
+	
+	return (NULL);
+}
+#endif
+
+
+/*********************************************************************************
+*
+*	Name:			adrandDrainPartition
+*
+*	Summary:		Write out the decays of a processed partition, add its
+*					counts to the totals and empty it.
+*
+*	Arguments:
+*		WindowPartitionTy	*partitionPtr	- The partition.
+*
+*	Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean adrandDrainPartition(WindowPartitionTy *partitionPtr)
+{
+	Boolean				okay = false;		/* Process flag (function return) */
+	TimeWindowStateTy	*statePtr;			/* The partition's time window processing */
+	LbUsFourByte		outOffset;			/* Offset of the current record */
+	LbUsFourByte		numDecays;			/* counter */
+	PHG_Decay			decay;				/* The current decay */
+	PHG_DetectedPhoton	bluePhotons[PHG_MAX_DETECTED_PHOTONS];	/* Its blue photons */
+	PHG_DetectedPhoton	pinkPhotons[PHG_MAX_DETECTED_PHOTONS];	/* Its pink photons */
+	LbUsFourByte		numBluePhotons;		/* Number of blue photons */
+	LbUsFourByte		numPinkPhotons;		/* Number of pink photons */
+	
+	
+	do { /* Process Loop */
+		
+		/* A partition whose decays did not fit in its output buffer
+			is processed again, writing them out directly */
+		statePtr = &partitionPtr->state;
+		if (!statePtr->isOkay) {
+			adrandProcessPartitionHere(partitionPtr);
+		}
+		
+		/* Each decay record is followed by its photons */
+		outOffset = 0;
+		while (outOffset < statePtr->outBufferUsed) {
+			memcpy(&decay, statePtr->outBuffer + outOffset + 1, sizeof(PHG_Decay));
+			outOffset += 1 + sizeof(PHG_Decay);
+			
+			numBluePhotons = 0;
+			numPinkPhotons = 0;
+			while ( (outOffset < statePtr->outBufferUsed) &&
+					(statePtr->outBuffer[outOffset] != ADRAND_DecayRecord) ) {
 				
-				} else if ( timeWindowDetections.numDecays < (ADRAND_MaxTWDecays - 1) ) {
-					
-					/* add decay to current time window */
-					curDecayNum++;
-					timeWindowDetections.decays[curDecayNum].decay = nextDecay;
-					if ( nextDecay.decayTime > timeWindowDetections.lastDetectionTime )
-						timeWindowDetections.lastDetectionTime = nextDecay.decayTime;
-					timeWindowDetections.decays[curDecayNum].numBluePhotons = 0;
-					timeWindowDetections.decays[curDecayNum].numPinkPhotons = 0;				
-					timeWindowDetections.numDecays += 1;
-					numDecaysRead++;
-					
-				} else {
-					
-					/* place this decay as last decay in current time window, 
-					 bouncing previous last decay.  This is okay as long as one doesn't
-					 use a window with so many decays in it, e.g. currently all decays
-					 in the window will be dumped anyway as we reject triples. */
-					timeWindowDetections.decays[curDecayNum].decay = nextDecay;
-					if ( nextDecay.decayTime > timeWindowDetections.lastDetectionTime )
-						timeWindowDetections.lastDetectionTime = nextDecay.decayTime;
-					timeWindowDetections.decays[curDecayNum].numBluePhotons = 0;
-					timeWindowDetections.decays[curDecayNum].numPinkPhotons = 0;				
-					timeWindowDetections.numDecays = ADRAND_MaxTWDecays;
-					numDecaysRead++;
-					
+				if (statePtr->outBuffer[outOffset] == ADRAND_BlueRecord) {
+					memcpy(&bluePhotons[numBluePhotons], statePtr->outBuffer + outOffset + 1,
+						sizeof(PHG_DetectedPhoton));
+					numBluePhotons++;
 				}
-								
+				else {
+					memcpy(&pinkPhotons[numPinkPhotons], statePtr->outBuffer + outOffset + 1,
+						sizeof(PHG_DetectedPhoton));
+					numPinkPhotons++;
+				}
+				outOffset += 1 + sizeof(PHG_DetectedPhoton);
 			}
-		
+			
+			adrandPassDecay(&decay, bluePhotons, numBluePhotons, pinkPhotons, numPinkPhotons);
 		}
 		
-		/* it is probable there are still decay(s) in the time window, flush them before leaving */
-		if ( timeWindowDetections.numDecays > 0 ) {
-			adrandProcessTimeWindow();
+		/* Add the partition's counts to the totals */
+		adrandWindowState.numDecaysWritten += statePtr->numDecaysWritten;
+		adrandWindowState.numDecaysUnchanged += statePtr->numDecaysUnchanged;
+		adrandWindowState.numDecaysRandom += statePtr->numDecaysRandom;
+		adrandWindowState.numDecaysLostTriples += statePtr->numDecaysLostTriples;
+		adrandWindowState.numLostCorrectWindow += statePtr->numLostCorrectWindow;
+		for ( numDecays = 0; numDecays < ADRAND_MaxTWDecays; numDecays++ ) {
+			adrandWindowState.histDecaysPerWindow[numDecays] += statePtr->histDecaysPerWindow[numDecays];
 		}
 		
-		/* print out final progress message */
-		if (LbTmStopTiming(&clockTiming, &realSecs, &cpuSecs)) {
-			accumSecs += realSecs;
-			accumCPUSecs += cpuSecs;
-			
-			/* Get current time */
-			time(&curTime);
-			
-			/* Convert time to string format */
-			strftime(timeStr, 31, "(%H:%M %e-%b-%y)", localtime(&curTime));
-			
-			/* Display a progress message */
-			LbInPrintf("%d MB read in,  CPU seconds = %3.0f %s.\n",
-				(int)(bytesReadIn/1024/1024), 
-				accumCPUSecs, timeStr);
-		}
-					
-		/* Report end of file creation */
-		{
-			/* Get current time */
-			time(&curTime);
+		/* Ready the partition to be read into again */
+		partitionPtr->eventsUsed = 0;
+		partitionPtr->numDecays = 0;
+		partitionPtr->isFileStart = false;
+		statePtr->outBufferUsed = 0;
+		
+		okay = true;
+	} while (false);
+	
+	
+	return (okay);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandEndPartitions
+*
+*	Summary:		Wait for any partition still being processed and free
+*					the partitions.
+*
+*	Arguments:		None.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void adrandEndPartitions()
+{
+	LbUsFourByte		partNum;			/* Current partition */
+	WindowPartitionTy	*partitionPtr;		/* The partition */
+	
+	
+	if (adrandPartitions != 0) {
+		for (partNum = 0; partNum < (2 * adrandNumThreads); partNum++) {
+			partitionPtr = &adrandPartitions[partNum];
 			
-			/* Convert time to string format */
-			strftime(timeStr, 31, "(%H:%M %e-%b-%y)", localtime(&curTime));
+			#ifdef ADRAND_THREADED_WINDOWS
+				if (partitionPtr->isThreaded) {
+					pthread_join(partitionPtr->thread, NULL);
+				}
+			#endif
 			
-			/* Display first progress message */
-			LbInPrintf("******* Creation of randoms-added data complete %s *******\n",
-				timeStr);
+			if (partitionPtr->events != 0) {
+				LbMmFree((void **) &partitionPtr->events);
+			}
+			if (partitionPtr->state.outBuffer != 0) {
+				LbMmFree((void **) &partitionPtr->state.outBuffer);
+			}
 		}
-	}
-	
-	okay = true;
-	
-	FAIL:;
-	/* NOTE:  In case of failure, files may be left unclosed; therefore,
-		it is best to completely exit the program on failure and let the 
-		system clean up these files. */
 		
-	return (okay);
+		LbMmFree((void **) &adrandPartitions);
+	}
 }
 
 
@@ -1084,11 +2125,12 @@ Boolean adrandCreateRandomsList( )
 *					purge the time window.
 *
 *	Arguments:
+*		TimeWindowStateTy	*statePtr		- The time window processing.
 *
 *	Function return: True unless an error occurs.
 *
 *********************************************************************************/
-Boolean adrandProcessTimeWindow( )
+Boolean adrandProcessTimeWindow(TimeWindowStateTy *statePtr)
 {
 	
 	Boolean				okay = false;			/* Function return value */
@@ -1098,46 +2140,46 @@ Boolean adrandProcessTimeWindow( )
 	do {
 		
 		/* increment the histogram of decays per time window */
-		histDecaysPerWindow[timeWindowDetections.numDecays - 1] += 1;
+		statePtr->histDecaysPerWindow[statePtr->window.numDecays - 1] += 1;
 		
 		/* give user a chance to modify/process time window decays and change counters 
 			before standard processing */
 		if (addrandUsrModDecays1FPtr) {
-			(*addrandUsrModDecays1FPtr)(&timeWindowDetections, 
-				&adrandRandomsFileHk, &numDecaysWritten, &numDecaysUnchanged, &numDecaysRandom, 
-				&numLostCorrectWindow, &numDecaysLostTriples);
+			(*addrandUsrModDecays1FPtr)(&statePtr->window, 
+				&adrandRandomsFileHk, &statePtr->numDecaysWritten, &statePtr->numDecaysUnchanged, &statePtr->numDecaysRandom, 
+				&statePtr->numLostCorrectWindow, &statePtr->numDecaysLostTriples);
 		}
 		
 		/* process the time window depending on how many decays and photons there are in it */
-		if ( timeWindowDetections.numDecays == 1 ) {
+		if ( statePtr->window.numDecays == 1 ) {
 			
-			if ( (timeWindowDetections.decays[0].numBluePhotons >= 1) &&
-					(timeWindowDetections.decays[0].numPinkPhotons >= 1) ) {
+			if ( (statePtr->window.decays[0].numBluePhotons >= 1) &&
+					(statePtr->window.decays[0].numPinkPhotons >= 1) ) {
 				
 				if ((!addrandUsrModDecays2FPtr) || 
-					((*addrandUsrModDecays2FPtr)(&timeWindowDetections, &adrandRandomsFileHk, 
-						&numDecaysWritten, &numDecaysUnchanged, 
-						&numDecaysRandom, &numLostCorrectWindow, &numDecaysLostTriples))) {
+					((*addrandUsrModDecays2FPtr)(&statePtr->window, &adrandRandomsFileHk, 
+						&statePtr->numDecaysWritten, &statePtr->numDecaysUnchanged, 
+						&statePtr->numDecaysRandom, &statePtr->numLostCorrectWindow, &statePtr->numDecaysLostTriples))) {
 					
 					/* write this decay to output list mode file */
-					PhoHFileRewriteDetections( &adrandRandomsFileHk, &(timeWindowDetections.decays[0].decay),
-						timeWindowDetections.decays[0].bluePhotons, timeWindowDetections.decays[0].numBluePhotons,
-						timeWindowDetections.decays[0].pinkPhotons, timeWindowDetections.decays[0].numPinkPhotons);
+					adrandWriteDecay( statePtr, &(statePtr->window.decays[0].decay),
+						statePtr->window.decays[0].bluePhotons, statePtr->window.decays[0].numBluePhotons,
+						statePtr->window.decays[0].pinkPhotons, statePtr->window.decays[0].numPinkPhotons);
 					
 					/* increment the number of decays written out, and the number unchnged written out */
-					numDecaysWritten++;
-					numDecaysUnchanged++;
+					statePtr->numDecaysWritten++;
+					statePtr->numDecaysUnchanged++;
 					
 				}
 				
 			}
 			
-		} else if ( timeWindowDetections.numDecays > 1 ) {
+		} else if ( statePtr->window.numDecays > 1 ) {
 			
-			for ( decayNum = 0; decayNum < timeWindowDetections.numDecays; decayNum++ ) {
+			for ( decayNum = 0; decayNum < statePtr->window.numDecays; decayNum++ ) {
 				
-				totalPhotons += timeWindowDetections.decays[decayNum].numBluePhotons;
-				totalPhotons += timeWindowDetections.decays[decayNum].numPinkPhotons;
+				totalPhotons += statePtr->window.decays[decayNum].numBluePhotons;
+				totalPhotons += statePtr->window.decays[decayNum].numPinkPhotons;
 				
 			}
 			
@@ -1151,54 +2193,54 @@ Boolean adrandProcessTimeWindow( )
 				totalPhotons = 0;
 				while (totalPhotons < 2) {
 					
-					if ( timeWindowDetections.decays[decayNum].numBluePhotons == 1 ) {
+					if ( statePtr->window.decays[decayNum].numBluePhotons == 1 ) {
 						
 						if ( totalPhotons == 0 ) {
 							
-							timeWindowDetections.decays[0].bluePhotons[0] =
-									timeWindowDetections.decays[decayNum].bluePhotons[0];
-							timeWindowDetections.decays[0].bluePhotons[0].flags =
+							statePtr->window.decays[0].bluePhotons[0] =
+									statePtr->window.decays[decayNum].bluePhotons[0];
+							statePtr->window.decays[0].bluePhotons[0].flags =
 									PHGFg_PhotonBlue;
-							timeWindowDetections.decays[0].numBluePhotons = 1;
+							statePtr->window.decays[0].numBluePhotons = 1;
 							totalPhotons++;
 							
 						} else {
 							
-							timeWindowDetections.decays[0].pinkPhotons[0] =
-									timeWindowDetections.decays[decayNum].bluePhotons[0];
-							timeWindowDetections.decays[0].pinkPhotons[0].flags = 0;
-							timeWindowDetections.decays[0].numPinkPhotons = 1;
+							statePtr->window.decays[0].pinkPhotons[0] =
+									statePtr->window.decays[decayNum].bluePhotons[0];
+							statePtr->window.decays[0].pinkPhotons[0].flags = 0;
+							statePtr->window.decays[0].numPinkPhotons = 1;
 							/* we must also adjust the photon time-since-creation
 							 to reflect the difference in decay times */
-							timeWindowDetections.decays[0].pinkPhotons[0].time_since_creation +=
-									(timeWindowDetections.decays[1].decay.decayTime -
-									timeWindowDetections.decays[0].decay.decayTime);
+							statePtr->window.decays[0].pinkPhotons[0].time_since_creation +=
+									(statePtr->window.decays[1].decay.decayTime -
+									statePtr->window.decays[0].decay.decayTime);
 							totalPhotons++;
 							
 						}
 						
-					} else if ( timeWindowDetections.decays[decayNum].numPinkPhotons == 1 ) {
+					} else if ( statePtr->window.decays[decayNum].numPinkPhotons == 1 ) {
 						
 						if ( totalPhotons == 0 ) {
 							
-							timeWindowDetections.decays[0].bluePhotons[0] =
-									timeWindowDetections.decays[decayNum].pinkPhotons[0];
-							timeWindowDetections.decays[0].bluePhotons[0].flags =
+							statePtr->window.decays[0].bluePhotons[0] =
+									statePtr->window.decays[decayNum].pinkPhotons[0];
+							statePtr->window.decays[0].bluePhotons[0].flags =
 									PHGFg_PhotonBlue;
-							timeWindowDetections.decays[0].numBluePhotons = 1;
+							statePtr->window.decays[0].numBluePhotons = 1;
 							totalPhotons++;
 							
 						} else {
 							
-							timeWindowDetections.decays[0].pinkPhotons[0] =
-									timeWindowDetections.decays[decayNum].pinkPhotons[0];
-							timeWindowDetections.decays[0].pinkPhotons[0].flags = 0;
-							timeWindowDetections.decays[0].numPinkPhotons = 1;
+							statePtr->window.decays[0].pinkPhotons[0] =
+									statePtr->window.decays[decayNum].pinkPhotons[0];
+							statePtr->window.decays[0].pinkPhotons[0].flags = 0;
+							statePtr->window.decays[0].numPinkPhotons = 1;
 							/* we must also adjust the photon time-since-creation
 							 to reflect the difference in decay times */
-							timeWindowDetections.decays[0].pinkPhotons[0].time_since_creation +=
-									(timeWindowDetections.decays[1].decay.decayTime -
-									timeWindowDetections.decays[0].decay.decayTime);
+							statePtr->window.decays[0].pinkPhotons[0].time_since_creation +=
+									(statePtr->window.decays[1].decay.decayTime -
+									statePtr->window.decays[0].decay.decayTime);
 							totalPhotons++;
 							
 						}						
@@ -1209,7 +2251,7 @@ Boolean adrandProcessTimeWindow( )
 					
 					/* if we have been through all the decays we should have created a random event.
 					 If not, we abort with error message. */
-					if ( (decayNum == timeWindowDetections.numDecays) && (totalPhotons < 2) ) {
+					if ( (decayNum == statePtr->window.numDecays) && (totalPhotons < 2) ) {
 						
 						ErAbort("Unable to create random event (adrandProcessTimeWindow).");
 						
@@ -1217,41 +2259,41 @@ Boolean adrandProcessTimeWindow( )
 				}
 				
 				/* set the decay type to random event */
-				timeWindowDetections.decays[0].decay.decayType = PhgEn_PETRandom;
+				statePtr->window.decays[0].decay.decayType = PhgEn_PETRandom;
 				
 				/* check to see if the two photons in the random do pass within time window -
 				 to this point we have only compared the decay time of the second photon...*/
-				if ( fabs( timeWindowDetections.decays[0].pinkPhotons[0].time_since_creation -
-							timeWindowDetections.decays[0].bluePhotons[0].time_since_creation )
+				if ( fabs( statePtr->window.decays[0].pinkPhotons[0].time_since_creation -
+							statePtr->window.decays[0].bluePhotons[0].time_since_creation )
 							<= adrandTimingWindow ) {
 					
 					if ((!addrandUsrModDecays2FPtr) || 
-						((*addrandUsrModDecays2FPtr)(&timeWindowDetections, &adrandRandomsFileHk, 
-							&numDecaysWritten, &numDecaysUnchanged, 
-							&numDecaysRandom, &numLostCorrectWindow, &numDecaysLostTriples))) {
+						((*addrandUsrModDecays2FPtr)(&statePtr->window, &adrandRandomsFileHk, 
+							&statePtr->numDecaysWritten, &statePtr->numDecaysUnchanged, 
+							&statePtr->numDecaysRandom, &statePtr->numLostCorrectWindow, &statePtr->numDecaysLostTriples))) {
 						
 						/* write this decay to output list mode file */
-						PhoHFileRewriteDetections( &adrandRandomsFileHk, &(timeWindowDetections.decays[0].decay),
-							timeWindowDetections.decays[0].bluePhotons, timeWindowDetections.decays[0].numBluePhotons,
-							timeWindowDetections.decays[0].pinkPhotons, timeWindowDetections.decays[0].numPinkPhotons);
+						adrandWriteDecay( statePtr, &(statePtr->window.decays[0].decay),
+							statePtr->window.decays[0].bluePhotons, statePtr->window.decays[0].numBluePhotons,
+							statePtr->window.decays[0].pinkPhotons, statePtr->window.decays[0].numPinkPhotons);
 						
 						/* increment the number of decays written out and the number of randoms created */
-						numDecaysWritten++;
-						numDecaysRandom++;
+						statePtr->numDecaysWritten++;
+						statePtr->numDecaysRandom++;
 						
 					}
 					
 				} else {
 					
 					/* keep track of how many randoms are lost to this second windowing */
-					numLostCorrectWindow++;
+					statePtr->numLostCorrectWindow++;
 					
 				}
 				
 			} else if ( totalPhotons > 2 ) {
 				
 				/* Triples - keep track how many decays are lost to triples */
-				numDecaysLostTriples += timeWindowDetections.numDecays;
+				statePtr->numDecaysLostTriples += statePtr->window.numDecays;
 				
 			}
 			
@@ -1271,5 +2313,291 @@ Boolean adrandProcessTimeWindow( )
 }
 
 
+/*********************************************************************************
+*
+*	Name:			adrandWriteDecay
+*
+*	Summary:		Write out a decay of the time window: into the output
+*					buffer of a partition, or else directly (see
+*					adrandPassDecay).
+*
+*	Arguments:
+*		TimeWindowStateTy	*statePtr		- The time window processing.
+*		PHG_Decay			*decayPtr		- The decay.
+*		PHG_DetectedPhoton	*bluePhotons	- The blue photons of the decay.
+*		LbUsFourByte		numBluePhotons	- The number of blue photons.
+*		PHG_DetectedPhoton	*pinkPhotons	- The pink photons of the decay.
+*		LbUsFourByte		numPinkPhotons	- The number of pink photons.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void adrandWriteDecay(TimeWindowStateTy *statePtr, PHG_Decay *decayPtr,
+			PHG_DetectedPhoton *bluePhotons, LbUsFourByte numBluePhotons,
+			PHG_DetectedPhoton *pinkPhotons, LbUsFourByte numPinkPhotons)
+{
+	LbUsFourByte		photonNum;			/* current photon */
+	
+	
+	if (statePtr->outBuffer == NULL) {
+		adrandPassDecay(decayPtr, bluePhotons, numBluePhotons, pinkPhotons, numPinkPhotons);
+	}
+	else if (statePtr->isOkay) {
+		statePtr->isOkay = adrandAppendRecord(&statePtr->outBuffer, &statePtr->outBufferSize,
+			&statePtr->outBufferUsed, ADRAND_DecayRecord, decayPtr, sizeof(PHG_Decay));
+		
+		for (photonNum = 0; (photonNum < numBluePhotons) && statePtr->isOkay; photonNum++) {
+			statePtr->isOkay = adrandAppendRecord(&statePtr->outBuffer, &statePtr->outBufferSize,
+				&statePtr->outBufferUsed, ADRAND_BlueRecord, &bluePhotons[photonNum],
+				sizeof(PHG_DetectedPhoton));
+		}
+		
+		for (photonNum = 0; (photonNum < numPinkPhotons) && statePtr->isOkay; photonNum++) {
+			statePtr->isOkay = adrandAppendRecord(&statePtr->outBuffer, &statePtr->outBufferSize,
+				&statePtr->outBufferUsed, ADRAND_PinkRecord, &pinkPhotons[photonNum],
+				sizeof(PHG_DetectedPhoton));
+		}
+	}
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandPassDecay
+*
+*	Summary:		Write out a decay to the randoms-added file, if one is
+*					being written, and pass it on to the stream's receiver,
+*					if any.
+*
+*	Arguments:
+*		PHG_Decay			*decayPtr		- The decay.
+*		PHG_DetectedPhoton	*bluePhotons	- The blue photons of the decay.
+*		LbUsFourByte		numBluePhotons	- The number of blue photons.
+*		PHG_DetectedPhoton	*pinkPhotons	- The pink photons of the decay.
+*		LbUsFourByte		numPinkPhotons	- The number of pink photons.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void adrandPassDecay(PHG_Decay *decayPtr,
+			PHG_DetectedPhoton *bluePhotons, LbUsFourByte numBluePhotons,
+			PHG_DetectedPhoton *pinkPhotons, LbUsFourByte numPinkPhotons)
+{
+	if (adrandRandomsFileHk.histFile != NULL) {
+		PhoHFileRewriteDetections( &adrandRandomsFileHk, decayPtr,
+			bluePhotons, numBluePhotons, pinkPhotons, numPinkPhotons);
+	}
+	
+	if (adrandDecayFPtr) {
+		(*adrandDecayFPtr)(decayPtr, bluePhotons, numBluePhotons, pinkPhotons, numPinkPhotons);
+	}
+}
+
+
+/*********************************************************************************
+*
+*	Name:			adrandPrintReport
+*
+*	Summary:		Print the decay counts and the histogram of decays per
+*					time window.
+*
+*	Arguments:		None.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void adrandPrintReport()
+{
+	LbUsFourByte	numDecays;			/* counter */
+	
+	
+	LbInPrintf("\n\tNumber of decays read in: %d", numDecaysRead);
+	
+	LbInPrintf("\n\n\tNumber of decays written out: %d", adrandWindowState.numDecaysWritten);
+	LbInPrintf("\n\tOf the decays written out, %d were written out unchanged.", adrandWindowState.numDecaysUnchanged);
+	LbInPrintf("\n\tOf the decays written out, %d were randoms created by addrandoms.", adrandWindowState.numDecaysRandom);
+	
+	LbInPrintf("\n\n\tNumber of decays lost as triples: %d", adrandWindowState.numDecaysLostTriples);
+	LbInPrintf("\n\n\tNumber of decays lost to correct windowing: %d", adrandWindowState.numLostCorrectWindow);
+	
+	/* write out histogram of decays found per time window */
+	LbInPrintf("\n\n\tHistogram of the number of decays found per time window:");
+	LbInPrintf("\n\n\tTime windows with 1 decay  =\t\t%d", adrandWindowState.histDecaysPerWindow[0]);
+	for ( numDecays = 2; numDecays < ADRAND_MaxTWDecays; numDecays++ ) {
+		
+		LbInPrintf("\n\tTime windows with %d decays =\t\t%d", numDecays, adrandWindowState.histDecaysPerWindow[numDecays-1]);
+		
+	}
+	LbInPrintf("\n\tTime windows with %d or more decays =\t%d\n\n", numDecays, adrandWindowState.histDecaysPerWindow[numDecays-1]);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			AdRandBeginStream
+*
+*	Summary:		Prepare to add randoms to a stream of time-sorted decays
+*					passed in by AdRandAddDecay and AdRandAddPhoton, rather
+*					than read from a sorted history file.  The coincidence
+*					window, triples method and randoms-added file come from
+*					the current detector parameters; the randoms-added file
+*					is only written if one is named there.  Each decay that
+*					would be written out is passed to decayFPtr.
+*
+*	Arguments:
+*		PhoHFileHdrTy		*hdrParamsPtr	- The header of the decays' source.
+*		AdRandDecayFType	*decayFPtr		- Receives the randoms-added decays.
+*
+*	Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean AdRandBeginStream(PhoHFileHdrTy *hdrParamsPtr, AdRandDecayFType *decayFPtr)
+{
+	Boolean				okay = false;		/* Process flag (function return) */
+	
+	
+	do { /* Process Loop */
+		
+		/* Save the randoms-processing related parameters; randoms are being
+			added whether or not a randoms-added file is written */
+		adrandSaveParams();
+		adrandDoRandoms = true;
+		adrandCustomFile = false;
+		
+		/* Check a positive coincidence timing window is selected */
+		if ( adrandTimingWindow <= 0.0 ) {
+			sprintf(adrandErrStr, "(AdRandBeginStream) Non-positive coincidence timing window not allowed.");
+			ErStGeneric(adrandErrStr);
+			goto FAIL;
+		}
+		
+		/* Set the header for the output and check the input is fit for randoms */
+		adrandHdrParams = *hdrParamsPtr;
+		if (adrandSetHeader() == false) {
+			/* Error should already have been reported */
+			goto FAIL;
+		}
+		
+		/* Open the randoms-added output file, if requested */
+		adrandRandomsFileHk.histFile = NULL;
+		if (strlen(adrandRandomsFileName) != 0) {
+			if (adrandCreateRandomsFile() == false) {
+				/* Error should already have been reported */
+				goto FAIL;
+			}
+		}
+		
+		LbInPrintf("\nAdding randoms with a coincidence window of %3.3f nanoseconds.\n",
+					adrandTimingWindow * 1.0E9);
+		if (adrandRandomsFileHk.histFile != NULL) {
+			LbInPrintf("Name of output randoms-added history file: %s.\n", adrandRandomsFileName);
+		}
+		
+		if (addrandUsrInitializeFPtr) {
+			(*addrandUsrInitializeFPtr)(&DetRunTimeParams[DetCurParams]);
+		}
+		
+		numDecaysRead = 0;
+		adrandClearCounts(&adrandWindowState);
+		adrandClearWindow(&adrandWindowState);
+		adrandDecayFPtr = decayFPtr;
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	
+	return (okay);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			AdRandAddDecay
+*
+*	Summary:		Add the next decay, in time order, to the time window.
+*					If it falls past the window, the window is processed
+*					first and the decay starts a new one.
+*
+*	Arguments:
+*		PHG_Decay			*decayPtr		- The decay.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void AdRandAddDecay(PHG_Decay *decayPtr)
+{
+	numDecaysRead++;
+	adrandAddDecay(&adrandWindowState, decayPtr);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			AdRandAddPhoton
+*
+*	Summary:		Add a photon of the last decay added to the time window.
+*
+*	Arguments:
+*		PHG_DetectedPhoton	*photonPtr		- The photon.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void AdRandAddPhoton(PHG_DetectedPhoton *photonPtr)
+{
+	adrandAddPhoton(&adrandWindowState, photonPtr);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			AdRandEndStream
+*
+*	Summary:		Process the last time window of a stream, close the
+*					randoms-added file if one was written and report.
+*
+*	Arguments:		None.
+*
+*	Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean AdRandEndStream()
+{
+	Boolean				okay = false;		/* Process flag (function return) */
+	
+	
+	do { /* Process Loop */
+		
+		/* flush the decay(s) left in the time window */
+		if ( adrandWindowState.window.numDecays > 0 ) {
+			adrandProcessTimeWindow(&adrandWindowState);
+		}
+		adrandDecayFPtr = 0;
+		
+		/* write header to output randoms added file and close */
+		if (adrandRandomsFileHk.histFile != NULL) {
+			if (adrandCloseRandomsFile() == false) {
+				/* Error should already have been reported */
+				goto FAIL;
+			}
+		}
+		
+		/* write out report for module */
+		adrandPrintReport();
+		
+		if (addrandUsrTerminateFPtr) {
+			(*addrandUsrTerminateFPtr)(&DetRunTimeParams[DetCurParams]);
+		}
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	
+	return (okay);
+}
+
+
 #undef ADD_RANDOMS_MAIN
 
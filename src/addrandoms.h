@@ -22,7 +22,11 @@
 *
 **********************************************************************************
 *
-*			Global functions defined:	
+*			Global functions defined:
+*				AdRandBeginStream
+*				AdRandAddDecay
+*				AdRandAddPhoton
+*				AdRandEndStream
 *
 *			Global variables defined:		none
 *
@@ -73,12 +77,21 @@ typedef struct {
 												/* the decays in this window */
 } timeWindowDetectionsTy;
 
+/* Receives each randoms-added decay of a stream (see AdRandBeginStream) */
+typedef void AdRandDecayFType(PHG_Decay *decayPtr,
+					PHG_DetectedPhoton *bluePhotons, LbUsFourByte numBluePhotons,
+					PHG_DetectedPhoton *pinkPhotons, LbUsFourByte numPinkPhotons);
+
 
 
 /* GLOBALS */
 
 
 /* PROTOTYPES */
+Boolean		AdRandBeginStream(PhoHFileHdrTy *hdrParamsPtr, AdRandDecayFType *decayFPtr);
+void		AdRandAddDecay(PHG_Decay *decayPtr);
+void		AdRandAddPhoton(PHG_DetectedPhoton *photonPtr);
+Boolean		AdRandEndStream(void);
 
 #undef LOCALE
 #endif /* ADD_RAND_HDR */
@@ -115,9 +115,9 @@
 Boolean phgrdhstInitialize(int argc, char *argv[])
 {
 	Boolean				okay = false;				/* Process Loop */
-    char			*knownOptions[] = {"pcd"};
+    char			*knownOptions[] = {"pcdt:r"};
 	char				optArgs[PHGRDHST_NumFlags][LBEnMxArgLen];
-	LbUsFourByte		optArgFlags = (LBFlag0);
+	LbUsFourByte		optArgFlags = (LBFlag0 + LBFlag3);
 	char				fileName[1024];				/* Name of param file */
 	LbFourByte			randSeed;			/* Seed for random generator */
 	
@@ -143,6 +143,23 @@ Boolean phgrdhstInitialize(int argc, char *argv[])
                         " or a detector history file (-d)\n");
 			break;
 		}
+		
+		/* Randoms are only added to detector history files */
+		if (PHGRDHST_IsAddRandoms() && !PHGRDHST_IsUseDetHistory()) {
+			ErStGeneric("Randoms can only be added (-r) while binning a detector history file (-d).");
+			break;
+		}
+		
+		/* If they gave us a number of worker processes, set them up, otherwise
+			bin serially
+		*/
+		if (PHGRDHST_IsWorkersOption() && (atoi(optArgs[3]) < 1)) {
+			ErStGeneric("The number of worker processes (-t) must be at least 1.");
+			break;
+		}
+		if (PhgParInitialize(PHGRDHST_IsWorkersOption() ? (LbUsFourByte) atoi(optArgs[3]) : 0) == false) {
+			break;
+		}
         
 		/* See if they supplied a command line argument */
 		if ((phgrdhstArgIndex != 0) && (argv[phgrdhstArgIndex] != 0)) {
@@ -195,6 +212,7 @@ Boolean phgrdhstInitialize(int argc, char *argv[])
 		}
 		
 		/* Initialize the math library */
+		PhgParBeginInitialize();
 		randSeed = PhgRunTimeParams.PhgRandomSeed;
 		if (!PhgMathInit(&randSeed))
 			break;
@@ -325,6 +343,7 @@ Boolean phgrdhstInitialize(int argc, char *argv[])
 			strcpy(phgrdhstHistName, DetRunTimeParams[DetCurParams].DetHistoryFilePath);
 			strcpy(phgrdhstHistParamsName, DetRunTimeParams[DetCurParams].DetHistoryParamsFilePath);
 		}
+		PhgParEndInitialize();
         
 		okay = true;
     CANCEL:;
@@ -391,6 +410,663 @@ void phgrdhstTerminate()
 	
 }
 
+/**********************
+ *	phgrdhstBinDecays
+ *
+ *	Purpose:	Collimate, detect and bin, as requested, the decays of a
+ *				standard history file, or of the range of one given to its
+ *				cursor.  The decays of current files are taken from the
+ *				cursor with their photons as they are stored.
+ *
+ *	Result:		True unless an error occurs.
+ ***********************/
+Boolean phgrdhstBinDecays(FILE *historyFile, PhoHFileCursorTy *historyCursor,
+			Boolean isOldDecays, Boolean isOldPhotons1, Boolean isOldPhotons2,
+			Boolean isPHGList, Boolean isColList,
+			PHG_TrackingPhoton *bluePhotons, PHG_TrackingPhoton *pinkPhotons)
+{
+	Boolean				okay = false;				/* Process flag */
+	EventTy				eventType;					/* Type of current event */
+	PhoHFileEventType	viewType;					/* Type of event viewed */
+	LbUsFourByte		numPhotons;					/* Number of photons for this decay */
+	PHG_Decay		   	decay;						/* The decay read */
+	PHG_Decay		   	nextDecay;					/* The decay read after its photons */
+	PHG_Decay			*decayPtr;					/* The decay viewed */
+	PHG_DetectedPhoton	detectedPhoton;				/* The photon read */
+	PHG_DetectedPhoton	detectedPhotons[PHG_MAX_DETECTED_PHOTONS];	/* The photons of the decay */
+	PHG_DetectedPhoton	*photons;					/* The photons viewed */
+	
+	do { /* Process Loop */
+		
+		/* Current files are viewed a decay at a time */
+		if (!isOldDecays) {
+			viewType = PhoHFileCursorDecay(historyCursor, &decayPtr, &photons, &numPhotons);
+			if (viewType != PhoHFileDecayEvent) {
+				ErStGeneric("Expected first event to be decay, and it wasn't.");
+				break;
+			}
+			
+			while (viewType == PhoHFileDecayEvent) {
+				phgrdhstBinDecay(decayPtr, photons, numPhotons, isPHGList, isColList,
+					bluePhotons, pinkPhotons);
+				
+				viewType = PhoHFileCursorDecay(historyCursor, &decayPtr, &photons, &numPhotons);
+			}
+			
+			okay = true;
+			break;
+		}
+		
+		/* Old files are read an event at a time */
+		eventType = oldReadEvent(historyFile, &decay, &detectedPhoton, isOldPhotons1, isOldPhotons2);
+		if (eventType != Decay) {
+			ErStGeneric("Expected first event to be decay, and it wasn't.");
+			break;
+		}
+		
+		/* Loop through all decays */
+		while (eventType == Decay) {
+			
+			/* Collect the photons of the decay */
+			numPhotons = 0;
+			eventType = oldReadEvent(historyFile, &nextDecay, &detectedPhoton,
+				isOldPhotons1, isOldPhotons2);
+			while (eventType == Photon) {
+				if (numPhotons == PHG_MAX_DETECTED_PHOTONS) {
+					ErStGeneric("Too many photons for one decay in history file.");
+					goto FAIL;
+				}
+				detectedPhotons[numPhotons] = detectedPhoton;
+				numPhotons++;
+				
+				eventType = oldReadEvent(historyFile, &nextDecay, &detectedPhoton,
+					isOldPhotons1, isOldPhotons2);
+			}
+			
+			phgrdhstBinDecay(&decay, detectedPhotons, numPhotons, isPHGList, isColList,
+				bluePhotons, pinkPhotons);
+			
+			/* Update current decay */
+			decay = nextDecay;
+		}
+		
+		okay = true;
+		FAIL:;
+	} while (false);
+	
+	return (okay);
+}
+
+/**********************
+ *	phgrdhstBinDecay
+ *
+ *	Purpose:	Collimate, detect and bin, as requested, one decay of a
+ *				standard history file.  Its photons are only made into
+ *				tracking photons when they are collimated or detected
+ *				here; otherwise they are binned as they were read.
+ *
+ *	Arguments:
+ *		PHG_Decay			*decayPtr		- The decay.
+ *		PHG_DetectedPhoton	*photons		- Its photons, as read.
+ *		LbUsFourByte		numPhotons		- The number of photons.
+ *		Boolean				isPHGList		- Is the file a PHG history file?
+ *		Boolean				isColList		- Is the file a collimator history file?
+ *		PHG_TrackingPhoton	*bluePhotons	- Storage for blue tracking photons.
+ *		PHG_TrackingPhoton	*pinkPhotons	- Storage for pink tracking photons.
+ *
+ *	Result:		None.
+ ***********************/
+void phgrdhstBinDecay(PHG_Decay *decayPtr, PHG_DetectedPhoton *photons,
+			LbUsFourByte numPhotons, Boolean isPHGList, Boolean isColList,
+			PHG_TrackingPhoton *bluePhotons, PHG_TrackingPhoton *pinkPhotons)
+{
+	LbUsFourByte		numBluePhotons = 0;			/* Number of blue photons for this decay */
+	LbUsFourByte		numPinkPhotons = 0;			/* Number of pink photons for this decay */
+	LbUsFourByte		photonIndex;				/* Index through the photons */
+	PHG_DetectedPhoton	*detectedBlues;				/* The blue photons */
+	PHG_DetectedPhoton	*detectedPinks;				/* The pink photons */
+	PHG_DetectedPhoton	sortedBlues[PHG_MAX_DETECTED_PHOTONS];	/* Blue photons sorted from pink */
+	PHG_DetectedPhoton	sortedPinks[PHG_MAX_DETECTED_PHOTONS];	/* Pink photons sorted from blue */
+	
+	/* Blue photons are written before pink ones, so the photons can usually
+		be used where they are
+	*/
+	while ((numBluePhotons < numPhotons) &&
+			LbFgIsSet((photons[numBluePhotons].flags & 3), PHGFg_PhotonBlue)) {
+		numBluePhotons++;
+	}
+	for (photonIndex = numBluePhotons; photonIndex < numPhotons; photonIndex++) {
+		if (LbFgIsSet((photons[photonIndex].flags & 3), PHGFg_PhotonBlue))
+			break;
+	}
+	
+	if (photonIndex == numPhotons) {
+		detectedBlues = photons;
+		detectedPinks = photons + numBluePhotons;
+		numPinkPhotons = numPhotons - numBluePhotons;
+	}
+	else {
+		numBluePhotons = 0;
+		for (photonIndex = 0; photonIndex < numPhotons; photonIndex++) {
+			if (LbFgIsSet((photons[photonIndex].flags & 3), PHGFg_PhotonBlue)) {
+				sortedBlues[numBluePhotons] = photons[photonIndex];
+				numBluePhotons++;
+			}
+			else {
+				sortedPinks[numPinkPhotons] = photons[photonIndex];
+				numPinkPhotons++;
+			}
+		}
+		detectedBlues = sortedBlues;
+		detectedPinks = sortedPinks;
+	}
+	
+	/* Bin the photons as they were read unless they are to be collimated or detected */
+	if (!(PHG_IsCollimateOnTheFly() && isPHGList) &&
+			!(PHG_IsDetectOnTheFly() && (isPHGList || isColList))) {
+		
+		phgrdhstBinDetections(decayPtr, detectedBlues, numBluePhotons,
+			detectedPinks, numPinkPhotons);
+		return;
+	}
+	
+	/* Convert to tracking photons */
+	for (photonIndex = 0; photonIndex < numBluePhotons; photonIndex++) {
+		PhgBinTrackingPhoton(decayPtr, &detectedBlues[photonIndex], &bluePhotons[photonIndex]);
+	}
+	for (photonIndex = 0; photonIndex < numPinkPhotons; photonIndex++) {
+		PhgBinTrackingPhoton(decayPtr, &detectedPinks[photonIndex], &pinkPhotons[photonIndex]);
+	}
+	
+	/* zero out processed event counters--this keeps us from mistakenly
+     reprocessing photons from the previous decay */
+	phgrdhstColPhotons.NumCollimatedBluePhotons = 0;
+	phgrdhstColPhotons.NumCollimatedPinkPhotons = 0;
+	phgrdhstDetPhotons.NumDetectedBluePhotons = 0;
+	phgrdhstDetPhotons.NumDetectedPinkPhotons = 0;
+    
+	/* Write the info if there were any detections */
+	if (PHG_IsPETCoincidencesOnly()){
+		
+		/* For PET check for both blue and pink photons to process detections */
+		if ((numBluePhotons != 0) &&
+            (numPinkPhotons != 0)) {
+			
+			/* Collimate them if requested, note that if we are reading
+             a collimator history file then we don't want to do this,
+             even though PHG_IsCollimateOnTheFly is set to true.
+			 */
+			if ( PHG_IsCollimateOnTheFly() && (isPHGList) ) {
+                
+				ColPETPhotons(decayPtr,
+                              bluePhotons, numBluePhotons,
+                              pinkPhotons, numPinkPhotons,
+                              &phgrdhstColPhotons);
+			}
+			
+			/* Detect them if requested */
+			if ( PHG_IsDetectOnTheFly() && (isPHGList || isColList) ) {
+                
+				/* Send collimated photons if it was done */
+				if ( PHG_IsCollimateOnTheFly() && (isPHGList) ) {
+					DetPETPhotons(decayPtr,
+                                  phgrdhstColPhotons.CollimatedTrkngBluePhotons,
+                                  phgrdhstColPhotons.NumCollimatedBluePhotons,
+                                  phgrdhstColPhotons.CollimatedTrkngPinkPhotons,
+                                  phgrdhstColPhotons.NumCollimatedPinkPhotons,
+                                  &phgrdhstDetPhotons);
+				}
+				else {
+					DetPETPhotons(decayPtr,
+                                  bluePhotons, numBluePhotons,
+                                  pinkPhotons, numPinkPhotons,
+                                  &phgrdhstDetPhotons);
+				}
+				
+				PhgBinPETPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+                                 decayPtr,
+                                 phgrdhstDetPhotons.DetectedTrkngBluePhotons,
+                                 phgrdhstDetPhotons.NumDetectedBluePhotons,
+                                 phgrdhstDetPhotons.DetectedTrkngPinkPhotons,
+                                 phgrdhstDetPhotons.NumDetectedPinkPhotons);
+			}
+			else if ( PHG_IsCollimateOnTheFly() && (isPHGList) ) {
+                
+                PhgBinPETPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+                                 decayPtr,
+                                 phgrdhstColPhotons.CollimatedTrkngBluePhotons,
+                                 phgrdhstColPhotons.NumCollimatedBluePhotons,
+                                 phgrdhstColPhotons.CollimatedTrkngPinkPhotons,
+                                 phgrdhstColPhotons.NumCollimatedPinkPhotons);
+			}
+			else {
+				/* Bin up non-collimated photons */
+				PhgBinPETPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+                                 decayPtr,
+                                 bluePhotons, numBluePhotons,
+                                 pinkPhotons, numPinkPhotons);
+			}
+		}
+	} else if (PHG_IsPETCoincPlusSingles()){
+		
+		/* For PET check there are blue or pink photons to process detections */
+		if ((numBluePhotons != 0) ||
+            (numPinkPhotons != 0)) {
+			
+			/* Collimate them if requested, note that if we are reading
+             a collimator history file then we don't want to do this,
+             even though PHG_IsCollimateOnTheFly is set to true.
+			 */
+			if ( PHG_IsCollimateOnTheFly() && (isPHGList) ) {
+                
+				ColPETPhotons(decayPtr,
+                              bluePhotons, numBluePhotons,
+                              pinkPhotons, numPinkPhotons,
+                              &phgrdhstColPhotons);
+			}
+			
+			/* Detect them if requested */
+			if ( PHG_IsDetectOnTheFly() && (isPHGList || isColList) ) {
+                
+				/* Send collimated photons if it was done */
+				if ( PHG_IsCollimateOnTheFly() && (isPHGList) ) {
+					DetPETPhotons(decayPtr,
+                                  phgrdhstColPhotons.CollimatedTrkngBluePhotons,
+                                  phgrdhstColPhotons.NumCollimatedBluePhotons,
+                                  phgrdhstColPhotons.CollimatedTrkngPinkPhotons,
+                                  phgrdhstColPhotons.NumCollimatedPinkPhotons,
+                                  &phgrdhstDetPhotons);
+				}
+				else {
+					DetPETPhotons(decayPtr,
+                                  bluePhotons, numBluePhotons,
+                                  pinkPhotons, numPinkPhotons,
+                                  &phgrdhstDetPhotons);
+				}
+				
+				if ( PhgBinParams[0].isBinPETasSPECT ) {
+					
+					PhgBinSPECTPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+                                       decayPtr,
+                                       phgrdhstDetPhotons.DetectedTrkngBluePhotons,
+                                       phgrdhstDetPhotons.NumDetectedBluePhotons);
+                    
+					PhgBinSPECTPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+                                       decayPtr,
+                                       phgrdhstDetPhotons.DetectedTrkngPinkPhotons,
+                                       phgrdhstDetPhotons.NumDetectedPinkPhotons);
+                    
+					
+				} else {
+                    
+					PhgBinPETPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+                                     decayPtr,
+                                     phgrdhstDetPhotons.DetectedTrkngBluePhotons,
+                                     phgrdhstDetPhotons.NumDetectedBluePhotons,
+                                     phgrdhstDetPhotons.DetectedTrkngPinkPhotons,
+                                     phgrdhstDetPhotons.NumDetectedPinkPhotons);
+					
+				}
+				
+			}
+			else if ( PHG_IsCollimateOnTheFly() && (isPHGList) ) {
+                
+				if ( PhgBinParams[0].isBinPETasSPECT ) {
+					
+					PhgBinSPECTPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+                                       decayPtr,
+                                       phgrdhstColPhotons.CollimatedTrkngBluePhotons,
+                                       phgrdhstColPhotons.NumCollimatedBluePhotons);
+                    
+					PhgBinSPECTPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+                                       decayPtr,
+                                       phgrdhstColPhotons.CollimatedTrkngPinkPhotons,
+                                       phgrdhstColPhotons.NumCollimatedPinkPhotons);
+					
+				} else {
+                    
+					PhgBinPETPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+                                     decayPtr,
+                                     phgrdhstColPhotons.CollimatedTrkngBluePhotons,
+                                     phgrdhstColPhotons.NumCollimatedBluePhotons,
+                                     phgrdhstColPhotons.CollimatedTrkngPinkPhotons,
+                                     phgrdhstColPhotons.NumCollimatedPinkPhotons);
+					
+				}
+				
+			}
+			else {
+				/* Bin up non-collimated photons */
+				if ( PhgBinParams[0].isBinPETasSPECT ) {
+					
+					PhgBinSPECTPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+                                       decayPtr,
+                                       bluePhotons, numBluePhotons);
+                    
+					PhgBinSPECTPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+                                       decayPtr,
+                                       pinkPhotons, numPinkPhotons);
+					
+				} else {
+					
+					PhgBinPETPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+                                     decayPtr,
+                                     bluePhotons, numBluePhotons,
+                                     pinkPhotons, numPinkPhotons);
+					
+				}
+				
+			}
+		}
+	}
+	else {
+        
+		/* For SPECT check for blue photos to process detections */
+		if (numBluePhotons != 0) {
+            
+			/* Collimate them if necessary */
+			if ( PHG_IsCollimateOnTheFly() && (isPHGList) ) {
+				
+				ColSPECTPhotons(decayPtr,
+                                bluePhotons, numBluePhotons,
+                                &phgrdhstColPhotons);
+			}
+            
+			/* Detect them if requested */
+			if ( PHG_IsDetectOnTheFly() && ( isPHGList || isColList ) ) {
+                
+				if ( PHG_IsCollimateOnTheFly() && (isPHGList) ) {
+					
+					DetSPECTPhotons(decayPtr,
+                                    phgrdhstColPhotons.CollimatedTrkngBluePhotons,
+                                    phgrdhstColPhotons.NumCollimatedBluePhotons,
+                                    &phgrdhstDetPhotons);
+				}
+				else {
+					DetSPECTPhotons(decayPtr,
+                                    bluePhotons, numBluePhotons,
+                                    &phgrdhstDetPhotons);
+				}
+                
+				PhgBinSPECTPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+                                   decayPtr,
+                                   phgrdhstDetPhotons.DetectedTrkngBluePhotons,
+                                   phgrdhstDetPhotons.NumDetectedBluePhotons);
+			}
+			else if ( PHG_IsCollimateOnTheFly() && (isPHGList) ) {
+                
+				PhgBinSPECTPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+                                   decayPtr,
+                                   phgrdhstColPhotons.CollimatedTrkngBluePhotons,
+                                   phgrdhstColPhotons.NumCollimatedBluePhotons);
+			}
+			else {
+				/* phgrdhst up non-collimated photons */
+				PhgBinSPECTPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+                                   decayPtr,
+                                   bluePhotons, numBluePhotons);
+			}
+		}
+	}
+}
+
+/**********************
+ *	phgrdhstAddRandoms
+ *
+ *	Purpose:	Add randoms to the time-sorted decays of a detector
+ *				history file and bin the result, without writing the
+ *				randoms-added history file unless one is named in the
+ *				detector parameters.  The decays are streamed through the
+ *				time windows of addrandoms (AdRandBeginStream) and each
+ *				randoms-added decay is binned by phgrdhstBinDetections.
+ *
+ *	Result:		True unless an error occurs.
+ ***********************/
+Boolean phgrdhstAddRandoms(PhoHFileCursorTy *historyCursor)
+{
+	Boolean				okay = false;				/* Process flag */
+	EventTy				eventType;					/* Type of current event */
+	PHG_Decay		   	decay;						/* The decay */
+	PHG_DetectedPhoton	detectedPhoton;				/* The detected photon */
+	
+	do { /* Process Loop */
+		
+		if (AdRandBeginStream(&phgrdhstHdrParams, phgrdhstBinDetections) == false) {
+			break;
+		}
+		
+		/* Read the initial event */
+		eventType = readEvent(historyCursor, &decay, &detectedPhoton);
+		if (eventType != Decay) {
+			ErStGeneric("Expected first event to be decay, and it wasn't.");
+			break;
+		}
+		
+		/* Pass all the events on in time order */
+		while (eventType != Null) {
+			if (eventType == Decay) {
+				AdRandAddDecay(&decay);
+			}
+			else {
+				AdRandAddPhoton(&detectedPhoton);
+			}
+			
+			eventType = readEvent(historyCursor, &decay, &detectedPhoton);
+		}
+		
+		if (AdRandEndStream() == false) {
+			break;
+		}
+		
+		okay = true;
+	} while (false);
+	
+	return (okay);
+}
+
+/**********************
+ *	phgrdhstBinDetections
+ *
+ *	Purpose:	Bin the photons of a decay as they were read from a history
+ *				file, or as they came out of the randoms time windows.
+ *
+ *	Arguments:
+ *		PHG_Decay			*decayPtr		- The decay.
+ *		PHG_DetectedPhoton	*bluePhotons	- The blue photons of the decay.
+ *		LbUsFourByte		numBluePhotons	- The number of blue photons.
+ *		PHG_DetectedPhoton	*pinkPhotons	- The pink photons of the decay.
+ *		LbUsFourByte		numPinkPhotons	- The number of pink photons.
+ *
+ *	Result:		None.
+ ***********************/
+void phgrdhstBinDetections(PHG_Decay *decayPtr,
+			PHG_DetectedPhoton *bluePhotons, LbUsFourByte numBluePhotons,
+			PHG_DetectedPhoton *pinkPhotons, LbUsFourByte numPinkPhotons)
+{
+	if (PHG_IsPETCoincidencesOnly()) {
+		if ((numBluePhotons != 0) && (numPinkPhotons != 0)) {
+			PhgBinPETDetectedPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+							 decayPtr,
+							 bluePhotons, numBluePhotons,
+							 pinkPhotons, numPinkPhotons);
+		}
+	}
+	else if (PHG_IsPETCoincPlusSingles()) {
+		if ((numBluePhotons != 0) || (numPinkPhotons != 0)) {
+			if ( PhgBinParams[0].isBinPETasSPECT ) {
+				
+				PhgBinSPECTDetectedPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+								   decayPtr,
+								   bluePhotons, numBluePhotons);
+				
+				PhgBinSPECTDetectedPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+								   decayPtr,
+								   pinkPhotons, numPinkPhotons);
+				
+			} else {
+				
+				PhgBinPETDetectedPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+								 decayPtr,
+								 bluePhotons, numBluePhotons,
+								 pinkPhotons, numPinkPhotons);
+				
+			}
+		}
+	}
+	else if (numBluePhotons != 0) {
+		PhgBinSPECTDetectedPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
+						   decayPtr,
+						   bluePhotons, numBluePhotons);
+	}
+}
+
+/**********************
+ *	phgrdhstBinRange
+ *
+ *	Purpose:	Bin one of the ranges of decays a history file was divided
+ *				into, with the range's own random number stream.  Called by
+ *				the worker processes.
+ *
+ *	Result:		True unless an error occurs.
+ ***********************/
+Boolean phgrdhstBinRange(LbUsFourByte rangeIndex)
+{
+	PhoHFileCursorTy	rangeCursor;			/* Reads the events of the range */
+	
+	/* A range is empty when a decay spans more than one */
+	if (phgrdhstRangeBounds[rangeIndex] == phgrdhstRangeBounds[rangeIndex+1]) {
+		return (true);
+	}
+	
+	/* Give the range its own random number stream for collimation and detection */
+	PhgMathInitRNGStream(PhgRunTimeParams.PhgRandomSeed, rangeIndex+1);
+	
+	/* Read the range from a copy of the file's cursor */
+	rangeCursor = *phgrdhstRangeCursor;
+	PhoHFileSetCursorRange(&rangeCursor, phgrdhstRangeBounds[rangeIndex],
+		phgrdhstRangeBounds[rangeIndex+1]);
+	
+	return (phgrdhstBinDecays(0, &rangeCursor, false, false, false,
+		phgrdhstRangeIsPHGList, phgrdhstRangeIsColList,
+		phgrdhstRangeBluePhotons, phgrdhstRangePinkPhotons));
+}
+
+/**********************
+ *	phgrdhstBinInParallel
+ *
+ *	Purpose:	Divide the decays of a mapped history file into ranges and
+ *				bin them with the worker processes.  The number of ranges
+ *				depends only on the size of the file, so the results don't
+ *				depend on the number of workers.  A compressed file is
+ *				divided between its chunks, found in its chunk index.  The
+ *				decay index of a standard file, if it has one, places the
+ *				range boundaries; otherwise the events are scanned for them.
+ *				The cursor is left at the end of the file.
+ *
+ *	Result:		True unless an error occurs.
+ ***********************/
+Boolean phgrdhstBinInParallel(PhoHFileCursorTy *historyCursor,
+			Boolean isPHGList, Boolean isColList,
+			PHG_TrackingPhoton *bluePhotons, PHG_TrackingPhoton *pinkPhotons)
+{
+	Boolean					okay = false;			/* Process flag */
+	LbUsEightByte			numBytes;				/* Bytes of events */
+	LbUsFourByte			numRanges;				/* Ranges the file is divided into */
+	PhoHFileDecayIndexHdrTy	indexHdr;				/* Header of the decay index */
+	PhoHFileChunkEntryTy	*indexEntries = 0;		/* Entries of the decay index */
+	
+	phgrdhstRangeBounds = 0;
+	
+	do { /* Process Loop */
+		
+		/* Divide the events into ranges of about PHGRDHST_RANGE_BYTES */
+		numBytes = historyCursor->rangeEnd - historyCursor->position;
+		if (numBytes/PHGRDHST_RANGE_BYTES >= PHGPAR_MAX_BLOCKS) {
+			numRanges = PHGPAR_MAX_BLOCKS;
+		}
+		else {
+			numRanges = (LbUsFourByte) ((numBytes + PHGRDHST_RANGE_BYTES - 1)/PHGRDHST_RANGE_BYTES);
+			if (numRanges == 0)
+				numRanges = 1;
+		}
+		
+		if ((phgrdhstRangeBounds = (LbUsEightByte *) LbMmAlloc(sizeof(LbUsEightByte) *
+				(numRanges + 1))) == 0) {
+			break;
+		}
+		
+		/* A compressed file's chunks hold whole decays; its chunk index has
+			the same entries as a decay index, so the ranges are placed the same way
+		*/
+		if (historyCursor->reader != 0) {
+			if (PhoHFileReadChunkIndex(historyCursor->historyFile, &indexEntries,
+					&indexHdr.numEntries) == false) {
+				break;
+			}
+			indexHdr.eventsStart = historyCursor->position;
+			indexHdr.fileSize = historyCursor->rangeEnd;
+			
+			PhoHFileSplitIndex(&indexHdr, indexEntries, numRanges, phgrdhstRangeBounds);
+		}
+		else {
+			/* Use the decay index if it covers these events */
+			if (PhoHFileReadDecayIndex(phgrdhstHistName, &indexHdr, &indexEntries) == false) {
+				break;
+			}
+			if ((indexHdr.numEntries != 0) &&
+					(indexHdr.eventsStart == historyCursor->position) &&
+					(indexHdr.fileSize == historyCursor->rangeEnd)) {
+				
+				PhoHFileSplitIndex(&indexHdr, indexEntries, numRanges, phgrdhstRangeBounds);
+			}
+			else if (PhoHFileSplitCursor(historyCursor, numRanges, phgrdhstRangeBounds) == false) {
+				break;
+			}
+			
+			/* Every range must start with a decay */
+			if (!PHG_IsADecay((LbUsFourByte) historyCursor->mapping[phgrdhstRangeBounds[0]])) {
+				ErStGeneric("Expected first event to be decay, and it wasn't.");
+				break;
+			}
+		}
+		
+		if (PhgParNumRanks == 1) {
+			LbInPrintf("\nBinning %llu bytes of events in %lu ranges with %lu worker processes.\n",
+				(unsigned long long) numBytes, (unsigned long) numRanges,
+				(unsigned long) PhgParNumWorkers);
+		}
+		else {
+			LbInPrintf("\nBinning %llu bytes of events in %lu ranges on %lu ranks with %lu worker processes each.\n",
+				(unsigned long long) numBytes, (unsigned long) numRanges,
+				(unsigned long) PhgParNumRanks, (unsigned long) PhgParNumWorkers);
+		}
+		
+		/* Bin the ranges */
+		phgrdhstRangeCursor = historyCursor;
+		phgrdhstRangeIsPHGList = isPHGList;
+		phgrdhstRangeIsColList = isColList;
+		phgrdhstRangeBluePhotons = bluePhotons;
+		phgrdhstRangePinkPhotons = pinkPhotons;
+		
+		if (PhgParProcessBlocks(numRanges, phgrdhstBinRange, "binned") == false) {
+			break;
+		}
+		
+		/* The whole file has been read */
+		PhoHFileSetCursorRange(historyCursor, historyCursor->rangeEnd, historyCursor->rangeEnd);
+		
+		okay = true;
+	} while (false);
+	
+	if (phgrdhstRangeBounds != 0)
+		LbMmFree((void **) &phgrdhstRangeBounds);
+	
+	if (indexEntries != 0)
+		LbMmFree((void **) &indexEntries);
+	
+	return (okay);
+}
+
 /**********************
  *	phgrdhstStandard
  *
@@ -401,21 +1077,12 @@ void phgrdhstTerminate()
 Boolean phgrdhstStandard(char *argv[])
 {
 	Boolean				okay = false;				/* Process flag */
-	EventTy				eventType;					/* Type of current event */
 	FILE				*historyFile;				/* The history file we are going to process */
 	LbHdrHkTy			headerHk;					/* Hook to header */
-	LbUsFourByte		numBluePhotons;				/* Number of blue photons for this decay */
-	LbUsFourByte		numPinkPhotons;				/* Number of pink photons for this decay */
 	LbUsFourByte		curFileIndex;				/* Current file index */
-	LbUsFourByte		numPhotonsProcessed;		/* Number of photons processed */
-	LbUsFourByte		numDecaysProcessed;			/* Number of decays processed */
-	PHG_Decay		   	decay;						/* The decay */
-	PHG_Decay		   	nextDecay;					/* The decay */
-	PHG_DetectedPhoton	detectedPhoton;				/* The detected photon */
-	PHG_TrackingPhoton	trackingPhoton;				/* The tracking photon */
+	PhoHFileCursorTy	historyCursor;				/* Reads the events of the history file */
 	PHG_TrackingPhoton	*bluePhotons = 0;			/* Blue photons for current decay */
 	PHG_TrackingPhoton	*pinkPhotons = 0;			/* Pink photon for current decay*/
-	double 				angle_norm;					/* for normalizing photon direction */
 	Boolean				isOldPhotons1;				/* is this a very old history file--must be
                                                      read using oldReadEvent */
 	Boolean				isOldPhotons2;				/* is this a moderately old history file--must be
@@ -449,8 +1116,8 @@ Boolean phgrdhstStandard(char *argv[])
 		}
         
 		/* Clear loop variables */
-		numPhotonsProcessed = 0;
-		numDecaysProcessed = 0;
+		historyCursor.mapping = 0;
+		historyCursor.reader = 0;
 		
 		/* Process the files */
 		for (curFileIndex = 1; curFileIndex <= phgrdhstNumToProc; curFileIndex++){
@@ -582,366 +1249,50 @@ Boolean phgrdhstStandard(char *argv[])
 			LbInPrintf("\n***********************\n");
             
 			{
-				/* Read the initial event */
-				if (isOldDecays) {
-					eventType = oldReadEvent(historyFile, &decay, &detectedPhoton, isOldPhotons1, isOldPhotons2);
-				} else {
-					eventType = readEvent(historyFile, &decay, &detectedPhoton);
-				}
-                
-				if (eventType != Decay) {
-					ErStGeneric("Expected first event to be decay, and it wasn't.");
-					goto FAIL;
+				/* Current files are read from a mapping of the file */
+				if (!isOldDecays) {
+					PhoHFileOpenCursor(historyFile, &historyCursor);
 				}
-                
-				/* Loop through all decays */
-				while (eventType == Decay) {
-                    
-					numDecaysProcessed++;
-					
-					/* Clear decay variables */
-					numBluePhotons = 0;
-					numPinkPhotons = 0;
-					
-					/* Read next event */
+				
+				/* Randoms are added to the decays in time order, so they
+					are binned serially
+				*/
+				if (PHGRDHST_IsAddRandoms()) {
 					if (isOldDecays) {
-						eventType = oldReadEvent(historyFile, &nextDecay, &detectedPhoton, isOldPhotons1, isOldPhotons2);
-					} else {
-						eventType = readEvent(historyFile, &nextDecay, &detectedPhoton);
+						ErStGeneric("Randoms can't be added to an old history file.");
+						goto FAIL;
 					}
-					
-                    while ( eventType == Photon)
-                    {
-                        
-						/* Convert to a tracking photon */
-						{
-							
-							/* initialize fields not stored in standard history file */
-							trackingPhoton.sliceIndex = 0;
-							trackingPhoton.angleIndex =  -1;
-							trackingPhoton.origSliceIndex = -1;
-							trackingPhoton.origAngleIndex = -1;
-							trackingPhoton.xIndex = -1;
-							trackingPhoton.yIndex = -1;
-							trackingPhoton.scatters_in_col = 0; /* We don't know this value--user must
-                                                                 create a custom history file if they
-                                                                 want it, otherwise these scatters are
-                                                                 folded into the num_of_scatters field below  */
-							trackingPhoton.scatter_target_weight  = 0;
-							trackingPhoton.num_det_interactions = 0;
-							
-							/* copy decay weight from decay */
-							trackingPhoton.decay_weight = decay.startWeight;
-                            
-							/* the rest of the tracking photon is copied from detectedPhoton */
-							{
-								
-								/* Flags are currently stored in first two bytes, with upper bits
-                                 representing number of scatters
-                                 */
-								trackingPhoton.flags = (detectedPhoton.flags & 3);
-								trackingPhoton.num_of_scatters =
-                                (detectedPhoton.flags >> 2);
-                                
-								trackingPhoton.location.x_position = detectedPhoton.location.x_position;
-								trackingPhoton.location.y_position = detectedPhoton.location.y_position;
-								trackingPhoton.location.z_position = detectedPhoton.location.z_position;
-								trackingPhoton.angle.cosine_x = detectedPhoton.angle.cosine_x;
-								trackingPhoton.angle.cosine_y = detectedPhoton.angle.cosine_y;
-								trackingPhoton.angle.cosine_z = detectedPhoton.angle.cosine_z;
-                                
-								{
-									/* normalize photon direction - it is written out as float but needs to be
-                                     double precision unit length for som,e functions */
-									angle_norm = sqrt(	(double)detectedPhoton.angle.cosine_x * (double)detectedPhoton.angle.cosine_x +
-                                                      (double)detectedPhoton.angle.cosine_y * (double)detectedPhoton.angle.cosine_y +
-                                                      (double)detectedPhoton.angle.cosine_z * (double)detectedPhoton.angle.cosine_z );
-									trackingPhoton.angle.cosine_x = (double)detectedPhoton.angle.cosine_x / angle_norm;
-									trackingPhoton.angle.cosine_y = (double)detectedPhoton.angle.cosine_y / angle_norm;
-									trackingPhoton.angle.cosine_z = (double)detectedPhoton.angle.cosine_z / angle_norm;
-								}
-                                
-								trackingPhoton.transaxialPosition = detectedPhoton.transaxialPosition;
-								trackingPhoton.azimuthalAngleIndex = detectedPhoton.azimuthalAngleIndex;
-								trackingPhoton.detectorAngle = detectedPhoton.detectorAngle;
-								trackingPhoton.detCrystal = detectedPhoton.detCrystal;
-								if (trackingPhoton.num_of_scatters == 0){
-									trackingPhoton.photon_scatter_weight = 0;
-									trackingPhoton.photon_primary_weight =
-                                    detectedPhoton.photon_weight;
-									trackingPhoton.photon_current_weight =
-                                    detectedPhoton.photon_weight;
-								}
-								else {
-									trackingPhoton.photon_scatter_weight =
-                                    detectedPhoton.photon_weight;
-									trackingPhoton.photon_current_weight =
-                                    detectedPhoton.photon_weight;
-									trackingPhoton.photon_primary_weight = 0;
-								}
-								trackingPhoton.energy = detectedPhoton.energy;
-								trackingPhoton.travel_distance  =
-                                detectedPhoton.time_since_creation * PHGMATH_SPEED_OF_LIGHT;
-								trackingPhoton.numStarts = 0;
-								trackingPhoton.number = (LbUsEightByte) -1;
-                                
-							}
-						}
-                        
-						/* See if it is blue or pink */
-						if (LbFgIsSet(trackingPhoton.flags, PHGFg_PhotonBlue)) {
-							bluePhotons[numBluePhotons] = trackingPhoton;
-							numBluePhotons++;
-						}
-						else {
-							pinkPhotons[numPinkPhotons] = trackingPhoton;
-							numPinkPhotons++;
-						}
-						
-						numPhotonsProcessed++;
-                        
-						/* Read next event */
-						if (isOldDecays) {
-							eventType = oldReadEvent(historyFile, &nextDecay, &detectedPhoton, isOldPhotons1,isOldPhotons2);
-						} else {
-							eventType = readEvent(historyFile, &nextDecay, &detectedPhoton);
-						}
-                        
+					if (PHGPAR_IsParallel()) {
+						LbInPrintf("\nRandoms are added in time order, binning serially.\n");
 					}
 					
-					/* zero out processed event counters--this keeps us from mistakenly
-                     reprocessing photons from the previous decay */
-					phgrdhstColPhotons.NumCollimatedBluePhotons = 0;
-					phgrdhstColPhotons.NumCollimatedPinkPhotons = 0;
-					phgrdhstDetPhotons.NumDetectedBluePhotons = 0;
-					phgrdhstDetPhotons.NumDetectedPinkPhotons = 0;
-                    
-					/* Write the info if there were any detections */
-					if (PHG_IsPETCoincidencesOnly()){
-						
-						/* For PET check for both blue and pink photons to process detections */
-						if ((numBluePhotons != 0) &&
-                            (numPinkPhotons != 0)) {
-							
-							/* Collimate them if requested, note that if we are reading
-                             a collimator history file then we don't want to do this,
-                             even though PHG_IsCollimateOnTheFly is set to true.
-							 */
-							if ( PHG_IsCollimateOnTheFly() && (isPHGList) ) {
-                                
-								ColPETPhotons(&decay,
-                                              bluePhotons, numBluePhotons,
-                                              pinkPhotons, numPinkPhotons,
-                                              &phgrdhstColPhotons);
-							}
-							
-							/* Detect them if requested */
-							if ( PHG_IsDetectOnTheFly() && (isPHGList || isColList) ) {
-                                
-								/* Send collimated photons if it was done */
-								if ( PHG_IsCollimateOnTheFly() && (isPHGList) ) {
-									DetPETPhotons(&decay,
-                                                  phgrdhstColPhotons.CollimatedTrkngBluePhotons,
-                                                  phgrdhstColPhotons.NumCollimatedBluePhotons,
-                                                  phgrdhstColPhotons.CollimatedTrkngPinkPhotons,
-                                                  phgrdhstColPhotons.NumCollimatedPinkPhotons,
-                                                  &phgrdhstDetPhotons);
-								}
-								else {
-									DetPETPhotons(&decay,
-                                                  bluePhotons, numBluePhotons,
-                                                  pinkPhotons, numPinkPhotons,
-                                                  &phgrdhstDetPhotons);
-								}
-								
-								PhgBinPETPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
-                                                 &decay,
-                                                 phgrdhstDetPhotons.DetectedTrkngBluePhotons,
-                                                 phgrdhstDetPhotons.NumDetectedBluePhotons,
-                                                 phgrdhstDetPhotons.DetectedTrkngPinkPhotons,
-                                                 phgrdhstDetPhotons.NumDetectedPinkPhotons);
-							}
-							else if ( PHG_IsCollimateOnTheFly() && (isPHGList) ) {
-                                
-                                PhgBinPETPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
-                                                 &decay,
-                                                 phgrdhstColPhotons.CollimatedTrkngBluePhotons,
-                                                 phgrdhstColPhotons.NumCollimatedBluePhotons,
-                                                 phgrdhstColPhotons.CollimatedTrkngPinkPhotons,
-                                                 phgrdhstColPhotons.NumCollimatedPinkPhotons);
-							}
-							else {
-								/* Bin up non-collimated photons */
-								PhgBinPETPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
-                                                 &decay,
-                                                 bluePhotons, numBluePhotons,
-                                                 pinkPhotons, numPinkPhotons);
-							}
-						}
-					} else if (PHG_IsPETCoincPlusSingles()){
-						
-						/* For PET check there are blue or pink photons to process detections */
-						if ((numBluePhotons != 0) ||
-                            (numPinkPhotons != 0)) {
-							
-							/* Collimate them if requested, note that if we are reading
-                             a collimator history file then we don't want to do this,
-                             even though PHG_IsCollimateOnTheFly is set to true.
-							 */
-							if ( PHG_IsCollimateOnTheFly() && (isPHGList) ) {
-                                
-								ColPETPhotons(&decay,
-                                              bluePhotons, numBluePhotons,
-                                              pinkPhotons, numPinkPhotons,
-                                              &phgrdhstColPhotons);
-							}
-							
-							/* Detect them if requested */
-							if ( PHG_IsDetectOnTheFly() && (isPHGList || isColList) ) {
-                                
-								/* Send collimated photons if it was done */
-								if ( PHG_IsCollimateOnTheFly() && (isPHGList) ) {
-									DetPETPhotons(&decay,
-                                                  phgrdhstColPhotons.CollimatedTrkngBluePhotons,
-                                                  phgrdhstColPhotons.NumCollimatedBluePhotons,
-                                                  phgrdhstColPhotons.CollimatedTrkngPinkPhotons,
-                                                  phgrdhstColPhotons.NumCollimatedPinkPhotons,
-                                                  &phgrdhstDetPhotons);
-								}
-								else {
-									DetPETPhotons(&decay,
-                                                  bluePhotons, numBluePhotons,
-                                                  pinkPhotons, numPinkPhotons,
-                                                  &phgrdhstDetPhotons);
-								}
-								
-								if ( PhgBinParams[0].isBinPETasSPECT ) {
-									
-									PhgBinSPECTPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
-                                                       &decay,
-                                                       phgrdhstDetPhotons.DetectedTrkngBluePhotons,
-                                                       phgrdhstDetPhotons.NumDetectedBluePhotons);
-                                    
-									PhgBinSPECTPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
-                                                       &decay,
-                                                       phgrdhstDetPhotons.DetectedTrkngPinkPhotons,
-                                                       phgrdhstDetPhotons.NumDetectedPinkPhotons);
-                                    
-									
-								} else {
-                                    
-									PhgBinPETPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
-                                                     &decay,
-                                                     phgrdhstDetPhotons.DetectedTrkngBluePhotons,
-                                                     phgrdhstDetPhotons.NumDetectedBluePhotons,
-                                                     phgrdhstDetPhotons.DetectedTrkngPinkPhotons,
-                                                     phgrdhstDetPhotons.NumDetectedPinkPhotons);
-									
-								}
-								
-							}
-							else if ( PHG_IsCollimateOnTheFly() && (isPHGList) ) {
-                                
-								if ( PhgBinParams[0].isBinPETasSPECT ) {
-									
-									PhgBinSPECTPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
-                                                       &decay,
-                                                       phgrdhstColPhotons.CollimatedTrkngBluePhotons,
-                                                       phgrdhstColPhotons.NumCollimatedBluePhotons);
-                                    
-									PhgBinSPECTPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
-                                                       &decay,
-                                                       phgrdhstColPhotons.CollimatedTrkngPinkPhotons,
-                                                       phgrdhstColPhotons.NumCollimatedPinkPhotons);
-									
-								} else {
-                                    
-									PhgBinPETPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
-                                                     &decay,
-                                                     phgrdhstColPhotons.CollimatedTrkngBluePhotons,
-                                                     phgrdhstColPhotons.NumCollimatedBluePhotons,
-                                                     phgrdhstColPhotons.CollimatedTrkngPinkPhotons,
-                                                     phgrdhstColPhotons.NumCollimatedPinkPhotons);
-									
-								}
-								
-							}
-							else {
-								/* Bin up non-collimated photons */
-								if ( PhgBinParams[0].isBinPETasSPECT ) {
-									
-									PhgBinSPECTPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
-                                                       &decay,
-                                                       bluePhotons, numBluePhotons);
-                                    
-									PhgBinSPECTPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
-                                                       &decay,
-                                                       pinkPhotons, numPinkPhotons);
-									
-								} else {
-									
-									PhgBinPETPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
-                                                     &decay,
-                                                     bluePhotons, numBluePhotons,
-                                                     pinkPhotons, numPinkPhotons);
-									
-								}
-								
-							}
-						}
+					if (phgrdhstAddRandoms(&historyCursor) == false) {
+						goto FAIL;
 					}
-					else {
-                        
-						/* For SPECT check for blue photos to process detections */
-						if (numBluePhotons != 0) {
-                            
-							/* Collimate them if necessary */
-							if ( PHG_IsCollimateOnTheFly() && (isPHGList) ) {
-								
-								ColSPECTPhotons(&decay,
-                                                bluePhotons, numBluePhotons,
-                                                &phgrdhstColPhotons);
-							}
-                            
-							/* Detect them if requested */
-							if ( PHG_IsDetectOnTheFly() && ( isPHGList || isColList ) ) {
-                                
-								if ( PHG_IsCollimateOnTheFly() && (isPHGList) ) {
-									
-									DetSPECTPhotons(&decay,
-                                                    phgrdhstColPhotons.CollimatedTrkngBluePhotons,
-                                                    phgrdhstColPhotons.NumCollimatedBluePhotons,
-                                                    &phgrdhstDetPhotons);
-								}
-								else {
-									DetSPECTPhotons(&decay,
-                                                    bluePhotons, numBluePhotons,
-                                                    &phgrdhstDetPhotons);
-								}
-                                
-								PhgBinSPECTPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
-                                                   &decay,
-                                                   phgrdhstDetPhotons.DetectedTrkngBluePhotons,
-                                                   phgrdhstDetPhotons.NumDetectedBluePhotons);
-							}
-							else if ( PHG_IsCollimateOnTheFly() && (isPHGList) ) {
-                                
-								PhgBinSPECTPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
-                                                   &decay,
-                                                   phgrdhstColPhotons.CollimatedTrkngBluePhotons,
-                                                   phgrdhstColPhotons.NumCollimatedBluePhotons);
-							}
-							else {
-								/* phgrdhst up non-collimated photons */
-								PhgBinSPECTPhotons(&PhgBinParams[0], &PhgBinData[0], &PhgBinFields[0],
-                                                   &decay,
-                                                   bluePhotons, numBluePhotons);
-							}
-						}
+				}
+				else if (PHGPAR_IsParallel() && (historyCursor.mapping != 0)) {
+					/* With worker processes, a mapped file is divided into ranges of
+						decays that are binned in parallel
+					*/
+					if (phgrdhstBinInParallel(&historyCursor, isPHGList, isColList,
+							bluePhotons, pinkPhotons) == false) {
+						goto FAIL;
+					}
+				}
+				else {
+					if (PHGPAR_IsParallel()) {
+						LbInPrintf("\nThis history file can't be divided, binning it serially.\n");
 					}
 					
-					/* Update current decay */
-					decay = nextDecay;
+					if (phgrdhstBinDecays(historyFile, &historyCursor, isOldDecays,
+							isOldPhotons1, isOldPhotons2, isPHGList, isColList,
+							bluePhotons, pinkPhotons) == false) {
+						goto FAIL;
+					}
+				}
+				
+				if (!isOldDecays) {
+					PhoHFileCloseCursor(&historyCursor);
 				}
 			}
 			/* Open next file */
@@ -1005,6 +1356,9 @@ Boolean phgrdhstStandard(char *argv[])
     CANCEL:;
 	} while (false);
 	
+	/* Release the mapping of a file left unfinished */
+	PhoHFileCloseCursor(&historyCursor);
+	
 	/* Free memory */
 	if (bluePhotons != 0)
 		LbMmFree((void **) &bluePhotons);
@@ -1031,6 +1385,8 @@ Boolean phgrdhstCustom(char *argv[])
 	PHG_Decay			decay;				/* The decay we are reading */
 	PHG_TrackingPhoton	*bluePhotons;		/* The blue photons we read */
 	PHG_TrackingPhoton	*pinkPhotons;		/* The pink photon we read */
+	PHG_DetInteractionsTy	*blueInteractions = 0;	/* Detector interactions of the blue photons */
+	PHG_DetInteractionsTy	*pinkInteractions = 0;	/* Detector interactions of the pink photons */
 	PHG_TrackingPhoton	bPhoton;			/* The blue photon we are reading */
 	PHG_TrackingPhoton	pPhoton;			/* The pink photon we are reading */
 	LbUsOneByte			numBlue;			/* Number of blue photons for this decay */
@@ -1057,6 +1413,7 @@ Boolean phgrdhstCustom(char *argv[])
 			ErStFileError(phgrdhstErrStr);
 			goto FAIL;
 		}
+		PhoHFileReadAhead(historyFile);
 		
 		/* Read in the header and verify it is the right type of file */
 		if (PhgHdrGtParams(historyFile, &phgrdhstHdrParams, &headerHk) == false){
@@ -1082,7 +1439,11 @@ Boolean phgrdhstCustom(char *argv[])
             
         } else if ( (phgrdhstHdrParams.H.HdrKind == PhoHFileEn_DET) ||
                    (phgrdhstHdrParams.H.HdrKind == PhoHFileEn_DET2625) ||
-                   (phgrdhstHdrParams.H.HdrKind == PhoHFileEn_DETOLD) ) {
+                   (phgrdhstHdrParams.H.HdrKind == PhoHFileEn_DETOLD) ||
+                   (phgrdhstHdrParams.H.HdrKind == PhoHFileEn_BIN) ) {
+            
+            /* Binning module history files hold detected photons, so
+             they can be printed like detector history files */
             
             isPHGList = false;
             isColList = false;
@@ -1147,6 +1508,17 @@ Boolean phgrdhstCustom(char *argv[])
 			break;
 		}
         
+		/* The photons' detector interactions are read into these */
+		if ((blueInteractions = (PHG_DetInteractionsTy *) LbMmAlloc(sizeof(PHG_DetInteractionsTy) *
+                                                            PHG_MAX_DETECTED_PHOTONS)) == 0) {
+			break;
+		}
+        
+		if ((pinkInteractions = (PHG_DetInteractionsTy *) LbMmAlloc(sizeof(PHG_DetInteractionsTy) *
+                                                            PHG_MAX_DETECTED_PHOTONS)) == 0) {
+			break;
+		}
+        
 		/* Loop through reading event information */
 		while (feof(historyFile) == false) {
             
@@ -1167,6 +1539,7 @@ Boolean phgrdhstCustom(char *argv[])
 			for (bIndex = 0; bIndex < numBlue; bIndex++) {
                 
 				/* Read the photon information */
+				bPhoton.det_interactions = blueInteractions[acceptedBlues];
 				if (PhoHFileReadFields(&histHk, &decay, &bPhoton, &photonAccepted) == false) {
 					goto FAIL;
 				}
@@ -1192,6 +1565,7 @@ Boolean phgrdhstCustom(char *argv[])
 				for (pIndex = 0; pIndex < numPink; pIndex++) {
                     
 					/* Read the photon information */
+					pPhoton.det_interactions = pinkInteractions[acceptedPinks];
 					if (PhoHFileReadFields(&histHk, &decay, &pPhoton, &photonAccepted) == false) {
 						goto FAIL;
 					}
@@ -1223,6 +1597,12 @@ Boolean phgrdhstCustom(char *argv[])
 	if (historyFile != 0) {
 		fclose(historyFile);
 	}
+	if (blueInteractions != 0) {
+		LbMmFree((void **)&blueInteractions);
+	}
+	if (pinkInteractions != 0) {
+		LbMmFree((void **)&pinkInteractions);
+	}
 	return(okay);
 }
 
@@ -1313,6 +1693,9 @@ Boolean phgbin(int argc, char *argv[])
 		ErHandle("User canceled readhist", false);
 		okay = true;
 	}
+	
+	/* Leave any other distributed ranks */
+	PhgParTerminate(okay);
     
 	/* Quit the program */
 	return (okay);
@@ -1324,22 +1707,22 @@ Boolean phgbin(int argc, char *argv[])
  *	Purpose:	Read the next event from the input file.
  *
  *	Arguments:
- *		FILE				*historyFile	- The history file.
+ *		PhoHFileCursorTy	*historyCursor	- The history file's cursor.
  *		PHG_Decay 			*decayPtr		- Storage for decay.
  *		PHG_DetectedPhoton	*photonPtr		- Storage for photon.
  *
  *	Result:	Enumerated type corresponding to event type.
  ***********************/
 EventTy readEvent(
-                  FILE *historyFile,
+                  PhoHFileCursorTy *historyCursor,
                   PHG_Decay *decayPtr,
                   PHG_DetectedPhoton * photonPtr	)
 {
 	EventTy				retEventType = Null;			/* The returned event type we read */
 	PhoHFileEventType	eventType = PhoHFileNullEvent;	/* The event type we read */
 	
-	/* Call PhoHFileReadEvent */
-	eventType = PhoHFileReadEvent( historyFile, decayPtr, photonPtr );
+	/* Call PhoHFileCursorEvent */
+	eventType = PhoHFileCursorEvent( historyCursor, decayPtr, photonPtr );
 	
 	/* Convert to the local event type */
 	switch ( eventType ) {
@@ -34,13 +34,19 @@
 #include "Detector.h"
 #include "phg.h"
 #include "PhgBin.h"
+#include "PhgParallel.h"
+#include "addrandoms.h"
 
 /* LOCAL CONSTANTS */
 #define PHGRDHST_IsUsePHGHistory()		LbFgIsSet(PhgOptions, LBFlag0)		/* Will we use the PHG history file */
 #define PHGRDHST_IsUseColHistory()		LbFgIsSet(PhgOptions, LBFlag1)		/* Will we use the Collimator history file */
 #define PHGRDHST_IsUseDetHistory()		LbFgIsSet(PhgOptions, LBFlag2)		/* Will we use the Detector history file */
+#define PHGRDHST_IsWorkersOption()		LbFgIsSet(PhgOptions, LBFlag3)		/* Did user supply a number of worker processes */
+#define PHGRDHST_IsAddRandoms()			LbFgIsSet(PhgOptions, LBFlag4)		/* Will we add randoms while binning */
 
-#define	PHGRDHST_NumFlags	3													/* Number of flags defined */
+#define	PHGRDHST_NumFlags	5													/* Number of flags defined */
+
+#define	PHGRDHST_RANGE_BYTES	(4*1024*1024)									/* Nominal bytes of events binned by a worker at a time */
 
 /* LOCAL TYPES */
 typedef enum  {Null, Decay, Photon} EventTy;
@@ -56,12 +62,18 @@ static char					phgrdhstHistParamsName[1024];	/* Name of history parameters file
 static LbUsFourByte			phgrdhstArgIndex;
 static ProdTblProdTblInfoTy	phgrdhstPrdTblInfo;				/* Info for initializing productivity table */
 static PhoHFileHdrTy		phgrdhstHdrParams;				/* Input header */
+static PhoHFileCursorTy		*phgrdhstRangeCursor;			/* Cursor of the file being binned in ranges */
+static LbUsEightByte		*phgrdhstRangeBounds;			/* File offsets bounding the ranges */
+static Boolean				phgrdhstRangeIsPHGList;			/* The file being binned in ranges is a PHG history file */
+static Boolean				phgrdhstRangeIsColList;			/* The file being binned in ranges is a collimator history file */
+static PHG_TrackingPhoton	*phgrdhstRangeBluePhotons;		/* Blue photons for the current decay of a range */
+static PHG_TrackingPhoton	*phgrdhstRangePinkPhotons;		/* Pink photons for the current decay of a range */
 
 /* PROTOTYPES */
 Boolean 		phgrdhstInitialize(int argc, char *argv[]);
 void			phgrdhstTerminate(void);
 Boolean			phgbin(int argc, char *argv[]);
-EventTy			readEvent(FILE *historyFile,
+EventTy			readEvent(PhoHFileCursorTy *historyCursor,
                                                   PHG_Decay *decayPtr,
                                                   PHG_DetectedPhoton *photonPtr);
 EventTy			oldReadEvent(FILE *historyFile,
@@ -69,6 +81,21 @@ EventTy			oldReadEvent(FILE *historyFile,
                              PHG_DetectedPhoton *photonPtr,
                              Boolean isOldPhotons1,
                              Boolean isOldPhotons2);
+Boolean			phgrdhstBinDecays(FILE *historyFile, PhoHFileCursorTy *historyCursor,
+					Boolean isOldDecays, Boolean isOldPhotons1, Boolean isOldPhotons2,
+					Boolean isPHGList, Boolean isColList,
+					PHG_TrackingPhoton *bluePhotons, PHG_TrackingPhoton *pinkPhotons);
+void			phgrdhstBinDecay(PHG_Decay *decayPtr, PHG_DetectedPhoton *photons,
+					LbUsFourByte numPhotons, Boolean isPHGList, Boolean isColList,
+					PHG_TrackingPhoton *bluePhotons, PHG_TrackingPhoton *pinkPhotons);
+Boolean			phgrdhstAddRandoms(PhoHFileCursorTy *historyCursor);
+void			phgrdhstBinDetections(PHG_Decay *decayPtr,
+					PHG_DetectedPhoton *bluePhotons, LbUsFourByte numBluePhotons,
+					PHG_DetectedPhoton *pinkPhotons, LbUsFourByte numPinkPhotons);
+Boolean			phgrdhstBinRange(LbUsFourByte rangeIndex);
+Boolean			phgrdhstBinInParallel(PhoHFileCursorTy *historyCursor,
+					Boolean isPHGList, Boolean isColList,
+					PHG_TrackingPhoton *bluePhotons, PHG_TrackingPhoton *pinkPhotons);
 Boolean			phgrdhstStandard(char *argv[]);
 Boolean			phgrdhstCustom(char *argv[]);
 void			phgbinProcessPhotons(PhoHFileHkTy *histHk, PHG_Decay *decayPtr,
@@ -0,0 +1,149 @@
+/*********************************************************************************
+*                                                                                *
+*                       Source code developed by the                             *
+*           Imaging Research Laboratory - University of Washington               *
+*               (C) Copyright 2026 Department of Radiology                       *
+*                           University of Washington                             *
+*                              All Rights Reserved                               *
+*                                                                                *
+*********************************************************************************/
+
+/*********************************************************************************
+*
+*			Module Name:		index.hist.c
+*			Revision Number:	1.0
+*			Date last revised:	17 October 2026
+*			Programmer:
+*			Date Originated:	17 October 2026
+*
+*			Module Overview:	Builds the decay index of existing standard
+*								history files (see PhoHFileIndexDecays), for
+*								files written without one or changed since.
+*
+*								indexhist [-i interval] historyfile ...
+*
+*								interval is the number of decays per index
+*								entry, INDEXHIST_DEFAULT_INTERVAL if not given.
+*
+*			References:			None.
+*
+**********************************************************************************
+*
+*			Global functions defined:
+*				IndexHist
+*
+*			Global macros defined:
+*
+*			Global variables defined:		none
+*
+*********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SystemDependent.h"
+
+#include "LbTypes.h"
+#include "LbMacros.h"
+#include "LbError.h"
+#include "LbEnvironment.h"
+#include "LbMemory.h"
+#include "LbInterface.h"
+#include "LbParamFile.h"
+#include "LbHeader.h"
+
+#include "Photon.h"
+#include "PhgParams.h"
+#include "ColTypes.h"
+#include "ColParams.h"
+#include "DetTypes.h"
+#include "DetParams.h"
+#include "CylPos.h"
+#include "PhoHFile.h"
+
+/* LOCAL CONSTANTS */
+#define INDEXHIST_DEFAULT_INTERVAL	10000		/* Decays per index entry unless given */
+#define INDEXHIST_IsIntervalOption()	LbFgIsSet(indexHistOptions, LBFlag0)	/* Did they give an interval? */
+#define INDEXHIST_NumFlags			1			/* Number of flags defined */
+
+/* LOCAL GLOBALS */
+static LbUsFourByte	indexHistOptions;			/* Command line options */
+
+/* PROTOTYPES */
+Boolean			IndexHist(int argc, char *argv[]);
+
+/* FUNCTIONS */
+/**********************
+*	IndexHist
+*
+*	Purpose:	Build the decay index of each history file named.
+*
+*	Result:	True unless an error occurs.
+***********************/
+Boolean IndexHist(int argc, char *argv[])
+{
+	Boolean					okay = false;				/* Process Loop */
+	char					*knownOptions[] = {"i:"};
+	char					optArgs[INDEXHIST_NumFlags][LBEnMxArgLen];
+	LbUsFourByte			optArgFlags = (LBFlag0);
+	LbUsFourByte			argIndex;					/* Index of the first file name */
+	LbUsFourByte			interval;					/* Decays per index entry */
+	LbFourByte				fileIndex;					/* Current file */
+	PhoHFileDecayIndexHdrTy	indexHdr;					/* Header of the index built */
+	PhoHFileChunkEntryTy	*entries = 0;				/* Entries of the index built */
+
+	do { /* Process Loop */
+
+		/* Get our options */
+		indexHistOptions = 0;
+		if (!LbEnGetOptions(argc, argv, knownOptions,
+				&indexHistOptions, optArgs, optArgFlags, &argIndex)) {
+			break;
+		}
+
+		if (INDEXHIST_IsIntervalOption()) {
+			if (atoi(optArgs[0]) < 1) {
+				ErStGeneric("The decay index interval (-i) must be at least 1.");
+				break;
+			}
+			interval = (LbUsFourByte) atoi(optArgs[0]);
+		}
+		else {
+			interval = INDEXHIST_DEFAULT_INTERVAL;
+		}
+
+		if ((argIndex == 0) || ((LbFourByte) argIndex >= argc)) {
+			ErStGeneric("usage: indexhist [-i interval] historyfile ...");
+			break;
+		}
+
+		/* Index each file */
+		for (fileIndex = argIndex; fileIndex < argc; fileIndex++) {
+			if (PhoHFileIndexDecays(argv[fileIndex], interval) == false) {
+				goto FAIL;
+			}
+
+			/* Report what was indexed */
+			if (PhoHFileReadDecayIndex(argv[fileIndex], &indexHdr, &entries) == false) {
+				goto FAIL;
+			}
+			LbInPrintf("Indexed %llu decays and %llu photons of '%s' in %lu entries.\n",
+				(unsigned long long) indexHdr.numDecays, (unsigned long long) indexHdr.numPhotons,
+				argv[fileIndex], (unsigned long) indexHdr.numEntries);
+
+			if (entries != 0) {
+				LbMmFree((void **) &entries);
+			}
+		}
+
+		okay = true;
+		FAIL:;
+	} while (false);
+
+	if (entries != 0) {
+		LbMmFree((void **) &entries);
+	}
+
+	return (okay);
+}
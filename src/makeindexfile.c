@@ -479,22 +479,11 @@ Boolean	allocIndexArrays()
 
 			SubObjObject[sliceIndex].attVoxelHeight = SubObjObject[sliceIndex].sliceHeight/
 				SubObjObject[sliceIndex].attNumYBins;
+		}
 		
-			/* Allocate array for indexes */
-			if ((SubObjObject[sliceIndex].activityArray = (SubObjActVoxelTy *) LbMmAlloc(
-					(sizeof(SubObjActVoxelTy) * 
-					(SubObjObject[sliceIndex].actNumXBins * SubObjObject[sliceIndex].actNumYBins)))) == 0) {
-				
-				goto FAIL;
-			}
-		
-			/* Allocate array for indexes */
-			if ((SubObjObject[sliceIndex].attenuationArray = (LbUsFourByte *) LbMmAlloc(
-					(sizeof(LbUsFourByte) * 
-					(SubObjObject[sliceIndex].attNumXBins * SubObjObject[sliceIndex].attNumYBins)))) == 0) {
-				
-				goto FAIL;
-			}
+		/* Allocate arrays for indexes */
+		if (!SubObjAllocIndexes()) {
+			goto FAIL;
 		}
 		okay = true;
 		FAIL:;
@@ -519,19 +508,12 @@ Boolean	allocIndexArrays()
 Boolean	freeSubObject(Boolean didActivity, Boolean didAttenuation)
 {
 	Boolean					okay = false;					/* Process flag */
-	LbUsFourByte			sliceIndex;						/* Current slice */
 	
 	do { /* Process Loop */
 	
-		/* Loop through the parameters at this level */
-		for (sliceIndex = 0; sliceIndex < SubObjNumSlices; sliceIndex++) {
-			
-			if (didActivity)
-				LbMmFree((void **) &(SubObjObject[sliceIndex].activityArray));
-		
-			if (didAttenuation)
-				LbMmFree((void **) &(SubObjObject[sliceIndex].attenuationArray));
-		}
+		/* Both index volumes are allocated together */
+		if (didActivity || didAttenuation)
+			SubObjFreeIndexes();
 		
 		LbMmFree((void **) &SubObjObject);
 		okay = true;
@@ -588,9 +570,9 @@ Boolean	initializeIndexArrays(Boolean doActivity)
 				/* Fill in the voxels with the given fill value */
 				for (voxelIndex = 0; voxelIndex < numVoxels; voxelIndex++) {
 					if (doActivity)
-						SubObjObject[sliceIndex].activityArray[voxelIndex] = fillValue;
+						SUBOBJGetActSliceIndexes(sliceIndex)[voxelIndex] = fillValue;
 					else
-						SubObjObject[sliceIndex].attenuationArray[voxelIndex] = fillValue;
+						SUBOBJGetAttSliceIndexes(sliceIndex)[voxelIndex] = fillValue;
 					
 				}
 			}
@@ -718,9 +700,9 @@ Boolean	initializeIndexArrays(Boolean doActivity)
 						
 						/* Fill the array */
 						if (doActivity)
-							SubObjObject[sliceIndex].activityArray[voxelIndex] = fillValue;
+							SUBOBJGetActSliceIndexes(sliceIndex)[voxelIndex] = fillValue;
 						else
-							SubObjObject[sliceIndex].attenuationArray[voxelIndex] = fillValue;
+							SUBOBJGetAttSliceIndexes(sliceIndex)[voxelIndex] = fillValue;
 			
 					}
 					
@@ -834,9 +816,9 @@ Boolean	initializeIndexArrays(Boolean doActivity)
 						
 						/* Fill the array */
 						if (doActivity)
-							SubObjObject[sliceIndex].activityArray[voxelIndex] = fillValue;
+							SUBOBJGetActSliceIndexes(sliceIndex)[voxelIndex] = fillValue;
 						else
-							SubObjObject[sliceIndex].attenuationArray[voxelIndex] = fillValue;
+							SUBOBJGetAttSliceIndexes(sliceIndex)[voxelIndex] = fillValue;
 			
 					}
 					
@@ -861,9 +843,9 @@ Boolean	initializeIndexArrays(Boolean doActivity)
 				/* Fill in the voxels with the given fill value */
 				for (voxelIndex = 0; voxelIndex < numVoxels; voxelIndex++) {
 					if (doActivity)
-						SubObjObject[sliceIndex].activityArray[voxelIndex] = fillValue;
+						SUBOBJGetActSliceIndexes(sliceIndex)[voxelIndex] = fillValue;
 					else
-						SubObjObject[sliceIndex].attenuationArray[voxelIndex] = fillValue;
+						SUBOBJGetAttSliceIndexes(sliceIndex)[voxelIndex] = fillValue;
 					
 				}
 				/*if (!doActivity)*/
@@ -1026,12 +1008,12 @@ void	createObjects(Boolean doActivity)
 				}
 				
 				if (doActivity) {
-					array = SubObjObject[sliceIndex].activityArray;
+					array = SUBOBJGetActSliceIndexes(sliceIndex);
 					numXBins = SubObjObject[sliceIndex].actNumXBins;
 					numYBins = SubObjObject[sliceIndex].actNumYBins;
 				}
 				else {
-					array = SubObjObject[sliceIndex].attenuationArray;
+					array = SUBOBJGetAttSliceIndexes(sliceIndex);
 					numXBins = SubObjObject[sliceIndex].attNumXBins;
 					numYBins = SubObjObject[sliceIndex].attNumYBins;
 				}
@@ -1106,14 +1088,14 @@ void	createObjects(Boolean doActivity)
 						(SubObjObject[sliceIndex].sliceDepth/2);
 					
 					if (doActivity) {
-						array = SubObjObject[sliceIndex].activityArray;
+						array = SUBOBJGetActSliceIndexes(sliceIndex);
 						voxelWidth = SubObjObject[sliceIndex].actVoxelWidth;
 						voxelHeight = SubObjObject[sliceIndex].actVoxelHeight;
 						numXBins = SubObjObject[sliceIndex].actNumXBins;
 						numYBins = SubObjObject[sliceIndex].actNumYBins;
 					}
 					else {
-						array = SubObjObject[sliceIndex].attenuationArray;
+						array = SUBOBJGetAttSliceIndexes(sliceIndex);
 						voxelWidth = SubObjObject[sliceIndex].attVoxelWidth;
 						voxelHeight = SubObjObject[sliceIndex].attVoxelHeight;
 						numXBins = SubObjObject[sliceIndex].attNumXBins;
@@ -1233,13 +1215,13 @@ Boolean	writeIndexFile(FILE *outputFile, Boolean doActivity)
 
 			/* Point to the write data */
 			if (doActivity) {
-				array = SubObjObject[sliceIndex].activityArray;
+				array = SUBOBJGetActSliceIndexes(sliceIndex);
 				
 				numVoxels = SubObjObject[sliceIndex].actNumXBins *
 					SubObjObject[sliceIndex].actNumYBins;
 			}
 			else {
-				array = SubObjObject[sliceIndex].attenuationArray;
+				array = SUBOBJGetAttSliceIndexes(sliceIndex);
 				
 				numVoxels = SubObjObject[sliceIndex].attNumXBins *
 					SubObjObject[sliceIndex].attNumYBins;
@@ -95,6 +95,7 @@
 #include "PhoTrk.h"
 #include "phg.h"
 #include "PhgBin.h"
+#include "PhgParallel.h"
 
 /* LOCAL CONSTANTS */
 #define PHG_PARAM_FILENAME		"phg.run"			/* Name of parameter file */
@@ -131,10 +132,10 @@ Boolean PhgRun(int argc, char *argv[])
 		char		*knownOptions[] = {"Debug"
 										(char *) 0};
 	#else
-		char			*knownOptions[] = {"d:"};
+		char			*knownOptions[] = {"d:t:"};
 	#endif
 	char				optArgs[PHG_NumFlags][LBEnMxArgLen];
-	LbUsFourByte		optArgFlags = (LBFlag0);
+	LbUsFourByte		optArgFlags = (LBFlag0 + LBFlag1);
 	LbUsFourByte		argIndex;
 	time_t 				curTime;							/* Current time for stamping execution date */
 	
@@ -156,6 +157,17 @@ Boolean PhgRun(int argc, char *argv[])
 			PhgDebugOptions = 0;
 		}
 
+		/* If they gave us a number of worker processes, set them up, otherwise track
+			serially with the compatibility random number stream
+		*/
+		if (PHG_IsWorkersOption() && (atoi(optArgs[1]) < 1)) {
+			ErStGeneric("The number of worker processes (-t) must be at least 1.");
+			break;
+		}
+		if (PhgParInitialize(PHG_IsWorkersOption() ? (LbUsFourByte) atoi(optArgs[1]) : 0) == false) {
+			break;
+		}
+
 		/* If they gave us a run file, then get it */
 		if ((argIndex != 0) && (argv[argIndex] != 0)) {
 			strcpy(PhgRunTimeParams.PhgParamFilePath, argv[argIndex]);
@@ -200,9 +212,11 @@ Boolean PhgRun(int argc, char *argv[])
 		}
 		
 		/* Initialize the phg */
+		PhgParBeginInitialize();
 		if (phg_initialize() == false) {
 			break;
 		}
+		PhgParEndInitialize();
 		
 		/* Print out operation parameters */
 		PhgPrintParams(argc, argv, randFromClock);
@@ -238,8 +252,11 @@ Boolean PhgRun(int argc, char *argv[])
 		
 	if (okay == false) {
 		ErHandle("Unable to perform simulation", false);
-		okay = true;
 	}
+
+	/* Leave any other distributed ranks */
+	PhgParTerminate(okay);
+	okay = true;
 				
 	#ifdef PHG_DEBUG
 		/* Close the debug dump file */
@@ -313,6 +330,30 @@ void PhgPrintParams(int argc, char *argv[], Boolean randFromClock)
 	LbInPrintf("\nModelling coherent scatter in object is %s.", (PHG_IsModelCoherentInObj() ? "on" : "off"));
 	LbInPrintf("\nModelling coherent scatter in tomograph is %s.", (PHG_IsModelCoherentInTomo() ? "on" : "off"));
 	LbInPrintf("\nModelling polarization is %s.", (PHG_IsModelPolarization() ? "on" : "off"));
+	LbInPrintf("\nWoodcock tracking in the object is %s.", (PHG_IsWoodcockTracking() ? "on" : "off"));
+	LbInPrintf("\nAlias table decay sampling is %s.", (PHG_IsAliasDecaySampling() ? "on" : "off"));
+	LbInPrintf("\nHistory file compression is %s.", (PHG_IsCompressHistoryFiles() ? "on" : "off"));
+	if (PHG_IsIndexHistoryFiles()) {
+		LbInPrintf("\nHistory files are indexed every %lu decays.",
+			(unsigned long) PhgRunTimeParams.PhgHistoryIndexInterval);
+	}
+	else {
+		LbInPrintf("\nHistory file decay indexing is off.");
+	}
+	if (PHG_IsSortHistoryFiles()) {
+		LbInPrintf("\nHistory files are written in time order, sorting %lu MB at a time.",
+			(unsigned long) PhgRunTimeParams.PhgHistorySortBufferSize);
+	}
+	else {
+		LbInPrintf("\nHistory file sorting is off.");
+	}
+	if (PHG_IsCachePrimaryAttenuation()) {
+		LbInPrintf("\nPrimary attenuation cache is on, allowing a spread of %.3g free paths.",
+			PhgRunTimeParams.PhgPrimaryAttCacheError);
+	}
+	else {
+		LbInPrintf("\nPrimary attenuation cache is off.");
+	}
 	LbInPrintf("\nPhoton energy is            %3.1f keV.",
 		PhgRunTimeParams.PhgNuclide.photonEnergy_KEV);
 	LbInPrintf("\nMinimum energy threshold is %3.1f", PhgRunTimeParams.PhgMinimumEnergy);
@@ -342,6 +383,13 @@ void PhgPrintParams(int argc, char *argv[], Boolean randFromClock)
 	if (PHG_IsNoHist() == false) {
 		LbInPrintf("\nCustomized target-cylinder history file is %s.", PHG_IsHistParams() ? "on" : "off");
 	}
+	if (PHGPAR_IsParallel()) {
+		if (PhgParNumRanks > 1) {
+			LbInPrintf("\nNumber of distributed ranks = %lu.", (unsigned long)PhgParNumRanks);
+		}
+		LbInPrintf("\nNumber of worker processes = %lu.", (unsigned long)PhgParNumWorkers);
+		LbInPrintf("\nEach block of decays has its own random number stream.");
+	}
 	#ifdef PHG_DEBUG
 	
 		LbInPrintf("\nDebug options = %d.", PhgDebugOptions);
@@ -371,6 +419,9 @@ void PhgPrintParams(int argc, char *argv[], Boolean randFromClock)
 		if (PHGDEBUG_ObjCohOnly()) {
 			LbInPrintf("\n\tAll interactions in object are being modeled as coherent.");
 		}
+		if (PHGDEBUG_TimeForcedDetection()) {
+			LbInPrintf("\n\tComponents of forced detection are being timed (reported at the end).");
+		}
 		
 	#else
 		LbInPrintf("\nDebugging is OFF.");
@@ -932,7 +983,10 @@ void phg_terminate()
 	}
 	/* Terminate the detection module if initialized */
 	if (PHG_IsDetectOnTheFly()) {
-		DetTerminate();
+		for (DetCurParams = 0; DetCurParams < DetNumParams; DetCurParams++) {
+			DetTerminate();
+		}
+		DetCurParams = 0;
 	}
 	
 	/* Terminate the photon tracking module */
@@ -52,8 +52,9 @@
 
 /* OPTION MACROS */
 #define PHG_IsDebugOptions()			LbFgIsSet(PhgOptions, LBFlag0)	/* Did user supply debug options? */
+#define PHG_IsWorkersOption()			LbFgIsSet(PhgOptions, LBFlag1)	/* Did user supply a number of worker processes? */
 
-#define	PHG_NumFlags	1												/* Number of flags defined */
+#define	PHG_NumFlags	2												/* Number of flags defined */
 
 /* DEBUGGING OPTIONS */
 #define PHGDEBUG_FixedDirection()			LbFgIsSet(PhgDebugOptions, LBFlag0) /* Should we pick a fixed direction */
@@ -64,6 +65,7 @@
 #define PHGDEBUG_BinCentroidPosition()		LbFgIsSet(PhgDebugOptions, LBFlag5) /* Should we bin the centroid position within the detector? */
 #define PHGDEBUG_DetAbsorbOnly()			LbFgIsSet(PhgDebugOptions, LBFlag6) /* Should we detector make all interactions absorptions? */		
 #define PHGDEBUG_ObjCohOnly()				LbFgIsSet(PhgDebugOptions, LBFlag7) /* Should object interactions be coherent only */
+#define PHGDEBUG_TimeForcedDetection()		LbFgIsSet(PhgDebugOptions, LBFlag8) /* Should we time the components of forced detection? */
 
 /* PROGRAM TYPES */
 /* The following is simply the local globals that used to be in PhgBin.c
@@ -543,6 +543,7 @@ static	void display(PhoHFileHdrTy *headerPtr)
 	fprintf(stdout, "\nSum of Events to Simulate in History\t:%lld",headerPtr->H.SumEventsToSimulate);
 	fprintf(stdout, "\nFile %s been sorted by decay time",headerPtr->H.isTimeSorted ? "has" : "has not");
 	fprintf(stdout, "\nFile %s randoms added",headerPtr->H.isRandomsAdded ? "has" : "does not have");
+	fprintf(stdout, "\nFile %s compressed",headerPtr->H.isCompressed ? "is" : "is not");
 	
 	fprintf(stdout, "\n");
 
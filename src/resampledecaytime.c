@@ -438,6 +438,14 @@ Boolean resamptResampleTime(char *argv[])
 				ErStFileError(resamptErrStr);
 				goto FAIL;
 			}
+			if (PhoHFileSetCompressed(&resamptOutHistHk, resamptHdrParams.H.isCompressed) == false) {
+				/* Error should already have been reported */
+				goto FAIL;
+			}
+			if (PhoHFileSetIndexedLike(&resamptOutHistHk, resamptInHistName) == false) {
+				/* Error should already have been reported */
+				goto FAIL;
+			}
 			
 		}
 		
@@ -450,6 +458,11 @@ Boolean resamptResampleTime(char *argv[])
 			/* write header to output randoms added file and close */
 		{
 			
+			/* write out the buffered records */
+			if (PhoHFileEndWrites(&resamptOutHistHk) == false) {
+				goto FAIL;
+			}
+			
 			/* update the file header */
 			if (PhgHdrUpHeader(NULL, &resamptHdrParams, &(resamptOutHistHk.headerHk)) == false) {
 				sprintf(resamptErrStr, "Unable to write header to output history file\n'%s'.",
@@ -469,6 +482,11 @@ Boolean resamptResampleTime(char *argv[])
 				goto FAIL;
 			}
 			
+			/* write its decay index, if requested */
+			if (PhoHFileEndIndex(&resamptOutHistHk) == false) {
+				goto FAIL;
+			}
+			
 		}
 		
 		okay = true;
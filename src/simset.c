@@ -168,6 +168,7 @@ Boolean			Convert(int argc, char *argv[]);
 Boolean			BuildAtt(int argc, char *argv[]);
 Boolean			CombineBin(int argc, char *argv[]);
 Boolean			CombineHist(int argc, char *argv[]);
+Boolean			IndexHist(int argc, char *argv[]);
 Boolean			ReverseBytes(int argc, char *argv[]);
 Boolean			DisplayHeader(int argc, char *argv[]);
 Boolean			makeindexfile(int argc, char *argv[]);
@@ -214,7 +215,7 @@ char	errString[256];	/* Our standard error string */
 	and you must always be sure that PHG_INDEX refers
 	to the function PhgRun
 */
-#define NUM_FUNCS	31
+#define NUM_FUNCS	32
 #define PHG_INDEX	0
 SimsetFuncElemTy SimsetFuncTbl[] = {
 
@@ -248,7 +249,8 @@ SimsetFuncElemTy SimsetFuncTbl[] = {
 	{"timesort",			tmsort},
 	{"addrandoms",			adrand},
 	{"resampledecaytime",	resampt},
-	{"bin",					phgbin}		/* Remember to update NUM_FUNCS when adding function */
+	{"bin",					phgbin},
+	{"indexhist",			IndexHist}		/* Remember to update NUM_FUNCS when adding function */
 };
 
 
@@ -17,6 +17,13 @@
 *		Date Originated:	12 December 2003
 *
 *		Module Overview:	Sort a phg history file according to decay time.
+*							Runs of decays are read into the sort buffer and
+*							sorted there by a radix sort on their decay times,
+*							split among threads where available.  The sorted
+*							runs are then merged in a single pass through a
+*							loser tree.  When the file nearly fits in the
+*							buffer, the last run stays in memory and joins the
+*							merge without being written out.
 *
 *		References:			Knuth (1973) vol III, on tape sorting, may be useful.
 *
@@ -58,6 +65,16 @@
 
 #include "SystemDependent.h"
 
+/* Runs are sorted by several threads on Unix systems */
+#if defined(GEN_UNIX) && !defined(TMSORT_SERIAL_SORT)
+	#define TMSORT_THREADED_SORT
+#endif
+
+#ifdef TMSORT_THREADED_SORT
+	#include <pthread.h>
+	#include <unistd.h>
+#endif
+
 #include "LbTypes.h"
 #include "LbError.h"
 #include "LbDebug.h"
@@ -67,7 +84,6 @@
 #include "LbParamFile.h"
 #include "LbInterface.h"
 #include "LbHeader.h"
-#include "LbSort.h"
 #include "LbTiming.h"
 
 #include "Photon.h"
@@ -110,40 +126,50 @@
 #define	TMSORT_NumFlags	5							/* Number of flags defined */
 
 #define		TMSORT_MINKEY	-1.0				/* Minimum sort key; also, must never actually occur */
-#define		TMSORT_MAXKEY	LBDOUBLE_MAX		/* Maximum sort key; also, must never actually occur */
 
-#define		TMSORT_TEMP_COUNT_OFFSET	0		/* Offset into decay data to temporarily store photon count */
+#define		TMSORT_MAX_THREADS			8		/* Most threads sorting a run */
+#define		TMSORT_MIN_THREAD_DECAYS	65536	/* Fewest decays worth a thread of their own */
+#define		TMSORT_MERGE_BUFFERS		64		/* Most merge read buffers the sort buffer is divided into */
+#define		TMSORT_PLAN_DECAYS			1024	/* Decays read between checks of the run size */
+#define		TMSORT_PLAN_MARGIN			1.05	/* Allowance for misjudging the memory the rest of a file needs */
 
-#define		TMSORT_DIST_CT		4				/* Number of read slot distributions to track */
+#define		TMSORT_RADIX_BITS			8		/* Key bits sorted by each radix sort pass */
+#define		TMSORT_RADIX_SIZE			256		/* Number of digit values in a pass */
+#define		TMSORT_RADIX_PASSES			8		/* Passes over the eight byte key */
+#define		TMSORT_SIGN_BIT				(((LbUsEightByte) 1) << 63)	/* Sign bit of the key */
 
 
 /* LOCAL TYPES */
 typedef enum  {Null, Decay, Photon} EventTy;
 
-typedef struct  {			/* Temporary decay data marker */
-	LbUsFourByte		numPhotons;			/* Number of photons in the decay data */
-	PHG_Decay 			*decayDataPtr;		/* Pointer into the buffer to the decay data */
-} DecaySortData;
-struct DecaySortBlock  {	/* DecaySortData block marker */
-	DecaySortData			*thisDataBlock;	/* Pointer to a dynamically allocated block of DecaySortData */
-	struct DecaySortBlock 	*nextSortBlock;	/* Pointer to the next block marker in the list */
-};
-typedef struct DecaySortBlock		DecaySortBlock;
-
-typedef double				TmSortKeyType;			/* The timesort key type */
+typedef double				TmSortKeyType;			/* The timesort key type (eight bytes) */
 typedef TmSortKeyType		*TmSortKeyPtr;			/* Pointer to a TmSortKeyType */
 
-typedef struct  {			/* Merge decay data marker */
+typedef struct  {			/* Decay data in the sort buffer */
 	LbUsFourByte		numPhotons;			/* Number of photons in the decay data */
 	PHG_Decay 			decayData;			/* The decay data */
 } DecayMergeData;
-typedef struct  {			/* Merge input file data */
-	FILE				*theFile;			/* The input file info */
+typedef struct  {			/* Sort index entry of a decay in the sort buffer */
+	LbUsEightByte		radixKey;			/* Sort key as an unsigned integer of the same order */
+	LbUsFourByte		offset;				/* Sort buffer offset of the decay's DecayMergeData */
+	LbUsFourByte		unused;				/* Pads the entry to sixteen bytes */
+} DecaySortItem;
+typedef struct  {			/* Slice of a run's sort index, sorted by one thread */
+	DecaySortItem		*items;				/* The index entries */
+	DecaySortItem		*scratch;			/* Space for as many entries again */
+	LbUsFourByte		numItems;			/* Number of entries */
+} DecaySortSlice;
+typedef struct  {			/* Merge input data, a sort file or a sorted index slice */
+	FILE				*theFile;			/* The input file info (NULL for a slice) */
 	DecayMergeData		*bufStart;			/* Start of the merge data buffer */
 	LbUsFourByte		bufSize;			/* Size of the merge data buffer */
-	LbUsFourByte		bufDecays;			/* Number of decays in the buffer */
+	LbUsFourByte		bufDecays;			/* Number of decays left in the buffer */
 	PHG_Decay 			nextDecay;			/* The next decay to read from the file */
 	Boolean				nextDecayPending;	/* Whether nextDecay is valid */
+	DecaySortItem		*nextItem;			/* Next index entry of a slice */
+	DecaySortItem		*endItem;			/* End of a slice's index entries */
+	DecayMergeData		*curRecord;			/* Current decay of the input, NULL when used up */
+	LbUsEightByte		curKey;				/* Radix sort key of curRecord */
 } MergeFileData;
 
 
@@ -157,7 +183,10 @@ static LbUsFourByte			tmsortNumToProc;				/* Number of histories to process */
 static char					tmsortHistName[1024];			/* Name of history file */
 static char					tmsortSortNameBase[1024];		/* Base name of sorted history file */
 static char					tmsortSortName[1024];			/* Name of sorted history file */
+static char					tmsortIndexName[1024+sizeof(PHOHFILE_INDEX_SUFFIX)];	/* Name of its decay index */
+static char					tmsortFinalIndexName[1024+sizeof(PHOHFILE_INDEX_SUFFIX)];	/* Name of the final decay index */
 static char					tmsortHistParamsName[1024];		/* Name of history parameters file */
+static LbUsFourByte			tmsortIndexInterval = 0;		/* Decays per entry of the history file's decay index, 0 for none */
 static LbUsFourByte			tmsortArgIndex;					/* Index through command line arguments */
 static PhoHFileHdrTy		tmsortHdrParams;				/* Input header */
 static LbHdrHkTy			tmsortHistHeaderHk;				/* Hook to original history file header */
@@ -169,33 +198,26 @@ static LbUsFourByte			tmsortMergeDecaySize = 0;		/* Byte size of merge decay eve
 static LbUsFourByte			tmsortMergeFileSize = 0;		/* Byte size of merge file data */
 static LbUsFourByte			tmsortPhotonSize = 0;			/* Byte size of photon event */
 static TmSortKeyType		tmsortMinKey;					/* Minimum sort key; never actually occurs */
-static TmSortKeyType		tmsortMaxKey;					/* Maximum sort key; never actually occurs */
 static PHG_Decay			tmsortNextDecayEvent;			/* Storage for next partially read deacy */
 static Boolean				tmsortDecayPending = false;		/* Status of tmsortNextDecayEvent */
 static LbUsFourByte			tmsortDataBufferSizeParam = 0;	/* Size of main data buffer (Mbytes) */
 static LbUsFourByte			tmsortDataBufferSize = 0;		/* Size of main data buffer (bytes) */
 static PHG_Decay			*tmsortSortBufferPtr = NULL;	/* Main buffer holding decay data */
-static PHG_Decay			*tmsortReserveBufferPtr = NULL;	/* Main buffer section for excess data */
-static PHG_Decay			*tmsortResBufferStart = NULL;	/* Original start of reserve buffer */
-static DecaySortBlock		*tmsortTempDecayBlocksList = NULL;
-															/* Dynamic list of DecaySortBlock */
-static LbUsFourByte			tmsortBlockSize;				/* Number of DecaySortData in a DecaySortBlock */
-static PHG_Decay			**tmsortDecaySlots[PHG_MAX_DETECTED_PHOTONS+1];
-															/* Lists of decay data slots in 
-																tmsortSortBufferPtr, by 
-																number of photons */
-static LbUsFourByte			tmsortDecaySlotCounts[PHG_MAX_DETECTED_PHOTONS+1];
-															/* Counts of the list sizes of 
-																tmsortDecaySlots */
-static LbUsFourByte			tmsortDecaySlotMaxs[PHG_MAX_DETECTED_PHOTONS+1];
-															/* Maximums for the list sizes of 
-																tmsortDecaySlotCounts */
-static LbUsFourByte			tmsortDecaySlotDists[TMSORT_DIST_CT][PHG_MAX_DETECTED_PHOTONS+1];
-															/* Counts of the list sizes for 
-																the last few reads */
-static LbUsFourByte			tmsortCurDist;					/* Current read slot distribution */
-static DecayMergeData		*tmsortMergeBufferPtr = NULL;	/* Pointer to main buffer during merging */
-static MergeFileData		*tmsortMergeFiles = NULL;		/* Array of files to be merged */
+static LbUsFourByte			tmsortNumThreads = 1;			/* Most threads sorting a run */
+static LbUsEightByte		tmsortHistFileSize;				/* Size of the history file, 0 if unknown */
+static LbUsFourByte			tmsortMaxRecordSpace;			/* Buffer space sure to hold one more decay */
+static LbUsFourByte			tmsortMergeBufMin;				/* Smallest read buffer of a merged file */
+static LbUsFourByte			tmsortMaxMergeFiles;			/* Most sort files merged at once */
+static LbUsFourByte			tmsortMaxMergeInputs;			/* Most merge inputs of any kind */
+static LbUsOneByte			*tmsortMergeSpace;				/* Sort buffer space for merge read buffers */
+static LbUsFourByte			tmsortMergeSpaceSize;			/* Size of tmsortMergeSpace */
+static MergeFileData		tmsortResidentInputs[TMSORT_MAX_THREADS];
+															/* Slices of the last run, kept in 
+																memory for the final merge */
+static LbUsFourByte			tmsortNumResidentInputs = 0;	/* Count of tmsortResidentInputs */
+static MergeFileData		*tmsortMergeFiles = NULL;		/* Array of inputs to be merged */
+static LbUsFourByte			*tmsortLoserTree = NULL;		/* Loser tree of the merge inputs, 
+																followed by space for building it */
 #ifdef TMSORT_PHO_DIST
 static LbUsFourByte			tmsortPhotonCounts[PHG_MAX_DETECTED_PHOTONS+1];
 															/* Count of total decays read, by photons */
@@ -211,24 +233,27 @@ Boolean			tmsortTest(char *argv[]);
 Boolean			tmsortTimeSort(char *argv[]);
 Boolean			tmsortSort(LbUsFourByte *numSortedFiles);
 Boolean			tmsortMerge(LbUsFourByte sortFilesToMerge, LbUsFourByte *finalFileNum);
-Boolean			tmsortMergeFileBatch(LbUsFourByte numSortFiles);
-Boolean			tmsortGetFirstBatch(FILE *historyFile, 
-					LbUsFourByte bufferSize, LbUsFourByte *numDecays);
-Boolean			tmsortGetNextBatch(FILE *historyFile, LbSortListPtr sortListPtr, 
-					LbUsFourByte *reserveSpace, LbUsFourByte *numDecays);
-void			tmsortClearReserveBuffer(LbSortListPtr sortListPtr, 
-					LbUsFourByte *reserveSpace, LbUsFourByte *clearedDecays);
-LbUsFourByte	tmsortEstimateReadDecays(void);
+Boolean			tmsortMergeFileBatch(LbUsFourByte *runFiles, LbUsFourByte numRuns,
+					Boolean withResident, LbUsFourByte outFileNumber);
+Boolean			tmsortCreateSortFile(LbUsFourByte fileNumber, PhoHFileHkTy *sortFileHkPtr);
+Boolean			tmsortCloseSortFile(LbUsFourByte fileNumber, PhoHFileHkTy *sortFileHkPtr,
+					LbUsEightByte *sortedFilesSize);
+DecaySortItem	*tmsortGetRunItems(LbUsFourByte numDecays);
+void			tmsortReadRun(FILE *historyFile, LbUsFourByte residentSpace,
+					LbUsFourByte *numDecays, LbUsFourByte *recordsSize, Boolean *isAtEnd);
+void			tmsortSortRun(LbUsFourByte numDecays, LbUsFourByte *numInputs);
+void			tmsortSortSlice(DecaySortSlice *slicePtr);
+#ifdef TMSORT_THREADED_SORT
+void			*tmsortSortSliceMain(void *slicePtr);
+#endif
+DecaySortItem	*tmsortRadixSort(DecaySortItem *items, DecaySortItem *scratch,
+					LbUsFourByte numItems);
+Boolean			tmsortMergeInputs(LbUsFourByte numInputs, PhoHFileHkTy *outFileHkPtr);
+Boolean			tmsortInputBefore(LbUsFourByte input1, LbUsFourByte input2);
+void			tmsortAdvanceInput(LbUsFourByte inputIndex);
 void			tmsortFillMergeBuffer(LbUsFourByte fileIndex);
-Boolean			tmsortSortDecay(LbSortListPtr sortListPtr, 
-					PHG_Decay *decayPtr, LbUsFourByte numPhotons);
-Boolean			tmsortStoreDecay(PHG_Decay *decayPtr, LbUsFourByte numPhotons,
-					PHG_Decay **decayLocation);
-void			tmsortRemoveDecay(PHG_Decay *decayLocation, LbUsFourByte numPhotons);
-Boolean			tmsortGetDecaySlot(LbUsFourByte numPhotons, PHG_Decay **decaySlot);
-LbFourByte		tmsortKeyComparator(LbSortKeyPtr keyPtr1, LbSortKeyPtr keyPtr2);
 void			tmsortGetDecaySortKey(PHG_Decay *decayPtr, TmSortKeyPtr decaySortKeyPtr);
-void			tmsortSetDecaySortKey(PHG_Decay *decayPtr, TmSortKeyType decaySortKey);
+LbUsEightByte	tmsortGetDecayRadixKey(PHG_Decay *decayPtr);
 Boolean			tmsortReadDecay(FILE *historyFile, 
 					PHG_Decay *decayPtr, 
 					LbUsFourByte *dataSize,
@@ -495,13 +520,12 @@ Boolean tmsortInitialize(int argc, char *argv[])
 			tmsortPhotonSize = sizeof(PHG_DetectedPhoton);
 		}
 		else {
-			/* Custom files use PHG_TrackingPhoton */
-			tmsortPhotonSize = sizeof(PHG_TrackingPhoton);
+			/* Custom files use PHG_TrackingPhoton, followed by its detector interactions */
+			tmsortPhotonSize = sizeof(PHG_TrackingPhoton) + sizeof(PHG_DetInteractionsTy);
 		}
 		
-		/* Initialize the default minimum and maximum key values */
+		/* Initialize the default minimum key value */
 		tmsortMinKey = TMSORT_MINKEY;
-		tmsortMaxKey = TMSORT_MAXKEY;
 		
 		/* Initialize the math library */
 		/* NOTE:  Random numbers not known to be used in this program */
@@ -940,8 +964,8 @@ Boolean tmsortTest(char *argv[])
 					tmsortPhotonSize = sizeof(PHG_DetectedPhoton);
 				}
 				else {
-					/* Custom files use PHG_TrackingPhoton */
-					tmsortPhotonSize = sizeof(PHG_TrackingPhoton);
+					/* Custom files use PHG_TrackingPhoton, followed by its detector interactions */
+					tmsortPhotonSize = sizeof(PHG_TrackingPhoton) + sizeof(PHG_DetInteractionsTy);
 				}
 			}
 		}		
@@ -978,10 +1002,24 @@ Boolean tmsortTimeSort(char *argv[])
 	LbUsFourByte		curFileIndex;				/* Current file index */
 	LbUsFourByte		sortFilesToMerge;			/* Number of smaller sort files produced */
 	LbUsFourByte		finalFileNumber;			/* Final index of sorted output file */
+	PhoHFileDecayIndexHdrTy	indexHdr;				/* Header of the history file's decay index */
+	PhoHFileChunkEntryTy	*indexEntries = NULL;	/* Its entries */
+	#ifdef TMSORT_THREADED_SORT
+	long				numProcessors;				/* Processors available for sorting */
+	#endif
 	
 	
 	do { /* Process Loop */
 		
+		/* Decide how many threads sort each run */
+		tmsortNumThreads = 1;
+		#ifdef TMSORT_THREADED_SORT
+			numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+			if (numProcessors > 1) {
+				tmsortNumThreads = PHGMATH_Min((LbUsFourByte) numProcessors, TMSORT_MAX_THREADS);
+			}
+		#endif
+		
 		/* Process the files */
 		for (curFileIndex = 1; curFileIndex <= tmsortNumToProc; curFileIndex++){
 			
@@ -1012,6 +1050,10 @@ Boolean tmsortTimeSort(char *argv[])
 				LbInPrintf("Buffer size is %ld megabytes.\n", 
 							(unsigned long)tmsortDataBufferSizeParam);
 			}
+			if (tmsortNumThreads > 1) {
+				LbInPrintf("Sorting with up to %ld threads.\n", 
+							(unsigned long)tmsortNumThreads);
+			}
 			
 			/* Check size of main data buffer (supplied by params file) */
 			/* Must be large enough for 3% reserve buffer to hold some full decays */
@@ -1031,6 +1073,37 @@ Boolean tmsortTimeSort(char *argv[])
 				goto FAIL;
 			}
 			
+			/* Size the merge read buffers; each must hold a few of the largest decays */
+			tmsortMaxRecordSpace = tmsortMergeDecaySize + tmsortDecaySize + 
+									PHG_MAX_DETECTED_PHOTONS*tmsortPhotonSize;
+			tmsortMergeBufMin = PHGMATH_Max(tmsortDataBufferSize / TMSORT_MERGE_BUFFERS, 
+									2*tmsortMaxRecordSpace);
+			tmsortMaxMergeFiles = PHGMATH_Max(tmsortDataBufferSize / tmsortMergeBufMin, 2);
+			
+			/* Allocate the merge inputs and their loser tree */
+			tmsortMaxMergeInputs = tmsortMaxMergeFiles + TMSORT_MAX_THREADS;
+			if ((tmsortMergeFiles = (MergeFileData *) 
+					LbMmAlloc(tmsortMaxMergeInputs*tmsortMergeFileSize)) == NULL) {
+				sprintf(tmsortErrStr, "Unable to allocate memory:  tmsortMergeFiles.");
+				ErStGeneric(tmsortErrStr);
+				goto FAIL;
+			}
+			if ((tmsortLoserTree = (LbUsFourByte *) 
+					LbMmAlloc(3*tmsortMaxMergeInputs*sizeof(LbUsFourByte))) == NULL) {
+				sprintf(tmsortErrStr, "Unable to allocate memory:  tmsortLoserTree.");
+				ErStGeneric(tmsortErrStr);
+				goto FAIL;
+			}
+			
+			
+			/* Index the sorted files like the history file, which may be deleted */
+			if (PhoHFileReadDecayIndex(tmsortHistName, &indexHdr, &indexEntries) == false) {
+				goto FAIL;
+			}
+			if (indexEntries != NULL) {
+				LbMmFree((void **) &indexEntries);
+			}
+			tmsortIndexInterval = indexHdr.interval;
 			
 			LbInPrintf("\nBeginning creation of intermediate subfiles...\n");
 			
@@ -1040,9 +1113,14 @@ Boolean tmsortTimeSort(char *argv[])
 				goto FAIL;
 			}
 			
-			if (sortFilesToMerge == 1) {
+			if ((sortFilesToMerge == 1) && (tmsortNumResidentInputs == 0)) {
 				LbInPrintf("Created a single sorted subfile; no merging required.\n");
 			}
+			else if (tmsortNumResidentInputs != 0) {
+				LbInPrintf("Created %ld sorted subfiles and kept the last run in memory, "
+							"now to be merged...\n", 
+							(unsigned long)sortFilesToMerge);
+			}
 			else {
 				LbInPrintf("Created %ld sorted subfiles, now to be merged...\n", 
 							(unsigned long)sortFilesToMerge);
@@ -1062,7 +1140,7 @@ Boolean tmsortTimeSort(char *argv[])
 			
 			
 			/* Merge the separate sorted files (phase II) */
-			if (sortFilesToMerge == 1) {
+			if ((sortFilesToMerge == 1) && (tmsortNumResidentInputs == 0)) {
 				/* Only one sort file produced; nothing to merge */
 				finalFileNumber = 1;
 			}
@@ -1087,14 +1165,26 @@ Boolean tmsortTimeSort(char *argv[])
 				ErStFileError(tmsortErrStr);
 				/* But keep going */
 			}
+			
+			/* Along with its decay index, if it has one */
+			sprintf(tmsortIndexName, "%s%s", tmsortSortName, PHOHFILE_INDEX_SUFFIX);
+			sprintf(tmsortFinalIndexName, "%s%s", tmsortSortNameBase, PHOHFILE_INDEX_SUFFIX);
+			remove(tmsortFinalIndexName);
+			rename(tmsortIndexName, tmsortFinalIndexName);
 #endif
 			
 			LbInPrintf("Final file and sorting process now completed.\n");
 			
-			/* Free the main buffer */
+			/* Free the main buffer and the merge inputs */
 			if (tmsortSortBufferPtr != NULL) {
 				LbMmFree((void **) &tmsortSortBufferPtr);
 			}
+			if (tmsortMergeFiles != NULL) {
+				LbMmFree((void **) &tmsortMergeFiles);
+			}
+			if (tmsortLoserTree != NULL) {
+				LbMmFree((void **) &tmsortLoserTree);
+			}
 			
 			
 			/* Open next parameters file */
@@ -1157,8 +1247,8 @@ Boolean tmsortTimeSort(char *argv[])
 					tmsortPhotonSize = sizeof(PHG_DetectedPhoton);
 				}
 				else {
-					/* Custom files use PHG_TrackingPhoton */
-					tmsortPhotonSize = sizeof(PHG_TrackingPhoton);
+					/* Custom files use PHG_TrackingPhoton, followed by its detector interactions */
+					tmsortPhotonSize = sizeof(PHG_TrackingPhoton) + sizeof(PHG_DetInteractionsTy);
 				}
 			}
 		}		
@@ -1172,6 +1262,12 @@ Boolean tmsortTimeSort(char *argv[])
 	if (tmsortSortBufferPtr != NULL) {
 		LbMmFree((void **) &tmsortSortBufferPtr);
 	}
+	if (tmsortMergeFiles != NULL) {
+		LbMmFree((void **) &tmsortMergeFiles);
+	}
+	if (tmsortLoserTree != NULL) {
+		LbMmFree((void **) &tmsortLoserTree);
+	}
 	
 	return (okay);
 }
@@ -1182,6 +1278,12 @@ Boolean tmsortTimeSort(char *argv[])
 *	Name:			tmsortSort
 *
 *	Summary:		Sort a large history file into multiple, smaller sorted files.
+*					Each run of decays read into the sort buffer is sorted
+*						there and written to its own file, except that the last
+*						run may stay in memory (tmsortResidentInputs) for the
+*						final merge.  While the file nearly fits in the buffer,
+*						a run is cut short once the rest of the file will fit,
+*						so that as little as possible is written out.
 *
 *	Arguments:
 *		LbUsFourByte	 	*numSortedFiles			- The # of files produced.
@@ -1193,64 +1295,45 @@ Boolean tmsortSort(LbUsFourByte *numSortedFiles)
 {
 	#define		kTSProgressMinutes		10	/* Time interval between progress displays */
 	#define		kTSProgressFiles		10	/* File interval between progress displays */
-	
+
 	Boolean				okay = false;				/* Function return value */
-	LbUsFourByte		i;							/* Generic index variable */
-	LbUsFourByte		j;							/* Index through decay distributions */
 	FILE				*historyFile;				/* The history file to sort */
-	/*double				histFileSize;*/				/* Size of the history file */
 	LbUsFourByte		accumSecs;					/* Seconds since last progress display */
 	double				accumCPUSecs;				/* Total used CPU time */
 	LbUsFourByte		nextAccumSecs;				/* Time between progress displays */
 	LbUsEightByte		sortedFilesSize;			/* Cumulative size of the sorted output files */
 	LbUsFourByte		nextFileDisplay;			/* Next file display point */
-	/*double				nextSizeDisplay;*/			/* Next cumulative size for a report message */
 	LbTmTimingType		clockTiming;				/* Timing data for progress messages */
-	LbUsFourByte		maxReserveSpace;			/* Original size of reserve buffer */
-	LbUsFourByte		reserveSpace;				/* Current size of reserve buffer */
 	EventTy				eventType;					/* Type of current event */
-	LbUsFourByte		numDecaysRead;				/* Number of decays read in so far */
-	LbUsFourByte		numDecaysWritten;			/* Number of decays written out so far */
-	LbUsFourByte		numInitialDecays;			/* Number of initial buffer decays */
-	LbSortItemPtr		listItemPtr;				/* Pointer to sorted list item */
-	LbSortListPtr		sortListPtr;				/* Pointer to sort sorted list */
-	DecaySortBlock		*curBlockPtr;				/* Pointer to the current block */
-	DecaySortData		*sortDataPtr;				/* Pointer to the current data */
-	LbUsFourByte		ioDecayAmount;				/* Usual number of buffer decays in i/o ops */
 	LbUsFourByte		sortFileNumber;				/* Index to current sorted output file */
-	Boolean				allDone;					/* File has been sorted into separate files */
 	PhoHFileHkTy		sortFileHk;					/* Hook to sorted file */
-	TmSortKeyType		minimumKey;					/* Smallest sort key for outputs */
-	LbUsFourByte		ioNumDecays;				/* Actual number of buffer decays in an i/o op */
-	LbSortItemPtr		minSortItem;				/* Item containing last minimumKey */
-	Boolean				foundDecay;					/* Good decay found in sorted list */
-	LbUsFourByte		numPhotons;					/* Number of photons in the decay */
-	PHG_Decay			*nextDecayPtr;				/* Current output decay data */
-	LbUsFourByte		clearedDecays;				/* Count of decays cleared from reserve buffer */
-	LbUsFourByte		estNumDecays;				/* Estimated count of decays to read in */
-	Boolean				gotData;					/* Decays were read in from file */
+	LbUsFourByte		numDecays;					/* Number of decays in the current run */
+	LbUsFourByte		recordsSize;				/* Buffer space used by the run's decays */
+	LbUsFourByte		numInputs;					/* Number of sorted slices of the run */
+	Boolean				isAtEnd;					/* The run ends the history file */
+	LbUsFourByte		residentSpace;				/* Space a run kept in memory may use */
+	LbUsFourByte		recordsEnd;					/* Aligned end of the run's decays */
+	LbUsFourByte		freeSpace;					/* Buffer space the run leaves unused */
 	double				realSecs;					/* Wall clock time elapsed */
 	double				cpuSecs;					/* CPU time elapsed */
 	time_t				curTime;					/* Current wall clock time */
 	char				timeStr[32];				/* String for printing the time */
-	
-	
+
+
 	/* Initialize variables */
-	tmsortTempDecayBlocksList = NULL;
-	for (i=0; i<=PHG_MAX_DETECTED_PHOTONS; i++) {
-		tmsortDecaySlots[i] = NULL;
-		
-		#ifdef TMSORT_PHO_DIST
-			tmsortPhotonCounts[i] = 0;
-		#endif
-	}
-	for (j=0; j<TMSORT_DIST_CT; j++) {
+	#ifdef TMSORT_PHO_DIST
+	{
+		LbUsFourByte	i;		/* Index through photon counts */
+
 		for (i=0; i<=PHG_MAX_DETECTED_PHOTONS; i++) {
-			tmsortDecaySlotDists[j][i] = 0;
+			tmsortPhotonCounts[i] = 0;
 		}
 	}
-	sortListPtr = NULL;
-	
+	#endif
+	tmsortNumResidentInputs = 0;
+	tmsortMergeSpace = (LbUsOneByte *)tmsortSortBufferPtr;
+	tmsortMergeSpaceSize = tmsortDataBufferSize;
+
 	/* Open history file file */
 	if ((historyFile = LbFlFileOpen(tmsortHistName, "rb")) == 0) {
 		sprintf(tmsortErrStr, "Unable to open history file\n'%s'.",
@@ -1258,18 +1341,17 @@ Boolean tmsortSort(LbUsFourByte *numSortedFiles)
 		ErStFileError(tmsortErrStr);
 		goto FAIL;
 	}
-	
-	/* Determine the size of the history file */
-	/*
-	if (fseek(historyFile, 0, SEEK_END) == 0) {
-		histFileSize = (double)(ftello(historyFile));
-	}
-	else {
-		histFileSize = -1.0;
+
+	/* Determine the size of the history file, used to size the runs */
+	tmsortHistFileSize = 0;
+	if ((! tmsortCustomFile) && (fseek(historyFile, 0, SEEK_END) == 0)) {
+		if (ftello(historyFile) > 0) {
+			tmsortHistFileSize = (LbUsEightByte) ftello(historyFile);
+		}
 	}
 	fseek(historyFile, 0, SEEK_SET);
-	*/
-	
+	PhoHFileReadAhead(historyFile);
+
 	/* Set up for progress display messages */
 	accumSecs = 0;
 	accumCPUSecs = 0.0;
@@ -1277,7 +1359,7 @@ Boolean tmsortSort(LbUsFourByte *numSortedFiles)
 	sortedFilesSize = 0;
 	nextFileDisplay = kTSProgressFiles;	/* = every xx sorted output files */
 	LbTmStartTiming(&clockTiming);
-	
+
 	/* Read in the original header and save it */
 	if (PhgHdrGtParams(historyFile, &tmsortHdrParams, &tmsortHistHeaderHk) == false){
 		sprintf(tmsortErrStr, "Unable to read history file header\n'%s'.",
@@ -1285,30 +1367,30 @@ Boolean tmsortSort(LbUsFourByte *numSortedFiles)
 		ErStFileError(tmsortErrStr);
 		goto FAIL;
 	}
-	
+
 	/* Verify that requested file is of the right type */
 	{
 		if (TMSORT_IsUsePHGHistory() && (tmsortHdrParams.H.HdrKind != PhoHFileEn_PHG)) {
 			ErStGeneric("File specified as PHG history file is not valid.");
 			goto FAIL;
 		}
-		
+
 		if (TMSORT_IsUseColHistory() && (tmsortHdrParams.H.HdrKind != PhoHFileEn_COL)) {
 			ErStGeneric("File specified as Collimator history file is not valid.");
 			goto FAIL;
 		}
-		
+
 		if (TMSORT_IsUseDetHistory() && (tmsortHdrParams.H.HdrKind != PhoHFileEn_DET)) {
 			ErStGeneric("File specified as Detector history file is not valid.");
 			goto FAIL;
 		}
 	}
-	
+
 	if (tmsortCustomFile) {
 		/* Setup header hook */
-		
+
 		tmsortHistParamsHk.doCustom = true;
-		
+
 		/* Do custom parameter initialization  */
 		if (PhoHFileGetRunTimeParams(tmsortHistParamsName, &(tmsortHistParamsHk.customParams)) == false) {
 			sprintf(tmsortErrStr,"Unable to get custom parameters for history file named '%s'",
@@ -1316,60 +1398,26 @@ Boolean tmsortSort(LbUsFourByte *numSortedFiles)
 			ErAlert(tmsortErrStr, false);
 			goto FAIL;
 		}
-		
+
 		strcpy(tmsortHistParamsHk.customParamsName, tmsortHistParamsName);
-		
+
 		tmsortHistParamsHk.bluesReceived = 0;
 		tmsortHistParamsHk.bluesAccepted = 0;
 		tmsortHistParamsHk.pinksReceived = 0;
 		tmsortHistParamsHk.pinksAccepted = 0;
 		tmsortHistParamsHk.histFile = historyFile;
 	}
-	
+
 	/* If the history file has been sorted already then we preserve its header */
 	/* If not, then the header is modified to show that it has been sorted. */
 	/* The file is sorted anyway, no matter what the header indicates. */
 	tmsortPreserveHeader = tmsortHdrParams.H.isTimeSorted;
-	
-	
-	/* The tmsortMaxKey may be improved upon by making it closer to the upper 
-		limit of possible decay time sort values */
-	if (tmsortHdrParams.H.PhgRunTimeParams.Phg_LengthOfScan > 0) {
-		/* The scan time exists, and no decay can occur after the end of scan */
-		tmsortMaxKey = tmsortHdrParams.H.PhgRunTimeParams.Phg_LengthOfScan + 1.0;
-	}
-	
-	/* Set aside a reserve buffer at the end of the main buffer for reading 
-		new decay data and for decay misfits */
-	maxReserveSpace = 0.03 * tmsortDataBufferSize;	/* 3% sounds good */
-	reserveSpace = maxReserveSpace;
-	/*reserveSpace = 32 * */		/* Arbitrary choice of number */
-	/*	(tmsortDecaySize + PHG_MAX_DETECTED_PHOTONS*tmsortPhotonSize);*/
-	tmsortReserveBufferPtr = (PHG_Decay *)((LbUsOneByte *)tmsortSortBufferPtr + 
-									tmsortDataBufferSize-maxReserveSpace);
-	tmsortResBufferStart = tmsortReserveBufferPtr;
-	
-	/* Allocate a start to the temporary, first batch decay list */
-	tmsortBlockSize = 1000;		/* Arbitrary choice */
-	if ((tmsortTempDecayBlocksList = (DecaySortBlock *) 
-			LbMmAlloc(sizeof(DecaySortBlock))) == NULL) {
-		sprintf(tmsortErrStr, "Unable to allocate memory:  tmsortTempDecayBlocksList.");
-		ErStGeneric(tmsortErrStr);
-		goto FAIL;
-	}
-	tmsortTempDecayBlocksList->nextSortBlock = NULL;
-	if ((tmsortTempDecayBlocksList->thisDataBlock = (DecaySortData *) 
-			LbMmAlloc(tmsortBlockSize*sizeof(DecaySortData))) == NULL) {
-		sprintf(tmsortErrStr, "Unable to allocate memory:  DecaySortData.");
-		ErStGeneric(tmsortErrStr);
-		goto FAIL;
-	}
-	
+
 	if (! tmsortCustomFile) {
-		/* Fill the first decay event buffer (decay reading assumes decay 
+		/* Fill the first decay event buffer (decay reading assumes decay
 			event always already read in from file */
 		tmsortDecayPending = false;
-		eventType = tmsortReadEvent(historyFile, &tmsortNextDecayEvent, 
+		eventType = tmsortReadEvent(historyFile, &tmsortNextDecayEvent,
 						(PHG_DetectedPhoton *)tmsortSortBufferPtr);
 		if (eventType != Decay) {
 			ErStGeneric("Expected first event to be decay, and it wasn't.");
@@ -1379,358 +1427,106 @@ Boolean tmsortSort(LbUsFourByte *numSortedFiles)
 			tmsortDecayPending = true;
 		}
 	}
-	
-	/* Initialize decay counts */
-	numDecaysRead = 0;
-	numDecaysWritten = 0;
-	
-	/* Fill the sort buffer from the input file */
-	if (! tmsortGetFirstBatch(historyFile, 
-								tmsortDataBufferSize-reserveSpace, 
-								&numInitialDecays)) {
-		/* Unable to allocate enough memory; error message already sent */
-		goto FAIL;
-	}
-	numDecaysRead = numInitialDecays;
-	
-	/* Initialize the read distribution with the one just read */
-	tmsortCurDist = 0;
-	for (i=0; i<=PHG_MAX_DETECTED_PHOTONS; i++) {
-		tmsortDecaySlotDists[tmsortCurDist][i] = tmsortDecaySlotMaxs[i];
-	}
-	
-	/* Make a new sorted list */
-	if ((sortListPtr = LbSortNewList(numInitialDecays+1, 
-						(LbSortKeyPtr)&tmsortMinKey, sizeof(TmSortKeyType), 
-						tmsortKeyComparator)) == NULL) {
-		/* Severe problems */
-		sprintf(tmsortErrStr, "Got failure creating sorted list.");
-		ErStGeneric(tmsortErrStr);
-		goto FAIL;
-	}
-	
-	/* Add an initial tmsortMinKey item (required by output algorithm) */
-	if (! LbSortInsert(sortListPtr, (LbSortKeyPtr)&tmsortMinKey, 0, NULL) ) {
-		/* Severe problems */
-		sprintf(tmsortErrStr, "Got failure adding first sorted list item.");
-		ErStGeneric(tmsortErrStr);
-		goto FAIL;
-	}
-	
-	/* Add the first batch of decays to the sorted list */
-	/* NOTE:  Can't be done at time of reading because sorted list isn't 
-		created until its size is known (after reading) */
-	curBlockPtr = tmsortTempDecayBlocksList;
-	while (curBlockPtr != NULL) {
-		for (i=0; i<tmsortBlockSize; i++) {
-			sortDataPtr = curBlockPtr->thisDataBlock + i;
-			if (sortDataPtr->decayDataPtr != NULL) {
-				/* Add the data to the sorted list */
-				if (! tmsortSortDecay(sortListPtr, 
-						sortDataPtr->decayDataPtr, sortDataPtr->numPhotons)) {
-					sprintf(tmsortErrStr, "Unable to sort data; all results are invalid.");
-					ErStGeneric(tmsortErrStr);
-					goto FAIL;
-				}
-			}
-			else {
-				/* End of data */
-				curBlockPtr = NULL;
-				break;
-			}
-		}
-		if (curBlockPtr != NULL) {
-			/* Go to next block */
-			curBlockPtr = curBlockPtr->nextSortBlock;
-		}
-	}
-	
-	/* Delete the temporary, first batch decay list */
-	curBlockPtr = tmsortTempDecayBlocksList;
-	while (curBlockPtr != NULL) {
-		if (curBlockPtr->thisDataBlock != NULL) {
-			/* Delete the data block */
-			LbMmFree((void **) &curBlockPtr->thisDataBlock);
-		}
-		tmsortTempDecayBlocksList = curBlockPtr->nextSortBlock;
-		LbMmFree((void **) &curBlockPtr);
-		curBlockPtr = tmsortTempDecayBlocksList;
-	}
-	
-	/* Allocate the decay slot lists */
-	for (i=0; i<=PHG_MAX_DETECTED_PHOTONS; i++) {
-		if (tmsortDecaySlotMaxs[i] > 0) {
-			/* Allocate the memory */
-			if ((tmsortDecaySlots[i] = (PHG_Decay **) 
-					LbMmAlloc(tmsortDecaySlotMaxs[i]*sizeof(PHG_Decay *))) == NULL) {
-				sprintf(tmsortErrStr, "Unable to allocate memory:  tmsortDecaySlots[%ld].", 
-					(unsigned long)i);
-				ErStGeneric(tmsortErrStr);
-				goto FAIL;
-			}
-		}
-	}
-	
-	/* Set the proportion of the sort buffer to be read/written */
-	/* This size is chosen to have a large portion of decay records 
-		in the sorted list, yet still allow bulk i/o to minimize disk 
-		seeks.  Note:  the size has not been optimally determined.  */
-	ioDecayAmount = numInitialDecays / 16;
-	if (ioDecayAmount <= 0) {
-		ioDecayAmount = numInitialDecays;
-	}
-	
-	
+
+
 	/* Sort the input file into as many output files as needed */
 	sortFileNumber = 0;
-	allDone = false;
 	do {
-		/* Create the next sortFileNumber numbered output file */
-		sortFileNumber++;
-		sprintf(tmsortSortName, 
-				"%s%ld", tmsortSortNameBase, (unsigned long)sortFileNumber);
-		if (PhoHFileCreate(tmsortSortName, "", 
-				tmsortHdrParams.H.HdrKind, &sortFileHk) == false) {
-			sprintf(tmsortErrStr,"Unable to create sorted file named:\n"
-				"'%s'\n"
-				" (tmsortSort)",
-				tmsortSortName);
-			ErStFileError(tmsortErrStr);
-			goto FAIL;
-		}
-		
-		/* Initialize the smallest sort key */
-		minimumKey = tmsortMinKey;
-		
-		do {
-			/* Write out the next batch of sorted output records */
-			ioNumDecays = ioDecayAmount;
-			if (LbSortFind(sortListPtr, (LbSortKeyPtr)&minimumKey, &minSortItem)) {
-				for (i=0; i<ioNumDecays; i++) {
-					foundDecay = LbSortNext(sortListPtr, 
-						minSortItem, &listItemPtr, &numPhotons, (void **)&nextDecayPtr);
-					if (foundDecay) {
-						/* Update the minimum key */
-						tmsortGetDecaySortKey(nextDecayPtr, &minimumKey);
-						
-						/* Write out the decay */
-						if (! tmsortWriteDecay(&sortFileHk, nextDecayPtr,
-								(PHG_DetectedPhoton *)(nextDecayPtr+1), numPhotons)) {
-							sprintf(tmsortErrStr, "Got failure writing sort decay to disk.");
-							ErStFileError(tmsortErrStr);
-							goto FAIL;
-						}
-						
-						/* Remove the decay from the sorted list */
-						if (! LbSortDelete(sortListPtr, listItemPtr)) {
-							/* Severe problems */
-							sprintf(tmsortErrStr, "Got failure removing sort decay from sorted list.");
-							ErStGeneric(tmsortErrStr);
-							goto FAIL;
-						}
-						
-						/* Clear the decay data's buffer spot */
-						tmsortRemoveDecay(nextDecayPtr, numPhotons);
-					}
-					else {
-						/* No more data >= minimumKey */
-						
-						ioNumDecays = i;	/* Decays found */
-						
-						break;
-					}
-				}
-			}
-			numDecaysWritten += ioNumDecays;
-			
-			/* Clear out the reserve buffer as much as possible */
-			tmsortClearReserveBuffer(sortListPtr, &reserveSpace, &clearedDecays);
-			ioNumDecays -= clearedDecays;
-			
-			if (reserveSpace == maxReserveSpace) {
-				/* Reserve buffer is unused -- check if can read in more */
-				estNumDecays = tmsortEstimateReadDecays();
-				ioNumDecays = PHGMATH_Max(ioNumDecays, estNumDecays);
-			}
-			
-			/* Refill the sort buffer */
-			gotData = tmsortGetNextBatch(historyFile, sortListPtr, 
-											&reserveSpace, &ioNumDecays);
-			numDecaysRead += ioNumDecays;
-		} while (gotData);
-		
-		if (LbSortNext(sortListPtr, minSortItem, &listItemPtr, 
-								&numPhotons, (void **)&nextDecayPtr)) {
-			/* Write out the remaining decays in the sorted list */
-			do {
-				/* Write out the decay */
-				if (! tmsortWriteDecay(&sortFileHk, nextDecayPtr,
-						(PHG_DetectedPhoton *)(nextDecayPtr+1), numPhotons)) {
-					sprintf(tmsortErrStr, "Got failure writing sort decay to disk.");
-					ErStFileError(tmsortErrStr);
-					goto FAIL;
-				}
-				numDecaysWritten++;
-				
-				/* Remove the decay from the sorted list */
-				if (! LbSortDelete(sortListPtr, listItemPtr)) {
-					/* Severe problems */
-					sprintf(tmsortErrStr, "Got failure removing sort decay from sorted list.");
-					ErStGeneric(tmsortErrStr);
-					goto FAIL;
-				}
-				
-				/* Clear the decay data's buffer spot */
-				tmsortRemoveDecay(nextDecayPtr, numPhotons);
-				
-			} while (LbSortNext(sortListPtr, minSortItem, &listItemPtr, 
-												&numPhotons, (void **)&nextDecayPtr));
-			
-			/* Clear out the reserve buffer as much as possible */
-			tmsortClearReserveBuffer(sortListPtr, &reserveSpace, &clearedDecays);
-		}
-		
-		if (LbSortFind(sortListPtr, (LbSortKeyPtr)&tmsortMinKey, &minSortItem)) {
-			if (! LbSortNext(sortListPtr, minSortItem, &listItemPtr, 
-										&numPhotons, (void **)&nextDecayPtr)) {
-				/* No data items remain in list */
-				
-				/* Input file has been completely sorted (for phase I) */
-				allDone = true;
-			}
-			else {
-				/* Need to start a new file */
-			}
-		}
-		else {
-			/* Sorted list is incorrectly empty!! (missing null item) */
-			/* Shouldn't ever happen */
-			
-			/* Assume file has been completely sorted (for phase I) */
-			allDone = true;
+		/* Read in and sort the next run */
+		residentSpace = tmsortDataBufferSize -
+			PHGMATH_Min(sortFileNumber+1, tmsortMaxMergeFiles)*tmsortMergeBufMin;
+		tmsortReadRun(historyFile, residentSpace, &numDecays, &recordsSize, &isAtEnd);
+		if (numDecays == 0) {
+			/* The last run ended exactly at the end of the file */
+			break;
 		}
-		
-		/* Copy the original file header data to the new file (it is desirable 
-			that a sorted file have an identical header as its unsorted copy) */
-		memcpy(sortFileHk.headerHk.headerData,
-				tmsortHistHeaderHk.headerData, tmsortHistHeaderHk.headerSize);
-		
-		if (! tmsortPreserveHeader) {
-			/* Add the timesorted indicator */
-			tmsortHdrParams.H.isTimeSorted = true;
-			if (LbHdrStElem(&(sortFileHk.headerHk), HDR_HISTORY_FILE_IS_SORTED_ID,
-					sizeof(tmsortHdrParams.H.isTimeSorted),
-					(void *)&(tmsortHdrParams.H.isTimeSorted)) == false){
-				
-				sprintf(tmsortErrStr,"Unable to set header 'timesorted indicator' parameter.");
-				ErStFileError(tmsortErrStr);
-				goto FAIL;
+		tmsortSortRun(numDecays, &numInputs);
+
+		if (isAtEnd && (sortFileNumber > 0)) {
+			/* Keep the last run in memory if it leaves room for the merge read buffers */
+			recordsEnd = (recordsSize + 7) & ~7;
+			freeSpace = (LbUsFourByte)((LbUsOneByte *)tmsortGetRunItems(numDecays) -
+							(LbUsOneByte *)tmsortSortBufferPtr) - recordsEnd;
+			if (freeSpace >=
+					PHGMATH_Min(sortFileNumber, tmsortMaxMergeFiles)*tmsortMergeBufMin) {
+
+				memcpy(tmsortResidentInputs, tmsortMergeFiles, numInputs*tmsortMergeFileSize);
+				tmsortNumResidentInputs = numInputs;
+				tmsortMergeSpace = (LbUsOneByte *)tmsortSortBufferPtr + recordsEnd;
+				tmsortMergeSpaceSize = freeSpace;
+				break;
 			}
 		}
-		
-		/* Save the header to the sorted output file */
-		if (PhgHdrUpHeader(NULL, &tmsortHdrParams, &(sortFileHk.headerHk)) == false) {
-			sprintf(tmsortErrStr, "Unable to write header to sorted history file\n'%s'.",
-				tmsortSortName);
-			ErStFileError(tmsortErrStr);
+
+		/* Write the run to the next sortFileNumber numbered output file */
+		sortFileNumber++;
+		if (! tmsortCreateSortFile(sortFileNumber, &sortFileHk)) {
 			goto FAIL;
 		}
-		
-		/* Accumulate the size of the sorted output file */
-		if (fseek(sortFileHk.histFile, 0, SEEK_END) == 0) {
-			if (ftell(sortFileHk.histFile) > 0) {
-				sortedFilesSize += ftell(sortFileHk.histFile);
-			}
+		if (! tmsortMergeInputs(numInputs, &sortFileHk)) {
+			goto FAIL;
 		}
-		
-		/* Close the output file */
-		/* NOTE:  Can't use PhoHFileClose because it restores the new header */
-		PhgHdrFrHeader(&sortFileHk.headerHk);
-		if (fclose(sortFileHk.histFile) != 0) {
-			sortFileHk.histFile = NULL;
-			sprintf(tmsortErrStr,"Unable to close sorted file named:\n"
-				"'%s'\n"
-				" (tmsortSort)",
-				tmsortSortName);
-			ErStFileError(tmsortErrStr);
+		if (! tmsortCloseSortFile(sortFileNumber, &sortFileHk, &sortedFilesSize)) {
 			goto FAIL;
 		}
-		sortFileHk.histFile = NULL;
-		
+
 		/* Check for a progress message display */
 		if (LbTmStopTiming(&clockTiming, &realSecs, &cpuSecs)) {
 			accumSecs += (LbUsFourByte) realSecs;
 			accumCPUSecs += cpuSecs;
-			
+
 			/* Restart the timer */
 			LbTmStartTiming(&clockTiming);
-			
+
 			if ((accumSecs >= nextAccumSecs) && 	/* use longer of two */
 						(sortFileNumber >= nextFileDisplay)) {
-				
+
 				accumSecs = 0;	/* easier than incrementing to total */
 				nextFileDisplay += kTSProgressFiles;	/* every xx sort files */
-				
+
 				/* Get current time */
 				time(&curTime);
-				
+
 				/* Convert time to string format */
 				strftime(timeStr, 31, "(%H:%M  %e-%b-%y)", localtime(&curTime));
-				
+
 				/* Display a progress message */
 				LbInPrintf(" %d subfiles created (%d MB),  CPU seconds = %3.0f  %s.\n",
-					sortFileNumber, (int)(sortedFilesSize/1024/1024), 
+					sortFileNumber, (int)(sortedFilesSize/1024/1024),
 					accumCPUSecs, timeStr);
 			}
 		}
-	} while (! allDone);
-	
+	} while (! isAtEnd);
+
 	*numSortedFiles = sortFileNumber;
-	
+
 	/* Display the 100% progress message */
 	if (LbTmStopTiming(&clockTiming, &realSecs, &cpuSecs)) {
 		accumCPUSecs += cpuSecs;
-		
+
 		/* Get current time */
 		time(&curTime);
-		
+
 		/* Convert time to string format */
 		strftime(timeStr, 31, "(%H:%M  %e-%b-%y)", localtime(&curTime));
-		
+
 		/* Display a progress message */
 		LbInPrintf(" %d subfiles created (%d MB),  CPU seconds = %3.0f  %s.\n",
-			sortFileNumber, (int)(sortedFilesSize/1024/1024), 
+			sortFileNumber, (int)(sortedFilesSize/1024/1024),
 			accumCPUSecs, timeStr);
 	}
-	
+
 	/* Close the history file file */
 	fclose(historyFile);
-	
+
 	okay = true;
-	
-	
+
+
 	FAIL:;
 	/* NOTE:  In case of failure, files may be left unclosed; therefore,
-		it is best to completely exit the program on failure and let the 
+		it is best to completely exit the program on failure and let the
 		system clean up these files. */
-	
-	/* Free data structures */
-	curBlockPtr = tmsortTempDecayBlocksList;
-	while (curBlockPtr != NULL) {
-		if (curBlockPtr->thisDataBlock != NULL) {
-			/* Delete the data block */
-			LbMmFree((void **) &curBlockPtr->thisDataBlock);
-		}
-		tmsortTempDecayBlocksList = curBlockPtr->nextSortBlock;
-		LbMmFree((void **) &curBlockPtr);
-	}
-	for (i=0; i<=PHG_MAX_DETECTED_PHOTONS; i++) {
-		if (tmsortDecaySlots[i] != NULL) {
-			LbMmFree((void **) &tmsortDecaySlots[i]);
-		}
-	}
-	LbSortDisposeList(&sortListPtr);
-	
+
 	return (okay);
 }
 
@@ -1740,6 +1536,10 @@ Boolean tmsortSort(LbUsFourByte *numSortedFiles)
 *	Name:			tmsortMerge
 *
 *	Summary:		Merge multiple, smaller sorted files into a single sorted history file.
+*					All of the files, and any run kept in memory, are merged in
+*						one pass unless there are more files than the buffer
+*						can give read buffers; then the earliest files are first
+*						merged together until the rest can be.
 *
 *	Arguments:
 *		LbUsFourByte	 	sortFilesToMerge		- The # of files to merge.
@@ -1751,220 +1551,94 @@ Boolean tmsortSort(LbUsFourByte *numSortedFiles)
 Boolean tmsortMerge(LbUsFourByte sortFilesToMerge, LbUsFourByte *finalFileNum)
 {
 	Boolean				okay = false;				/* Function return value */
-	LbUsFourByte		maxSimulSortFiles;			/* Maximum number of open sort files */
+	LbUsFourByte		*runFiles = NULL;			/* File indexes of the runs, in input order */
+	LbUsFourByte		numRuns;					/* Number of runs left in files */
 	LbUsFourByte		mergeFileNumber;			/* File index of a merged output file */
-	LbUsFourByte		simulSortFiles;				/* Number of files to merge at one time */
 	LbUsFourByte		i;							/* Generic index variable */
-	PhoHFileHdrTy		sortHdrParams;				/* Input header */
-	LbHdrHkTy			sortHeaderHk;				/* Hook to sort file header */
-	LbUsFourByte		mergedFiles;				/* Current count of files merged */
-	LbUsFourByte		filesToMerge;				/* Current total count of files to merge */
-	LbUsFourByte		curNumSortFiles;			/* Current count of files to merge */
 	time_t				curTime;					/* Current wall clock time */
 	char				timeStr[32];				/* String for printing the time */
-	
-	
-	/* Set maximum number of open files */
-	/* Since allowed main buffer minimum is based on a minimal size for 3% of the 
-		buffer, allow 100/3 = 33 maximum files--the reason is that the buffer 
-		will be divided into this many sub-buffers. */
-	maxSimulSortFiles = 33;
-	
-	/* Create an array of files for each file to be merged */
-	if ((tmsortMergeFiles = (MergeFileData *) 
-			LbMmAlloc(maxSimulSortFiles*tmsortMergeFileSize)) == NULL) {
-		sprintf(tmsortErrStr, "Unable to allocate memory:  tmsortMergeFiles.");
+
+
+	/* List the sort files in the order their decays were read */
+	if ((runFiles = (LbUsFourByte *)
+			LbMmAlloc((sortFilesToMerge+1)*sizeof(LbUsFourByte))) == NULL) {
+		sprintf(tmsortErrStr, "Unable to allocate memory:  runFiles.");
 		ErStGeneric(tmsortErrStr);
 		goto FAIL;
 	}
-	
-	/* Open an output file */
-	mergeFileNumber = sortFilesToMerge + 1;
-	sprintf(tmsortSortName, 
-			"%s%ld", tmsortSortNameBase, (unsigned long)mergeFileNumber);
-	if (PhoHFileCreate(tmsortSortName, "", 
-			tmsortHdrParams.H.HdrKind, &tmsortMergeFileHk) == false) {
-		sprintf(tmsortErrStr,"Unable to create sorted file named:\n"
-			"'%s'\n"
-			" (tmsortMerge)",
-			tmsortSortName);
-		ErStFileError(tmsortErrStr);
-		goto FAIL;
-	}
-	
-	/* Open as many simultaneous input files as possible, up to the maximum */
-	simulSortFiles = 0;
 	for (i=0; i<sortFilesToMerge; i++) {
-		/* Try to open the file */
-		sprintf(tmsortSortName, "%s%ld", tmsortSortNameBase, (unsigned long)(i+1));
-		if ((tmsortMergeFiles[i].theFile = LbFlFileOpen(tmsortSortName, "rb")) != NULL) {
-			simulSortFiles++;
-			
-			/* Read in the header (but ignore it) */
-			if (PhgHdrGtParams(tmsortMergeFiles[i].theFile, &sortHdrParams, &sortHeaderHk) == false){
-				sprintf(tmsortErrStr, "Unable to read input sort file header\n'%s'.",
-					tmsortSortName);
-				ErStFileError(tmsortErrStr);
-				goto FAIL;
-			}
-		}
-		else {
-			/* No more can be opened */
-			break;
-		}
-		
-		if (simulSortFiles == maxSimulSortFiles) {
-			/* Have reached the maximum allowable */
-			break;
-		}
+		runFiles[i] = i+1;
 	}
-	
-	/* Convert the main buffer to a merge buffer */
-	tmsortMergeBufferPtr = (DecayMergeData *)tmsortSortBufferPtr;
-	
-	/* Merge the files */
-	mergedFiles = 0;
-	filesToMerge = sortFilesToMerge;
-	curNumSortFiles = simulSortFiles;
-	while (curNumSortFiles > 1) {
+	numRuns = sortFilesToMerge;
+	mergeFileNumber = sortFilesToMerge;
+
+	/* Merge the earliest files together until the rest can be merged at once;
+		the merged file takes their place at the front of the list */
+	while (numRuns > tmsortMaxMergeFiles) {
+		mergeFileNumber++;
+
 		/* Get current time */
 		time(&curTime);
-		
+
 		/* Convert time to string format */
 		strftime(timeStr, 31, "(%H:%M  %e-%b-%y)", localtime(&curTime));
-		
+
 		/* Display a progress message */
-		LbInPrintf(" Merging subfiles %ld-%ld,  %s.\n", 
-						(unsigned long)(mergedFiles+1), 
-						(unsigned long)(mergedFiles+curNumSortFiles), timeStr);
-		
-		/* Merge the current set of files */
-		if (! tmsortMergeFileBatch(curNumSortFiles)) {
+		LbInPrintf(" Merging %ld subfiles into subfile %ld,  %s.\n",
+						(unsigned long)tmsortMaxMergeFiles,
+						(unsigned long)mergeFileNumber, timeStr);
+
+		if (! tmsortMergeFileBatch(runFiles, tmsortMaxMergeFiles, false, mergeFileNumber)) {
 			/* Error in merging files; should already have been reported */
 			goto FAIL;
 		}
-		
-		/* Close up the output file */
-		{
-			/* Copy the original file header data to the new file (it is desirable 
-				that a sorted file have an identical header as its unsorted copy) */
-			memcpy(tmsortMergeFileHk.headerHk.headerData,
-					tmsortHistHeaderHk.headerData, tmsortHistHeaderHk.headerSize);
-			
-			if (! tmsortPreserveHeader) {
-				/* Add the timesorted indicator */
-				tmsortHdrParams.H.isTimeSorted = true;
-				if (LbHdrStElem(&(tmsortMergeFileHk.headerHk), HDR_HISTORY_FILE_IS_SORTED_ID,
-						sizeof(tmsortHdrParams.H.isTimeSorted),
-						(void *)&(tmsortHdrParams.H.isTimeSorted)) == false){
-					
-					sprintf(tmsortErrStr,"Unable to set header 'timesorted indicator' parameter.");
-					ErStFileError(tmsortErrStr);
-					goto FAIL;
-				}
-			}
-			
-			/* Save the original header to the merged output file */
-			if (PhgHdrUpHeader(NULL, &tmsortHdrParams, &(tmsortMergeFileHk.headerHk)) == false) {
-				sprintf(tmsortSortName, 
-					"%s%ld", tmsortSortNameBase, (unsigned long)mergeFileNumber);
-				sprintf(tmsortErrStr, "Unable to write header to merged history file\n'%s'.",
-					tmsortSortName);
-				ErStFileError(tmsortErrStr);
-				goto FAIL;
-			}
-			
-			/* Close the output file */
-			/* NOTE:  Can't use PhoHFileClose because it restores the new header */
-			PhgHdrFrHeader(&tmsortMergeFileHk.headerHk);
-			if (fclose(tmsortMergeFileHk.histFile) != 0) {
-				tmsortMergeFileHk.histFile = NULL;
-				sprintf(tmsortSortName, 
-					"%s%ld", tmsortSortNameBase, (unsigned long)mergeFileNumber);
-				sprintf(tmsortErrStr,"Unable to close merged file named:\n"
-					"'%s'\n"
-					" (tmsortMerge)",
-					tmsortSortName);
-				ErStFileError(tmsortErrStr);
-				goto FAIL;
-			}
-			tmsortMergeFileHk.histFile = NULL;
-		}
-		
-		/* Close and delete the merged input files */
-		for (i=0; i<curNumSortFiles; i++) {
-			/* Close the file (ignore errors) */
-			fclose(tmsortMergeFiles[i].theFile);
-			tmsortMergeFiles[i].theFile = NULL;
-			
-#ifndef TMSORT_KEEP_TEMP_FILES
-			/* Delete the file (report errors, but keep going) */
-			sprintf(tmsortSortName, 
-				"%s%ld", tmsortSortNameBase, (unsigned long)(mergedFiles+i+1));
-			if (remove(tmsortSortName) != 0) {
-				sprintf(tmsortErrStr, "Unable to delete sort file\n'%s'.",
-					tmsortSortName);
-				ErStFileError(tmsortErrStr);
-			}
-#endif
-		}
-		
-		/* Update the counts of files to merge */
-		mergedFiles += curNumSortFiles;
-		filesToMerge = filesToMerge - curNumSortFiles + 1;
-		curNumSortFiles = PHGMATH_Min(simulSortFiles, filesToMerge);
-		
-		if (curNumSortFiles > 1) {
-			/* Set up for the next merge batch */
-			
-			/* Open an output file */
-			mergeFileNumber++;
-			sprintf(tmsortSortName, 
-				"%s%ld", tmsortSortNameBase, (unsigned long)mergeFileNumber);
-			if (PhoHFileCreate(tmsortSortName, "", 
-					tmsortHdrParams.H.HdrKind, &tmsortMergeFileHk) == false) {
-				sprintf(tmsortErrStr,"Unable to create sorted file named:\n"
-					"'%s'\n"
-					" (tmsortMerge)",
-					tmsortSortName);
-				ErStFileError(tmsortErrStr);
-				goto FAIL;
-			}
-			
-			/* Open the input files */
-			for (i=0; i<curNumSortFiles; i++) {
-				/* Try to open the file */
-				sprintf(tmsortSortName, 
-					"%s%ld", tmsortSortNameBase, (unsigned long)(mergedFiles+i+1));
-				if ((tmsortMergeFiles[i].theFile = LbFlFileOpen(tmsortSortName, "rb")) != NULL) {
-					/* Read in the header (but ignore it) */
-					if (PhgHdrGtParams(tmsortMergeFiles[i].theFile, &sortHdrParams, &sortHeaderHk) == false){
-						sprintf(tmsortErrStr, "Unable to read input sort file header\n'%s'.",
-							tmsortSortName);
-						ErStFileError(tmsortErrStr);
-						goto FAIL;
-					}
-				}
-			}
+
+		runFiles[0] = mergeFileNumber;
+		for (i=1; i<=numRuns-tmsortMaxMergeFiles; i++) {
+			runFiles[i] = runFiles[i+tmsortMaxMergeFiles-1];
 		}
+		numRuns -= tmsortMaxMergeFiles - 1;
 	}
-	
-	*finalFileNum = mergeFileNumber;
-	
-	/* Free memory */
-	if (tmsortMergeFiles != NULL) {
-		LbMmFree((void **) &tmsortMergeFiles);
+
+	/* Merge the remaining files with the run kept in memory */
+	mergeFileNumber++;
+
+	/* Get current time */
+	time(&curTime);
+
+	/* Convert time to string format */
+	strftime(timeStr, 31, "(%H:%M  %e-%b-%y)", localtime(&curTime));
+
+	/* Display a progress message */
+	if (tmsortNumResidentInputs != 0) {
+		LbInPrintf(" Merging %ld subfiles and the run in memory,  %s.\n",
+						(unsigned long)numRuns, timeStr);
 	}
-	
+	else {
+		LbInPrintf(" Merging %ld subfiles,  %s.\n",
+						(unsigned long)numRuns, timeStr);
+	}
+
+	if (! tmsortMergeFileBatch(runFiles, numRuns, true, mergeFileNumber)) {
+		/* Error in merging files; should already have been reported */
+		goto FAIL;
+	}
+
+	*finalFileNum = mergeFileNumber;
+
 	okay = true;
-	
-	
+
+
 	FAIL:;
 	/* NOTE:  In case of failure, files may be left unclosed; therefore,
-		it is best to completely exit the program on failure and let the 
-		system clean up these files.  This also requires tmsortMergeFiles 
-		be left unfreed. */
-	
+		it is best to completely exit the program on failure and let the
+		system clean up these files. */
+
+	/* Free memory */
+	if (runFiles != NULL) {
+		LbMmFree((void **) &runFiles);
+	}
+
 	return (okay);
 }
 
@@ -1973,599 +1647,756 @@ Boolean tmsortMerge(LbUsFourByte sortFilesToMerge, LbUsFourByte *finalFileNum)
 *
 *	Name:			tmsortMergeFileBatch
 *
-*	Summary:		Merge numSortFiles sorted files into a single sorted file.
+*	Summary:		Merge numRuns sorted files into a single sorted file,
+*						then delete them.  The merge space is divided evenly
+*						into their read buffers.
 *
 *	Arguments:
-*		LbUsFourByte	 	numSortFiles			- The # of files to merge.
+*		LbUsFourByte	 	*runFiles				- The file indexes, in input order.
+*		LbUsFourByte	 	numRuns					- The # of files to merge.
+*		Boolean			 	withResident			- Also merge the run kept in memory.
+*		LbUsFourByte	 	outFileNumber			- The file index of the output.
 *
 *	Function return: True unless an error occurs.
 *
 *********************************************************************************/
-Boolean tmsortMergeFileBatch(LbUsFourByte numSortFiles)
+Boolean tmsortMergeFileBatch(LbUsFourByte *runFiles, LbUsFourByte numRuns,
+			Boolean withResident, LbUsFourByte outFileNumber)
 {
 	Boolean				okay = false;				/* Function return value */
-	LbSortListPtr		mergeListPtr;				/* Pointer to merge sorted list */
+	PhoHFileHdrTy		sortHdrParams;				/* Input header */
+	LbHdrHkTy			sortHeaderHk;				/* Hook to sort file header */
+	LbUsFourByte		bufSize;					/* Size of each read buffer */
+	LbUsFourByte		numInputs;					/* Number of merge inputs */
 	LbUsFourByte		i;							/* Generic index variable */
-	LbUsFourByte		bufferUsed;					/* Amount of main buffer used for current sort file */
-	LbUsFourByte		bufOffset;					/* Start of buffer for current sort file */
-	DecayMergeData		*mergeBufferPtr;			/* Pointer into current sorted merge buffer */
 	EventTy				eventType;					/* Type of current event */
-	LbUsFourByte		numDecaysRead;				/* Number of decays read in so far */
-	LbUsFourByte		numDecaysWritten;			/* Number of decays written out so far */
-	TmSortKeyType		minSortKey;					/* Minimum sort key */
-	Boolean				allDone;					/* Files have been merged */
-	LbSortItemPtr		minSortItem;				/* Item containing last minimum key */
-	LbSortItemPtr		mergeItemPtr;				/* Item containing current minimum decay */
-	LbUsFourByte		numPhotons;					/* Number of photons in the decay */
-	PHG_Decay			*nextDecayPtr;				/* Current output decay data */
-	TmSortKeyType		nextSortKey;				/* Next minimum sort key */
-	LbSortItemPtr		nextItemPtr;				/* Item containing next minimum decay */
-	LbUsFourByte		fileIndex;					/* Current sort file index number */
-	PHG_Decay			*mergeDecayPtr;				/* Ptr to current minimum decay data */
-	LbUsFourByte		remainingDecays;			/* Decays still in current sort buffer */
-	LbUsFourByte		dataSize;					/* Size of current decay data */
-	
-	
-	/* Make a new sorted list */
-	if ((mergeListPtr = LbSortNewList(numSortFiles+1, 
-							(LbSortKeyPtr)&tmsortMinKey, sizeof(TmSortKeyType), 
-							tmsortKeyComparator)) == NULL) {
-		/* Severe problems */
-		sprintf(tmsortErrStr, "Got failure creating sorted list.");
-		ErStGeneric(tmsortErrStr);
-		goto FAIL;
-	}
-	
-	/* Add an initial tmsortMinKey item (to increase access speed) */
-	if (! LbSortInsert(mergeListPtr, (LbSortKeyPtr)&tmsortMinKey, 0, NULL) ) {
-		/* Severe problems */
-		sprintf(tmsortErrStr, "Got failure adding first sorted list item.");
-		ErStGeneric(tmsortErrStr);
-		goto FAIL;
-	}
-	
-	/* Divide the main buffer into numSortFiles sections */
-	bufferUsed = 0;
-	tmsortMergeFiles[0].bufStart = tmsortMergeBufferPtr;
-	for (i=1; i<numSortFiles; i++) {
-		bufOffset = (LbUsFourByte)
-			((float)i/numSortFiles * tmsortDataBufferSize);
-		tmsortMergeFiles[i].bufStart = (DecayMergeData *)
-			((LbUsOneByte *)tmsortMergeBufferPtr + bufOffset);
-		tmsortMergeFiles[i-1].bufSize = bufOffset - bufferUsed;
-		bufferUsed = bufOffset;
-	}
-	tmsortMergeFiles[numSortFiles-1].bufSize = 
-		tmsortDataBufferSize - bufferUsed;
-	
-	/* Read in the first decay for each file */
-	for (i=0; i<numSortFiles; i++) {
+
+
+	/* Open the files, each reading into an equal share of the merge space */
+	bufSize = (tmsortMergeSpaceSize / numRuns) & ~7;
+	for (i=0; i<numRuns; i++) {
+		sprintf(tmsortSortName, "%s%ld", tmsortSortNameBase, (unsigned long)runFiles[i]);
+		if ((tmsortMergeFiles[i].theFile = LbFlFileOpen(tmsortSortName, "rb")) == NULL) {
+			sprintf(tmsortErrStr, "Unable to open sort file\n'%s'.",
+				tmsortSortName);
+			ErStFileError(tmsortErrStr);
+			goto FAIL;
+		}
+		PhoHFileReadAhead(tmsortMergeFiles[i].theFile);
+
+		/* Read in the header (but ignore it) */
+		if (PhgHdrGtParams(tmsortMergeFiles[i].theFile, &sortHdrParams, &sortHeaderHk) == false){
+			sprintf(tmsortErrStr, "Unable to read input sort file header\n'%s'.",
+				tmsortSortName);
+			ErStFileError(tmsortErrStr);
+			goto FAIL;
+		}
+		PhgHdrFrHeader(&sortHeaderHk);
+
+		tmsortMergeFiles[i].bufStart = (DecayMergeData *)(tmsortMergeSpace + i*bufSize);
+		tmsortMergeFiles[i].bufSize = bufSize;
+		tmsortMergeFiles[i].bufDecays = 0;
+		tmsortMergeFiles[i].curRecord = NULL;
+
+		/* Read in the first decay */
 		if (! tmsortCustomFile) {
 			/* But only for standard files */
-			mergeBufferPtr = tmsortMergeFiles[i].bufStart;
 			tmsortDecayPending = false;
-			eventType = tmsortReadEvent(tmsortMergeFiles[i].theFile, 
-							&(tmsortMergeFiles[i].nextDecay), 
-							(PHG_DetectedPhoton *) &(mergeBufferPtr->decayData));
+			eventType = tmsortReadEvent(tmsortMergeFiles[i].theFile,
+							&(tmsortMergeFiles[i].nextDecay),
+							(PHG_DetectedPhoton *) &(tmsortMergeFiles[i].bufStart->decayData));
 			if (eventType != Decay) {
 				ErStGeneric("Expected first event to be decay, and it wasn't.");
 				goto FAIL;
 			}
 		}
-		
-		/* Mark the file as ready for reading */
+
+		/* Mark the file as ready for reading, and fill its buffer */
 		tmsortMergeFiles[i].nextDecayPending = true;
+		tmsortAdvanceInput(i);
 	}
-	
-	/* Initialize decay counts */
-	numDecaysRead = 0;
-	numDecaysWritten = 0;
-	
-	/* Fill the buffers from each file */
-	for (i=0; i<numSortFiles; i++) {
-		tmsortFillMergeBuffer(i);
-		numDecaysRead += tmsortMergeFiles[i].bufDecays;
+	numInputs = numRuns;
+
+	/* The run kept in memory was read last, so its slices follow the files */
+	if (withResident && (tmsortNumResidentInputs != 0)) {
+		memcpy(tmsortMergeFiles + numRuns, tmsortResidentInputs,
+			tmsortNumResidentInputs*tmsortMergeFileSize);
+		numInputs += tmsortNumResidentInputs;
 	}
-	
-	/* Insert the start of each buffer into the sorted list */
-	for (i=0; i<numSortFiles; i++) {
-		if (tmsortMergeFiles[i].bufDecays > 0) {
-			tmsortGetDecaySortKey(&(tmsortMergeFiles[i].bufStart->decayData), 
-									&minSortKey);
-			if (! LbSortInsert(mergeListPtr, 
-						(LbSortKeyPtr)&minSortKey, 
-						i,	/* File index */
-						(PHG_Decay *)(tmsortMergeFiles[i].bufStart)
-							/* Buffer start */
-					)) {
-				
-				/* Severe problems; but just keep going */
-				sprintf(tmsortErrStr, "Got failure inserting decay into sorted list.");
-				ErStGeneric(tmsortErrStr);
-			}
-		}
+
+	/* Merge them into the output file */
+	if (! tmsortCreateSortFile(outFileNumber, &tmsortMergeFileHk)) {
+		goto FAIL;
 	}
-	
-	/* Find the special, first item in the sorted list */
-	if (! LbSortFirst(mergeListPtr, &minSortItem, &numPhotons, (void **)&nextDecayPtr)) {
-		/* Severe problems; but should never occur */
-		sprintf(tmsortErrStr, "Couldn't find null merge file sort item.");
-		ErStGeneric(tmsortErrStr);
+	if (! tmsortMergeInputs(numInputs, &tmsortMergeFileHk)) {
 		goto FAIL;
 	}
-	
-	/* Do the merge */
-	allDone = false;
-	while (! allDone) {
-		/* Find the minimal decay data buffer in the sorted list */
-		if (LbSortNext(mergeListPtr, minSortItem, &mergeItemPtr, 
-									&numPhotons, (void **)&nextDecayPtr)) {
-			if (LbSortNext(mergeListPtr, mergeItemPtr, &nextItemPtr, 
-										&numPhotons, (void **)&nextDecayPtr)) {
-				/* Note the next smallest buffer data */
-				LbSortGetItemSortKey(nextItemPtr, 
-						(LbSortKeyPtr)&nextSortKey, sizeof(TmSortKeyType));
+	if (! tmsortCloseSortFile(outFileNumber, &tmsortMergeFileHk, NULL)) {
+		goto FAIL;
+	}
+
+	/* Close and delete the merged input files */
+	for (i=0; i<numRuns; i++) {
+		/* Close the file (ignore errors) */
+		fclose(tmsortMergeFiles[i].theFile);
+		tmsortMergeFiles[i].theFile = NULL;
+
+#ifndef TMSORT_KEEP_TEMP_FILES
+		/* Delete the file (report errors, but keep going) */
+		sprintf(tmsortSortName,
+			"%s%ld", tmsortSortNameBase, (unsigned long)runFiles[i]);
+		if (remove(tmsortSortName) != 0) {
+			sprintf(tmsortErrStr, "Unable to delete sort file\n'%s'.",
+				tmsortSortName);
+			ErStFileError(tmsortErrStr);
+		}
+		sprintf(tmsortIndexName, "%s%s", tmsortSortName, PHOHFILE_INDEX_SUFFIX);
+		remove(tmsortIndexName);
+#endif
+	}
+
+	okay = true;
+
+
+	FAIL:;
+
+	return (okay);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			tmsortCreateSortFile
+*
+*	Summary:		Create the numbered sorted output file.
+*
+*	Arguments:
+*		LbUsFourByte	 	fileNumber				- The index of the file.
+*		PhoHFileHkTy	 	*sortFileHkPtr			- Hook to the created file.
+*
+*	Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean tmsortCreateSortFile(LbUsFourByte fileNumber, PhoHFileHkTy *sortFileHkPtr)
+{
+	Boolean				okay = false;				/* Function return value */
+
+
+	do { /* Process Loop */
+
+		sprintf(tmsortSortName,
+				"%s%ld", tmsortSortNameBase, (unsigned long)fileNumber);
+		if (PhoHFileCreate(tmsortSortName, "",
+				tmsortHdrParams.H.HdrKind, sortFileHkPtr) == false) {
+			sprintf(tmsortErrStr,"Unable to create sorted file named:\n"
+				"'%s'\n"
+				" (tmsortCreateSortFile)",
+				tmsortSortName);
+			ErStFileError(tmsortErrStr);
+			break;
+		}
+		if (PhoHFileSetCompressed(sortFileHkPtr, tmsortHdrParams.H.isCompressed) == false) {
+			/* Error should already have been reported */
+			break;
+		}
+		if (PhoHFileSetIndexed(sortFileHkPtr, tmsortIndexInterval) == false) {
+			/* Error should already have been reported */
+			break;
+		}
+
+		okay = true;
+	} while (false);
+
+	return (okay);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			tmsortCloseSortFile
+*
+*	Summary:		Give the numbered sorted output file the original header
+*						and close it.
+*
+*	Arguments:
+*		LbUsFourByte	 	fileNumber				- The index of the file.
+*		PhoHFileHkTy	 	*sortFileHkPtr			- Hook to the file.
+*		LbUsEightByte	 	*sortedFilesSize		- Total to add the file size to, or NULL.
+*
+*	Function return: True unless an error occurs.
+*
+*********************************************************************************/
+Boolean tmsortCloseSortFile(LbUsFourByte fileNumber, PhoHFileHkTy *sortFileHkPtr,
+			LbUsEightByte *sortedFilesSize)
+{
+	Boolean				okay = false;				/* Function return value */
+
+
+	do { /* Process Loop */
+
+		/* Copy the original file header data to the new file (it is desirable
+			that a sorted file have an identical header as its unsorted copy) */
+		memcpy(sortFileHkPtr->headerHk.headerData,
+				tmsortHistHeaderHk.headerData, tmsortHistHeaderHk.headerSize);
+
+		if (! tmsortPreserveHeader) {
+			/* Add the timesorted indicator */
+			tmsortHdrParams.H.isTimeSorted = true;
+			if (LbHdrStElem(&(sortFileHkPtr->headerHk), HDR_HISTORY_FILE_IS_SORTED_ID,
+					sizeof(tmsortHdrParams.H.isTimeSorted),
+					(void *)&(tmsortHdrParams.H.isTimeSorted)) == false){
+
+				sprintf(tmsortErrStr,"Unable to set header 'timesorted indicator' parameter.");
+				ErStFileError(tmsortErrStr);
+				break;
 			}
-			else {
-				/* Only one file left to merge */
-				nextSortKey = tmsortMaxKey;
+		}
+
+		/* Write out the buffered records */
+		if (PhoHFileEndWrites(sortFileHkPtr) == false) {
+			break;
+		}
+
+		/* Save the header to the sorted output file */
+		sprintf(tmsortSortName,
+				"%s%ld", tmsortSortNameBase, (unsigned long)fileNumber);
+		if (PhgHdrUpHeader(NULL, &tmsortHdrParams, &(sortFileHkPtr->headerHk)) == false) {
+			sprintf(tmsortErrStr, "Unable to write header to sorted history file\n'%s'.",
+				tmsortSortName);
+			ErStFileError(tmsortErrStr);
+			break;
+		}
+
+		/* Accumulate the size of the sorted output file */
+		if ((sortedFilesSize != NULL) && (fseek(sortFileHkPtr->histFile, 0, SEEK_END) == 0)) {
+			if (ftell(sortFileHkPtr->histFile) > 0) {
+				*sortedFilesSize += ftell(sortFileHkPtr->histFile);
 			}
 		}
-		else {
-			/* Nothing left in the list--all files merged */
-			allDone = true;
+
+		/* Close the output file */
+		/* NOTE:  Can't use PhoHFileClose because it restores the new header */
+		PhgHdrFrHeader(&sortFileHkPtr->headerHk);
+		if (fclose(sortFileHkPtr->histFile) != 0) {
+			sortFileHkPtr->histFile = NULL;
+			sprintf(tmsortErrStr,"Unable to close sorted file named:\n"
+				"'%s'\n"
+				" (tmsortCloseSortFile)",
+				tmsortSortName);
+			ErStFileError(tmsortErrStr);
+			break;
 		}
-		
-		if (! allDone) {
-			/* Set up at the minimum decay */
-			fileIndex = LbSortGetItemIndex(mergeItemPtr);
-			mergeBufferPtr = (DecayMergeData *)LbSortGetItemDataPtr(mergeItemPtr);
-			mergeDecayPtr = &(mergeBufferPtr->decayData);
-			remainingDecays = tmsortMergeFiles[fileIndex].bufDecays;
-			
-			/* Write out all minimal decays in this buffer */
-			do {
-				/* Write out the minimum decay */
-				if (! tmsortWriteDecay(&tmsortMergeFileHk, mergeDecayPtr,
-						(PHG_DetectedPhoton *)(mergeDecayPtr+1), 
-						mergeBufferPtr->numPhotons)) {
-					sprintf(tmsortErrStr, "Got failure writing merge decay to disk.");
-					ErStFileError(tmsortErrStr);
-					goto FAIL;
-				}
-				numDecaysWritten++;
-				dataSize = tmsortMergeDecaySize + 
-					mergeBufferPtr->numPhotons*tmsortPhotonSize;
-				mergeBufferPtr = (DecayMergeData *)
-					((LbUsOneByte *)mergeBufferPtr + dataSize);
-				mergeDecayPtr = &(mergeBufferPtr->decayData);
-				remainingDecays--;
-				
-				if (remainingDecays > 0) {
-					/* Get the next sort key in the buffer */
-					tmsortGetDecaySortKey(mergeDecayPtr, &minSortKey);
+		sortFileHkPtr->histFile = NULL;
+
+		/* Write its decay index, if requested */
+		if (PhoHFileEndIndex(sortFileHkPtr) == false) {
+			break;
+		}
+
+		okay = true;
+	} while (false);
+
+	return (okay);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			tmsortGetRunItems
+*
+*	Summary:		Return the start of a run's sort index.  The decays of a
+*						run fill the sort buffer from the start; their index
+*						entries fill it from the end, with as much space again
+*						below them for the radix sort.
+*
+*	Arguments:
+*		LbUsFourByte	 	numDecays			- The # of decays in the run.
+*
+*	Function return: The first index entry.
+*
+*********************************************************************************/
+DecaySortItem *tmsortGetRunItems(LbUsFourByte numDecays)
+{
+	return ((DecaySortItem *)((LbUsOneByte *)tmsortSortBufferPtr +
+				(tmsortDataBufferSize & ~15)) - numDecays);
+}
+
+
+/*********************************************************************************
+*
+*	Name:			tmsortReadRun
+*
+*	Summary:		Fill the sort buffer as much as possible with decays from
+*						the given input file, and index them for sorting.
+*					Stop early once the rest of the file is expected to fit
+*						in residentSpace but not in what remains of the buffer.
+*
+*	Arguments:
+*		FILE				*historyFile		- History file to read from.
+*		LbUsFourByte	 	residentSpace		- Space the rest of the file may
+*													use if kept in memory.
+*		LbUsFourByte	 	*numDecays			- The # of decays read.
+*		LbUsFourByte	 	*recordsSize		- Buffer space used by the decays.
+*		Boolean			 	*isAtEnd			- The file has been read to the end.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void tmsortReadRun(FILE *historyFile, LbUsFourByte residentSpace,
+			LbUsFourByte *numDecays, LbUsFourByte *recordsSize, Boolean *isAtEnd)
+{
+	DecaySortItem		*topItem;			/* End of the index entries */
+	DecaySortItem		*itemPtr;			/* Current index entry */
+	DecaySortItem		swapItem;			/* Entry being exchanged */
+	DecayMergeData		*recordPtr;			/* Current decay in the buffer */
+	LbUsFourByte		bufferSize;			/* Usable size of the buffer */
+	LbUsFourByte		decayCount;			/* Number of decays read */
+	LbUsFourByte		usedSpace;			/* Buffer space used by decays */
+	LbUsFourByte		runSpace;			/* Buffer space used by decays and index */
+	LbUsFourByte		dataSize;			/* Size of the decay data */
+	LbUsFourByte		numPhotons;			/* Number of photons in the decay */
+	LbUsFourByte		i;					/* Index through the entries */
+	LbUsEightByte		runStart;			/* File position of the run's first decay */
+	LbUsEightByte		filePos;			/* Current file position */
+	double				restSpace;			/* Expected space for the rest of the file */
+
+
+	topItem = tmsortGetRunItems(0);
+	bufferSize = tmsortDataBufferSize & ~15;
+	decayCount = 0;
+	usedSpace = 0;
+	runStart = (tmsortHistFileSize != 0) ? (LbUsEightByte) ftello(historyFile) : 0;
+	*isAtEnd = false;
+
+	for (;;) {
+		/* Stop when the buffer may not hold another decay with its index entries */
+		if (usedSpace + tmsortMaxRecordSpace +
+				2*(decayCount+1)*sizeof(DecaySortItem) > bufferSize) {
+			break;
+		}
+
+		/* Check now and then whether the rest of the file could stay in memory
+			after this run, using the space the run's decays have taken so far */
+		if ((tmsortHistFileSize != 0) && (decayCount != 0) &&
+				((decayCount % TMSORT_PLAN_DECAYS) == 0)) {
+
+			filePos = (LbUsEightByte) ftello(historyFile);
+			if ((filePos > runStart) && (filePos < tmsortHistFileSize)) {
+				runSpace = usedSpace + 2*decayCount*sizeof(DecaySortItem);
+				restSpace = (double)(tmsortHistFileSize - filePos) * runSpace /
+								(filePos - runStart) * TMSORT_PLAN_MARGIN;
+				if ((runSpace + restSpace > bufferSize) && (restSpace <= residentSpace)) {
+					break;
 				}
-			} while ((remainingDecays > 0) && (minSortKey <= nextSortKey));
-			
-			if (remainingDecays > 0) {
-				/* Save this buffer's decay count */
-				tmsortMergeFiles[fileIndex].bufDecays = remainingDecays;
-			}
-			else {
-				/* Reload the buffer from the input sort file */
-				tmsortFillMergeBuffer(fileIndex);
-				mergeBufferPtr = tmsortMergeFiles[fileIndex].bufStart;
-				remainingDecays = tmsortMergeFiles[fileIndex].bufDecays;
-				numDecaysRead += remainingDecays;
-				mergeDecayPtr = &(mergeBufferPtr->decayData);
-				tmsortGetDecaySortKey(mergeDecayPtr, &minSortKey);
 			}
-			
-			/* Readjust the sorted list */
-			if (! LbSortDelete(mergeListPtr, mergeItemPtr)) {
-				/* Severe problems; but just keep going */
-				sprintf(tmsortErrStr, "Got failure removing merge decay from sorted list.");
-				ErStGeneric(tmsortErrStr);
+		}
+
+		/* Read the decay and index it */
+		recordPtr = (DecayMergeData *)((LbUsOneByte *)tmsortSortBufferPtr + usedSpace);
+		if (! tmsortReadDecay(historyFile, &(recordPtr->decayData), &dataSize, &numPhotons)) {
+			/* Ran out of decay data */
+			*isAtEnd = true;
+			break;
+		}
+		recordPtr->numPhotons = numPhotons;
+		itemPtr = topItem - (decayCount+1);
+		itemPtr->radixKey = tmsortGetDecayRadixKey(&(recordPtr->decayData));
+		itemPtr->offset = usedSpace;
+		decayCount++;
+		usedSpace += tmsortMergeDecaySize + dataSize - tmsortDecaySize;
+
+		if ((! tmsortCustomFile) && (! tmsortDecayPending)) {
+			/* That was the last decay */
+			*isAtEnd = true;
+			break;
+		}
+	}
+
+	/* The index was filled downward; put it in the order the decays were read */
+	itemPtr = topItem - decayCount;
+	for (i=0; i<decayCount/2; i++) {
+		swapItem = itemPtr[i];
+		itemPtr[i] = itemPtr[decayCount-1-i];
+		itemPtr[decayCount-1-i] = swapItem;
+	}
+
+	*numDecays = decayCount;
+	*recordsSize = usedSpace;
+}
+
+
+/*********************************************************************************
+*
+*	Name:			tmsortSortRun
+*
+*	Summary:		Sort the index of the run in the sort buffer, in slices
+*						sorted by separate threads when the run is large.
+*					The sorted slices become the first merge inputs, ready
+*						to be merged.
+*
+*	Arguments:
+*		LbUsFourByte	 	numDecays			- The # of decays in the run.
+*		LbUsFourByte	 	*numInputs			- The # of sorted slices.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void tmsortSortRun(LbUsFourByte numDecays, LbUsFourByte *numInputs)
+{
+	DecaySortSlice		slices[TMSORT_MAX_THREADS];	/* The slices to sort */
+	DecaySortItem		*items;						/* The run's index */
+	LbUsFourByte		numSlices;					/* Number of slices */
+	LbUsFourByte		firstItem;					/* First entry of a slice */
+	LbUsFourByte		endItem;					/* End of a slice's entries */
+	LbUsFourByte		i;							/* Index through the slices */
+	#ifdef TMSORT_THREADED_SORT
+	pthread_t			threads[TMSORT_MAX_THREADS];	/* Threads sorting slices */
+	Boolean				isStarted[TMSORT_MAX_THREADS];	/* Did the thread start? */
+	#endif
+
+
+	/* Give each thread a fair share of the run */
+	numSlices = tmsortNumThreads;
+	while ((numSlices > 1) && (numDecays / numSlices < TMSORT_MIN_THREAD_DECAYS)) {
+		numSlices--;
+	}
+	items = tmsortGetRunItems(numDecays);
+	for (i=0; i<numSlices; i++) {
+		firstItem = (LbUsFourByte)(((LbUsEightByte) numDecays * i) / numSlices);
+		endItem = (LbUsFourByte)(((LbUsEightByte) numDecays * (i+1)) / numSlices);
+		slices[i].items = items + firstItem;
+		slices[i].scratch = items - numDecays + firstItem;
+		slices[i].numItems = endItem - firstItem;
+	}
+
+	/* Sort the slices; the first in this thread */
+	#ifdef TMSORT_THREADED_SORT
+		for (i=1; i<numSlices; i++) {
+			isStarted[i] = (pthread_create(&threads[i], NULL,
+								tmsortSortSliceMain, &slices[i]) == 0);
+		}
+		tmsortSortSlice(&slices[0]);
+		for (i=1; i<numSlices; i++) {
+			if (isStarted[i]) {
+				pthread_join(threads[i], NULL);
 			}
-			if (remainingDecays > 0) {
-				if (! LbSortInsert(mergeListPtr, 
-							(LbSortKeyPtr)&minSortKey, 
-							fileIndex, (PHG_Decay *)mergeBufferPtr)) {
-					/* Severe problems; but just keep going */
-					sprintf(tmsortErrStr, "Got failure adding merge decay to sorted list.");
-					ErStGeneric(tmsortErrStr);
-				}
+			else {
+				/* The thread couldn't be started, so sort it here */
+				tmsortSortSlice(&slices[i]);
 			}
 		}
+	#else
+		for (i=0; i<numSlices; i++) {
+			tmsortSortSlice(&slices[i]);
+		}
+	#endif
+
+	/* Make the slices the merge inputs */
+	for (i=0; i<numSlices; i++) {
+		tmsortMergeFiles[i].theFile = NULL;
+		tmsortMergeFiles[i].nextItem = slices[i].items;
+		tmsortMergeFiles[i].endItem = slices[i].items + slices[i].numItems;
+		tmsortMergeFiles[i].curRecord = NULL;
+		tmsortAdvanceInput(i);
 	}
-	
-	okay = true;
-	
-	
-	FAIL:;
-	
-	/* Free memory */
-	LbSortDisposeList(&mergeListPtr);
-	
-	return (okay);
+
+	*numInputs = numSlices;
+}
+
+
+/*********************************************************************************
+*
+*	Name:			tmsortSortSlice
+*
+*	Summary:		Sort a slice of a run's index, leaving it in place.
+*
+*	Arguments:
+*		DecaySortSlice		*slicePtr			- The slice.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void tmsortSortSlice(DecaySortSlice *slicePtr)
+{
+	DecaySortItem		*sortedItems;		/* Where the sorted entries ended up */
+
+
+	sortedItems = tmsortRadixSort(slicePtr->items, slicePtr->scratch, slicePtr->numItems);
+	if (sortedItems != slicePtr->items) {
+		memcpy(slicePtr->items, sortedItems, slicePtr->numItems*sizeof(DecaySortItem));
+	}
+}
+
+
+#ifdef TMSORT_THREADED_SORT
+/*********************************************************************************
+*
+*	Name:			tmsortSortSliceMain
+*
+*	Summary:		A thread sorting one slice of a run's index.
+*
+*	Arguments:
+*		void				*slicePtr			- The slice.
+*
+*	Function return: None.
+*
+*********************************************************************************/
+void *tmsortSortSliceMain(void *slicePtr)
+{
+	tmsortSortSlice((DecaySortSlice *) slicePtr);
+
+	return (NULL);
 }
+#endif
 
 
 /*********************************************************************************
 *
-*	Name:			tmsortGetFirstBatch
+*	Name:			tmsortRadixSort
 *
-*	Summary:		Fill the data buffer as much as possible with new events 
-*						from the given input file.
-*					Record the locations and photon counts for later sorting.
-*					Record the distribution of decay slots by photon counts.
+*	Summary:		Sort index entries by their radix keys, least significant
+*						byte first.  The sort is stable, so decays with equal
+*						keys keep the order they were read in.  Passes where
+*						every key has the same byte are skipped.
 *
 *	Arguments:
-*		FILE					*historyFile	- History file to read from.
-*		LbUsFourByte			bufferSize		- Space available in buffer.
-*		LbUsFourByte			*numDecays		- Number of decays read in.
+*		DecaySortItem		*items				- The entries to sort.
+*		DecaySortItem		*scratch			- Space for as many entries.
+*		LbUsFourByte		numItems			- The # of entries.
 *
-*	Function return: True if successful; false if not.
+*	Function return: items or scratch, whichever holds the sorted entries.
 *
 *********************************************************************************/
-Boolean tmsortGetFirstBatch(FILE *historyFile, 
-							LbUsFourByte bufferSize, LbUsFourByte *numDecays)
+DecaySortItem *tmsortRadixSort(DecaySortItem *items, DecaySortItem *scratch,
+					LbUsFourByte numItems)
 {
-	Boolean				result;				/* Function return value */
-	PHG_Decay			*bufPtr;			/* Local pointer into data buffer */
-	LbUsFourByte		availSpace;			/* Size of remaining buffer space */
-	LbUsFourByte		minSpaceReqd;		/* Guaranteed empty space */
-	DecaySortBlock		*curBlockPtr;		/* Pointer to the current block */
-	LbUsFourByte		curBlockCount;		/* Data count of current block */
-	LbUsFourByte		i;					/* Index through number of photons */
-	LbUsFourByte		dataSize;			/* Size of single decay data */
-	LbUsFourByte		numPhotons;			/* Photons associated with a decay */
-	DecaySortData		*sortDataPtr;		/* Pointer to the current data */
-	
-	
-	result = true;
-	bufPtr = tmsortSortBufferPtr;
-	availSpace = bufferSize;
-	minSpaceReqd = 2*tmsortDecaySize + PHG_MAX_DETECTED_PHOTONS*tmsortPhotonSize;
-	curBlockPtr = tmsortTempDecayBlocksList;
-	curBlockCount = 0;
-	
-	/* Zero out the decay counts (for use as temporary counters) */
-	for (i=0; i<=PHG_MAX_DETECTED_PHOTONS; i++) {
-		tmsortDecaySlotCounts[i] = 0;
+	LbUsFourByte		counts[TMSORT_RADIX_PASSES][TMSORT_RADIX_SIZE];
+											/* Counts of each digit, then
+												where its entries go next */
+	DecaySortItem		*fromItems;			/* Entries being sorted from */
+	DecaySortItem		*toItems;			/* Entries being sorted into */
+	DecaySortItem		*swapItems;			/* Exchange of the two */
+	LbUsEightByte		radixKey;			/* Key of the current entry */
+	LbUsFourByte		pass;				/* Index through the passes */
+	LbUsFourByte		shift;				/* Shift to the pass's digit */
+	LbUsFourByte		digit;				/* The current digit */
+	LbUsFourByte		total;				/* Running total of digit counts */
+	LbUsFourByte		count;				/* Count of the current digit */
+	LbUsFourByte		i;					/* Index through the entries */
+
+
+	/* Count the digits of every pass at once */
+	memset(counts, 0, sizeof(counts));
+	for (i=0; i<numItems; i++) {
+		radixKey = items[i].radixKey;
+		for (pass=0; pass<TMSORT_RADIX_PASSES; pass++) {
+			counts[pass][radixKey & (TMSORT_RADIX_SIZE-1)]++;
+			radixKey >>= TMSORT_RADIX_BITS;
+		}
 	}
-	
-	/* Fill the buffer as much as possible */
-	while (result && (availSpace >= minSpaceReqd)) {
-		if (tmsortReadDecay(historyFile, bufPtr, &dataSize, &numPhotons)) {
-			/* A decay was read; reduce the available buffer space */
-			availSpace -= dataSize;
-			
-			/* Record the data for later sorting */
-			if (curBlockCount >= tmsortBlockSize) {
-				/* Need to allocate a new block */
-				if ((curBlockPtr->nextSortBlock = (DecaySortBlock *) 
-						LbMmAlloc(sizeof(DecaySortBlock))) == NULL) {
-					sprintf(tmsortErrStr, "Unable to allocate memory:  DecaySortBlock.");
-					ErStGeneric(tmsortErrStr);
-					result = false;
-					break;
-				}
-				curBlockPtr = curBlockPtr->nextSortBlock;
-				curBlockPtr->nextSortBlock = NULL;
-				if ((curBlockPtr->thisDataBlock = (DecaySortData *) 
-						LbMmAlloc(tmsortBlockSize*sizeof(DecaySortData))) == NULL) {
-					sprintf(tmsortErrStr, "Unable to allocate memory:  DecaySortData.");
-					ErStGeneric(tmsortErrStr);
-					result = false;
-					break;
-				}
-				curBlockCount = 0;
-			}
-			sortDataPtr = curBlockPtr->thisDataBlock + curBlockCount;
-			sortDataPtr->numPhotons = numPhotons;
-			sortDataPtr->decayDataPtr = bufPtr;
-			curBlockCount++;
-			
-			/* Record the decay data by photon count */
-			tmsortDecaySlotCounts[numPhotons]++;
-			
-			bufPtr = (PHG_Decay *)((LbUsOneByte *)bufPtr + dataSize);
+
+	fromItems = items;
+	toItems = scratch;
+	for (pass=0; (pass<TMSORT_RADIX_PASSES) && (numItems>0); pass++) {
+		shift = pass*TMSORT_RADIX_BITS;
+
+		/* Skip the pass if every key has the same digit */
+		digit = (LbUsFourByte)((fromItems[0].radixKey >> shift) & (TMSORT_RADIX_SIZE-1));
+		if (counts[pass][digit] == numItems) {
+			continue;
 		}
-		else {
-			/* Ran out of decay data */
-			
-			/* Record the end of data, if necessary */
-			if (curBlockCount < tmsortBlockSize) {
-				sortDataPtr = curBlockPtr->thisDataBlock + curBlockCount;
-				sortDataPtr->decayDataPtr = NULL;
-			}
-			
-			break;
+
+		/* Turn the counts into the first position for each digit */
+		total = 0;
+		for (digit=0; digit<TMSORT_RADIX_SIZE; digit++) {
+			count = counts[pass][digit];
+			counts[pass][digit] = total;
+			total += count;
 		}
+
+		/* Distribute the entries by digit */
+		for (i=0; i<numItems; i++) {
+			digit = (LbUsFourByte)((fromItems[i].radixKey >> shift) & (TMSORT_RADIX_SIZE-1));
+			toItems[counts[pass][digit]++] = fromItems[i];
+		}
+
+		swapItems = fromItems;
+		fromItems = toItems;
+		toItems = swapItems;
 	}
-	
-	/* Add up the total decays and record the maximum photon counts */
-	*numDecays = 0;
-	for (i=0; i<=PHG_MAX_DETECTED_PHOTONS; i++) {
-		*numDecays += tmsortDecaySlotCounts[i];
-		
-		tmsortDecaySlotMaxs[i] = tmsortDecaySlotCounts[i];
-		tmsortDecaySlotCounts[i] = 0;	/* Restore to 0 */
-	}
-	
-	return (result);
+
+	return (fromItems);
 }
 
 
 /*********************************************************************************
 *
-*	Name:			tmsortGetNextBatch
+*	Name:			tmsortMergeInputs
 *
-*	Summary:		Fill the sort buffer as much as possible with numDecays 
-*						from the given input file.
-*					Record the decay positions in the record array.
+*	Summary:		Merge the first numInputs merge inputs into the output
+*						file.  The inputs are held in a loser tree (Knuth
+*						vol III, 5.4.1), so each decay written costs one
+*						comparison per level of the tree.
 *
 *	Arguments:
-*		FILE				*historyFile		- History file to read from.
-*		LbSortListPtr		sortListPtr			- The sort list.
-*		LbUsFourByte	 	*reserveSpace		- Size of reserve buffer space.
-*		LbUsFourByte	 	*numDecays			- The # of decays to read, 
-*													and actually read.
+*		LbUsFourByte	 	numInputs			- The # of inputs.
+*		PhoHFileHkTy	 	*outFileHkPtr		- Hook to the output file.
 *
-*	Function return: True if data read, false if none remained or could be read.
+*	Function return: True unless an error occurs.
 *
 *********************************************************************************/
-Boolean tmsortGetNextBatch(FILE *historyFile, LbSortListPtr sortListPtr, 
-							LbUsFourByte *reserveSpace, LbUsFourByte *numDecays)
+Boolean tmsortMergeInputs(LbUsFourByte numInputs, PhoHFileHkTy *outFileHkPtr)
 {
-	Boolean				dataRead;			/* Function return value */
-	LbUsFourByte		availSpace;			/* Size of remaining buffer space */
-	LbUsFourByte		minSpaceReqd;		/* Minimum reserve buffer size */
-	LbUsFourByte		decaysRead;			/* Number of decays read in */
-	PHG_Decay			*localBufferPtr;	/* Local ptr into reserve buffer */
-	LbUsFourByte		i;					/* Index through slot counts */
-	LbUsFourByte		d;					/* Index through numDecays */
-	LbUsFourByte		dataSize;			/* Size of decay */
-	LbUsFourByte		numPhotons;			/* Number of photons in decay */
-	PHG_Decay			*decayLocation;		/* Where decay is stored */
-	
-	
-	dataRead = false;
-	availSpace = *reserveSpace;
-	minSpaceReqd = 2*tmsortDecaySize + PHG_MAX_DETECTED_PHOTONS*tmsortPhotonSize;
-	
-	decaysRead = 0;
-	if ((availSpace >= minSpaceReqd) && (*numDecays > 0)) {
-		localBufferPtr = tmsortReserveBufferPtr;
-		
-		/* Clear the next read distribution */
-		tmsortCurDist = (tmsortCurDist + 1) % TMSORT_DIST_CT;
-		for (i=0; i<=PHG_MAX_DETECTED_PHOTONS; i++) {
-			tmsortDecaySlotDists[tmsortCurDist][i] = 0;
+	Boolean				okay = false;		/* Function return value */
+	LbUsFourByte		*loserTree;			/* Loser of each match; the winner in [0] */
+	LbUsFourByte		*winners;			/* Winner of each match, while building */
+	LbUsFourByte		node;				/* Index through the matches */
+	LbUsFourByte		winner;				/* Input with the smallest decay */
+	LbUsFourByte		loser;				/* Input beaten by the winner */
+	DecayMergeData		*recordPtr;			/* Decay being written */
+
+
+	/* Build the tree; the inputs are the leaves numInputs..2*numInputs-1 */
+	loserTree = tmsortLoserTree;
+	winners = tmsortLoserTree + tmsortMaxMergeInputs;
+	for (node=0; node<numInputs; node++) {
+		winners[numInputs+node] = node;
+	}
+	for (node=numInputs-1; node>0; node--) {
+		if (tmsortInputBefore(winners[2*node], winners[2*node+1])) {
+			winners[node] = winners[2*node];
+			loserTree[node] = winners[2*node+1];
 		}
-		
-		for (d=0; d<*numDecays; d++) {
-			if (tmsortReadDecay(historyFile, localBufferPtr, &dataSize, &numPhotons)) {
-				dataRead = true;
-				decaysRead++;
-				tmsortDecaySlotDists[tmsortCurDist][numPhotons]++;
-				
-				/* Try to fit the data into the buffer memory */
-				if (! tmsortStoreDecay(localBufferPtr, numPhotons, &decayLocation)) {
-					/* Couldn't find a spot, so use reserve buffer space for it */
-					localBufferPtr = (PHG_Decay *)((LbUsOneByte *)localBufferPtr + dataSize);
-					availSpace -= dataSize;
-				}
-				
-				/* Add the data to the sorted list */
-				if (! tmsortSortDecay(sortListPtr, decayLocation, numPhotons)) {
-					sprintf(tmsortErrStr, "Unable to sort data; all results are invalid.");
-					ErStGeneric(tmsortErrStr);
-					break;
-				}
-				
-				/* Check for low memory */
-				if (availSpace < minSpaceReqd) {
-					break;
-				}
-			}
-			else {
-				/* Ran out of decay data */
-				break;
+		else {
+			winners[node] = winners[2*node+1];
+			loserTree[node] = winners[2*node];
+		}
+	}
+	loserTree[0] = (numInputs > 1) ? winners[1] : 0;
+
+	/* Write out the winning decay until all inputs are used up */
+	for (;;) {
+		winner = loserTree[0];
+		recordPtr = tmsortMergeFiles[winner].curRecord;
+		if (recordPtr == NULL) {
+			break;
+		}
+
+		if (! tmsortWriteDecay(outFileHkPtr, &(recordPtr->decayData),
+				(PHG_DetectedPhoton *)(&(recordPtr->decayData)+1),
+				recordPtr->numPhotons)) {
+			sprintf(tmsortErrStr, "Got failure writing sort decay to disk.");
+			ErStFileError(tmsortErrStr);
+			goto FAIL;
+		}
+
+		/* Replay the winner's matches with its next decay */
+		tmsortAdvanceInput(winner);
+		for (node=(winner+numInputs)/2; node>0; node/=2) {
+			loser = loserTree[node];
+			if (tmsortInputBefore(loser, winner)) {
+				loserTree[node] = winner;
+				winner = loser;
 			}
 		}
-		
-		/* Update reserve space */
-		*reserveSpace = availSpace;
-		
-		/* Update reserve buffer ptr */
-		tmsortReserveBufferPtr = localBufferPtr;
+		loserTree[0] = winner;
 	}
-	
-	/* Update numDecays */
-	*numDecays = decaysRead;
-	
-	
-	return (dataRead);
+
+	okay = true;
+
+
+	FAIL:;
+
+	return (okay);
 }
 
 
 /*********************************************************************************
 *
-*	Name:			tmsortClearReserveBuffer
+*	Name:			tmsortInputBefore
 *
-*	Summary:		Clear out the reserve buffer as much as possible.
+*	Summary:		Decide whether one merge input's decay comes before
+*						another's.  Used up inputs come last; equal keys go
+*						in input order, which is the order they were read in.
 *
 *	Arguments:
-*		LbSortListPtr		sortListPtr		- The sort list.
-*		LbUsFourByte	 	*reserveSpace	- Size of reserve buffer.
-*		LbUsFourByte	 	*clearedDecays	- Number of decays removed from reserve buffer.
+*		LbUsFourByte	 	input1				- The first input.
+*		LbUsFourByte	 	input2				- The second input.
 *
-*	Function return: None.
+*	Function return: True if input1's decay comes first.
 *
 *********************************************************************************/
-void tmsortClearReserveBuffer(LbSortListPtr sortListPtr, 
-						LbUsFourByte *reserveSpace, LbUsFourByte *clearedDecays)
+Boolean tmsortInputBefore(LbUsFourByte input1, LbUsFourByte input2)
 {
-	LbUsFourByte		clearedCount;		/* Number of decays cleared from reserve buffer */
-	PHG_Decay			*usedResBufferPtr;	/* Pointer to end of used reserve buffer */
-	PHG_Decay			*curResBufferPtr;	/* Pointer into previous reserve buffer */
-	TmSortKeyType		decaySortKey;		/* Decay time sort key */
-	LbSortItemPtr		theSortItemPtr;		/* Sorted list item for current decay */
-	Boolean				foundDecay;			/* Result of sorted list data search */
-	LbUsFourByte		numPhotons;			/* Number of photons in decay */
-	PHG_Decay			*decayLocation;		/* Where decay is stored */
-	TmSortKeyType		foundSortKey;		/* Sort key of theSortItemPtr */
-	LbUsFourByte		dataSize;			/* Size of decay data */
-	PHG_Decay			*storedLocation;	/* New location of decay data */
-	
-	
-	/* Scan through the data in the reserve buffer */
-	clearedCount = 0;
-	usedResBufferPtr = tmsortResBufferStart;
-	curResBufferPtr = tmsortResBufferStart;
-	while (curResBufferPtr < tmsortReserveBufferPtr) {
-		/* Get the decay sort key */
-		tmsortGetDecaySortKey(curResBufferPtr, &decaySortKey);
-		
-		if (decaySortKey != tmsortMinKey) {
-			/* Find the data in the sorted list */
-			if (! LbSortFind(sortListPtr, (LbSortKeyPtr)&decaySortKey, &theSortItemPtr)) {
-				/* Data isn't in sorted list!!  Severe error. */
-				foundDecay = false;
-				sprintf(tmsortErrStr, "Sort data missing; all results are invalid.");
-				ErStGeneric(tmsortErrStr);
-				break;
-			}
-			
-			/* Make sure the sorted list item is the correct one */
-			foundDecay = true;
-			while (((PHG_Decay *)LbSortGetItemDataPtr(theSortItemPtr)) != curResBufferPtr) {
-				/* Get the previous one */
-				foundDecay = LbSortPrev(sortListPtr, 
-					theSortItemPtr, &theSortItemPtr, &numPhotons, (void **)&decayLocation);
-				if (! foundDecay) {
-					/* Data isn't in sorted list!!  Severe error. */
-					sprintf(tmsortErrStr, "Sort data missing; all results are invalid.");
-					ErStGeneric(tmsortErrStr);
-					break;
-				}
-				LbSortGetItemSortKey(theSortItemPtr, 
-						(LbSortKeyPtr)&foundSortKey, sizeof(TmSortKeyType));
-				if (foundSortKey != decaySortKey) {
-					/* Data isn't in sorted list!!  Severe error. */
-					foundDecay = false;
-					sprintf(tmsortErrStr, "Sort data missing; all results are invalid.");
-					ErStGeneric(tmsortErrStr);
-					break;
-				}
-			}
-			if (! foundDecay) {
-				break;
-			}
-			
-			/* Try to store the decay in the main buffer */
-			numPhotons = LbSortGetItemIndex(theSortItemPtr);
-			dataSize = tmsortDecaySize + numPhotons*tmsortPhotonSize;
-			if (tmsortStoreDecay(curResBufferPtr, numPhotons, &storedLocation)) {
-				/* Decay data now no longer in reserve buffer */
-				LbSortSetItemDataPtr(theSortItemPtr, storedLocation);
-				clearedCount++;
-				*reserveSpace += dataSize;
-			}
-			else {
-				/* Couldn't find a spot, so it stays in the reserve buffer */
-				if (usedResBufferPtr < curResBufferPtr) {
-					/* Compress the reserve buffer */
-					memcpy(usedResBufferPtr, curResBufferPtr, dataSize);
-					
-					/* Update the recorded data location */
-					LbSortSetItemDataPtr(theSortItemPtr, usedResBufferPtr);
-				}
-				usedResBufferPtr = (PHG_Decay *)((LbUsOneByte *)usedResBufferPtr + dataSize);
-			}
-		}
-		else {
-			/* Decay has been written out already; data is invalid except for photon count */
-			dataSize = tmsortDecaySize + 
-				(*((LbUsFourByte *)((LbUsOneByte *)curResBufferPtr + TMSORT_TEMP_COUNT_OFFSET))) * 
-				tmsortPhotonSize;
-			*reserveSpace += dataSize;
-		}
-		
-		curResBufferPtr = (PHG_Decay *)((LbUsOneByte *)curResBufferPtr + dataSize);
+	MergeFileData		*inputPtr1;			/* The first input */
+	MergeFileData		*inputPtr2;			/* The second input */
+
+
+	inputPtr1 = tmsortMergeFiles + input1;
+	inputPtr2 = tmsortMergeFiles + input2;
+
+	if (inputPtr1->curRecord == NULL) {
+		return (false);
 	}
-	*clearedDecays = clearedCount;
-	
-	/* Update the start of the reserve buffer */
-	tmsortReserveBufferPtr = usedResBufferPtr;
+	if (inputPtr2->curRecord == NULL) {
+		return (true);
+	}
+	if (inputPtr1->curKey != inputPtr2->curKey) {
+		return (inputPtr1->curKey < inputPtr2->curKey);
+	}
+
+	return (input1 < input2);
 }
 
 
 /*********************************************************************************
 *
-*	Name:			tmsortEstimateReadDecays
+*	Name:			tmsortAdvanceInput
 *
-*	Summary:		Make an estimate of the maximum number of decays to read.
+*	Summary:		Move a merge input on to its next decay, refilling a
+*						file's read buffer when it is used up.
 *
-*	Arguments:		None.
+*	Arguments:
+*		LbUsFourByte	 	inputIndex			- The input.
 *
-*	Function return: The estimated number of decays that can be read.
+*	Function return: None.
 *
 *********************************************************************************/
-LbUsFourByte tmsortEstimateReadDecays(void)
+void tmsortAdvanceInput(LbUsFourByte inputIndex)
 {
-	LbUsFourByte		curReadTotal;		/* Count of current distribution decays */
-	LbUsFourByte		i;					/* Index through photon counts */
-	LbUsFourByte		j;					/* Index through decay distributions */
-	LbUsFourByte		curReadDist[PHG_MAX_DETECTED_PHOTONS+1];
-											/* Running average distribution */
-	LbUsFourByte		histoCell;			/* Count in histogram single cell */
-	float				bestMult;			/* Best scale multiplier of current distribution */
-	LbUsFourByte		estDecays;			/* The estimated decay count */
-	
-	
-	/* Compute the running average distribution currently being read */
-	curReadTotal = 0;
-	for (i=0; i<=PHG_MAX_DETECTED_PHOTONS; i++) {
-		histoCell = tmsortDecaySlotDists[0][i];
-		curReadDist[i] = histoCell;
-		curReadTotal += histoCell;
-	}
-	for (j=1; j<TMSORT_DIST_CT; j++) {
-		for (i=0; i<=PHG_MAX_DETECTED_PHOTONS; i++) {
-			histoCell = tmsortDecaySlotDists[j][i];
-			curReadDist[i] += histoCell;
-			curReadTotal += histoCell;
+	MergeFileData		*inputPtr;			/* The input */
+
+
+	inputPtr = tmsortMergeFiles + inputIndex;
+
+	if (inputPtr->theFile == NULL) {
+		/* A sorted slice of the sort buffer */
+		if (inputPtr->nextItem < inputPtr->endItem) {
+			inputPtr->curRecord = (DecayMergeData *)
+				((LbUsOneByte *)tmsortSortBufferPtr + inputPtr->nextItem->offset);
+			inputPtr->curKey = inputPtr->nextItem->radixKey;
+			inputPtr->nextItem++;
 		}
-	}
-	
-	/* Find the largest multiplier of the current distribution that will fit 
-		in the open slots distribution */
-	for (i=0; i<=PHG_MAX_DETECTED_PHOTONS; i++) {
-		if ((tmsortDecaySlotMaxs[i] > 0) && (curReadDist[i] > 0)) {
-			/* Set best multiplier to start with */
-			bestMult = (float)tmsortDecaySlotCounts[i] / 
-						curReadDist[i];
-			break;
+		else {
+			inputPtr->curRecord = NULL;
 		}
 	}
-	for (i=0; i<=PHG_MAX_DETECTED_PHOTONS; i++) {
-		if ((tmsortDecaySlotMaxs[i] > 0) && (curReadDist[i] > 0)) {
-			if (bestMult*curReadDist[i] > tmsortDecaySlotCounts[i]) {
-				/* Have to reduce the multiplier */
-				bestMult = (float)tmsortDecaySlotCounts[i] / 
-							curReadDist[i];
-			}
+	else {
+		/* A sort file */
+		if ((inputPtr->curRecord != NULL) && (inputPtr->bufDecays > 1)) {
+			inputPtr->curRecord = (DecayMergeData *)((LbUsOneByte *)inputPtr->curRecord +
+				tmsortMergeDecaySize + inputPtr->curRecord->numPhotons*tmsortPhotonSize);
+			inputPtr->bufDecays--;
+		}
+		else {
+			tmsortFillMergeBuffer(inputIndex);
+			inputPtr->curRecord = (inputPtr->bufDecays > 0) ? inputPtr->bufStart : NULL;
+		}
+
+		if (inputPtr->curRecord != NULL) {
+			inputPtr->curKey = tmsortGetDecayRadixKey(&(inputPtr->curRecord->decayData));
 		}
 	}
-	
-	/* Compute the estimated number to read in */
-	estDecays = (LbUsFourByte)(bestMult*curReadTotal + 0.5);
-	
-	/* Return the estimate */
-	return (estDecays);
 }
 
 
@@ -2639,206 +2470,6 @@ void tmsortFillMergeBuffer(LbUsFourByte fileIndex)
 }
 
 
-/*********************************************************************************
-*
-*	Name:			tmsortSortDecay
-*
-*	Summary:		Record the decay into its sorted position in the sorted list.
-*
-*	Arguments:
-*		LbSortListPtr		sortListPtr		- The sorted list.
-*		PHG_Decay			*decayPtr		- The decay data.
-*		LbUsFourByte	 	numPhotons		- The number of photons in the decay.
-*
-*	Function return: True if successful.
-*
-*********************************************************************************/
-Boolean tmsortSortDecay(LbSortListPtr sortListPtr, 
-							PHG_Decay *decayPtr, LbUsFourByte numPhotons)
-{
-	Boolean				result = false;		/* Function return */
-	TmSortKeyType		decaySortKey;		/* Decay time sort key */
-	
-	
-	/* Get the decay sort key */
-	tmsortGetDecaySortKey(decayPtr, &decaySortKey);
-	
-	/* Add the decay to the sorted list */
-	if (! LbSortInsert(sortListPtr, (LbSortKeyPtr)&decaySortKey, numPhotons, decayPtr)) {
-		/* Severe problems */
-		sprintf(tmsortErrStr, "Got failure inserting decay into sorted list.");
-		ErStGeneric(tmsortErrStr);
-		result = false;
-	}
-	else {
-		result = true;
-	}
-	
-	return (result);
-}
-
-
-/*********************************************************************************
-*
-*	Name:			tmsortStoreDecay
-*
-*	Summary:		Store the decay record in the buffer memory.
-*
-*	Arguments:
-*		PHG_Decay				*decayPtr		- The decay data to store.
-*		LbUsFourByte	 		numPhotons		- Number of photons in the decay.
-*		PHG_Decay				**decayLocation	- Returned decay data location.
-*
-*	Function return: True if decay data stored in buffer;
-*						false if no place for it.
-*
-*********************************************************************************/
-Boolean tmsortStoreDecay(PHG_Decay *decayPtr, LbUsFourByte numPhotons,
-							PHG_Decay **decayLocation)
-{
-	Boolean				found;				/* If proper memory location found */
-	PHG_Decay			*decaySlot;			/* Proper decay location */
-	
-	
-	/* Find a memory location for the decay data */
-	found = tmsortGetDecaySlot(numPhotons, &decaySlot);
-	
-	if (found) {
-		/* Move the decay data to the located slot */
-		memcpy(decaySlot, decayPtr, 
-				tmsortDecaySize+numPhotons*tmsortPhotonSize);
-		*decayLocation = decaySlot;
-	}
-	else {
-		/* No available slot, so decay must remain in current buffer */
-		*decayLocation = decayPtr;
-	}
-	
-	/* Return the result */
-	return (found);
-}
-
-
-/*********************************************************************************
-*
-*	Name:			tmsortRemoveDecay
-*
-*	Summary:		Remove the decay record from the buffer memory.
-*
-*	Arguments:
-*		PHG_Decay				*decayLocation	- The decay data buffer location.
-*		LbUsFourByte	 		numPhotons		- Number of photons in the decay.
-*
-*	Function return: None.
-*
-*********************************************************************************/
-void tmsortRemoveDecay(PHG_Decay *decayLocation, LbUsFourByte numPhotons)
-{
-	LbUsFourByte		index;			/* Photon index into decay slot array */
-	LbUsFourByte		slotCount;		/* Available decay slots */
-	PHG_Decay			**slotPtr;		/* Pointer to decay data pointer */
-	
-	
-	if (decayLocation < tmsortResBufferStart) {
-		/* Record the main buffer decay location as an empty slot */
-		index = numPhotons;
-		slotCount = tmsortDecaySlotCounts[index];
-		slotPtr = tmsortDecaySlots[index] + slotCount;
-		*slotPtr = decayLocation;
-		tmsortDecaySlotCounts[index]++;
-	}
-	else {
-		/* Decay was stored in the reserve buffer; mark it as invalid */
-		tmsortSetDecaySortKey(decayLocation, tmsortMinKey);
-		
-		/* Save the number of photons in the invalid data location */
-		*((LbUsFourByte *)((LbUsOneByte *)decayLocation + TMSORT_TEMP_COUNT_OFFSET)) 
-			= numPhotons;
-	}
-}
-
-
-/*********************************************************************************
-*
-*	Name:			tmsortGetDecaySlot
-*
-*	Summary:		Find and return a memory slot for the decay.
-*					Record the used slot in the open slot list.
-*
-*	Arguments:
-*		LbUsFourByte 		numPhotons		- The number of decay photons.
-*		PHG_Decay			**decaySlot		- Located memory slot.
-*
-*	Function return: True if slot located.
-*
-*********************************************************************************/
-Boolean tmsortGetDecaySlot(LbUsFourByte numPhotons, PHG_Decay **decaySlot)
-{
-	Boolean				found;			/* Function result */
-	LbUsFourByte		index;			/* Photon index into decay slot array */
-	LbUsFourByte		slotCount;		/* Available decay slots */
-	PHG_Decay			**slotPtr;		/* Pointer to decay data slot */
-	
-	
-	found = false;
-	
-	index = numPhotons;
-	slotCount = tmsortDecaySlotCounts[index];
-	if (slotCount > 0) {
-		/* A spot for it is available */
-		slotPtr = tmsortDecaySlots[index] + slotCount-1;
-		*decaySlot = *slotPtr;
-		tmsortDecaySlotCounts[index]--;
-		found = true;
-	}
-	else {
-		/* No spot available for that photon count */
-		found = false;
-	}
-	
-	return (found);
-}
-
-
-/*********************************************************************************
-*
-*	Name:			tmsortKeyComparator
-*
-*	Summary:		Compare the two sort keys, key1 and key2.
-*
-*	Arguments:
-*		LbSortKeyPtr		keyPtr1			- Pointer to first sort key.
-*		LbSortKeyPtr		keyPtr2			- Pointer to second sort key.
-*
-*	Function return:  -1 if key1<key2; 0 if key1=key2; 1 if key1>key2.
-*
-*********************************************************************************/
-LbFourByte tmsortKeyComparator(LbSortKeyPtr keyPtr1, LbSortKeyPtr keyPtr2)
-{
-	TmSortKeyType		sortKey1;		/* First sort key */
-	TmSortKeyType		sortKey2;		/* Second sort key */
-	LbFourByte			result;			/* Result of function */
-	
-	
-	/* Compare the two sort keys and return the result */
-	
-	sortKey1 = *((TmSortKeyPtr) keyPtr1);
-	sortKey2 = *((TmSortKeyPtr) keyPtr2);
-	
-	if (sortKey1 < sortKey2) {
-		result = -1;
-	}
-	else if (sortKey1 == sortKey2) {
-		result = 0;
-	}
-	else {
-		result = 1;
-	}
-	
-	return (result);
-}
-
-
 /*********************************************************************************
 *
 *	Name:			tmsortGetDecaySortKey
@@ -2855,8 +2486,8 @@ LbFourByte tmsortKeyComparator(LbSortKeyPtr keyPtr1, LbSortKeyPtr keyPtr2)
 void tmsortGetDecaySortKey(PHG_Decay *decayPtr, TmSortKeyPtr decaySortKeyPtr)
 {
 	/* Find and return the sort key */
-	/* NOTE:  If you change this be sure to also change the Set Key function */
-	/* 		Also check tmsortMinKey, tmsortMaxKey, and tmsortKeyComparator */
+	/* NOTE:  If you change this be sure to also check tmsortMinKey
+			and tmsortGetDecayRadixKey */
 	
 	/* ### Correct as appropriate */
 	/**decaySortKeyPtr = ((PHG_DetectedPhoton *)(decayPtr+1))->time_since_creation;*/
@@ -2866,26 +2497,36 @@ void tmsortGetDecaySortKey(PHG_Decay *decayPtr, TmSortKeyPtr decaySortKeyPtr)
 
 /*********************************************************************************
 *
-*	Name:			tmsortSetDecaySortKey
+*	Name:			tmsortGetDecayRadixKey
 *
-*	Summary:		Set the sort key for the supplied decay.
+*	Summary:		Return the sort key for the supplied decay as an unsigned
+*						integer that orders the same way, for the radix sort.
 *
 *	Arguments:
 *		PHG_Decay			*decayPtr		- Pointer to decay data.
-*		TmSortKeyType		decaySortKey	- New decay sort key.
 *
-*	Function return: None.
+*	Function return: The radix sort key.
 *
 *********************************************************************************/
-void tmsortSetDecaySortKey(PHG_Decay *decayPtr, TmSortKeyType decaySortKey)
+LbUsEightByte tmsortGetDecayRadixKey(PHG_Decay *decayPtr)
 {
-	/* Set the new sort key */
-	/* NOTE:  If you change this be sure to also change the Get Key function */
-	/* 		Also check tmsortMinKey, tmsortMaxKey, and tmsortKeyComparator */
-	
-	/* ### Correct as appropriate */
-	/*((PHG_DetectedPhoton *)(decayPtr+1))->time_since_creation = decaySortKey;*/
-	decayPtr->decayTime = decaySortKey;
+	TmSortKeyType		decaySortKey;		/* The decay sort key */
+	LbUsEightByte		radixKey;			/* Its bits, reordered */
+
+
+	tmsortGetDecaySortKey(decayPtr, &decaySortKey);
+	memcpy(&radixKey, &decaySortKey, sizeof(radixKey));
+
+	/* Flip negative keys entirely and positive keys' sign bit, so that the
+		IEEE doubles order as unsigned integers */
+	if (radixKey & TMSORT_SIGN_BIT) {
+		radixKey = ~radixKey;
+	}
+	else {
+		radixKey |= TMSORT_SIGN_BIT;
+	}
+
+	return (radixKey);
 }
 
 
@@ -2982,6 +2623,7 @@ Boolean tmsortReadDecay(FILE *historyFile,
 			for (bIndex=0; bIndex<numBlue; bIndex++) {
 				
 				/* Read the photon information */
+				photonPtr->det_interactions = (detInteractionInfoTy *)(photonPtr + 1);
 				if (PhoHFileReadFields(&tmsortHistParamsHk, decayPtr, 
 										photonPtr, &photonAccepted) == false) {
 					/* Problem */
@@ -2990,7 +2632,7 @@ Boolean tmsortReadDecay(FILE *historyFile,
 				
 				/* Record the photon */
 				LbFgSet(photonPtr->flags, PHGFg_PhotonBlue);
-				photonPtr++;
+				photonPtr = (PHG_TrackingPhoton *)((LbUsOneByte *)photonPtr + tmsortPhotonSize);
 				(*numPhotons)++;
 			}
 			
@@ -3010,6 +2652,7 @@ Boolean tmsortReadDecay(FILE *historyFile,
 				for (pIndex=0; pIndex<numPink; pIndex++) {
 					
 					/* Read the photon information */
+					photonPtr->det_interactions = (detInteractionInfoTy *)(photonPtr + 1);
 					if (PhoHFileReadFields(&tmsortHistParamsHk, decayPtr, 
 											photonPtr, &photonAccepted) == false) {
 						/* Problem */
@@ -3018,7 +2661,7 @@ Boolean tmsortReadDecay(FILE *historyFile,
 					
 					/* Record the photon */
 					LbFgClear(photonPtr->flags, PHGFg_PhotonBlue);
-					photonPtr++;
+					photonPtr = (PHG_TrackingPhoton *)((LbUsOneByte *)photonPtr + tmsortPhotonSize);
 					(*numPhotons)++;
 				}
 			}
@@ -3060,6 +2703,25 @@ EventTy tmsortReadEvent(FILE *historyFile, PHG_Decay *decayPtr, PHG_DetectedPhot
 	
 	
 	do { /* Process Loop */
+		
+		/* Standard files are read by the history file module, which also 
+			decodes compressed files */
+		if (! tmsortCustomFile) {
+			switch (PhoHFileReadEvent(historyFile, decayPtr, photonPtr)) {
+				case PhoHFileDecayEvent:
+					eventType = Decay;
+					break;
+				
+				case PhoHFilePhotonEvent:
+					eventType = Photon;
+					break;
+				
+				default:
+					eventType = Null;
+					break;
+			}
+			break;
+		}
 
 		/* See what type of event we have */
 		if ((fread(&flag, sizeof(LbUsOneByte), 1, historyFile)) != 1) {
@@ -3132,11 +2794,11 @@ Boolean tmsortWriteDecay(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay,
 			PHG_DetectedPhoton *decayPhotons, LbUsFourByte numPhotons)
 {
 	PHG_TrackingPhoton	*photonPtr;		/* Pointer to custom photons */
-	PHG_TrackingPhoton	*bluePhotons;	/* Pointer to start of blue photons */
 	LbUsFourByte		numBluePhotons;	/* Count of blue photons */
-	PHG_TrackingPhoton	*pinkPhotons;	/* Pointer to start of pink photons */
 	LbUsFourByte		numPinkPhotons;	/* Count of pink photons */
 	LbUsFourByte		index;			/* Index through custom photons */
+	static PHG_TrackingPhoton	bluePhotons[PHG_MAX_DETECTED_PHOTONS];	/* The blue photons */
+	static PHG_TrackingPhoton	pinkPhotons[PHG_MAX_DETECTED_PHOTONS];	/* The pink photons */
 	
 	
 	if (! tmsortCustomFile) {
@@ -3148,25 +2810,29 @@ Boolean tmsortWriteDecay(PhoHFileHkTy *hdrHkTyPtr, PHG_Decay *decay,
 		/* Custom history file */
 		
 		photonPtr = (PHG_TrackingPhoton *)((LbUsOneByte *)decay + tmsortDecaySize);
-		bluePhotons = photonPtr;
 		numBluePhotons = 0;
-		pinkPhotons = NULL;
 		numPinkPhotons = 0;
 		
-		/* Count the blue and pink photons */
-		for (index=0; index<numPhotons; index++) {
+		/* Separate the blue and pink photons; each stored photon is followed 
+			by its detector interactions, which may have moved since it was read */
+		for (index=0; (index<numPhotons) && 
+				(numBluePhotons<PHG_MAX_DETECTED_PHOTONS) && 
+				(numPinkPhotons<PHG_MAX_DETECTED_PHOTONS); index++) {
 			if (LbFgIsSet(photonPtr->flags, PHGFg_PhotonBlue)) {
 				/* Blue photon */
+				bluePhotons[numBluePhotons] = *photonPtr;
+				bluePhotons[numBluePhotons].det_interactions = 
+					(detInteractionInfoTy *)(photonPtr + 1);
 				numBluePhotons++;
 			}
 			else {
 				/* Pink photon */
+				pinkPhotons[numPinkPhotons] = *photonPtr;
+				pinkPhotons[numPinkPhotons].det_interactions = 
+					(detInteractionInfoTy *)(photonPtr + 1);
 				numPinkPhotons++;
-				if (pinkPhotons == NULL) {
-					pinkPhotons = photonPtr;
-				}
 			}
-			photonPtr++;
+			photonPtr = (PHG_TrackingPhoton *)((LbUsOneByte *)photonPtr + tmsortPhotonSize);
 		}
 		
 		return (PhoHFileWriteDetections(hdrHkTyPtr, decay, 